@@ -0,0 +1,324 @@
+/* @file Счётчики купюр текущей инкассации. */
+
+#include "DatabaseUtils/BalanceCounters.h"
+
+#include <QtCore/QMap>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QStringList>
+
+#include <DatabaseProxy/DatabaseTransaction.h>
+#include <DatabaseProxy/IDatabaseProxy.h>
+#include <DatabaseProxy/IDatabaseQuery.h>
+
+namespace PPSDK = SDK::PaymentProcessor;
+
+namespace CBalanceCounters {
+const char CreateQuery[] = "INSERT OR IGNORE INTO `balance_counter` (`kind`, `type`, `nominal`, "
+                           "`currency`) VALUES (:kind, :type, :nominal, :currency)";
+
+const char CountQuery[] = "UPDATE `balance_counter` SET `count` = `count` + 1 WHERE `kind` = :kind "
+                          "AND `type` = :type AND `nominal` = :nominal AND `currency` = :currency";
+
+/// Серийные номера дописываются так же, как их склеивает GROUP_CONCAT(`serial`, ',').
+const char CountSerialQuery[] =
+    "UPDATE `balance_counter` SET `count` = `count` + 1, "
+    "`serials` = COALESCE(`serials` || ',', '') || :serial WHERE `kind` = :kind "
+    "AND `type` = :type AND `nominal` = :nominal AND `currency` = :currency";
+
+/// Отметка о порче счётчиков - строка вида StaleKind, её удаляет только пересборка.
+const int StaleKind = 2;
+
+const char MarkStaleQuery[] = "INSERT OR IGNORE INTO `balance_counter` (`kind`, `type`, "
+                              "`nominal`, `currency`) VALUES (:kind, 0, 0, 0)";
+
+const char StaleQuery[] = "SELECT COUNT(*) FROM `balance_counter` WHERE `kind` = :kind";
+
+const char ResetQuery[] = "DELETE FROM `balance_counter` WHERE `kind` = :kind";
+
+const char ReadQuery[] = "SELECT `type`, `nominal`, SUM(`count`), GROUP_CONCAT(`serials`, ',') "
+                         "FROM `balance_counter` WHERE `kind` = :kind "
+                         "GROUP BY `type`, `nominal` ORDER BY `type` ASC, `nominal` DESC";
+
+/// Прежние агрегирующие запросы баланса по всем купюрам.
+const char AcceptedQuery[] =
+    "SELECT `type`, `nominal`, COUNT(*), GROUP_CONCAT(`serial`, ',') FROM `payment_note` "
+    "WHERE ((NOT `ejection`) OR (`ejection` IS NULL)) AND `type` <> :emoney "
+    "GROUP BY `type`, `nominal` ORDER BY `type` ASC, `nominal` DESC";
+
+const char DispensedQuery[] =
+    "SELECT `type`, `nominal`, COUNT(*), GROUP_CONCAT(`serial`, ',') FROM `dispensed_note` "
+    "WHERE ((NOT `reported`) OR (`reported` IS NULL)) "
+    "GROUP BY `type`, `nominal` ORDER BY `type` ASC, `nominal` DESC";
+
+const char ClearQuery[] = "DELETE FROM `balance_counter`";
+
+const char RebuildAcceptedQuery[] =
+    "INSERT INTO `balance_counter` (`kind`, `type`, `nominal`, `currency`, `count`, `serials`) "
+    "SELECT 0, `type`, `nominal`, `currency`, COUNT(*), GROUP_CONCAT(`serial`, ',') "
+    "FROM `payment_note` WHERE ((NOT `ejection`) OR (`ejection` IS NULL)) AND `type` <> :emoney "
+    "GROUP BY `type`, `nominal`, `currency`";
+
+const char RebuildDispensedQuery[] =
+    "INSERT INTO `balance_counter` (`kind`, `type`, `nominal`, `currency`, `count`, `serials`) "
+    "SELECT 1, `type`, `nominal`, `currency`, COUNT(*), GROUP_CONCAT(`serial`, ',') "
+    "FROM `dispensed_note` WHERE ((NOT `reported`) OR (`reported` IS NULL)) "
+    "GROUP BY `type`, `nominal`, `currency`";
+} // namespace CBalanceCounters
+
+//---------------------------------------------------------------------------
+BalanceCounters::BalanceCounters(IDatabaseProxy &aDatabase)
+    : m_Database(aDatabase), m_Valid(true) {}
+
+//---------------------------------------------------------------------------
+bool BalanceCounters::add(EKind aKind, const PPSDK::SNote &aNote) {
+    if ((aKind == Accepted) && (aNote.type == PPSDK::EAmountType::EMoney)) {
+        return true;
+    }
+
+    auto exec = [&](const char *aQuery, bool aSerial) -> bool {
+        QScopedPointer<IDatabaseQuery> query(m_Database.createQuery(aQuery));
+        if (!query) {
+            return false;
+        }
+
+        query->bindValue(":kind", aKind);
+        query->bindValue(":type", aNote.type);
+        query->bindValue(":nominal", aNote.nominal.toString());
+        query->bindValue(":currency", aNote.currency);
+
+        if (aSerial) {
+            query->bindValue(":serial", aNote.serial);
+        }
+
+        return query->exec();
+    };
+
+    bool withSerial = !aNote.serial.isNull();
+
+    if (!exec(CBalanceCounters::CreateQuery, false) ||
+        !exec(withSerial ? CBalanceCounters::CountSerialQuery : CBalanceCounters::CountQuery,
+              withSerial)) {
+        m_Valid = false;
+
+        return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool BalanceCounters::reset(EKind aKind) {
+    QScopedPointer<IDatabaseQuery> query(m_Database.createQuery(CBalanceCounters::ResetQuery));
+    if (!query) {
+        m_Valid = false;
+
+        return false;
+    }
+
+    query->bindValue(":kind", aKind);
+
+    if (!query->exec()) {
+        m_Valid = false;
+
+        return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool BalanceCounters::read(EKind aKind, QList<PPSDK::SBalance::SAmounts> &aSums, double &aTotal) {
+    if (!m_Valid && !rebuild()) {
+        return false;
+    }
+
+    return select(CBalanceCounters::ReadQuery, aKind, aSums, aTotal);
+}
+
+//---------------------------------------------------------------------------
+bool BalanceCounters::recompute(EKind aKind,
+                                QList<PPSDK::SBalance::SAmounts> &aSums,
+                                double &aTotal) {
+    return select((aKind == Accepted) ? CBalanceCounters::AcceptedQuery
+                                      : CBalanceCounters::DispensedQuery,
+                  aKind,
+                  aSums,
+                  aTotal);
+}
+
+//---------------------------------------------------------------------------
+bool BalanceCounters::rebuild() {
+    DatabaseTransaction transaction(&m_Database);
+
+    if (!transaction) {
+        return false;
+    }
+
+    QStringList steps;
+    steps << CBalanceCounters::ClearQuery << CBalanceCounters::RebuildAcceptedQuery
+          << CBalanceCounters::RebuildDispensedQuery;
+
+    foreach (const QString &step, steps) {
+        QScopedPointer<IDatabaseQuery> query(m_Database.createQuery(step));
+        if (!query) {
+            return false;
+        }
+
+        if (step.contains(":emoney")) {
+            query->bindValue(":emoney", PPSDK::EAmountType::EMoney);
+        }
+
+        if (!query->exec()) {
+            return false;
+        }
+    }
+
+    if (!transaction.commit()) {
+        return false;
+    }
+
+    m_Valid = true;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void BalanceCounters::invalidate() {
+    m_Valid = false;
+}
+
+//---------------------------------------------------------------------------
+bool BalanceCounters::markStale() {
+    m_Valid = false;
+
+    QScopedPointer<IDatabaseQuery> query(m_Database.createQuery(CBalanceCounters::MarkStaleQuery));
+    if (!query) {
+        return false;
+    }
+
+    query->bindValue(":kind", CBalanceCounters::StaleKind);
+
+    return query->exec();
+}
+
+//---------------------------------------------------------------------------
+bool BalanceCounters::restore() {
+    QScopedPointer<IDatabaseQuery> query(m_Database.createQuery(CBalanceCounters::StaleQuery));
+    if (!query) {
+        return false;
+    }
+
+    query->bindValue(":kind", CBalanceCounters::StaleKind);
+
+    if (!query->exec() || !query->first()) {
+        return false;
+    }
+
+    if (query->value(0).toInt() == 0) {
+        return true;
+    }
+
+    m_Valid = false;
+
+    return rebuild();
+}
+
+//---------------------------------------------------------------------------
+bool BalanceCounters::select(const QString &aQuery,
+                             EKind aKind,
+                             QList<PPSDK::SBalance::SAmounts> &aSums,
+                             double &aTotal) {
+    QScopedPointer<IDatabaseQuery> query(m_Database.createQuery(aQuery));
+    if (!query) {
+        return false;
+    }
+
+    if (aQuery.contains(":kind")) {
+        query->bindValue(":kind", aKind);
+    }
+
+    if (aQuery.contains(":emoney")) {
+        query->bindValue(":emoney", PPSDK::EAmountType::EMoney);
+    }
+
+    if (!query->exec()) {
+        return false;
+    }
+
+    fill(*query, aSums, aTotal);
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void BalanceCounters::fill(IDatabaseQuery &aQuery,
+                           QList<PPSDK::SBalance::SAmounts> &aSums,
+                           double &aTotal) {
+    QMap<PPSDK::EAmountType::Enum, PPSDK::SBalance::SAmounts> amounts;
+    aTotal = 0.0;
+
+    for (aQuery.first(); aQuery.isValid(); aQuery.next()) {
+        PPSDK::EAmountType::Enum type =
+            static_cast<PPSDK::EAmountType::Enum>(aQuery.value(0).toInt());
+
+        if (!amounts.contains(type)) {
+            amounts[type].type = type;
+        }
+
+        amounts[type].amounts << PPSDK::SBalance::SAmounts::SAmount(aQuery.value(1).toDouble(),
+                                                                    aQuery.value(2).toInt(),
+                                                                    aQuery.value(3).toString());
+        aTotal += aQuery.value(1).toDouble() * aQuery.value(2).toInt();
+    }
+
+    aSums = amounts.values();
+}
+
+//---------------------------------------------------------------------------
+bool BalanceCounters::equal(const QList<PPSDK::SBalance::SAmounts> &aLeft,
+                            const QList<PPSDK::SBalance::SAmounts> &aRight,
+                            QString &aDifference) {
+    auto describe = [](const QList<PPSDK::SBalance::SAmounts> &aSums) -> QString {
+        QStringList result;
+
+        foreach (const PPSDK::SBalance::SAmounts &sums, aSums) {
+            foreach (const PPSDK::SBalance::SAmounts::SAmount &amount, sums.amounts) {
+                result << QString("%1:%2x%3").arg(sums.type).arg(amount.value.toString()).arg(
+                    amount.count);
+            }
+        }
+
+        return result.join(" ");
+    };
+
+    auto serials = [](const QString &aSerials) -> QStringList {
+        QStringList result = aSerials.split(",");
+        result.sort();
+
+        return result;
+    };
+
+    bool result = aLeft.size() == aRight.size();
+
+    for (int i = 0; result && (i < aLeft.size()); ++i) {
+        const PPSDK::SBalance::SAmounts &left = aLeft[i];
+        const PPSDK::SBalance::SAmounts &right = aRight[i];
+
+        result = (left.type == right.type) && (left.amounts.size() == right.amounts.size());
+
+        for (int j = 0; result && (j < left.amounts.size()); ++j) {
+            result = (left.amounts[j].value.rawValue() == right.amounts[j].value.rawValue()) &&
+                     (left.amounts[j].count == right.amounts[j].count) &&
+                     (serials(left.amounts[j].serials) == serials(right.amounts[j].serials));
+        }
+    }
+
+    aDifference = result ? QString()
+                         : QString("counters [%1], notes [%2]")
+                               .arg(describe(aLeft))
+                               .arg(describe(aRight));
+
+    return result;
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,79 @@
+/* @file Счётчики купюр текущей инкассации. */
+
+#pragma once
+
+#include <QtCore/QList>
+#include <QtCore/QString>
+
+#include <SDK/PaymentProcessor/Core/Encashment.h>
+#include <SDK/PaymentProcessor/Payment/Amount.h>
+
+class IDatabaseProxy;
+class IDatabaseQuery;
+
+//---------------------------------------------------------------------------
+/// Хранит в таблице `balance_counter` количество и серийные номера купюр с начала инкассации
+/// в разрезе типа, номинала и валюты. Счётчики меняются в той же транзакции, что и купюры,
+/// поэтому баланс читается из нескольких строк, а не агрегацией всей истории купюр.
+class BalanceCounters {
+public:
+    /// Виды учитываемых купюр.
+    enum EKind {
+        Accepted = 0, /// Принятые (`payment_note`), кроме электронных денег.
+        Dispensed = 1 /// Выданные сдачей (`dispensed_note`).
+    };
+
+    explicit BalanceCounters(IDatabaseProxy &aDatabase);
+
+    /// Учитывает купюру. Вызывается в транзакции, добавившей купюру.
+    bool add(EKind aKind, const SDK::PaymentProcessor::SNote &aNote);
+
+    /// Обнуляет счётчики. Вызывается в транзакции инкассации.
+    bool reset(EKind aKind);
+
+    /// Разбивка по суммам из счётчиков. Испорченные счётчики предварительно пересобираются.
+    bool read(EKind aKind,
+              QList<SDK::PaymentProcessor::SBalance::SAmounts> &aSums,
+              double &aTotal);
+
+    /// Разбивка по суммам полной агрегацией купюр (эталон для самопроверки).
+    bool recompute(EKind aKind,
+                   QList<SDK::PaymentProcessor::SBalance::SAmounts> &aSums,
+                   double &aTotal);
+
+    /// Пересобирает счётчики по купюрам. Вызывается вне транзакции.
+    bool rebuild();
+
+    /// Помечает счётчики испорченными: следующее чтение их пересоберёт.
+    void invalidate();
+
+    /// Помечает счётчики испорченными и сохраняет отметку в БД. Вызывается в транзакции, где
+    /// не удалось обновить счётчики: отметка фиксируется вместе с купюрой.
+    bool markStale();
+
+    /// Пересобирает счётчики, если прежний запуск оставил отметку о порче. Вызывается при
+    /// запуске вне транзакции.
+    bool restore();
+
+    /// Сравнивает две разбивки. Порядок серийных номеров внутри номинала не учитывается.
+    static bool equal(const QList<SDK::PaymentProcessor::SBalance::SAmounts> &aLeft,
+                      const QList<SDK::PaymentProcessor::SBalance::SAmounts> &aRight,
+                      QString &aDifference);
+
+private:
+    /// Читает результат запроса вида (type, nominal, count, serials).
+    static void fill(IDatabaseQuery &aQuery,
+                     QList<SDK::PaymentProcessor::SBalance::SAmounts> &aSums,
+                     double &aTotal);
+
+    bool select(const QString &aQuery,
+                EKind aKind,
+                QList<SDK::PaymentProcessor::SBalance::SAmounts> &aSums,
+                double &aTotal);
+
+private:
+    IDatabaseProxy &m_Database;
+    bool m_Valid;
+};
+
+//---------------------------------------------------------------------------
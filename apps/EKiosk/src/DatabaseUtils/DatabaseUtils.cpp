@@ -5,7 +5,6 @@
 #include <QtCore/QFile>
 #include <QtCore/QMutexLocker>
 #include <QtCore/QRecursiveMutex>
-#include <QtCore/QRegularExpression>
 #include <QtCore/QScopedPointer>
 #include <QtCore/QStringList>
 
@@ -15,6 +14,7 @@
 #include <DatabaseProxy/IDatabaseQuery.h>
 #include <memory>
 
+#include "DatabaseUtils/SqlScript.h"
 #include "System/IApplication.h"
 
 namespace CDatabaseUtils {
@@ -35,7 +35,12 @@ const struct {
     int version;
     QString script;
 } Patches[] = {
-    // Миграции добавляются здесь по мере необходимости
+    // Индексируемое время создания платежа и индекс выданных купюр по инкассации.
+    {13, ":/scripts/db_patch_13.sql"},
+    // Счётчики купюр текущей инкассации для баланса.
+    {14, ":/scripts/db_patch_14.sql"},
+    // Аренда платежей параллельной оффлайн очередью.
+    {15, ":/scripts/db_patch_15.sql"},
 };
 
 } // namespace CDatabaseUtils
@@ -43,7 +48,8 @@ const struct {
 //---------------------------------------------------------------------------
 DatabaseUtils::DatabaseUtils(IDatabaseProxy &aProxy, IApplication *aApplication)
     : m_Database(aProxy), m_Application(aApplication), m_Log(aApplication->getLog()),
-      m_PaymentLog(ILog::getInstance("Payments")) {}
+      m_PaymentLog(ILog::getInstance("Payments")), m_ParameterWriter(aProxy),
+      m_BalanceCounters(aProxy), m_BalanceSelfCheck(false), m_PaymentQueue(aProxy) {}
 
 //---------------------------------------------------------------------------
 DatabaseUtils::~DatabaseUtils() = default;
@@ -87,9 +93,26 @@ bool DatabaseUtils::initialize() {
         return false;
     }
 
+    // Счётчики, испорченные в прошлом запуске, пересобираются до первого чтения баланса.
+    if (!m_BalanceCounters.restore()) {
+        LOG(m_Log, LogLevel::Error, "Failed to restore balance counters.");
+    }
+
     return true;
 }
 
+//---------------------------------------------------------------------------
+void DatabaseUtils::setBalanceSelfCheck(bool aEnabled) {
+    QMutexLocker lock(&m_AccessMutex);
+
+    m_BalanceSelfCheck = aEnabled;
+}
+
+//---------------------------------------------------------------------------
+QRecursiveMutex *DatabaseUtils::readMutex() const {
+    return m_Database.acquireReadConnection() ? nullptr : &m_AccessMutex;
+}
+
 //---------------------------------------------------------------------------
 bool DatabaseUtils::updateDatabase(const QString &aSqlScriptName) {
     QFile ftemp(aSqlScriptName);
@@ -97,16 +120,7 @@ bool DatabaseUtils::updateDatabase(const QString &aSqlScriptName) {
         throw std::runtime_error("Cannot open database script from resources.");
     }
 
-    QString resSQL = ftemp.readAll();
-
-    QRegularExpression rx(R"((\/\*.*\*\/|\-\-.*\n))");
-    resSQL.replace(rx, "");
-
-    // Удалим перевод строк с сохранением возможности писать ("CREATE\nTABLE")
-    resSQL.replace("\r", "");
-    resSQL.replace("\n", " ");
-
-    QStringList creatingSteps = resSQL.split(";");
+    QStringList creatingSteps = SqlScript::split(QString::fromUtf8(ftemp.readAll()));
 
     long rowsAffected(0);
 
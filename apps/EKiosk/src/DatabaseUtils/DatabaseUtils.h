@@ -6,9 +6,12 @@
 
 #include <Common/ILog.h>
 
+#include "DatabaseUtils/BalanceCounters.h"
 #include "DatabaseUtils/IDatabaseUtils.h"
 #include "DatabaseUtils/IHardwareDatabaseUtils.h"
 #include "DatabaseUtils/IPaymentDatabaseUtils.h"
+#include "DatabaseUtils/PaymentParameterWriter.h"
+#include "DatabaseUtils/PaymentQueue.h"
 
 //---------------------------------------------------------------------------
 class IDatabaseProxy;
@@ -25,6 +28,10 @@ public:
     /// Инициализация.
     virtual bool initialize();
 
+    /// Режим самопроверки: баланс дополнительно считается по всем купюрам и сверяется со
+    /// счётчиками, при расхождении счётчики пересобираются.
+    void setBalanceSelfCheck(bool aEnabled);
+
 #pragma region IDatabaseUtils interface
 
     /// Подготавливает к выполнению запрос.
@@ -117,8 +124,17 @@ public:
     /// Получить информацию по всем купюроприемникам в контексте платежа.
     virtual QList<SDK::PaymentProcessor::SNote> getPaymentNotes(qint64 aPayment);
 
-    /// Возвращает список платежей, ожидающих проведения.
-    virtual QList<qint64> getPaymentQueue();
+    /// Возвращает не более aLimit свободных платежей, ожидающих проведения, в порядке aOrder.
+    virtual QList<SQueuedPayment> getPaymentQueue(EPaymentQueueOrder::Enum aOrder, int aLimit);
+
+    /// Арендует платёж для обработчика aOwner на aSeconds секунд.
+    virtual bool claimPayment(qint64 aPayment, const QString &aOwner, int aSeconds);
+
+    /// Продлевает аренду платежа aOwner на aSeconds секунд.
+    virtual bool renewPayment(qint64 aPayment, const QString &aOwner, int aSeconds);
+
+    /// Снимает аренду платежа, взятую aOwner.
+    virtual bool releasePayment(qint64 aPayment, const QString &aOwner);
 
     /// Возвращает краткую информацию по платежам и купюрам с последней инкассации.
     virtual SDK::PaymentProcessor::SBalance getBalance();
@@ -151,12 +167,31 @@ private:
     IDatabaseProxy &m_Database;
     ILog *m_Log;
     ILog *m_PaymentLog;
-    QRecursiveMutex m_AccessMutex;
+    mutable QRecursiveMutex m_AccessMutex;
+
+    /// Запись изменившихся параметров платежей.
+    PaymentParameterWriter m_ParameterWriter;
+
+    /// Счётчики купюр текущей инкассации.
+    BalanceCounters m_BalanceCounters;
+    bool m_BalanceSelfCheck;
+
+    /// Очередь оффлайн платежей.
+    PaymentQueue m_PaymentQueue;
 
 private:
     /// Заполняет отчет инкассации о платежах
     void fillEncashmentReport(SDK::PaymentProcessor::SEncashment &aEncashment);
 
+    /// Разбивка купюр баланса из счётчиков (с самопроверкой, если она включена).
+    bool readBalanceSums(BalanceCounters::EKind aKind,
+                         QList<SDK::PaymentProcessor::SBalance::SAmounts> &aSums,
+                         double &aTotal);
+
+    /// Мьютекс для запросов отчётов. nullptr, если поток читает отдельным соединением
+    /// и не должен ждать запись платежей.
+    QRecursiveMutex *readMutex() const;
+
 private:
     /// Возвращает количество таблиц в базе
     int databaseTableCount() const;
@@ -7,6 +7,8 @@
 #include <SDK/PaymentProcessor/Payment/IPayment.h>
 #include <SDK/PaymentProcessor/Payment/Step.h>
 
+#include "DatabaseUtils/PaymentQueue.h"
+
 //---------------------------------------------------------------------------
 typedef QList<SDK::PaymentProcessor::IPayment::SParameter> TPaymentParameters;
 
@@ -47,8 +49,18 @@ public:
     /// Получить информацию по всем купюрам в контексте платежа.
     virtual QList<SDK::PaymentProcessor::SNote> getPaymentNotes(qint64 aPayment) = 0;
 
-    /// Возвращает список платежей, ожидающих проведения.
-    virtual QList<qint64> getPaymentQueue() = 0;
+    /// Возвращает не более aLimit свободных платежей, ожидающих проведения, в порядке aOrder.
+    virtual QList<SQueuedPayment> getPaymentQueue(EPaymentQueueOrder::Enum aOrder,
+                                                  int aLimit) = 0;
+
+    /// Арендует платёж для обработчика aOwner на aSeconds секунд. false - платёж уже арендован.
+    virtual bool claimPayment(qint64 aPayment, const QString &aOwner, int aSeconds) = 0;
+
+    /// Продлевает аренду платежа aOwner на aSeconds секунд. false - аренда уже потеряна.
+    virtual bool renewPayment(qint64 aPayment, const QString &aOwner, int aSeconds) = 0;
+
+    /// Снимает аренду платежа, взятую aOwner.
+    virtual bool releasePayment(qint64 aPayment, const QString &aOwner) = 0;
 
     /// Возвращает краткую информацию по платежам и купюрам с последней инкассации.
     virtual SDK::PaymentProcessor::SBalance getBalance() = 0;
@@ -18,6 +18,7 @@
 #include <numeric>
 
 #include "DatabaseUtils/DatabaseUtils.h"
+#include "DatabaseUtils/SqlScript.h"
 #include "Services/SettingsService.h"
 #include "System/IApplication.h"
 
@@ -91,7 +92,7 @@ QMap<qint64, TPaymentParameters> DatabaseUtils::getPaymentParameters(const QList
         ids << QString::number(id);
     }
 
-    QMutexLocker lock(&m_AccessMutex);
+    QMutexLocker lock(readMutex());
 
     QMap<qint64, TPaymentParameters> result;
 
@@ -102,7 +103,7 @@ QMap<qint64, TPaymentParameters> DatabaseUtils::getPaymentParameters(const QList
                                "`id` FROM `payment` WHERE `id` in (%1)")
                            .arg(ids.join(","));
 
-    QScopedPointer<IDatabaseQuery> query(m_Database.createQuery(strQuery));
+    QScopedPointer<IDatabaseQuery> query(m_Database.createReadQuery(strQuery));
     if (!query) {
         LOG(m_PaymentLog,
             LogLevel::Error,
@@ -151,7 +152,7 @@ QMap<qint64, TPaymentParameters> DatabaseUtils::getPaymentParameters(const QList
                        "`payment_param` WHERE "
                        "`fk_payment_id` in (%1)")
                    .arg(ids.join(","));
-    query.reset(m_Database.createQuery(strQuery));
+    query.reset(m_Database.createReadQuery(strQuery));
     if (!query) {
         LOG(m_PaymentLog,
             LogLevel::Error,
@@ -253,7 +254,8 @@ bool DatabaseUtils::savePayment(PPSDK::IPayment *aPayment, const QString &aSigna
             throw QString("failed to save main data");
         }
 
-        QStringList savedParameters;
+        // Эти параметры хранятся в основной записи платежа.
+        QSet<QString> savedParameters;
         savedParameters << PPSDK::CPayment::Parameters::ID
                         << PPSDK::CPayment::Parameters::CreationDate
                         << PPSDK::CPayment::Parameters::LastUpdateDate
@@ -270,39 +272,29 @@ bool DatabaseUtils::savePayment(PPSDK::IPayment *aPayment, const QString &aSigna
                         << PPSDK::CPayment::Parameters::Signature
                         << PPSDK::CPayment::Parameters::ReceiptPrinted;
 
-        strQuery = "INSERT OR REPLACE INTO `payment_param` (`name`, `value`, `type`, "
-                   "`fk_payment_id`, `external`) "
-                   "VALUES (:name, :value, :type, :id, :external)";
-
-        foreach (const PPSDK::IPayment::SParameter &parameter, aPayment->serialize()) {
-            if (!savedParameters.contains(parameter.name)) {
-                query->clear();
-
-                query.reset(m_Database.createQuery(strQuery));
-                if (!query) {
-                    throw QString("failed to save parameter %2, failed to create query")
-                        .arg(aPayment->getID())
-                        .arg(parameter.name);
-                }
+        query.reset();
 
-                query->bindValue(":name", parameter.name);
-                query->bindValue(":value", parameter.value);
-                query->bindValue(":type", parameter.crypted ? 1 : 0);
-                query->bindValue(":id", aPayment->getID());
-                query->bindValue(":external", parameter.external ? 1 : 0);
+        int written = 0;
 
-                if (!query->exec()) {
-                    throw QString("failed to save parameter %2")
-                        .arg(aPayment->getID())
-                        .arg(parameter.name);
-                }
-            }
+        if (!m_ParameterWriter.write(
+                aPayment->getID(), aPayment->serialize(), savedParameters, written)) {
+            throw QString("failed to save parameters");
         }
 
         if (!transaction.commit()) {
             throw QString("failed to commit transaction");
         }
+
+        m_ParameterWriter.commit();
+
+        LOG(m_PaymentLog,
+            LogLevel::Debug,
+            QString("Payment %1. Saved, %2 parameters changed.")
+                .arg(aPayment->getID())
+                .arg(written));
     } catch (QString &error) {
+        m_ParameterWriter.rollback();
+
         LOG(m_PaymentLog,
             LogLevel::Error,
             QString("Payment %1. Failed to save: %2.").arg(aPayment->getID()).arg(error));
@@ -364,6 +356,20 @@ bool DatabaseUtils::addPaymentNote(qint64 aPayment,
                     QString("Payment %1. Failed to add new amount: %2.")
                         .arg(aPayment)
                         .arg(note.nominal.toString()));
+            } else if (!m_BalanceCounters.add(BalanceCounters::Accepted, note)) {
+                // Купюра без учёта в счётчиках фиксируется только вместе с отметкой о их порче.
+                if (!m_BalanceCounters.markStale()) {
+                    LOG(m_PaymentLog,
+                        LogLevel::Error,
+                        QString("Payment %1. Failed to update balance counters.").arg(aPayment));
+                    transaction.rollback();
+                    break;
+                }
+
+                LOG(m_PaymentLog,
+                    LogLevel::Warning,
+                    QString("Payment %1. Failed to update balance counters, they will be rebuilt.")
+                        .arg(aPayment));
             }
         }
 
@@ -427,6 +433,21 @@ bool DatabaseUtils::addChangeNote(const QString &aSession,
                     QString("Change from %1. Failed to add dispensed note: %2.")
                         .arg(aSession)
                         .arg(note.nominal.toString()));
+            } else if (!m_BalanceCounters.add(BalanceCounters::Dispensed, note)) {
+                if (!m_BalanceCounters.markStale()) {
+                    LOG(m_PaymentLog,
+                        LogLevel::Error,
+                        QString("Change from %1. Failed to update balance counters.")
+                            .arg(aSession));
+                    transaction.rollback();
+                    break;
+                }
+
+                LOG(m_PaymentLog,
+                    LogLevel::Warning,
+                    QString("Change from %1. Failed to update balance counters, they will be "
+                            "rebuilt.")
+                        .arg(aSession));
             }
         }
 
@@ -447,38 +468,43 @@ bool DatabaseUtils::addChangeNote(const QString &aSession,
 }
 
 //---------------------------------------------------------------------------
-QList<qint64> DatabaseUtils::getPaymentQueue() {
+QList<SQueuedPayment> DatabaseUtils::getPaymentQueue(EPaymentQueueOrder::Enum aOrder,
+                                                    int aLimit) {
     QMutexLocker lock(&m_AccessMutex);
 
-    QList<qint64> result;
+    return m_PaymentQueue.select(aOrder, aLimit, PaymentQueue::now());
+}
 
-    QString strQuery = "SELECT `id` FROM `payment` WHERE (`status` IN (:status_init, "
-                       ":status_check, :status_error)) AND "
-                       "(`next_try_date` IS NULL OR strftime('%s%f', `next_try_date`) IS NULL OR "
-                       "strftime('%s%f', `next_try_date`) <= "
-                       "strftime('%s%f', :date)) "
-                       "ORDER BY `next_try_date`, `id` DESC";
+//---------------------------------------------------------------------------
+bool DatabaseUtils::claimPayment(qint64 aPayment, const QString &aOwner, int aSeconds) {
+    QMutexLocker lock(&m_AccessMutex);
 
-    QScopedPointer<IDatabaseQuery> query(m_Database.createQuery(strQuery));
+    qint64 now = PaymentQueue::now();
 
-    if (!query) {
-        return result;
-    }
+    return m_PaymentQueue.claim(aPayment, aOwner, now + qint64(aSeconds) * 1000, now);
+}
 
-    query->bindValue(":status_init", PPSDK::EPaymentStatus::Init);
-    query->bindValue(":status_check", PPSDK::EPaymentStatus::ReadyForCheck);
-    query->bindValue(":status_error", PPSDK::EPaymentStatus::ProcessError);
-    query->bindValue(":date", QDateTime::currentDateTime().toString(CIDatabaseProxy::DateFormat));
+//---------------------------------------------------------------------------
+bool DatabaseUtils::renewPayment(qint64 aPayment, const QString &aOwner, int aSeconds) {
+    QMutexLocker lock(&m_AccessMutex);
 
-    if (!query->exec() || !query->first()) {
-        return result;
-    }
+    qint64 now = PaymentQueue::now();
 
-    for (; query->isValid(); query->next()) {
-        result << query->value(0).toLongLong();
+    return m_PaymentQueue.renew(aPayment, aOwner, now + qint64(aSeconds) * 1000, now);
+}
+
+//---------------------------------------------------------------------------
+bool DatabaseUtils::releasePayment(qint64 aPayment, const QString &aOwner) {
+    QMutexLocker lock(&m_AccessMutex);
+
+    if (!m_PaymentQueue.release(aPayment, aOwner)) {
+        LOG(m_Log,
+            LogLevel::Error,
+            QString("Failed to release lease of payment %1.").arg(aPayment));
+        return false;
     }
 
-    return result;
+    return true;
 }
 
 //---------------------------------------------------------------------------
@@ -500,96 +526,31 @@ PPSDK::SBalance DatabaseUtils::getBalance() {
         result.lastEncashmentId = query->value(0).toInt();
         result.lastEncashmentDate = query->value(1).toDateTime();
 
-        // 1.5 Вытаскиваем все платежи, оплаченные электронными деньгами
-        queryStr =
-            QString("SELECT DISTINCT(payment.[id]) FROM payment, payment_note "
-                    "WHERE payment.id = payment_note.[fk_payment_id] AND payment_note.type = %1")
-                .arg(PPSDK::EAmountType::EMoney);
-
-        query.reset(m_Database.execQuery(queryStr));
-        if (!query) {
-            throw QString("failed to select eMoney payments");
-        }
-
-        QStringList eMoneyPayments;
-
-        for (query->first(); query->isValid(); query->next()) {
-            eMoneyPayments << query->value(0).toString();
-        }
-
-        // 2. Подсчитываем количество купюр и суммы определенных номиналов.
+        // 2. Количество купюр и суммы номиналов - из счётчиков текущей инкассации.
         {
-            queryStr = QString("SELECT `type`, `nominal`, COUNT(*), GROUP_CONCAT(`serial`, ',') "
-                               "FROM `payment_note` "
-                               "WHERE ((NOT `ejection`) OR (`ejection` IS NULL)) "
-                               "AND `type` <> %1 "
-                               "GROUP BY `type`, `nominal` ORDER BY `type` ASC, `nominal` DESC")
-                           .arg(PPSDK::EAmountType::EMoney);
-
-            query.reset(m_Database.execQuery(queryStr));
-            if (!query) {
-                throw QString("failed to calculate notes");
-            }
-
-            QMap<PPSDK::EAmountType::Enum, PPSDK::SBalance::SAmounts> amounts;
             double totalAmount = 0.0;
 
-            for (query->first(); query->isValid(); query->next()) {
-                PPSDK::EAmountType::Enum type =
-                    static_cast<PPSDK::EAmountType::Enum>(query->value(0).toInt());
-
-                if (!amounts.contains(type)) {
-                    amounts[type].type = type;
-                }
-
-                amounts[type].amounts
-                    << PPSDK::SBalance::SAmounts::SAmount(query->value(1).toDouble(),
-                                                          query->value(2).toInt(),
-                                                          query->value(3).toString());
-                totalAmount += query->value(1).toDouble() * query->value(2).toInt();
+            if (!readBalanceSums(BalanceCounters::Accepted, result.detailedSums, totalAmount)) {
+                throw QString("failed to calculate notes");
             }
 
             result.amount = QString::number(totalAmount, 'f', 2);
-            result.detailedSums = amounts.values();
         }
 
         // 2.5 Подсчитываем кол-во купюр выданных в качестве сдачи
         {
-            queryStr = QString("SELECT `type`, `nominal`, COUNT(*), GROUP_CONCAT(`serial`, ',') "
-                               "FROM `dispensed_note` "
-                               "WHERE ((NOT `reported`) OR (`reported` IS NULL)) "
-                               "GROUP BY `type`, `nominal` ORDER BY `type` ASC, `nominal` DESC");
-
-            query.reset(m_Database.execQuery(queryStr));
-            if (!query) {
-                throw QString("failed to calculate dispensed notes");
-            }
-
-            QMap<PPSDK::EAmountType::Enum, PPSDK::SBalance::SAmounts> amounts;
             double totalAmount = 0.0;
 
-            for (query->first(); query->isValid(); query->next()) {
-                PPSDK::EAmountType::Enum type =
-                    static_cast<PPSDK::EAmountType::Enum>(query->value(0).toInt());
-
-                if (!amounts.contains(type)) {
-                    amounts[type].type = type;
-                }
-
-                amounts[type].amounts
-                    << PPSDK::SBalance::SAmounts::SAmount(query->value(1).toDouble(),
-                                                          query->value(2).toInt(),
-                                                          query->value(3).toString());
-                totalAmount += query->value(1).toDouble() * query->value(2).toInt();
+            if (!readBalanceSums(BalanceCounters::Dispensed, result.dispensedSums, totalAmount)) {
+                throw QString("failed to calculate dispensed notes");
             }
 
             result.dispensedAmount = QString::number(totalAmount, 'f', 2);
-            result.dispensedSums = amounts.values();
 
-            // Создание списка выданных купюр
-            queryStr = QString("SELECT `date`, `type`, `nominal`, `currency`, `session_id` FROM "
-                               "`dispensed_note` WHERE "
-                               "((NOT `reported`) OR (`reported` IS NULL))");
+            // Создание списка выданных купюр. Отметку пишет только инкассация, поэтому
+            // неотмеченные купюры ищутся по индексу, а не просмотром всей истории.
+            queryStr = "SELECT `date`, `type`, `nominal`, `currency`, `session_id` FROM "
+                       "`dispensed_note` WHERE `reported` IS NULL OR `reported` IN (0, '')";
             query.reset(m_Database.execQuery(queryStr));
             if (!query) {
                 throw QString("failed to select dispensed notes");
@@ -612,8 +573,8 @@ PPSDK::SBalance DatabaseUtils::getBalance() {
         queryStr = "SELECT `id`, `receipt_printed`, `status` FROM `payment` WHERE `id` >= (SELECT "
                    "P.`id` FROM "
                    "`payment` AS P, `payment_note` "
-                   "AS PN WHERE PN.`fk_payment_id` = P.`id` AND ((NOT PN.`ejection`) OR "
-                   "(PN.`ejection` IS NULL)) ORDER "
+                   "AS PN WHERE PN.`fk_payment_id` = P.`id` AND (PN.`ejection` IS NULL OR "
+                   "PN.`ejection` IN (0, '')) ORDER "
                    "BY P.`id` ASC LIMIT 1)";
 
         query.reset(m_Database.execQuery(queryStr));
@@ -640,11 +601,11 @@ PPSDK::SBalance DatabaseUtils::getBalance() {
             // учитывать платежи, оплаченные сдачей.
             query->clear();
 
-            queryStr = QString("SELECT SUM(`value`) FROM `payment_param` WHERE `name` = :name AND "
-                               "`fk_payment_id` >= "
-                               ":first_payment "
-                               "AND `fk_payment_id` NOT IN (%1)")
-                           .arg(eMoneyPayments.join(","));
+            // Платежи, оплаченные электронными деньгами, ищем только среди платежей инкассации.
+            queryStr = "SELECT SUM(`value`) FROM `payment_param` WHERE `name` = :name AND "
+                       "`fk_payment_id` >= :first_payment AND `fk_payment_id` NOT IN "
+                       "(SELECT `fk_payment_id` FROM `payment_note` WHERE `type` = :emoney AND "
+                       "`fk_payment_id` >= :first_note)";
             query.reset(m_Database.createQuery(queryStr));
             if (!query) {
                 throw QString("failed to calculate fee amount (prepare query error).");
@@ -652,6 +613,8 @@ PPSDK::SBalance DatabaseUtils::getBalance() {
 
             query->bindValue(":name", PPSDK::CPayment::Parameters::Fee);
             query->bindValue(":first_payment", result.payments.first());
+            query->bindValue(":emoney", PPSDK::EAmountType::EMoney);
+            query->bindValue(":first_note", result.payments.first());
 
             if (!query->exec() || !query->first()) {
                 throw QString("failed to calculate encashment fee amount.");
@@ -693,11 +656,49 @@ PPSDK::SBalance DatabaseUtils::getBalance() {
     return result;
 }
 
+//---------------------------------------------------------------------------
+bool DatabaseUtils::readBalanceSums(BalanceCounters::EKind aKind,
+                                    QList<PPSDK::SBalance::SAmounts> &aSums,
+                                    double &aTotal) {
+    if (!m_BalanceCounters.read(aKind, aSums, aTotal)) {
+        LOG(m_Log, LogLevel::Warning, "Failed to read balance counters, counting all notes.");
+
+        m_BalanceCounters.invalidate();
+
+        return m_BalanceCounters.recompute(aKind, aSums, aTotal);
+    }
+
+    if (m_BalanceSelfCheck) {
+        QList<PPSDK::SBalance::SAmounts> sums;
+        double total = 0.0;
+        QString difference;
+
+        if (!m_BalanceCounters.recompute(aKind, sums, total)) {
+            LOG(m_Log, LogLevel::Warning, "Balance self-check failed to count notes.");
+        } else if (!BalanceCounters::equal(aSums, sums, difference)) {
+            LOG(m_Log,
+                LogLevel::Error,
+                QString("Balance counters (kind %1) differ from notes: %2. Rebuilding.")
+                    .arg(aKind)
+                    .arg(difference));
+
+            m_BalanceCounters.invalidate();
+
+            aSums = sums;
+            aTotal = total;
+        }
+    }
+
+    return true;
+}
+
 //---------------------------------------------------------------------------
 QList<qint64>
 DatabaseUtils::getPayments(const QSet<SDK::PaymentProcessor::EPaymentStatus::Enum> &aStates) {
     QList<qint64> result;
 
+    QMutexLocker lock(readMutex());
+
     try {
         QString queryStr;
 
@@ -712,8 +713,8 @@ DatabaseUtils::getPayments(const QSet<SDK::PaymentProcessor::EPaymentStatus::Enu
             queryStr = "SELECT `id` FROM `payment` WHERE `status` IN (" + statuses.join(",") + ")";
         }
 
-        QScopedPointer<IDatabaseQuery> query(m_Database.execQuery(queryStr));
-        if (!query) {
+        QScopedPointer<IDatabaseQuery> query(m_Database.createReadQuery(queryStr));
+        if (!query || !query->exec()) {
             throw QString("failed to get payment list");
         }
 
@@ -731,17 +732,29 @@ DatabaseUtils::getPayments(const QSet<SDK::PaymentProcessor::EPaymentStatus::Enu
 QList<qint64> DatabaseUtils::findPayments(const QDate &aDate, const QString &aPhoneNumber) {
     QList<qint64> result;
 
-    QString queryStr = QString("select distinct(p.[id]) from payment p, payment_param pp "
-                               "where p.[id] = pp.[fk_payment_id] and pp.[value] = '%1'")
-                           .arg(aPhoneNumber);
+    QString queryStr = "select distinct(p.[id]) from payment p, payment_param pp "
+                       "where p.[id] = pp.[fk_payment_id] and pp.[value] = :value";
 
-    if (aDate.isValid() && !aDate.isNull()) {
-        queryStr += QString(" AND p.create_date between '%1 00:00:00' AND '%1 59:59:59'")
-                        .arg(aDate.toString("yyyy-MM-dd"));
+    bool byDate = aDate.isValid() && !aDate.isNull();
+
+    // Сутки берутся полуинтервалом по индексу i__payment__create_epoch.
+    if (byDate) {
+        queryStr += " AND p.[create_epoch] >= :from AND p.[create_epoch] < :to";
     }
 
-    QScopedPointer<IDatabaseQuery> query(m_Database.execQuery(queryStr));
+    QMutexLocker lock(readMutex());
+
+    QScopedPointer<IDatabaseQuery> query(m_Database.createReadQuery(queryStr));
     if (query) {
+        query->bindValue(":value", aPhoneNumber);
+
+        if (byDate) {
+            query->bindValue(":from", SqlScript::toEpoch(QDateTime(aDate, QTime(0, 0))));
+            query->bindValue(":to", SqlScript::toEpoch(QDateTime(aDate.addDays(1), QTime(0, 0))));
+        }
+    }
+
+    if (query && query->exec()) {
         for (query->first(); query->isValid(); query->next()) {
             result << query->value(0).toLongLong();
         }
@@ -930,7 +943,7 @@ PPSDK::SEncashment DatabaseUtils::perform_Encashment(const QVariantMap &aParamet
             throw QString("failed to add encashment record.");
         }
 
-        // 3. Теперь обновляем данные по купюрам.
+        // 3. Теперь обновляем данные по купюрам и обнуляем их счётчики.
         LOG(m_Log, LogLevel::Normal, " - updating payment notes;");
 
         strQuery =
@@ -943,6 +956,10 @@ PPSDK::SEncashment DatabaseUtils::perform_Encashment(const QVariantMap &aParamet
             throw QString("failed to update notes ejection date.");
         }
 
+        if (!m_BalanceCounters.reset(BalanceCounters::Accepted)) {
+            throw QString("failed to reset notes counters.");
+        }
+
         // 3.5 Теперь обновляем данные по купюрам.
         LOG(m_Log, LogLevel::Normal, " - updating dispensed notes;");
 
@@ -954,6 +971,10 @@ PPSDK::SEncashment DatabaseUtils::perform_Encashment(const QVariantMap &aParamet
             throw QString("failed to update dispensed notes reported date.");
         }
 
+        if (!m_BalanceCounters.reset(BalanceCounters::Dispensed)) {
+            throw QString("failed to reset dispensed notes counters.");
+        }
+
         // 4. Получаем номер инкассации.
         query.reset(m_Database.execQuery("SELECT MAX(`id`) FROM `encashment`"));
         if (!query || !query->first()) {
@@ -996,7 +1017,7 @@ PPSDK::SEncashment DatabaseUtils::perform_Encashment(const QVariantMap &aParamet
 
 //---------------------------------------------------------------------------
 QList<SDK::PaymentProcessor::SEncashment> DatabaseUtils::getLastEncashments(int aCount) {
-    QMutexLocker lock(&m_AccessMutex);
+    QMutexLocker lock(readMutex());
 
     QMap<int, PPSDK::SEncashment> result;
 
@@ -1008,9 +1029,9 @@ QList<SDK::PaymentProcessor::SEncashment> DatabaseUtils::getLastEncashments(int
                 "`dispenser_report` FROM `encashment` ORDER BY `id` DESC LIMIT %1")
             .arg(aCount < 1 ? 1 : aCount);
 
-    QScopedPointer<IDatabaseQuery> query(m_Database.execQuery(queryStr));
+    QScopedPointer<IDatabaseQuery> query(m_Database.createReadQuery(queryStr));
 
-    if (!query || !query->first()) {
+    if (!query || !query->exec() || !query->first()) {
         LOG(m_Log, LogLevel::Error, QString("no first encashment record, database is damaged"));
 
         return result.values();
@@ -1034,7 +1055,7 @@ QList<SDK::PaymentProcessor::SEncashment> DatabaseUtils::getLastEncashments(int
         // 2. Получаем дату предыдущей инкассации
         {
             queryStr = "SELECT `date` FROM `encashment` WHERE `id` = :id";
-            QScopedPointer<IDatabaseQuery> q(m_Database.createQuery(queryStr));
+            QScopedPointer<IDatabaseQuery> q(m_Database.createReadQuery(queryStr));
 
             if (!q) {
                 LOG(m_Log, LogLevel::Error, QString("failed to get previous encashment date"));
@@ -1058,7 +1079,7 @@ QList<SDK::PaymentProcessor::SEncashment> DatabaseUtils::getLastEncashments(int
                        "`payment_note` WHERE "
                        "`ejection` = :ejection "
                        "GROUP BY `type`, `nominal` ORDER BY `type` ASC, `nominal` DESC";
-            QScopedPointer<IDatabaseQuery> q(m_Database.createQuery(queryStr));
+            QScopedPointer<IDatabaseQuery> q(m_Database.createReadQuery(queryStr));
 
             if (!q) {
                 LOG(m_Log, LogLevel::Error, QString("failed to calculate notes"));
@@ -1114,7 +1135,7 @@ QList<SDK::PaymentProcessor::SEncashment> DatabaseUtils::getLastEncashments(int
                        "`dispensed_note` WHERE "
                        "`reported` = :reported "
                        "GROUP BY `type`, `nominal` ORDER BY `type` ASC, `nominal` DESC";
-            QScopedPointer<IDatabaseQuery> q(m_Database.createQuery(queryStr));
+            QScopedPointer<IDatabaseQuery> q(m_Database.createReadQuery(queryStr));
 
             if (!q) {
                 LOG(m_Log, LogLevel::Error, QString("failed to calculate notes"));
@@ -1150,7 +1171,7 @@ QList<SDK::PaymentProcessor::SEncashment> DatabaseUtils::getLastEncashments(int
             queryStr = "SELECT P.`id` FROM `payment` AS P, `payment_note` AS PN WHERE "
                        "PN.`fk_payment_id` = P.`id` "
                        "AND PN.`ejection` = :ejection ORDER BY P.`id`";
-            QScopedPointer<IDatabaseQuery> q(m_Database.createQuery(queryStr));
+            QScopedPointer<IDatabaseQuery> q(m_Database.createReadQuery(queryStr));
 
             if (!q) {
                 LOG(m_Log,
@@ -1173,7 +1194,7 @@ QList<SDK::PaymentProcessor::SEncashment> DatabaseUtils::getLastEncashments(int
         {
             queryStr =
                 "SELECT `name`, `value` FROM `encashment_param` WHERE `fk_encashment_id` = :id";
-            QScopedPointer<IDatabaseQuery> q(m_Database.createQuery(queryStr));
+            QScopedPointer<IDatabaseQuery> q(m_Database.createReadQuery(queryStr));
 
             if (!q) {
                 LOG(m_Log,
@@ -1215,8 +1236,10 @@ bool DatabaseUtils::backupOldPayments() {
         date = balance.lastEncashmentDate;
     }
 
-    QString strQuery = "SELECT COUNT(*) FROM `payment` WHERE strftime('%s%f', `create_date`) <= "
-                       "strftime('%s%f', :date)";
+    // Старые платежи выбираются диапазоном по индексу i__payment__create_epoch.
+    qint64 epoch = SqlScript::toEpoch(date);
+
+    QString strQuery = "SELECT COUNT(*), MAX(`id`) FROM `payment` WHERE `create_epoch` <= :epoch";
 
     QScopedPointer<IDatabaseQuery> query(m_Database.createQuery(strQuery));
     if (!query) {
@@ -1225,7 +1248,7 @@ bool DatabaseUtils::backupOldPayments() {
         return false;
     }
 
-    query->bindValue(":date", date.toString(CIDatabaseProxy::DateFormat));
+    query->bindValue(":epoch", epoch);
 
     if (!query->exec() || !query->first()) {
         LOG(m_Log, LogLevel::Error, "Failed to read old payment count.");
@@ -1242,14 +1265,15 @@ bool DatabaseUtils::backupOldPayments() {
         return true;
     }
 
+    qint64 lastOldPayment = query->value(1).toLongLong();
+
     query->clear();
 
     strQuery = "SELECT `id`, `create_date`, `last_update`, `type`,	`initial_session`, `session`, "
                "`server_status`, `server_error`, `number_of_tries`, `next_try_date`, `operator`, "
                "`status`, `on_monitoring`, "
                "`priority`, `step`, `currency`, `signature`, `receipt_printed` FROM `payment` "
-               "WHERE strftime('%s%f', "
-               "`create_date`) <= strftime('%s%f', :date)";
+               "WHERE `create_epoch` <= :epoch";
 
     if (!query->prepare(strQuery)) {
         LOG(m_Log, LogLevel::Error, "Failed to read old payments (query prepare error).");
@@ -1257,7 +1281,7 @@ bool DatabaseUtils::backupOldPayments() {
         return false;
     }
 
-    query->bindValue(":date", date.toString(CIDatabaseProxy::DateFormat));
+    query->bindValue(":epoch", epoch);
 
     if (!query->exec()) {
         LOG(m_Log, LogLevel::Error, "Failed to read old payments.");
@@ -1274,6 +1298,9 @@ bool DatabaseUtils::backupOldPayments() {
     QDomDocument xml;
     xml.appendChild(xml.createElement("payments"));
 
+    QScopedPointer<IDatabaseQuery> paramsQuery(m_Database.createQuery(
+        "SELECT `name`, `value` FROM `payment_param` WHERE `fk_payment_id` = :id"));
+
     for (query->first(); query->isValid(); query->next()) {
         QDomElement element = xml.createElement("payment");
 
@@ -1298,9 +1325,6 @@ bool DatabaseUtils::backupOldPayments() {
 
         xml.documentElement().appendChild(element);
 
-        strQuery = "SELECT `name`, `value` FROM `payment_param` WHERE `fk_payment_id` = :id";
-
-        QScopedPointer<IDatabaseQuery> paramsQuery(m_Database.createQuery(strQuery));
         if (!paramsQuery) {
             LOG(m_Log, LogLevel::Error, "Failed to load params while backuping payment.");
 
@@ -1321,6 +1345,8 @@ bool DatabaseUtils::backupOldPayments() {
         }
     }
 
+    paramsQuery.reset();
+
     QString filePath = IApplication::getWorkingDirectory() + "/backup";
 
     QDir dir(filePath);
@@ -1342,32 +1368,40 @@ bool DatabaseUtils::backupOldPayments() {
 
     DatabaseTransaction transaction(&m_Database);
 
-    // Удаляем платежи
-    strQuery =
-        QString(
-            "DELETE FROM `payment` WHERE strftime('%s%f', `create_date`) <= strftime('%s%f', '%1')")
-            .arg(date.toString(CIDatabaseProxy::DateFormat));
+    auto execDelete = [&](const QString &aQuery, const QString &aName, qint64 aValue) -> bool {
+        query.reset(m_Database.createQuery(aQuery));
+        if (!query) {
+            return false;
+        }
 
-    query.reset(m_Database.execQuery(strQuery));
-    if (!query) {
+        query->bindValue(aName, aValue);
+
+        return query->exec();
+    };
+
+    // Удаляем платежи
+    if (!execDelete("DELETE FROM `payment` WHERE `create_epoch` <= :epoch", ":epoch", epoch)) {
         LOG(m_Log, LogLevel::Error, "Failed to delete payment records.");
 
         return false;
     }
 
-    // Удаляем параметры платежей
-    query.reset(m_Database.execQuery(
-        "DELETE FROM `payment_param` WHERE `fk_payment_id` NOT IN(SELECT `id` FROM `payment`)"));
-    if (!query) {
+    // Удаляем параметры платежей. Старые платежи лежат в начале таблицы, поэтому осиротевшие
+    // строки ищутся диапазоном по индексу внешнего ключа, а не полным просмотром.
+    if (!execDelete("DELETE FROM `payment_param` WHERE `fk_payment_id` <= :last_id AND "
+                    "`fk_payment_id` NOT IN(SELECT `id` FROM `payment`)",
+                    ":last_id",
+                    lastOldPayment)) {
         LOG(m_Log, LogLevel::Error, "Failed to delete payment params records.");
 
         return false;
     }
 
     // Удаляем купюры
-    query.reset(m_Database.execQuery("DELETE FROM `payment_note` WHERE `fk_payment_id` NOT "
-                                     "IN(SELECT `id` FROM `payment`) AND `ejection` NOT NULL"));
-    if (!query) {
+    if (!execDelete("DELETE FROM `payment_note` WHERE `fk_payment_id` <= :last_id AND "
+                    "`fk_payment_id` NOT IN(SELECT `id` FROM `payment`) AND `ejection` NOT NULL",
+                    ":last_id",
+                    lastOldPayment)) {
         LOG(m_Log, LogLevel::Error, "Failed to delete payment params records.");
 
         return false;
@@ -1375,6 +1409,8 @@ bool DatabaseUtils::backupOldPayments() {
 
     transaction.commit();
 
+    m_ParameterWriter.clear();
+
     query.reset(m_Database.execQuery("VACUUM"));
 
     LOG(m_Log, LogLevel::Normal, "Old payments deleted.");
@@ -1399,6 +1435,8 @@ void DatabaseUtils::removePayment(qint64 aPayment) {
         return true;
     };
 
+    m_ParameterWriter.forget(aPayment);
+
     if (execSql("DELETE FROM `payment_param` WHERE `fk_payment_id` = :id") &&
         execSql("DELETE FROM `payment` WHERE `id` = :id")) {
         return;
@@ -1469,8 +1507,10 @@ bool DatabaseUtils::suspendPayment(qint64 aPayment, int aMinutes) {
 QMap<qint64, quint32> DatabaseUtils::getStatistic() const {
     QMap<qint64, quint32> result;
 
-    QScopedPointer<IDatabaseQuery> query(
-        m_Database.createQuery("SELECT `operator`, count(*) FROM `payment` GROUP BY `operator`;"));
+    QMutexLocker lock(readMutex());
+
+    QScopedPointer<IDatabaseQuery> query(m_Database.createReadQuery(
+        "SELECT `operator`, count(*) FROM `payment` GROUP BY `operator`;"));
     if (query) {
         if (query->exec()) {
             for (query->first(); query->isValid(); query->next()) {
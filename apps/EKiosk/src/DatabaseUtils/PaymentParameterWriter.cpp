@@ -0,0 +1,163 @@
+/* @file Пакетная запись параметров платежа в БД. */
+
+#include "DatabaseUtils/PaymentParameterWriter.h"
+
+#include <QtCore/QScopedPointer>
+
+#include <DatabaseProxy/IDatabaseProxy.h>
+#include <DatabaseProxy/IDatabaseQuery.h>
+
+namespace PPSDK = SDK::PaymentProcessor;
+
+namespace CPaymentParameterWriter {
+const char InsertQuery[] = "INSERT OR REPLACE INTO `payment_param` (`name`, `value`, `type`, "
+                           "`fk_payment_id`, `external`) "
+                           "VALUES (:name, :value, :type, :id, :external)";
+
+const char SelectQuery[] = "SELECT `name`, `value`, `type`, `external` FROM `payment_param` "
+                           "WHERE `fk_payment_id` = :id";
+
+/// Идентификатор платежа, для которого нет незафиксированных изменений.
+const qint64 NoPayment = -1;
+} // namespace CPaymentParameterWriter
+
+//---------------------------------------------------------------------------
+PaymentParameterWriter::PaymentParameterWriter(IDatabaseProxy &aDatabase, int aCacheSize)
+    : m_Database(aDatabase), m_Stored(aCacheSize),
+      m_PendingPayment(CPaymentParameterWriter::NoPayment) {}
+
+//---------------------------------------------------------------------------
+PaymentParameterWriter::SStoredValue
+PaymentParameterWriter::toStored(const PPSDK::IPayment::SParameter &aParameter) {
+    SStoredValue result;
+
+    // Так значение окажется в текстовой колонке: null пишется пустой строкой, bool - числом.
+    if (aParameter.value.isNull()) {
+        result.value = "";
+    } else if (aParameter.value.userType() == QMetaType::Bool) {
+        result.value = aParameter.value.toBool() ? "1" : "0";
+    } else {
+        result.value = aParameter.value.toString();
+    }
+
+    result.crypted = aParameter.crypted;
+    result.external = aParameter.external;
+
+    return result;
+}
+
+//---------------------------------------------------------------------------
+bool PaymentParameterWriter::load(qint64 aPayment, TStoredValues &aValues) {
+    QScopedPointer<IDatabaseQuery> query(
+        m_Database.createQuery(CPaymentParameterWriter::SelectQuery));
+
+    if (!query) {
+        return false;
+    }
+
+    query->bindValue(":id", aPayment);
+
+    if (!query->exec()) {
+        return false;
+    }
+
+    for (query->first(); query->isValid(); query->next()) {
+        SStoredValue value;
+        value.value = query->value(1).toString();
+        value.crypted = query->value(2).toInt() != 0;
+        value.external = query->value(3).toInt() != 0;
+
+        aValues.insert(query->value(0).toString(), value);
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool PaymentParameterWriter::write(qint64 aPayment,
+                                   const TPaymentParameters &aParameters,
+                                   const QSet<QString> &aSkip,
+                                   int &aWritten) {
+    aWritten = 0;
+    m_PendingPayment = aPayment;
+    m_Pending.clear();
+
+    TStoredValues *stored = m_Stored.object(aPayment);
+
+    if (stored) {
+        m_Pending = *stored;
+    } else if (!load(aPayment, m_Pending)) {
+        return false;
+    }
+
+    QScopedPointer<IDatabaseQuery> query;
+
+    foreach (const PPSDK::IPayment::SParameter &parameter, aParameters) {
+        if (aSkip.contains(parameter.name)) {
+            continue;
+        }
+
+        SStoredValue value = toStored(parameter);
+        auto it = m_Pending.constFind(parameter.name);
+
+        if ((it != m_Pending.constEnd()) && (*it == value)) {
+            continue;
+        }
+
+        // Один подготовленный запрос на все строки, только если есть что писать.
+        if (!query) {
+            query.reset(m_Database.createQuery(CPaymentParameterWriter::InsertQuery));
+
+            if (!query) {
+                return false;
+            }
+        }
+
+        query->bindValue(":name", parameter.name);
+        query->bindValue(":value", parameter.value);
+        query->bindValue(":type", parameter.crypted ? 1 : 0);
+        query->bindValue(":id", aPayment);
+        query->bindValue(":external", parameter.external ? 1 : 0);
+
+        if (!query->exec()) {
+            return false;
+        }
+
+        m_Pending.insert(parameter.name, value);
+        ++aWritten;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void PaymentParameterWriter::commit() {
+    if (m_PendingPayment != CPaymentParameterWriter::NoPayment) {
+        m_Stored.insert(m_PendingPayment, new TStoredValues(m_Pending));
+    }
+
+    m_PendingPayment = CPaymentParameterWriter::NoPayment;
+    m_Pending.clear();
+}
+
+//---------------------------------------------------------------------------
+void PaymentParameterWriter::rollback() {
+    if (m_PendingPayment != CPaymentParameterWriter::NoPayment) {
+        m_Stored.remove(m_PendingPayment);
+    }
+
+    m_PendingPayment = CPaymentParameterWriter::NoPayment;
+    m_Pending.clear();
+}
+
+//---------------------------------------------------------------------------
+void PaymentParameterWriter::forget(qint64 aPayment) {
+    m_Stored.remove(aPayment);
+}
+
+//---------------------------------------------------------------------------
+void PaymentParameterWriter::clear() {
+    m_Stored.clear();
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,79 @@
+/* @file Пакетная запись параметров платежа в БД. */
+
+#pragma once
+
+#include <QtCore/QCache>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+
+#include "DatabaseUtils/IPaymentDatabaseUtils.h"
+
+class IDatabaseProxy;
+
+//---------------------------------------------------------------------------
+namespace CPaymentParameterWriter {
+/// Число платежей, для которых запоминаются сохранённые параметры.
+const int CacheSize = 256;
+} // namespace CPaymentParameterWriter
+
+//---------------------------------------------------------------------------
+/// Записывает в `payment_param` только те параметры платежа, которые отличаются от уже сохранённых.
+/// Все строки пишутся одним подготовленным запросом в транзакции вызывающего.
+/// Сохранённые значения последних платежей хранятся в памяти, для остальных читаются из БД одним
+/// запросом. Кэш меняется только после commit(), rollback() забывает платёж.
+class PaymentParameterWriter {
+public:
+    explicit PaymentParameterWriter(IDatabaseProxy &aDatabase,
+                                    int aCacheSize = CPaymentParameterWriter::CacheSize);
+
+    /// Записывает изменившиеся параметры aParameters, кроме перечисленных в aSkip.
+    /// Вызывается внутри открытой транзакции. В aWritten - число записанных строк.
+    bool write(qint64 aPayment,
+               const TPaymentParameters &aParameters,
+               const QSet<QString> &aSkip,
+               int &aWritten);
+
+    /// Транзакция зафиксирована: записанные значения становятся сохранёнными.
+    void commit();
+
+    /// Транзакция откатана: сохранённые значения платежа перечитываются при следующей записи.
+    void rollback();
+
+    /// Забывает сохранённые значения платежа (например, после его удаления).
+    void forget(qint64 aPayment);
+
+    /// Забывает сохранённые значения всех платежей.
+    void clear();
+
+private:
+    struct SStoredValue {
+        QString value;
+        bool crypted;
+        bool external;
+
+        bool operator==(const SStoredValue &aOther) const {
+            return (value == aOther.value) && (crypted == aOther.crypted) &&
+                   (external == aOther.external);
+        }
+    };
+
+    typedef QHash<QString, SStoredValue> TStoredValues;
+
+    /// Приводит значение к виду, в котором оно сравнивается с сохранённым.
+    static SStoredValue toStored(const SDK::PaymentProcessor::IPayment::SParameter &aParameter);
+
+    /// Читает сохранённые параметры платежа из БД.
+    bool load(qint64 aPayment, TStoredValues &aValues);
+
+private:
+    IDatabaseProxy &m_Database;
+
+    QCache<qint64, TStoredValues> m_Stored;
+
+    /// Платёж и его значения, записанные в текущей транзакции.
+    qint64 m_PendingPayment;
+    TStoredValues m_Pending;
+};
+
+//---------------------------------------------------------------------------
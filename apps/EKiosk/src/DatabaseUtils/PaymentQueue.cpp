@@ -0,0 +1,135 @@
+/* @file Очередь оффлайн платежей с арендой записей. */
+
+#include "DatabaseUtils/PaymentQueue.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QScopedPointer>
+
+#include <SDK/PaymentProcessor/Payment/Parameters.h>
+#include <SDK/PaymentProcessor/Payment/Step.h>
+
+#include <DatabaseProxy/IDatabaseProxy.h>
+#include <DatabaseProxy/IDatabaseQuery.h>
+
+namespace PPSDK = SDK::PaymentProcessor;
+
+namespace CPaymentQueue {
+/// Условие готовности совпадает с прежней выборкой очереди, статус берётся по индексу.
+const char SelectQuery[] =
+    "SELECT p.`id`, p.`operator`, p.`create_epoch`, CAST(pp.`value` AS REAL) AS `amount` "
+    "FROM `payment` p LEFT JOIN `payment_param` pp ON pp.`fk_payment_id` = p.`id` AND "
+    "pp.`name` = :amount_name "
+    "WHERE (p.`status` IN (:status_init, :status_check, :status_error)) AND "
+    "(p.`next_try_date` IS NULL OR strftime('%s%f', p.`next_try_date`) IS NULL OR "
+    "strftime('%s%f', p.`next_try_date`) <= strftime('%s%f', :date)) AND "
+    "(p.`lease_until` IS NULL OR p.`lease_until` <= :now) ";
+
+const char OldestOrder[] = "ORDER BY p.`create_epoch`, p.`id` LIMIT :limit";
+const char AmountOrder[] = "ORDER BY `amount` DESC, p.`id` LIMIT :limit";
+
+const char ClaimQuery[] = "UPDATE `payment` SET `lease_owner` = :owner, `lease_until` = :until "
+                          "WHERE `id` = :id AND (`lease_until` IS NULL OR `lease_until` <= :now)";
+
+const char RenewQuery[] = "UPDATE `payment` SET `lease_until` = :until "
+                          "WHERE `id` = :id AND `lease_owner` = :owner AND `lease_until` > :now";
+
+const char ReleaseQuery[] = "UPDATE `payment` SET `lease_owner` = NULL, `lease_until` = NULL "
+                            "WHERE `id` = :id AND `lease_owner` = :owner";
+} // namespace CPaymentQueue
+
+//---------------------------------------------------------------------------
+PaymentQueue::PaymentQueue(IDatabaseProxy &aDatabase) : m_Database(aDatabase) {}
+
+//---------------------------------------------------------------------------
+QList<SQueuedPayment>
+PaymentQueue::select(EPaymentQueueOrder::Enum aOrder, int aLimit, qint64 aNow) {
+    QList<SQueuedPayment> result;
+
+    QString queryStr = QString(CPaymentQueue::SelectQuery) +
+                       (aOrder == EPaymentQueueOrder::Amount ? CPaymentQueue::AmountOrder
+                                                             : CPaymentQueue::OldestOrder);
+
+    QScopedPointer<IDatabaseQuery> query(m_Database.createQuery(queryStr));
+    if (!query) {
+        return result;
+    }
+
+    query->bindValue(":amount_name", PPSDK::CPayment::Parameters::Amount);
+    query->bindValue(":status_init", PPSDK::EPaymentStatus::Init);
+    query->bindValue(":status_check", PPSDK::EPaymentStatus::ReadyForCheck);
+    query->bindValue(":status_error", PPSDK::EPaymentStatus::ProcessError);
+    query->bindValue(
+        ":date",
+        QDateTime::fromMSecsSinceEpoch(aNow).toString(CIDatabaseProxy::DateFormat));
+    query->bindValue(":now", aNow);
+    query->bindValue(":limit", aLimit);
+
+    if (!query->exec() || !query->first()) {
+        return result;
+    }
+
+    for (; query->isValid(); query->next()) {
+        SQueuedPayment payment;
+
+        payment.id = query->value(0).toLongLong();
+        payment.provider = query->value(1).isNull() ? -1 : query->value(1).toLongLong();
+        payment.created = query->value(2).toLongLong();
+        payment.amount = query->value(3).toDouble();
+
+        result << payment;
+    }
+
+    return result;
+}
+
+//---------------------------------------------------------------------------
+bool PaymentQueue::claim(qint64 aPayment, const QString &aOwner, qint64 aUntil, qint64 aNow) {
+    QScopedPointer<IDatabaseQuery> query(m_Database.createQuery(CPaymentQueue::ClaimQuery));
+    if (!query) {
+        return false;
+    }
+
+    query->bindValue(":owner", aOwner);
+    query->bindValue(":until", aUntil);
+    query->bindValue(":id", aPayment);
+    query->bindValue(":now", aNow);
+
+    // Условие на срок аренды проверяется в том же UPDATE, поэтому захват атомарен.
+    return query->exec() && (query->numRowsAffected() == 1);
+}
+
+//---------------------------------------------------------------------------
+bool PaymentQueue::renew(qint64 aPayment, const QString &aOwner, qint64 aUntil, qint64 aNow) {
+    QScopedPointer<IDatabaseQuery> query(m_Database.createQuery(CPaymentQueue::RenewQuery));
+    if (!query) {
+        return false;
+    }
+
+    query->bindValue(":until", aUntil);
+    query->bindValue(":id", aPayment);
+    query->bindValue(":owner", aOwner);
+    query->bindValue(":now", aNow);
+
+    // Истёкшая аренда не продлевается: платёж мог уже достаться другому обработчику.
+    return query->exec() && (query->numRowsAffected() == 1);
+}
+
+//---------------------------------------------------------------------------
+bool PaymentQueue::release(qint64 aPayment, const QString &aOwner) {
+    QScopedPointer<IDatabaseQuery> query(m_Database.createQuery(CPaymentQueue::ReleaseQuery));
+    if (!query) {
+        return false;
+    }
+
+    query->bindValue(":id", aPayment);
+    query->bindValue(":owner", aOwner);
+
+    return query->exec();
+}
+
+//---------------------------------------------------------------------------
+qint64 PaymentQueue::now() {
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+//---------------------------------------------------------------------------
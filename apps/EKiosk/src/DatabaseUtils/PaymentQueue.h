@@ -0,0 +1,59 @@
+/* @file Очередь оффлайн платежей с арендой записей. */
+
+#pragma once
+
+#include <QtCore/QList>
+#include <QtCore/QString>
+
+class IDatabaseProxy;
+
+//---------------------------------------------------------------------------
+/// Платёж, ожидающий проведения.
+struct SQueuedPayment {
+    qint64 id;       /// Идентификатор платежа.
+    qint64 provider; /// Оператор.
+    qint64 created;  /// Время создания, мс от 1970-01-01 (0 - неизвестно).
+    double amount;   /// Сумма платежа.
+
+    SQueuedPayment() : id(-1), provider(-1), created(0), amount(0) {}
+};
+
+//---------------------------------------------------------------------------
+namespace EPaymentQueueOrder {
+/// Порядок выборки очереди.
+enum Enum {
+    Oldest = 0, /// Сначала созданные раньше.
+    Amount      /// Сначала крупные.
+};
+} // namespace EPaymentQueueOrder
+
+//---------------------------------------------------------------------------
+/// Выборка платежей к проведению и их аренда в таблице `payment` (db_patch_15.sql). Платёж
+/// проводится только владельцем действующей аренды: захват - условный UPDATE, поэтому из двух
+/// обработчиков (в том числе разных экземпляров приложения после перезапуска) платёж получит
+/// один. Аренда с истёкшим сроком считается свободной - так подбираются платежи упавшего
+/// экземпляра. Методы не потокобезопасны, синхронизация - на вызывающей стороне.
+class PaymentQueue {
+public:
+    explicit PaymentQueue(IDatabaseProxy &aDatabase);
+
+    /// Не более aLimit свободных платежей, у которых наступило время проведения, в порядке aOrder.
+    QList<SQueuedPayment> select(EPaymentQueueOrder::Enum aOrder, int aLimit, qint64 aNow);
+
+    /// Захватывает платёж aPayment для aOwner до момента aUntil. false - платёж уже арендован.
+    bool claim(qint64 aPayment, const QString &aOwner, qint64 aUntil, qint64 aNow);
+
+    /// Продлевает действующую аренду aOwner до aUntil. false - аренда истекла или чужая.
+    bool renew(qint64 aPayment, const QString &aOwner, qint64 aUntil, qint64 aNow);
+
+    /// Освобождает аренду aOwner. Чужая аренда не снимается.
+    bool release(qint64 aPayment, const QString &aOwner);
+
+    /// Текущее время в формате срока аренды.
+    static qint64 now();
+
+private:
+    IDatabaseProxy &m_Database;
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,63 @@
+/* @file Разбор SQL-скриптов схемы БД и общие выражения схемы. */
+
+#pragma once
+
+#include <QtCore/QDate>
+#include <QtCore/QDateTime>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QStringList>
+
+//---------------------------------------------------------------------------
+namespace SqlScript {
+
+/// Разбивает скрипт на отдельные запросы: убирает комментарии и переводы строк, режет по ';'.
+/// Тело CREATE TRIGGER ... BEGIN ... END содержит ';' и остаётся одним запросом.
+inline QStringList split(const QString &aScript) {
+    QString script = aScript;
+
+    script.replace(QRegularExpression(R"((\/\*.*\*\/|\-\-.*\n))"), "");
+
+    // Удалим перевод строк с сохранением возможности писать ("CREATE\nTABLE")
+    script.replace("\r", "");
+    script.replace("\n", " ");
+
+    static const QRegularExpression triggerStart(R"(^\s*CREATE\s+(TEMP\s+|TEMPORARY\s+)?TRIGGER\b)",
+                                                 QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression triggerEnd(R"(\bEND\s*$)",
+                                               QRegularExpression::CaseInsensitiveOption);
+
+    QStringList result;
+    QString pending;
+
+    foreach (const QString &part, script.split(";")) {
+        pending += part;
+
+        if (pending.contains(triggerStart) && !pending.contains(triggerEnd)) {
+            pending += ";";
+            continue;
+        }
+
+        if (!pending.trimmed().isEmpty()) {
+            result << pending.trimmed();
+        }
+
+        pending.clear();
+    }
+
+    if (!pending.trimmed().isEmpty()) {
+        result << pending.trimmed();
+    }
+
+    return result;
+}
+
+/// Дата платежа в миллисекундах от 1970-01-01 без учёта часового пояса - так же, как колонку
+/// `payment`.`create_epoch` считает скрипт db_patch_13.sql по строке `create_date`.
+inline qint64 toEpoch(const QDateTime &aDateTime) {
+    return QDate(1970, 1, 1).daysTo(aDateTime.date()) * Q_INT64_C(86400000) +
+           aDateTime.time().msecsSinceStartOfDay();
+}
+
+} // namespace SqlScript
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,29 @@
+-- sqlite
+-- Время создания платежа в миллисекундах от 1970-01-01 (без учёта часового пояса, как и строка
+-- `create_date`). Выборки по дате идут диапазоном по индексу вместо strftime() по каждой строке.
+ALTER TABLE `payment` ADD COLUMN `create_epoch` INTEGER DEFAULT NULL;
+
+UPDATE `payment` SET `create_epoch` =
+  CAST(strftime('%s', `create_date`) AS INTEGER) * 1000 + CAST(substr(strftime('%f', `create_date`), 4) AS INTEGER);
+
+CREATE INDEX IF NOT EXISTS i__payment__create_epoch ON `payment` (`create_epoch`);
+
+CREATE TRIGGER IF NOT EXISTS t__payment__create_epoch_insert AFTER INSERT ON `payment`
+BEGIN
+  UPDATE `payment` SET `create_epoch` =
+    CAST(strftime('%s', NEW.`create_date`) AS INTEGER) * 1000 + CAST(substr(strftime('%f', NEW.`create_date`), 4) AS INTEGER)
+  WHERE `id` = NEW.`id`;
+END;
+
+CREATE TRIGGER IF NOT EXISTS t__payment__create_epoch_update AFTER UPDATE OF `create_date` ON `payment`
+WHEN NEW.`create_date` IS NOT OLD.`create_date`
+BEGIN
+  UPDATE `payment` SET `create_epoch` =
+    CAST(strftime('%s', NEW.`create_date`) AS INTEGER) * 1000 + CAST(substr(strftime('%f', NEW.`create_date`), 4) AS INTEGER)
+  WHERE `id` = NEW.`id`;
+END;
+
+-- Выданные купюры выбираются по отметке инкассации.
+CREATE INDEX IF NOT EXISTS i__dispensed_note__reported ON `dispensed_note` (`reported`);
+
+UPDATE `device_param` SET `value` = 13 WHERE `name` = 'db_patch' AND `fk_device_id` = 1;
@@ -0,0 +1,28 @@
+-- sqlite
+-- Счётчики купюр с начала инкассации (BalanceCounters): 0 - принятые, 1 - выданные сдачей.
+-- Меняются вместе с купюрами и обнуляются инкассацией, баланс не агрегирует всю историю.
+CREATE TABLE IF NOT EXISTS `balance_counter` (
+  `kind`      INTEGER NOT NULL,
+  `type`      INTEGER NOT NULL,
+  `nominal`   DECIMAL(10,2) NOT NULL,
+  `currency`  INTEGER NOT NULL,
+  `count`     INTEGER NOT NULL DEFAULT 0,
+  `serials`   TEXT DEFAULT NULL,
+
+  CONSTRAINT unique_balance_counter UNIQUE([kind], [type], [nominal], [currency])
+);
+
+DELETE FROM `balance_counter`;
+
+-- Принятые купюры текущей инкассации, кроме электронных денег (EAmountType::EMoney = 2).
+INSERT INTO `balance_counter` (`kind`, `type`, `nominal`, `currency`, `count`, `serials`)
+  SELECT 0, `type`, `nominal`, `currency`, COUNT(*), GROUP_CONCAT(`serial`, ',') FROM `payment_note`
+  WHERE ((NOT `ejection`) OR (`ejection` IS NULL)) AND `type` <> 2
+  GROUP BY `type`, `nominal`, `currency`;
+
+INSERT INTO `balance_counter` (`kind`, `type`, `nominal`, `currency`, `count`, `serials`)
+  SELECT 1, `type`, `nominal`, `currency`, COUNT(*), GROUP_CONCAT(`serial`, ',') FROM `dispensed_note`
+  WHERE ((NOT `reported`) OR (`reported` IS NULL))
+  GROUP BY `type`, `nominal`, `currency`;
+
+UPDATE `device_param` SET `value` = 14 WHERE `name` = 'db_patch' AND `fk_device_id` = 1;
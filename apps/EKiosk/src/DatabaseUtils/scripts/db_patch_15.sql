@@ -0,0 +1,11 @@
+-- sqlite
+-- Аренда платежа обработчиком оффлайн очереди: идентификатор экземпляра приложения и срок аренды
+-- в миллисекундах от 1970-01-01 UTC. Платёж с действующей арендой не берётся в обработку, поэтому
+-- после перезапуска его не проведёт второй обработчик, пока прежний ещё может его проводить.
+ALTER TABLE `payment` ADD COLUMN `lease_owner` VARCHAR(38) DEFAULT NULL;
+ALTER TABLE `payment` ADD COLUMN `lease_until` INTEGER DEFAULT NULL;
+
+-- Очередь выбирается по статусу, а не перебором всей истории платежей.
+CREATE INDEX IF NOT EXISTS i__payment__status ON `payment` (`status`);
+
+UPDATE `device_param` SET `value` = 15 WHERE `name` = 'db_patch' AND `fk_device_id` = 1;
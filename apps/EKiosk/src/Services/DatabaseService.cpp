@@ -69,6 +69,39 @@ bool DatabaseService::initialize() {
             .arg(dbSettings.port)
             .arg(dbSettings.name));
 
+    SDatabasePerformance performance;
+
+    if (!dbSettings.journalMode.isEmpty()) {
+        performance.journalMode = dbSettings.journalMode;
+    }
+
+    if (!dbSettings.synchronous.isEmpty()) {
+        performance.synchronous = dbSettings.synchronous;
+    }
+
+    if (dbSettings.cacheSize != 0) {
+        performance.cacheSize = dbSettings.cacheSize;
+    }
+
+    if (dbSettings.mmapSize >= 0) {
+        performance.mmapSize = dbSettings.mmapSize;
+    }
+
+    if (!dbSettings.tempStore.isEmpty()) {
+        performance.tempStore = dbSettings.tempStore;
+    }
+
+    if (dbSettings.statementCacheSize >= 0) {
+        performance.statementCacheSize = dbSettings.statementCacheSize;
+    }
+
+    if (dbSettings.readConnections >= 0) {
+        performance.readConnections = dbSettings.readConnections;
+    }
+
+    m_Database->setPerformance(performance);
+    m_DbUtils->setBalanceSelfCheck(dbSettings.balanceSelfCheck);
+
     bool integrityFailed = false;
     QStringList errorsList;
 
@@ -99,11 +132,18 @@ bool DatabaseService::initialize() {
 
                 // Закрываем БД и переименовываем файл базы
                 QString databaseFile = m_Database->getCurrentBaseName();
+                QString backupSuffix = QString(".backup_%1").arg(
+                    QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss_zzz"));
                 m_Database->close();
-                QFile::rename(databaseFile,
-                              databaseFile + QString(".backup_%1")
-                                                 .arg(QDateTime::currentDateTime().toString(
-                                                     "yyyyMMdd_hhmmss_zzz")));
+                QFile::rename(databaseFile, databaseFile + backupSuffix);
+
+                // Журнал WAL от сломанной базы не должен примениться к новой.
+                foreach (const QString &journal, QStringList() << "-wal" << "-shm" << "-journal") {
+                    if (QFile::exists(databaseFile + journal)) {
+                        QFile::rename(databaseFile + journal,
+                                      databaseFile + backupSuffix + journal);
+                    }
+                }
 
                 // Выставить ошибочный статус устройства "терминал"
                 EventService::instance(m_Application)
@@ -55,7 +55,7 @@ const int NetworkFailureTimeout = 3;
 //---------------------------------------------------------------------------
 NetworkService::NetworkService(IApplication *aApplication)
     : ILogable("Connection"), m_DeviceService(nullptr), m_EventService(nullptr),
-      m_Connection(nullptr), m_Enabled(true), m_DontWatchConnection(false),
+      m_Connection(nullptr), m_Enabled(true), m_CachedConnected(0), m_DontWatchConnection(false),
       m_Application(aApplication), m_Fails(0) {
     QObject::moveToThread(this);
 
@@ -204,9 +204,18 @@ bool NetworkService::closeConnection() {
 
 //---------------------------------------------------------------------------
 bool NetworkService::isConnected(bool aUseCache) {
+    if (aUseCache) {
+        return m_CachedConnected.loadAcquire() != 0;
+    }
+
     try {
-        return m_Connection ? m_Connection->isConnected(aUseCache) : false;
+        bool connected = m_Connection ? m_Connection->isConnected(false) : false;
+        m_CachedConnected.storeRelease(connected ? 1 : 0);
+
+        return connected;
     } catch (const NetworkError &e) {
+        m_CachedConnected.storeRelease(0);
+
         toLog(LogLevel::Error, e.getMessage());
         if (e.getSeverity() == ESeverity::Critical) {
             toLog(LogLevel::Fatal, "Generating reboot event due to critical error.");
@@ -253,8 +262,14 @@ PP::SConnection NetworkService::getConnection() const {
 //---------------------------------------------------------------------------
 bool NetworkService::testConnection() {
     bool result = false;
-    QMetaObject::invokeMethod(
-        this, "doTestConnection", Qt::BlockingQueuedConnection, Q_ARG(bool *, &result));
+
+    // Хосты проверяются параллельно, так что ожидание не дольше таймаута одного запроса.
+    // Из потока сервиса проверка вызывается напрямую.
+    Qt::ConnectionType type = QThread::currentThread() == static_cast<QThread *>(this)
+                                  ? Qt::DirectConnection
+                                  : Qt::BlockingQueuedConnection;
+
+    QMetaObject::invokeMethod(this, "doTestConnection", type, Q_ARG(bool *, &result));
     return result;
 }
 
@@ -588,6 +603,8 @@ void NetworkService::onModem_Initialized() {
 
 //---------------------------------------------------------------------------
 void NetworkService::onConnectionAlive() {
+    m_CachedConnected.storeRelease(1);
+
     // В случае успешной проверки связи - сбрасываем счетчик обрывов
     m_Fails = 0;
 }
@@ -596,6 +613,8 @@ void NetworkService::onConnectionAlive() {
 void NetworkService::onConnectionLost() {
     toLog(LogLevel::Warning, "Connection lost.");
 
+    m_CachedConnected.storeRelease(0);
+
     if (m_DontWatchConnection || !m_Enabled) {
         return;
     }
@@ -719,6 +738,8 @@ bool NetworkService::doDisconnect() {
             m_Connection->close();
         }
 
+        m_CachedConnected.storeRelease(0);
+
         toLog(LogLevel::Normal, QString("Disconnected from '%1'.").arg(getConnection().name));
 
         return true;
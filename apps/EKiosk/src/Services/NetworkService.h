@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QMutex>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QString>
@@ -65,7 +66,8 @@ public:
     /// Разрывает соединение.
     virtual bool closeConnection();
 
-    /// Проверяет установленно ли соединение.
+    /// Проверяет установленно ли соединение. С aUseCache возвращает состояние, опубликованное
+    /// потоком сервиса по последней проверке, не обращаясь к соединению и не блокируясь.
     virtual bool isConnected(bool aUseCache = false);
 
     /// Тестирует соединение: устанавливает, проверяет доступность ресурса aHost, разрывает.
@@ -122,6 +124,9 @@ private:
     /// Признак работы сетевого сервиса
     volatile bool m_Enabled;
 
+    /// Состояние соединения по последней проверке, читается из любого потока.
+    QAtomicInt m_CachedConnected;
+
     // Число неудачных попыток соединения.
     int m_Fails;
     QTimer m_RestoreTimer;
@@ -0,0 +1,219 @@
+/* @file Параллельное проведение оффлайн платежей. */
+
+#include "Services/OfflinePaymentWorkers.h"
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRandomGenerator>
+
+//---------------------------------------------------------------------------
+namespace CWorkers {
+/// Запас разрешений корзины: столько секунд проведения на полной частоте подряд.
+const double BurstSeconds = 10;
+
+/// Ожидание проводимых платежей при удалении, мс.
+const int DestroyTimeout = 5 * 1000;
+} // namespace CWorkers
+
+//---------------------------------------------------------------------------
+OfflinePaymentWorkers::OfflinePaymentWorkers(const SSettings &aSettings,
+                                             const TGatewayResolver &aGatewayResolver,
+                                             const TClock &aClock)
+    : m_Settings(aSettings), m_GatewayResolver(aGatewayResolver), m_Clock(aClock),
+      m_State(new SState()), m_Pool(new QThreadPool()) {
+    m_Settings.workers = qMax(1, m_Settings.workers);
+
+    if (!m_Clock) {
+        m_Clock = &PaymentQueue::now;
+    }
+
+    m_Pool->setMaxThreadCount(m_Settings.workers);
+}
+
+//---------------------------------------------------------------------------
+OfflinePaymentWorkers::~OfflinePaymentWorkers() {
+    stop();
+
+    // Деструктор QThreadPool ждёт задачи без ограничения. Пул с зависшей задачей оставляем
+    // до выхода из приложения: задача держит только разделяемое состояние.
+    if (m_Pool->waitForDone(CWorkers::DestroyTimeout)) {
+        delete m_Pool;
+    }
+}
+
+//---------------------------------------------------------------------------
+const OfflinePaymentWorkers::SSettings &OfflinePaymentWorkers::getSettings() const {
+    return m_Settings;
+}
+
+//---------------------------------------------------------------------------
+void OfflinePaymentWorkers::setFinishedHandler(const TFinished &aHandler) {
+    QMutexLocker lock(&m_State->lock);
+
+    m_State->finished = aHandler;
+}
+
+//---------------------------------------------------------------------------
+void OfflinePaymentWorkers::stop() {
+    QMutexLocker lock(&m_State->lock);
+
+    m_State->stopped = true;
+    m_State->finished = TFinished();
+}
+
+//---------------------------------------------------------------------------
+int OfflinePaymentWorkers::dispatch(const QList<SQueuedPayment> &aQueue,
+                                    const TClaim &aClaim,
+                                    const TProcess &aProcess) {
+    QMutexLocker lock(&m_State->lock);
+
+    if (m_State->stopped) {
+        return 0;
+    }
+
+    int started = 0;
+    int freeWorkers = m_Settings.workers - m_State->running.size();
+    qint64 now = m_Clock();
+
+    foreach (const SQueuedPayment &payment, aQueue) {
+        if (freeWorkers <= 0) {
+            break;
+        }
+
+        if (m_State->running.contains(payment.id)) {
+            continue;
+        }
+
+        QString provider = QString::number(payment.provider);
+        QString gateway = m_Settings.gatewayRate > 0 ? getGateway(payment.provider) : QString();
+
+        // Платёж с исчерпанным лимитом остаётся в очереди, следующие за ним идут своим чередом.
+        if (!hasToken(m_ProviderBuckets, provider, m_Settings.providerRate, now) ||
+            !hasToken(m_GatewayBuckets, gateway, m_Settings.gatewayRate, now)) {
+            continue;
+        }
+
+        if (!aClaim(payment)) {
+            continue;
+        }
+
+        takeToken(m_ProviderBuckets, provider, m_Settings.providerRate);
+        takeToken(m_GatewayBuckets, gateway, m_Settings.gatewayRate);
+
+        m_State->running.insert(payment.id);
+
+        QSharedPointer<SState> state = m_State;
+
+        QtConcurrent::run(m_Pool, [state, payment, aProcess]() {
+            aProcess(payment);
+            finish(state, payment.id);
+        });
+
+        ++started;
+        --freeWorkers;
+    }
+
+    return started;
+}
+
+//---------------------------------------------------------------------------
+int OfflinePaymentWorkers::running() const {
+    QMutexLocker lock(&m_State->lock);
+
+    return m_State->running.size();
+}
+
+//---------------------------------------------------------------------------
+QList<qint64> OfflinePaymentWorkers::getRunning() const {
+    QMutexLocker lock(&m_State->lock);
+
+    return m_State->running.values();
+}
+
+//---------------------------------------------------------------------------
+int OfflinePaymentWorkers::available() const {
+    QMutexLocker lock(&m_State->lock);
+
+    return m_Settings.workers - m_State->running.size();
+}
+
+//---------------------------------------------------------------------------
+bool OfflinePaymentWorkers::waitForDone(int aTimeout) {
+    return m_Pool->waitForDone(aTimeout);
+}
+
+//---------------------------------------------------------------------------
+QDateTime
+OfflinePaymentWorkers::jitter(const QDateTime &aNextTry, const QDateTime &aNow, double aSpread) {
+    qint64 delay = aNow.msecsTo(aNextTry);
+
+    if (delay <= 0 || aSpread <= 0) {
+        return aNextTry;
+    }
+
+    double factor = (QRandomGenerator::global()->generateDouble() * 2 - 1) * aSpread;
+
+    return aNextTry.addMSecs(qint64(delay * factor));
+}
+
+//---------------------------------------------------------------------------
+bool OfflinePaymentWorkers::hasToken(QMap<QString, SBucket> &aBuckets,
+                                     const QString &aKey,
+                                     double aRate,
+                                     qint64 aNow) {
+    if (aRate <= 0) {
+        return true;
+    }
+
+    double capacity = qMax(1.0, aRate * CWorkers::BurstSeconds / 60);
+
+    auto it = aBuckets.find(aKey);
+    if (it == aBuckets.end()) {
+        SBucket bucket = {capacity, aNow};
+        it = aBuckets.insert(aKey, bucket);
+    } else if (aNow > it->updated) {
+        it->tokens = qMin(capacity, it->tokens + (aNow - it->updated) * aRate / 60000);
+        it->updated = aNow;
+    }
+
+    return it->tokens >= 1;
+}
+
+//---------------------------------------------------------------------------
+void OfflinePaymentWorkers::takeToken(QMap<QString, SBucket> &aBuckets,
+                                      const QString &aKey,
+                                      double aRate) {
+    if (aRate > 0) {
+        aBuckets[aKey].tokens -= 1;
+    }
+}
+
+//---------------------------------------------------------------------------
+QString OfflinePaymentWorkers::getGateway(qint64 aProvider) {
+    auto it = m_Gateways.find(aProvider);
+
+    if (it == m_Gateways.end()) {
+        QString gateway = m_GatewayResolver ? m_GatewayResolver(aProvider) : QString();
+        it = m_Gateways.insert(aProvider, gateway);
+    }
+
+    return it.value();
+}
+
+//---------------------------------------------------------------------------
+void OfflinePaymentWorkers::finish(const QSharedPointer<SState> &aState, qint64 aPayment) {
+    TFinished handler;
+
+    {
+        QMutexLocker lock(&aState->lock);
+
+        aState->running.remove(aPayment);
+        handler = aState->finished;
+    }
+
+    if (handler) {
+        handler();
+    }
+}
+
+//---------------------------------------------------------------------------
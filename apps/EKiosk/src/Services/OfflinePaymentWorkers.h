@@ -0,0 +1,130 @@
+/* @file Параллельное проведение оффлайн платежей. */
+
+#pragma once
+
+#include <QtCore/QDateTime>
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QThreadPool>
+
+#include <functional>
+
+#include "DatabaseUtils/PaymentQueue.h"
+
+//---------------------------------------------------------------------------
+/// Раздаёт платежи очереди пулу потоков. Одновременно проводится не больше заданного числа
+/// платежей; частота проведения ограничивается отдельно для каждого оператора и каждого шлюза
+/// (token bucket с запасом на CWorkers::BurstSeconds). Платёж запускается только после захвата
+/// (аренды) в БД, поэтому один и тот же платёж не проводится дважды ни этим, ни другим
+/// экземпляром приложения. Методы потокобезопасны.
+class OfflinePaymentWorkers {
+public:
+    struct SSettings {
+        /// Число потоков проведения.
+        int workers{4};
+
+        /// Порядок очереди.
+        EPaymentQueueOrder::Enum order{EPaymentQueueOrder::Oldest};
+
+        /// Платежей в минуту на оператора и на шлюз, 0 - без ограничения.
+        double providerRate{0};
+        double gatewayRate{0};
+    };
+
+    /// Шлюз оператора (ключ ограничения частоты).
+    typedef std::function<QString(qint64 aProvider)> TGatewayResolver;
+
+    /// Захват платежа. false - платёж занят другим обработчиком.
+    typedef std::function<bool(const SQueuedPayment &aPayment)> TClaim;
+
+    /// Проведение захваченного платежа, выполняется в потоке пула.
+    typedef std::function<void(const SQueuedPayment &aPayment)> TProcess;
+
+    /// Текущее время в мс.
+    typedef std::function<qint64()> TClock;
+
+    /// Освободился поток проведения, вызывается в потоке пула.
+    typedef std::function<void()> TFinished;
+
+    OfflinePaymentWorkers(const SSettings &aSettings,
+                          const TGatewayResolver &aGatewayResolver,
+                          const TClock &aClock = TClock());
+    ~OfflinePaymentWorkers();
+
+    const SSettings &getSettings() const;
+
+    /// Устанавливает обработчик освобождения потока (например, чтобы сразу взять следующий платёж).
+    void setFinishedHandler(const TFinished &aHandler);
+
+    /// Прекращает раздачу: dispatch() больше не запускает платежи. Проводимые доводятся до конца.
+    void stop();
+
+    /// Запускает платежи из aQueue (в порядке следования) на свободных потоках. Уже проводимые и
+    /// упёршиеся в ограничение частоты платежи пропускаются. Возвращает число запущенных.
+    int dispatch(const QList<SQueuedPayment> &aQueue,
+                 const TClaim &aClaim,
+                 const TProcess &aProcess);
+
+    /// Число проводимых сейчас платежей.
+    int running() const;
+
+    /// Идентификаторы проводимых сейчас платежей.
+    QList<qint64> getRunning() const;
+
+    /// Число свободных потоков.
+    int available() const;
+
+    /// Ждёт завершения проводимых платежей. false - не дождались за aTimeout мс.
+    bool waitForDone(int aTimeout);
+
+    /// Разносит время следующей попытки aNextTry на ±aSpread от оставшейся паузы, чтобы
+    /// отложенные одновременно платежи не возвращались в очередь одной пачкой.
+    static QDateTime jitter(const QDateTime &aNextTry, const QDateTime &aNow, double aSpread = 0.2);
+
+private:
+    Q_DISABLE_COPY(OfflinePaymentWorkers)
+
+    struct SBucket {
+        double tokens;
+        qint64 updated;
+    };
+
+    /// Состояние, которое задачи пула разделяют с объектом: задача, не завершившаяся к удалению
+    /// объекта, продолжает работать с ним.
+    struct SState {
+        QMutex lock;
+        QSet<qint64> running;
+        TFinished finished;
+        bool stopped{false};
+    };
+
+    /// Пополняет корзину aKey и проверяет наличие разрешения.
+    static bool
+    hasToken(QMap<QString, SBucket> &aBuckets, const QString &aKey, double aRate, qint64 aNow);
+
+    /// Забирает разрешение из корзины aKey.
+    static void takeToken(QMap<QString, SBucket> &aBuckets, const QString &aKey, double aRate);
+
+    /// Шлюз оператора с кешированием.
+    QString getGateway(qint64 aProvider);
+
+    /// Платёж завершён.
+    static void finish(const QSharedPointer<SState> &aState, qint64 aPayment);
+
+private:
+    SSettings m_Settings;
+    TGatewayResolver m_GatewayResolver;
+    TClock m_Clock;
+
+    /// Блокировка m_State->lock защищает и корзины с кешем шлюзов.
+    QSharedPointer<SState> m_State;
+    QThreadPool *m_Pool;
+    QMap<qint64, QString> m_Gateways;
+    QMap<QString, SBucket> m_ProviderBuckets;
+    QMap<QString, SBucket> m_GatewayBuckets;
+};
+
+//---------------------------------------------------------------------------
@@ -6,6 +6,8 @@
 #include <QtCore/QCryptographicHash>
 #include <QtCore/QMutexLocker>
 #include <QtCore/QRegularExpression>
+#include <QtCore/QUrl>
+#include <QtCore/QUuid>
 
 #include <SDK/PaymentProcessor/Core/Event.h>
 #include <SDK/PaymentProcessor/Core/EventTypes.h>
@@ -57,6 +59,18 @@ const int OnlinePaymentOvertime = 30 * 60 * 1000;
 /// Таймаут обработки очереди оффлайн платежей при отсутствии связи.
 const int CheckNetworkConnectionTimeout = 5 * 1000;
 
+/// Сколько платежей очереди просматривается за один проход.
+const int QueueWindow = 256;
+
+/// Срок аренды платежа, сек. После него платёж упавшего экземпляра снова попадает в очередь.
+const int LeaseTimeout = 10 * 60;
+
+/// Период продления аренды проводимых платежей, сек.
+const int LeaseRenewInterval = LeaseTimeout / 5;
+
+/// Ожидание проводимых платежей при остановке сервиса.
+const int WorkersShutdownTimeout = 10 * 1000;
+
 /// Тип платежа, в который будет добавляться неизрасходованная сдача.
 const char ChangePaymentType[] = "humo";
 
@@ -73,7 +87,7 @@ PaymentService *PaymentService::instance(IApplication *aApplication) {
 //---------------------------------------------------------------------------
 PaymentService::PaymentService(IApplication *aApplication)
     : ILogable("Payments"), m_Application(aApplication), m_Enabled(false), m_DBUtils(nullptr),
-      m_CommandIndex(0), m_OfflinePaymentID(-1) {
+      m_CommandIndex(0), m_InstanceID(QUuid::createUuid().toString()) {
     qRegisterMetaType<EPaymentCommandResult::Enum>("EPaymentCommandResult");
 
     m_PaymentThread.setObjectName(CPaymentService::ThreadName);
@@ -131,6 +145,33 @@ bool PaymentService::initialize() {
         }
     }
 
+    PPSDK::SOfflinePaymentSettings offlineSettings =
+        SettingsService::instance(m_Application)
+            ->getAdapter<PPSDK::TerminalSettings>()
+            ->getOfflinePaymentSettings();
+
+    OfflinePaymentWorkers::SSettings workerSettings;
+    workerSettings.workers = offlineSettings.workers;
+    workerSettings.order = (offlineSettings.order == PPSDK::SOfflinePaymentSettings::Amount)
+                               ? EPaymentQueueOrder::Amount
+                               : EPaymentQueueOrder::Oldest;
+    workerSettings.providerRate = offlineSettings.providerRate;
+    workerSettings.gatewayRate = offlineSettings.gatewayRate;
+
+    m_Workers.reset(new OfflinePaymentWorkers(
+        workerSettings, [this](qint64 aProvider) { return getProviderGateway(aProvider); }));
+
+    // Освободившийся поток сразу берёт следующий платёж, не дожидаясь таймера.
+    m_Workers->setFinishedHandler([this]() {
+        QMetaObject::invokeMethod(&m_PaymentTimer, "start", Qt::QueuedConnection, Q_ARG(int, 0));
+    });
+
+    toLog(LogLevel::Normal,
+          QString("Offline payment workers: %1, provider rate: %2/min, gateway rate: %3/min.")
+              .arg(workerSettings.workers)
+              .arg(workerSettings.providerRate)
+              .arg(workerSettings.gatewayRate));
+
     // Ищем всех провайдеров с неподдерживаемым типом процессинга
     auto *dealerSettings = SettingsService::instance(m_Application)
                                ->getAdapter<SDK::PaymentProcessor::DealerSettings>();
@@ -189,12 +230,32 @@ bool PaymentService::shutdown() {
 
     SafeStopServiceThread(&m_PaymentThread, 3000, getLog());
 
+    // Новые платежи не раздаются, сетевые запросы проводимых уже сброшены сетевым сервисом
+    // выше. Дожидаемся, пока потоки проведения выйдут из фабрик платежей.
+    bool drained = true;
+
+    if (m_Workers) {
+        m_Workers->stop();
+
+        drained = m_Workers->waitForDone(CPaymentService::WorkersShutdownTimeout);
+    }
+
     if (m_ChangePayment) {
         m_ChangePayment.reset();
     }
 
     setPaymentActive(std::shared_ptr<PPSDK::IPayment>());
 
+    // Зависший платёж ещё работает с фабрикой: оставляем фабрики до выхода из приложения.
+    // Аренда такого платежа не даст провести его повторно до истечения срока.
+    if (!drained) {
+        toLog(LogLevel::Error,
+              QString("%1 offline payment(s) still in progress, payment factories are kept.")
+                  .arg(m_Workers->running()));
+
+        return true;
+    }
+
     while (!m_Factories.isEmpty()) {
         PluginService::instance(m_Application)
             ->getPluginLoader()
@@ -687,12 +748,14 @@ bool PaymentService::updatePaymentFields(
     bool aForceUpdate) {
     QMutexLocker lock(&m_OfflinePaymentLock);
 
-    if (m_OfflinePaymentID != aID) {
+    std::shared_ptr<PPSDK::IPayment> offlinePayment = m_OfflinePayments.value(aID);
+
+    if (!offlinePayment) {
         doUpdatePaymentFields(aID, getPayment(aID), aFields);
     } else if (aForceUpdate) {
         // m_OfflinePaymentLock гарантирует что мы попали на запись параметра ДО сохранения оффлайн
         // платежа в БД сохраняем параметр в объект, обслуживаемый в оффлайне
-        doUpdatePaymentFields(aID, m_OfflinePayment, aFields, aForceUpdate);
+        doUpdatePaymentFields(aID, offlinePayment, aFields, aForceUpdate);
         // тут же сохраняем объект в базу напрямую
         doUpdatePaymentFields(aID, getPayment(aID), aFields, aForceUpdate);
     } else {
@@ -882,7 +945,8 @@ bool PaymentService::canProcessPaymentOffline(qint64 aPayment) {
 
 //---------------------------------------------------------------------------
 void PaymentService::hangupProcessing() {
-    QMetaObject::invokeMethod(this, "onProcessPayments", Qt::QueuedConnection);
+    // Очередь раздаётся только из потока проведения платежей.
+    QMetaObject::invokeMethod(&m_PaymentTimer, "start", Qt::QueuedConnection, Q_ARG(int, 0));
 }
 
 //---------------------------------------------------------------------------
@@ -1026,8 +1090,7 @@ bool PaymentService::processPaymentInternal(const std::shared_ptr<PPSDK::IPaymen
     // Запоминаем id платежа, находящегося в обработке.
     {
         QMutexLocker lock(&m_OfflinePaymentLock);
-        m_OfflinePaymentID = aPayment->getID();
-        m_OfflinePayment = aPayment;
+        m_OfflinePayments.insert(aPayment->getID(), aPayment);
     }
 
     // Проверка на неиспользованный остаток
@@ -1057,12 +1120,23 @@ bool PaymentService::processPaymentInternal(const std::shared_ptr<PPSDK::IPaymen
         }
     }
 
+    // Разносим повторные попытки платежей, отложенных одновременно (например, при недоступности
+    // шлюза), чтобы они не возвращались в очередь одной пачкой.
+    if (aPayment->getStatus() == PPSDK::EPaymentStatus::ProcessError) {
+        QDateTime nextTry =
+            aPayment->getParameter(PPSDK::CPayment::Parameters::NextTryDate).value.toDateTime();
+
+        if (nextTry.isValid()) {
+            aPayment->setNextTryDate(
+                OfflinePaymentWorkers::jitter(nextTry, QDateTime::currentDateTime()));
+        }
+    }
+
     // Отпускаем платеж.
     {
         QMutexLocker lock(&m_OfflinePaymentLock);
 
-        m_OfflinePaymentID = -1;
-        m_OfflinePayment.reset();
+        m_OfflinePayments.remove(aPayment->getID());
 
         // Сохраняем платёж внутри защищенного блока для избежания записи параметров offline платежа
         savePayment(aPayment.get());
@@ -1085,6 +1159,8 @@ void PaymentService::onProcessPayments() {
         m_LastBackupDate = QDateTime::currentDateTime();
     }
 
+    renewLeases();
+
     // Блокируем offline проведение платежей до установления связи
     if (!m_Application->getCore()->getNetworkService()->isConnected(true)) {
         toLog(LogLevel::Warning, "Waiting network connection for payment processing.");
@@ -1094,37 +1170,97 @@ void PaymentService::onProcessPayments() {
         return;
     }
 
-    QList<qint64> payments = m_DBUtils->getPaymentQueue();
-
-    if (static_cast<int>(!payments.empty()) != 0) {
-        qint64 id = payments.takeFirst();
+    {
+        QMutexLocker lock(&m_CommandMutex);
 
-        if (m_Enabled) {
-            std::shared_ptr<PPSDK::IPayment> payment(getPayment(id));
+        if (!m_Commands.isEmpty()) {
+            // Команды меняют платежи в обход очереди, поэтому выполняются, когда ни один платёж
+            // не проводится. До тех пор новые платежи не раздаются.
+            if (m_Workers->running() != 0) {
+                m_PaymentTimer.start(CPaymentService::ProcessOfflineTimeout);
 
-            // Если платеж не прогрузился, останавливаем его обработку на 15 минут.
-            if (!payment) {
-                toLog(LogLevel::Warning, QString("Suspending bad payment %1.").arg(id));
+                return;
+            }
 
-                m_DBUtils->suspendPayment(id, 15);
-            } else {
-                processPaymentInternal(payment);
+            // Обрабатываем очередь команд.
+            foreach (auto &command, m_Commands) {
+                emit paymentCommandComplete(command.first, command.second(this));
             }
+
+            m_Commands.clear();
         }
     }
 
-    QMutexLocker lock(&m_CommandMutex);
+    if (m_Enabled && (m_Workers->available() > 0)) {
+        QList<SQueuedPayment> payments = m_DBUtils->getPaymentQueue(
+            m_Workers->getSettings().order, CPaymentService::QueueWindow);
 
-    // Обрабатываем очередь команд.
-    foreach (auto &command, m_Commands) {
-        emit paymentCommandComplete(command.first, command.second(this));
+        m_Workers->dispatch(
+            payments,
+            [this](const SQueuedPayment &aPayment) {
+                return m_DBUtils->claimPayment(
+                    aPayment.id, m_InstanceID, CPaymentService::LeaseTimeout);
+            },
+            [this](const SQueuedPayment &aPayment) { processQueuedPayment(aPayment); });
     }
 
-    m_Commands.clear();
-
     m_PaymentTimer.start(CPaymentService::ProcessOfflineTimeout);
 }
 
+//---------------------------------------------------------------------------
+void PaymentService::processQueuedPayment(const SQueuedPayment &aPayment) {
+    if (m_Enabled) {
+        std::shared_ptr<PPSDK::IPayment> payment(getPayment(aPayment.id));
+
+        // Если платеж не прогрузился, останавливаем его обработку на 15 минут.
+        if (!payment) {
+            toLog(LogLevel::Warning, QString("Suspending bad payment %1.").arg(aPayment.id));
+
+            m_DBUtils->suspendPayment(aPayment.id, 15);
+        } else {
+            processPaymentInternal(payment);
+        }
+    }
+
+    m_DBUtils->releasePayment(aPayment.id, m_InstanceID);
+}
+
+//---------------------------------------------------------------------------
+void PaymentService::renewLeases() {
+    QDateTime now = QDateTime::currentDateTime();
+
+    if (m_LastLeaseRenewal.isValid() &&
+        m_LastLeaseRenewal.addSecs(CPaymentService::LeaseRenewInterval) > now) {
+        return;
+    }
+
+    m_LastLeaseRenewal = now;
+
+    foreach (qint64 id, m_Workers->getRunning()) {
+        if (!m_DBUtils->renewPayment(id, m_InstanceID, CPaymentService::LeaseTimeout)) {
+            toLog(LogLevel::Error, QString("Payment %1. Failed to renew the lease.").arg(id));
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+QString PaymentService::getProviderGateway(qint64 aProvider) {
+    PPSDK::SProvider provider = SettingsService::instance(m_Application)
+                                    ->getAdapter<SDK::PaymentProcessor::DealerSettings>()
+                                    ->getProvider(aProvider);
+
+    foreach (const PPSDK::SProvider::SProcessingTraits::SRequest &request,
+             provider.processor.requests) {
+        QString host = QUrl(request.url).host();
+
+        if (!host.isEmpty()) {
+            return host;
+        }
+    }
+
+    return provider.processor.type;
+}
+
 //---------------------------------------------------------------------------
 int PaymentService::registerForcePaymentCommand(const QString &aInitialSession,
                                                 const QVariantMap &aParameters) {
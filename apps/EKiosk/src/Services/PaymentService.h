@@ -6,6 +6,7 @@
 #include <QtCore/QFutureSynchronizer>
 #include <QtCore/QList>
 #include <QtCore/QMutex>
+#include <QtCore/QScopedPointer>
 #include <QtCore/QThread>
 #include <QtCore/QTimer>
 
@@ -19,6 +20,7 @@
 #include <memory>
 
 #include "DatabaseUtils/IPaymentDatabaseUtils.h"
+#include "Services/OfflinePaymentWorkers.h"
 
 namespace PPSDK = SDK::PaymentProcessor;
 
@@ -249,6 +251,15 @@ private:
     /// Проведение платежа
     bool processPaymentInternal(const std::shared_ptr<PPSDK::IPayment> &aPayment);
 
+    /// Проведение арендованного платежа очереди в потоке пула, по окончании аренда снимается.
+    void processQueuedPayment(const SQueuedPayment &aPayment);
+
+    /// Шлюз оператора для ограничения частоты: хост адреса запросов или тип процессинга.
+    QString getProviderGateway(qint64 aProvider);
+
+    /// Продлевает аренду проводимых платежей, чтобы долгий платёж не достался другому экземпляру.
+    void renewLeases();
+
 private:
     IApplication *m_Application;
     volatile bool m_Enabled;
@@ -284,10 +295,18 @@ private:
     /// Дата последней выгрузки устаревших платежей.
     QDateTime m_LastBackupDate;
 
-    /// ID платежа, проходящего в данный момент обработку в оффлайне.
+    /// Платежи, проходящие в данный момент обработку в оффлайне.
     QRecursiveMutex m_OfflinePaymentLock;
-    qint64 m_OfflinePaymentID;
-    std::shared_ptr<PPSDK::IPayment> m_OfflinePayment;
+    QMap<qint64, std::shared_ptr<PPSDK::IPayment>> m_OfflinePayments;
+
+    /// Потоки проведения оффлайн платежей.
+    QScopedPointer<OfflinePaymentWorkers> m_Workers;
+
+    /// Идентификатор экземпляра приложения - владелец аренды платежей.
+    QString m_InstanceID;
+
+    /// Время последнего продления аренды.
+    QDateTime m_LastLeaseRenewal;
 };
 
 //---------------------------------------------------------------------------
@@ -2,13 +2,16 @@
 
 #include "Services/SettingsService.h"
 
+#include <QtCore/QDataStream>
 #include <QtCore/QDir>
 
+#include <Common/ILog.h>
 #include <Common/Version.h>
 
 #include <SDK/PaymentProcessor/Settings/DealerSettings.h>
 #include <SDK/PaymentProcessor/Settings/Directory.h>
 #include <SDK/PaymentProcessor/Settings/ExtensionsSettings.h>
+#include <SDK/PaymentProcessor/Settings/SettingsSnapshot.h>
 #include <SDK/PaymentProcessor/Settings/TerminalSettings.h>
 #include <SDK/PaymentProcessor/Settings/UserSettings.h>
 
@@ -24,6 +27,57 @@
 namespace PPSDK = SDK::PaymentProcessor;
 namespace AdapterNames = PPSDK::CAdapterNames;
 
+//---------------------------------------------------------------------------
+namespace CSettingsService {
+/// Снимки разобранных справочников, пути относительно каталога пользовательских данных.
+const char DealerSnapshot[] = "cache/dealer.snapshot";
+const char DirectorySnapshot[] = "cache/directory.snapshot";
+} // namespace CSettingsService
+
+namespace {
+//---------------------------------------------------------------------------
+/// Открывает снимок, причина отказа пишется в лог.
+bool openSnapshot(PPSDK::SettingsSnapshot &aSnapshot, ILog *aLog) {
+    if (aSnapshot.open()) {
+        aLog->write(LogLevel::Normal,
+                    QString("Using settings snapshot %1.").arg(aSnapshot.getFileName()));
+        return true;
+    }
+
+    aLog->write(LogLevel::Normal,
+                QString("Settings snapshot %1 is not used: %2.")
+                    .arg(aSnapshot.getFileName())
+                    .arg(aSnapshot.getError()));
+
+    return false;
+}
+
+//---------------------------------------------------------------------------
+/// Записывает в снимок данные адаптера, только что загруженного из XML.
+template <class T>
+void writeSnapshot(PPSDK::SettingsSnapshot &aSnapshot, const T &aAdapter, ILog *aLog) {
+    QByteArray data;
+
+    {
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(PPSDK::CSettingsSnapshot::StreamVersion);
+        aAdapter.saveSnapshot(stream);
+    }
+
+    if (aSnapshot.write(data)) {
+        aLog->write(LogLevel::Normal,
+                    QString("Settings snapshot %1 updated, %2 bytes.")
+                        .arg(aSnapshot.getFileName())
+                        .arg(data.size()));
+    } else {
+        aLog->write(LogLevel::Warning,
+                    QString("Failed to write settings snapshot %1: %2.")
+                        .arg(aSnapshot.getFileName())
+                        .arg(aSnapshot.getError()));
+    }
+}
+} // namespace
+
 //---------------------------------------------------------------------------
 SettingsService *SettingsService::instance(IApplication *aApplication) {
     return dynamic_cast<SettingsService *>(
@@ -43,6 +97,47 @@ bool SettingsService::initialize() {
 
     m_SettingsManager->setLog(m_Application->getLog());
 
+    ILog *log = m_Application->getLog();
+    QDir userData(m_Application->getUserDataPath());
+
+    //---------------------------------------------------------------------------
+    // Операторы, комиссии и номерная ёмкость - самые большие конфиги. Пока их файлы не меняются
+    // (в том числе обновлением контента через UpdateRemoteContent), они берутся из двоичных
+    // снимков без разбора XML; изменённый или повреждённый снимок пересобирается после загрузки.
+    QList<SSettingsSource> commissionSources;
+    commissionSources
+        << SSettingsSource("commissions.xml", AdapterNames::DealerAdapter, true)
+        << SSettingsSource("commissions.local.xml", AdapterNames::DealerAdapter, true);
+
+    // Загрузка всех operators.xml
+    QList<SSettingsSource> operatorSources;
+    foreach (auto file,
+             userData.entryInfoList(QStringList() << "operators*.xml", QDir::Files, QDir::Name)) {
+        // Вставляем в property_tree как ссылку на файл
+        operatorSources << SSettingsSource(
+            file.filePath(), AdapterNames::DealerAdapter, "operators");
+    }
+
+    QList<SSettingsSource> directorySources;
+    directorySources << SSettingsSource("numcapacity.xml", AdapterNames::Directory, true);
+
+    QStringList dealerFiles;
+    foreach (const SSettingsSource &source, commissionSources + operatorSources) {
+        dealerFiles << userData.absoluteFilePath(source.configFileName);
+    }
+
+    // Снимок другой сборки не читается: формат данных задают адаптеры этой сборки.
+    PPSDK::SettingsSnapshot dealerSnapshot(
+        userData.absoluteFilePath(CSettingsService::DealerSnapshot), dealerFiles,
+        Humo::getVersion());
+    PPSDK::SettingsSnapshot directorySnapshot(
+        userData.absoluteFilePath(CSettingsService::DirectorySnapshot),
+        QStringList() << userData.absoluteFilePath(directorySources.first().configFileName),
+        Humo::getVersion());
+
+    bool dealerCached = openSnapshot(dealerSnapshot, log);
+    bool directoryCached = openSnapshot(directorySnapshot, log);
+
     //---------------------------------------------------------------------------
     // Регистрируем все конфиги.
     // ВАЖНО: Порядок файлов определяет приоритет настроек.
@@ -58,34 +153,33 @@ bool SettingsService::initialize() {
                                        true)
                     << SSettingsSource("terminal.ini", AdapterNames::TerminalAdapter, false)
                     << SSettingsSource("keys.xml", AdapterNames::TerminalAdapter, false)
-                    << SSettingsSource("config.xml", AdapterNames::TerminalAdapter, true)
+                    << SSettingsSource("config.xml", AdapterNames::TerminalAdapter, true);
 
-                    << SSettingsSource("commissions.xml", AdapterNames::DealerAdapter, true)
-                    << SSettingsSource("commissions.local.xml", AdapterNames::DealerAdapter, true)
+    if (!dealerCached) {
+        settingsSources << commissionSources;
+    }
 
-                    << SSettingsSource("config.xml", AdapterNames::DealerAdapter, true)
+    settingsSources << SSettingsSource("config.xml", AdapterNames::DealerAdapter, true)
                     << SSettingsSource("customers.xml", AdapterNames::DealerAdapter, true)
                     << SSettingsSource("groups.xml", AdapterNames::DealerAdapter, true)
 
                     // user.ini должен идти после system.ini, чтобы пользовательские настройки могли
                     // переопределять системные.
-                    << SSettingsSource("user.ini", AdapterNames::UserAdapter, true)
+                    << SSettingsSource("user.ini", AdapterNames::UserAdapter, true);
 
-                    << SSettingsSource("numcapacity.xml", AdapterNames::Directory, true)
-                    << SSettingsSource(IApplication::getWorkingDirectory() + "/data/directory.xml",
+    if (!directoryCached) {
+        settingsSources << directorySources;
+    }
+
+    settingsSources << SSettingsSource(IApplication::getWorkingDirectory() + "/data/directory.xml",
                                        AdapterNames::Directory,
                                        true)
                     << SSettingsSource("config.xml", AdapterNames::Extensions, true)
                     /* Временный конфиг #38560 */
                     << SSettingsSource("extensions.xml", AdapterNames::Extensions, true);
 
-    // Загрузка всех operators.xml
-    foreach (auto file,
-             QDir(m_Application->getUserDataPath())
-                 .entryInfoList(QStringList() << "operators*.xml", QDir::Files, QDir::Name)) {
-        // Вставляем в property_tree как ссылку на файл
-        settingsSources << SSettingsSource(
-            file.filePath(), AdapterNames::DealerAdapter, "operators");
+    if (!dealerCached) {
+        settingsSources << operatorSources;
     }
 
     // Загружаем настройки.
@@ -114,10 +208,52 @@ bool SettingsService::initialize() {
     auto *dealerSettings =
         new SDK::PaymentProcessor::DealerSettings(m_SettingsManager->getProperties());
     dealerSettings->setLog(m_Application->getLog());
+
+    auto *directory = new SDK::PaymentProcessor::Directory(m_SettingsManager->getProperties(),
+                                                            m_Application->getLog());
+
+    // Снимок, который не удалось прочитать, заменяется загрузкой пропущенных конфигов. Они
+    // загружаются одним списком в том же порядке, что и без снимков.
+    bool dealerFailed = dealerCached && !dealerSettings->loadSnapshot(dealerSnapshot.data());
+    bool directoryFailed = directoryCached && !directory->loadSnapshot(directorySnapshot.data());
+
+    dealerSnapshot.close();
+    directorySnapshot.close();
+
+    if (dealerFailed || directoryFailed) {
+        QList<SSettingsSource> missingSources;
+
+        if (dealerFailed) {
+            missingSources << commissionSources;
+        }
+
+        if (directoryFailed) {
+            missingSources << directorySources;
+        }
+
+        if (dealerFailed) {
+            missingSources << operatorSources;
+        }
+
+        m_SettingsManager->loadSettings(missingSources);
+    }
+
     dealerSettings->initialize();
 
-    auto *directory = new SDK::PaymentProcessor::Directory(m_SettingsManager->getProperties());
-    directory->setLog(m_Application->getLog());
+    if (!dealerCached || dealerFailed) {
+        writeSnapshot(dealerSnapshot, *dealerSettings, log);
+    }
+
+    // Ёмкость разбирается в конструкторе справочника, поэтому он создаётся заново.
+    if (directoryFailed) {
+        delete directory;
+        directory = new SDK::PaymentProcessor::Directory(m_SettingsManager->getProperties(),
+                                                         m_Application->getLog());
+    }
+
+    if (!directoryCached || directoryFailed) {
+        writeSnapshot(directorySnapshot, *directory, log);
+    }
 
     auto *extensionsSettings =
         new SDK::PaymentProcessor::ExtensionsSettings(m_SettingsManager->getProperties());
@@ -35,6 +35,7 @@ const char NoRestart[] = "no-restart";
 const char DestinationSubdirs[] = "destination-subdir";
 const char AcceptKeys[] = "accept-keys";
 const char WithoutBITS[] = "no-bits";
+const char Paranoid[] = "paranoid";
 } // namespace Opt
 
 namespace Command {
@@ -186,6 +187,9 @@ void UpdaterApp::run() {
     // подпапка, в которую распаковываем архив
     QString subdir = getArgument(Opt::DestinationSubdirs);
     bool woBITS = getArgument(Opt::WithoutBITS).compare("true", Qt::CaseInsensitive) == 0;
+    // Пересчёт контрольных сумм рабочего каталога без кеша
+    bool paranoid = getArgument(Opt::Paranoid).compare("true", Qt::CaseInsensitive) == 0 ||
+                    settings.value("hash/paranoid", false).toBool();
 
     // Отключение BITS через updater.ini
     Q_UNUSED(woBITS);
@@ -243,6 +247,18 @@ void UpdaterApp::run() {
 #ifdef Q_OS_WIN32
     m_Updater->useBITS(!woBITS, settings.value("bits/priority", CBITS::HIGH).toInt());
 #endif
+    m_Updater->setDownloadConcurrency(
+        settings.value("download/threads", CDownloadScheduler::MaxTasks).toInt(),
+        settings.value("download/threads_per_host", CDownloadScheduler::MaxTasksPerHost).toInt());
+    m_Updater->setDownloadOrder(settings.value("download/order").toString() == "manifest"
+                                    ? DownloadScheduler::ManifestOrder
+                                    : DownloadScheduler::SmallFirst);
+    m_Updater->setSegmentedDownload(
+        settings.value("download/segment_threshold", CDownloadScheduler::SegmentThreshold)
+            .toLongLong(),
+        settings.value("download/segments", CDownloadScheduler::Segments).toInt());
+    m_Updater->setParanoidHashing(paranoid);
+    m_Updater->setDownloadBandwidth(settings.value("download/bandwidth", 0).toLongLong());
     connect(m_Updater, SIGNAL(progress(int)), &m_ReportBuilder, SLOT(setProgress(int)));
 
     // Создаем файл отчета.
@@ -17,6 +17,7 @@
 
 #include <SysUtils/ISysUtils.h>
 #include <WatchServiceClient/Constants.h>
+#include <WatchServiceClient/Protocol.h>
 #include <algorithm>
 #include <boost/optional.hpp>
 
@@ -398,23 +399,31 @@ void WatchService::checkAutoStartModules() {
 
 //----------------------------------------------------------------------------
 void WatchService::messageReceived(const QByteArray &aMessage) {
-    QStringList paramList = QString::fromUtf8(aMessage.data(), aMessage.size()).split(";");
-    if (!paramList.isEmpty()) {
-        QString sender;
-        QString type;
-        QString params;
-        QString module;
-
-        foreach (QString param, paramList) {
-            if (param.indexOf(CWatchService::Fields::Sender) != -1) {
-                sender = param.right(param.length() - param.indexOf("=") - 1);
-            } else if (param.indexOf(CWatchService::Fields::Type) != -1) {
-                type = param.right(param.length() - param.indexOf("=") - 1);
-            } else if (param.indexOf(CWatchService::Fields::Params) != -1) {
-                params = param.right(param.length() - param.indexOf("=") - 1);
-            } else if (param.indexOf(CWatchService::Fields::Module) != -1) {
-                module = param.right(param.length() - param.indexOf("=") - 1);
-            }
+    SWatchServiceMessage message;
+
+    if (WatchServiceProtocol::decode(aMessage, message)) {
+        const QString &sender = message.sender;
+        const QString &type = message.type;
+        const QString &params = message.params;
+        const QString &module = message.module;
+
+        // Сообщение более новой версии схемы: команды не выполняем, но модуль жив.
+        if (message.unknownType != 0) {
+            toLog(LogLevel::Debug,
+                  QString("Skipping message of unknown type %1 from %2.")
+                      .arg(message.unknownType)
+                      .arg(sender));
+        }
+
+        // Клиент понимает двоичный протокол: подтверждаем, дальше он пишет в двоичном виде.
+        if ((message.protocol > 0) && !sender.isEmpty() && m_Server) {
+            SWatchServiceMessage answer;
+            answer.sender = CWatchService::Name;
+            answer.target = sender;
+            answer.type = CWatchService::Commands::Protocol;
+            answer.params = QString::number(CWatchServiceProtocol::Version);
+
+            m_Server->sendMessage(WatchServiceProtocol::encode(answer, WatchServiceProtocol::Text));
         }
 
         // Запуск модуля
@@ -582,6 +591,10 @@ void WatchService::messageReceived(const QByteArray &aMessage) {
             it.value().lastAnswer = aMessage;
             it.value().touch();
         }
+    } else {
+        toLog(LogLevel::Warning,
+              QString("Malformed binary message (%1 bytes) has been ignored.")
+                  .arg(aMessage.size()));
     }
 }
 
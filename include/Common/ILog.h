@@ -32,9 +32,16 @@ public:
     /// Переоткрыть все файлы логов
     static void logRotateAll();
 
-    /// Установить уровень логирования для всех логов
+    /// Установить уровень логирования для всех логов, кроме логов с персональным уровнем.
     static void setGlobalLevel(LogLevel::Enum aMaxLogLevel);
 
+    /// Установить персональный уровень логирования для логов с именем aName. Действует сразу,
+    /// в том числе на уже созданные логи, и имеет приоритет над глобальным уровнем.
+    static void setLevelOverride(const QString &aName, LogLevel::Enum aLevel);
+
+    /// Снять персональный уровень логирования, вернув логи с именем aName к глобальному.
+    static void clearLevelOverride(const QString &aName);
+
     /// Возвращает имя экземпляра лога.
     virtual const QString &getName() const = 0;
 
@@ -51,6 +58,10 @@ public:
     /// игнорируется.
     virtual void setLevel(LogLevel::Enum aLevel) = 0;
 
+    /// Возвращает true, если сообщение уровня aLevel будет записано. Должна быть дешёвой:
+    /// вызывается макросами LOG* до формирования текста сообщения.
+    virtual bool isEnabled(LogLevel::Enum aLevel) const = 0;
+
     /// Устанавливает уровень отступа для древовидных логов.
     virtual void adjustPadding(int aStep) = 0;
 
@@ -67,13 +78,18 @@ protected:
     virtual ~ILog() {}
 };
 
+//---------------------------------------------------------------------------
+// Макросы записи проверяют уровень лога до вычисления message, поэтому отфильтрованное
+// сообщение (arg(), toHex() и т.п.) не форматируется и стоит одного ветвления.
+
 //---------------------------------------------------------------------------
 // Запись в лог с проверкой указателя на лог.
 #define LOG(log, level, message)                                                                   \
     {                                                                                              \
-        if (log != 0)                                                                              \
-            log->write(level, message);                                                            \
-        else                                                                                       \
+        if (log != 0) {                                                                            \
+            if (log->isEnabled(level))                                                             \
+                log->write(level, message);                                                        \
+        } else                                                                                     \
             qCritical("Log pointer is empty. Message:%s.", qPrintable(message));                   \
     }
 
@@ -81,9 +97,10 @@ protected:
 // Запись в лог с именем функции и проверкой указателя на лог.
 #define LOGF(log, level, message)                                                                  \
     {                                                                                              \
-        if (log != 0)                                                                              \
-            log->write(level, message + QString(" (%1)").arg(Q_FUNC_INFO));                        \
-        else                                                                                       \
+        if (log != 0) {                                                                            \
+            if (log->isEnabled(level))                                                             \
+                log->write(level, message + QString(" (%1)").arg(Q_FUNC_INFO));                    \
+        } else                                                                                     \
             qCritical("Log pointer is empty. Message:%s.", qPrintable(message));                   \
     }
 
@@ -91,10 +108,20 @@ protected:
 // Запись в лог с именем функции и проверкой указателя на лог.
 #define LOGB(log, level, message, binaryData)                                                      \
     {                                                                                              \
-        if (log != 0)                                                                              \
-            log->write(level, message, binaryData);                                                \
-        else                                                                                       \
+        if (log != 0) {                                                                            \
+            if (log->isEnabled(level))                                                             \
+                log->write(level, message, binaryData);                                            \
+        } else                                                                                     \
             qCritical("Log pointer is empty. Message:%s.", qPrintable(message));                   \
     }
 
 //---------------------------------------------------------------------------
+// Запись через toLog() объекта с методом isLogEnabled() (ILogable, DeviceLogManager).
+// Сообщение формируется, только если уровень включён.
+#define TO_LOG(level, message)                                                                     \
+    {                                                                                              \
+        if (this->isLogEnabled(level))                                                             \
+            this->toLog(level, message);                                                           \
+    }
+
+//---------------------------------------------------------------------------
@@ -27,6 +27,12 @@ protected:
         }
     }
 
+    /// Возвращает true, если сообщение уровня aLevel попадёт в лог. Без лога возвращает true,
+    /// чтобы toLog() сообщил о пустом указателе.
+    inline bool isLogEnabled(LogLevel::Enum aLevel) const {
+        return !m_Log || m_Log->isEnabled(aLevel);
+    }
+
     inline ILog *getLog() const { return m_Log; }
 
 private:
@@ -6,8 +6,10 @@
 #include <QtCore/QMap>
 #include <QtCore/QMutex>
 #include <QtCore/QPair>
+#include <QtCore/QReadWriteLock>
 #include <QtCore/QRecursiveMutex>
 #include <QtCore/QSet>
+#include <QtCore/QSharedPointer>
 
 #include <Crypt/ICryptEngine.h>
 #include <libipriv/libipriv.h>
@@ -16,8 +18,25 @@
 /// Пара ключей: закрытый, открытый
 typedef QPair<IPRIV_KEY, IPRIV_KEY> TKeyPair;
 
+/// Загруженная пара ключей. Закрытый и открытый ключи защищены каждый своим мьютексом: операции
+/// с разными парами, а также подпись и проверка подписи одной парой выполняются параллельно.
+/// Ключи аппаратного токена дополнительно захватывают мьютекс движка, т.к. сессия токена общая.
+struct SKeyPairContext {
+    SKeyPairContext() : engineMutex(nullptr), released(false) {}
+
+    TKeyPair keys;
+    QRecursiveMutex *engineMutex;
+    QMutex secretMutex;
+    QMutex publicMutex;
+
+    /// Пара выгружена, ключи закрыты. Меняется под обоими мьютексами ключей.
+    bool released;
+};
+
+typedef QSharedPointer<SKeyPairContext> TKeyPairContext;
+
 /// Номер пары ключей + ключи
-typedef QMap<int, TKeyPair> TKeyPairList;
+typedef QMap<int, TKeyPairContext> TKeyPairList;
 
 //---------------------------------------------------------------------------
 /// Реализация криптодвижка, основанная на библиотеке libipriv.
@@ -115,6 +134,13 @@ public:
                             QByteArray &aSignature,
                             QString &aErrorDescription);
 
+    /// Подписывает запросы aRequests парой ключей aKeyPair, подписи в том же порядке складывает
+    /// в aSignatures. Ключ захватывается один раз на весь пакет.
+    virtual bool signBatch(int aKeyPair,
+                           const QList<QByteArray> &aRequests,
+                           QList<QByteArray> &aSignatures,
+                           QString &aErrorDescription);
+
     /// Функции проверки ЭЦП
 
     /// Проверяет подпись в строке aResponseString парой ключей aKeyPair, оригинальное сообщение
@@ -130,6 +156,13 @@ public:
                               const QByteArray &aSignature,
                               QString &aErrorDescription);
 
+    /// Проверяет подписи ответов aResponses парой ключей aKeyPair, оригинальные сообщения в том
+    /// же порядке складывает в aOriginalResponses. Ключ захватывается один раз на весь пакет.
+    virtual bool verifyBatch(int aKeyPair,
+                             const QList<QByteArray> &aResponses,
+                             QList<QByteArray> &aOriginalResponses,
+                             QString &aErrorDescription);
+
     /// Функции шифрования данных
 
     /// Шифрует aData и складывает результат в aResult. Используется пара ключей aKeyPair, тип ключа
@@ -202,12 +235,21 @@ private:
     /// Возвращает описание ошибки библиотеки libipriv.
     QString errorToString(int aError) const;
 
+    /// Возвращает загруженную пару ключей, пустой указатель - пары нет.
+    TKeyPairContext findKeyPair(int aKeyPair) const;
+
+    /// Помещает пару ключей под номером aKeyPair, прежняя пара выгружается.
+    void insertKeyPair(int aKeyPair, const TKeyPair &aKeys, CCrypt::ETypeEngine aEngine);
+
 private:
     bool m_Initialized;
     CCrypt::ETypeEngine m_Engine;
 
+    /// Сериализует управление ключами и токеном. Криптооперации его не захватывают.
     QRecursiveMutex m_Mutex;
 
+    /// Защищает только словарь пар, операции с ключами идут под мьютексами самих пар.
+    mutable QReadWriteLock m_KeyPairsLock;
     TKeyPairList m_KeyPairs;
 };
 
@@ -118,6 +118,13 @@ public:
                             QByteArray &aSignature,
                             QString &aErrorDescription) = 0;
 
+    /// Подписывает запросы aRequests парой ключей aKeyPair, подписи в том же порядке складывает
+    /// в aSignatures. При первой ошибке возвращает false, в aErrorDescription - номер запроса.
+    virtual bool signBatch(int aKeyPair,
+                           const QList<QByteArray> &aRequests,
+                           QList<QByteArray> &aSignatures,
+                           QString &aErrorDescription) = 0;
+
     /// Функции проверки ЭЦП
 
     /// Проверяет подпись в строке aResponseString парой ключей aKeyPair, оригинальное сообщение
@@ -133,6 +140,14 @@ public:
                               const QByteArray &aSignature,
                               QString &aErrorDescription) = 0;
 
+    /// Проверяет подписи ответов aResponses парой ключей aKeyPair, оригинальные сообщения в том
+    /// же порядке складывает в aOriginalResponses. При первой ошибке возвращает false, в
+    /// aErrorDescription - номер ответа.
+    virtual bool verifyBatch(int aKeyPair,
+                             const QList<QByteArray> &aResponses,
+                             QList<QByteArray> &aOriginalResponses,
+                             QString &aErrorDescription) = 0;
+
     /// Функции шифрования данных
 
     /// Шифрует aData и складывает результат в aResult. Используется пара ключей aKeyPair, тип ключа
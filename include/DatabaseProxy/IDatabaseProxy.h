@@ -17,8 +17,37 @@ const QString DateFormat = "yyyy-MM-dd hh:mm:ss.zzz";
 const QString PaymentDateFormat = "yyyy-MM-dd hh:mm:ss";
 const QString ShortDateFormat = "yyyy-MM-dd 00:00:00";
 const QString LogName = "DatabaseProxy";
+
+/// Профиль производительности по умолчанию.
+const QString DefaultJournalMode = "WAL";
+const QString DefaultSynchronous = "FULL";
+const int DefaultCacheSize = -8192; // КиБ
+const qint64 DefaultMmapSize = 0;
+const QString DefaultTempStore = "MEMORY";
+const int DefaultStatementCacheSize = 64;
+const int DefaultReadConnections = 0;
 } // namespace CIDatabaseProxy
 
+//---------------------------------------------------------------------------
+/// Профиль производительности соединения. Прагмы применимы только к SQLite.
+struct SDatabasePerformance {
+    QString journalMode;    /// PRAGMA journal_mode: DELETE, TRUNCATE, PERSIST, MEMORY, WAL, OFF.
+    QString synchronous;    /// PRAGMA synchronous: OFF, NORMAL, FULL, EXTRA.
+    int cacheSize;          /// PRAGMA cache_size: > 0 - в страницах, < 0 - в КиБ.
+    qint64 mmapSize;        /// PRAGMA mmap_size, байт. 0 - не отображать файл в память.
+    QString tempStore;      /// PRAGMA temp_store: DEFAULT, FILE, MEMORY.
+    int statementCacheSize; /// Число подготовленных запросов в LRU кэше. 0 - кэш отключён.
+    int readConnections;    /// Соединений только для чтения (WAL). 0 - всё через одно соединение.
+
+    SDatabasePerformance()
+        : journalMode(CIDatabaseProxy::DefaultJournalMode),
+          synchronous(CIDatabaseProxy::DefaultSynchronous),
+          cacheSize(CIDatabaseProxy::DefaultCacheSize), mmapSize(CIDatabaseProxy::DefaultMmapSize),
+          tempStore(CIDatabaseProxy::DefaultTempStore),
+          statementCacheSize(CIDatabaseProxy::DefaultStatementCacheSize),
+          readConnections(CIDatabaseProxy::DefaultReadConnections) {}
+};
+
 //---------------------------------------------------------------------------
 class IDatabaseQueryChecker {
 public:
@@ -41,6 +70,10 @@ public:
     /// Установить интерфейс контроля над ошибками БД
     virtual void setQueryChecker(IDatabaseQueryChecker *aQueryChecker) = 0;
 
+    /// Устанавливает профиль производительности. Применяется при открытии БД, а если
+    /// соединение уже открыто - сразу.
+    virtual void setPerformance(const SDatabasePerformance &aPerformance) = 0;
+
     /// Открытие соединения с БД.
     virtual bool open(const QString &aDatabaseName = CIDatabaseProxy::DefaultDatabase,
                       const QString &aUser = CIDatabaseProxy::DefaultUser,
@@ -63,6 +96,15 @@ public:
     /// Создает и подготавливает экземпляр запроса к БД.
     virtual IDatabaseQuery *createQuery(const QString &aQueryString) = 0;
 
+    /// Создает и подготавливает запрос только на чтение. Если за текущим потоком закреплено
+    /// соединение чтения, запрос выполняется на нём и видит только зафиксированные данные.
+    virtual IDatabaseQuery *createReadQuery(const QString &aQueryString) = 0;
+
+    /// Закрепляет за текущим потоком отдельное соединение для чтения. Возвращает false, если его
+    /// нет (пул выключен или занят, поток ведёт транзакцию): тогда запросы чтения идут через
+    /// основное соединение и требуют той же синхронизации, что и запись.
+    virtual bool acquireReadConnection() = 0;
+
     /// Выполнение DML запроса. Помещает в rowsAffected количество затронутых
     /// строк.
     virtual bool execDML(const QString &aQuery, long &aRowsAffected) = 0;
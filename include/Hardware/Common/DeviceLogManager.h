@@ -19,6 +19,9 @@ public:
         }
     }
 
+    /// Проверить, попадёт ли сообщение уровня aLevel в лог.
+    bool isLogEnabled(LogLevel::Enum aLevel) const { return !m_Log || m_Log->isEnabled(aLevel); }
+
     /// Установить лог.
     void setLog(ILog *aLog) { m_Log = aLog; }
 
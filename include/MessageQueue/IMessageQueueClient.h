@@ -45,6 +45,10 @@ public:
     /// Послать сообщение серверу.
     virtual void sendMessage(const QByteArray &aMessage) = 0;
 
+    /// Послать сообщение серверу кадром с длиной. Сообщение может содержать '\0',
+    /// сервер должен поддерживать такие кадры.
+    virtual void sendBinaryMessage(const QByteArray &aMessage) = 0;
+
     /// Подписаться на получение сообщения. aObject должен иметь
     /// слот onMessageReceived(QByteArray aMessage).
     virtual bool subscribeOnMessageReceived(QObject *aObject) = 0;
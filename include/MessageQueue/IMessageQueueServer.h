@@ -25,6 +25,10 @@ public:
     /// Послать сообщение всем подключенным клиентам.
     virtual void sendMessage(const QByteArray &aMessage) = 0;
 
+    /// Послать сообщение всем подключенным клиентам кадром с длиной. Сообщение может
+    /// содержать '\0', клиенты должны поддерживать такие кадры.
+    virtual void sendBinaryMessage(const QByteArray &aMessage) = 0;
+
     /// Подписаться на получение сообщения. aObject должен иметь
     /// слот onMessageReceived(QByteArray aMessage).
     virtual bool subscribeOnMessageReceived(QObject *aObject) = 0;
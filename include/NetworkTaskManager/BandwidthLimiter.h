@@ -0,0 +1,79 @@
+/* @file Ограничение скорости чтения сетевых ответов по классам трафика. */
+
+#pragma once
+
+#include <QtCore/QtGlobal>
+
+#include <functional>
+
+//------------------------------------------------------------------------
+namespace CBandwidthLimiter {
+/// Число классов трафика. Меньший номер класса - больший приоритет.
+const int ClassCount = 3;
+
+/// Объём токенов, накапливаемых в простое, в миллисекундах работы на полной скорости.
+const qint64 BurstInterval = 200;
+
+/// Минимальный объём корзины, байт.
+const qint64 MinBurst = 4 * 1024;
+
+/// Доля общей корзины, которую не могут выбрать классы с низким приоритетом, пока есть
+/// активные запросы с более высоким приоритетом, в процентах.
+const int PriorityReserve = 50;
+} // namespace CBandwidthLimiter
+
+//------------------------------------------------------------------------
+/// Набор корзин токенов: по одной на класс трафика и общая на канал. Скорость задаётся в байтах
+/// в секунду, 0 - без ограничения. Время берётся из aClock (мс), что позволяет тестировать
+/// ограничитель на модельных часах. Класс не потокобезопасен.
+class BandwidthLimiter {
+public:
+    typedef std::function<qint64()> TClock;
+
+    explicit BandwidthLimiter(TClock aClock = TClock());
+
+    /// Устанавливает ограничение класса aClass.
+    void setLimit(int aClass, qint64 aBytesPerSecond);
+    qint64 getLimit(int aClass) const;
+
+    /// Устанавливает общее ограничение канала.
+    void setTotalLimit(qint64 aBytesPerSecond);
+    qint64 getTotalLimit() const;
+
+    /// Учёт запросов класса, ожидающих данные. Пока у класса есть активные запросы, классы
+    /// с меньшим приоритетом оставляют ему часть общей корзины.
+    void setActive(int aClass, bool aActive);
+
+    /// Есть ли ограничения для класса aClass.
+    bool isLimited(int aClass) const;
+
+    /// Выделяет классу aClass до aWanted байт и возвращает выделенный объём.
+    qint64 acquire(int aClass, qint64 aWanted);
+
+private:
+    /// Корзина токенов.
+    struct SBucket {
+        qint64 rate;
+        qint64 tokens;
+        qint64 fraction; // тысячные доли байта, накопленные при пополнении
+
+        SBucket() : rate(0), tokens(0), fraction(0) {}
+
+        qint64 capacity() const;
+        void setRate(qint64 aRate);
+        void refill(qint64 aElapsed);
+    };
+
+    /// Пополняет корзины на время, прошедшее с последнего вызова.
+    void refill();
+
+private:
+    TClock m_Clock;
+    qint64 m_LastTime;
+
+    SBucket m_Total;
+    SBucket m_Classes[CBandwidthLimiter::ClassCount];
+    int m_Active[CBandwidthLimiter::ClassCount];
+};
+
+//------------------------------------------------------------------------
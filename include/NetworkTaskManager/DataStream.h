@@ -20,8 +20,17 @@ public:
     virtual QByteArray takeAll();
     virtual QByteArray readAll();
 
+    /// Читает до aMaxSize байт с позиции aOffset, не меняя позицию записи.
+    virtual QByteArray read(qint64 aOffset, qint64 aMaxSize);
+
     virtual qint64 size() const;
 
+    /// Позиция, с которой будет записан следующий блок.
+    virtual qint64 pos() const;
+
+    /// Сбрасывает накопленные данные в устройство.
+    virtual bool flush();
+
     virtual void close();
 
 protected:
@@ -2,20 +2,45 @@
 
 #pragma once
 
+#include <QtCore/QByteArray>
+
 #include "DataStream.h"
 
-class QByteArray;
 class QString;
 
+//------------------------------------------------------------------------
+namespace CFileDataStream {
+/// Объём данных, накапливаемых в памяти до записи в файл.
+const qint64 FlushThreshold = 1024 * 1024;
+} // namespace CFileDataStream
+
 //------------------------------------------------------------------------
 class FileDataStream : public DataStream {
 public:
     FileDataStream(const QString &aPath);
+    virtual ~FileDataStream();
+
+    /// Данные пишутся в файл, когда в буфере набирается aBytes байт, при перемещении по файлу,
+    /// чтении и закрытии. 0 - запись при каждом вызове write().
+    void setFlushThreshold(qint64 aBytes);
 
     virtual bool clear();
+    virtual bool seek(qint64 aOffset);
     virtual bool write(const QByteArray &aData);
 
+    virtual QByteArray takeAll();
+    virtual QByteArray readAll();
+    virtual QByteArray read(qint64 aOffset, qint64 aMaxSize);
+
     virtual qint64 size() const;
+    virtual qint64 pos() const;
+
+    virtual bool flush();
+    virtual void close();
+
+private:
+    QByteArray m_Buffer;
+    qint64 m_FlushThreshold;
 };
 
 //------------------------------------------------------------------------
@@ -3,6 +3,7 @@
 #pragma once
 
 #include <QtCore/QByteArray>
+#include <QtCore/QCryptographicHash>
 #include <QtCore/QString>
 
 #include "IVerifier.h"
@@ -13,40 +14,43 @@ const int MD5HashSize = 32;
 const int Sha256HashSize = 64;
 } // namespace CHashVerifier
 
-class IHashVerifier : public IVerifier {
+class IHashVerifier : public IStreamVerifier {
 public:
     virtual QString referenceHash() const = 0;
     virtual QString calculatedHash() const = 0;
 };
 
 //------------------------------------------------------------------------
-class Md5Verifier : public IHashVerifier {
+/// Проверка контрольной суммы, считаемой по мере получения данных.
+class HashVerifier : public IHashVerifier {
 public:
-    explicit Md5Verifier(QString aMD5);
+    HashVerifier(QCryptographicHash::Algorithm aAlgorithm, QString aHash);
 
     virtual bool verify(NetworkTask *aTask, const QByteArray &aData) override;
 
-    QString referenceHash() const override { return m_MD5; }
-    QString calculatedHash() const override { return m_CalculatedMD5; }
+    virtual void reset() override;
+    virtual void update(const QByteArray &aData) override;
+    virtual bool finish(NetworkTask *aTask) override;
+
+    QString referenceHash() const override { return m_Hash; }
+    QString calculatedHash() const override { return m_CalculatedHash; }
 
 private:
-    QString m_MD5;
-    QString m_CalculatedMD5;
+    QCryptographicHash m_Context;
+    QString m_Hash;
+    QString m_CalculatedHash;
 };
 
 //------------------------------------------------------------------------
-class Sha256Verifier : public IHashVerifier {
+class Md5Verifier : public HashVerifier {
 public:
-    explicit Sha256Verifier(QString aSha256);
-
-    virtual bool verify(NetworkTask *aTask, const QByteArray &aData) override;
-
-    QString referenceHash() const override { return m_Sha256; }
-    QString calculatedHash() const override { return m_CalculatedSha256; }
+    explicit Md5Verifier(QString aMD5);
+};
 
-private:
-    QString m_Sha256;
-    QString m_CalculatedSha256;
+//------------------------------------------------------------------------
+class Sha256Verifier : public HashVerifier {
+public:
+    explicit Sha256Verifier(QString aSha256);
 };
 
 //------------------------------------------------------------------------
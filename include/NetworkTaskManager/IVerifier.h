@@ -14,3 +14,18 @@ public:
 };
 
 //------------------------------------------------------------------------
+/// Верификатор, который обрабатывает данные по мере их получения. Задача передаёт ему каждый
+/// записанный в поток блок, поэтому к концу загрузки результат уже посчитан.
+class IStreamVerifier : public IVerifier {
+public:
+    /// Начинает расчёт заново.
+    virtual void reset() = 0;
+
+    /// Добавляет очередной блок данных.
+    virtual void update(const QByteArray &aData) = 0;
+
+    /// Проверяет данные, переданные после reset().
+    virtual bool finish(NetworkTask *aTask) = 0;
+};
+
+//------------------------------------------------------------------------
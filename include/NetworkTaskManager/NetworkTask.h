@@ -3,6 +3,7 @@
 #pragma once
 
 #include <QtCore/QDateTime>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QMap>
 #include <QtCore/QMutex>
 #include <QtCore/QSharedPointer>
@@ -12,9 +13,16 @@
 #include <QtCore/QWaitCondition>
 
 class IVerifier;
+class IStreamVerifier;
 class DataStream;
 class NetworkTaskManager;
 
+//------------------------------------------------------------------------
+namespace CNetworkTask {
+/// Размер блока чтения потока при пересчёте суммы ранее скачанных данных.
+const qint64 VerifyBlockSize = 256 * 1024;
+} // namespace CNetworkTask
+
 //------------------------------------------------------------------------
 class NetworkTask : public QObject {
     Q_OBJECT
@@ -53,6 +61,34 @@ public:
     /// Тип сетевого запроса.
     enum Type { Head = 0, Get, Post, Put };
 
+    /// Класс трафика. Определяет ограничение скорости и приоритет при чтении ответа.
+    enum TrafficClass {
+        Interactive = 0, /// Запросы, которых ждёт пользователь (платежи).
+        Monitoring,      /// Проверка связи, мониторинг, статистика.
+        Bulk             /// Фоновая загрузка контента и обновлений.
+    };
+
+    /// Состояние задачи.
+    enum State {
+        Created = 0, /// Задача создана и ещё не запускалась.
+        Queued,      /// Задача передана менеджеру и ждёт отправки запроса.
+        Running,     /// Запрос отправлен.
+        Finished     /// Задача завершена (успешно, с ошибкой или удалена).
+    };
+
+    /// Длительности этапов выполнения запроса, мс. -1 - этап не пройден или его время
+    /// недоступно (разрешение имени и соединение отмечаются начиная с Qt 6.3).
+    struct STimings {
+        qint64 queue;     /// От addTask до отправки запроса менеджером.
+        qint64 dns;       /// От отправки до начала соединения: разрешение имени или ожидание
+                          /// свободного соединения.
+        qint64 connect;   /// От начала соединения до отправки запроса в сокет.
+        qint64 firstByte; /// От отправки запроса до получения заголовков ответа.
+        qint64 total;     /// От addTask до завершения задачи.
+
+        STimings() : queue(-1), dns(-1), connect(-1), firstByte(-1), total(-1) {}
+    };
+
     NetworkTask();
     virtual ~NetworkTask();
 
@@ -70,6 +106,9 @@ public:
     void setFlags(Flags aFlags);
     Flags getFlags() const;
 
+    void setTrafficClass(TrafficClass aClass);
+    TrafficClass getTrafficClass() const;
+
     /// Возвращает код ошибки.
     int getError() const;
     /// Возвращает текстовое описание ошибки.
@@ -77,6 +116,11 @@ public:
 
     int getHttpError() const;
 
+    State getState() const;
+
+    /// Времена этапов последнего выполнения. Полностью заполнены после завершения задачи.
+    STimings getTimings() const;
+
     void setTag(const QVariant &aTag);
     const QVariant &getTag() const;
 
@@ -112,30 +156,47 @@ signals:
     /// aTotal - кол-во байт.
     void onProgress(qint64 aCurrent, qint64 aTotal);
 
-private slots:
-    void onTimeout();
-
 protected:
     void setSize(qint64 aCurrent, qint64 aTotal);
     void setError(int aError, const QString &aMessage = "");
     void setHttpError(int aError);
     void setProcessing(NetworkTaskManager *aManager, bool aProcessing);
 
-    /// Перезапустить таймер завершения таска по таймауту
-    void resetTimer();
+    /// Отметки этапов выполнения запроса, выполняются в нити менеджера.
+    void markStarted();
+    void markConnecting();
+    void markRequestSent();
+    void markFirstByte();
 
     /// Сбросить ошибки предыдущей попытки скачивания
     void clearErrors();
 
+    /// Начинает потоковую проверку с текущей позиции записи. Данные, уже лежащие в потоке
+    /// до этой позиции (докачка), передаются верификатору заново.
+    void startVerification();
+
+    /// Записывает полученные данные в поток и передаёт их верификатору.
+    bool writeData(const QByteArray &aData);
+
+private:
+    /// Проверяет содержимое потока верификатором.
+    bool verifyData();
+
+    /// Передаёт потоковому верификатору первые aSize байт потока.
+    bool feedVerifier(IStreamVerifier *aVerifier, qint64 aSize);
+
 private:
     bool m_Processing;
     QMutex m_ProcessingMutex;
     QWaitCondition m_ProcessingCondition;
-    QTimer m_Timer;
+    State m_State;
+    QElapsedTimer m_Clock; // запущен в addTask
+    STimings m_Timings;
     NetworkTaskManager *m_Manager{};
     Type m_Type;
     QUrl m_Url;
     Flags m_Flags;
+    TrafficClass m_TrafficClass;
     int m_Timeout;
     int m_Error;
     int m_HttpError;
@@ -147,6 +208,7 @@ private:
     QThread *m_ParentThread;
     qint64 m_Size;
     qint64 m_CurrentSize;
+    qint64 m_VerifiedSize; // -1 - потоковая проверка не начата или прервана
     QVariant m_Tag;
 };
 
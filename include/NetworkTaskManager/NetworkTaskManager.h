@@ -2,12 +2,15 @@
 
 #pragma once
 
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
 #include <QtCore/QList>
-#include <QtCore/QMap>
 #include <QtCore/QPointer>
+#include <QtCore/QSet>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QString>
 #include <QtCore/QThread>
+#include <QtCore/QTimer>
 #include <QtNetwork/QNetworkAccessManager>
 #include <QtNetwork/QNetworkProxy>
 #include <QtNetwork/QNetworkReply>
@@ -15,10 +18,24 @@
 
 #include <Common/ILogable.h>
 
+#include <NetworkTaskManager/BandwidthLimiter.h>
+#include <NetworkTaskManager/TimerWheel.h>
+
 //------------------------------------------------------------------------
 namespace CNetworkTaskManager {
 extern const char LogName[];
 const int BadTask = -1;
+
+/// Период чтения ответов, ожидающих токенов ограничителя скорости, мс.
+const int ThrottleInterval = 20;
+
+/// Размер буфера ответа. Когда буфер заполнен, данные перестают читаться из сокета,
+/// и ограничение скорости доходит до сервера через управление потоком TCP.
+const qint64 ReadBufferSize = 1024 * 1024;
+const qint64 ThrottledReadBufferSize = 64 * 1024;
+
+/// Шаг колеса таймаутов задач, мс. Таймаут срабатывает с точностью до шага.
+const int TimeoutResolution = 100;
 } // namespace CNetworkTaskManager
 
 //------------------------------------------------------------------------
@@ -38,9 +55,16 @@ public:
     void setProxy(const QNetworkProxy &aProxy);
 
     /// Устанавливает ограничение скорости закачки в процентах от максимальной
-    /// возможной.
+    /// возможной. Действует на класс NetworkTask::Bulk, если задано общее ограничение канала.
     void setDownloadSpeedLimit(int aPercent);
 
+    /// Устанавливает ограничение скорости чтения ответов класса aClass (NetworkTask::TrafficClass)
+    /// в байтах в секунду, 0 - без ограничения. Может меняться во время загрузки.
+    void setTrafficLimit(int aClass, qint64 aBytesPerSecond);
+
+    /// Устанавливает общее ограничение скорости канала в байтах в секунду, 0 - без ограничения.
+    void setTotalTrafficLimit(qint64 aBytesPerSecond);
+
     /// Добавление нового задания в очередь.
     void addTask(NetworkTask *aTask);
 
@@ -62,6 +86,8 @@ private slots:
 
     /// Синхронизированная установка лимита скорости загрузки.
     void onSetDownloadSpeedLimit(int aPercent);
+    void onSetTrafficLimit(int aClass, qint64 aBytesPerSecond);
+    void onSetTotalTrafficLimit(qint64 aBytesPerSecond);
 
     /// Синхронизированное добавление нового задания.
     void onAddTask(NetworkTask *aTask);
@@ -79,11 +105,35 @@ private slots:
     void onTaskError(QNetworkReply::NetworkError aError);
     void onTaskSslErrors(const QList<QSslError> &aErrors);
     void onTaskComplete();
+    void onTaskMetaDataChanged();
+    void onTaskConnecting();
+    void onTaskRequestSent();
+
+    /// Дочитывает ответы, придержанные ограничителем скорости.
+    void onThrottleTimeout();
+
+    /// Завершает задачи с истёкшим таймаутом.
+    void onWheelTimeout();
 
 private:
     /// Рабочая процедура нити.
     void run();
 
+    /// Читает из ответа доступные данные в пределах ограничения скорости.
+    void readReply(QNetworkReply *aReply);
+
+    /// Завершает задачу полностью прочитанного ответа.
+    void completeReply(QNetworkReply *aReply);
+
+    /// Возвращает задачу ответа aReply или nullptr.
+    NetworkTask *taskOf(QNetworkReply *aReply) const;
+
+    /// Переносит таймаут задачи на aTimeout мс от текущего момента.
+    void scheduleTimeout(QNetworkReply *aReply, qint64 aTimeout);
+
+    /// Обрывает ответ, освобождает его класс трафика в ограничителе и удаляет ответ из реестра.
+    void releaseReply(QNetworkReply *aReply);
+
     /// Загрузка сертификата из ресурсов
     QSslCertificate loadCertResource(const QString &aPath);
 
@@ -92,11 +142,39 @@ signals:
     void networkTaskStatus(bool aFailure);
 
 private:
-    typedef QMap<QNetworkReply *, QPointer<NetworkTask>> TTaskMap;
-
+    /// Запись реестра. Адрес задачи хранится отдельно от QPointer: задачу могут удалить
+    /// до завершения, а запись по задаче всё равно нужно найти и убрать. Класс трафика
+    /// запоминается при запуске: по нему ответ освобождается в ограничителе скорости.
+    struct STaskEntry {
+        NetworkTask *key;
+        QPointer<NetworkTask> task;
+        int trafficClass;
+
+        STaskEntry() : key(nullptr), trafficClass(-1) {}
+        explicit STaskEntry(NetworkTask *aTask);
+    };
+
+    typedef QHash<QNetworkReply *, STaskEntry> TTaskMap;
+    typedef QHash<NetworkTask *, QNetworkReply *> TReplyMap;
+
+    /// Реестр выполняемых задач: поиск и по ответу, и по задаче за O(1).
     TTaskMap m_Tasks;
+    TReplyMap m_Replies;
     QSharedPointer<QNetworkAccessManager> m_Network;
     QString m_UserAgent;
+
+    BandwidthLimiter m_Limiter;
+    QTimer m_ThrottleTimer;
+    int m_DownloadSpeedLimit; // процент общего ограничения для NetworkTask::Bulk, 0 - нет
+
+    /// Завершённые ответы, в буфере которых ещё есть данные.
+    QSet<QNetworkReply *> m_FinishedReplies;
+
+    /// Таймауты всех задач обслуживает одно колесо с одним таймером.
+    QElapsedTimer m_Clock;
+    TimerWheel<QNetworkReply *> m_Timeouts;
+    QTimer m_WheelTimer;
+
     void loadCerts();
 };
 
@@ -0,0 +1,98 @@
+/* @file Колесо таймеров для сроков выполнения сетевых задач. */
+
+#pragma once
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QVector>
+
+//------------------------------------------------------------------------
+namespace CTimerWheel {
+/// Число ячеек колеса. Сроки дальше одного оборота ждут в ячейке следующих оборотов.
+const int SlotCount = 512;
+} // namespace CTimerWheel
+
+//------------------------------------------------------------------------
+/// Хешированное колесо таймеров. Срок ключа попадает в ячейку своего такта (aResolution мс),
+/// постановка, перенос и отмена стоят O(1) независимо от числа ключей. Время абсолютное, мс,
+/// отсчитывается вызывающим. Срок срабатывает не раньше заданного и не позже чем через такт.
+/// Класс не потокобезопасен.
+template <typename TKey> class TimerWheel {
+public:
+    explicit TimerWheel(qint64 aResolution, int aSlotCount = CTimerWheel::SlotCount)
+        : m_Resolution(qMax(qint64(1), aResolution)), m_Slots(qMax(1, aSlotCount)), m_Tick(-1) {}
+
+    /// Ставит срок ключа aKey на момент aDeadline. Ранее поставленный срок заменяется.
+    void schedule(const TKey &aKey, qint64 aDeadline) {
+        cancel(aKey);
+
+        // Ячейка такта, к концу которого срок гарантированно наступил.
+        qint64 tick = qMax((aDeadline + m_Resolution - 1) / m_Resolution, m_Tick + 1);
+        int slot = static_cast<int>(tick % m_Slots.size());
+
+        m_Slots[slot].insert(aKey, aDeadline);
+        m_Index.insert(aKey, slot);
+    }
+
+    /// Снимает срок ключа aKey. Возвращает false, если срока не было.
+    bool cancel(const TKey &aKey) {
+        auto it = m_Index.find(aKey);
+
+        if (it == m_Index.end()) {
+            return false;
+        }
+
+        m_Slots[it.value()].remove(aKey);
+        m_Index.erase(it);
+
+        return true;
+    }
+
+    bool contains(const TKey &aKey) const { return m_Index.contains(aKey); }
+
+    bool isEmpty() const { return m_Index.isEmpty(); }
+
+    int size() const { return m_Index.size(); }
+
+    qint64 resolution() const { return m_Resolution; }
+
+    /// Проворачивает колесо до момента aNow и возвращает ключи с наступившим сроком,
+    /// снимая их с колеса.
+    QList<TKey> advance(qint64 aNow) {
+        QList<TKey> expired;
+        qint64 target = aNow / m_Resolution;
+
+        if (target <= m_Tick) {
+            return expired;
+        }
+
+        // После долгой паузы достаточно одного оборота: он обходит все ячейки.
+        qint64 count = qMin(target - m_Tick, qint64(m_Slots.size()));
+
+        for (qint64 tick = target - count + 1; tick <= target; ++tick) {
+            QHash<TKey, qint64> &slot = m_Slots[static_cast<int>(tick % m_Slots.size())];
+
+            for (auto it = slot.begin(); it != slot.end();) {
+                if (it.value() <= aNow) {
+                    expired << it.key();
+                    m_Index.remove(it.key());
+                    it = slot.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        m_Tick = target;
+
+        return expired;
+    }
+
+private:
+    qint64 m_Resolution;
+    QVector<QHash<TKey, qint64>> m_Slots; // ключ -> срок
+    QHash<TKey, int> m_Index;             // ключ -> ячейка
+    qint64 m_Tick;                        // последний обработанный такт
+};
+
+//------------------------------------------------------------------------
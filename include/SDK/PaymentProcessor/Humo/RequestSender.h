@@ -4,10 +4,16 @@
 
 #include <QtCore/QByteArray>
 #include <QtCore/QDateTime>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
 #include <QtCore/QObject>
 #include <QtCore/QPointer>
+#include <QtCore/QQueue>
+#include <QtCore/QSharedPointer>
 #include <QtCore/QString>
+#include <QtCore/QThreadPool>
 #include <QtCore/QUrl>
+#include <QtCore/QWaitCondition>
 
 #include <NetworkTaskManager/NetworkTask.h>
 #include <functional>
@@ -22,6 +28,28 @@ class Request;
 class Response;
 
 //---------------------------------------------------------------------------
+namespace CRequestSender {
+/// Число запросов к одному серверу, одновременно находящихся в сети. Совпадает с числом
+/// соединений, которые QNetworkAccessManager держит открытыми для одного хоста.
+const int MaxInFlight = 6;
+
+/// Предельное число потоков для кодирования, подписи и проверки подписи.
+const int MaxWorkers = 4;
+
+/// Ожидание прерванных запросов при удалении отправителя, мс.
+const int CloseTimeout = 5 * 1000;
+} // namespace CRequestSender
+
+//---------------------------------------------------------------------------
+/// Отправка запросов к платёжным шлюзам. Запросы проходят конвейер: кодирование и подпись в
+/// рабочих потоках, передача через менеджер сети (не более MaxInFlight запросов к одному
+/// серверу, соединения переиспользуются), проверка подписи и декодирование ответа снова в
+/// рабочих потоках. Пока один запрос в сети, следующие уже подписываются. Рабочие потоки
+/// общие для всех отправителей.
+///
+/// Кодировщик, подписчик, верифаер, декодер и модификатор вызываются в рабочих потоках.
+/// Конструктор ответа синхронного запроса вызывается в потоке, ждущем ответа, асинхронного -
+/// в рабочем потоке вместе с обработчиком.
 class RequestSender : public QObject {
     Q_OBJECT
 
@@ -82,6 +110,9 @@ public:
     /// Метод, корректирующий значения из HTTP заголовка и тело запроса.
     typedef std::function<bool(Request &, NetworkTask::TByteMap &, QByteArray &)> TRequestModifier;
 
+    /// Обработчик результата асинхронного запроса. Ответ переходит во владение обработчика.
+    typedef std::function<void(Response *, ESendError)> TResponseHandler;
+
     /// Возвращает текстовое описание ошибки.
     static QString translateError(ESendError aError);
 
@@ -91,7 +122,8 @@ public:
     /// Устанавливает сетевой интерфейс для выполнения запросов.
     void setNetworkTaskManager(NetworkTaskManager *aNetwork);
 
-    /// Устанавливает конструктор для специфических ответов.
+    /// Устанавливает конструктор для специфических ответов. Для асинхронных запросов он
+    /// вызывается в рабочем потоке и не должен обращаться к данным владельца без блокировки.
     void setResponseCreator(const TResponseCreator &aResponseCreator);
 
     /// Устанавливает кодировщик запросов.
@@ -115,6 +147,12 @@ public:
     /// Активирует поддержку HTTP запросов. По умолчанию доступны только HTTPS.
     void setOnlySecureConnectionEnabled(bool aOnlySecure);
 
+    /// Устанавливает число запросов к одному серверу, одновременно находящихся в сети.
+    void setMaxInFlight(int aCount);
+
+    /// Число запросов, ещё не получивших результат.
+    int getPendingCount() const;
+
     /// Отправляет запрос методом GET на адрес aUrl.
     Response *get(const QUrl &aUrl,
                   Request &aRequest,
@@ -129,8 +167,27 @@ public:
                    ESendError &aError,
                    int aTimeout = 60 * 1000);
 
+    /// Асинхронно отправляет запрос методом GET на адрес aUrl. aRequest должен существовать до
+    /// вызова aHandler. aHandler и конструктор ответа вызываются в рабочем потоке отправителя,
+    /// а при ошибке до отправки - сразу в вызывающем потоке.
+    void getAsync(const QUrl &aUrl,
+                  Request &aRequest,
+                  ESignatureType aSignatureType,
+                  const TResponseHandler &aHandler,
+                  int aTimeout = 60 * 1000);
+
+    /// Асинхронно отправляет запрос методом POST на адрес aUrl. aRequest должен существовать до
+    /// вызова aHandler. aHandler и конструктор ответа вызываются в рабочем потоке отправителя,
+    /// а при ошибке до отправки - сразу в вызывающем потоке.
+    void postAsync(const QUrl &aUrl,
+                   Request &aRequest,
+                   ESignatureType aSignatureType,
+                   const TResponseHandler &aHandler,
+                   int aTimeout = 60 * 1000);
+
 protected:
-    /// Отправляет запрос методом aType на адрес aUrl.
+    /// Отправляет запрос методом aType на адрес aUrl и ждёт ответа. Не должен вызываться из
+    /// обработчика асинхронного запроса: ожидание занимает рабочий поток.
     Response *request(NetworkTask::Type aType,
                       const QUrl &aUrl,
                       Request &aRequest,
@@ -138,6 +195,14 @@ protected:
                       ESendError &aError,
                       int aTimeout);
 
+    /// Ставит запрос методом aType на адрес aUrl в конвейер. Ответ создаётся в рабочем потоке.
+    void send(NetworkTask::Type aType,
+              const QUrl &aUrl,
+              Request &aRequest,
+              ESignatureType aSignatureType,
+              const TResponseHandler &aHandler,
+              int aTimeout);
+
     /// Конструктор ответов по умолчанию.
     Response *defaultResponseCreator(const Request &aRequest, const QString &aData);
 
@@ -165,6 +230,94 @@ protected:
                                  ESignatureType aSignatureType,
                                  const QByteArray &aSignature = QByteArray());
 
+private:
+    /// Получает декодированный ответ сервера, пустой при ошибке.
+    typedef std::function<void(const QString &, ESendError)> TDataHandler;
+
+    /// Запрос, проходящий через конвейер.
+    struct SContext {
+        NetworkTask::Type type;
+        QUrl url;
+        Request *request;
+        ESignatureType signatureType;
+        int timeout;
+        TDataHandler handler;
+        QString gateway;
+
+        QByteArray body;
+        NetworkTask::TByteMap headers;
+
+        int networkError;
+        bool canceled;
+        QByteArray responseData;
+        NetworkTask::TByteMap responseHeaders;
+    };
+
+    typedef QSharedPointer<SContext> TContext;
+
+    /// Запрос, отданный менеджеру сети. Задачу удаляет менеджер, поэтому указатель слабый.
+    struct SFlight {
+        TContext context;
+        QPointer<NetworkTask> task;
+    };
+
+    /// Отправитель для обработчиков в потоке менеджера сети. Обнуляется в деструкторе: вызовы,
+    /// оставшиеся в очереди менеджера, после этого ничего не делают.
+    struct SLife {
+        QMutex mutex;
+        RequestSender *sender;
+    };
+
+    /// Задачи отправителя в общих рабочих потоках. Переживает отправителя, пока задача
+    /// завершается.
+    struct SJobs {
+        QMutex mutex;
+        QWaitCondition idle;
+        int count;
+
+        SJobs() : count(0) {}
+    };
+
+    /// Очередь и число запросов в сети для одного сервера.
+    struct SGateway {
+        int inFlight;
+        QQueue<TContext> queue;
+
+        SGateway() : inFlight(0) {}
+    };
+
+    /// Рабочие потоки всех отправителей: кодирование, подпись и проверка подписи.
+    static QThreadPool *workers();
+
+    /// Выполняет aJob в рабочем потоке и учитывает её до завершения.
+    void runInWorker(const std::function<void()> &aJob);
+
+    /// Ставит запрос в конвейер, aHandler получает декодированный ответ.
+    void enqueue(NetworkTask::Type aType,
+                 const QUrl &aUrl,
+                 Request &aRequest,
+                 ESignatureType aSignatureType,
+                 const TDataHandler &aHandler,
+                 int aTimeout);
+
+    /// Кодирует и подписывает запрос, вызывается в рабочем потоке.
+    void prepare(const TContext &aContext);
+
+    /// Отправляет подготовленные запросы сервера aGateway в пределах окна.
+    void dispatch(const QString &aGateway);
+
+    /// Создаёт и запускает сетевую задачу, вызывается в потоке менеджера сети.
+    void startTask(const TContext &aContext);
+
+    /// Сетевая задача запроса завершена, вызывается в потоке менеджера сети.
+    void completeTask(const TContext &aContext, NetworkTask *aTask);
+
+    /// Проверяет подпись и декодирует ответ, вызывается в рабочем потоке.
+    void process(const TContext &aContext);
+
+    /// Отдаёт результат обработчику запроса.
+    void finish(const TContext &aContext, const QString &aData, ESendError aError);
+
 private:
     TResponseCreator m_ResponseCreator;
     TRequestEncoder m_RequestEncoder;
@@ -179,6 +332,18 @@ private:
     ICryptEngine *m_CryptEngine;
 
     bool m_OnlySecureConnection;
+
+    QSharedPointer<SJobs> m_Jobs;
+
+    mutable QMutex m_Mutex;
+    QWaitCondition m_IdleCondition;
+    int m_MaxInFlight;
+    int m_Pending;                          // запросы без результата
+    bool m_Closing;                         // отправитель удаляется, новые запросы не принимаются
+    QHash<QString, SGateway> m_Gateways;    // сервер -> очередь
+    QHash<SContext *, SFlight> m_InFlight;  // запросы, отданные менеджеру сети
+
+    QSharedPointer<SLife> m_Life;
 };
 
 //------------------------------------------------------------------------------
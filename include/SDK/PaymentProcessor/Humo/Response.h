@@ -5,6 +5,7 @@
 #include <QtCore/QVariantMap>
 
 #include "ErrorCodes.h"
+#include "ResponseFields.h"
 
 namespace SDK {
 namespace PaymentProcessor {
@@ -47,7 +48,7 @@ public:
     /// Возвращает указанный параметр. Если отсутствует - возвращает пустой QVariant.
     virtual QVariant getParameter(const QString &aName) const;
 
-    /// Возвращает полный список параметров.
+    /// Возвращает полный список параметров. Словарь строится при первом обращении.
     virtual const QVariantMap &getParameters() const;
 
     /// Возвращает строку, из которой был сконструирован объект.
@@ -63,12 +64,23 @@ protected:
     /// Возвращает запрос, связанный с ответом.
     const Request &getRequest() const;
 
+private:
+    /// Обновляет коды ошибки, результата и текст ошибки по полю aName.
+    void updateStatus(QStringView aName, QStringView aValue);
+
+    /// Строит словарь параметров из таблицы полей.
+    void buildParameters() const;
+
 private:
     /// Строка, из которой был создан класс.
     QString m_ResponseString;
 
-    /// Параметры ответа.
-    QVariantMap m_Parameters;
+    /// Поля ответа, разобранные без построения словаря.
+    ResponseFields m_Fields;
+
+    /// Параметры ответа. До первого обращения к getParameters или addParameter пуст.
+    mutable QVariantMap m_Parameters;
+    mutable bool m_ParametersReady;
 
     /// Значения полей "ошибка" и "результат".
     int m_Error;
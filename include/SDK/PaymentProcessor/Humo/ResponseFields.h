@@ -0,0 +1,68 @@
+/* @file Таблица полей ответа сервера в формате key=value. */
+
+#pragma once
+
+#include <QtCore/QString>
+#include <QtCore/QStringView>
+#include <QtCore/QVariantMap>
+#include <QtCore/QVector>
+
+namespace SDK {
+namespace PaymentProcessor {
+namespace Humo {
+
+//---------------------------------------------------------------------------
+/// Поля ответа сервера. Ответ разбирается за один проход: строки разделены "\r\n", поле -
+/// строка вида NAME=value, где NAME состоит из латинских букв, цифр и '_'. Значение не может
+/// содержать '\n', кроме завершающего, который в значение не входит. Строки другого вида
+/// пропускаются. Таблица хранит лишь смещения в исходной строке, QString и QVariant создаются
+/// по запросу. При повторе имени действует последнее значение.
+class ResponseFields {
+public:
+    ResponseFields();
+    explicit ResponseFields(const QString &aData);
+
+    /// Разбирает ответ aData, прежние поля удаляются.
+    void parse(const QString &aData);
+
+    /// Число полей, включая повторы имён.
+    int size() const;
+    bool isEmpty() const;
+
+    /// Имя и значение поля с номером aIndex в порядке следования в ответе.
+    QStringView name(int aIndex) const;
+    QStringView value(int aIndex) const;
+
+    /// Номер последнего поля с именем aName, -1 - поля нет.
+    int indexOf(QStringView aName) const;
+
+    bool contains(QStringView aName) const;
+
+    /// Значение поля aName, пустой QVariant - поля нет.
+    QVariant get(QStringView aName) const;
+
+    /// Значение поля aName как число, aDefault - поля нет или это не число.
+    int getInt(QStringView aName, int aDefault = 0) const;
+
+    /// Все поля в виде словаря строковых значений.
+    QVariantMap toVariantMap() const;
+
+private:
+    struct SField {
+        int nameStart;
+        int nameLength;
+        int valueStart;
+        int valueLength;
+    };
+
+    /// Добавляет поле, если строка [aStart, aEnd) им является.
+    void parseLine(int aStart, int aEnd);
+
+    QString m_Data;
+    QVector<SField> m_Fields;
+};
+
+//------------------------------------------------------------------------------
+} // namespace Humo
+} // namespace PaymentProcessor
+} // namespace SDK
@@ -2,9 +2,11 @@
 
 #pragma once
 
+#include <QtCore/QDateTime>
 #include <QtCore/QList>
 #include <QtCore/QMap>
 #include <QtCore/QSet>
+#include <QtCore/QSharedPointer>
 #include <QtCore/QTime>
 #include <QtCore/QVariantMap>
 #include <QtCore/QWeakPointer>
@@ -12,6 +14,7 @@
 #include <Common/PropertyTree.h>
 
 //----------------------------------------------------------------------------
+class QDataStream;
 class QJsonArray;
 
 namespace SDK {
@@ -130,9 +133,12 @@ class CommissionByTimeList {
 protected:
     CommissionByTimeList();
 
-    TCommissions getCommissions() const;
+    /// Входит ли время aTime в интервал действия комиссий.
+    bool contains(const QTime &aTime) const;
 
-    bool query(double aSum, Commission &aCommission) const;
+    TCommissions getCommissions(const QTime &aTime) const;
+
+    bool query(double aSum, const QTime &aTime, Commission &aCommission) const;
 
     CommissionByTimeList &operator<<(const Commission &aCommission);
 
@@ -154,9 +160,13 @@ class CommissionByDayList {
 protected:
     CommissionByDayList();
 
-    TCommissions getCommissions() const;
+    /// Действуют ли комиссии в день недели aDay.
+    bool contains(Commission::Day aDay) const;
 
-    bool query(double aSum, Commission &aCommission) const;
+    TCommissions getCommissions(Commission::Day aDay, const QTime &aTime) const;
+
+    bool query(double aSum, Commission::Day aDay, const QTime &aTime,
+               Commission &aCommission) const;
 
     static CommissionByDayList from_Settings(const TPtree &aSettings);
 
@@ -171,6 +181,8 @@ private:
 
 //----------------------------------------------------------------------------
 class ProcessingCommission {
+    friend class Commissions;
+
     enum Type {
         // <Комиссия> = <amount>*<процент комиссии хумо>
         Real = 1,
@@ -207,9 +219,9 @@ class Commissions {
 
         SComplexCommissions() { vat = 0; }
 
-        TCommissions getCommissions() const;
+        TCommissions getCommissions(Commission::Day aDay, const QTime &aTime) const;
 
-        Commission query(double aSum) const;
+        Commission query(double aSum, Commission::Day aDay, const QTime &aTime) const;
 
         QList<CommissionByDayList> commissionsByDay;
         QList<CommissionByTimeList> commissionsByTime;
@@ -226,6 +238,16 @@ public:
     /// Получение актуальной комиссии по идентификатору оператора и сумме платежа.
     Commission getCommission(qint64 aProvider, double aSum) const;
 
+    /// Список комиссий и комиссия, действующие в момент aTime. Правила оператора при первом
+    /// обращении компилируются в таблицы порогов по дням недели и временным окнам, дальше
+    /// комиссия находится двоичным поиском по сумме.
+    TCommissions getCommissions(qint64 aProvider, const QDateTime &aTime) const;
+    Commission getCommission(qint64 aProvider, double aSum, const QDateTime &aTime) const;
+
+    /// То же обходом исходных правил, без скомпилированных таблиц. Эталон для проверки.
+    TCommissions findCommissions(qint64 aProvider, const QDateTime &aTime) const;
+    Commission findCommission(qint64 aProvider, double aSum, const QDateTime &aTime) const;
+
     /// Получение комиссии процессинга за платёж по указанному оператору. Используется для разбивки
     /// комиссии на платёжном чеке. Все подсчёты производятся только методом getCommission.
     ProcessingCommission getProcessingCommission(qint64 aProvider);
@@ -249,18 +271,60 @@ public:
     /// Дополнить комиссии недостающими элементами из настроек
     void appendFrom_Settings(const TPtree &aSettings);
 
+    /// Чтение комиссий из снимка настроек. При ошибке статус aStream отличен от Ok.
+    static Commissions from_Snapshot(QDataStream &aStream);
+
+    /// Запись комиссий в снимок настроек.
+    void toSnapshot(QDataStream &aStream) const;
+
     /// Сбросить состояние
     void clear();
 
 protected:
+    /// Таблица порогов, скомпилированные правила оператора и кэш скомпилированных правил.
+    struct STable;
+    struct SCompiled;
+    struct SCompiledCache;
+
+    /// Правила оператора aProvider или правила по умолчанию.
+    const SComplexCommissions &getRules(qint64 aProvider) const;
+
+    /// Скомпилированные правила оператора, компилируются при первом обращении.
+    QSharedPointer<const SCompiled> getCompiled(qint64 aProvider) const;
+
+    /// Компиляция правил: таблицы для всех дней недели и временных окон.
+    static QSharedPointer<const SCompiled> compile(const SComplexCommissions &aCommissions);
+    static STable compileTable(const QList<CommissionList> &aChain, const TCommissions &aCurrent);
+
+    /// Комиссия для суммы aSum по таблице порогов.
+    static Commission evaluate(const STable &aTable, double aSum);
+
     SComplexCommissions loadCommissions(const TPtree &aBranch);
     SComplexCommissions loadCommissions(const QVariant &aCommissions);
 
+    /// Сериализация составных частей для снимка настроек.
+    static void write(QDataStream &aStream, const Commission &aCommission);
+    static void write(QDataStream &aStream, const CommissionList &aList);
+    static void write(QDataStream &aStream, const CommissionByTimeList &aList);
+    static void write(QDataStream &aStream, const CommissionByDayList &aList);
+    static void write(QDataStream &aStream, const ProcessingCommission &aCommission);
+    static void write(QDataStream &aStream, const SComplexCommissions &aCommissions);
+
+    static void read(QDataStream &aStream, Commission &aCommission);
+    static void read(QDataStream &aStream, CommissionList &aList);
+    static void read(QDataStream &aStream, CommissionByTimeList &aList);
+    static void read(QDataStream &aStream, CommissionByDayList &aList);
+    static void read(QDataStream &aStream, ProcessingCommission &aCommission);
+    static void read(QDataStream &aStream, SComplexCommissions &aCommissions);
+
 private:
     bool m_IsValid;
     QMap<qint64, SComplexCommissions> m_ProviderCommissions;
     QMap<qint64, ProcessingCommission> m_ProcessingCommissions;
     SComplexCommissions m_DefaultCommissions;
+
+    /// Общий для копий кэш; сбрасывается при любом изменении правил.
+    QSharedPointer<SCompiledCache> m_Cache;
 };
 
 //----------------------------------------------------------------------------
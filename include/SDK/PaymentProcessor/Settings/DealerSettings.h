@@ -7,13 +7,17 @@
 #include <boost/noncopyable.hpp>
 #pragma pop_macro("foreach")
 
+#include <QtCore/QHash>
 #include <QtCore/QReadWriteLock>
+#include <QtCore/QSet>
+#include <QtCore/QSharedPointer>
 
 #include <Common/ILogable.h>
 #include <Common/PropertyTree.h>
 
 #include <SDK/PaymentProcessor/Settings/ISettingsAdapter.h>
 #include <SDK/PaymentProcessor/Settings/Provider.h>
+#include <SDK/PaymentProcessor/Settings/ProviderCatalog.h>
 #include <SDK/PaymentProcessor/Settings/Range.h>
 
 #include "Commissions.h"
@@ -86,6 +90,13 @@ public:
     /// Инициализация настроек.
     void initialize();
 
+    /// Восстанавливает операторов и комиссии из снимка настроек. Вызывается до initialize(),
+    /// которая после этого не разбирает operators.xml и комиссии. false - снимок не прочитан.
+    bool loadSnapshot(QDataStream &aStream);
+
+    /// Записывает разобранных операторов и комиссии в снимок настроек.
+    void saveSnapshot(QDataStream &aStream) const;
+
     /// Возвращает персональные данные дилера.
     const SPersonalSettings &getPersonalSettings() const;
 
@@ -142,11 +153,19 @@ private:
     /// Загружает список операторов.
     bool loadProviders();
 
-    /// Загружает список операторов из xml файла.
-    bool loadOperatorsXML(const QString &aFileName);
+    /// Загружает описания операторов из xml файла в aSources. Повторные описания пропускаются.
+    bool loadOperatorsXML(const QString &aFileName,
+                          ProviderCatalog::TSources &aSources,
+                          QSet<qint64> &aLoaded);
+
+    /// Загружает оператора из буфера. Вызывается параллельно при построении каталога.
+    bool loadProvidersFrom_Buffer(const std::string &aBuffer, SProvider &aProvider) const;
 
-    /// Загружает оператора из буфера
-    bool loadProvidersFrom_Buffer(const std::string &aBuffer, SProvider &aProvider);
+    /// Возвращает оператора с учётом внешних лимитов. Вызывается под m_ProvidersLock.
+    SProvider findProvider(qint64 aId) const;
+
+    /// Фильтрует отключённых операторов. Вызывается под m_ProvidersLock.
+    QList<qint64> getEnabledIDs(const QList<qint64> &aIds) const;
 
     /// Загружает комиссии.
     bool loadCommissions();
@@ -160,12 +179,12 @@ private:
 private:
     TPtree &m_Properties;
 
-    QReadWriteLock m_ProvidersLock;
-    QMap<qint64, std::string> m_ProviderRawBuffer;
-    TProviderList m_Providers;
+    /// Защищает каталог и изменения поверх него, под блокировкой описания не разбираются.
+    mutable QReadWriteLock m_ProvidersLock;
+    QSharedPointer<const ProviderCatalog> m_ProviderCatalog;
+    QSet<qint64> m_DisabledProviders;
+    QHash<qint64, SProvider::SLimits> m_ExternalLimits;
 
-    QMultiMap<qint64, qint64> m_ProviderGateways;
-    QMultiMap<QString, qint64> m_ProvidersProcessingIndex;
     SPersonalSettings m_PersonalSettings;
 
     Commissions m_Commissions;
@@ -174,6 +193,9 @@ private:
     /// Чёрно-белый список клиентов.
     TCustomers m_Customers;
 
+    /// Операторы и комиссии получены из снимка.
+    bool m_FromSnapshot;
+
     /// Флаг состояния.
     bool m_IsValid;
 };
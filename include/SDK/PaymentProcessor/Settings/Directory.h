@@ -13,16 +13,21 @@
 #include <SDK/PaymentProcessor/Connection/Connection.h>
 #include <SDK/PaymentProcessor/Settings/ISettingsAdapter.h>
 #include <SDK/PaymentProcessor/Settings/Range.h>
+#include <SDK/PaymentProcessor/Settings/RangeIndex.h>
 
 #include <boost/property_tree/ptree.hpp>
 
+class QDataStream;
+
 namespace SDK {
 namespace PaymentProcessor {
 
 //----------------------------------------------------------------------------
 class Directory : public ISettingsAdapter, public ILogable {
 public:
-    explicit Directory(TPtree &aProperties);
+    /// Номерная ёмкость разбирается и индексируется в конструкторе, поэтому лог передаётся
+    /// сюда, а не через setLog() после создания.
+    explicit Directory(TPtree &aProperties, ILog *aLog = nullptr);
     ~Directory();
 
     /// Валидация данных.
@@ -40,16 +45,26 @@ public:
     /// Возвращает список ID операторов, которые имеют виртуальные ёмкости.
     QSet<qint64> getOverlappedIDs() const;
 
+    /// Заменяет номерную ёмкость данными снимка настроек. false - снимок не прочитан.
+    bool loadSnapshot(QDataStream &aStream);
+
+    /// Записывает номерную ёмкость в снимок настроек.
+    void saveSnapshot(QDataStream &aStream) const;
+
 private:
     Directory(const Directory &);
     void operator=(const Directory &);
 
+    /// Перестраивает индекс поиска по номеру.
+    void buildRangeIndex();
+
 private:
     TPtree m_Properties;
 
     QVector<SRange> m_Ranges;
     QVector<SRange> m_OverlappedRanges;
     QSet<qint64> m_OverlappedIDs;
+    RangeIndex m_RangeIndex;
     QDateTime m_RangesTimestamp;
 };
 
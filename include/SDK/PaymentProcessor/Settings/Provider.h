@@ -7,6 +7,8 @@
 #include <QtCore/QUrl>
 #include <QtCore/QVariantMap>
 
+class QDataStream;
+
 namespace SDK {
 namespace PaymentProcessor {
 
@@ -187,6 +189,15 @@ struct SProvider {
     static TProviderFields json2Fields(const QString &aJson);
 };
 
+//------------------------------------------------------------------------------
+/// Сериализация описания оператора для снимка настроек. Внешние лимиты не сохраняются.
+QDataStream &operator<<(QDataStream &aStream, const SProviderField::SEnum_Item &aItem);
+QDataStream &operator>>(QDataStream &aStream, SProviderField::SEnum_Item &aItem);
+QDataStream &operator<<(QDataStream &aStream, const SProviderField &aField);
+QDataStream &operator>>(QDataStream &aStream, SProviderField &aField);
+QDataStream &operator<<(QDataStream &aStream, const SProvider &aProvider);
+QDataStream &operator>>(QDataStream &aStream, SProvider &aProvider);
+
 //------------------------------------------------------------------------------
 } // namespace PaymentProcessor
 } // namespace SDK
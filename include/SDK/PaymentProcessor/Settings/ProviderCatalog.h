@@ -0,0 +1,85 @@
+/* @file Скомпилированный каталог операторов. */
+
+#pragma once
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMultiMap>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include <SDK/PaymentProcessor/Settings/Provider.h>
+
+#include <functional>
+#include <string>
+
+class QDataStream;
+
+namespace SDK {
+namespace PaymentProcessor {
+
+//---------------------------------------------------------------------------
+/// Неизменяемый каталог операторов с индексами по идентификатору, номеру шлюза (cid и tt_list)
+/// и типу процессинга. Все описания разбираются один раз при построении, после этого каталог
+/// только читается, поэтому обращения из разных потоков не требуют синхронизации.
+class ProviderCatalog {
+public:
+    /// Описание оператора в исходном виде (XML).
+    struct SSource {
+        qint64 id;
+        std::string buffer;
+    };
+
+    typedef QVector<SSource> TSources;
+
+    /// Разбор описания оператора. false - оператор в каталог не попадает.
+    typedef std::function<bool(const std::string &aBuffer, SProvider &aProvider)> TParser;
+
+    /// Разбирает описания aSources (при aParallel - на глобальном пуле потоков) и строит индексы.
+    /// Порядок aSources сохраняется: в индексах позже описанный оператор возвращается первым.
+    static QSharedPointer<const ProviderCatalog>
+    compile(const TSources &aSources, const TParser &aParser, bool aParallel = true);
+
+    /// Читает каталог из снимка настроек. nullptr - данные повреждены.
+    static QSharedPointer<const ProviderCatalog> load(QDataStream &aStream);
+
+    /// Записывает каталог в снимок настроек в исходном порядке операторов.
+    void save(QDataStream &aStream) const;
+
+    /// Тип процессинга оператора. Процессинг вида тип_процессинга#имя - алиас стандартного типа.
+    static QString getProcessingType(const SProvider &aProvider);
+
+    /// Количество операторов.
+    int size() const;
+
+    /// Оператор с идентификатором aId, nullptr - если такого нет.
+    const SProvider *find(qint64 aId) const;
+
+    /// Идентификаторы операторов, обслуживаемых шлюзом aCid.
+    QList<qint64> getIDsByCID(qint64 aCid) const;
+
+    /// Идентификаторы операторов с типом процессинга aType.
+    QList<qint64> getIDsByProcessing(const QString &aType) const;
+
+    /// Список типов процессинга без повторов.
+    QStringList getProcessingTypes() const;
+
+private:
+    ProviderCatalog() = default;
+
+    /// Добавляет оператора в конец каталога и индексы. Повторный идентификатор пропускается.
+    void add(qint64 aId, const SProvider &aProvider);
+
+private:
+    QVector<qint64> m_Order;
+    QHash<qint64, SProvider> m_Providers;
+    QMultiMap<qint64, qint64> m_Gateways;
+    QMultiMap<QString, qint64> m_Processing;
+};
+
+//---------------------------------------------------------------------------
+} // namespace PaymentProcessor
+} // namespace SDK
+
+//---------------------------------------------------------------------------
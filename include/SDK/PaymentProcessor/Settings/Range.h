@@ -2,6 +2,8 @@
 
 #include <QtCore/QVector>
 
+class QDataStream;
+
 namespace SDK {
 namespace PaymentProcessor {
 
@@ -28,6 +30,11 @@ bool operator<(const SRange &aRange, qint64 aNumber);
 /// Оператор сравнения для поиска диапазона в который входит aNumber с помощью qUpperBound().
 bool operator<(qint64 aNumber, const SRange &aRange);
 
+//---------------------------------------------------------------------------
+/// Сериализация диапазона для снимка настроек.
+QDataStream &operator<<(QDataStream &aStream, const SRange &aRange);
+QDataStream &operator>>(QDataStream &aStream, SRange &aRange);
+
 } // namespace PaymentProcessor
 } // namespace SDK
 
@@ -0,0 +1,53 @@
+/* @file Индекс номерной ёмкости. */
+
+#pragma once
+
+#include <QtCore/QList>
+#include <QtCore/QVector>
+
+#include <SDK/PaymentProcessor/Settings/Range.h>
+
+namespace SDK {
+namespace PaymentProcessor {
+
+//---------------------------------------------------------------------------
+/// Неизменяемый индекс диапазонов номерной ёмкости. Границы всех диапазонов разбивают числовую
+/// ось на элементарные отрезки, для каждого отрезка заранее сохранён готовый ответ: виртуальные
+/// диапазоны, если они его покрывают, иначе обычные. Поиск - переход по таблице корзин к
+/// короткому участку упакованных границ и двоичный поиск внутри него.
+class RangeIndex {
+public:
+    RangeIndex();
+
+    /// Строит индекс. Диапазоны в ответе идут в порядке входных списков.
+    RangeIndex(const QVector<SRange> &aRanges, const QVector<SRange> &aOverlappedRanges);
+
+    /// Диапазоны, содержащие номер aNumber.
+    QList<SRange> find(qint64 aNumber) const;
+
+    /// Количество элементарных отрезков.
+    int segmentCount() const;
+
+private:
+    /// Номер отрезка, содержащего aNumber, -1 - номер вне всех диапазонов.
+    int findSegment(qint64 aNumber) const;
+
+private:
+    /// Отсортированные границы отрезков: отрезок i - [m_Bounds[i], m_Bounds[i + 1]).
+    QVector<qint64> m_Bounds;
+
+    /// Ответы отрезков: m_Matches[m_Offsets[i]..m_Offsets[i + 1]).
+    QVector<quint32> m_Offsets;
+    QVector<SRange> m_Matches;
+
+    /// Корзина b покрывает номера [m_Bounds[0] + (b << m_Shift), ...) и хранит номер отрезка,
+    /// в котором она начинается.
+    QVector<quint32> m_Buckets;
+    int m_Shift;
+};
+
+//---------------------------------------------------------------------------
+} // namespace PaymentProcessor
+} // namespace SDK
+
+//---------------------------------------------------------------------------
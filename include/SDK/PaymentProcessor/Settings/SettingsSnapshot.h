@@ -0,0 +1,90 @@
+/* @file Двоичный снимок разобранных настроек. */
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QList>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QStringList>
+
+namespace SDK {
+namespace PaymentProcessor {
+
+//---------------------------------------------------------------------------
+namespace CSettingsSnapshot {
+/// Признак и версия формата. Версия увеличивается при изменении формата самого снимка.
+const quint32 Magic = 0x454B5353;
+const quint32 Version = 2;
+
+/// Версия QDataStream данных снимка.
+const int StreamVersion = QDataStream::Qt_5_0;
+} // namespace CSettingsSnapshot
+
+//---------------------------------------------------------------------------
+/// Снимок результата разбора XML настроек, привязанный к исходным файлам. Формат:
+/// признак, версия, версия сборки, список исходников (путь, размер, MD5), размер и MD5 данных,
+/// затем сами данные одним блоком. Файл отображается в память, данные читаются из неё без
+/// копирования. Снимок действителен, только если совпали версия, сборка, все исходники и сумма
+/// данных; иначе настройки загружаются из XML и снимок записывается заново. Сериализацию данных
+/// задают адаптеры настроек, поэтому снимок другой сборки не читается даже при тех же исходниках.
+class SettingsSnapshot {
+public:
+    /// aBuild - версия сборки, записавшей снимок (Humo::getVersion()).
+    SettingsSnapshot(const QString &aFileName, const QStringList &aSources, const QString &aBuild);
+    ~SettingsSnapshot();
+
+    /// Открывает и проверяет снимок. false - снимка нет, он повреждён или устарел (см. getError()).
+    bool open();
+
+    /// Данные открытого снимка.
+    QDataStream &data();
+
+    /// Освобождает отображение файла.
+    void close();
+
+    /// Записывает снимок с данными aData. Суммы исходников берутся с момента open(), то есть
+    /// до их разбора: файл, изменённый во время загрузки, при следующем запуске снимок обновит.
+    bool write(const QByteArray &aData);
+
+    /// Путь к файлу снимка.
+    const QString &getFileName() const;
+
+    /// Причина отказа последнего open() или write().
+    const QString &getError() const;
+
+private:
+    /// Описание исходного файла.
+    struct SSource {
+        QString path;
+        qint64 size;
+        QByteArray hash;
+    };
+
+    /// Текущее состояние исходников, отсутствующий файл - размер -1 и пустая сумма.
+    QList<SSource> getSources();
+
+    /// MD5 файла, пустой массив - файл не прочитан.
+    static QByteArray hashFile(const QString &aPath);
+
+private:
+    QString m_FileName;
+    QStringList m_SourceNames;
+    QString m_Build;
+    QList<SSource> m_Sources;
+
+    QFile m_File;
+    uchar *m_Map;
+    QByteArray m_Content;
+    QByteArray m_Data;
+    QScopedPointer<QDataStream> m_Stream;
+
+    QString m_Error;
+};
+
+//---------------------------------------------------------------------------
+} // namespace PaymentProcessor
+} // namespace SDK
+
+//---------------------------------------------------------------------------
@@ -28,9 +28,38 @@ struct SDatabaseSettings {
     QString password;
     int port{0};
 
+    /// Профиль производительности SQLite. Незаданные значения (пустая строка, 0 для cacheSize,
+    /// -1 для остальных чисел) берутся по умолчанию.
+    QString journalMode;        /// Режим журнала (WAL, DELETE, ...).
+    QString synchronous;        /// Уровень синхронизации (OFF, NORMAL, FULL, EXTRA).
+    int cacheSize{0};           /// Размер кэша страниц: > 0 - в страницах, < 0 - в КиБ.
+    qint64 mmapSize{-1};        /// Размер отображаемой в память части файла БД, байт.
+    QString tempStore;          /// Хранилище временных таблиц (DEFAULT, FILE, MEMORY).
+    int statementCacheSize{-1}; /// Число подготовленных запросов в кэше.
+    int readConnections{-1};    /// Число соединений только для чтения.
+
+    /// Сверять счётчики баланса с подсчётом по всем купюрам при каждом чтении баланса.
+    bool balanceSelfCheck{false};
+
     SDatabaseSettings() = default;
 };
 
+//---------------------------------------------------------------------------
+struct SOfflinePaymentSettings {
+    /// Порядок проведения накопившихся платежей.
+    enum EOrder {
+        Oldest, /// Сначала старые.
+        Amount  /// Сначала крупные.
+    };
+
+    int workers{4};         /// Число платежей, проводимых одновременно.
+    EOrder order{Oldest};   /// Порядок очереди.
+    double providerRate{0}; /// Платежей в минуту на одного оператора, 0 - без ограничения.
+    double gatewayRate{0};  /// Платежей в минуту на один шлюз, 0 - без ограничения.
+
+    SOfflinePaymentSettings() = default;
+};
+
 //---------------------------------------------------------------------------
 struct SKeySettings {
     bool isValid{false};
@@ -192,6 +221,9 @@ public:
     /// Получить настройки БД.
     SDatabaseSettings getDatabaseSettings() const;
 
+    /// Получить настройки проведения оффлайн платежей.
+    SOfflinePaymentSettings getOfflinePaymentSettings() const;
+
     /// Получить список устройств.
     QStringList getDeviceList() const;
 
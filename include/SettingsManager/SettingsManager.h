@@ -8,6 +8,8 @@
 #include <boost/property_tree/ptree.hpp>
 #pragma pop_macro("foreach")
 
+#include <QtCore/QDateTime>
+#include <QtCore/QHash>
 #include <QtCore/QList>
 #include <QtCore/QMap>
 #include <QtCore/QString>
@@ -65,10 +67,25 @@ private:
     /// Делает резервную копию файла.
     void createBackup(const QString &aFilePath);
 
+    /// Запоминает содержимое изменяемого файла после загрузки или сохранения.
+    void rememberFile(const QString &aFilePath, const TPtree &aTree);
+
+    /// Запомненное содержимое файла, nullptr - файл с тех пор изменился или не запоминался.
+    const TPtree *findFile(const QString &aFilePath) const;
+
+private:
+    /// Состояние изменяемого файла на момент последней загрузки или сохранения.
+    struct SFileState {
+        qint64 size;
+        QDateTime modified;
+        TPtree tree;
+    };
+
     TPtree m_Properties;
 
     QString m_ConfigPath;
     QList<SSettingsSource> m_SettingSources;
+    QHash<QString, SFileState> m_Files;
 };
 
 //---------------------------------------------------------------------------
@@ -3,6 +3,7 @@
 #pragma once
 
 #include <QtCore/QList>
+#include <QtCore/QMap>
 #include <QtCore/QSet>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QSignalMapper>
@@ -12,6 +13,8 @@
 #include <NetworkTaskManager/NetworkTaskManager.h>
 
 #include "Component.h"
+#include "DownloadScheduler.h"
+#include "FileHasher.h"
 
 // Windows-specific BITS functionality
 #ifdef Q_OS_WIN32
@@ -87,6 +90,22 @@ public:
     /// указываем контрольную сумму для скачиваемого архива
     void setMD5(const QString &aMD5);
 
+    /// Число одновременных загрузок файлов обновления всего и с одного сервера.
+    void setDownloadConcurrency(int aMaxTasks, int aMaxTasksPerHost);
+
+    /// Порядок загрузки файлов обновления.
+    void setDownloadOrder(DownloadScheduler::EOrder aOrder);
+
+    /// Файлы от aThreshold байт качаются aSegments частями. aThreshold = 0 - не делить.
+    void setSegmentedDownload(qint64 aThreshold, int aSegments);
+
+    /// Пересчитывать контрольные суммы всех файлов рабочего каталога без кеша.
+    void setParanoidHashing(bool aParanoid);
+
+    /// Пропускная способность канала, байт в секунду. Загрузка файлов обновления занимает
+    /// не больше 80% от неё. 0 - без ограничения.
+    void setDownloadBandwidth(qint64 aBytesPerSecond);
+
     /// Запуск процедуры валидации установленного ПО.
     int checkIntegrity();
 
@@ -117,6 +136,9 @@ private:
     /// Сканирует рабочий каталог и возвращает список файлов и контрольных сумм.
     TFileList getWorkingDirStructure() const noexcept(false);
 
+    /// Собирает файлы каталога aDir и его подкаталогов, кроме исключённых.
+    void collectFiles(const QString &aDir, QList<FileHasher::SEntry> &aEntries) const;
+
     /// Удаляет пустые папки.
     int removeEmptyFolders(const QString &aDir);
 
@@ -163,7 +185,7 @@ private slots:
     void deploy();
     void packageDownloaded(QObject *aPackage);
     void deployDownloadedPackage(QObject *aPackage);
-    void downloadComplete();
+    void downloadComplete(NetworkTask *aTask);
 
     void showProgress();
 
@@ -231,13 +253,19 @@ private:
     // Список задач для закачки.
     QList<NetworkTask *> m_ActiveTasks;
 
+    // Очередь параллельной загрузки задач.
+    DownloadScheduler m_Scheduler;
+
     // Размер таска на момент начала загрузки
-    qint64 m_CurrentTaskSize{};
+    QMap<NetworkTask *, qint64> m_TaskSizes;
+
+    // Число неудачных попыток скачать файл задачи.
+    QMap<NetworkTask *, int> m_TaskFails;
 
     // При попытке получить обновление сервер просил подождать
     bool m_WaitUpdateServer{};
 
-    // Число неудачных попыток скачать файл.
+    // Число неудачных попыток получить обновление или скачать архив.
     int m_FailCount;
 
     QSignalMapper m_Mapper;
@@ -249,6 +277,8 @@ private:
 
     bool m_UseBITS;
     int m_JobPriority;
+
+    bool m_ParanoidHashing{};
 };
 
 //---------------------------------------------------------------------------
@@ -56,6 +56,8 @@ const QString SetState = "set_state";
 const QString ResetState = "reset_state";
 /// Команда закрытия логов.
 const QString CloseLogs = "close_logs";
+/// Подтверждение сервисом версии двоичного протокола.
+const QString Protocol = "protocol";
 } // namespace Commands
 
 namespace Notification {
@@ -85,6 +87,8 @@ const QString Sender = "sender";
 const QString Type = "type";
 /// Параметры.
 const QString Params = "params";
+/// Версия двоичного протокола, которую понимает отправитель.
+const QString Protocol = "protocol";
 } // namespace Fields
 
 namespace States {
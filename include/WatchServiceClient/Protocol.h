@@ -0,0 +1,104 @@
+/* @file Протокол обмена сторожевого сервиса с клиентами. */
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+//---------------------------------------------------------------------------
+namespace CWatchServiceProtocol {
+/// Первый байт двоичного сообщения. Текстовое сообщение начинается с латинской буквы.
+const char Magic = '\xEB';
+
+/// Версия двоичной схемы. Декодер пропускает незнакомые поля и отмечает незнакомые типы,
+/// поэтому более новая версия читается, если не поменялся заголовок.
+const quint8 Version = 1;
+
+/// Заголовок: признак, версия, код типа.
+const int HeaderSize = 3;
+
+/// Поле: тег, длина (quint16, big endian), значение в UTF-8.
+const int FieldHeaderSize = 3;
+
+/// Максимальная длина значения поля.
+const int MaxFieldSize = 0xFFFF;
+
+/// Коды типов сообщений. Custom - тип передаётся строкой в поле Type.
+namespace Types {
+enum Enum {
+    Custom = 0,
+    Ping,
+    ScreenActivity,
+    Close,
+    Exit,
+    StartModule,
+    CloseModule,
+    Restart,
+    Reboot,
+    Shutdown,
+    ShowSplashScreen,
+    HideSplashScreen,
+    SetState,
+    ResetState,
+    CloseLogs,
+    ModuleClosed,
+    Protocol,
+    Count
+};
+} // namespace Types
+
+/// Теги полей.
+namespace Tags {
+enum Enum { Sender = 1, Target, Module, Params, Type, Tail };
+} // namespace Tags
+} // namespace CWatchServiceProtocol
+
+//---------------------------------------------------------------------------
+/// Сообщение между сторожевым сервисом и его клиентами.
+struct SWatchServiceMessage {
+    QString sender;
+    QString target;
+    QString type;
+    QString module;
+    QString params;
+
+    /// Элементы без известного ключа.
+    QStringList tail;
+
+    /// Версия двоичной схемы, которую понимает отправитель текстового сообщения. 0 - только текст.
+    int protocol;
+
+    /// Код типа из более новой версии схемы, 0 - тип известен. Такое сообщение не повреждено,
+    /// получатель его пропускает.
+    int unknownType;
+
+    SWatchServiceMessage() : protocol(0), unknownType(0) {}
+};
+
+//---------------------------------------------------------------------------
+/// Кодирование сообщений. Текстовый формат "ключ=значение;" понимают все версии сервиса
+/// и клиентов, двоичный используется после того, как сервис подтвердил его поддержку.
+class WatchServiceProtocol {
+public:
+    enum EFormat { Text, Binary };
+
+    /// Кодирует сообщение. Сообщение с полем длиннее MaxFieldSize кодируется текстом.
+    static QByteArray encode(const SWatchServiceMessage &aMessage, EFormat aFormat);
+
+    /// Декодирует сообщение любого формата. false - повреждённое двоичное сообщение.
+    /// Сообщение незнакомого типа декодируется с ненулевым unknownType.
+    static bool decode(const QByteArray &aData, SWatchServiceMessage &aMessage);
+
+    /// Возвращает true, если aData - двоичное сообщение.
+    static bool isBinary(const QByteArray &aData);
+
+private:
+    static QByteArray encodeText(const SWatchServiceMessage &aMessage);
+    static QByteArray encodeBinary(const SWatchServiceMessage &aMessage);
+
+    static void decodeText(const QByteArray &aData, SWatchServiceMessage &aMessage);
+    static bool decodeBinary(const QByteArray &aData, SWatchServiceMessage &aMessage);
+};
+
+//---------------------------------------------------------------------------
@@ -2,13 +2,6 @@
 
 #include "ConnectionBase.h"
 
-#include <QtCore/QStringList>
-
-#include <Common/ScopedPointerLaterDeleter.h>
-
-#include <NetworkTaskManager/MemoryDataStream.h>
-#include <NetworkTaskManager/NetworkTask.h>
-#include <NetworkTaskManager/NetworkTaskManager.h>
 #include <utility>
 
 namespace CConnection {
@@ -18,9 +11,6 @@ const int DefaultCheckPeriod = 60 * 1000; // 1 минута
 /// Период пинга соединения.
 const int DefaultPingPeriod = 15 * 60 * 1000; // 15 минут
 
-/// Таймаут запроса проверки соединения.
-const int PingTimeout = 30 * 1000; // 30 секунд
-
 /// Хост по умолчанию для проверки соединения.
 const QString DefaultCheckHost = "http://mon.humo.tj:80/ping";
 
@@ -31,11 +21,12 @@ const QString DefaultCheckResponse = "";
 //--------------------------------------------------------------------------------
 ConnectionBase::ConnectionBase(QString aName, NetworkTaskManager *aNetwork, ILog *aLog)
     : m_Network(aNetwork), m_Name(std::move(aName)), m_Connected(false), m_CheckCount(0),
-      m_Watch(false), m_Log(aLog) {
+      m_Watch(false), m_Log(aLog), m_Probe(aNetwork, aLog) {
     // Таймер будет взводится заново после каждой удачной проверки
     m_CheckTimer.setSingleShot(true);
     m_CheckTimer.setInterval(CConnection::DefaultCheckPeriod);
     QObject::connect(&m_CheckTimer, SIGNAL(timeout()), this, SLOT(onCheckTimeout()));
+    QObject::connect(&m_Probe, SIGNAL(finished(bool)), this, SLOT(onProbeFinished(bool)));
 
     m_CheckHosts << IConnection::CheckUrl(QUrl(CConnection::DefaultCheckHost),
                                           CConnection::DefaultCheckResponse);
@@ -125,16 +116,15 @@ bool ConnectionBase::checkConnection(const IConnection::CheckUrl &aHost) noexcep
         return true;
     }
 
-    // Для каждого хоста из списка или до первой удачной проверки
-    foreach (auto host, hosts) {
-        if (doCheckConnection(host)) {
-            emit connectionAlive();
+    // Один хост проверяется способом, выбранным соединением; список - параллельно,
+    // до первой удачной проверки.
+    bool alive = hosts.size() == 1 ? doCheckConnection(hosts.first()) : m_Probe.check(hosts);
 
-            return true;
-        }
+    if (alive) {
+        emit connectionAlive();
     }
 
-    return false;
+    return alive;
 }
 
 //--------------------------------------------------------------------------------
@@ -146,6 +136,11 @@ void ConnectionBase::setCheckHosts(const QList<IConnection::CheckUrl> &aHosts) {
     }
 }
 
+//--------------------------------------------------------------------------------
+ConnectionProbe::SHealth ConnectionBase::getHealth() const {
+    return m_Probe.getHealth();
+}
+
 //--------------------------------------------------------------------------------
 void ConnectionBase::onCheckTimeout() {
     ++m_CheckCount;
@@ -154,92 +149,52 @@ void ConnectionBase::onCheckTimeout() {
 
     try {
         // Проверяем состояние соединения через апи ОС и делаем http запрос если
-        // подошло время
-        if (isConnected(false) && m_CheckCount >= m_PingPeriod) {
+        // подошло время. Запросы не блокируют поток, результат придёт в onProbeFinished.
+        if (isConnected(false) && m_CheckCount >= m_PingPeriod && m_Probe.start(m_CheckHosts)) {
             m_CheckCount = 0;
-            m_Connected = checkConnection();
-        }
 
-        if (isConnected(true)) {
-            toLog(LogLevel::Debug, "Check timer START.");
-            m_CheckTimer.start();
-        } else {
-            emit connectionLost();
+            return;
         }
     } catch (const NetworkError &e) {
         toLog(LogLevel::Error, e.getMessage());
 
         emit connectionLost();
+
+        return;
     }
+
+    continueWatch();
 }
 
 //--------------------------------------------------------------------------------
-bool ConnectionBase::httpCheckMethod(const IConnection::CheckUrl &aHost) {
-    toLog(LogLevel::Normal, QString("Checking connection on %1...").arg(aHost.first.toString()));
-
-    if (!m_Network) {
-        toLog(LogLevel::Error, "Failed to check connection. Network interface is not specified.");
-
-        return false;
+void ConnectionBase::onProbeFinished(bool aAlive) {
+    // Соединение могли закрыть, пока шла проверка.
+    if (!m_Watch || !m_Connected) {
+        return;
     }
 
-    QScopedPointer<NetworkTask, ScopedPointerLaterDeleter<NetworkTask>> task(new NetworkTask());
-
-    task->setTimeout(CConnection::PingTimeout);
-    task->setUrl(aHost.first);
-    // По-хорошему, тут должен быть HEAD-запрос, но он почему-то не проходит
-    // аутентификацию на прокси-сервере.
-    task->setType(NetworkTask::Get);
-    task->setDataStream(new MemoryDataStream());
-
-    m_Network->addTask(task.data());
-
-    task->waitForFinished();
-
-    QByteArray answer = task->getDataStream()->takeAll();
+    m_Connected = aAlive;
 
-    auto traceLog = [&]() {
-        toLog(LogLevel::Trace,
-              QString("error:%1 http_code:%2").arg(task->getError()).arg(task->getHttpError()));
-
-        QStringList response;
-        QMapIterator<QByteArray, QByteArray> i(task->getResponseHeader());
-        while (i.hasNext()) {
-            i.next();
-            response << QString("%1: %2")
-                            .arg(QString::fromLatin1(i.key()))
-                            .arg(QString::fromLatin1(i.value()));
-        }
-
-        toLog(LogLevel::Trace,
-              QString("HEADER:\n%1\nBODY:\n%2")
-                  .arg(response.join("\n"))
-                  .arg(QString::fromLatin1(answer.left(80))));
-    };
-
-    if (task->getError() != NetworkTask::NoError) {
-        toLog(LogLevel::Error,
-              QString("Connection check failed. Error %1.").arg(task->errorString()));
-
-        traceLog();
-
-        return false;
+    if (aAlive) {
+        emit connectionAlive();
     }
 
-    if (!aHost.second.isEmpty() && !answer.contains(aHost.second.toLatin1())) {
-        toLog(LogLevel::Error,
-              QString("Server answer verify failed '%1'.\nServer response: '%2'.")
-                  .arg(aHost.second)
-                  .arg(QString::fromUtf8(answer).left(1024)));
-
-        traceLog();
+    continueWatch();
+}
 
-        return false;
+//--------------------------------------------------------------------------------
+void ConnectionBase::continueWatch() {
+    if (isConnected(true)) {
+        toLog(LogLevel::Debug, "Check timer START.");
+        m_CheckTimer.start();
+    } else {
+        emit connectionLost();
     }
+}
 
-    toLog(LogLevel::Normal, "Connection check ok.");
-
-    return true;
+//--------------------------------------------------------------------------------
+bool ConnectionBase::httpCheckMethod(const IConnection::CheckUrl &aHost) {
+    return m_Probe.check(QList<CheckUrl>() << aHost);
 }
 
 //----------------------------------------------------------------------------
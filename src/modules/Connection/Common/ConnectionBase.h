@@ -11,6 +11,7 @@
 #include <Common/ILogable.h>
 
 #include "Connection/IConnection.h"
+#include "ConnectionProbe.h"
 
 //--------------------------------------------------------------------------------
 /// Константы
@@ -22,7 +23,7 @@ const QString LogName = "Connection";
 //--------------------------------------------------------------------------------
 /// Базовый класс соединения.
 /// Управляет таймерами проверки соединения и реализует метод проверки
-/// соединения по HTTP.
+/// соединения по HTTP. Хосты проверяются параллельно через ConnectionProbe.
 class ConnectionBase : public IConnection {
     Q_OBJECT
 
@@ -45,15 +46,22 @@ public:
     /// Проверяет установленно ли соединение.
     virtual bool isConnected(bool aUseCache) noexcept(false);
 
-    /// Физически проверяет соединение выполняя HTTP запрос.
+    /// Физически проверяет соединение выполняя HTTP запрос. Без параметра все хосты
+    /// проверяются одновременно, ожидание не дольше таймаута одного запроса.
     virtual bool checkConnection(const CheckUrl &aHost = CheckUrl()) noexcept(false);
 
     /// Устанавливает список хостов для проверки соединения.
     virtual void setCheckHosts(const QList<IConnection::CheckUrl> &aHosts);
 
+    /// Результат последней проверки хостов, без ожидания.
+    ConnectionProbe::SHealth getHealth() const;
+
 protected slots:
     void onCheckTimeout();
 
+    /// Результат периодической проверки хостов.
+    void onProbeFinished(bool aAlive);
+
 protected:
     virtual void doConnect() noexcept(false) = 0;
     virtual void doDisconnect() noexcept(false) = 0;
@@ -62,6 +70,9 @@ protected:
 
     bool httpCheckMethod(const IConnection::CheckUrl &aHost);
 
+    /// Перезапускает таймер проверки или сообщает о потере соединения.
+    void continueWatch();
+
     void toLog(LogLevel::Enum aLevel, const QString &aMessage) const;
 
     NetworkTaskManager *m_Network;
@@ -74,6 +85,7 @@ protected:
     QTimer m_CheckTimer;
     QList<CheckUrl> m_CheckHosts;
     ILog *m_Log;
+    ConnectionProbe m_Probe;
 };
 
 //--------------------------------------------------------------------------------
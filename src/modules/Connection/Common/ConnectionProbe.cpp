@@ -0,0 +1,400 @@
+/* @file Параллельная проверка доступности хостов с кешем состояния связи. */
+
+#include "ConnectionProbe.h"
+
+#include <QtCore/QMutexLocker>
+#include <QtCore/QStringList>
+
+#include <NetworkTaskManager/MemoryDataStream.h>
+#include <NetworkTaskManager/NetworkTask.h>
+#include <NetworkTaskManager/NetworkTaskManager.h>
+
+//--------------------------------------------------------------------------------
+qint64 ConnectionProbe::SHostStats::averageLatency() const {
+    if (latencies.isEmpty()) {
+        return -1;
+    }
+
+    qint64 sum = 0;
+
+    foreach (qint64 latency, latencies) {
+        sum += latency;
+    }
+
+    return sum / latencies.size();
+}
+
+//--------------------------------------------------------------------------------
+ConnectionProbe::ConnectionProbe(NetworkTaskManager *aNetwork, ILog *aLog)
+    : m_Network(aNetwork), m_Log(aLog), m_Timeout(CConnectionProbe::Timeout),
+      m_Quorum(CConnectionProbe::Quorum), m_BackoffBase(CConnectionProbe::BackoffBase),
+      m_BackoffMax(CConnectionProbe::BackoffMax), m_Round(0), m_Running(false),
+      m_Settled(false), m_Async(false), m_Pending(0), m_Successes(0), m_RoundQuorum(0) {
+    m_Clock.start();
+}
+
+//--------------------------------------------------------------------------------
+ConnectionProbe::~ConnectionProbe() {
+    // Владелец уже разрушается, результат прерванной проверки ему не нужен.
+    blockSignals(true);
+
+    finishRound();
+}
+
+//--------------------------------------------------------------------------------
+void ConnectionProbe::setTimeout(int aMsec) {
+    m_Timeout = aMsec;
+}
+
+//--------------------------------------------------------------------------------
+void ConnectionProbe::setQuorum(int aQuorum) {
+    m_Quorum = qMax(1, aQuorum);
+}
+
+//--------------------------------------------------------------------------------
+void ConnectionProbe::setBackoff(qint64 aBase, qint64 aMax) {
+    QMutexLocker lock(&m_Mutex);
+
+    m_BackoffBase = aBase;
+    m_BackoffMax = qMax(aBase, aMax);
+}
+
+//--------------------------------------------------------------------------------
+bool ConnectionProbe::start(const QList<IConnection::CheckUrl> &aHosts) {
+    return startRound(aHosts, true);
+}
+
+//--------------------------------------------------------------------------------
+bool ConnectionProbe::check(const QList<IConnection::CheckUrl> &aHosts) {
+    {
+        QMutexLocker lock(&m_Mutex);
+
+        while (m_Running && !m_Settled) {
+            m_SettledCondition.wait(&m_Mutex);
+        }
+    }
+
+    // Итог асинхронной проверки публикуется до начала новой.
+    finishRound();
+
+    if (!startRound(aHosts, false)) {
+        return false;
+    }
+
+    {
+        QMutexLocker lock(&m_Mutex);
+
+        while (!m_Settled) {
+            m_SettledCondition.wait(&m_Mutex);
+        }
+    }
+
+    finishRound();
+
+    return getHealth().alive;
+}
+
+//--------------------------------------------------------------------------------
+bool ConnectionProbe::isRunning() const {
+    QMutexLocker lock(&m_Mutex);
+
+    return m_Running;
+}
+
+//--------------------------------------------------------------------------------
+ConnectionProbe::SHealth ConnectionProbe::getHealth() const {
+    QMutexLocker lock(&m_Mutex);
+
+    return m_Health;
+}
+
+//--------------------------------------------------------------------------------
+ConnectionProbe::SHostStats ConnectionProbe::getHostStats(const QUrl &aHost) const {
+    QMutexLocker lock(&m_Mutex);
+
+    return m_Hosts.value(aHost);
+}
+
+//--------------------------------------------------------------------------------
+bool ConnectionProbe::startRound(const QList<IConnection::CheckUrl> &aHosts, bool aAsync) {
+    if (!m_Network) {
+        toLog(LogLevel::Error, "Failed to check connection. Network interface is not specified.");
+
+        return false;
+    }
+
+    QList<NetworkTask *> tasks;
+
+    {
+        QMutexLocker lock(&m_Mutex);
+
+        if (m_Running) {
+            return false;
+        }
+
+        QList<IConnection::CheckUrl> hosts = selectHosts(aHosts);
+
+        if (hosts.isEmpty()) {
+            return false;
+        }
+
+        ++m_Round;
+        m_Running = true;
+        m_Settled = false;
+        m_Async = aAsync;
+        m_Pending = hosts.size();
+        m_Successes = 0;
+        m_RoundQuorum = qMin(m_Quorum, hosts.size());
+        m_RoundHealth = SHealth();
+        m_Probes.clear();
+
+        QStringList names;
+
+        for (int i = 0; i < hosts.size(); ++i) {
+            auto *task = new NetworkTask();
+
+            task->setTimeout(m_Timeout);
+            task->setUrl(hosts[i].first);
+            // По-хорошему, тут должен быть HEAD-запрос, но он почему-то не проходит
+            // аутентификацию на прокси-сервере.
+            task->setType(NetworkTask::Get);
+            task->setTrafficClass(NetworkTask::Monitoring);
+            task->setDataStream(new MemoryDataStream());
+
+            // Ответ обрабатывается прямо в потоке менеджера сети: поток проверки может ждать
+            // итог, не обрабатывая события.
+            int round = m_Round;
+            connect(
+                task,
+                &NetworkTask::onComplete,
+                this,
+                [this, round, i]() { onTaskComplete(round, i); },
+                Qt::DirectConnection);
+
+            SProbe probe = {hosts[i], task, false};
+            m_Probes << probe;
+            tasks << task;
+            names << hosts[i].first.toString();
+        }
+
+        toLog(LogLevel::Normal, QString("Checking connection on %1...").arg(names.join(", ")));
+    }
+
+    foreach (NetworkTask *task, tasks) {
+        m_Network->addTask(task);
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+void ConnectionProbe::onTaskComplete(int aRound, int aIndex) {
+    QMutexLocker lock(&m_Mutex);
+
+    // Задачи завершённой проверки уже сняты и ждут удаления.
+    if (aRound != m_Round || aIndex >= m_Probes.size()) {
+        return;
+    }
+
+    // Завершённую задачу finishRound не снимает, даже если итог уже подведён.
+    SProbe &probe = m_Probes[aIndex];
+    probe.done = true;
+
+    // Ответы, пришедшие после подведения итога, не учитываются.
+    if (m_Settled) {
+        return;
+    }
+
+    --m_Pending;
+
+    bool ok = isAnswerValid(probe);
+    qint64 latency = probe.task->getTimings().total;
+    SHostStats &stats = m_Hosts[probe.host.first];
+
+    if (ok) {
+        stats.latencies << latency;
+
+        while (stats.latencies.size() > CConnectionProbe::HistorySize) {
+            stats.latencies.removeFirst();
+        }
+
+        stats.failures = 0;
+        stats.retryAt = 0;
+
+        ++m_Successes;
+
+        if (m_RoundHealth.latency < 0) {
+            m_RoundHealth.host = probe.host.first;
+            m_RoundHealth.latency = latency;
+        }
+
+        toLog(LogLevel::Normal,
+              QString("Connection check ok: %1, %2 ms.")
+                  .arg(probe.host.first.toString())
+                  .arg(latency));
+    } else {
+        ++stats.failures;
+
+        qint64 backoff = m_BackoffBase;
+
+        for (int i = 1; i < stats.failures && backoff < m_BackoffMax; ++i) {
+            backoff *= 2;
+        }
+
+        stats.retryAt = m_Clock.elapsed() + qMin(backoff, m_BackoffMax);
+    }
+
+    bool alive = m_Successes >= m_RoundQuorum;
+
+    // Итог известен, если кворум набран или набрать его уже нельзя.
+    if (alive || m_Successes + m_Pending < m_RoundQuorum) {
+        m_Settled = true;
+        m_RoundHealth.alive = alive;
+        m_SettledCondition.wakeAll();
+
+        QMetaObject::invokeMethod(this, "onSettled", Qt::QueuedConnection, Q_ARG(int, aRound));
+    }
+}
+
+//--------------------------------------------------------------------------------
+bool ConnectionProbe::isAnswerValid(const SProbe &aProbe) const {
+    NetworkTask *task = aProbe.task;
+    QByteArray answer = task->getDataStream()->takeAll();
+
+    auto traceLog = [&]() {
+        toLog(LogLevel::Trace,
+              QString("error:%1 http_code:%2").arg(task->getError()).arg(task->getHttpError()));
+
+        QStringList response;
+        QMapIterator<QByteArray, QByteArray> i(task->getResponseHeader());
+        while (i.hasNext()) {
+            i.next();
+            response << QString("%1: %2")
+                            .arg(QString::fromLatin1(i.key()))
+                            .arg(QString::fromLatin1(i.value()));
+        }
+
+        toLog(LogLevel::Trace,
+              QString("HEADER:\n%1\nBODY:\n%2")
+                  .arg(response.join("\n"))
+                  .arg(QString::fromLatin1(answer.left(80))));
+    };
+
+    if (task->getError() != NetworkTask::NoError) {
+        toLog(LogLevel::Error,
+              QString("Connection check failed on %1. Error %2.")
+                  .arg(aProbe.host.first.toString())
+                  .arg(task->errorString()));
+
+        traceLog();
+
+        return false;
+    }
+
+    if (!aProbe.host.second.isEmpty() && !answer.contains(aProbe.host.second.toLatin1())) {
+        toLog(LogLevel::Error,
+              QString("Server answer verify failed '%1'.\nServer response: '%2'.")
+                  .arg(aProbe.host.second)
+                  .arg(QString::fromUtf8(answer).left(1024)));
+
+        traceLog();
+
+        return false;
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+void ConnectionProbe::onSettled(int aRound) {
+    bool current = false;
+
+    {
+        QMutexLocker lock(&m_Mutex);
+
+        current = aRound == m_Round && m_Running;
+    }
+
+    if (current) {
+        finishRound();
+    }
+}
+
+//--------------------------------------------------------------------------------
+void ConnectionProbe::finishRound() {
+    QList<NetworkTask *> tasks;
+    QList<NetworkTask *> running;
+    bool async = false;
+    bool alive = false;
+
+    {
+        QMutexLocker lock(&m_Mutex);
+
+        if (!m_Running) {
+            return;
+        }
+
+        // Проверку прервали до итога (удаление объекта): ответы больше не нужны.
+        m_Settled = true;
+        m_Running = false;
+
+        // Флаг done выставляется под этой же блокировкой, поэтому снимаются только задачи,
+        // ответ на которые ещё не получен.
+        foreach (const SProbe &probe, m_Probes) {
+            tasks << probe.task;
+
+            if (!probe.done) {
+                running << probe.task;
+            }
+        }
+
+        m_Probes.clear();
+
+        async = m_Async;
+        alive = m_RoundHealth.alive;
+
+        m_Health = m_RoundHealth;
+        m_Health.checked = QDateTime::currentDateTime();
+    }
+
+    foreach (NetworkTask *task, running) {
+        m_Network->removeTask(task);
+    }
+
+    foreach (NetworkTask *task, tasks) {
+        task->waitForFinished();
+        task->deleteLater();
+    }
+
+    if (!alive) {
+        toLog(LogLevel::Error, "Connection check failed on all hosts.");
+    }
+
+    if (async) {
+        emit finished(alive);
+    }
+}
+
+//--------------------------------------------------------------------------------
+QList<IConnection::CheckUrl>
+ConnectionProbe::selectHosts(const QList<IConnection::CheckUrl> &aHosts) const {
+    QList<IConnection::CheckUrl> hosts;
+    qint64 now = m_Clock.elapsed();
+
+    foreach (const IConnection::CheckUrl &host, aHosts) {
+        if (m_Hosts.value(host.first).retryAt <= now) {
+            hosts << host;
+        }
+    }
+
+    return hosts.isEmpty() ? aHosts : hosts;
+}
+
+//--------------------------------------------------------------------------------
+void ConnectionProbe::toLog(LogLevel::Enum aLevel, const QString &aMessage) const {
+    if (m_Log) {
+        m_Log->write(aLevel, aMessage);
+    }
+}
+
+//--------------------------------------------------------------------------------
@@ -0,0 +1,158 @@
+/* @file Параллельная проверка доступности хостов с кешем состояния связи. */
+
+#pragma once
+
+#include <QtCore/QDateTime>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QUrl>
+#include <QtCore/QWaitCondition>
+
+#include <Common/ILog.h>
+
+#include "Connection/IConnection.h"
+
+class NetworkTask;
+class NetworkTaskManager;
+
+//--------------------------------------------------------------------------------
+namespace CConnectionProbe {
+/// Таймаут запроса к одному хосту.
+const int Timeout = 30 * 1000; // 30 секунд
+
+/// Число успешных ответов, после которого связь считается установленной.
+const int Quorum = 1;
+
+/// Число последних задержек, хранимых для хоста.
+const int HistorySize = 16;
+
+/// Пауза перед повторной проверкой недоступного хоста. Удваивается после каждой неудачи.
+const qint64 BackoffBase = 60 * 1000;     // 1 минута
+const qint64 BackoffMax = 30 * 60 * 1000; // 30 минут
+} // namespace CConnectionProbe
+
+//--------------------------------------------------------------------------------
+/// Проверка связи: запросы ко всем хостам уходят одновременно, результат известен после
+/// первого успешного ответа (или набора кворума) либо после отказа всех хостов. Для хостов
+/// ведётся история задержек; недоступный хост пропускается в следующих проверках с
+/// экспоненциально растущей паузой. Результат последней проверки доступен без ожидания из
+/// любого потока.
+class ConnectionProbe : public QObject {
+    Q_OBJECT
+
+public:
+    /// Состояние связи по результату последней завершённой проверки.
+    struct SHealth {
+        bool alive;
+        QDateTime checked; // время проверки, пусто - проверок ещё не было
+        QUrl host;         // первый ответивший хост
+        qint64 latency;    // задержка его ответа, мс; -1 - ответа не было
+
+        SHealth() : alive(false), latency(-1) {}
+    };
+
+    /// Статистика проверок хоста.
+    struct SHostStats {
+        QList<qint64> latencies; // задержки последних успешных проверок, мс
+        int failures;            // число неудачных проверок подряд
+        qint64 retryAt;          // до этого момента хост не проверяется, мс
+
+        SHostStats() : failures(0), retryAt(0) {}
+
+        /// Средняя задержка, -1 - успешных проверок не было.
+        qint64 averageLatency() const;
+    };
+
+    ConnectionProbe(NetworkTaskManager *aNetwork, ILog *aLog);
+    virtual ~ConnectionProbe();
+
+    /// Таймаут запроса к одному хосту, мс.
+    void setTimeout(int aMsec);
+
+    /// Число успешных ответов, достаточное для вывода о наличии связи.
+    void setQuorum(int aQuorum);
+
+    /// Начальная и максимальная пауза перед повторной проверкой недоступного хоста, мс.
+    void setBackoff(qint64 aBase, qint64 aMax);
+
+    /// Запускает проверку хостов aHosts и сразу возвращает управление. Результат - сигнал
+    /// finished. Возвращает false, если проверка уже идёт или хосты не заданы.
+    bool start(const QList<IConnection::CheckUrl> &aHosts);
+
+    /// Проверяет хосты aHosts и ждёт результата, не запуская цикл событий. Идущая
+    /// асинхронная проверка сначала доводится до конца.
+    bool check(const QList<IConnection::CheckUrl> &aHosts);
+
+    /// Идёт ли проверка.
+    bool isRunning() const;
+
+    /// Результат последней проверки. Потокобезопасен.
+    SHealth getHealth() const;
+
+    /// Статистика хоста. Потокобезопасен.
+    SHostStats getHostStats(const QUrl &aHost) const;
+
+signals:
+    /// Асинхронная проверка завершена.
+    void finished(bool aAlive);
+
+private slots:
+    /// Итог проверки aRound набран, задачи можно освободить.
+    void onSettled(int aRound);
+
+private:
+    /// Запрос к одному хосту.
+    struct SProbe {
+        IConnection::CheckUrl host;
+        NetworkTask *task;
+        bool done;
+    };
+
+    /// Запускает проверку. aAsync - сообщить результат сигналом finished.
+    bool startRound(const QList<IConnection::CheckUrl> &aHosts, bool aAsync);
+
+    /// Обработка ответа хоста, вызывается в потоке менеджера сети.
+    void onTaskComplete(int aRound, int aIndex);
+
+    /// Проверяет ответ хоста.
+    bool isAnswerValid(const SProbe &aProbe) const;
+
+    /// Отменяет оставшиеся запросы, освобождает задачи и публикует результат.
+    void finishRound();
+
+    /// Хосты, которые пора проверять. Если таких нет, проверяются все.
+    QList<IConnection::CheckUrl> selectHosts(const QList<IConnection::CheckUrl> &aHosts) const;
+
+    void toLog(LogLevel::Enum aLevel, const QString &aMessage) const;
+
+private:
+    NetworkTaskManager *m_Network;
+    ILog *m_Log;
+
+    int m_Timeout;
+    int m_Quorum;
+    qint64 m_BackoffBase;
+    qint64 m_BackoffMax;
+    QElapsedTimer m_Clock;
+
+    mutable QMutex m_Mutex;
+    QWaitCondition m_SettledCondition;
+
+    int m_Round;       // номер текущей проверки
+    bool m_Running;    // проверка запущена и её задачи ещё не освобождены
+    bool m_Settled;    // итог текущей проверки известен
+    bool m_Async;      // текущая проверка запущена через start
+    int m_Pending;     // запросы без ответа
+    int m_Successes;   // успешные ответы
+    int m_RoundQuorum; // кворум текущей проверки
+    QList<SProbe> m_Probes;
+    SHealth m_RoundHealth;
+
+    SHealth m_Health;
+    QHash<QUrl, SHostStats> m_Hosts;
+};
+
+//--------------------------------------------------------------------------------
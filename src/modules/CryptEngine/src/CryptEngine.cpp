@@ -23,14 +23,151 @@ const int IprivHashAlg = IPRIV_ALG_MD5;
 const int IprivHashAlg = IPRIV_ALG_SHA256;
 #endif
 
-const int DecryptMaxBufferSize = 4096; // Максимальный размер для расшифровывания данных.
-const int KeyExportBufferSize = 4096;  // Размер памяти для экспорта публичного ключа.
+const int DecryptMaxBufferSize = 4096;     // Максимальный размер для расшифровывания данных.
+const int KeyExportBufferSize = 4096;      // Размер памяти для экспорта публичного ключа.
 const int KeySize = 2048;
+const int SignOverhead = 2048;             // Запас под подпись в подписанном документе.
+const int SignDetachBufferSize = 4096;     // Размер памяти для отделённой подписи.
+const int MaxCachedBufferSize = 64 * 1024; // Буферы больше не кешируются потоком.
 
 ICryptEngine &instance() {
     static CryptEngine cryptEngine;
     return cryptEngine;
 }
+
+//---------------------------------------------------------------------------
+/// Буфер результата операции. Буфер до MaxCachedBufferSize принадлежит потоку и переживает
+/// вызов, поэтому повторные операции не выделяют память под выход заново.
+class OutputBuffer {
+public:
+    explicit OutputBuffer(int aSize) {
+        if (aSize <= MaxCachedBufferSize) {
+            thread_local QByteArray cached;
+
+            if (cached.size() < aSize) {
+                cached.resize(aSize);
+            }
+
+            m_Buffer = &cached;
+        } else {
+            m_Own.resize(aSize);
+            m_Buffer = &m_Own;
+        }
+    }
+
+    char *data() { return m_Buffer->data(); }
+    int size() const { return m_Buffer->size(); }
+
+    /// Возвращает первые aSize байт результата.
+    QByteArray take(int aSize) {
+        if (m_Buffer == &m_Own) {
+            m_Own.resize(aSize);
+            return m_Own;
+        }
+
+        return QByteArray(m_Buffer->constData(), aSize);
+    }
+
+private:
+    QByteArray *m_Buffer;
+    QByteArray m_Own;
+};
+
+//---------------------------------------------------------------------------
+/// Захватывает ключ пары на время операции.
+class KeyLocker {
+public:
+    KeyLocker(const TKeyPairContext &aContext, CCrypt::ETypeKey aKey)
+        : m_Context(aContext), m_Mutex(nullptr) {
+        if (!m_Context) {
+            return;
+        }
+
+        if (m_Context->engineMutex) {
+            m_Context->engineMutex->lock();
+        }
+
+        m_Mutex = (aKey == CCrypt::ETypeKey::Public) ? &m_Context->publicMutex
+                                                     : &m_Context->secretMutex;
+        m_Mutex->lock();
+        m_Key = (aKey == CCrypt::ETypeKey::Public) ? &m_Context->keys.second
+                                                   : &m_Context->keys.first;
+    }
+
+    ~KeyLocker() {
+        if (m_Mutex) {
+            m_Mutex->unlock();
+
+            if (m_Context->engineMutex) {
+                m_Context->engineMutex->unlock();
+            }
+        }
+    }
+
+    /// Ключ, nullptr - пары нет или она уже выгружена.
+    IPRIV_KEY *key() const { return (m_Mutex && !m_Context->released) ? m_Key : nullptr; }
+
+private:
+    Q_DISABLE_COPY(KeyLocker)
+
+    TKeyPairContext m_Context;
+    QMutex *m_Mutex;
+    IPRIV_KEY *m_Key = nullptr;
+};
+
+//---------------------------------------------------------------------------
+/// Закрывает ключи выгружаемой пары, дождавшись завершения начатых операций.
+void closeKeyPair(const TKeyPairContext &aContext) {
+    if (aContext->engineMutex) {
+        aContext->engineMutex->lock();
+    }
+
+    {
+        QMutexLocker secretLocker(&aContext->secretMutex);
+        QMutexLocker publicLocker(&aContext->publicMutex);
+
+        Crypt_CloseKey(&aContext->keys.first);
+        Crypt_CloseKey(&aContext->keys.second);
+
+        aContext->released = true;
+    }
+
+    if (aContext->engineMutex) {
+        aContext->engineMutex->unlock();
+    }
+}
+
+//---------------------------------------------------------------------------
+int signData(IPRIV_KEY *aKey, const QByteArray &aRequest, QByteArray &aSignature) {
+    OutputBuffer buffer(aRequest.size() + SignOverhead);
+
+    int res = ::Crypt_SignEx(
+        aRequest.data(), aRequest.size(), buffer.data(), buffer.size(), aKey, IprivHashAlg);
+
+    if (res > 0) {
+        aSignature = buffer.take(res);
+    }
+
+    return res;
+}
+
+//---------------------------------------------------------------------------
+int verifyData(IPRIV_KEY *aKey, const QByteArray &aResponseString, QByteArray &aOriginalResponse) {
+    const char *originalResponseData = nullptr;
+    int originalResponseDataSize = 0;
+
+    int res = ::Crypt_Verify(aResponseString.data(),
+                             aResponseString.size(),
+                             &originalResponseData,
+                             &originalResponseDataSize,
+                             aKey);
+
+    if (res == 0) {
+        aOriginalResponse = QByteArray(originalResponseData, originalResponseDataSize);
+    }
+
+    return res;
+}
 } // namespace CCryptEngine
 
 //---------------------------------------------------------------------------
@@ -203,18 +340,16 @@ QByteArray CryptEngine::generatePassword() const {
 bool CryptEngine::exportSecretKey(int aKeyPair,
                                   QByteArray &aSecretKey,
                                   const QByteArray &aPassword) {
-    QMutexLocker locker(&m_Mutex);
+    CCryptEngine::KeyLocker secretKey(findKeyPair(aKeyPair), CCrypt::ETypeKey::Private);
 
-    if (!m_KeyPairs.contains(aKeyPair)) {
+    if (!secretKey.key()) {
         return false;
     }
 
     aSecretKey.resize(CCryptEngine::KeyExportBufferSize);
 
-    TKeyPair pair = m_KeyPairs[aKeyPair];
-
-    int result =
-        Crypt_ExportSecretKey(aSecretKey.data(), aSecretKey.size(), aPassword.data(), &pair.first);
+    int result = Crypt_ExportSecretKey(
+        aSecretKey.data(), aSecretKey.size(), aPassword.data(), secretKey.key());
     if (result <= 0) {
         return false;
     }
@@ -248,24 +383,26 @@ bool CryptEngine::exportSecretKeyToFile(int aKeyPair,
 
 //---------------------------------------------------------------------------
 bool CryptEngine::exportPublicKey(int aKeyPair, QByteArray &aPublicKey, ulong &aSerialNumber) {
-    QMutexLocker locker(&m_Mutex);
+    TKeyPairContext context = findKeyPair(aKeyPair);
 
-    if (!m_KeyPairs.contains(aKeyPair)) {
+    // Порядок захвата - закрытый, затем открытый ключ.
+    CCryptEngine::KeyLocker secretKey(context, CCrypt::ETypeKey::Private);
+    CCryptEngine::KeyLocker publicKey(context, CCrypt::ETypeKey::Public);
+
+    if (!secretKey.key() || !publicKey.key()) {
         return false;
     }
 
     aPublicKey.resize(CCryptEngine::KeyExportBufferSize);
 
-    TKeyPair pair = m_KeyPairs[aKeyPair];
-
-    int result =
-        Crypt_ExportPublicKey(aPublicKey.data(), aPublicKey.size(), &pair.second, &pair.first);
+    int result = Crypt_ExportPublicKey(
+        aPublicKey.data(), aPublicKey.size(), publicKey.key(), secretKey.key());
     if (result <= 0) {
         return false;
     }
 
     aPublicKey.resize(result);
-    aSerialNumber = pair.second.keyserial;
+    aSerialNumber = publicKey.key()->keyserial;
 
     return true;
 }
@@ -300,8 +437,10 @@ bool CryptEngine::exportPublicKeyToFile(int aKeyPair,
 bool CryptEngine::replacePublicKey(int aKeyPair, const QByteArray &aPublicKey) {
     QMutexLocker locker(&m_Mutex);
 
+    CCryptEngine::KeyLocker publicKey(findKeyPair(aKeyPair), CCrypt::ETypeKey::Public);
+
     // Проверяем есть ли такая пара.
-    if (!m_KeyPairs.contains(aKeyPair)) {
+    if (!publicKey.key()) {
         return false;
     }
 
@@ -313,9 +452,9 @@ bool CryptEngine::replacePublicKey(int aKeyPair, const QByteArray &aPublicKey) {
         return false;
     }
 
-    Crypt_CloseKey(&m_KeyPairs[aKeyPair].second);
+    Crypt_CloseKey(publicKey.key());
 
-    m_KeyPairs[aKeyPair].second = key;
+    *publicKey.key() = key;
 
     return true;
 }
@@ -340,13 +479,6 @@ bool CryptEngine::createKeyPair(int aKeyPair,
 
     QMutexLocker locker(&m_Mutex);
 
-    std::optional<TKeyPair> oldPair;
-
-    // Если уже загружена эта пара, то выгружаем и перетираем.
-    if (m_KeyPairs.contains(aKeyPair)) {
-        oldPair = m_KeyPairs.take(aKeyPair);
-    }
-
     if (aEngine == CCrypt::ETypeEngine::RuToken) {
         Crypt_Ctrl_Int(aEngine, IPRIV_ENGCMD_SET_PKCS11_SLOT, 0);
         Crypt_Ctrl_String(aEngine, IPRIV_ENGCMD_SET_PIN, getRootPassword()[0].data());
@@ -354,24 +486,16 @@ bool CryptEngine::createKeyPair(int aKeyPair,
 
     TKeyPair pair;
 
+    // Прежняя пара остаётся доступной, пока не создана новая.
     int result = Crypt_GenKey(
         aEngine, aKeyCard.data(), aKeyCard.size(), &pair.first, &pair.second, aKeySize);
     if (result != 0) {
         aErrorDescription = errorToString(result);
 
-        if (oldPair.has_value()) {
-            m_KeyPairs.insert(aKeyPair, oldPair.value());
-        }
-
         return false;
     }
 
-    if (oldPair.has_value()) {
-        Crypt_CloseKey(&oldPair->first);
-        Crypt_CloseKey(&oldPair->second);
-    }
-
-    m_KeyPairs[aKeyPair] = pair;
+    insertKeyPair(aKeyPair, pair, aEngine);
 
     return true;
 }
@@ -395,10 +519,8 @@ bool CryptEngine::loadKeyPair(int aKeyPair,
 
     QMutexLocker locker(&m_Mutex);
 
-    if (m_KeyPairs.contains(aKeyPair)) {
-        // Пара ключей с таким номером уже загружена, выгружаем.
-        releaseKeyPair(aKeyPair);
-    }
+    // Пара ключей с таким номером уже загружена, выгружаем.
+    releaseKeyPair(aKeyPair);
 
     TKeyPair keyPair;
     int res = 0;
@@ -441,51 +563,88 @@ bool CryptEngine::loadKeyPair(int aKeyPair,
         return false;
     }
 
-    m_KeyPairs[aKeyPair] = keyPair;
+    insertKeyPair(aKeyPair, keyPair, aEngine);
 
     return true;
 }
 
+//---------------------------------------------------------------------------
+TKeyPairContext CryptEngine::findKeyPair(int aKeyPair) const {
+    QReadLocker locker(&m_KeyPairsLock);
+
+    return m_KeyPairs.value(aKeyPair);
+}
+
+//---------------------------------------------------------------------------
+void CryptEngine::insertKeyPair(int aKeyPair, const TKeyPair &aKeys, CCrypt::ETypeEngine aEngine) {
+    TKeyPairContext context(new SKeyPairContext());
+    context->keys = aKeys;
+
+    if (aEngine == CCrypt::ETypeEngine::RuToken) {
+        context->engineMutex = &m_Mutex;
+    }
+
+    TKeyPairContext oldContext;
+
+    {
+        QWriteLocker locker(&m_KeyPairsLock);
+
+        oldContext = m_KeyPairs.value(aKeyPair);
+        m_KeyPairs.insert(aKeyPair, context);
+    }
+
+    if (oldContext) {
+        CCryptEngine::closeKeyPair(oldContext);
+    }
+}
+
 //---------------------------------------------------------------------------
 QString CryptEngine::getKeyPairSerialNumber(int aKeyPair) {
-    QMutexLocker locker(&m_Mutex);
+    CCryptEngine::KeyLocker publicKey(findKeyPair(aKeyPair), CCrypt::ETypeKey::Public);
 
-    TKeyPairList::iterator keyPair = m_KeyPairs.find(aKeyPair);
-    if (keyPair == m_KeyPairs.end()) {
+    if (!publicKey.key()) {
         return {};
     }
 
 #ifdef TC_USE_MD5
-    return QString::number(keyPair.value().second.keyserial);
+    return QString::number(publicKey.key()->keyserial);
 #else
-    return QString::number(keyPair.value().second.keyserial) + "-sha256";
+    return QString::number(publicKey.key()->keyserial) + "-sha256";
 #endif
 }
 
 //---------------------------------------------------------------------------
 bool CryptEngine::releaseKeyPair(int aKeyPair) {
-    QMutexLocker locker(&m_Mutex);
-
-    TKeyPairList::iterator it = m_KeyPairs.find(aKeyPair);
+    TKeyPairContext context;
 
-    if (it != m_KeyPairs.end()) {
-        Crypt_CloseKey(&it.value().first);
-        Crypt_CloseKey(&it.value().second);
+    {
+        QWriteLocker locker(&m_KeyPairsLock);
 
-        m_KeyPairs.erase(it);
+        context = m_KeyPairs.take(aKeyPair);
+    }
 
-        return true;
+    if (!context) {
+        return false;
     }
 
-    return false;
+    // Начатые операции с парой завершаются, новые её уже не найдут.
+    CCryptEngine::closeKeyPair(context);
+
+    return true;
 }
 
 //---------------------------------------------------------------------------
 void CryptEngine::releaseKeyPairs() {
-    QMutexLocker locker(&m_Mutex);
+    TKeyPairList keyPairs;
 
-    while (!m_KeyPairs.isEmpty()) {
-        releaseKeyPair(m_KeyPairs.keys()[0]);
+    {
+        QWriteLocker locker(&m_KeyPairsLock);
+
+        keyPairs.swap(m_KeyPairs);
+    }
+
+    foreach (const TKeyPairContext &context, keyPairs) {
+        CCryptEngine::closeKeyPair(context);
     }
 }
 
@@ -494,23 +653,15 @@ bool CryptEngine::sign(int aKeyPair,
                        const QByteArray &aRequest,
                        QByteArray &aSignature,
                        QString &aErrorDescription) {
-    QMutexLocker locker(&m_Mutex);
+    CCryptEngine::KeyLocker secretKey(findKeyPair(aKeyPair), CCrypt::ETypeKey::Private);
 
-    TKeyPairList::iterator keyPair = m_KeyPairs.find(aKeyPair);
-    if (keyPair == m_KeyPairs.end()) {
+    if (!secretKey.key()) {
         aErrorDescription = "key pair not found";
 
         return false;
     }
 
-    aSignature.resize(aRequest.size() + 2048);
-
-    int res = ::Crypt_SignEx(aRequest.data(),
-                             aRequest.size(),
-                             aSignature.data(),
-                             aSignature.size(),
-                             &keyPair.value().first,
-                             CCryptEngine::IprivHashAlg);
+    int res = CCryptEngine::signData(secretKey.key(), aRequest, aSignature);
 
     if (res <= 0) {
         aErrorDescription = errorToString(res);
@@ -518,8 +669,6 @@ bool CryptEngine::sign(int aKeyPair,
         return false;
     }
 
-    aSignature.resize(res);
-
     return true;
 }
 
@@ -528,22 +677,21 @@ bool CryptEngine::signDetach(int aKeyPair,
                              const QByteArray &aRequest,
                              QByteArray &aSignature,
                              QString &aErrorDescription) {
-    QMutexLocker locker(&m_Mutex);
+    CCryptEngine::KeyLocker secretKey(findKeyPair(aKeyPair), CCrypt::ETypeKey::Private);
 
-    TKeyPairList::iterator keyPair = m_KeyPairs.find(aKeyPair);
-    if (keyPair == m_KeyPairs.end()) {
+    if (!secretKey.key()) {
         aErrorDescription = "key pair not found";
 
         return false;
     }
 
-    aSignature.resize(4096);
+    CCryptEngine::OutputBuffer buffer(CCryptEngine::SignDetachBufferSize);
 
     int res = ::Crypt_Sign2Ex(aRequest.data(),
                               aRequest.size(),
-                              aSignature.data(),
-                              aSignature.size(),
-                              &keyPair.value().first,
+                              buffer.data(),
+                              buffer.size(),
+                              secretKey.key(),
                               CCryptEngine::IprivHashAlg);
 
     if (res <= 0) {
@@ -552,7 +700,40 @@ bool CryptEngine::signDetach(int aKeyPair,
         return false;
     }
 
-    aSignature.resize(res);
+    aSignature = buffer.take(res);
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool CryptEngine::signBatch(int aKeyPair,
+                            const QList<QByteArray> &aRequests,
+                            QList<QByteArray> &aSignatures,
+                            QString &aErrorDescription) {
+    CCryptEngine::KeyLocker secretKey(findKeyPair(aKeyPair), CCrypt::ETypeKey::Private);
+
+    if (!secretKey.key()) {
+        aErrorDescription = "key pair not found";
+
+        return false;
+    }
+
+    aSignatures.clear();
+    aSignatures.reserve(aRequests.size());
+
+    for (int i = 0; i < aRequests.size(); ++i) {
+        QByteArray signature;
+
+        int res = CCryptEngine::signData(secretKey.key(), aRequests.at(i), signature);
+
+        if (res <= 0) {
+            aErrorDescription = QString("request %1: %2").arg(i).arg(errorToString(res));
+
+            return false;
+        }
+
+        aSignatures.append(signature);
+    }
 
     return true;
 }
@@ -562,27 +743,17 @@ bool CryptEngine::verify(int aKeyPair,
                          const QByteArray &aResponseString,
                          QByteArray &aOriginalResponse,
                          QString &aErrorDescription) {
-    QMutexLocker locker(&m_Mutex);
+    CCryptEngine::KeyLocker publicKey(findKeyPair(aKeyPair), CCrypt::ETypeKey::Public);
 
-    TKeyPairList::iterator keyPair = m_KeyPairs.find(aKeyPair);
-    if (keyPair == m_KeyPairs.end()) {
+    if (!publicKey.key()) {
         aErrorDescription = "key pair not found";
 
         return false;
     }
 
-    const char *originalResponseData = nullptr;
-    int originalResponseDataSize = 0;
-
-    int res = ::Crypt_Verify(aResponseString.data(),
-                             aResponseString.size(),
-                             &originalResponseData,
-                             &originalResponseDataSize,
-                             &keyPair.value().second);
+    int res = CCryptEngine::verifyData(publicKey.key(), aResponseString, aOriginalResponse);
 
     if (res == 0) {
-        aOriginalResponse = QByteArray(originalResponseData, originalResponseDataSize);
-
         return true;
     }
 
@@ -596,10 +767,9 @@ bool CryptEngine::verifyDetach(int aKeyPair,
                                const QByteArray &aResponseString,
                                const QByteArray &aSignature,
                                QString &aErrorDescription) {
-    QMutexLocker locker(&m_Mutex);
+    CCryptEngine::KeyLocker publicKey(findKeyPair(aKeyPair), CCrypt::ETypeKey::Public);
 
-    TKeyPairList::iterator keyPair = m_KeyPairs.find(aKeyPair);
-    if (keyPair == m_KeyPairs.end()) {
+    if (!publicKey.key()) {
         aErrorDescription = "key pair not found";
 
         return false;
@@ -609,7 +779,7 @@ bool CryptEngine::verifyDetach(int aKeyPair,
                               aResponseString.size(),
                               aSignature.data(),
                               aSignature.size(),
-                              &keyPair.value().second);
+                              publicKey.key());
 
     if (res == 0) {
         return true;
@@ -620,27 +790,56 @@ bool CryptEngine::verifyDetach(int aKeyPair,
     return false;
 }
 
+//---------------------------------------------------------------------------
+bool CryptEngine::verifyBatch(int aKeyPair,
+                              const QList<QByteArray> &aResponses,
+                              QList<QByteArray> &aOriginalResponses,
+                              QString &aErrorDescription) {
+    CCryptEngine::KeyLocker publicKey(findKeyPair(aKeyPair), CCrypt::ETypeKey::Public);
+
+    if (!publicKey.key()) {
+        aErrorDescription = "key pair not found";
+
+        return false;
+    }
+
+    aOriginalResponses.clear();
+    aOriginalResponses.reserve(aResponses.size());
+
+    for (int i = 0; i < aResponses.size(); ++i) {
+        QByteArray originalResponse;
+
+        int res = CCryptEngine::verifyData(publicKey.key(), aResponses.at(i), originalResponse);
+
+        if (res != 0) {
+            aErrorDescription = QString("response %1: %2").arg(i).arg(errorToString(res));
+
+            return false;
+        }
+
+        aOriginalResponses.append(originalResponse);
+    }
+
+    return true;
+}
+
 //---------------------------------------------------------------------------
 bool CryptEngine::encrypt(int aKeyPair,
                           const QByteArray &aData,
                           QByteArray &aResult,
                           CCrypt::ETypeKey aKey,
                           QString &aErrorDescription) {
-    QMutexLocker locker(&m_Mutex);
+    CCryptEngine::KeyLocker key(findKeyPair(aKeyPair), aKey);
 
-    TKeyPairList::iterator keyPair = m_KeyPairs.find(aKeyPair);
-    if (keyPair == m_KeyPairs.end()) {
+    if (!key.key()) {
         aErrorDescription = "key pair not found";
 
         return false;
     }
 
-    aResult.resize(CCryptEngine::DecryptMaxBufferSize);
+    CCryptEngine::OutputBuffer buffer(CCryptEngine::DecryptMaxBufferSize);
 
-    IPRIV_KEY key =
-        (aKey == CCrypt::ETypeKey::Public) ? keyPair.value().second : keyPair.value().first;
-
-    int res = ::Crypt_Encrypt(aData.data(), aData.size(), aResult.data(), aResult.size(), &key);
+    int res = ::Crypt_Encrypt(aData.data(), aData.size(), buffer.data(), buffer.size(), key.key());
 
     if (res <= 0) {
         aErrorDescription = errorToString(res);
@@ -648,7 +847,7 @@ bool CryptEngine::encrypt(int aKeyPair,
         return false;
     }
 
-    aResult.resize(res);
+    aResult = buffer.take(res);
 
     return true;
 }
@@ -667,21 +866,18 @@ bool CryptEngine::encryptLong(int aKeyPair,
                               QByteArray &aResult,
                               CCrypt::ETypeKey aKey,
                               QString &aErrorDescription) {
-    QMutexLocker locker(&m_Mutex);
+    CCryptEngine::KeyLocker key(findKeyPair(aKeyPair), aKey);
 
-    TKeyPairList::iterator keyPair = m_KeyPairs.find(aKeyPair);
-    if (keyPair == m_KeyPairs.end()) {
+    if (!key.key()) {
         aErrorDescription = "key pair not found";
 
         return false;
     }
 
-    aResult.resize((aData.size() + 1024) * 2);
+    CCryptEngine::OutputBuffer buffer((aData.size() + 1024) * 2);
 
-    IPRIV_KEY key =
-        (aKey == CCrypt::ETypeKey::Public) ? keyPair.value().second : keyPair.value().first;
-
-    int res = ::Crypt_EncryptLong(aData.data(), aData.size(), aResult.data(), aResult.size(), &key);
+    int res =
+        ::Crypt_EncryptLong(aData.data(), aData.size(), buffer.data(), buffer.size(), key.key());
 
     if (res <= 0) {
         aErrorDescription = errorToString(res);
@@ -689,7 +885,7 @@ bool CryptEngine::encryptLong(int aKeyPair,
         return false;
     }
 
-    aResult.resize(res);
+    aResult = buffer.take(res);
 
     return true;
 }
@@ -708,21 +904,17 @@ bool CryptEngine::decrypt(int aKeyPair,
                           QByteArray &aResult,
                           CCrypt::ETypeKey aKey,
                           QString &aErrorDescription) {
-    QMutexLocker locker(&m_Mutex);
+    CCryptEngine::KeyLocker key(findKeyPair(aKeyPair), aKey);
 
-    TKeyPairList::iterator keyPair = m_KeyPairs.find(aKeyPair);
-    if (keyPair == m_KeyPairs.end()) {
+    if (!key.key()) {
         aErrorDescription = "key pair not found";
 
         return false;
     }
 
-    aResult.resize(CCryptEngine::DecryptMaxBufferSize);
-
-    IPRIV_KEY key =
-        (aKey == CCrypt::ETypeKey::Public) ? keyPair.value().second : keyPair.value().first;
+    CCryptEngine::OutputBuffer buffer(CCryptEngine::DecryptMaxBufferSize);
 
-    int res = ::Crypt_Decrypt(aData.data(), aData.size(), aResult.data(), aResult.size(), &key);
+    int res = ::Crypt_Decrypt(aData.data(), aData.size(), buffer.data(), buffer.size(), key.key());
 
     if (res <= 0) {
         aErrorDescription = errorToString(res);
@@ -730,7 +922,7 @@ bool CryptEngine::decrypt(int aKeyPair,
         return false;
     }
 
-    aResult.resize(res);
+    aResult = buffer.take(res);
 
     return true;
 }
@@ -749,21 +941,18 @@ bool CryptEngine::decryptLong(int aKeyPair,
                               QByteArray &aResult,
                               CCrypt::ETypeKey aKey,
                               QString &aErrorDescription) {
-    QMutexLocker locker(&m_Mutex);
+    CCryptEngine::KeyLocker key(findKeyPair(aKeyPair), aKey);
 
-    TKeyPairList::iterator keyPair = m_KeyPairs.find(aKeyPair);
-    if (keyPair == m_KeyPairs.end()) {
+    if (!key.key()) {
         aErrorDescription = "key pair not found";
 
         return false;
     }
 
-    aResult.resize((aData.size() + 1024) * 2);
-
-    IPRIV_KEY key =
-        (aKey == CCrypt::ETypeKey::Public) ? keyPair.value().second : keyPair.value().first;
+    CCryptEngine::OutputBuffer buffer((aData.size() + 1024) * 2);
 
-    int res = ::Crypt_DecryptLong(aData.data(), aData.size(), aResult.data(), aResult.size(), &key);
+    int res =
+        ::Crypt_DecryptLong(aData.data(), aData.size(), buffer.data(), buffer.size(), key.key());
 
     if (res <= 0) {
         aErrorDescription = errorToString(res);
@@ -771,7 +960,7 @@ bool CryptEngine::decryptLong(int aKeyPair,
         return false;
     }
 
-    aResult.resize(res);
+    aResult = buffer.take(res);
 
     return true;
 }
@@ -3,12 +3,27 @@
 
 #include <DatabaseProxy/IDatabaseProxy.h>
 
-DatabaseQuery::DatabaseQuery(const QSqlDatabase &db, IDatabaseQueryChecker *aQueryChecker)
+#include "StatementCache.h"
+
+DatabaseQuery::DatabaseQuery(const QSqlDatabase &db,
+                             IDatabaseQueryChecker *aQueryChecker,
+                             const QSharedPointer<StatementCache> &aCache)
     : QSqlQuery(db), m_Log(ILog::getInstance(CIDatabaseQuery::DefaultLog)),
-      m_QueryChecker(aQueryChecker) {}
+      m_QueryChecker(aQueryChecker), m_Cache(aCache), m_CacheGeneration(0) {}
+
+//---------------------------------------------------------------------------
+DatabaseQuery::~DatabaseQuery() {
+    releaseStatement();
+}
 
 //---------------------------------------------------------------------------
-DatabaseQuery::~DatabaseQuery() = default;
+void DatabaseQuery::releaseStatement() {
+    if (m_Cache && !m_CachedQuery.isEmpty()) {
+        m_Cache->release(m_CachedQuery, *this, m_CacheGeneration);
+    }
+
+    m_CachedQuery.clear();
+}
 
 //---------------------------------------------------------------------------
 bool DatabaseQuery::first() {
@@ -42,6 +57,19 @@ QVariant DatabaseQuery::value(int i) const {
 
 //---------------------------------------------------------------------------
 bool DatabaseQuery::prepare(const QString &aQuery) {
+    releaseStatement();
+
+    if (m_Cache) {
+        // Номер берём до подготовки: если соединение сменится, запрос не вернётся в кэш.
+        m_CacheGeneration = m_Cache->generation();
+
+        if (m_Cache->acquire(aQuery, *this)) {
+            m_CachedQuery = aQuery;
+
+            return true;
+        }
+    }
+
     if (!QSqlQuery::prepare(aQuery)) {
         m_QueryChecker->isGood(false);
 
@@ -54,6 +82,10 @@ bool DatabaseQuery::prepare(const QString &aQuery) {
         return false;
     }
 
+    if (m_Cache) {
+        m_CachedQuery = aQuery;
+    }
+
     return true;
 }
 
@@ -86,6 +118,8 @@ bool DatabaseQuery::exec() {
 
 //---------------------------------------------------------------------------
 void DatabaseQuery::clear() {
+    releaseStatement();
+
     QSqlQuery::clear();
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QtCore/QSharedPointer>
 #include <QtCore/QString>
 #include <QtCore/QVariant>
 #include <QtSql/QtSql>
@@ -9,11 +10,16 @@
 #include <DatabaseProxy/IDatabaseQuery.h>
 
 class IDatabaseQueryChecker;
+class StatementCache;
 
 //---------------------------------------------------------------------------
 class DatabaseQuery : public IDatabaseQuery, public QSqlQuery {
 public:
-    DatabaseQuery(const QSqlDatabase &db, IDatabaseQueryChecker *aQueryChecker);
+    /// При заданном aCache подготовленный запрос берётся из кэша и возвращается в него
+    /// при повторной подготовке, очистке или удалении запроса.
+    DatabaseQuery(const QSqlDatabase &db,
+                  IDatabaseQueryChecker *aQueryChecker,
+                  const QSharedPointer<StatementCache> &aCache = QSharedPointer<StatementCache>());
     virtual ~DatabaseQuery() override;
 
     virtual bool prepare(const QString &aQuery) override;
@@ -31,9 +37,18 @@ public:
 
     virtual QVariant value(int i) const override;
 
+private:
+    /// Возвращает подготовленный запрос в кэш.
+    void releaseStatement();
+
 private:
     ILog *m_Log;
     IDatabaseQueryChecker *m_QueryChecker;
+
+    QSharedPointer<StatementCache> m_Cache;
+    /// Текст подготовленного запроса, который можно вернуть в кэш, и номер его соединения.
+    QString m_CachedQuery;
+    int m_CacheGeneration;
 };
 
 //---------------------------------------------------------------------------
@@ -26,6 +26,11 @@ void MySqlDatabaseProxy::setQueryChecker(IDatabaseQueryChecker *aQueryChecker) {
     m_QueryChecker = aQueryChecker;
 }
 
+//---------------------------------------------------------------------------
+void MySqlDatabaseProxy::setPerformance(const SDatabasePerformance & /*aPerformance*/) {
+    // Прагмы профиля относятся только к SQLite, настройки MySQL задаются на сервере.
+}
+
 //---------------------------------------------------------------------------
 bool MySqlDatabaseProxy::open(const QString &dbName,
                               const QString &user,
@@ -213,6 +218,16 @@ IDatabaseQuery *MySqlDatabaseProxy::createQuery(const QString &aQueryString) {
     return query;
 }
 
+//---------------------------------------------------------------------------
+IDatabaseQuery *MySqlDatabaseProxy::createReadQuery(const QString &aQueryString) {
+    return createQuery(aQueryString);
+}
+
+//---------------------------------------------------------------------------
+bool MySqlDatabaseProxy::acquireReadConnection() {
+    return false;
+}
+
 //---------------------------------------------------------------------------
 bool MySqlDatabaseProxy::checkIntegrity(QStringList &aListErrors) {
     Q_UNUSED(aListErrors)
@@ -35,6 +35,9 @@ public:
     /// Установить интерфейс контроля над ошибками БД
     virtual void setQueryChecker(IDatabaseQueryChecker *aQueryChecker) override;
 
+    /// Профиль производительности для MySQL не применяется.
+    virtual void setPerformance(const SDatabasePerformance &aPerformance) override;
+
     virtual bool open(const QString &dbName,
                       const QString &aUser = CMySqlDatabaseProxy::DefaultUser,
                       const QString &aPassword = CMySqlDatabaseProxy::DefaultPass,
@@ -51,6 +54,12 @@ public:
     /// Создает и подготавливает экземпляр запроса к БД.
     virtual IDatabaseQuery *createQuery(const QString &aQueryString) override;
 
+    /// Отдельных соединений чтения нет: запрос создаётся на основном соединении.
+    virtual IDatabaseQuery *createReadQuery(const QString &aQueryString) override;
+
+    /// Отдельных соединений чтения нет.
+    virtual bool acquireReadConnection() override;
+
     /*!< Выполнение DML запроса. Помещает в rowsAffected количество затронутых строк. */
     virtual bool execDML(const QString &strQuery, long &rowsAffected) override;
     /*!< Выполнение запроса, содержащего, к примеру, COUNT(*). В result записывает значение ячейки
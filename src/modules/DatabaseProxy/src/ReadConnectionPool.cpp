@@ -0,0 +1,261 @@
+/* @file Пул соединений SQLite только для чтения. */
+
+#include "ReadConnectionPool.h"
+
+#include <QtCore/QAtomicInteger>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThreadStorage>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include "SQLiteDatabaseProxy.h"
+#include "StatementCache.h"
+
+namespace CReadConnectionPool {
+/// Префикс имён соединений в QSqlDatabase.
+const QString ConnectionPrefix = "ek_reader_";
+} // namespace CReadConnectionPool
+
+namespace {
+/// Идентификаторы пулов не повторяются, поэтому соединение удалённого пула не достанется новому.
+QAtomicInteger<quint64> PoolCounter;
+} // namespace
+
+//---------------------------------------------------------------------------
+ReadConnectionPool::SThreadReaders::~SThreadReaders() {
+    for (auto it = readers.begin(); it != readers.end(); ++it) {
+        ReadConnectionPool::close(it.value());
+    }
+}
+
+//---------------------------------------------------------------------------
+ReadConnectionPool::ReadConnectionPool()
+    : ILogable(CIDatabaseProxy::LogName), m_Id(++PoolCounter), m_State(new SState()) {}
+
+//---------------------------------------------------------------------------
+ReadConnectionPool::~ReadConnectionPool() {
+    detach();
+}
+
+//---------------------------------------------------------------------------
+void ReadConnectionPool::attach(const QString &aDatabaseName,
+                                const SDatabasePerformance &aPerformance) {
+    detach();
+
+    QMutexLocker locker(&m_State->mutex);
+
+    m_State->databaseName = aDatabaseName;
+    m_State->performance = aPerformance;
+    m_State->enabled = aPerformance.readConnections > 0;
+    m_State->limitReported = false;
+}
+
+//---------------------------------------------------------------------------
+void ReadConnectionPool::detach() {
+    {
+        QMutexLocker locker(&m_State->mutex);
+
+        // Соединения других потоков закрывать отсюда нельзя: они закроются в своих потоках.
+        m_State->enabled = false;
+        m_State->generation++;
+        m_State->open = 0;
+    }
+
+    releaseCurrent();
+}
+
+//---------------------------------------------------------------------------
+bool ReadConnectionPool::acquire(QSqlDatabase &aDb, QSharedPointer<StatementCache> &aCache) {
+    SThreadReaders *local = threadReaders();
+    auto it = local->readers.find(m_Id);
+
+    if (it != local->readers.end()) {
+        {
+            QMutexLocker locker(&m_State->mutex);
+
+            if (m_State->enabled && (it->generation == m_State->generation)) {
+                aDb = it->db;
+                aCache = it->cache;
+
+                return true;
+            }
+        }
+
+        // Соединение открыто до detach, возможно к другому файлу.
+        close(it.value());
+        local->readers.erase(it);
+    }
+
+    SReader reader;
+    QString name;
+    QString databaseName;
+    SDatabasePerformance performance;
+
+    {
+        QMutexLocker locker(&m_State->mutex);
+
+        if (!m_State->enabled) {
+            return false;
+        }
+
+        if (m_State->open >= m_State->performance.readConnections) {
+            if (!m_State->limitReported) {
+                toLog(LogLevel::Normal,
+                      QString("All %1 read connections are in use, reading through the main "
+                              "connection.")
+                          .arg(m_State->performance.readConnections));
+
+                m_State->limitReported = true;
+            }
+
+            return false;
+        }
+
+        // Место занимается до открытия, чтобы соединение открывалось без блокировки пула.
+        m_State->open++;
+
+        reader.state = m_State;
+        reader.generation = m_State->generation;
+        name = CReadConnectionPool::ConnectionPrefix +
+               QString("%1_%2").arg(m_Id).arg(++m_State->counter);
+        databaseName = m_State->databaseName;
+        performance = m_State->performance;
+    }
+
+    if (!open(reader, name, databaseName, performance)) {
+        QMutexLocker locker(&m_State->mutex);
+
+        if (reader.generation == m_State->generation) {
+            m_State->open--;
+        }
+
+        return false;
+    }
+
+    local->readers.insert(m_Id, reader);
+
+    aDb = reader.db;
+    aCache = reader.cache;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+int ReadConnectionPool::size() const {
+    QMutexLocker locker(&m_State->mutex);
+
+    return m_State->open;
+}
+
+//---------------------------------------------------------------------------
+ReadConnectionPool::SThreadReaders *ReadConnectionPool::threadReaders() {
+    // Хранилище общее для всех пулов и не удаляется раньше потоков, поэтому данные каждого
+    // потока гарантированно удаляются в нём самом при его завершении.
+    static QThreadStorage<SThreadReaders *> storage;
+
+    if (!storage.hasLocalData()) {
+        storage.setLocalData(new SThreadReaders());
+    }
+
+    return storage.localData();
+}
+
+//---------------------------------------------------------------------------
+bool ReadConnectionPool::open(SReader &aReader, const QString &aName,
+                              const QString &aDatabaseName,
+                              const SDatabasePerformance &aPerformance) {
+    aReader.db = QSqlDatabase::addDatabase(CSQLiteDatabaseProxy::DriverName, aName);
+    aReader.db.setDatabaseName(aDatabaseName);
+    aReader.db.setConnectOptions(
+        QString("QSQLITE_BUSY_TIMEOUT=%1").arg(CSQLiteDatabaseProxy::BusyTimeout));
+
+    if (!aReader.db.open()) {
+        toLog(LogLevel::Warning,
+              QString("Cannot open read connection to %1: %2. Reading through the main "
+                      "connection.")
+                  .arg(aDatabaseName)
+                  .arg(aReader.db.lastError().driverText()));
+
+        aReader.db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(aName);
+
+        return false;
+    }
+
+    QStringList pragmas;
+    pragmas << "PRAGMA query_only = ON";
+
+    if (aPerformance.cacheSize != 0) {
+        pragmas << QString("PRAGMA cache_size = %1").arg(aPerformance.cacheSize);
+    }
+
+    if (aPerformance.mmapSize >= 0) {
+        pragmas << QString("PRAGMA mmap_size = %1").arg(aPerformance.mmapSize);
+    }
+
+    if (!aPerformance.tempStore.isEmpty()) {
+        pragmas << QString("PRAGMA temp_store = %1").arg(aPerformance.tempStore);
+    }
+
+    {
+        QSqlQuery query(aReader.db);
+
+        foreach (const QString &pragma, pragmas) {
+            if (!query.exec(pragma)) {
+                toLog(LogLevel::Warning,
+                      QString("Failed to apply %1 to read connection. Error: %2.")
+                          .arg(pragma)
+                          .arg(query.lastError().text()));
+            }
+        }
+    }
+
+    aReader.cache = QSharedPointer<StatementCache>(
+        new StatementCache(aPerformance.statementCacheSize));
+    aReader.cache->attach(aReader.db);
+
+    toLog(LogLevel::Debug,
+          QString("Read connection %1 opened, %2 of %3 in use.")
+              .arg(aName)
+              .arg(size())
+              .arg(aPerformance.readConnections));
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void ReadConnectionPool::close(SReader &aReader) {
+    // Кэш держит подготовленные запросы этого соединения.
+    aReader.cache->detach();
+
+    QString name = aReader.db.connectionName();
+
+    aReader.db.close();
+    aReader.db = QSqlDatabase();
+
+    QSqlDatabase::removeDatabase(name);
+
+    // Место освобождается, только если пул жив и с тех пор не переключался.
+    QSharedPointer<SState> state = aReader.state.toStrongRef();
+
+    if (state) {
+        QMutexLocker locker(&state->mutex);
+
+        if (aReader.generation == state->generation) {
+            state->open--;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+void ReadConnectionPool::releaseCurrent() {
+    SThreadReaders *local = threadReaders();
+    auto it = local->readers.find(m_Id);
+
+    if (it != local->readers.end()) {
+        close(it.value());
+        local->readers.erase(it);
+    }
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,93 @@
+/* @file Пул соединений SQLite только для чтения. */
+
+#pragma once
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QString>
+#include <QtCore/QWeakPointer>
+#include <QtSql/QSqlDatabase>
+
+#include <Common/ILogable.h>
+
+#include <DatabaseProxy/IDatabaseProxy.h>
+
+class StatementCache;
+
+//---------------------------------------------------------------------------
+/// Соединения только для чтения к файлу БД в режиме WAL, не больше одного на поток.
+/// QSqlDatabase можно использовать только в создавшем его потоке, поэтому соединение
+/// хранится в данных потока (QThreadStorage), открывается при первом обращении потока
+/// и закрывается только им самим: при завершении потока или при следующем обращении
+/// после detach/attach. Читатель видит последнюю зафиксированную транзакцию и не ждёт
+/// основное соединение.
+class ReadConnectionPool : protected ILogable {
+public:
+    ReadConnectionPool();
+    virtual ~ReadConnectionPool() override;
+
+    /// Включает пул для файла aDatabaseName. Число соединений ограничено
+    /// aPerformance.readConnections, 0 - пул выключен.
+    void attach(const QString &aDatabaseName, const SDatabasePerformance &aPerformance);
+
+    /// Выключает пул. Соединение текущего потока закрывается сразу, соединения других
+    /// потоков - ими самими и больше не выдаются.
+    void detach();
+
+    /// Возвращает соединение текущего потока и его кэш запросов, открывая соединение при первом
+    /// обращении. false - пул выключен, все соединения заняты другими потоками или ошибка.
+    bool acquire(QSqlDatabase &aDb, QSharedPointer<StatementCache> &aCache);
+
+    /// Число соединений, выданных после последнего attach.
+    int size() const;
+
+private:
+    /// Общее состояние пула. Соединения потоков ссылаются на него слабо и могут пережить пул.
+    struct SState {
+        QMutex mutex;
+        QString databaseName;
+        SDatabasePerformance performance;
+        bool enabled{false};
+        bool limitReported{false};
+
+        /// Меняется при каждом detach: соединения прошлых поколений не выдаются и не считаются.
+        quint64 generation{0};
+        int open{0};
+        int counter{0};
+    };
+
+    struct SReader {
+        QWeakPointer<SState> state;
+        quint64 generation{0};
+        QSqlDatabase db;
+        QSharedPointer<StatementCache> cache;
+    };
+
+    /// Соединения одного потока по идентификаторам пулов. Удаляется QThreadStorage
+    /// в этом же потоке при его завершении.
+    struct SThreadReaders {
+        QHash<quint64, SReader> readers;
+
+        ~SThreadReaders();
+    };
+
+    /// Соединения текущего потока.
+    static SThreadReaders *threadReaders();
+
+    /// Открывает соединение aName в текущем потоке.
+    bool open(SReader &aReader, const QString &aName, const QString &aDatabaseName,
+              const SDatabasePerformance &aPerformance);
+
+    /// Закрывает соединение. Вызывается только в потоке, открывшем соединение.
+    static void close(SReader &aReader);
+
+    /// Закрывает соединение этого пула в текущем потоке, если оно есть.
+    void releaseCurrent();
+
+private:
+    const quint64 m_Id;
+    QSharedPointer<SState> m_State;
+};
+
+//---------------------------------------------------------------------------
@@ -3,6 +3,7 @@
 
 #include <QtCore/QDir>
 #include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
 
 #include <Common/BasicApplication.h>
 #include <Common/SleepHelper.h>
@@ -10,14 +11,24 @@
 #include <memory>
 
 #include "DatabaseQuery.h"
+#include "ReadConnectionPool.h"
+#include "StatementCache.h"
 
 namespace CSQLiteDatabaseProxy {
 const int MaxTryCount = 3;
+
+/// Допустимые значения прагм профиля производительности.
+const QStringList JournalModes = QStringList() << "DELETE" << "TRUNCATE" << "PERSIST" << "MEMORY"
+                                               << "WAL" << "OFF";
+const QStringList SynchronousLevels = QStringList() << "OFF" << "NORMAL" << "FULL" << "EXTRA";
+const QStringList TempStores = QStringList() << "DEFAULT" << "FILE" << "MEMORY";
 } // namespace CSQLiteDatabaseProxy
 
 //---------------------------------------------------------------------------
 SQLiteDatabaseProxy::SQLiteDatabaseProxy()
-    : ILogable(CIDatabaseProxy::LogName), m_QueryChecker(nullptr) {}
+    : ILogable(CIDatabaseProxy::LogName), m_QueryChecker(nullptr),
+      m_StatementCache(new StatementCache(m_Performance.statementCacheSize)),
+      m_ReadPool(new ReadConnectionPool()), m_TransactionThread(nullptr) {}
 
 //---------------------------------------------------------------------------
 SQLiteDatabaseProxy::~SQLiteDatabaseProxy() = default;
@@ -27,6 +38,115 @@ void SQLiteDatabaseProxy::setQueryChecker(IDatabaseQueryChecker *aQueryChecker)
     m_QueryChecker = aQueryChecker;
 }
 
+//---------------------------------------------------------------------------
+void SQLiteDatabaseProxy::setPerformance(const SDatabasePerformance &aPerformance) {
+    QMutexLocker locker(&m_Mutex);
+
+    m_Performance = aPerformance;
+    m_StatementCache->setCapacity(m_Performance.statementCacheSize);
+
+    if (isConnected()) {
+        applyPerformance();
+        attachReadPool();
+    }
+}
+
+//---------------------------------------------------------------------------
+void SQLiteDatabaseProxy::applyPerformance() {
+    auto execPragma = [this](const QString &aPragma, QString *aResult = nullptr) -> bool {
+        QSqlQuery query(*m_Db);
+
+        // Ошибка прагмы не портит данные, поэтому не учитывается m_QueryChecker.
+        if (!query.exec(aPragma)) {
+            toLog(LogLevel::Warning,
+                  QString("Failed to apply %1. Error: %2.")
+                      .arg(aPragma)
+                      .arg(query.lastError().text()));
+
+            return false;
+        }
+
+        if (aResult && query.first()) {
+            *aResult = query.value(0).toString().toUpper();
+        }
+
+        return true;
+    };
+
+    auto checkValue = [this](const QString &aName,
+                             const QString &aValue,
+                             const QStringList &aAllowed) -> bool {
+        if (aAllowed.contains(aValue)) {
+            return true;
+        }
+
+        if (!aValue.isEmpty()) {
+            toLog(LogLevel::Warning, QString("Invalid %1 value: %2.").arg(aName).arg(aValue));
+        }
+
+        return false;
+    };
+
+    QString journalMode = m_Performance.journalMode.toUpper();
+    m_JournalMode.clear();
+
+    if (checkValue("journal_mode", journalMode, CSQLiteDatabaseProxy::JournalModes)) {
+        if (execPragma(QString("PRAGMA journal_mode = %1").arg(journalMode), &m_JournalMode) &&
+            (m_JournalMode != journalMode)) {
+            // Например, WAL недоступен на сетевых дисках.
+            toLog(LogLevel::Warning,
+                  QString("Journal mode %1 is not available, %2 is used.")
+                      .arg(journalMode)
+                      .arg(m_JournalMode));
+        }
+    } else {
+        execPragma("PRAGMA journal_mode", &m_JournalMode);
+    }
+
+    QString synchronous = m_Performance.synchronous.toUpper();
+
+    if (checkValue("synchronous", synchronous, CSQLiteDatabaseProxy::SynchronousLevels)) {
+        execPragma(QString("PRAGMA synchronous = %1").arg(synchronous));
+    }
+
+    if (m_Performance.cacheSize != 0) {
+        execPragma(QString("PRAGMA cache_size = %1").arg(m_Performance.cacheSize));
+    }
+
+    if (m_Performance.mmapSize >= 0) {
+        execPragma(QString("PRAGMA mmap_size = %1").arg(m_Performance.mmapSize));
+    }
+
+    QString tempStore = m_Performance.tempStore.toUpper();
+
+    if (checkValue("temp_store", tempStore, CSQLiteDatabaseProxy::TempStores)) {
+        execPragma(QString("PRAGMA temp_store = %1").arg(tempStore));
+    }
+
+    toLog(LogLevel::Normal,
+          QString("Database performance profile: journal_mode = %1, synchronous = %2, cache_size = "
+                  "%3, mmap_size = %4, temp_store = %5, statement cache = %6, read connections = "
+                  "%7.")
+              .arg(m_JournalMode)
+              .arg(synchronous)
+              .arg(m_Performance.cacheSize)
+              .arg(m_Performance.mmapSize)
+              .arg(tempStore)
+              .arg(m_Performance.statementCacheSize)
+              .arg(m_Performance.readConnections));
+}
+
+//---------------------------------------------------------------------------
+void SQLiteDatabaseProxy::attachReadPool() {
+    // Без WAL читатель блокирует запись, а у базы в памяти своё содержимое на каждое соединение.
+    if ((m_Performance.readConnections > 0) && (m_JournalMode == "WAL") &&
+        (m_CurrentBase != ":memory:")) {
+        m_ReadPool->attach(m_CurrentBase, m_Performance);
+    } else {
+        m_ReadPool->detach();
+    }
+}
+
 //---------------------------------------------------------------------------
 bool SQLiteDatabaseProxy::open(const QString &aDbName,
                                const QString &aUser,
@@ -58,6 +178,10 @@ bool SQLiteDatabaseProxy::open(const QString &aDbName,
     if (m_Db->open()) {
         toLog(LogLevel::Normal, QString("Database opened: %1.").arg(m_CurrentBase));
 
+        applyPerformance();
+        m_StatementCache->attach(*m_Db);
+        attachReadPool();
+
         return true;
     }
     toLog(LogLevel::Error,
@@ -70,6 +194,11 @@ bool SQLiteDatabaseProxy::open(const QString &aDbName,
 
 //---------------------------------------------------------------------------
 void SQLiteDatabaseProxy::close() {
+    m_ReadPool->detach();
+
+    // Запросы из кэша подготовлены для закрываемого соединения.
+    m_StatementCache->detach();
+
     if (isConnected()) {
         m_Db->close();
     }
@@ -204,6 +333,8 @@ bool SQLiteDatabaseProxy::transaction() {
         return false;
     }
 
+    m_TransactionThread.storeRelease(QThread::currentThread());
+
     return true;
 }
 
@@ -215,6 +346,9 @@ bool SQLiteDatabaseProxy::commit() {
         return false;
     }
 
+    // После неудачной фиксации транзакцию всё равно откатывают.
+    m_TransactionThread.storeRelease(nullptr);
+
     if (!m_QueryChecker->isGood(m_Db->commit())) {
         toLog(LogLevel::Error,
               QString("Cannot commit transaction. Error: %1.").arg(m_Db->lastError().text()));
@@ -233,6 +367,8 @@ bool SQLiteDatabaseProxy::rollback() {
         return false;
     }
 
+    m_TransactionThread.storeRelease(nullptr);
+
     if (!m_QueryChecker->isGood(m_Db->rollback())) {
         toLog(LogLevel::Error,
               QString("Cannot rollback transaction. Error: %1.").arg(m_Db->lastError().text()));
@@ -251,7 +387,7 @@ IDatabaseQuery *SQLiteDatabaseProxy::createQuery() {
         return nullptr;
     }
 
-    return new DatabaseQuery(*m_Db, m_QueryChecker);
+    return new DatabaseQuery(*m_Db, m_QueryChecker, m_StatementCache);
 }
 
 //---------------------------------------------------------------------------
@@ -266,6 +402,43 @@ IDatabaseQuery *SQLiteDatabaseProxy::createQuery(const QString &aQueryString) {
     return query;
 }
 
+//---------------------------------------------------------------------------
+IDatabaseQuery *SQLiteDatabaseProxy::createReadQuery(const QString &aQueryString) {
+    QSqlDatabase db;
+    QSharedPointer<StatementCache> cache;
+
+    if (!acquireReader(db, cache)) {
+        return createQuery(aQueryString);
+    }
+
+    IDatabaseQuery *query = new DatabaseQuery(db, m_QueryChecker, cache);
+
+    if (!m_QueryChecker->isGood(query->prepare(aQueryString))) {
+        delete query;
+        query = nullptr;
+    }
+
+    return query;
+}
+
+//---------------------------------------------------------------------------
+bool SQLiteDatabaseProxy::acquireReadConnection() {
+    QSqlDatabase db;
+    QSharedPointer<StatementCache> cache;
+
+    return acquireReader(db, cache);
+}
+
+//---------------------------------------------------------------------------
+bool SQLiteDatabaseProxy::acquireReader(QSqlDatabase &aDb,
+                                        QSharedPointer<StatementCache> &aCache) {
+    if (!isConnected() || (m_TransactionThread.loadAcquire() == QThread::currentThread())) {
+        return false;
+    }
+
+    return m_ReadPool->acquire(aDb, aCache);
+}
+
 //---------------------------------------------------------------------------
 bool SQLiteDatabaseProxy::checkIntegrity(QStringList &aListErrors) {
     QScopedPointer<IDatabaseQuery> query(createQuery());
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QtCore/QAtomicPointer>
 #include <QtCore/QMutex>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QString>
@@ -11,6 +12,9 @@
 #include <DatabaseProxy/IDatabaseQuery.h>
 
 class QSqlDatabase;
+class QThread;
+class ReadConnectionPool;
+class StatementCache;
 
 //---------------------------------------------------------------------------
 namespace CSQLiteDatabaseProxy {
@@ -30,6 +34,9 @@ public:
     /// Установить интерфейс контроля над ошибками БД
     virtual void setQueryChecker(IDatabaseQueryChecker *aQueryChecker) override;
 
+    /// IDatabaseProxy: Устанавливает профиль производительности.
+    virtual void setPerformance(const SDatabasePerformance &aPerformance) override;
+
     /// IDatabaseProxy: Открытие соединения с БД.
     virtual bool open(const QString &aDbName = CIDatabaseProxy::DefaultDatabase,
                       const QString &aUser = CIDatabaseProxy::DefaultUser,
@@ -52,6 +59,12 @@ public:
     /// Создает и подготавливает экземпляр запроса к БД.
     virtual IDatabaseQuery *createQuery(const QString &aQueryString) override;
 
+    /// IDatabaseProxy: Создаёт и подготавливает запрос только на чтение.
+    virtual IDatabaseQuery *createReadQuery(const QString &aQueryString) override;
+
+    /// IDatabaseProxy: Закрепляет за текущим потоком соединение для чтения.
+    virtual bool acquireReadConnection() override;
+
     /// IDatabaseProxy: Выполнение DML запроса. Помещает в rowsAffected количество затронутых строк.
     virtual bool execDML(const QString &aQuery, long &aRowsAffected) override;
 
@@ -79,11 +92,30 @@ public:
 protected:
     virtual bool safeExec(QSqlQuery *aQuery, const QString &aQueryMessage);
 
+    /// Применяет прагмы профиля производительности к открытому соединению.
+    void applyPerformance();
+
+    /// Включает пул соединений чтения, если база открыта в режиме WAL.
+    void attachReadPool();
+
+    /// Соединение чтения текущего потока. false - читать нужно через основное соединение.
+    bool acquireReader(QSqlDatabase &aDb, QSharedPointer<StatementCache> &aCache);
+
 private:
     QSharedPointer<QSqlDatabase> m_Db;
     QRecursiveMutex m_Mutex;
     QString m_CurrentBase;
     IDatabaseQueryChecker *m_QueryChecker;
+    SDatabasePerformance m_Performance;
+    QSharedPointer<StatementCache> m_StatementCache;
+
+    /// Режим журнала, выбранный SQLite для открытой БД.
+    QString m_JournalMode;
+    QSharedPointer<ReadConnectionPool> m_ReadPool;
+
+    /// Поток, открывший транзакцию: его чтение идёт через основное соединение, иначе
+    /// незафиксированные изменения транзакции не будут видны.
+    QAtomicPointer<QThread> m_TransactionThread;
 };
 
 //---------------------------------------------------------------------------
@@ -0,0 +1,131 @@
+/* @file Кэш подготовленных запросов к БД. */
+
+#include "StatementCache.h"
+
+#include <QtCore/QMutexLocker>
+
+namespace {
+/// Обменивает состояния запросов без повторной подготовки.
+void swapStatements(QSqlQuery &aLeft, QSqlQuery &aRight) {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    aLeft.swap(aRight);
+#else
+    // До Qt 6.2 копия разделяет результат с оригиналом, подготовленный запрос не теряется.
+    QSqlQuery temp(aLeft);
+    aLeft = aRight;
+    aRight = temp;
+#endif
+}
+} // namespace
+
+//---------------------------------------------------------------------------
+StatementCache::StatementCache(int aCapacity)
+    : m_Capacity(qMax(0, aCapacity)), m_Generation(0), m_Hits(0), m_Misses(0) {}
+
+//---------------------------------------------------------------------------
+void StatementCache::attach(const QSqlDatabase &aDb) {
+    QMutexLocker locker(&m_Mutex);
+
+    m_Index.clear();
+    m_Entries.clear();
+    m_Db = aDb;
+    ++m_Generation;
+}
+
+//---------------------------------------------------------------------------
+void StatementCache::detach() {
+    QMutexLocker locker(&m_Mutex);
+
+    m_Index.clear();
+    m_Entries.clear();
+    m_Db = QSqlDatabase();
+    ++m_Generation;
+}
+
+//---------------------------------------------------------------------------
+void StatementCache::setCapacity(int aCapacity) {
+    QMutexLocker locker(&m_Mutex);
+
+    m_Capacity = qMax(0, aCapacity);
+
+    trim();
+}
+
+//---------------------------------------------------------------------------
+int StatementCache::generation() const {
+    QMutexLocker locker(&m_Mutex);
+
+    return m_Generation;
+}
+
+//---------------------------------------------------------------------------
+bool StatementCache::acquire(const QString &aQuery, QSqlQuery &aTarget) {
+    QMutexLocker locker(&m_Mutex);
+
+    if (m_Capacity == 0) {
+        return false;
+    }
+
+    auto it = m_Index.find(aQuery);
+
+    if (it == m_Index.end()) {
+        ++m_Misses;
+
+        return false;
+    }
+
+    TEntries::iterator entry = it.value();
+    m_Index.erase(it);
+
+    swapStatements(aTarget, *entry->statement);
+    m_Entries.erase(entry);
+
+    ++m_Hits;
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void StatementCache::release(const QString &aQuery, QSqlQuery &aSource, int aGeneration) {
+    QMutexLocker locker(&m_Mutex);
+
+    if ((aGeneration != m_Generation) || (m_Capacity == 0) || !m_Db.isValid() ||
+        m_Index.contains(aQuery)) {
+        return;
+    }
+
+    // Сбрасываем выборку, чтобы запрос в кэше не держал блокировку чтения.
+    aSource.finish();
+
+    std::unique_ptr<QSqlQuery> statement(new QSqlQuery(m_Db));
+    swapStatements(*statement, aSource);
+
+    m_Entries.push_front(SEntry{aQuery, std::move(statement)});
+    m_Index.insert(aQuery, m_Entries.begin());
+
+    trim();
+}
+
+//---------------------------------------------------------------------------
+quint64 StatementCache::hits() const {
+    QMutexLocker locker(&m_Mutex);
+
+    return m_Hits;
+}
+
+//---------------------------------------------------------------------------
+quint64 StatementCache::misses() const {
+    QMutexLocker locker(&m_Mutex);
+
+    return m_Misses;
+}
+
+//---------------------------------------------------------------------------
+void StatementCache::trim() {
+    while (static_cast<int>(m_Entries.size()) > m_Capacity) {
+        m_Index.remove(m_Entries.back().query);
+        m_Entries.pop_back();
+    }
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,69 @@
+/* @file Кэш подготовленных запросов к БД. */
+
+#pragma once
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+
+#include <list>
+#include <memory>
+
+//---------------------------------------------------------------------------
+/// LRU кэш подготовленных запросов одного соединения, ключ - текст запроса.
+/// Запрос выдаётся в монопольное пользование: пока он не возвращён, в кэше его нет,
+/// и параллельный запрос с тем же текстом подготавливается заново.
+class StatementCache {
+public:
+    explicit StatementCache(int aCapacity);
+
+    /// Привязывает кэш к новому соединению. Ранее подготовленные запросы выбрасываются.
+    void attach(const QSqlDatabase &aDb);
+
+    /// Выбрасывает все запросы и отвязывает кэш от соединения (перед его закрытием).
+    void detach();
+
+    /// Устанавливает максимальное число хранимых запросов. 0 - кэш отключён.
+    void setCapacity(int aCapacity);
+
+    /// Номер текущего соединения. Запросы, подготовленные для прежнего соединения, не принимаются.
+    int generation() const;
+
+    /// Забирает из кэша подготовленный запрос aQuery в aTarget. Возвращает false, если его нет.
+    bool acquire(const QString &aQuery, QSqlQuery &aTarget);
+
+    /// Возвращает подготовленный запрос в кэш. aSource становится пустым запросом к той же БД.
+    void release(const QString &aQuery, QSqlQuery &aSource, int aGeneration);
+
+    /// Число попаданий и промахов с момента создания кэша.
+    quint64 hits() const;
+    quint64 misses() const;
+
+private:
+    struct SEntry {
+        QString query;
+        std::unique_ptr<QSqlQuery> statement;
+    };
+
+    typedef std::list<SEntry> TEntries;
+
+    /// Удаляет самые давно использованные запросы сверх ёмкости.
+    void trim();
+
+private:
+    mutable QMutex m_Mutex;
+    QSqlDatabase m_Db;
+
+    /// В начале списка - последние возвращённые запросы.
+    TEntries m_Entries;
+    QHash<QString, TEntries::iterator> m_Index;
+
+    int m_Capacity;
+    int m_Generation;
+    quint64 m_Hits;
+    quint64 m_Misses;
+};
+
+//---------------------------------------------------------------------------
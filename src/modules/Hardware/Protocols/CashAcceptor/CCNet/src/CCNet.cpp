@@ -129,7 +129,7 @@ TResult CCNetProtocol::processCommand(const QByteArray &aCommandData,
     int checkingCounter = 1;
 
     do {
-        toLog(LogLevel::Normal, QString("CCNet: >> {%1}").arg(QString(request.toHex())));
+        TO_LOG(LogLevel::Normal, QString("CCNet: >> {%1}").arg(QString(request.toHex())));
         aAnswerData.clear();
 
         if (!m_Port->write(request)) {
@@ -192,15 +192,12 @@ TResult CCNetProtocol::getAnswer(QByteArray &aAnswerData, const CCCNet::Commands
     }
 
     for (int i = 0; i < answers.size(); ++i) {
-        QString log = QString("CCNet: << {%1}").arg(answers[i].toHex().data());
+        QString omitted = (logs[i].isEmpty() && (i != index)) ? " - omitted" : "";
+        TO_LOG(LogLevel::Normal,
+               QString("CCNet: << {%1}%2").arg(answers[i].toHex().data()).arg(omitted));
 
         if (!logs[i].isEmpty()) {
-            toLog(LogLevel::Normal, log);
             toLog(LogLevel::Error, logs[i]);
-        } else if (i != index) {
-            toLog(LogLevel::Normal, log + " - omitted");
-        } else {
-            toLog(LogLevel::Normal, log);
         }
     }
 
@@ -307,7 +304,7 @@ bool CCNetProtocol::readAnswers(TAnswers &aAnswers, int aTimeout) {
 bool CCNetProtocol::sendACK() {
     QByteArray command(1, CCCNet::ACK);
     pack(command);
-    toLog(LogLevel::Normal, QString("CCNet: >> {%1} - ACK").arg(command.toHex().data()));
+    TO_LOG(LogLevel::Normal, QString("CCNet: >> {%1} - ACK").arg(command.toHex().data()));
 
     return m_Port->write(command);
 }
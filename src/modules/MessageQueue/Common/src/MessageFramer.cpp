@@ -0,0 +1,126 @@
+/* @file Разбиение потока очереди сообщений на кадры. */
+
+#include "MessageFramer.h"
+
+MessageFramer::MessageFramer() : m_Offset(0), m_Scanned(0), m_Corrupted(false) {}
+
+//----------------------------------------------------------------------------
+QByteArray MessageFramer::frame(const QByteArray &aMessage, EFormat aFormat) {
+    QByteArray result;
+
+    if (aFormat == Binary) {
+        result.reserve(CMessageFramer::BinaryHeaderSize + aMessage.size());
+        result.resize(CMessageFramer::BinaryHeaderSize);
+        result[0] = CMessageFramer::BinaryMarker;
+        qToBigEndian<quint32>(static_cast<quint32>(aMessage.size()), result.data() + 1);
+        result.append(aMessage);
+    } else {
+        result.reserve(aMessage.size() + 1);
+        result.append(aMessage);
+        result.append(CMessageFramer::Terminator);
+    }
+
+    return result;
+}
+
+//----------------------------------------------------------------------------
+void MessageFramer::append(const QByteArray &aData) {
+    if (m_Offset == m_Buffer.size()) {
+        // Всё прочитано: новые данные просто заменяют буфер без копирования.
+        m_Buffer = aData;
+        m_Offset = 0;
+        m_Scanned = 0;
+    } else {
+        m_Buffer.append(aData);
+    }
+}
+
+//----------------------------------------------------------------------------
+bool MessageFramer::next(QByteArray &aMessage, EFormat *aFormat) {
+    int available = m_Buffer.size() - m_Offset;
+
+    if (available > 0 && m_Buffer.at(m_Offset) == CMessageFramer::BinaryMarker) {
+        if (available >= CMessageFramer::BinaryHeaderSize) {
+            quint32 size = qFromBigEndian<quint32>(m_Buffer.constData() + m_Offset + 1);
+
+            if (size > CMessageFramer::MaxBinarySize) {
+                clear();
+                m_Corrupted = true;
+
+                return false;
+            }
+
+            if (available - CMessageFramer::BinaryHeaderSize >= static_cast<qint64>(size)) {
+                aMessage = m_Buffer.mid(m_Offset + CMessageFramer::BinaryHeaderSize, size);
+                m_Offset += CMessageFramer::BinaryHeaderSize + static_cast<int>(size);
+                m_Scanned = m_Offset;
+
+                if (aFormat) {
+                    *aFormat = Binary;
+                }
+
+                return true;
+            }
+        }
+    } else if (available > 0) {
+        int end = m_Buffer.indexOf(CMessageFramer::Terminator, qMax(m_Offset, m_Scanned));
+
+        if (end >= 0) {
+            aMessage = m_Buffer.mid(m_Offset, end - m_Offset);
+            m_Offset = end + 1;
+            m_Scanned = m_Offset;
+
+            if (aFormat) {
+                *aFormat = Text;
+            }
+
+            return true;
+        }
+
+        // Незавершённый кадр при следующем чтении не просматривается заново.
+        m_Scanned = m_Buffer.size();
+    }
+
+    compact();
+
+    return false;
+}
+
+//----------------------------------------------------------------------------
+bool MessageFramer::isCorrupted() const {
+    return m_Corrupted;
+}
+
+//----------------------------------------------------------------------------
+void MessageFramer::clear() {
+    m_Buffer.clear();
+    m_Offset = 0;
+    m_Scanned = 0;
+    m_Corrupted = false;
+}
+
+//----------------------------------------------------------------------------
+int MessageFramer::pending() const {
+    return m_Buffer.size() - m_Offset;
+}
+
+//----------------------------------------------------------------------------
+void MessageFramer::compact() {
+    if (m_Offset == 0) {
+        return;
+    }
+
+    if (m_Offset == m_Buffer.size()) {
+        m_Buffer.clear();
+        m_Offset = 0;
+        m_Scanned = 0;
+    } else if ((m_Offset >= CMessageFramer::CompactThreshold) ||
+               (m_Offset * 2 >= m_Buffer.size())) {
+        // Сдвиг стоит не больше уже прочитанного, поэтому суммарно разбор линеен.
+        m_Buffer.remove(0, m_Offset);
+        m_Scanned -= m_Offset;
+        m_Offset = 0;
+    }
+}
+
+//----------------------------------------------------------------------------
@@ -0,0 +1,99 @@
+/* @file Разбиение потока очереди сообщений на кадры. */
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QtEndian>
+
+//----------------------------------------------------------------------------
+namespace CMessageFramer {
+/// Конец текстового кадра.
+const char Terminator = '\0';
+
+/// Первый байт кадра с длиной. В UTF-8 не встречается, поэтому текстовый кадр с него не начнётся.
+const char BinaryMarker = '\xFF';
+
+/// Маркер и длина (quint32, big endian).
+const int BinaryHeaderSize = 5;
+
+/// Максимальный размер сообщения в кадре с длиной, больший считается порчей потока.
+const quint32 MaxBinarySize = 64 * 1024 * 1024;
+
+/// Прочитанная часть буфера, после которой он уплотняется.
+const int CompactThreshold = 64 * 1024;
+
+/// Объём неотправленных данных сокета, при котором они отправляются, не дожидаясь цикла событий.
+const qint64 FlushThreshold = 256 * 1024;
+} // namespace CMessageFramer
+
+//----------------------------------------------------------------------------
+/// Кадры потока: текстовые, завершаемые '\0', и кадры с длиной для произвольных данных.
+/// Принятые данные дописываются в конец буфера, а сообщения читаются со смещения, поэтому
+/// каждый байт просматривается один раз, а буфер сдвигается, только когда прочитана большая
+/// его часть.
+class MessageFramer {
+public:
+    /// Формат кадра.
+    enum EFormat {
+        Text,  /// Сообщение и '\0'. Сообщение не может содержать '\0'.
+        Binary /// Маркер, длина и сообщение.
+    };
+
+    MessageFramer();
+
+    /// Возвращает кадр с сообщением.
+    static QByteArray frame(const QByteArray &aMessage, EFormat aFormat = Text);
+
+    /// Пишет кадр в буфер сокета без промежуточной копии. Сокет отправит накопленные кадры
+    /// одной записью по возвращении в цикл событий, большой объём отправляется сразу.
+    template <typename TSocket>
+    static void write(TSocket &aSocket, const QByteArray &aMessage, EFormat aFormat = Text) {
+        if (aFormat == Binary) {
+            char header[CMessageFramer::BinaryHeaderSize];
+            header[0] = CMessageFramer::BinaryMarker;
+            qToBigEndian<quint32>(static_cast<quint32>(aMessage.size()), header + 1);
+
+            aSocket.write(header, sizeof(header));
+            aSocket.write(aMessage);
+        } else {
+            aSocket.write(aMessage);
+            aSocket.write(&CMessageFramer::Terminator, 1);
+        }
+
+        if (aSocket.bytesToWrite() >= CMessageFramer::FlushThreshold) {
+            aSocket.flush();
+        }
+    }
+
+    /// Дописывает принятые данные.
+    void append(const QByteArray &aData);
+
+    /// Извлекает следующее полное сообщение. false - полных сообщений больше нет.
+    bool next(QByteArray &aMessage, EFormat *aFormat = nullptr);
+
+    /// Возвращает true, если встретился кадр недопустимой длины. Данные при этом отброшены.
+    bool isCorrupted() const;
+
+    /// Отбрасывает все данные.
+    void clear();
+
+    /// Число принятых, но ещё не разобранных байт.
+    int pending() const;
+
+private:
+    /// Удаляет прочитанную часть буфера.
+    void compact();
+
+private:
+    QByteArray m_Buffer;
+
+    /// Начало непрочитанных данных.
+    int m_Offset;
+
+    /// Позиция, до которой текущий текстовый кадр уже просмотрен в поисках '\0'.
+    int m_Scanned;
+
+    bool m_Corrupted;
+};
+
+//----------------------------------------------------------------------------
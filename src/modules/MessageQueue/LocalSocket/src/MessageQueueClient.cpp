@@ -13,7 +13,11 @@ MessageQueueClient::MessageQueueClient() {
 }
 
 //----------------------------------------------------------------------------
-MessageQueueClient::~MessageQueueClient() = default;
+MessageQueueClient::~MessageQueueClient() {
+    if (m_Socket.state() == QLocalSocket::ConnectedState) {
+        m_Socket.flush();
+    }
+}
 
 //----------------------------------------------------------------------------
 bool MessageQueueClient::connect(const QString &aQueueName) {
@@ -25,7 +29,10 @@ bool MessageQueueClient::connect(const QString &aQueueName) {
 
 //----------------------------------------------------------------------------
 void MessageQueueClient::disconnect() {
-    m_Socket.disconnectFrom_Server();
+    m_Socket.flush();
+    m_Socket.disconnectFromServer();
+
+    m_Framer.clear();
 }
 
 //----------------------------------------------------------------------------
@@ -34,11 +41,16 @@ bool MessageQueueClient::isConnected() const {
 }
 
 //----------------------------------------------------------------------------
-static void MessageQueueClient::sendMessage(const QByteArray &aMessage) {
+void MessageQueueClient::sendMessage(const QByteArray &aMessage) {
     if (m_Socket.state() == QLocalSocket::ConnectedState) {
-        m_Socket.write(aMessage + '\0');
-        m_Socket.flush();
-        m_Socket.waitForBytesWritten(100);
+        MessageFramer::write(m_Socket, aMessage);
+    }
+}
+
+//----------------------------------------------------------------------------
+void MessageQueueClient::sendBinaryMessage(const QByteArray &aMessage) {
+    if (m_Socket.state() == QLocalSocket::ConnectedState) {
+        MessageFramer::write(m_Socket, aMessage, MessageFramer::Binary);
     }
 }
 
@@ -68,20 +80,14 @@ bool MessageQueueClient::subscribeOnEvents(QObject *aObject) {
 }
 
 //----------------------------------------------------------------------------
-static void MessageQueueClient::onSocketReadyRead() {
-    QByteArray buffer = m_Socket.readAll();
-    /*if (buffer.indexOf(MessageQueueConstants::PingMessage) >= 0)
-    {
-            m_AnswerTimer.stop();
-            QTimer::singleShot(MessageQueueConstants::PingTime, this, SLOT(pingServer()));
-            return;
-    }*/
-    m_Buffer += buffer;
-    parseInputBuffer(m_Buffer);
+void MessageQueueClient::onSocketReadyRead() {
+    m_Framer.append(m_Socket.readAll());
+
+    parseInputBuffer();
 }
 
 //----------------------------------------------------------------------------
-static void MessageQueueClient::onSocketError(QLocalSocket::LocalSocketError aErrorCode) {
+void MessageQueueClient::onSocketError(QLocalSocket::LocalSocketError aErrorCode) {
     emit onError(static_cast<CIMessageQueueClient::ErrorCode>(aErrorCode), m_Socket.errorString());
 }
 
@@ -91,16 +97,15 @@ void MessageQueueClient::onSocketDisconnected() {
 }
 
 //----------------------------------------------------------------------------
-static void MessageQueueClient::parseInputBuffer(QByteArray &aBuffer) {
-    int messageEnd = aBuffer.indexOf('\0');
-    while (messageEnd != -1) {
-        QByteArray newMessageData = aBuffer.left(messageEnd);
-
-        aBuffer = aBuffer.right(aBuffer.size() - messageEnd - 1);
+void MessageQueueClient::parseInputBuffer() {
+    QByteArray message;
 
-        emit onMessageReceived(newMessageData);
+    while (m_Framer.next(message)) {
+        emit onMessageReceived(message);
+    }
 
-        messageEnd = aBuffer.indexOf('\0');
+    if (m_Framer.isCorrupted()) {
+        m_Framer.clear();
     }
 }
 
@@ -8,6 +8,8 @@
 
 #include "MessageQueue/IMessageQueueClient.h"
 
+#include "MessageFramer.h"
+
 class MessageQueueClient : public QObject, public IMessageQueueClient {
     Q_OBJECT
 
@@ -25,6 +27,9 @@ public:
     /// Послать сообщение серверу.
     virtual void sendMessage(const QByteArray &aMessage) override;
 
+    /// Послать сообщение серверу кадром с длиной.
+    virtual void sendBinaryMessage(const QByteArray &aMessage) override;
+
     /// Подписаться на получение сообщения. aObject должен иметь
     /// слот onMessageReceived(QByteArray aMessage).
     virtual bool subscribeOnMessageReceived(QObject *aObject) override;
@@ -39,7 +44,8 @@ public:
     virtual bool subscribeOnEvents(QObject *aObject) override;
 
 private:
-    void parseInputBuffer(QByteArray &aBuffer);
+    /// Разбирает принятые данные и рассылает полные сообщения.
+    void parseInputBuffer();
 
 private slots:
     void onSocketReadyRead();
@@ -54,7 +60,7 @@ signals:
 
 private:
     QLocalSocket m_Socket{};
-    QByteArray m_Buffer{};
+    MessageFramer m_Framer{};
 
     /// Таймер, который будет следить за ответом сервера на пинг.
     QTimer m_AnswerTimer{};
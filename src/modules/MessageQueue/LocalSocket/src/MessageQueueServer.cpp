@@ -15,7 +15,9 @@ MessageQueueServer::MessageQueueServer(const QString &aQueueName, ILog *aLog) :
 }
 
 //----------------------------------------------------------------------------
-MessageQueueServer::~MessageQueueServer() = default;
+MessageQueueServer::~MessageQueueServer() {
+    flush();
+}
 
 //----------------------------------------------------------------------------
 bool MessageQueueServer::init() {
@@ -28,6 +30,8 @@ bool MessageQueueServer::init() {
 
 //----------------------------------------------------------------------------
 void MessageQueueServer::stop() {
+    flush();
+
     QLocalServer::close();
 }
 
@@ -44,11 +48,27 @@ bool MessageQueueServer::subscribeOnDisconnected(QObject *aObject) {
 
 //----------------------------------------------------------------------------
 void MessageQueueServer::sendMessage(const QByteArray &aMessage) {
-    foreach (QLocalSocket *socket, m_Sockets.keys()) {
-        if (socket->state() == QLocalSocket::ConnectedState) {
-            socket->write(aMessage + '\0');
-            socket->flush();
-            socket->waitForBytesWritten(100);
+    for (auto it = m_Sockets.begin(); it != m_Sockets.end(); ++it) {
+        if (it.key()->state() == QLocalSocket::ConnectedState) {
+            MessageFramer::write(*it.key(), aMessage);
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+void MessageQueueServer::sendBinaryMessage(const QByteArray &aMessage) {
+    for (auto it = m_Sockets.begin(); it != m_Sockets.end(); ++it) {
+        if (it.key()->state() == QLocalSocket::ConnectedState) {
+            MessageFramer::write(*it.key(), aMessage, MessageFramer::Binary);
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+void MessageQueueServer::flush() {
+    for (auto it = m_Sockets.begin(); it != m_Sockets.end(); ++it) {
+        if (it.key()->state() == QLocalSocket::ConnectedState) {
+            it.key()->flush();
         }
     }
 }
@@ -67,7 +87,7 @@ void MessageQueueServer::incomingConnection(quintptr aSocketDescriptor) {
 
     // Используем lambda-соединения вместо устаревшего QSignalMapper
     connect(newSocket, &QLocalSocket::disconnected, this, [this, newSocket]() {
-        onSocketDisconnected();
+        onSocketDisconnected(newSocket);
     });
 
     connect(newSocket, &QLocalSocket::readyRead, this, [this, newSocket]() {
@@ -76,12 +96,9 @@ void MessageQueueServer::incomingConnection(quintptr aSocketDescriptor) {
 }
 
 //----------------------------------------------------------------------------
-void MessageQueueServer::onSocketDisconnected() {
+void MessageQueueServer::onSocketDisconnected(QLocalSocket *socket) {
     emit onDisconnected();
 
-    // Find the socket that was disconnected
-    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
-
     if (socket) {
         LOG(m_Log,
             LogLevel::Normal,
@@ -94,43 +111,41 @@ void MessageQueueServer::onSocketDisconnected() {
 }
 
 //----------------------------------------------------------------------------
-void MessageQueueServer::onSocketReadyRead(QObject *aObject) {
-    QLocalSocket *socket = dynamic_cast<QLocalSocket *>(aObject);
+void MessageQueueServer::onSocketReadyRead(QLocalSocket *socket) {
     if (!socket) {
         LOG(m_Log, LogLevel::Error, "Wrong object was passed to onSocketReadyRead slot...");
         return;
     }
 
-    QByteArray newData = socket->readAll();
-
-    /*if (newData.indexOf(MessageQueueConstants::PingMessage) >= 0)
-    {
-            sendMessage(MessageQueueConstants::PingMessage);
-            return;
-    }*/
-
     quintptr socketDescriptor = socket->socketDescriptor();
 
-    if (m_Buffers.contains(socketDescriptor)) {
-        m_Buffers[socketDescriptor] = m_Buffers[socketDescriptor] + newData;
-    } else {
-        m_Buffers[socketDescriptor] = newData;
-    }
+    m_Buffers[socketDescriptor].append(socket->readAll());
 
-    parseInputBuffer(m_Buffers[socketDescriptor]);
+    parseInputBuffer(socketDescriptor);
 }
 
 //----------------------------------------------------------------------------
-static void MessageQueueServer::parseInputBuffer(QByteArray &aBuffer) {
-    int messageEnd = aBuffer.indexOf('\0');
-    while (messageEnd != -1) {
-        QByteArray newMessageData = aBuffer.left(messageEnd);
+void MessageQueueServer::parseInputBuffer(quintptr aSocketDescriptor) {
+    MessageFramer &framer = m_Buffers[aSocketDescriptor];
+    QList<QByteArray> messages;
+    QByteArray message;
 
-        aBuffer = aBuffer.right(aBuffer.size() - messageEnd - 1);
+    while (framer.next(message)) {
+        messages << message;
+    }
 
-        emit onMessageReceived(newMessageData);
+    if (framer.isCorrupted()) {
+        LOG(m_Log,
+            LogLevel::Error,
+            QString("Invalid frame length received from socket %1, input buffer is dropped.")
+                .arg(aSocketDescriptor));
+
+        framer.clear();
+    }
 
-        messageEnd = aBuffer.indexOf('\0');
+    // Слот может отключить клиента, и буфер сокета будет удалён до конца разбора.
+    foreach (const QByteArray &received, messages) {
+        emit onMessageReceived(received);
     }
 }
 
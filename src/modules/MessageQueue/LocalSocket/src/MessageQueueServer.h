@@ -9,9 +9,11 @@
 #include "Common/ILog.h"
 #include "MessageQueue/IMessageQueueServer.h"
 
+#include "MessageFramer.h"
+
 class MessageQueueServer : public QLocalServer, public IMessageQueueServer {
     typedef QMap<QLocalSocket *, quintptr> TLocalSocketMap;
-    typedef QMap<quintptr, QByteArray> TSocketBufferMap;
+    typedef QMap<quintptr, MessageFramer> TSocketBufferMap;
 
     Q_OBJECT
 
@@ -28,6 +30,9 @@ public:
     /// Послать сообщение всем подключенным клиентам.
     virtual void sendMessage(const QByteArray &aMessage) override;
 
+    /// Послать сообщение всем подключенным клиентам кадром с длиной.
+    virtual void sendBinaryMessage(const QByteArray &aMessage) override;
+
     /// Подписаться на получение сообщения. aObject должен иметь
     /// слот onMessageReceived(QByteArray aMessage).
     virtual bool subscribeOnMessageReceived(QObject *aObject) override;
@@ -40,15 +45,19 @@ protected:
     virtual void incomingConnection(quintptr socketDescriptor) override;
 
 private:
-    void parseInputBuffer(QByteArray &aBuffer);
+    /// Разбирает принятые данные сокета и рассылает полные сообщения.
+    void parseInputBuffer(quintptr aSocketDescriptor);
+
+    /// Пишет накопленные в сокетах сообщения.
+    void flush();
 
 signals:
     void onMessageReceived(QByteArray aMessage);
     void onDisconnected();
 
 private slots:
-    void onSocketDisconnected();
-    void onSocketReadyRead(QObject *aObject);
+    void onSocketDisconnected(QLocalSocket *aSocket);
+    void onSocketReadyRead(QLocalSocket *aSocket);
 
 private:
     TLocalSocketMap m_Sockets{};
@@ -20,7 +20,9 @@ MessageQueueClient::MessageQueueClient() : ILogable(CIMessageQueueClient::Defaul
 }
 
 //----------------------------------------------------------------------------
-MessageQueueClient::~MessageQueueClient() = default;
+MessageQueueClient::~MessageQueueClient() {
+    m_Socket.flush();
+}
 
 //----------------------------------------------------------------------------
 bool MessageQueueClient::connect(const QString &aQueueName) {
@@ -32,6 +34,8 @@ bool MessageQueueClient::connect(const QString &aQueueName) {
 
 //----------------------------------------------------------------------------
 void MessageQueueClient::disconnect() {
+    // Отправленные, но ещё не записанные в сокет сообщения не должны потеряться.
+    m_Socket.flush();
     m_Socket.disconnectFromHost();
 }
 
@@ -43,8 +47,14 @@ bool MessageQueueClient::isConnected() const {
 //----------------------------------------------------------------------------
 void MessageQueueClient::sendMessage(const QByteArray &aMessage) {
     if (m_Socket.state() == QTcpSocket::ConnectedState) {
-        m_Socket.write(aMessage + '\0');
-        m_Socket.flush();
+        MessageFramer::write(m_Socket, aMessage);
+    }
+}
+
+//----------------------------------------------------------------------------
+void MessageQueueClient::sendBinaryMessage(const QByteArray &aMessage) {
+    if (m_Socket.state() == QTcpSocket::ConnectedState) {
+        MessageFramer::write(m_Socket, aMessage, MessageFramer::Binary);
     }
 }
 
@@ -82,10 +92,12 @@ void MessageQueueClient::onSocketReadyRead() {
     while (m_Socket.bytesAvailable() > 0) {
         QByteArray buffer = m_Socket.readAll();
 
-        toLog(LogLevel::Normal, QString::fromUtf8(buffer));
+        if (isLogEnabled(LogLevel::Trace)) {
+            toLog(LogLevel::Trace, QString("Received %1 bytes.").arg(buffer.size()));
+        }
 
-        m_Buffer += buffer;
-        parseInputBuffer(m_Buffer);
+        m_Framer.append(buffer);
+        parseInputBuffer();
     }
 }
 
@@ -100,13 +112,17 @@ void MessageQueueClient::onSocketDisconnected() {
 }
 
 //----------------------------------------------------------------------------
-void MessageQueueClient::parseInputBuffer(QByteArray &aBuffer) {
-    int messageEnd = aBuffer.indexOf('\0');
-    while (messageEnd != -1) {
-        QByteArray newMessageData = aBuffer.left(messageEnd);
-        aBuffer = aBuffer.right(aBuffer.size() - messageEnd - 1);
-        emit onMessageReceived(newMessageData);
-        messageEnd = aBuffer.indexOf('\0');
+void MessageQueueClient::parseInputBuffer() {
+    QByteArray message;
+
+    while (m_Framer.next(message)) {
+        emit onMessageReceived(message);
+    }
+
+    if (m_Framer.isCorrupted()) {
+        toLog(LogLevel::Error, "Invalid frame length received, input buffer is dropped.");
+
+        m_Framer.clear();
     }
 }
 
@@ -10,6 +10,8 @@
 
 #include "MessageQueue/IMessageQueueClient.h"
 
+#include "MessageFramer.h"
+
 class MessageQueueClient : public QObject, public IMessageQueueClient, public ILogable {
     Q_OBJECT
 
@@ -27,6 +29,9 @@ public:
     /// Послать сообщение серверу.
     virtual void sendMessage(const QByteArray &aMessage) override;
 
+    /// Послать сообщение серверу кадром с длиной.
+    virtual void sendBinaryMessage(const QByteArray &aMessage) override;
+
     /// Подписаться на получение сообщения. aObject должен иметь
     /// слот onMessageReceived(QByteArray aMessage).
     virtual bool subscribeOnMessageReceived(QObject *aObject) override;
@@ -41,7 +46,7 @@ public:
     virtual bool subscribeOnEvents(QObject *aObject) override;
 
 private:
-    void parseInputBuffer(QByteArray &aBuffer);
+    void parseInputBuffer();
 
 private slots:
     void onSocketReadyRead();
@@ -56,7 +61,7 @@ signals:
 
 private:
     QTcpSocket m_Socket;
-    QByteArray m_Buffer;
+    MessageFramer m_Framer;
 
     /// Таймер, который будет следить за ответом сервера на пинг.
     QTimer m_AnswerTimer;
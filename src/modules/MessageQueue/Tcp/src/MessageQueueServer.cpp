@@ -13,7 +13,9 @@ MessageQueueServer::MessageQueueServer(QString aQueueName, ILog *aLog)
     : m_Log(aLog), m_QueueName(std::move(aQueueName)) {}
 
 //----------------------------------------------------------------------------
-MessageQueueServer::~MessageQueueServer() = default;
+MessageQueueServer::~MessageQueueServer() {
+    flush();
+}
 
 //----------------------------------------------------------------------------
 bool MessageQueueServer::init() {
@@ -33,6 +35,8 @@ bool MessageQueueServer::init() {
 
 //----------------------------------------------------------------------------
 void MessageQueueServer::stop() {
+    flush();
+
     QTcpServer::close();
 }
 
@@ -51,10 +55,27 @@ bool MessageQueueServer::subscribeOnDisconnected(QObject *aObject) {
 
 //----------------------------------------------------------------------------
 void MessageQueueServer::sendMessage(const QByteArray &aMessage) {
-    foreach (QTcpSocket *socket, m_Sockets.keys()) {
-        if (socket->state() == QTcpSocket::ConnectedState) {
-            socket->write(aMessage + '\0');
-            socket->flush();
+    for (auto it = m_Sockets.begin(); it != m_Sockets.end(); ++it) {
+        if (it.key()->state() == QTcpSocket::ConnectedState) {
+            MessageFramer::write(*it.key(), aMessage);
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+void MessageQueueServer::sendBinaryMessage(const QByteArray &aMessage) {
+    for (auto it = m_Sockets.begin(); it != m_Sockets.end(); ++it) {
+        if (it.key()->state() == QTcpSocket::ConnectedState) {
+            MessageFramer::write(*it.key(), aMessage, MessageFramer::Binary);
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+void MessageQueueServer::flush() {
+    for (auto it = m_Sockets.begin(); it != m_Sockets.end(); ++it) {
+        if (it.key()->state() == QTcpSocket::ConnectedState) {
+            it.key()->flush();
         }
     }
 }
@@ -117,29 +138,38 @@ void MessageQueueServer::onSocketReadyRead(QTcpSocket *socket) {
         return;
     }
 
-    while (socket->bytesAvailable() > 0) {
-        QByteArray newData = socket->readAll();
+    quintptr socketDescriptor = socket->socketDescriptor();
 
-        quintptr socketDescriptor = socket->socketDescriptor();
-
-        m_Buffers[socketDescriptor] = parseInputBuffer(m_Buffers[socketDescriptor].append(newData));
+    while (socket->bytesAvailable() > 0) {
+        m_Buffers[socketDescriptor].append(socket->readAll());
     }
+
+    parseInputBuffer(socketDescriptor);
 }
 
 //----------------------------------------------------------------------------
-QByteArray MessageQueueServer::parseInputBuffer(QByteArray aBuffer) {
-    int messageEnd = aBuffer.indexOf('\0');
-    while (messageEnd != -1) {
-        QByteArray newMessageData = aBuffer.left(messageEnd);
+void MessageQueueServer::parseInputBuffer(quintptr aSocketDescriptor) {
+    MessageFramer &framer = m_Buffers[aSocketDescriptor];
+    QList<QByteArray> messages;
+    QByteArray message;
 
-        aBuffer = aBuffer.right(aBuffer.size() - messageEnd - 1);
+    while (framer.next(message)) {
+        messages << message;
+    }
 
-        emit onMessageReceived(newMessageData);
+    if (framer.isCorrupted()) {
+        LOG(m_Log,
+            LogLevel::Error,
+            QString("Invalid frame length received from socket %1, input buffer is dropped.")
+                .arg(aSocketDescriptor));
 
-        messageEnd = aBuffer.indexOf('\0');
+        framer.clear();
     }
 
-    return aBuffer;
+    // Обработчик может отключить сокет и удалить его буфер, поэтому рассылаем после разбора.
+    foreach (const QByteArray &received, messages) {
+        emit onMessageReceived(received);
+    }
 }
 
 //----------------------------------------------------------------------------
@@ -10,9 +10,11 @@
 
 #include "MessageQueue/IMessageQueueServer.h"
 
+#include "MessageFramer.h"
+
 class MessageQueueServer : public QTcpServer, public IMessageQueueServer {
     typedef QMap<QTcpSocket *, quintptr> TLocalSocketMap;
-    typedef QMap<quintptr, QByteArray> TSocketBufferMap;
+    typedef QMap<quintptr, MessageFramer> TSocketBufferMap;
 
     Q_OBJECT
 
@@ -29,6 +31,9 @@ public:
     /// Послать сообщение всем подключенным клиентам.
     virtual void sendMessage(const QByteArray &aMessage) override;
 
+    /// Послать сообщение всем подключенным клиентам кадром с длиной.
+    virtual void sendBinaryMessage(const QByteArray &aMessage) override;
+
     /// Подписаться на получение сообщения. aObject должен иметь
     /// слот onMessageReceived(QByteArray aMessage).
     virtual bool subscribeOnMessageReceived(QObject *aObject) override;
@@ -41,7 +46,11 @@ protected:
     virtual void incomingConnection(qintptr socketDescriptor) override;
 
 private:
-    QByteArray parseInputBuffer(QByteArray aBuffer);
+    /// Разбирает принятые данные сокета и рассылает полные сообщения.
+    void parseInputBuffer(quintptr aSocketDescriptor);
+
+    /// Пишет накопленные в сокетах сообщения.
+    void flush();
 
 signals:
     void onMessageReceived(QByteArray aMessage);
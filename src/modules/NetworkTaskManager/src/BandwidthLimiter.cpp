@@ -0,0 +1,144 @@
+/* @file Ограничение скорости чтения сетевых ответов по классам трафика. */
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSharedPointer>
+
+#include <NetworkTaskManager/BandwidthLimiter.h>
+#include <utility>
+
+BandwidthLimiter::BandwidthLimiter(TClock aClock) : m_Clock(std::move(aClock)) {
+    if (!m_Clock) {
+        QSharedPointer<QElapsedTimer> timer(new QElapsedTimer());
+        timer->start();
+
+        m_Clock = [timer]() -> qint64 { return timer->elapsed(); };
+    }
+
+    m_LastTime = m_Clock();
+
+    for (int i = 0; i < CBandwidthLimiter::ClassCount; ++i) {
+        m_Active[i] = 0;
+    }
+}
+
+//------------------------------------------------------------------------
+void BandwidthLimiter::setLimit(int aClass, qint64 aBytesPerSecond) {
+    if (aClass >= 0 && aClass < CBandwidthLimiter::ClassCount) {
+        refill();
+        m_Classes[aClass].setRate(aBytesPerSecond);
+    }
+}
+
+//------------------------------------------------------------------------
+qint64 BandwidthLimiter::getLimit(int aClass) const {
+    return (aClass >= 0 && aClass < CBandwidthLimiter::ClassCount) ? m_Classes[aClass].rate : 0;
+}
+
+//------------------------------------------------------------------------
+void BandwidthLimiter::setTotalLimit(qint64 aBytesPerSecond) {
+    refill();
+    m_Total.setRate(aBytesPerSecond);
+}
+
+//------------------------------------------------------------------------
+qint64 BandwidthLimiter::getTotalLimit() const {
+    return m_Total.rate;
+}
+
+//------------------------------------------------------------------------
+void BandwidthLimiter::setActive(int aClass, bool aActive) {
+    if (aClass >= 0 && aClass < CBandwidthLimiter::ClassCount) {
+        m_Active[aClass] = qMax(0, m_Active[aClass] + (aActive ? 1 : -1));
+    }
+}
+
+//------------------------------------------------------------------------
+bool BandwidthLimiter::isLimited(int aClass) const {
+    return (m_Total.rate > 0) || (getLimit(aClass) > 0);
+}
+
+//------------------------------------------------------------------------
+qint64 BandwidthLimiter::acquire(int aClass, qint64 aWanted) {
+    aClass = qBound(0, aClass, CBandwidthLimiter::ClassCount - 1);
+
+    refill();
+
+    SBucket &bucket = m_Classes[aClass];
+    qint64 granted = qMax(qint64(0), aWanted);
+
+    if (bucket.rate > 0) {
+        granted = qMin(granted, bucket.tokens);
+    }
+
+    if (m_Total.rate > 0) {
+        qint64 reserve = 0;
+
+        for (int i = 0; i < aClass; ++i) {
+            if (m_Active[i] > 0) {
+                reserve = m_Total.capacity() * CBandwidthLimiter::PriorityReserve / 100;
+                break;
+            }
+        }
+
+        granted = qMin(granted, qMax(qint64(0), m_Total.tokens - reserve));
+        m_Total.tokens -= granted;
+    }
+
+    if (bucket.rate > 0) {
+        bucket.tokens -= granted;
+    }
+
+    return granted;
+}
+
+//------------------------------------------------------------------------
+void BandwidthLimiter::refill() {
+    qint64 now = m_Clock();
+    qint64 elapsed = now - m_LastTime;
+
+    if (elapsed <= 0) {
+        return;
+    }
+
+    m_LastTime = now;
+    m_Total.refill(elapsed);
+
+    for (int i = 0; i < CBandwidthLimiter::ClassCount; ++i) {
+        m_Classes[i].refill(elapsed);
+    }
+}
+
+//------------------------------------------------------------------------
+qint64 BandwidthLimiter::SBucket::capacity() const {
+    return qMax(CBandwidthLimiter::MinBurst, rate * CBandwidthLimiter::BurstInterval / 1000);
+}
+
+//------------------------------------------------------------------------
+void BandwidthLimiter::SBucket::setRate(qint64 aRate) {
+    bool wasUnlimited = (rate <= 0);
+
+    rate = qMax(qint64(0), aRate);
+    fraction = 0;
+
+    // Новое ограничение начинает с полной корзины, уменьшенное - обрезает накопленное.
+    tokens = wasUnlimited ? capacity() : qMin(tokens, capacity());
+}
+
+//------------------------------------------------------------------------
+void BandwidthLimiter::SBucket::refill(qint64 aElapsed) {
+    if (rate <= 0) {
+        return;
+    }
+
+    qint64 amount = aElapsed * rate + fraction;
+
+    tokens += amount / 1000;
+    fraction = amount % 1000;
+
+    if (tokens >= capacity()) {
+        tokens = capacity();
+        fraction = 0;
+    }
+}
+
+//------------------------------------------------------------------------
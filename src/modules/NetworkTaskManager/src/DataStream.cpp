@@ -46,11 +46,36 @@ QByteArray DataStream::readAll() {
     return m_stream->readAll();
 }
 
+//------------------------------------------------------------------------
+QByteArray DataStream::read(qint64 aOffset, qint64 aMaxSize) {
+    qint64 current = m_stream->pos();
+
+    if (!m_stream->seek(aOffset)) {
+        return QByteArray();
+    }
+
+    QByteArray result = m_stream->read(aMaxSize);
+
+    m_stream->seek(current);
+
+    return result;
+}
+
 //------------------------------------------------------------------------
 qint64 DataStream::size() const {
     return m_stream->size();
 }
 
+//------------------------------------------------------------------------
+qint64 DataStream::pos() const {
+    return m_stream->pos();
+}
+
+//------------------------------------------------------------------------
+bool DataStream::flush() {
+    return true;
+}
+
 //------------------------------------------------------------------------
 void DataStream::close() {
     m_stream->close();
@@ -4,30 +4,101 @@
 
 #include <NetworkTaskManager/FileDataStream.h>
 
-FileDataStream::FileDataStream(const QString &aPath) : DataStream(nullptr) {
+FileDataStream::FileDataStream(const QString &aPath)
+    : DataStream(nullptr), m_FlushThreshold(CFileDataStream::FlushThreshold) {
     m_stream = QSharedPointer<QIODevice>(new QFile(aPath));
     m_stream->open(QIODevice::ReadWrite | QIODevice::Append | QIODevice::Unbuffered);
 }
 
+//------------------------------------------------------------------------
+FileDataStream::~FileDataStream() {
+    flush();
+}
+
+//------------------------------------------------------------------------
+void FileDataStream::setFlushThreshold(qint64 aBytes) {
+    m_FlushThreshold = qMax(qint64(0), aBytes);
+}
+
 //------------------------------------------------------------------------
 bool FileDataStream::clear() {
     auto *file = dynamic_cast<QFile *>(m_stream.data());
 
+    m_Buffer.clear();
+
     return file->resize(0) && file->seek(0);
 }
 
+//------------------------------------------------------------------------
+bool FileDataStream::seek(qint64 aOffset) {
+    return flush() && DataStream::seek(aOffset);
+}
+
 //------------------------------------------------------------------------
 bool FileDataStream::write(const QByteArray &aData) {
-    auto *file = dynamic_cast<QFile *>(m_stream.data());
+    // Файл открыт без буферизации QFile, поэтому блоки собираются здесь и пишутся одним вызовом.
+    m_Buffer.append(aData);
+
+    if (m_Buffer.size() >= m_FlushThreshold) {
+        return flush();
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------
+QByteArray FileDataStream::takeAll() {
+    flush();
+
+    return DataStream::takeAll();
+}
+
+//------------------------------------------------------------------------
+QByteArray FileDataStream::readAll() {
+    flush();
 
-    return (file->write(aData) == aData.size() && file->flush());
+    return DataStream::readAll();
+}
+
+//------------------------------------------------------------------------
+QByteArray FileDataStream::read(qint64 aOffset, qint64 aMaxSize) {
+    flush();
+
+    return DataStream::read(aOffset, aMaxSize);
 }
 
 //------------------------------------------------------------------------
 qint64 FileDataStream::size() const {
     auto *file = dynamic_cast<QFile *>(m_stream.data());
 
-    return file->size();
+    return file->size() + m_Buffer.size();
+}
+
+//------------------------------------------------------------------------
+qint64 FileDataStream::pos() const {
+    return m_stream->pos() + m_Buffer.size();
+}
+
+//------------------------------------------------------------------------
+bool FileDataStream::flush() {
+    if (m_Buffer.isEmpty()) {
+        return true;
+    }
+
+    auto *file = dynamic_cast<QFile *>(m_stream.data());
+
+    bool result = file->isOpen() && (file->write(m_Buffer) == m_Buffer.size()) && file->flush();
+
+    m_Buffer.clear();
+
+    return result;
+}
+
+//------------------------------------------------------------------------
+void FileDataStream::close() {
+    flush();
+
+    DataStream::close();
 }
 
 //------------------------------------------------------------------------
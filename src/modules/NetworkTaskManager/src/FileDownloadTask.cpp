@@ -11,6 +11,7 @@ FileDownloadTask::FileDownloadTask(QUrl aUrl, QString aPath)
     setUrl(m_Url);
     setDataStream(new FileDataStream(m_Path));
     setFlags(NetworkTask::Continue);
+    setTrafficClass(NetworkTask::Bulk);
 }
 
 //------------------------------------------------------------------------
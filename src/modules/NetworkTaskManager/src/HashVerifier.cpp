@@ -1,32 +1,42 @@
 /* @file Верификатор данных по алгоритму MD5. */
 
-#include <QtCore/QCryptographicHash>
-
 #include <NetworkTaskManager/HashVerifier.h>
 #include <utility>
 
-Md5Verifier::Md5Verifier(QString aMd5) : m_MD5(std::move(aMd5)) {}
+HashVerifier::HashVerifier(QCryptographicHash::Algorithm aAlgorithm, QString aHash)
+    : m_Context(aAlgorithm), m_Hash(std::move(aHash)) {}
 
 //------------------------------------------------------------------------
-bool Md5Verifier::verify(NetworkTask * /*aTask*/, const QByteArray &aData) {
-    m_CalculatedMD5 = QCryptographicHash::hash(aData, QCryptographicHash::Md5).toHex();
+bool HashVerifier::verify(NetworkTask *aTask, const QByteArray &aData) {
+    reset();
+    update(aData);
 
-    return (m_MD5.compare(m_CalculatedMD5, Qt::CaseInsensitive) == 0);
+    return finish(aTask);
 }
 
 //------------------------------------------------------------------------
-Sha256Verifier::Sha256Verifier(QString aSha256) : m_Sha256(std::move(aSha256)) {
-    ;
+void HashVerifier::reset() {
+    m_Context.reset();
+    m_CalculatedHash.clear();
 }
 
 //------------------------------------------------------------------------
-bool Sha256Verifier::verify(NetworkTask * /*aTask*/, const QByteArray &aData) {
-#if QT_VERSION >= 0x050000
-    m_CalculatedSha256 = QCryptographicHash::hash(aData, QCryptographicHash::Sha256).toHex();
-#else
-    m_CalculatedSha256 = CCryptographicHash::hash(aData, CCryptographicHash::Sha256).toHex();
-#endif
-
-    return (m_Sha256.compare(m_CalculatedSha256, Qt::CaseInsensitive) == 0);
+void HashVerifier::update(const QByteArray &aData) {
+    m_Context.addData(aData);
+}
+
+//------------------------------------------------------------------------
+bool HashVerifier::finish(NetworkTask * /*aTask*/) {
+    m_CalculatedHash = m_Context.result().toHex();
+
+    return (m_Hash.compare(m_CalculatedHash, Qt::CaseInsensitive) == 0);
 }
+
+//------------------------------------------------------------------------
+Md5Verifier::Md5Verifier(QString aMd5) : HashVerifier(QCryptographicHash::Md5, std::move(aMd5)) {}
+
+//------------------------------------------------------------------------
+Sha256Verifier::Sha256Verifier(QString aSha256)
+    : HashVerifier(QCryptographicHash::Sha256, std::move(aSha256)) {}
+
 //------------------------------------------------------------------------
@@ -10,12 +10,8 @@
 
 NetworkTask::NetworkTask()
     : m_Type(Get), m_Timeout(0), m_Error(NotReady), m_HttpError(0), m_Processing(false),
-      m_ParentThread(QThread::currentThread()), m_Flags(None), m_Size(0), m_CurrentSize(0) {
-    m_Timer.setParent(this);
-    m_Timer.setSingleShot(true);
-
-    connect(&m_Timer, SIGNAL(timeout()), SLOT(onTimeout()));
-}
+      m_ParentThread(QThread::currentThread()), m_Flags(None), m_TrafficClass(Interactive),
+      m_State(Created), m_Size(0), m_CurrentSize(0), m_VerifiedSize(-1) {}
 
 //------------------------------------------------------------------------
 NetworkTask::~NetworkTask() = default;
@@ -123,24 +119,31 @@ void NetworkTask::setProcessing(NetworkTaskManager *aManager, bool aProcessing)
     m_Processing = aProcessing;
 
     if (aProcessing) {
-        if (m_Timer.interval() != 0) {
-            m_Timer.start();
-        }
+        m_State = Queued;
+        m_Timings = STimings();
+        m_Clock.start();
 
         clearErrors();
 
+        m_VerifiedSize = -1;
+
         this->moveToThread(getManager()->thread());
 
         m_ProcessingMutex.lock();
     } else {
-        m_Timer.stop();
+        m_State = Finished;
+        m_Timings.total = m_Clock.isValid() ? m_Clock.elapsed() : -1;
 
         if (m_ParentThread != nullptr && m_ParentThread->isRunning()) {
             this->moveToThread(m_ParentThread);
         }
 
+        if (m_DataStream && !m_DataStream->flush() && getError() == NoError) {
+            setError(Stream_WriteError);
+        }
+
         if (m_Verifier) {
-            if (!m_Verifier->verify(this, getDataStream()->readAll())) {
+            if (!verifyData()) {
                 if (getError() == NoError) {
                     setError(VerifyFailed);
                 }
@@ -158,11 +161,29 @@ void NetworkTask::setProcessing(NetworkTaskManager *aManager, bool aProcessing)
 }
 
 //------------------------------------------------------------------------
-void NetworkTask::resetTimer() {
-    if (m_Processing) {
-        if (m_Timer.interval() != 0) {
-            m_Timer.start();
-        }
+void NetworkTask::markStarted() {
+    m_State = Running;
+    m_Timings.queue = m_Clock.elapsed();
+}
+
+//------------------------------------------------------------------------
+void NetworkTask::markConnecting() {
+    if (m_Timings.dns < 0 && m_Timings.queue >= 0) {
+        m_Timings.dns = m_Clock.elapsed() - m_Timings.queue;
+    }
+}
+
+//------------------------------------------------------------------------
+void NetworkTask::markRequestSent() {
+    if (m_Timings.connect < 0 && m_Timings.dns >= 0) {
+        m_Timings.connect = m_Clock.elapsed() - m_Timings.queue - m_Timings.dns;
+    }
+}
+
+//------------------------------------------------------------------------
+void NetworkTask::markFirstByte() {
+    if (m_Timings.firstByte < 0 && m_Timings.queue >= 0) {
+        m_Timings.firstByte = m_Clock.elapsed() - m_Timings.queue;
     }
 }
 
@@ -173,6 +194,73 @@ void NetworkTask::clearErrors() {
     m_HttpError = 0;
 }
 
+//------------------------------------------------------------------------
+void NetworkTask::startVerification() {
+    auto *verifier = dynamic_cast<IStreamVerifier *>(m_Verifier.data());
+
+    if (verifier && m_DataStream) {
+        feedVerifier(verifier, m_DataStream->pos());
+    }
+}
+
+//------------------------------------------------------------------------
+bool NetworkTask::writeData(const QByteArray &aData) {
+    if (!m_DataStream->write(aData)) {
+        m_VerifiedSize = -1;
+
+        return false;
+    }
+
+    if (m_VerifiedSize >= 0) {
+        static_cast<IStreamVerifier *>(m_Verifier.data())->update(aData);
+        m_VerifiedSize += aData.size();
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------
+bool NetworkTask::verifyData() {
+    auto *verifier = dynamic_cast<IStreamVerifier *>(m_Verifier.data());
+
+    if (!verifier) {
+        return m_Verifier->verify(this, getDataStream()->readAll());
+    }
+
+    // Если поток менялся не только через writeData (например, скачивать было нечего),
+    // сумма считается по его содержимому.
+    if (m_VerifiedSize != getDataStream()->size() &&
+        !feedVerifier(verifier, getDataStream()->size())) {
+        return false;
+    }
+
+    m_VerifiedSize = -1;
+
+    return verifier->finish(this);
+}
+
+//------------------------------------------------------------------------
+bool NetworkTask::feedVerifier(IStreamVerifier *aVerifier, qint64 aSize) {
+    aVerifier->reset();
+    m_VerifiedSize = -1;
+
+    for (qint64 offset = 0; offset < aSize;) {
+        QByteArray data =
+            m_DataStream->read(offset, qMin(aSize - offset, CNetworkTask::VerifyBlockSize));
+
+        if (data.isEmpty()) {
+            return false;
+        }
+
+        aVerifier->update(data);
+        offset += data.size();
+    }
+
+    m_VerifiedSize = aSize;
+
+    return true;
+}
+
 //------------------------------------------------------------------------
 void NetworkTask::setType(Type aType) {
     m_Type = aType;
@@ -195,7 +283,7 @@ const QUrl &NetworkTask::getUrl() const {
 
 //------------------------------------------------------------------------
 void NetworkTask::setTimeout(int aMsec) {
-    m_Timer.setInterval(aMsec);
+    m_Timeout = aMsec;
 }
 
 //------------------------------------------------------------------------
@@ -213,6 +301,16 @@ NetworkTask::Flags NetworkTask::getFlags() const {
     return m_Flags;
 }
 
+//------------------------------------------------------------------------
+void NetworkTask::setTrafficClass(TrafficClass aClass) {
+    m_TrafficClass = aClass;
+}
+
+//------------------------------------------------------------------------
+NetworkTask::TrafficClass NetworkTask::getTrafficClass() const {
+    return m_TrafficClass;
+}
+
 //------------------------------------------------------------------------
 void NetworkTask::setError(int aError, const QString &aMessage) {
     if ((getError() != QNetworkReply::NoError) &&
@@ -239,6 +337,16 @@ int NetworkTask::getHttpError() const {
     return m_HttpError;
 }
 
+//------------------------------------------------------------------------
+NetworkTask::State NetworkTask::getState() const {
+    return m_State;
+}
+
+//------------------------------------------------------------------------
+NetworkTask::STimings NetworkTask::getTimings() const {
+    return m_Timings;
+}
+
 //------------------------------------------------------------------------
 void NetworkTask::setVerifier(IVerifier *aVerifier) {
     m_Verifier = QSharedPointer<IVerifier>(aVerifier);
@@ -259,13 +367,6 @@ DataStream *NetworkTask::getDataStream() const {
     return m_DataStream.data();
 }
 
-//------------------------------------------------------------------------
-void NetworkTask::onTimeout() {
-    setError(NetworkTask::Timeout);
-
-    getManager()->removeTask(this);
-}
-
 //------------------------------------------------------------------------
 NetworkTask::TByteMap &NetworkTask::getRequestHeader() {
     return m_RequestHeader;
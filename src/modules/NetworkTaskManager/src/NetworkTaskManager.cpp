@@ -14,12 +14,29 @@
 
 const char CNetworkTaskManager::LogName[] = "DownloadManager";
 
-NetworkTaskManager::NetworkTaskManager(ILog *aLog) : ILogable(aLog) {
+//------------------------------------------------------------------------
+NetworkTaskManager::STaskEntry::STaskEntry(NetworkTask *aTask)
+    : key(aTask), task(aTask), trafficClass(aTask->getTrafficClass()) {}
+
+//------------------------------------------------------------------------
+NetworkTaskManager::NetworkTaskManager(ILog *aLog)
+    : ILogable(aLog), m_DownloadSpeedLimit(0), m_Timeouts(CNetworkTaskManager::TimeoutResolution) {
     qRegisterMetaType<QNetworkProxy>("QNetworkProxy");
     qRegisterMetaType<NetworkTask *>("NetworkTask");
 
     loadCerts();
 
+    m_ThrottleTimer.setParent(this);
+    m_ThrottleTimer.setInterval(CNetworkTaskManager::ThrottleInterval);
+
+    connect(&m_ThrottleTimer, SIGNAL(timeout()), SLOT(onThrottleTimeout()));
+
+    m_Clock.start();
+    m_WheelTimer.setParent(this);
+    m_WheelTimer.setInterval(CNetworkTaskManager::TimeoutResolution);
+
+    connect(&m_WheelTimer, SIGNAL(timeout()), SLOT(onWheelTimeout()));
+
     moveToThread(this);
 
     setObjectName("NetworkTaskManager");
@@ -50,6 +67,21 @@ void NetworkTaskManager::setDownloadSpeedLimit(int aPercent) {
         this, "onSetDownloadSpeedLimit", Qt::QueuedConnection, Q_ARG(int, aPercent));
 }
 
+//------------------------------------------------------------------------
+void NetworkTaskManager::setTrafficLimit(int aClass, qint64 aBytesPerSecond) {
+    metaObject()->invokeMethod(this,
+                               "onSetTrafficLimit",
+                               Qt::QueuedConnection,
+                               Q_ARG(int, aClass),
+                               Q_ARG(qint64, aBytesPerSecond));
+}
+
+//------------------------------------------------------------------------
+void NetworkTaskManager::setTotalTrafficLimit(qint64 aBytesPerSecond) {
+    metaObject()->invokeMethod(
+        this, "onSetTotalTrafficLimit", Qt::QueuedConnection, Q_ARG(qint64, aBytesPerSecond));
+}
+
 //------------------------------------------------------------------------
 void NetworkTaskManager::addTask(NetworkTask *aTask) {
     aTask->setProcessing(this, true);
@@ -68,14 +100,45 @@ void NetworkTaskManager::onSetProxy(const QNetworkProxy &aProxy) {
 }
 
 //------------------------------------------------------------------------
-void NetworkTaskManager::onSetDownloadSpeedLimit(int /*aPercent*/) {
-    // TODO:
+void NetworkTaskManager::onSetDownloadSpeedLimit(int aPercent) {
+    m_DownloadSpeedLimit = qBound(0, aPercent, 100);
+
+    if (m_DownloadSpeedLimit > 0 && m_Limiter.getTotalLimit() > 0) {
+        m_Limiter.setLimit(NetworkTask::Bulk,
+                           qMax(qint64(1), m_Limiter.getTotalLimit() * m_DownloadSpeedLimit / 100));
+    }
+}
+
+//------------------------------------------------------------------------
+void NetworkTaskManager::onSetTrafficLimit(int aClass, qint64 aBytesPerSecond) {
+    toLog(LogLevel::Normal,
+          QString("Traffic class %1 limit: %2 bytes/s.").arg(aClass).arg(aBytesPerSecond));
+
+    // Явно заданное ограничение фоновой загрузки заменяет процентное.
+    if (aClass == NetworkTask::Bulk) {
+        m_DownloadSpeedLimit = 0;
+    }
+
+    m_Limiter.setLimit(aClass, aBytesPerSecond);
+}
+
+//------------------------------------------------------------------------
+void NetworkTaskManager::onSetTotalTrafficLimit(qint64 aBytesPerSecond) {
+    toLog(LogLevel::Normal, QString("Total traffic limit: %1 bytes/s.").arg(aBytesPerSecond));
+
+    m_Limiter.setTotalLimit(aBytesPerSecond);
+
+    if (m_DownloadSpeedLimit > 0) {
+        onSetDownloadSpeedLimit(m_DownloadSpeedLimit);
+    }
 }
 
 //------------------------------------------------------------------------
 void NetworkTaskManager::onAddTask(NetworkTask *aTask) {
     toLog(LogLevel::Debug, QString("> url:%1").arg(aTask->getUrl().toString()));
 
+    aTask->markStarted();
+
     QNetworkRequest request;
 
     request.setUrl(aTask->getUrl());
@@ -145,8 +208,25 @@ void NetworkTaskManager::onAddTask(NetworkTask *aTask) {
     }
     }
 
-    // TODO m_Tasks[reply] = aTask;
-    m_Tasks[reply] = QPointer<NetworkTask>(aTask);
+    // Ответ прежнего запуска задачи (или удалённой задачи с тем же адресом) больше не нужен.
+    QNetworkReply *previous = m_Replies.value(aTask);
+
+    if (previous != nullptr) {
+        releaseReply(previous);
+    }
+
+    m_Tasks.insert(reply, STaskEntry(aTask));
+    m_Replies.insert(aTask, reply);
+
+    // Таймаут отсчитывается с момента addTask.
+    if (aTask->getTimeout() > 0) {
+        scheduleTimeout(reply, aTask->getTimeout() - aTask->getTimings().queue);
+    }
+
+    reply->setReadBufferSize(m_Limiter.isLimited(aTask->getTrafficClass())
+                                 ? CNetworkTaskManager::ThrottledReadBufferSize
+                                 : CNetworkTaskManager::ReadBufferSize);
+    m_Limiter.setActive(aTask->getTrafficClass(), true);
 
     connect(reply, SIGNAL(downloadProgress(qint64, qint64)), SLOT(onTaskProgress(qint64, qint64)));
     connect(
@@ -159,54 +239,126 @@ void NetworkTaskManager::onAddTask(NetworkTask *aTask) {
             SIGNAL(sslErrors(const QList<QSslError> &)),
             SLOT(onTaskSslErrors(const QList<QSslError> &)));
     connect(reply, SIGNAL(finished()), SLOT(onTaskComplete()));
+    connect(reply, SIGNAL(metaDataChanged()), SLOT(onTaskMetaDataChanged()));
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    connect(reply, SIGNAL(socketStartedConnecting()), SLOT(onTaskConnecting()));
+    connect(reply, SIGNAL(requestSent()), SLOT(onTaskRequestSent()));
+#endif
 }
 
 //------------------------------------------------------------------------
 void NetworkTaskManager::onRemoveTask(NetworkTask *aTask) {
-    for (TTaskMap::iterator it = m_Tasks.begin(); it != m_Tasks.end(); ++it) {
-        if (it.value().data() == aTask && !it.value().isNull()) {
-            disconnect(it.key(), nullptr, this, nullptr);
+    QNetworkReply *reply = m_Replies.value(aTask);
 
-            it.key()->close();
-            it.key()->abort();
+    if (reply == nullptr || taskOf(reply) != aTask) {
+        return;
+    }
 
-            if (aTask->getError() != 0) {
-                toLog(LogLevel::Error,
-                      QString("< Error: %1. HttpError: %2. Request URL: %3.")
-                          .arg(aTask->errorString())
-                          .arg(aTask->getHttpError())
-                          .arg(aTask->getUrl().toString()));
-            }
+    if (aTask->getError() != 0) {
+        toLog(LogLevel::Error,
+              QString("< Error: %1. HttpError: %2. Request URL: %3.")
+                  .arg(aTask->errorString())
+                  .arg(aTask->getHttpError())
+                  .arg(aTask->getUrl().toString()));
+    }
+
+    NetworkTask::STimings timings = aTask->getTimings();
+
+    toLog(LogLevel::Debug,
+          QString("< timings: queue %1, dns %2, connect %3, first byte %4 ms.")
+              .arg(timings.queue)
+              .arg(timings.dns)
+              .arg(timings.connect)
+              .arg(timings.firstByte));
+
+    releaseReply(reply);
+
+    aTask->setProcessing(this, false);
+}
+
+//------------------------------------------------------------------------
+void NetworkTaskManager::releaseReply(QNetworkReply *aReply) {
+    disconnect(aReply, nullptr, this, nullptr);
+
+    aReply->close();
+    aReply->abort();
 
-            it.value().data()->setProcessing(this, false);
+    m_Timeouts.cancel(aReply);
+    m_FinishedReplies.remove(aReply);
 
-            it.key()->deleteLater();
+    TTaskMap::iterator it = m_Tasks.find(aReply);
 
-            m_Tasks.erase(it);
+    if (it != m_Tasks.end()) {
+        // Каждый запущенный ответ занимал свой класс: заменённый, оборванный по таймауту и
+        // ответ удалённой задачи освобождают его так же, как и снятый с задачей.
+        m_Limiter.setActive(it->trafficClass, false);
 
-            return;
+        if (m_Replies.value(it->key) == aReply) {
+            m_Replies.remove(it->key);
         }
+
+        m_Tasks.erase(it);
     }
+
+    aReply->deleteLater();
 }
 
 //------------------------------------------------------------------------
-void NetworkTaskManager::onTaskProgress(qint64 aReceived, qint64 aTotal) {
-    TTaskMap::iterator it = m_Tasks.find(dynamic_cast<QNetworkReply *>(sender()));
+NetworkTask *NetworkTaskManager::taskOf(QNetworkReply *aReply) const {
+    TTaskMap::const_iterator it = m_Tasks.constFind(aReply);
+
+    return it != m_Tasks.constEnd() ? it->task.data() : nullptr;
+}
+
+//------------------------------------------------------------------------
+void NetworkTaskManager::scheduleTimeout(QNetworkReply *aReply, qint64 aTimeout) {
+    m_Timeouts.schedule(aReply, m_Clock.elapsed() + aTimeout);
+
+    if (!m_WheelTimer.isActive()) {
+        m_WheelTimer.start();
+    }
+}
+
+//------------------------------------------------------------------------
+void NetworkTaskManager::onWheelTimeout() {
+    foreach (QNetworkReply *reply, m_Timeouts.advance(m_Clock.elapsed())) {
+        NetworkTask *task = taskOf(reply);
+
+        if (task != nullptr) {
+            task->setError(NetworkTask::Timeout);
+
+            onRemoveTask(task);
+        } else if (m_Tasks.contains(reply)) {
+            releaseReply(reply);
+        }
+    }
 
-    if (it != m_Tasks.end() && !it.value().isNull()) {
-        auto *task = it.value().data();
+    if (m_Timeouts.isEmpty()) {
+        m_WheelTimer.stop();
+    }
+}
 
+//------------------------------------------------------------------------
+void NetworkTaskManager::onTaskProgress(qint64 aReceived, qint64 aTotal) {
+    auto *reply = dynamic_cast<QNetworkReply *>(sender());
+    NetworkTask *task = taskOf(reply);
+
+    if (task != nullptr) {
         task->setSize(aReceived, aTotal);
-        task->resetTimer();
+
+        if (task->getTimeout() > 0) {
+            scheduleTimeout(reply, task->getTimeout());
+        }
     }
 }
 
 //------------------------------------------------------------------------
 void NetworkTaskManager::onTaskUploadProgress(qint64 /*unused*/, qint64 /*unused*/) {
-    TTaskMap::iterator it = m_Tasks.find(dynamic_cast<QNetworkReply *>(sender()));
+    auto *reply = dynamic_cast<QNetworkReply *>(sender());
+    NetworkTask *task = taskOf(reply);
 
-    if (it != m_Tasks.end() && !it.value().isNull()) {
-        it.value().data()->resetTimer();
+    if (task != nullptr && task->getTimeout() > 0) {
+        scheduleTimeout(reply, task->getTimeout());
     }
 }
 
@@ -214,90 +366,108 @@ void NetworkTaskManager::onTaskUploadProgress(qint64 /*unused*/, qint64 /*unused
 void NetworkTaskManager::onTaskReadyRead() {
     auto *reply = dynamic_cast<QNetworkReply *>(sender());
 
-    if ((reply != nullptr) && m_Tasks.contains(reply) && !m_Tasks.value(reply).isNull()) {
-        auto *task = m_Tasks.value(reply).data();
-
-        if (task) {
-            QVariant httpStatusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
-            if (httpStatusCode.isValid()) {
-                int statusCode = httpStatusCode.toInt();
-                task->setHttpError(statusCode);
+    if (reply != nullptr) {
+        readReply(reply);
+    }
+}
 
-                switch (statusCode) {
-                // Ошибка в заголовоке Range
-                case 416: {
-                    toLog(LogLevel::Error,
-                          "Request range header is wrong, "
-                          "cannot download content.");
+//------------------------------------------------------------------------
+void NetworkTaskManager::readReply(QNetworkReply *aReply) {
+    NetworkTask *task = taskOf(aReply);
+
+    if (task != nullptr) {
+        QVariant httpStatusCode = aReply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+        if (httpStatusCode.isValid()) {
+            int statusCode = httpStatusCode.toInt();
+            task->setHttpError(statusCode);
+
+            switch (statusCode) {
+            // Ошибка в заголовоке Range
+            case 416: {
+                toLog(LogLevel::Error,
+                      "Request range header is wrong, "
+                      "cannot download content.");
 
-                    task->setError(NetworkTask::BadTask);
-                    reply->abort();
-                    break;
-                }
+                task->setError(NetworkTask::BadTask);
+                aReply->abort();
+                break;
+            }
 
-                case 200: // Успех.
-                case 206: // Успех частичного скачивания.
+            case 200: // Успех.
+            case 206: // Успех частичного скачивания.
+            {
+                if (task->getSize() == 0) // выполняем этот код, только в момент получения
+                                          // первого пакета данных
                 {
-                    if (task->getSize() == 0) // выполняем этот код, только в момент получения
-                                              // первого пакета данных
-                    {
-                        QString contentRange =
-                            QString::fromLatin1(reply->rawHeader("Content-Range"));
-
-                        if (contentRange.isEmpty()) {
-                            // Если запрашивали кусок данных, а пришел файл
-                            // целиком - нужно начинать писать поток с 0-го
-                            // байта
-                            task->getDataStream()->clear();
-                        } else {
-                            // Если запрашивали кусок данных, позиционируем на
-                            // начало передаваемого диапазона
-                            // http://tools.ietf.org/html/rfc2616#section-14.16
-                            QRegularExpression rx(R"((\d+)\-\d+/\d+)");
-
-                            auto match = rx.match(contentRange);
-                            if (match.hasMatch()) {
-                                qint64 pos = match.captured(1).toLongLong();
-
-                                if (!task->getDataStream()->seek(pos)) {
-                                    toLog(LogLevel::Error,
-                                          QString("Content-Range: %1. Error seek "
-                                                  "stream to position: %2.")
-                                              .arg(contentRange)
-                                              .arg(pos));
-                                }
-                            } else {
+                    QString contentRange =
+                        QString::fromLatin1(aReply->rawHeader("Content-Range"));
+
+                    if (contentRange.isEmpty()) {
+                        // Если запрашивали кусок данных, а пришел файл
+                        // целиком - нужно начинать писать поток с 0-го
+                        // байта
+                        task->getDataStream()->clear();
+                    } else {
+                        // Если запрашивали кусок данных, позиционируем на
+                        // начало передаваемого диапазона
+                        // http://tools.ietf.org/html/rfc2616#section-14.16
+                        QRegularExpression rx(R"((\d+)\-\d+/\d+)");
+
+                        auto match = rx.match(contentRange);
+                        if (match.hasMatch()) {
+                            qint64 pos = match.captured(1).toLongLong();
+
+                            if (!task->getDataStream()->seek(pos)) {
                                 toLog(LogLevel::Error,
-                                      QString("Can't parse Content-Range: %1.").arg(contentRange));
-
-                                task->getDataStream()->clear();
+                                      QString("Content-Range: %1. Error seek "
+                                              "stream to position: %2.")
+                                          .arg(contentRange)
+                                          .arg(pos));
                             }
+                        } else {
+                            toLog(LogLevel::Error,
+                                  QString("Can't parse Content-Range: %1.").arg(contentRange));
+
+                            task->getDataStream()->clear();
                         }
                     }
 
-                    QByteArray replyData = reply->readAll();
+                    task->startVerification();
+                }
 
-                    toLog(LogLevel::Debug,
-                          QString("< receive %1%2 bytes.")
-                              .arg(statusCode == 206 ? "(partial) " : "")
-                              .arg(replyData.size()));
+                qint64 available = aReply->bytesAvailable();
+                QByteArray replyData =
+                    aReply->read(m_Limiter.acquire(task->getTrafficClass(), available));
 
-                    if (!task->getDataStream()->write(replyData)) {
-                        toLog(LogLevel::Error, "Cannot save received data to the stream.");
-                        task->setError(NetworkTask::Stream_WriteError);
-                        reply->abort();
-                    }
+                // Остаток ответа дочитывается по таймеру по мере накопления токенов.
+                if (replyData.size() < available && !m_ThrottleTimer.isActive()) {
+                    m_ThrottleTimer.start();
+                }
 
+                if (replyData.isEmpty()) {
                     break;
                 }
 
-                default:
-                    toLog(LogLevel::Error,
-                          QString("Data is ready for read, but response code "
-                                  "is incorrect: %1")
-                              .arg(httpStatusCode.toString()));
-                    reply->abort();
+                toLog(LogLevel::Debug,
+                      QString("< receive %1%2 bytes.")
+                          .arg(statusCode == 206 ? "(partial) " : "")
+                          .arg(replyData.size()));
+
+                if (!task->writeData(replyData)) {
+                    toLog(LogLevel::Error, "Cannot save received data to the stream.");
+                    task->setError(NetworkTask::Stream_WriteError);
+                    aReply->abort();
                 }
+
+                break;
+            }
+
+            default:
+                toLog(LogLevel::Error,
+                      QString("Data is ready for read, but response code "
+                              "is incorrect: %1")
+                          .arg(httpStatusCode.toString()));
+                aReply->abort();
             }
         }
     }
@@ -305,25 +475,24 @@ void NetworkTaskManager::onTaskReadyRead() {
 
 //------------------------------------------------------------------------
 void NetworkTaskManager::onTaskError(QNetworkReply::NetworkError aError) {
-    for (TTaskMap::iterator it = m_Tasks.begin(); it != m_Tasks.end(); ++it) {
-        if (it.key() == sender() && !it.value().isNull()) {
-            it.value().data()->setError(aError, it.key()->errorString());
-
-            switch (aError) {
-            case QNetworkReply::ConnectionRefusedError:
-            case QNetworkReply::RemoteHostClosedError:
-            case QNetworkReply::HostNotFoundError:
-            case QNetworkReply::TimeoutError:
-            case QNetworkReply::TemporaryNetworkFailureError:
-            case QNetworkReply::ProxyNotFoundError:
-            case QNetworkReply::ProxyTimeoutError:
-                emit networkTaskStatus(true);
-                break;
-            default:
-                break;
-            }
-
-            return;
+    auto *reply = dynamic_cast<QNetworkReply *>(sender());
+    NetworkTask *task = taskOf(reply);
+
+    if (task != nullptr) {
+        task->setError(aError, reply->errorString());
+
+        switch (aError) {
+        case QNetworkReply::ConnectionRefusedError:
+        case QNetworkReply::RemoteHostClosedError:
+        case QNetworkReply::HostNotFoundError:
+        case QNetworkReply::TimeoutError:
+        case QNetworkReply::TemporaryNetworkFailureError:
+        case QNetworkReply::ProxyNotFoundError:
+        case QNetworkReply::ProxyTimeoutError:
+            emit networkTaskStatus(true);
+            break;
+        default:
+            break;
         }
     }
 }
@@ -351,51 +520,133 @@ void NetworkTaskManager::onTaskSslErrors(const QList<QSslError> &aErrors) {
 void NetworkTaskManager::onTaskComplete() {
     auto *reply = dynamic_cast<QNetworkReply *>(sender());
 
-    for (TTaskMap::iterator it = m_Tasks.begin(); it != m_Tasks.end(); ++it) {
-        if (it.key() == reply && !it.value().isNull()) {
-            auto *task = it.value().data();
+    // Ответ получен, но часть данных ещё ждёт токенов ограничителя скорости.
+    if (reply != nullptr && reply->bytesAvailable() > 0 && taskOf(reply) != nullptr) {
+        m_FinishedReplies.insert(reply);
 
-            int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (!m_ThrottleTimer.isActive()) {
+            m_ThrottleTimer.start();
+        }
 
-            QList<QByteArray> headers = reply->rawHeaderList();
-            foreach (QByteArray header, headers) {
-                task->getResponseHeader().insert(header, reply->rawHeader(header));
-            }
+        return;
+    }
 
-            task->getResponseHeader().insert(
-                "Content-Type", reply->header(QNetworkRequest::ContentTypeHeader).toByteArray());
-
-            if (reply->error() != QNetworkReply::OperationCanceledError) {
-                task->setError(reply->error(), reply->errorString());
-                if ((statusCode != 0) &&
-                    ((statusCode == 301) || (statusCode == 416) || (statusCode == 404))) {
-                    toLog(LogLevel::Warning,
-                          QString("Set bad task error, because statusCode=%1.").arg(statusCode));
-
-                    task->setHttpError(statusCode);
-                    task->setError(NetworkTask::BadTask);
-                } else if (task->getCurrentSize() != task->getSize()) {
-                    toLog(LogLevel::Warning,
-                          QString("Set bad task error, because taskSize != "
-                                  "size: (%1 != %2).")
-                              .arg(task->getCurrentSize())
-                              .arg(task->getSize()));
-
-                    // Qt error work around.
-                    task->setError(NetworkTask::BadTask);
-                }
+    completeReply(reply);
+}
+
+//------------------------------------------------------------------------
+void NetworkTaskManager::completeReply(QNetworkReply *aReply) {
+    NetworkTask *task = taskOf(aReply);
+
+    if (task == nullptr) {
+        // Задачу удалили, не дождавшись ответа.
+        if (m_Tasks.contains(aReply)) {
+            releaseReply(aReply);
+        }
+
+        return;
+    }
+
+    int statusCode = aReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    QList<QByteArray> headers = aReply->rawHeaderList();
+    foreach (QByteArray header, headers) {
+        task->getResponseHeader().insert(header, aReply->rawHeader(header));
+    }
+
+    task->getResponseHeader().insert(
+        "Content-Type", aReply->header(QNetworkRequest::ContentTypeHeader).toByteArray());
+
+    if (aReply->error() != QNetworkReply::OperationCanceledError) {
+        task->setError(aReply->error(), aReply->errorString());
+        if ((statusCode != 0) &&
+            ((statusCode == 301) || (statusCode == 416) || (statusCode == 404))) {
+            toLog(LogLevel::Warning,
+                  QString("Set bad task error, because statusCode=%1.").arg(statusCode));
+
+            task->setHttpError(statusCode);
+            task->setError(NetworkTask::BadTask);
+        } else if (task->getCurrentSize() != task->getSize()) {
+            toLog(LogLevel::Warning,
+                  QString("Set bad task error, because taskSize != "
+                          "size: (%1 != %2).")
+                      .arg(task->getCurrentSize())
+                      .arg(task->getSize()));
+
+            // Qt error work around.
+            task->setError(NetworkTask::BadTask);
+        }
+    }
+
+    if (task->getError() == 0) {
+        // сообщаем об успешном статусе задачи
+        emit networkTaskStatus(false);
+    }
+
+    removeTask(task);
+}
+
+//------------------------------------------------------------------------
+void NetworkTaskManager::onTaskMetaDataChanged() {
+    NetworkTask *task = taskOf(dynamic_cast<QNetworkReply *>(sender()));
+
+    if (task != nullptr) {
+        task->markFirstByte();
+    }
+}
+
+//------------------------------------------------------------------------
+void NetworkTaskManager::onTaskConnecting() {
+    NetworkTask *task = taskOf(dynamic_cast<QNetworkReply *>(sender()));
+
+    if (task != nullptr) {
+        task->markConnecting();
+    }
+}
+
+//------------------------------------------------------------------------
+void NetworkTaskManager::onTaskRequestSent() {
+    NetworkTask *task = taskOf(dynamic_cast<QNetworkReply *>(sender()));
+
+    if (task != nullptr) {
+        task->markRequestSent();
+    }
+}
+
+//------------------------------------------------------------------------
+void NetworkTaskManager::onThrottleTimeout() {
+    bool pending = false;
+
+    // Ответы с большим приоритетом получают токены первыми.
+    for (int trafficClass = NetworkTask::Interactive; trafficClass <= NetworkTask::Bulk;
+         ++trafficClass) {
+        foreach (QNetworkReply *reply, m_Tasks.keys()) {
+            NetworkTask *task = taskOf(reply);
+
+            if (task == nullptr || task->getTrafficClass() != trafficClass) {
+                continue;
             }
 
-            if (task->getError() == 0) {
-                // сообщаем об успешном статусе задачи
-                emit networkTaskStatus(false);
+            if (reply->bytesAvailable() > 0) {
+                readReply(reply);
             }
 
-            removeTask(task);
+            // Ответ мог быть прерван при чтении и уже удалён из списка задач.
+            if (!m_Tasks.contains(reply)) {
+                continue;
+            }
 
-            return;
+            if (reply->bytesAvailable() > 0) {
+                pending = true;
+            } else if (m_FinishedReplies.remove(reply)) {
+                completeReply(reply);
+            }
         }
     }
+
+    if (!pending) {
+        m_ThrottleTimer.stop();
+    }
 }
 
 //------------------------------------------------------------------------
@@ -473,7 +724,14 @@ void NetworkTaskManager::clearTasks() {
 //------------------------------------------------------------------------
 void NetworkTaskManager::onClearTasks() {
     while (!m_Tasks.isEmpty()) {
-        onRemoveTask(m_Tasks.begin().value().data());
+        QNetworkReply *reply = m_Tasks.begin().key();
+        NetworkTask *task = taskOf(reply);
+
+        if (task != nullptr) {
+            onRemoveTask(task);
+        } else {
+            releaseReply(reply);
+        }
     }
 }
 
@@ -2,11 +2,15 @@
 
 // Stl
 
+#include <QtCore/QDataStream>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
 #include <QtCore/QRegularExpression>
 #include <QtCore/QStringList>
 
 #include <SDK/PaymentProcessor/Settings/Commissions.h>
 
+#include <algorithm>
 #include <boost/foreach.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <cmath>
@@ -16,6 +20,58 @@
 namespace SDK {
 namespace PaymentProcessor {
 
+namespace CCommissions {
+/// Длительность суток в миллисекундах.
+const int MSecsPerDay = 24 * 60 * 60 * 1000;
+} // namespace CCommissions
+
+namespace {
+/// Время для сравнения: недействительное QTime меньше любого действительного.
+int timeKey(const QTime &aTime) {
+    return aTime.isValid() ? aTime.msecsSinceStartOfDay() : -1;
+}
+} // namespace
+
+//----------------------------------------------------------------------------
+/// Таблица порогов: отсортированные границы сумм и готовый ответ для каждой границы и каждого
+/// интервала между ними. Ответ - номер в answers, -1 - комиссия по умолчанию.
+struct Commissions::STable {
+    QVector<double> bounds;
+    QVector<int> points;
+    QVector<int> intervals;
+    QVector<Commission> answers;
+
+    /// Исходная цепочка списков для сумм, неотличимых от границы при сравнении qFuzzyCompare.
+    QList<CommissionList> chain;
+
+    /// Результат getCommissions().
+    TCommissions current;
+};
+
+//----------------------------------------------------------------------------
+/// Правила оператора, развёрнутые по дням недели и временным окнам.
+struct Commissions::SCompiled {
+    /// Номер таблицы для дня aDay и времени aTime.
+    int find(int aDay, const QTime &aTime) const {
+        int slot =
+            int(std::upper_bound(times.begin(), times.end(), timeKey(aTime)) - times.begin()) - 1;
+
+        return tableIndex[(aDay - Commission::Mon) * times.size() + slot];
+    }
+
+    /// Начала временных окон, первое - 0.
+    QVector<int> times;
+    QVector<int> tableIndex;
+    QVector<STable> tables;
+};
+
+//----------------------------------------------------------------------------
+struct Commissions::SCompiledCache {
+    QMutex mutex;
+    QHash<qint64, QSharedPointer<const SCompiled>> providers;
+    QSharedPointer<const SCompiled> defaults;
+};
+
 //----------------------------------------------------------------------------
 Commission::Commission()
     : m_Value(0.0), m_Above(CCommissions::DefaultAboveValue),
@@ -279,10 +335,13 @@ CommissionList CommissionList::from_Variant(const QVariant &aCommissions) {
 CommissionByTimeList::CommissionByTimeList() = default;
 
 //----------------------------------------------------------------------------
-TCommissions CommissionByTimeList::getCommissions() const {
-    QTime currentTime = QTime::currentTime();
+bool CommissionByTimeList::contains(const QTime &aTime) const {
+    return (m_Begin <= aTime) && (aTime <= m_End);
+}
 
-    if ((currentTime >= m_Begin) && (currentTime <= m_End)) {
+//----------------------------------------------------------------------------
+TCommissions CommissionByTimeList::getCommissions(const QTime &aTime) const {
+    if (contains(aTime)) {
         return m_Commissions.getCommissions();
     }
     return {};
@@ -290,10 +349,9 @@ TCommissions CommissionByTimeList::getCommissions() const {
 
 //----------------------------------------------------------------------------
 bool CommissionByTimeList::query(double aSum,
+                                 const QTime &aTime,
                                  SDK::PaymentProcessor::Commission &aCommission) const {
-    QTime time(QTime::currentTime());
-
-    if ((m_Begin <= time) && (time <= m_End)) {
+    if (contains(aTime)) {
         return m_Commissions.query(aSum, aCommission);
     }
 
@@ -331,12 +389,17 @@ CommissionByTimeList CommissionByTimeList::from_Variant(const QVariant &aCommiss
 CommissionByDayList::CommissionByDayList() = default;
 
 //----------------------------------------------------------------------------
-TCommissions CommissionByDayList::getCommissions() const {
+bool CommissionByDayList::contains(Commission::Day aDay) const {
+    return m_Days.contains(aDay);
+}
+
+//----------------------------------------------------------------------------
+TCommissions CommissionByDayList::getCommissions(Commission::Day aDay, const QTime &aTime) const {
     TCommissions result;
 
-    if (m_Days.contains(static_cast<Commission::Day>(QDate::currentDate().dayOfWeek()))) {
+    if (contains(aDay)) {
         foreach (const CommissionByTimeList &commissionByTime, m_CommissionsByTime) {
-            result = commissionByTime.getCommissions();
+            result = commissionByTime.getCommissions(aTime);
 
             if (!result.isEmpty()) {
                 break;
@@ -352,10 +415,13 @@ TCommissions CommissionByDayList::getCommissions() const {
 }
 
 //----------------------------------------------------------------------------
-bool CommissionByDayList::query(double aSum, SDK::PaymentProcessor::Commission &aCommission) const {
-    if (m_Days.contains(static_cast<Commission::Day>(QDate::currentDate().dayOfWeek()))) {
+bool CommissionByDayList::query(double aSum,
+                                Commission::Day aDay,
+                                const QTime &aTime,
+                                SDK::PaymentProcessor::Commission &aCommission) const {
+    if (contains(aDay)) {
         foreach (const CommissionByTimeList &commissionByTime, m_CommissionsByTime) {
-            if (commissionByTime.query(aSum, aCommission)) {
+            if (commissionByTime.query(aSum, aTime, aCommission)) {
                 return true;
             }
         }
@@ -471,7 +537,7 @@ bool ProcessingCommission::isNull() const {
 }
 
 //----------------------------------------------------------------------------
-Commissions::Commissions() : m_IsValid(false) {}
+Commissions::Commissions() : m_IsValid(false), m_Cache(new SCompiledCache()) {}
 
 //----------------------------------------------------------------------------
 bool Commissions::SComplexCommissions::sortByMinLimit(const Commission &aFirst,
@@ -480,16 +546,17 @@ bool Commissions::SComplexCommissions::sortByMinLimit(const Commission &aFirst,
 }
 
 //----------------------------------------------------------------------------
-TCommissions Commissions::SComplexCommissions::getCommissions() const {
+TCommissions Commissions::SComplexCommissions::getCommissions(Commission::Day aDay,
+                                                             const QTime &aTime) const {
     TCommissions result;
 
     foreach (const CommissionByDayList &commissionByDay, commissionsByDay) {
-        result << commissionByDay.getCommissions();
+        result << commissionByDay.getCommissions(aDay, aTime);
     }
 
     if (result.isEmpty()) {
         foreach (const CommissionByTimeList &commissionByTime, commissionsByTime) {
-            result << commissionByTime.getCommissions();
+            result << commissionByTime.getCommissions(aTime);
         }
 
         if (result.isEmpty()) {
@@ -503,17 +570,19 @@ TCommissions Commissions::SComplexCommissions::getCommissions() const {
 }
 
 //----------------------------------------------------------------------------
-Commission Commissions::SComplexCommissions::query(double aSum) const {
+Commission Commissions::SComplexCommissions::query(double aSum,
+                                                   Commission::Day aDay,
+                                                   const QTime &aTime) const {
     Commission result;
 
     foreach (const CommissionByDayList &commissionByDay, commissionsByDay) {
-        if (commissionByDay.query(aSum, result)) {
+        if (commissionByDay.query(aSum, aDay, aTime, result)) {
             return result;
         }
     }
 
     foreach (const CommissionByTimeList &commissionByTime, commissionsByTime) {
-        if (commissionByTime.query(aSum, result)) {
+        if (commissionByTime.query(aSum, aTime, result)) {
             return result;
         }
     }
@@ -525,20 +594,252 @@ Commission Commissions::SComplexCommissions::query(double aSum) const {
 
 //----------------------------------------------------------------------------
 TCommissions Commissions::getCommissions(qint64 aProvider) const {
-    if (m_ProviderCommissions.contains(aProvider)) {
-        return m_ProviderCommissions[aProvider].getCommissions();
+    return getCommissions(aProvider, QDateTime::currentDateTime());
+}
+
+//----------------------------------------------------------------------------
+Commission Commissions::getCommission(qint64 aProvider, double aSum) const {
+    return getCommission(aProvider, aSum, QDateTime::currentDateTime());
+}
+
+//----------------------------------------------------------------------------
+TCommissions Commissions::getCommissions(qint64 aProvider, const QDateTime &aTime) const {
+    int day = aTime.date().dayOfWeek();
+
+    if (day < Commission::Mon || day > Commission::Sun || !aTime.time().isValid()) {
+        return findCommissions(aProvider, aTime);
     }
 
-    return m_DefaultCommissions.getCommissions();
+    QSharedPointer<const SCompiled> compiled = getCompiled(aProvider);
+
+    return compiled->tables[compiled->find(day, aTime.time())].current;
 }
 
 //----------------------------------------------------------------------------
-Commission Commissions::getCommission(qint64 aProvider, double aSum) const {
-    if (m_ProviderCommissions.contains(aProvider)) {
-        return m_ProviderCommissions[aProvider].query(aSum);
+Commission Commissions::getCommission(qint64 aProvider, double aSum, const QDateTime &aTime) const {
+    int day = aTime.date().dayOfWeek();
+
+    if (day < Commission::Mon || day > Commission::Sun || !aTime.time().isValid()) {
+        return findCommission(aProvider, aSum, aTime);
+    }
+
+    QSharedPointer<const SCompiled> compiled = getCompiled(aProvider);
+
+    return evaluate(compiled->tables[compiled->find(day, aTime.time())], aSum);
+}
+
+//----------------------------------------------------------------------------
+TCommissions Commissions::findCommissions(qint64 aProvider, const QDateTime &aTime) const {
+    return getRules(aProvider).getCommissions(
+        static_cast<Commission::Day>(aTime.date().dayOfWeek()), aTime.time());
+}
+
+//----------------------------------------------------------------------------
+Commission
+Commissions::findCommission(qint64 aProvider, double aSum, const QDateTime &aTime) const {
+    return getRules(aProvider).query(
+        aSum, static_cast<Commission::Day>(aTime.date().dayOfWeek()), aTime.time());
+}
+
+//----------------------------------------------------------------------------
+const Commissions::SComplexCommissions &Commissions::getRules(qint64 aProvider) const {
+    auto it = m_ProviderCommissions.constFind(aProvider);
+
+    return it == m_ProviderCommissions.constEnd() ? m_DefaultCommissions : it.value();
+}
+
+//----------------------------------------------------------------------------
+QSharedPointer<const Commissions::SCompiled> Commissions::getCompiled(qint64 aProvider) const {
+    QMutexLocker locker(&m_Cache->mutex);
+
+    auto it = m_ProviderCommissions.constFind(aProvider);
+
+    if (it == m_ProviderCommissions.constEnd()) {
+        if (!m_Cache->defaults) {
+            m_Cache->defaults = compile(m_DefaultCommissions);
+        }
+
+        return m_Cache->defaults;
+    }
+
+    QSharedPointer<const SCompiled> &compiled = m_Cache->providers[aProvider];
+
+    if (!compiled) {
+        compiled = compile(it.value());
     }
 
-    return m_DefaultCommissions.query(aSum);
+    return compiled;
+}
+
+//----------------------------------------------------------------------------
+QSharedPointer<const Commissions::SCompiled>
+Commissions::compile(const SComplexCommissions &aCommissions) {
+    QSharedPointer<SCompiled> compiled(new SCompiled());
+
+    // Границы временных окон: начало и момент сразу после конца каждого окна.
+    compiled->times << 0;
+
+    auto addWindow = [&compiled](const CommissionByTimeList &aList) {
+        int begin = timeKey(aList.m_Begin);
+        int end = timeKey(aList.m_End);
+
+        if (begin > 0 && begin < CCommissions::MSecsPerDay) {
+            compiled->times << begin;
+        }
+
+        if (end >= 0 && end + 1 < CCommissions::MSecsPerDay) {
+            compiled->times << end + 1;
+        }
+    };
+
+    foreach (const CommissionByDayList &commissionByDay, aCommissions.commissionsByDay) {
+        foreach (const CommissionByTimeList &commissionByTime,
+                 commissionByDay.m_CommissionsByTime) {
+            addWindow(commissionByTime);
+        }
+    }
+
+    foreach (const CommissionByTimeList &commissionByTime, aCommissions.commissionsByTime) {
+        addWindow(commissionByTime);
+    }
+
+    std::sort(compiled->times.begin(), compiled->times.end());
+    compiled->times.erase(std::unique(compiled->times.begin(), compiled->times.end()),
+                          compiled->times.end());
+
+    // Для каждого дня и окна - цепочка списков в порядке обхода query(). Одинаковые цепочки
+    // используют одну таблицу.
+    QHash<QVector<int>, int> tableByChain;
+
+    for (int day = Commission::Mon; day <= Commission::Sun; ++day) {
+        foreach (int start, compiled->times) {
+            QTime time = QTime::fromMSecsSinceStartOfDay(start);
+            QVector<int> key;
+            QList<CommissionList> chain;
+            int id = 0;
+
+            foreach (const CommissionByDayList &commissionByDay, aCommissions.commissionsByDay) {
+                bool dayMatched = commissionByDay.contains(static_cast<Commission::Day>(day));
+
+                foreach (const CommissionByTimeList &commissionByTime,
+                         commissionByDay.m_CommissionsByTime) {
+                    if (dayMatched && commissionByTime.contains(time)) {
+                        key << id;
+                        chain << commissionByTime.m_Commissions;
+                    }
+
+                    ++id;
+                }
+
+                if (dayMatched) {
+                    key << id;
+                    chain << commissionByDay.m_Commissions;
+                }
+
+                ++id;
+            }
+
+            foreach (const CommissionByTimeList &commissionByTime, aCommissions.commissionsByTime) {
+                if (commissionByTime.contains(time)) {
+                    key << id;
+                    chain << commissionByTime.m_Commissions;
+                }
+
+                ++id;
+            }
+
+            chain << aCommissions.commissions;
+
+            int table = tableByChain.value(key, -1);
+
+            if (table < 0) {
+                table = compiled->tables.size();
+                tableByChain.insert(key, table);
+                compiled->tables << compileTable(
+                    chain, aCommissions.getCommissions(static_cast<Commission::Day>(day), time));
+            }
+
+            compiled->tableIndex << table;
+        }
+    }
+
+    return compiled;
+}
+
+//----------------------------------------------------------------------------
+Commissions::STable Commissions::compileTable(const QList<CommissionList> &aChain,
+                                              const TCommissions &aCurrent) {
+    STable table;
+    table.chain = aChain;
+    table.current = aCurrent;
+
+    foreach (const CommissionList &list, aChain) {
+        foreach (const Commission &commission, list.m_Commissions) {
+            table.bounds << commission.m_Above << commission.m_Below;
+        }
+    }
+
+    std::sort(table.bounds.begin(), table.bounds.end());
+    table.bounds.erase(std::unique(table.bounds.begin(), table.bounds.end()), table.bounds.end());
+
+    // Ответ для суммы, представляющей границу или интервал: номер в answers, -1 - комиссии нет.
+    auto answer = [&table](double aSum) -> int {
+        Commission commission;
+
+        foreach (const CommissionList &list, table.chain) {
+            if (list.query(aSum, commission)) {
+                table.answers << commission;
+                return table.answers.size() - 1;
+            }
+        }
+
+        return -1;
+    };
+
+    const QVector<double> &bounds = table.bounds;
+
+    if (bounds.isEmpty()) {
+        table.intervals << answer(0.0);
+        return table;
+    }
+
+    table.intervals << answer(bounds.first() - 1.0 - qAbs(bounds.first()));
+
+    for (int i = 0; i < bounds.size(); ++i) {
+        table.points << answer(bounds[i]);
+        table.intervals << answer(i + 1 < bounds.size() ? (bounds[i] + bounds[i + 1]) / 2.0
+                                                        : bounds[i] + 1.0 + qAbs(bounds[i]));
+    }
+
+    return table;
+}
+
+//----------------------------------------------------------------------------
+Commission Commissions::evaluate(const STable &aTable, double aSum) {
+    const double *bounds = aTable.bounds.constData();
+    int count = aTable.bounds.size();
+    int i = int(std::upper_bound(bounds, bounds + count, aSum) - bounds);
+    int answer = -1;
+
+    if (i > 0 && bounds[i - 1] == aSum) {
+        answer = aTable.points[i - 1];
+    } else if ((i > 0 && qFuzzyCompare(aSum, bounds[i - 1])) ||
+               (i < count && qFuzzyCompare(aSum, bounds[i]))) {
+        // Сумма в окрестности границы: результат зависит от нечёткого сравнения, считаем напрямую.
+        Commission commission;
+
+        foreach (const CommissionList &list, aTable.chain) {
+            if (list.query(aSum, commission)) {
+                return commission;
+            }
+        }
+
+        return commission;
+    } else {
+        answer = aTable.intervals[i];
+    }
+
+    return answer < 0 ? Commission() : aTable.answers[answer];
 }
 
 //----------------------------------------------------------------------------
@@ -678,6 +979,8 @@ void Commissions::appendFrom_Settings(const TPtree &aSettings) {
             }
         }
     }
+
+    m_Cache.reset(new SCompiledCache());
 }
 
 //----------------------------------------------------------------------------
@@ -686,6 +989,210 @@ void Commissions::clear() {
 
     m_ProviderCommissions.clear();
     m_ProcessingCommissions.clear();
+    m_Cache.reset(new SCompiledCache());
+}
+
+//----------------------------------------------------------------------------
+Commissions Commissions::from_Snapshot(QDataStream &aStream) {
+    Commissions result;
+    quint32 count = 0;
+
+    aStream >> result.m_IsValid >> count;
+
+    for (quint32 i = 0; i < count && aStream.status() == QDataStream::Ok; ++i) {
+        qint64 provider = 0;
+        SComplexCommissions commissions;
+
+        aStream >> provider;
+        read(aStream, commissions);
+        result.m_ProviderCommissions.insert(provider, commissions);
+    }
+
+    aStream >> count;
+
+    for (quint32 i = 0; i < count && aStream.status() == QDataStream::Ok; ++i) {
+        qint64 provider = 0;
+        ProcessingCommission commission;
+
+        aStream >> provider;
+        read(aStream, commission);
+        result.m_ProcessingCommissions.insert(provider, commission);
+    }
+
+    read(aStream, result.m_DefaultCommissions);
+
+    return result;
+}
+
+//----------------------------------------------------------------------------
+void Commissions::toSnapshot(QDataStream &aStream) const {
+    aStream << m_IsValid << quint32(m_ProviderCommissions.size());
+
+    for (auto it = m_ProviderCommissions.constBegin(); it != m_ProviderCommissions.constEnd();
+         ++it) {
+        aStream << it.key();
+        write(aStream, it.value());
+    }
+
+    aStream << quint32(m_ProcessingCommissions.size());
+
+    for (auto it = m_ProcessingCommissions.constBegin(); it != m_ProcessingCommissions.constEnd();
+         ++it) {
+        aStream << it.key();
+        write(aStream, it.value());
+    }
+
+    write(aStream, m_DefaultCommissions);
+}
+
+//----------------------------------------------------------------------------
+void Commissions::write(QDataStream &aStream, const Commission &aCommission) {
+    aStream << aCommission.m_Value << aCommission.m_Above << aCommission.m_Below
+            << aCommission.m_MinCharge << aCommission.m_MaxCharge << qint32(aCommission.m_Type)
+            << qint32(aCommission.m_Round) << qint32(aCommission.m_Base);
+}
+
+//----------------------------------------------------------------------------
+void Commissions::write(QDataStream &aStream, const CommissionList &aList) {
+    aStream << quint32(aList.m_Commissions.size());
+
+    foreach (const Commission &commission, aList.m_Commissions) {
+        write(aStream, commission);
+    }
+}
+
+//----------------------------------------------------------------------------
+void Commissions::write(QDataStream &aStream, const CommissionByTimeList &aList) {
+    aStream << aList.m_Begin << aList.m_End;
+    write(aStream, aList.m_Commissions);
+}
+
+//----------------------------------------------------------------------------
+void Commissions::write(QDataStream &aStream, const CommissionByDayList &aList) {
+    aStream << quint32(aList.m_Days.size());
+
+    foreach (Commission::Day day, aList.m_Days) {
+        aStream << qint32(day);
+    }
+
+    aStream << quint32(aList.m_CommissionsByTime.size());
+
+    foreach (const CommissionByTimeList &byTime, aList.m_CommissionsByTime) {
+        write(aStream, byTime);
+    }
+
+    write(aStream, aList.m_Commissions);
+}
+
+//----------------------------------------------------------------------------
+void Commissions::write(QDataStream &aStream, const ProcessingCommission &aCommission) {
+    aStream << qint32(aCommission.m_Type) << aCommission.m_Value << aCommission.m_MinValue;
+}
+
+//----------------------------------------------------------------------------
+void Commissions::write(QDataStream &aStream, const SComplexCommissions &aCommissions) {
+    aStream << quint32(aCommissions.commissionsByDay.size());
+
+    foreach (const CommissionByDayList &byDay, aCommissions.commissionsByDay) {
+        write(aStream, byDay);
+    }
+
+    aStream << quint32(aCommissions.commissionsByTime.size());
+
+    foreach (const CommissionByTimeList &byTime, aCommissions.commissionsByTime) {
+        write(aStream, byTime);
+    }
+
+    write(aStream, aCommissions.commissions);
+    aStream << qint32(aCommissions.vat);
+}
+
+//----------------------------------------------------------------------------
+void Commissions::read(QDataStream &aStream, Commission &aCommission) {
+    qint32 type = 0;
+    qint32 round = 0;
+    qint32 base = 0;
+
+    aStream >> aCommission.m_Value >> aCommission.m_Above >> aCommission.m_Below >>
+        aCommission.m_MinCharge >> aCommission.m_MaxCharge >> type >> round >> base;
+
+    aCommission.m_Type = static_cast<Commission::Type>(type);
+    aCommission.m_Round = static_cast<Commission::RoundType>(round);
+    aCommission.m_Base = static_cast<Commission::Base>(base);
+}
+
+//----------------------------------------------------------------------------
+void Commissions::read(QDataStream &aStream, CommissionList &aList) {
+    quint32 count = 0;
+    aStream >> count;
+
+    for (quint32 i = 0; i < count && aStream.status() == QDataStream::Ok; ++i) {
+        Commission commission;
+        read(aStream, commission);
+        aList.m_Commissions << commission;
+    }
+}
+
+//----------------------------------------------------------------------------
+void Commissions::read(QDataStream &aStream, CommissionByTimeList &aList) {
+    aStream >> aList.m_Begin >> aList.m_End;
+    read(aStream, aList.m_Commissions);
+}
+
+//----------------------------------------------------------------------------
+void Commissions::read(QDataStream &aStream, CommissionByDayList &aList) {
+    quint32 count = 0;
+    aStream >> count;
+
+    for (quint32 i = 0; i < count && aStream.status() == QDataStream::Ok; ++i) {
+        qint32 day = 0;
+        aStream >> day;
+        aList.m_Days.insert(static_cast<Commission::Day>(day));
+    }
+
+    aStream >> count;
+
+    for (quint32 i = 0; i < count && aStream.status() == QDataStream::Ok; ++i) {
+        CommissionByTimeList byTime;
+        read(aStream, byTime);
+        aList.m_CommissionsByTime << byTime;
+    }
+
+    read(aStream, aList.m_Commissions);
+}
+
+//----------------------------------------------------------------------------
+void Commissions::read(QDataStream &aStream, ProcessingCommission &aCommission) {
+    qint32 type = 0;
+
+    aStream >> type >> aCommission.m_Value >> aCommission.m_MinValue;
+    aCommission.m_Type = static_cast<ProcessingCommission::Type>(type);
+}
+
+//----------------------------------------------------------------------------
+void Commissions::read(QDataStream &aStream, SComplexCommissions &aCommissions) {
+    quint32 count = 0;
+    aStream >> count;
+
+    for (quint32 i = 0; i < count && aStream.status() == QDataStream::Ok; ++i) {
+        CommissionByDayList byDay;
+        read(aStream, byDay);
+        aCommissions.commissionsByDay << byDay;
+    }
+
+    aStream >> count;
+
+    for (quint32 i = 0; i < count && aStream.status() == QDataStream::Ok; ++i) {
+        CommissionByTimeList byTime;
+        read(aStream, byTime);
+        aCommissions.commissionsByTime << byTime;
+    }
+
+    qint32 vat = 0;
+
+    read(aStream, aCommissions.commissions);
+    aStream >> vat;
+    aCommissions.vat = vat;
 }
 
 //----------------------------------------------------------------------------
@@ -2,6 +2,7 @@
 
 // Stl
 
+#include <QtCore/QDataStream>
 #include <QtCore/QElapsedTimer>
 #include <QtCore/QFile>
 #include <QtCore/QStack>
@@ -25,7 +26,7 @@ using TPtreeOperators = boost::property_tree::basic_ptree<std::string, std::stri
 //---------------------------------------------------------------------------
 DealerSettings::DealerSettings(TPtree &aProperties)
     : m_Properties(aProperties.get_child(CAdapterNames::DealerAdapter, aProperties)),
-      m_ProvidersLock(QReadWriteLock::Recursive), m_IsValid(false) {}
+      m_ProvidersLock(QReadWriteLock::Recursive), m_FromSnapshot(false), m_IsValid(false) {}
 
 //---------------------------------------------------------------------------
 DealerSettings::~DealerSettings() = default;
@@ -37,7 +38,7 @@ QString DealerSettings::getAdapterName() {
 
 //---------------------------------------------------------------------------
 void DealerSettings::initialize() {
-    bool r1 = loadProviders();
+    bool r1 = m_FromSnapshot ? m_ProviderCatalog->size() > 0 : loadProviders();
     bool r2 = loadCommissions();
     bool r3 = loadPersonalSettings();
 
@@ -52,6 +53,51 @@ void DealerSettings::initialize() {
     m_Properties.clear();
 }
 
+//---------------------------------------------------------------------------
+bool DealerSettings::loadSnapshot(QDataStream &aStream) {
+    auto catalog = ProviderCatalog::load(aStream);
+    Commissions commissions = Commissions::from_Snapshot(aStream);
+
+    if (!catalog || aStream.status() != QDataStream::Ok) {
+        toLog(LogLevel::Error, "Failed to read providers and commissions from snapshot.");
+        return false;
+    }
+
+    {
+        QWriteLocker locker(&m_ProvidersLock);
+
+        m_ProviderCatalog = catalog;
+        m_DisabledProviders.clear();
+    }
+
+    m_Commissions = commissions;
+    m_FromSnapshot = true;
+
+    toLog(LogLevel::Normal,
+          QString("Total providers restored from snapshot: %1.").arg(catalog->size()));
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void DealerSettings::saveSnapshot(QDataStream &aStream) const {
+    QSharedPointer<const ProviderCatalog> catalog;
+
+    {
+        QReadLocker locker(&m_ProvidersLock);
+
+        catalog = m_ProviderCatalog;
+    }
+
+    if (catalog) {
+        catalog->save(aStream);
+    } else {
+        aStream << quint32(0);
+    }
+
+    m_Commissions.toSnapshot(aStream);
+}
+
 //---------------------------------------------------------------------------
 inline QString &encodeLTGT(QString &value) {
     return value.replace("&", "&amp;").replace("<", "&lt;").replace(">", "&gt;");
@@ -63,7 +109,9 @@ inline QString &encodeQUOT(QString &value) {
 }
 
 //---------------------------------------------------------------------------
-bool DealerSettings::loadOperatorsXML(const QString &aFileName) {
+bool DealerSettings::loadOperatorsXML(const QString &aFileName,
+                                      ProviderCatalog::TSources &aSources,
+                                      QSet<qint64> &aLoaded) {
     QFile inputFile(aFileName);
 
     if (!inputFile.open(QIODevice::ReadOnly)) {
@@ -73,8 +121,6 @@ bool DealerSettings::loadOperatorsXML(const QString &aFileName) {
 
     std::string op;
     qint64 opID = 0;
-    QString processing;
-    QSet<qint64> cids;
     double operatorsVersion = 0.;
     QStack<QString> tags;
 
@@ -97,8 +143,6 @@ bool DealerSettings::loadOperatorsXML(const QString &aFileName) {
                      QString::number(operatorsVersion, 'f').toStdString() + "\"";
 
                 opID = 0;
-                processing.clear();
-                cids.clear();
             } else {
                 op += "<" + tags.top().toLatin1();
             }
@@ -118,13 +162,6 @@ bool DealerSettings::loadOperatorsXML(const QString &aFileName) {
                     operatorsVersion = attrs.value("version", "0").toDouble();
                 } else if (isOP) {
                     opID = attrs.value("id").toLongLong();
-
-                    if (operatorsVersion < 2.0) {
-                        cids << attrs.value("cid").toLongLong();
-                    }
-                } else if (tags.top() == "processor") {
-                    // Процессинг вида тип_процессинга#имя является алиасом для стандартных типов
-                    processing = attrs.value("type").split("#").takeFirst();
                 }
 
                 foreach (auto name, attrs.keys()) {
@@ -142,20 +179,6 @@ bool DealerSettings::loadOperatorsXML(const QString &aFileName) {
             if (!xmlReader.isWhitespace()) {
                 QString text = xmlReader.text().toString();
                 op += encodeLTGT(text).toUtf8();
-
-                if (operatorsVersion >= 2.0) {
-                    if (tags.size() > 2 && tags.at(tags.size() - 2) == "operator") {
-                        if (tags.top() == "cid") {
-                            cids << xmlReader.text().toString().toLongLong();
-                        }
-                    }
-                }
-
-                if (tags.top() == "tt_list") {
-                    foreach (auto cid, xmlReader.text().toString().split(",")) {
-                        cids << cid.trimmed().toLongLong();
-                    }
-                }
             }
 
             break;
@@ -168,22 +191,14 @@ bool DealerSettings::loadOperatorsXML(const QString &aFileName) {
             if (key == "operator") {
                 op += "</operator>";
 
-                if (m_ProviderRawBuffer.contains(opID)) {
-                    // qDebug() << "Skip existing operator " << opID;
-                } else {
-                    m_ProviderRawBuffer[opID].swap(op);
-                    foreach (qint64 cid, cids) {
-                        m_ProviderGateways.insert(cid, opID);
-                    }
-                    // operatorsProcessing[opID].swap(processing);
-                    // operatorsHash[opID].swap(QString::fromLatin1(CCryptographicHash::hash(op,
-                    // CCryptographicHash::Sha256).toHex()));
-                    m_ProvidersProcessingIndex.insert(processing, opID);
+                // Действует первое описание оператора, шлюзы и процессинг индексирует каталог.
+                if (!aLoaded.contains(opID)) {
+                    aLoaded.insert(opID);
+                    aSources.append({opID, std::string()});
+                    aSources.last().buffer.swap(op);
                 }
 
-                cids.clear();
                 op.reserve(4096);
-                processing.clear();
                 opID = 0;
             } else {
                 op += "</" + key.toStdString() + ">";
@@ -223,6 +238,9 @@ bool DealerSettings::loadProviders() {
     QElapsedTimer elapsed;
     elapsed.start();
 
+    ProviderCatalog::TSources sources;
+    QSet<qint64> loaded;
+
     const auto &providersTree = m_Properties.get_child("", emptyTree);
     BOOST_FOREACH (const TPtree::value_type &operators, providersTree) {
         if (operators.first != "operators") {
@@ -233,15 +251,32 @@ bool DealerSettings::loadProviders() {
 
         toLog(LogLevel::Normal, QString("Loading %1.").arg(operatorsPath));
 
-        loadOperatorsXML(operatorsPath);
+        loadOperatorsXML(operatorsPath, sources, loaded);
+    }
+
+    qint64 readTime = elapsed.elapsed();
+
+    // Все описания разбираются сразу и параллельно: обращения к операторам не ждут разбора.
+    auto catalog = ProviderCatalog::compile(
+        sources, [this](const std::string &aBuffer, SProvider &aProvider) -> bool {
+            return loadProvidersFrom_Buffer(aBuffer, aProvider);
+        });
+
+    {
+        QWriteLocker locker(&m_ProvidersLock);
+
+        m_ProviderCatalog = catalog;
+        m_DisabledProviders.clear();
     }
 
     toLog(LogLevel::Normal,
-          QString("Total providers loaded: %1, elapsed %2 ms.")
-              .arg(m_ProviderRawBuffer.size())
-              .arg(elapsed.elapsed()));
+          QString("Total providers loaded: %1, skipped: %2, elapsed %3 ms (read %4 ms).")
+              .arg(catalog->size())
+              .arg(sources.size() - catalog->size())
+              .arg(elapsed.elapsed())
+              .arg(readTime));
 
-    return !m_ProviderRawBuffer.isEmpty();
+    return catalog->size() > 0;
 }
 
 //---------------------------------------------------------------------------
@@ -271,7 +306,8 @@ void loadProviderEnumItems(SProviderField::TEnum_Items &aItemList, const TPtreeO
 }
 
 //---------------------------------------------------------------------------
-bool DealerSettings::loadProvidersFrom_Buffer(const std::string &aBuffer, SProvider &aProvider) {
+bool DealerSettings::loadProvidersFrom_Buffer(const std::string &aBuffer,
+                                              SProvider &aProvider) const {
     TPtreeOperators operators;
     const TPtreeOperators emptyTree;
 
@@ -524,37 +560,36 @@ bool DealerSettings::loadProvidersFrom_Buffer(const std::string &aBuffer, SProvi
 void DealerSettings::disableProvider(qint64 aId) {
     QWriteLocker locker(&m_ProvidersLock);
 
-    m_Providers.remove(aId);
-    m_ProviderRawBuffer.remove(aId);
-    m_ProvidersProcessingIndex.remove(m_ProvidersProcessingIndex.key(aId), aId);
-
-    foreach (auto cid, m_ProviderGateways.keys()) {
-        m_ProviderGateways.remove(cid, aId);
-    }
+    // Каталог неизменяем, отключённые операторы отсекаются при чтении.
+    m_DisabledProviders.insert(aId);
 }
 
 //----------------------------------------------------------------------------
 bool DealerSettings::loadCommissions() {
-    try {
-        const TPtree emptyTree;
+    // Комиссии из снимка уже восстановлены, из XML читаются только клиенты.
+    if (!m_FromSnapshot) {
+        try {
+            const TPtree emptyTree;
 
-        toLog(LogLevel::Normal, "Loading commissions.");
+            toLog(LogLevel::Normal, "Loading commissions.");
 
-        BOOST_FOREACH (const TPtree::value_type &commissions,
-                       m_Properties.get_child("", emptyTree)) {
-            if (commissions.first != "commissions") {
-                continue;
-            }
+            BOOST_FOREACH (const TPtree::value_type &commissions,
+                           m_Properties.get_child("", emptyTree)) {
+                if (commissions.first != "commissions") {
+                    continue;
+                }
 
-            if (!m_Commissions.isValid()) {
-                m_Commissions = Commissions::from_Settings(commissions.second);
-            } else {
-                m_Commissions.appendFrom_Settings(commissions.second);
+                if (!m_Commissions.isValid()) {
+                    m_Commissions = Commissions::from_Settings(commissions.second);
+                } else {
+                    m_Commissions.appendFrom_Settings(commissions.second);
+                }
             }
+        } catch (std::runtime_error &error) {
+            toLog(LogLevel::Error,
+                  QString("Failed to load commissions. Error: %1.").arg(error.what()));
+            return false;
         }
-    } catch (std::runtime_error &error) {
-        toLog(LogLevel::Error, QString("Failed to load commissions. Error: %1.").arg(error.what()));
-        return false;
     }
 
     try {
@@ -645,35 +680,53 @@ bool DealerSettings::loadPersonalSettings() {
 
 //----------------------------------------------------------------------------
 SProvider DealerSettings::getProvider(qint64 aId) {
-    if (m_ProviderRawBuffer.contains(aId)) {
-        QWriteLocker locker(&m_ProvidersLock);
+    QReadLocker locker(&m_ProvidersLock);
 
-        SProvider provider;
-        if (loadProvidersFrom_Buffer(m_ProviderRawBuffer[aId], provider)) {
-            m_Providers.insert(aId, provider);
-            m_ProviderRawBuffer.remove(aId);
-        } else {
-            toLog(LogLevel::Error, QString("Error parse provider %1 from buffer.").arg(aId));
-        }
+    return findProvider(aId);
+}
+
+//----------------------------------------------------------------------------
+SProvider DealerSettings::findProvider(qint64 aId) const {
+    const SProvider *compiled = m_ProviderCatalog ? m_ProviderCatalog->find(aId) : nullptr;
+
+    if (!compiled || m_DisabledProviders.contains(aId)) {
+        return {};
     }
 
-    QReadLocker locker(&m_ProvidersLock);
+    SProvider provider = *compiled;
 
-    if (m_Providers.contains(aId)) {
-        SProvider provider = m_Providers.value(aId);
+    auto external = m_ExternalLimits.constFind(aId);
+    if (external != m_ExternalLimits.constEnd()) {
+        provider.limits.externalMin = external->externalMin;
+        provider.limits.externalMax = external->externalMax;
+    }
 
-        // Лимиты из описания оператора могут быть переопределены снаружи
-        provider.limits.min = !qFuzzyIsNull(provider.limits.externalMin.toDouble())
-                                  ? provider.limits.externalMin
-                                  : provider.limits.min;
-        provider.limits.max = !qFuzzyIsNull(provider.limits.externalMax.toDouble())
-                                  ? provider.limits.externalMax
-                                  : provider.limits.max;
+    // Лимиты из описания оператора могут быть переопределены снаружи
+    provider.limits.min = !qFuzzyIsNull(provider.limits.externalMin.toDouble())
+                              ? provider.limits.externalMin
+                              : provider.limits.min;
+    provider.limits.max = !qFuzzyIsNull(provider.limits.externalMax.toDouble())
+                              ? provider.limits.externalMax
+                              : provider.limits.max;
 
-        return provider;
+    return provider;
+}
+
+//----------------------------------------------------------------------------
+QList<qint64> DealerSettings::getEnabledIDs(const QList<qint64> &aIds) const {
+    if (m_DisabledProviders.isEmpty()) {
+        return aIds;
     }
 
-    return {};
+    QList<qint64> result;
+
+    foreach (qint64 id, aIds) {
+        if (!m_DisabledProviders.contains(id)) {
+            result << id;
+        }
+    }
+
+    return result;
 }
 
 //----------------------------------------------------------------------------
@@ -701,8 +754,12 @@ SProvider DealerSettings::getMNPProvider(qint64 aId, qint64 aCidIn, qint64 aCidO
 QList<SProvider> DealerSettings::getProvidersByCID(qint64 aCid) {
     QList<SProvider> providers;
 
-    foreach (auto id, m_ProviderGateways.values(aCid)) {
-        providers << getProvider(id);
+    QReadLocker locker(&m_ProvidersLock);
+
+    if (m_ProviderCatalog) {
+        foreach (auto id, getEnabledIDs(m_ProviderCatalog->getIDsByCID(aCid))) {
+            providers << findProvider(id);
+        }
     }
 
     return providers;
@@ -710,24 +767,41 @@ QList<SProvider> DealerSettings::getProvidersByCID(qint64 aCid) {
 
 //---------------------------------------------------------------------------
 QList<qint64> DealerSettings::getProviders(const QString &aProcessingType) {
-    return m_ProvidersProcessingIndex.values(aProcessingType);
+    QReadLocker locker(&m_ProvidersLock);
+
+    return m_ProviderCatalog
+               ? getEnabledIDs(m_ProviderCatalog->getIDsByProcessing(aProcessingType))
+               : QList<qint64>();
 }
 
 //---------------------------------------------------------------------------
 QStringList DealerSettings::getProviderProcessingTypes() {
-    const auto keys = m_ProvidersProcessingIndex.keys();
-    return {keys.cbegin(), keys.cend()};
+    QReadLocker locker(&m_ProvidersLock);
+
+    QStringList result;
+
+    if (m_ProviderCatalog) {
+        foreach (const QString &type, m_ProviderCatalog->getProcessingTypes()) {
+            if (!getEnabledIDs(m_ProviderCatalog->getIDsByProcessing(type)).isEmpty()) {
+                result << type;
+            }
+        }
+    }
+
+    return result;
 }
 
 //---------------------------------------------------------------------------
 void DealerSettings::setExternalLimits(qint64 aProviderId,
                                        double aMinExternalLimit,
                                        double aMaxExternalLimit) {
-    SProvider provider = getProvider(aProviderId);
+    QWriteLocker locker(&m_ProvidersLock);
+
+    if (!findProvider(aProviderId).isNull()) {
+        SProvider::SLimits &limits = m_ExternalLimits[aProviderId];
 
-    if (!provider.isNull()) {
-        m_Providers[aProviderId].limits.externalMin = QString::number(aMinExternalLimit);
-        m_Providers[aProviderId].limits.externalMax = QString::number(aMaxExternalLimit);
+        limits.externalMin = QString::number(aMinExternalLimit);
+        limits.externalMax = QString::number(aMaxExternalLimit);
     }
 }
 
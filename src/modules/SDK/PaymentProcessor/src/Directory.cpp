@@ -1,5 +1,7 @@
 /* @file Справочники. */
 
+#include <QtCore/QDataStream>
+
 #include <SDK/PaymentProcessor/Settings/Directory.h>
 #include <SDK/PaymentProcessor/Settings/Provider.h>
 
@@ -23,8 +25,8 @@ QString Directory::getAdapterName() {
 }
 
 //---------------------------------------------------------------------------
-Directory::Directory(TPtree &aProperties)
-    : m_Properties(aProperties.get_child(CAdapterNames::Directory, aProperties)) {
+Directory::Directory(TPtree &aProperties, ILog *aLog)
+    : ILogable(aLog), m_Properties(aProperties.get_child(CAdapterNames::Directory, aProperties)) {
     m_Ranges.reserve(20000);
     SRange range;
 
@@ -75,6 +77,8 @@ Directory::Directory(TPtree &aProperties)
     m_OverlappedRanges.squeeze();
     std::sort(m_Ranges.begin(), m_Ranges.end());
     std::sort(m_OverlappedRanges.begin(), m_OverlappedRanges.end());
+
+    buildRangeIndex();
 }
 
 //---------------------------------------------------------------------------
@@ -115,29 +119,54 @@ QList<SConnectionTemplate> Directory::getConnectionTemplates() const {
 
 //---------------------------------------------------------------------------
 QList<SRange> Directory::getRangesForNumber(qint64 aNumber) const {
-    QList<SRange> ranges;
-    ranges.reserve(5);
-
-    // Сначала ищем в виртуальных диапазонах
-    QVector<SRange>::const_iterator begin =
-        std::lower_bound(m_OverlappedRanges.begin(), m_OverlappedRanges.end(), aNumber);
-    QVector<SRange>::const_iterator end =
-        std::upper_bound(m_OverlappedRanges.begin(), m_OverlappedRanges.end(), aNumber);
-
-    // Если нет в виртуальных, то ищем в обычных
-    if (begin == end) {
-        begin = std::lower_bound(m_Ranges.begin(), m_Ranges.end(), aNumber);
-        end = std::upper_bound(m_Ranges.begin(), m_Ranges.end(), aNumber);
+    // Виртуальные диапазоны имеют приоритет над обычными, это учтено при построении индекса.
+    return m_RangeIndex.find(aNumber);
+}
+
+//---------------------------------------------------------------------------
+QSet<qint64> Directory::getOverlappedIDs() const {
+    return m_OverlappedIDs;
+}
+
+//---------------------------------------------------------------------------
+bool Directory::loadSnapshot(QDataStream &aStream) {
+    QDateTime timestamp;
+    QVector<SRange> ranges;
+    QVector<SRange> overlappedRanges;
+    QSet<qint64> overlappedIDs;
+
+    aStream >> timestamp >> ranges >> overlappedRanges >> overlappedIDs;
+
+    if (aStream.status() != QDataStream::Ok) {
+        toLog(LogLevel::Error, "Failed to read number capacity from snapshot.");
+        return false;
     }
 
-    std::copy(begin, end, std::back_inserter(ranges));
+    // Диапазоны записаны уже отсортированными.
+    m_RangesTimestamp = timestamp;
+    m_Ranges.swap(ranges);
+    m_OverlappedRanges.swap(overlappedRanges);
+    m_OverlappedIDs.swap(overlappedIDs);
+
+    buildRangeIndex();
 
-    return ranges;
+    return true;
 }
 
 //---------------------------------------------------------------------------
-QSet<qint64> Directory::getOverlappedIDs() const {
-    return m_OverlappedIDs;
+void Directory::saveSnapshot(QDataStream &aStream) const {
+    aStream << m_RangesTimestamp << m_Ranges << m_OverlappedRanges << m_OverlappedIDs;
+}
+
+//---------------------------------------------------------------------------
+void Directory::buildRangeIndex() {
+    m_RangeIndex = RangeIndex(m_Ranges, m_OverlappedRanges);
+
+    toLog(LogLevel::Debug,
+          QString("Number capacity index: %1 ranges, %2 virtual, %3 segments.")
+              .arg(m_Ranges.size())
+              .arg(m_OverlappedRanges.size())
+              .arg(m_RangeIndex.segmentCount()));
 }
 
 //---------------------------------------------------------------------------
@@ -10,7 +10,11 @@
 #include <QtCore/QTextCodec>
 #endif
 
-#include <Common/ScopedPointerLaterDeleter.h>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtCore/QDeadlineTimer>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
 
 #include <SDK/PaymentProcessor/Humo/Request.h>
 #include <SDK/PaymentProcessor/Humo/RequestSender.h>
@@ -32,10 +36,23 @@ namespace CRequestSender {
 const int DefaultKeyPair = 0;
 } // namespace CRequestSender
 
+namespace {
+/// Рабочие потоки всех отправителей: подпись не должна занимать больше MaxWorkers ядер.
+class WorkerPool : public QThreadPool {
+public:
+    WorkerPool() {
+        setMaxThreadCount(qMin(QThread::idealThreadCount(), CRequestSender::MaxWorkers));
+    }
+};
+} // namespace
+
 //---------------------------------------------------------------------------
 RequestSender::RequestSender(NetworkTaskManager *aNetwork, ICryptEngine *aCryptEngine)
     : m_Network(aNetwork), m_CryptEngine(aCryptEngine), m_KeyPair(CRequestSender::DefaultKeyPair),
-      m_OnlySecureConnection(true) {
+      m_OnlySecureConnection(true), m_MaxInFlight(CRequestSender::MaxInFlight), m_Pending(0),
+      m_Closing(false), m_Jobs(new SJobs()), m_Life(new SLife()) {
+    m_Life->sender = this;
+
 #if defined(_DEBUG) || defined(DEBUG_INFO)
     m_OnlySecureConnection = false;
 #endif // _DEBUG || DEBUG_INFO
@@ -72,7 +89,117 @@ RequestSender::RequestSender(NetworkTaskManager *aNetwork, ICryptEngine *aCryptE
 }
 
 //---------------------------------------------------------------------------
-RequestSender::~RequestSender() = default;
+RequestSender::~RequestSender() {
+    QList<TContext> queued;
+    QList<QPointer<NetworkTask>> tasks;
+
+    {
+        QMutexLocker lock(&m_Mutex);
+
+        m_Closing = true;
+
+        for (auto it = m_Gateways.begin(); it != m_Gateways.end(); ++it) {
+            queued << it->queue;
+            it->queue.clear();
+        }
+
+        for (auto it = m_InFlight.begin(); it != m_InFlight.end(); ++it) {
+            it->context->canceled = true;
+            tasks << it->task;
+        }
+    }
+
+    foreach (const TContext &context, queued) {
+        finish(context, QString(), NetworkError);
+    }
+
+    // Запросы в сети прерываются, их обработчики получают сетевую ошибку. Задачи живут в потоке
+    // менеджера, там и проверяется, не удалена ли уже задача.
+    NetworkTaskManager *network = m_Network.data();
+
+    if (network) {
+        auto abort = [network, tasks]() {
+            foreach (const QPointer<NetworkTask> &task, tasks) {
+                if (!task.isNull()) {
+                    network->removeTask(task.data());
+                }
+            }
+        };
+
+        QMetaObject::invokeMethod(network, abort, Qt::AutoConnection);
+    }
+
+    {
+        QMutexLocker lock(&m_Mutex);
+
+        QDeadlineTimer deadline(network ? CRequestSender::CloseTimeout : 0);
+
+        while (m_Pending > 0) {
+            if (!m_IdleCondition.wait(&m_Mutex, deadline)) {
+                break;
+            }
+        }
+    }
+
+    // Менеджер сети не ответил (удалён или его поток остановлен): обработчики в его очереди
+    // больше не сработают, запросы завершаются здесь.
+    {
+        QMutexLocker lock(&m_Life->mutex);
+
+        m_Life->sender = nullptr;
+    }
+
+    QList<TContext> lost;
+
+    {
+        QMutexLocker lock(&m_Mutex);
+
+        for (auto it = m_InFlight.begin(); it != m_InFlight.end(); ++it) {
+            lost << it->context;
+        }
+
+        m_InFlight.clear();
+    }
+
+    foreach (const TContext &context, lost) {
+        finish(context, QString(), NetworkError);
+    }
+
+    // Рабочие потоки общие, поэтому ждём только свои задачи.
+    QMutexLocker lock(&m_Jobs->mutex);
+
+    while (m_Jobs->count > 0) {
+        m_Jobs->idle.wait(&m_Jobs->mutex);
+    }
+}
+
+//---------------------------------------------------------------------------
+QThreadPool *RequestSender::workers() {
+    static WorkerPool pool;
+
+    return &pool;
+}
+
+//---------------------------------------------------------------------------
+void RequestSender::runInWorker(const std::function<void()> &aJob) {
+    QSharedPointer<SJobs> jobs = m_Jobs;
+
+    {
+        QMutexLocker lock(&jobs->mutex);
+
+        ++jobs->count;
+    }
+
+    QtConcurrent::run(workers(), [jobs, aJob]() {
+        aJob();
+
+        QMutexLocker lock(&jobs->mutex);
+
+        if (--jobs->count == 0) {
+            jobs->idle.wakeAll();
+        }
+    });
+}
 
 //---------------------------------------------------------------------------
 void RequestSender::setNetworkTaskManager(NetworkTaskManager *aNetwork) {
@@ -119,6 +246,20 @@ void RequestSender::setOnlySecureConnectionEnabled(bool aOnlySecure) {
     m_OnlySecureConnection = aOnlySecure;
 }
 
+//---------------------------------------------------------------------------
+void RequestSender::setMaxInFlight(int aCount) {
+    QMutexLocker lock(&m_Mutex);
+
+    m_MaxInFlight = qMax(1, aCount);
+}
+
+//---------------------------------------------------------------------------
+int RequestSender::getPendingCount() const {
+    QMutexLocker lock(&m_Mutex);
+
+    return m_Pending;
+}
+
 //---------------------------------------------------------------------------
 Response *RequestSender::request(NetworkTask::Type aType,
                                  const QUrl &aUrl,
@@ -126,96 +267,303 @@ Response *RequestSender::request(NetworkTask::Type aType,
                                  ESignatureType aSignatureType,
                                  ESendError &aError,
                                  int aTimeout) {
-    if (aUrl.scheme().toLower() == "http" && m_OnlySecureConnection) {
-        aError = HttpIsNotSupported;
+    // Результат приходит из рабочего потока, цикл событий вызывающего потока не нужен.
+    // Семафор живёт вместе с обработчиком: release может завершаться уже после acquire.
+    QSharedPointer<QSemaphore> done(new QSemaphore());
+    QString data;
+
+    enqueue(
+        aType,
+        aUrl,
+        aRequest,
+        aSignatureType,
+        [&data, &aError, done](const QString &aData, ESendError aSendError) {
+            data = aData;
+            aError = aSendError;
+            done->release();
+        },
+        aTimeout);
+
+    done->acquire();
+
+    // Ответ создаётся в вызывающем потоке: конструкторы ответов владельцев обращаются к их
+    // данным без блокировок.
+    return aError == Ok ? m_ResponseCreator(aRequest, data) : nullptr;
+}
+
+//---------------------------------------------------------------------------
+void RequestSender::send(NetworkTask::Type aType,
+                         const QUrl &aUrl,
+                         Request &aRequest,
+                         ESignatureType aSignatureType,
+                         const TResponseHandler &aHandler,
+                         int aTimeout) {
+    Request *request = &aRequest;
+
+    enqueue(
+        aType,
+        aUrl,
+        aRequest,
+        aSignatureType,
+        [this, request, aHandler](const QString &aData, ESendError aError) {
+            aHandler(aError == Ok ? m_ResponseCreator(*request, aData) : nullptr, aError);
+        },
+        aTimeout);
+}
 
-        return nullptr;
+//---------------------------------------------------------------------------
+void RequestSender::enqueue(NetworkTask::Type aType,
+                            const QUrl &aUrl,
+                            Request &aRequest,
+                            ESignatureType aSignatureType,
+                            const TDataHandler &aHandler,
+                            int aTimeout) {
+    TContext context(new SContext());
+
+    context->type = aType;
+    context->url = aUrl;
+    context->request = &aRequest;
+    context->signatureType = aSignatureType;
+    context->timeout = aTimeout;
+    context->handler = aHandler;
+    context->gateway = aUrl.scheme() + "://" + aUrl.authority();
+    context->networkError = NetworkTask::NoError;
+    context->canceled = false;
+
+    {
+        QMutexLocker lock(&m_Mutex);
+
+        ++m_Pending;
+
+        if (m_Closing) {
+            lock.unlock();
+            finish(context, QString(), NetworkError);
+
+            return;
+        }
     }
 
-    aError = Ok;
+    if (aUrl.scheme().toLower() == "http" && m_OnlySecureConnection) {
+        finish(context, QString(), HttpIsNotSupported);
+
+        return;
+    }
 
     if (m_Network.isNull()) {
-        aError = NoNetworkInterfaceSpecified;
+        finish(context, QString(), NoNetworkInterfaceSpecified);
 
-        return nullptr;
+        return;
     }
 
     // Подставляем серийный номер пары ключа в каждый запрос.
     QString keyPairSerial = m_CryptEngine->getKeyPairSerialNumber(m_KeyPair);
 
     if (keyPairSerial.isEmpty()) {
-        aError = ClientCryptError;
+        finish(context, QString(), ClientCryptError);
 
-        return nullptr;
+        return;
     }
 
     if (aSignatureType == Solid) {
         aRequest.addParameter("ACCEPT_KEYS", keyPairSerial);
+    } else if (aSignatureType == Detached) {
+        context->headers.insert("X-humo-accepted-keys", keyPairSerial.toLatin1());
     }
 
-    QScopedPointer<NetworkTask, ScopedPointerLaterDeleter<NetworkTask>> task(new NetworkTask());
+    runInWorker([this, context]() { prepare(context); });
+}
 
-    task->setUrl(aUrl);
-    task->setType(aType);
-    task->setTimeout(aTimeout);
-    task->setDataStream(new MemoryDataStream());
-    task->getRequestHeader().insert("Content-Type", "application/x-www-form-urlencoded");
+//---------------------------------------------------------------------------
+void RequestSender::prepare(const TContext &aContext) {
+    aContext->headers.insert("Content-Type", "application/x-www-form-urlencoded");
 
     QByteArray encodedRequest;
     QByteArray signedRequest;
     QByteArray detachedSignature;
 
-    if (!m_RequestEncoder(aRequest.toString(), std::ref(encodedRequest))) {
-        aError = EncodeError;
+    if (!m_RequestEncoder(aContext->request->toString(), std::ref(encodedRequest))) {
+        finish(aContext, QString(), EncodeError);
 
-        return nullptr;
+        return;
     }
 
-    if (!m_RequestSigner(
-            encodedRequest, std::ref(signedRequest), aSignatureType, std::ref(detachedSignature))) {
-        aError = ClientCryptError;
+    if (!m_RequestSigner(encodedRequest,
+                         std::ref(signedRequest),
+                         aContext->signatureType,
+                         std::ref(detachedSignature))) {
+        finish(aContext, QString(), ClientCryptError);
 
-        return nullptr;
+        return;
     }
 
-    if (aSignatureType == Solid) {
+    if (aContext->signatureType == Solid) {
         signedRequest = "inputmessage=" + signedRequest;
 
-        const auto &rawParameters = aRequest.getParameters(true);
+        const auto &rawParameters = aContext->request->getParameters(true);
         foreach (auto name, rawParameters.keys()) {
             signedRequest += ("\n" + name + "=" + rawParameters.value(name).toString()).toUtf8();
         }
-    } else if (aSignatureType == Detached) {
-        task->getRequestHeader().insert("X-signature", detachedSignature);
-        task->getRequestHeader().insert("X-humo-accepted-keys", keyPairSerial.toLatin1());
+    } else if (aContext->signatureType == Detached) {
+        aContext->headers.insert("X-signature", detachedSignature);
     } else {
-        aError = UnknownSignatureType;
+        finish(aContext, QString(), UnknownSignatureType);
+
+        return;
+    }
+
+    if (!m_RequestModifier(
+            *aContext->request, std::ref(aContext->headers), std::ref(signedRequest))) {
+        finish(aContext, QString(), RequestModifyError);
+
+        return;
+    }
+
+    aContext->body = signedRequest;
+
+    {
+        QMutexLocker lock(&m_Mutex);
+
+        if (m_Closing) {
+            lock.unlock();
+            finish(aContext, QString(), NetworkError);
+
+            return;
+        }
+
+        m_Gateways[aContext->gateway].queue.enqueue(aContext);
+    }
+
+    dispatch(aContext->gateway);
+}
+
+//---------------------------------------------------------------------------
+void RequestSender::dispatch(const QString &aGateway) {
+    QList<TContext> ready;
+
+    {
+        QMutexLocker lock(&m_Mutex);
+
+        SGateway &gateway = m_Gateways[aGateway];
+
+        while (!m_Closing && gateway.inFlight < m_MaxInFlight && !gateway.queue.isEmpty()) {
+            ++gateway.inFlight;
+            ready << gateway.queue.dequeue();
+
+            SFlight flight = {ready.last(), QPointer<NetworkTask>()};
+            m_InFlight.insert(ready.last().data(), flight);
+        }
+    }
+
+    NetworkTaskManager *network = m_Network.data();
+    QSharedPointer<SLife> life = m_Life;
+
+    foreach (const TContext &context, ready) {
+        // Задача создаётся в потоке менеджера: там же она завершается и удаляется.
+        auto start = [life, context]() {
+            QMutexLocker lock(&life->mutex);
+
+            if (life->sender) {
+                life->sender->startTask(context);
+            }
+        };
+
+        if (!network || !QMetaObject::invokeMethod(network, start, Qt::QueuedConnection)) {
+            {
+                QMutexLocker lock(&m_Mutex);
+
+                --m_Gateways[aGateway].inFlight;
+                m_InFlight.remove(context.data());
+            }
+
+            finish(context, QString(), NoNetworkInterfaceSpecified);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+void RequestSender::startTask(const TContext &aContext) {
+    {
+        QMutexLocker lock(&m_Mutex);
 
-        return nullptr;
+        if (m_Closing || m_Network.isNull()) {
+            --m_Gateways[aContext->gateway].inFlight;
+            m_InFlight.remove(aContext.data());
+            lock.unlock();
+
+            finish(aContext, QString(), NetworkError);
+
+            return;
+        }
     }
 
-    if (!m_RequestModifier(aRequest, std::ref(task->getRequestHeader()), std::ref(signedRequest))) {
-        aError = RequestModifyError;
+    auto *task = new NetworkTask();
+
+    task->setUrl(aContext->url);
+    task->setType(aContext->type);
+    task->setTimeout(aContext->timeout);
+    task->setDataStream(new MemoryDataStream());
+    task->getRequestHeader() = aContext->headers;
+    task->getDataStream()->write(aContext->body);
+
+    QSharedPointer<SLife> life = m_Life;
+
+    connect(
+        task,
+        &NetworkTask::onComplete,
+        task,
+        [life, aContext, task]() {
+            // Задача поставлена в этом же потоке, ожидание лишь освобождает её мьютекс.
+            task->waitForFinished();
+            task->deleteLater();
+
+            QMutexLocker lock(&life->mutex);
+
+            if (life->sender) {
+                life->sender->completeTask(aContext, task);
+            }
+        },
+        Qt::DirectConnection);
 
-        return nullptr;
+    {
+        QMutexLocker lock(&m_Mutex);
+
+        m_InFlight[aContext.data()].task = task;
     }
 
-    task->getDataStream()->write(signedRequest);
+    m_Network->addTask(task);
+}
 
-    m_Network->addTask(task.data());
+//---------------------------------------------------------------------------
+void RequestSender::completeTask(const TContext &aContext, NetworkTask *aTask) {
+    aContext->networkError = aTask->getError();
+    aContext->responseData = aTask->getDataStream()->takeAll();
+    aContext->responseHeaders = aTask->getResponseHeader();
 
-    task->waitForFinished();
+    {
+        QMutexLocker lock(&m_Mutex);
+
+        m_InFlight.remove(aContext.data());
+        --m_Gateways[aContext->gateway].inFlight;
+    }
 
-    if (task->getError() != NetworkTask::NoError) {
-        aError = NetworkError;
+    dispatch(aContext->gateway);
+
+    runInWorker([this, aContext]() { process(aContext); });
+}
+
+//---------------------------------------------------------------------------
+void RequestSender::process(const TContext &aContext) {
+    // Прерванная задача завершается без сетевой ошибки, но и без ответа.
+    if (aContext->canceled || aContext->networkError != NetworkTask::NoError) {
+        finish(aContext, QString(), NetworkError);
 
-        return nullptr;
+        return;
     }
 
-    QByteArray signedResponseData = task->getDataStream()->takeAll();
+    QByteArray signedResponseData = aContext->responseData;
 
     // Проверим на запакованные данные
-    if (task->getResponseHeader()["Content-Type"] == "application/x-gzip") {
+    if (aContext->responseHeaders["Content-Type"] == "application/x-gzip") {
         signedResponseData =
             qUncompress(reinterpret_cast<const uchar *>(signedResponseData.constData()),
                         signedResponseData.size());
@@ -225,25 +573,38 @@ Response *RequestSender::request(NetworkTask::Type aType,
     QByteArray responseSignature;
     QString responseData;
 
-    if (aSignatureType == Detached) {
+    if (aContext->signatureType == Detached) {
         responseSignature =
-            QByteArray::fromPercentEncoding(task->getResponseHeader()["X-signature"]);
+            QByteArray::fromPercentEncoding(aContext->responseHeaders["X-signature"]);
     }
 
-    if (!m_ResponseVerifier(
-            signedResponseData, std::ref(encodedResponseData), aSignatureType, responseSignature)) {
-        aError = ServerCryptError;
+    if (!m_ResponseVerifier(signedResponseData,
+                            std::ref(encodedResponseData),
+                            aContext->signatureType,
+                            responseSignature)) {
+        finish(aContext, QString(), ServerCryptError);
 
-        return nullptr;
+        return;
     }
 
     if (!m_ResponseDecoder(encodedResponseData, std::ref(responseData))) {
-        aError = DecodeError;
+        finish(aContext, QString(), DecodeError);
 
-        return nullptr;
+        return;
     }
 
-    return m_ResponseCreator(aRequest, responseData);
+    finish(aContext, responseData, Ok);
+}
+
+//---------------------------------------------------------------------------
+void RequestSender::finish(const TContext &aContext, const QString &aData, ESendError aError) {
+    aContext->handler(aData, aError);
+
+    QMutexLocker lock(&m_Mutex);
+
+    if (--m_Pending == 0) {
+        m_IdleCondition.wakeAll();
+    }
 }
 
 //---------------------------------------------------------------------------
@@ -264,6 +625,24 @@ Response *RequestSender::post(const QUrl &aUrl,
     return request(NetworkTask::Post, aUrl, aRequest, aSignatureType, aError, aTimeout);
 }
 
+//---------------------------------------------------------------------------
+void RequestSender::getAsync(const QUrl &aUrl,
+                             Request &aRequest,
+                             ESignatureType aSignatureType,
+                             const TResponseHandler &aHandler,
+                             int aTimeout) {
+    send(NetworkTask::Get, aUrl, aRequest, aSignatureType, aHandler, aTimeout);
+}
+
+//---------------------------------------------------------------------------
+void RequestSender::postAsync(const QUrl &aUrl,
+                              Request &aRequest,
+                              ESignatureType aSignatureType,
+                              const TResponseHandler &aHandler,
+                              int aTimeout) {
+    send(NetworkTask::Post, aUrl, aRequest, aSignatureType, aHandler, aTimeout);
+}
+
 //---------------------------------------------------------------------------
 Response *RequestSender::defaultResponseCreator(const Request &aRequest, const QString &aData) {
     return new Response(aRequest, aData);
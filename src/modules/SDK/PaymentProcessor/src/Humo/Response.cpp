@@ -1,6 +1,5 @@
 /* @file Базовый ответ сервера. */
 
-#include <QtCore/QRegularExpression>
 #include <QtCore/QStringList>
 
 #include <SDK/PaymentProcessor/Humo/Response.h>
@@ -13,17 +12,12 @@ namespace Humo {
 
 //---------------------------------------------------------------------------
 Response::Response(const Request &aRequest, QString aResponseString)
-    : m_ResponseString(std::move(aResponseString)), m_Error(ELocalError::NetworkError),
-      m_Result(EServerResult::Empty), m_Request(aRequest) {
-    QRegularExpression regexp("^(\\w+)=(.*)$");
-
-    foreach (auto line, m_ResponseString.split("\r\n")) {
-        QRegularExpressionMatch match = regexp.match(line);
-        if (match.hasMatch()) {
-            if (match.capturedLength() > 1) {
-                addParameter(match.captured(1), match.captured(2));
-            }
-        }
+    : m_ResponseString(std::move(aResponseString)), m_ParametersReady(false),
+      m_Error(ELocalError::NetworkError), m_Result(EServerResult::Empty), m_Request(aRequest) {
+    m_Fields.parse(m_ResponseString);
+
+    for (int i = 0; i < m_Fields.size(); ++i) {
+        updateStatus(m_Fields.name(i), m_Fields.value(i));
     }
 }
 
@@ -52,14 +46,28 @@ const QString &Response::getErrorMessage() const {
 
 //---------------------------------------------------------------------------
 QVariant Response::getParameter(const QString &aName) const {
+    if (!m_ParametersReady) {
+        return m_Fields.get(aName);
+    }
+
     return m_Parameters.contains(aName) ? m_Parameters.value(aName) : QVariant();
 }
 
 //---------------------------------------------------------------------------
 const QVariantMap &Response::getParameters() const {
+    buildParameters();
+
     return m_Parameters;
 }
 
+//---------------------------------------------------------------------------
+void Response::buildParameters() const {
+    if (!m_ParametersReady) {
+        m_Parameters = m_Fields.toVariantMap();
+        m_ParametersReady = true;
+    }
+}
+
 //---------------------------------------------------------------------------
 const QString &Response::toString() const {
     return m_ResponseString;
@@ -78,20 +86,28 @@ QString Response::toLogString() const {
 
 //---------------------------------------------------------------------------
 void Response::addParameter(const QString &aName, const QString &aValue) {
+    buildParameters();
+
     m_Parameters[aName] = aValue;
 
-    if (aName == CResponse::Parameters::Error) {
-        m_Error = static_cast<EServerError::Enum>(aValue.toInt());
-    } else if (aName == CResponse::Parameters::ErrorCode) {
-        m_Error = static_cast<EServerError::Enum>(aValue.toInt());
+    updateStatus(aName, aValue);
+}
+
+//---------------------------------------------------------------------------
+void Response::updateStatus(QStringView aName, QStringView aValue) {
+    // Поля статуса редки, строки для них создаются только здесь.
+    if (aName == QLatin1String(CResponse::Parameters::Error)) {
+        m_Error = static_cast<EServerError::Enum>(aValue.toString().toInt());
+    } else if (aName == QLatin1String(CResponse::Parameters::ErrorCode)) {
+        m_Error = static_cast<EServerError::Enum>(aValue.toString().toInt());
     }
 
-    if (aName == CResponse::Parameters::Result) {
-        m_Result = static_cast<EServerResult::Enum>(aValue.toInt());
+    if (aName == QLatin1String(CResponse::Parameters::Result)) {
+        m_Result = static_cast<EServerResult::Enum>(aValue.toString().toInt());
     }
 
-    if (aName == CResponse::Parameters::ErrorMessage) {
-        m_ErrorMessage = aValue;
+    if (aName == QLatin1String(CResponse::Parameters::ErrorMessage)) {
+        m_ErrorMessage = aValue.toString();
     }
 }
 
@@ -0,0 +1,155 @@
+/* @file Таблица полей ответа сервера в формате key=value. */
+
+#include <SDK/PaymentProcessor/Humo/ResponseFields.h>
+
+namespace SDK {
+namespace PaymentProcessor {
+namespace Humo {
+
+namespace {
+/// Символ имени поля: латинская буква, цифра или '_' (\w без Unicode-свойств).
+inline bool isNameChar(QChar aChar) {
+    ushort c = aChar.unicode();
+
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '_';
+}
+} // namespace
+
+//---------------------------------------------------------------------------
+ResponseFields::ResponseFields() = default;
+
+//---------------------------------------------------------------------------
+ResponseFields::ResponseFields(const QString &aData) {
+    parse(aData);
+}
+
+//---------------------------------------------------------------------------
+void ResponseFields::parse(const QString &aData) {
+    // Копия разделяет данные с aData, смещения полей остаются действительными.
+    m_Data = aData;
+    m_Fields.clear();
+
+    int size = m_Data.size();
+    int start = 0;
+
+    while (start <= size) {
+        int end = m_Data.indexOf(QLatin1String("\r\n"), start);
+
+        if (end < 0) {
+            end = size;
+        }
+
+        parseLine(start, end);
+
+        start = end + 2;
+    }
+}
+
+//---------------------------------------------------------------------------
+void ResponseFields::parseLine(int aStart, int aEnd) {
+    const QChar *data = m_Data.constData();
+    int nameEnd = aStart;
+
+    while (nameEnd < aEnd && isNameChar(data[nameEnd])) {
+        ++nameEnd;
+    }
+
+    if (nameEnd == aStart || nameEnd == aEnd || data[nameEnd] != QLatin1Char('=')) {
+        return;
+    }
+
+    int valueStart = nameEnd + 1;
+    int valueEnd = aEnd;
+
+    for (int i = valueStart; i < aEnd; ++i) {
+        if (data[i] == QLatin1Char('\n')) {
+            // Перевод строки допустим только последним символом.
+            if (i != aEnd - 1) {
+                return;
+            }
+
+            valueEnd = i;
+        }
+    }
+
+    SField field = {aStart, nameEnd - aStart, valueStart, valueEnd - valueStart};
+    m_Fields.append(field);
+}
+
+//---------------------------------------------------------------------------
+int ResponseFields::size() const {
+    return m_Fields.size();
+}
+
+//---------------------------------------------------------------------------
+bool ResponseFields::isEmpty() const {
+    return m_Fields.isEmpty();
+}
+
+//---------------------------------------------------------------------------
+QStringView ResponseFields::name(int aIndex) const {
+    const SField &field = m_Fields.at(aIndex);
+
+    return QStringView(m_Data).mid(field.nameStart, field.nameLength);
+}
+
+//---------------------------------------------------------------------------
+QStringView ResponseFields::value(int aIndex) const {
+    const SField &field = m_Fields.at(aIndex);
+
+    return QStringView(m_Data).mid(field.valueStart, field.valueLength);
+}
+
+//---------------------------------------------------------------------------
+int ResponseFields::indexOf(QStringView aName) const {
+    for (int i = m_Fields.size() - 1; i >= 0; --i) {
+        if (m_Fields.at(i).nameLength == aName.size() && name(i) == aName) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+//---------------------------------------------------------------------------
+bool ResponseFields::contains(QStringView aName) const {
+    return indexOf(aName) >= 0;
+}
+
+//---------------------------------------------------------------------------
+QVariant ResponseFields::get(QStringView aName) const {
+    int index = indexOf(aName);
+
+    return index < 0 ? QVariant() : QVariant(value(index).toString());
+}
+
+//---------------------------------------------------------------------------
+int ResponseFields::getInt(QStringView aName, int aDefault) const {
+    int index = indexOf(aName);
+
+    if (index < 0) {
+        return aDefault;
+    }
+
+    bool ok = false;
+    int result = value(index).toString().toInt(&ok);
+
+    return ok ? result : aDefault;
+}
+
+//---------------------------------------------------------------------------
+QVariantMap ResponseFields::toVariantMap() const {
+    QVariantMap result;
+
+    for (int i = 0; i < m_Fields.size(); ++i) {
+        result.insert(name(i).toString(), value(i).toString());
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------------------------
+} // namespace Humo
+} // namespace PaymentProcessor
+} // namespace SDK
@@ -1,5 +1,6 @@
 /* @file Описание платёжного оператора. */
 
+#include <QtCore/QDataStream>
 #include <QtCore/QDebug>
 #include <QtCore/QJsonArray>
 #include <QtCore/QJsonDocument>
@@ -214,6 +215,183 @@ TProviderFields SProvider::json2Fields(const QString &aJson) {
     return fields;
 }
 
+//------------------------------------------------------------------------------
+namespace {
+typedef SProvider::SProcessingTraits::SRequest TRequest;
+
+//------------------------------------------------------------------------------
+void writeRequestField(QDataStream &aStream, const TRequest::SField &aField) {
+    aStream << aField.name << aField.value << aField.crypted << qint32(aField.algorithm);
+}
+
+//------------------------------------------------------------------------------
+void readRequestField(QDataStream &aStream, TRequest::SField &aField) {
+    qint32 algorithm = 0;
+
+    aStream >> aField.name >> aField.value >> aField.crypted >> algorithm;
+    aField.algorithm = static_cast<decltype(aField.algorithm)>(algorithm);
+}
+
+//------------------------------------------------------------------------------
+void writeRequest(QDataStream &aStream, const TRequest &aRequest) {
+    aStream << aRequest.url << quint32(aRequest.requestFields.size());
+
+    foreach (const TRequest::SField &field, aRequest.requestFields) {
+        writeRequestField(aStream, field);
+    }
+
+    aStream << quint32(aRequest.responseFields.size());
+
+    foreach (const TRequest::SResponseField &field, aRequest.responseFields) {
+        writeRequestField(aStream, field);
+        aStream << field.required << qint32(field.encoding) << qint32(field.codepage);
+    }
+}
+
+//------------------------------------------------------------------------------
+void readRequest(QDataStream &aStream, TRequest &aRequest) {
+    quint32 count = 0;
+    aStream >> aRequest.url >> count;
+
+    for (quint32 i = 0; i < count && aStream.status() == QDataStream::Ok; ++i) {
+        TRequest::SField field;
+        readRequestField(aStream, field);
+        aRequest.requestFields << field;
+    }
+
+    aStream >> count;
+
+    for (quint32 i = 0; i < count && aStream.status() == QDataStream::Ok; ++i) {
+        TRequest::SResponseField field;
+        qint32 encoding = 0;
+        qint32 codepage = 0;
+
+        readRequestField(aStream, field);
+        aStream >> field.required >> encoding >> codepage;
+
+        field.encoding = static_cast<TRequest::SResponseField::Encoding>(encoding);
+        field.codepage = static_cast<TRequest::SResponseField::Codepage>(codepage);
+        aRequest.responseFields << field;
+    }
+}
+} // namespace
+
+//------------------------------------------------------------------------------
+QDataStream &operator<<(QDataStream &aStream, const SProviderField::SEnum_Item &aItem) {
+    return aStream << aItem.title << aItem.value << aItem.id << qint32(aItem.sort)
+                   << aItem.subItems;
+}
+
+//------------------------------------------------------------------------------
+QDataStream &operator>>(QDataStream &aStream, SProviderField::SEnum_Item &aItem) {
+    qint32 sort = 0;
+
+    aStream >> aItem.title >> aItem.value >> aItem.id >> sort >> aItem.subItems;
+    aItem.sort = sort;
+
+    return aStream;
+}
+
+//------------------------------------------------------------------------------
+QDataStream &operator<<(QDataStream &aStream, const SProviderField &aField) {
+    aStream << aField.type << aField.id << aField.keyboardType << aField.letterCase
+            << aField.language << qint32(aField.sort) << qint32(aField.minSize)
+            << qint32(aField.maxSize) << aField.isRequired << aField.title << aField.comment
+            << aField.extendedComment << aField.mask << aField.isPassword << aField.behavior
+            << aField.format << aField.url << aField.html << aField.backButton
+            << aField.forwardButton << aField.enum_Items << aField.defaultValue
+            << aField.dependency << quint32(aField.security.size());
+
+    for (auto it = aField.security.constBegin(); it != aField.security.constEnd(); ++it) {
+        aStream << qint32(it.key()) << it.value();
+    }
+
+    return aStream;
+}
+
+//------------------------------------------------------------------------------
+QDataStream &operator>>(QDataStream &aStream, SProviderField &aField) {
+    qint32 sort = 0;
+    qint32 minSize = 0;
+    qint32 maxSize = 0;
+    quint32 count = 0;
+
+    aStream >> aField.type >> aField.id >> aField.keyboardType >> aField.letterCase >>
+        aField.language >> sort >> minSize >> maxSize >> aField.isRequired >> aField.title >>
+        aField.comment >> aField.extendedComment >> aField.mask >> aField.isPassword >>
+        aField.behavior >> aField.format >> aField.url >> aField.html >> aField.backButton >>
+        aField.forwardButton >> aField.enum_Items >> aField.defaultValue >> aField.dependency >>
+        count;
+
+    aField.sort = sort;
+    aField.minSize = minSize;
+    aField.maxSize = maxSize;
+
+    for (quint32 i = 0; i < count && aStream.status() == QDataStream::Ok; ++i) {
+        qint32 subsystem = 0;
+        QString mask;
+
+        aStream >> subsystem >> mask;
+        aField.security.insert(static_cast<SProviderField::SecuritySubsystem>(subsystem), mask);
+    }
+
+    return aStream;
+}
+
+//------------------------------------------------------------------------------
+QDataStream &operator<<(QDataStream &aStream, const SProvider &aProvider) {
+    const SProvider::SProcessingTraits &processor = aProvider.processor;
+
+    aStream << aProvider.id << aProvider.cid << aProvider.ttList << aProvider.limits.min
+            << aProvider.limits.max << aProvider.limits.system << aProvider.limits.check;
+
+    aStream << qint32(processor.keyPair) << qint32(processor.clientCard) << processor.type
+            << qint32(processor.feeType) << processor.skipCheck << processor.payOnline
+            << processor.askForRetry << processor.requirePrinter << processor.rounding
+            << processor.showAddInfo << quint32(processor.requests.size());
+
+    for (auto it = processor.requests.constBegin(); it != processor.requests.constEnd(); ++it) {
+        aStream << it.key();
+        writeRequest(aStream, it.value());
+    }
+
+    return aStream << aProvider.type << aProvider.name << aProvider.comment << aProvider.fields
+                   << aProvider.externalDataHandler << aProvider.receipts
+                   << aProvider.receiptParameters;
+}
+
+//------------------------------------------------------------------------------
+QDataStream &operator>>(QDataStream &aStream, SProvider &aProvider) {
+    SProvider::SProcessingTraits &processor = aProvider.processor;
+    qint32 keyPair = 0;
+    qint32 clientCard = 0;
+    qint32 feeType = 0;
+    quint32 count = 0;
+
+    aStream >> aProvider.id >> aProvider.cid >> aProvider.ttList >> aProvider.limits.min >>
+        aProvider.limits.max >> aProvider.limits.system >> aProvider.limits.check;
+
+    aStream >> keyPair >> clientCard >> processor.type >> feeType >> processor.skipCheck >>
+        processor.payOnline >> processor.askForRetry >> processor.requirePrinter >>
+        processor.rounding >> processor.showAddInfo >> count;
+
+    processor.keyPair = keyPair;
+    processor.clientCard = clientCard;
+    processor.feeType = static_cast<SProvider::FeeType>(feeType);
+
+    for (quint32 i = 0; i < count && aStream.status() == QDataStream::Ok; ++i) {
+        QString name;
+        TRequest request;
+
+        aStream >> name;
+        readRequest(aStream, request);
+        processor.requests.insert(name, request);
+    }
+
+    return aStream >> aProvider.type >> aProvider.name >> aProvider.comment >> aProvider.fields >>
+           aProvider.externalDataHandler >> aProvider.receipts >> aProvider.receiptParameters;
+}
+
 //------------------------------------------------------------------------------
 } // namespace PaymentProcessor
 } // namespace SDK
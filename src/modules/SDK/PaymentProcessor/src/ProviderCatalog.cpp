@@ -0,0 +1,146 @@
+/* @file Скомпилированный каталог операторов. */
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtCore/QDataStream>
+#include <QtCore/QSet>
+
+#include <SDK/PaymentProcessor/Settings/ProviderCatalog.h>
+
+#include <algorithm>
+
+namespace SDK {
+namespace PaymentProcessor {
+
+namespace {
+/// Результат разбора одного описания.
+struct SCompiled {
+    const ProviderCatalog::SSource *source;
+    SProvider provider;
+    bool valid;
+};
+} // namespace
+
+//---------------------------------------------------------------------------
+QSharedPointer<const ProviderCatalog>
+ProviderCatalog::compile(const TSources &aSources, const TParser &aParser, bool aParallel) {
+    QVector<SCompiled> compiled;
+    compiled.reserve(aSources.size());
+
+    for (const SSource &source : aSources) {
+        compiled.append({&source, SProvider(), false});
+    }
+
+    auto parse = [&aParser](SCompiled &aCompiled) {
+        aCompiled.valid = aParser(aCompiled.source->buffer, aCompiled.provider);
+    };
+
+    if (aParallel) {
+        QtConcurrent::blockingMap(compiled, parse);
+    } else {
+        std::for_each(compiled.begin(), compiled.end(), parse);
+    }
+
+    // Индексы строятся в исходном порядке, чтобы выдача совпадала с порядком описаний в файлах.
+    QSharedPointer<ProviderCatalog> catalog(new ProviderCatalog());
+    catalog->m_Providers.reserve(compiled.size());
+
+    for (const SCompiled &item : compiled) {
+        if (item.valid) {
+            catalog->add(item.source->id, item.provider);
+        }
+    }
+
+    return catalog;
+}
+
+//---------------------------------------------------------------------------
+QSharedPointer<const ProviderCatalog> ProviderCatalog::load(QDataStream &aStream) {
+    QSharedPointer<ProviderCatalog> catalog(new ProviderCatalog());
+    quint32 count = 0;
+
+    aStream >> count;
+    catalog->m_Providers.reserve(int(qMin<quint32>(count, 1u << 20)));
+
+    for (quint32 i = 0; i < count && aStream.status() == QDataStream::Ok; ++i) {
+        qint64 id = 0;
+        SProvider provider;
+
+        aStream >> id >> provider;
+        catalog->add(id, provider);
+    }
+
+    if (aStream.status() != QDataStream::Ok) {
+        return QSharedPointer<const ProviderCatalog>();
+    }
+
+    return catalog;
+}
+
+//---------------------------------------------------------------------------
+void ProviderCatalog::save(QDataStream &aStream) const {
+    aStream << quint32(m_Order.size());
+
+    foreach (qint64 id, m_Order) {
+        aStream << id << *m_Providers.constFind(id);
+    }
+}
+
+//---------------------------------------------------------------------------
+void ProviderCatalog::add(qint64 aId, const SProvider &aProvider) {
+    if (m_Providers.contains(aId)) {
+        return;
+    }
+
+    m_Order << aId;
+    m_Providers.insert(aId, aProvider);
+
+    QSet<qint64> cids = aProvider.ttList;
+    if (aProvider.cid >= 0) {
+        cids << aProvider.cid;
+    }
+
+    foreach (qint64 cid, cids) {
+        m_Gateways.insert(cid, aId);
+    }
+
+    m_Processing.insert(getProcessingType(aProvider), aId);
+}
+
+//---------------------------------------------------------------------------
+QString ProviderCatalog::getProcessingType(const SProvider &aProvider) {
+    return aProvider.processor.type.section('#', 0, 0);
+}
+
+//---------------------------------------------------------------------------
+int ProviderCatalog::size() const {
+    return m_Providers.size();
+}
+
+//---------------------------------------------------------------------------
+const SProvider *ProviderCatalog::find(qint64 aId) const {
+    auto it = m_Providers.constFind(aId);
+
+    return it == m_Providers.constEnd() ? nullptr : &it.value();
+}
+
+//---------------------------------------------------------------------------
+QList<qint64> ProviderCatalog::getIDsByCID(qint64 aCid) const {
+    return m_Gateways.values(aCid);
+}
+
+//---------------------------------------------------------------------------
+QList<qint64> ProviderCatalog::getIDsByProcessing(const QString &aType) const {
+    return m_Processing.values(aType);
+}
+
+//---------------------------------------------------------------------------
+QStringList ProviderCatalog::getProcessingTypes() const {
+    const auto keys = m_Processing.uniqueKeys();
+    return {keys.cbegin(), keys.cend()};
+}
+
+//---------------------------------------------------------------------------
+} // namespace PaymentProcessor
+} // namespace SDK
+
+//---------------------------------------------------------------------------
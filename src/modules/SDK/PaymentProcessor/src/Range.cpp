@@ -1,5 +1,7 @@
 /* @file Диапазон номерной ёмкости. */
 
+#include <QtCore/QDataStream>
+
 #include <SDK/PaymentProcessor/Settings/Range.h>
 
 namespace SDK {
@@ -20,6 +22,16 @@ bool operator<(qint64 aNumber, const SRange &aRange) {
     return aNumber < aRange.from;
 }
 
+//---------------------------------------------------------------------------
+QDataStream &operator<<(QDataStream &aStream, const SRange &aRange) {
+    return aStream << aRange.from << aRange.to << aRange.cids << aRange.ids;
+}
+
+//---------------------------------------------------------------------------
+QDataStream &operator>>(QDataStream &aStream, SRange &aRange) {
+    return aStream >> aRange.from >> aRange.to >> aRange.cids >> aRange.ids;
+}
+
 } // namespace PaymentProcessor
 } // namespace SDK
 
@@ -0,0 +1,172 @@
+/* @file Индекс номерной ёмкости. */
+
+#include <QtCore/QPair>
+
+#include <SDK/PaymentProcessor/Settings/RangeIndex.h>
+
+#include <algorithm>
+
+namespace SDK {
+namespace PaymentProcessor {
+
+namespace {
+/// Добавляет в aBounds границы корректных диапазонов.
+void collectBounds(const QVector<SRange> &aRanges, QVector<qint64> &aBounds) {
+    foreach (const SRange &range, aRanges) {
+        if (range.from <= range.to) {
+            aBounds << range.from << range.to + 1;
+        }
+    }
+}
+
+/// Отрезки [first, last), которые покрывает диапазон aRange.
+QPair<int, int> segmentsOf(const QVector<qint64> &aBounds, const SRange &aRange) {
+    auto first = std::lower_bound(aBounds.begin(), aBounds.end(), aRange.from);
+    auto last = std::lower_bound(first, aBounds.end(), aRange.to + 1);
+
+    return qMakePair(int(first - aBounds.begin()), int(last - aBounds.begin()));
+}
+} // namespace
+
+//---------------------------------------------------------------------------
+RangeIndex::RangeIndex() : m_Shift(0) {}
+
+//---------------------------------------------------------------------------
+RangeIndex::RangeIndex(const QVector<SRange> &aRanges, const QVector<SRange> &aOverlappedRanges)
+    : m_Shift(0) {
+    collectBounds(aRanges, m_Bounds);
+    collectBounds(aOverlappedRanges, m_Bounds);
+
+    std::sort(m_Bounds.begin(), m_Bounds.end());
+    m_Bounds.erase(std::unique(m_Bounds.begin(), m_Bounds.end()), m_Bounds.end());
+
+    if (m_Bounds.size() < 2) {
+        m_Bounds.clear();
+        return;
+    }
+
+    int segments = m_Bounds.size() - 1;
+
+    // Сколько виртуальных и обычных диапазонов покрывает каждый отрезок.
+    QVector<int> overlapped(segments + 1, 0);
+    QVector<int> regular(segments + 1, 0);
+
+    foreach (const SRange &range, aOverlappedRanges) {
+        if (range.from <= range.to) {
+            QPair<int, int> covered = segmentsOf(m_Bounds, range);
+            ++overlapped[covered.first];
+            --overlapped[covered.second];
+        }
+    }
+
+    foreach (const SRange &range, aRanges) {
+        if (range.from <= range.to) {
+            QPair<int, int> covered = segmentsOf(m_Bounds, range);
+            ++regular[covered.first];
+            --regular[covered.second];
+        }
+    }
+
+    // Виртуальные диапазоны перекрывают обычные, как и при поиске по спискам.
+    m_Offsets.resize(segments + 1);
+    m_Offsets[0] = 0;
+
+    for (int i = 0, virtualCount = 0, regularCount = 0; i < segments; ++i) {
+        virtualCount += overlapped[i];
+        regularCount += regular[i];
+
+        overlapped[i] = virtualCount;
+        m_Offsets[i + 1] = m_Offsets[i] + quint32(virtualCount > 0 ? virtualCount : regularCount);
+    }
+
+    m_Matches.resize(int(m_Offsets.last()));
+    QVector<quint32> cursors = m_Offsets;
+
+    foreach (const SRange &range, aOverlappedRanges) {
+        if (range.from <= range.to) {
+            QPair<int, int> covered = segmentsOf(m_Bounds, range);
+
+            for (int i = covered.first; i < covered.second; ++i) {
+                m_Matches[int(cursors[i]++)] = range;
+            }
+        }
+    }
+
+    foreach (const SRange &range, aRanges) {
+        if (range.from <= range.to) {
+            QPair<int, int> covered = segmentsOf(m_Bounds, range);
+
+            for (int i = covered.first; i < covered.second; ++i) {
+                if (overlapped[i] == 0) {
+                    m_Matches[int(cursors[i]++)] = range;
+                }
+            }
+        }
+    }
+
+    // Корзин примерно столько же, сколько границ: в среднем корзина сужает поиск до пары границ.
+    quint64 span = quint64(m_Bounds.last() - m_Bounds.first());
+
+    while ((span >> m_Shift) >= quint64(m_Bounds.size())) {
+        ++m_Shift;
+    }
+
+    int buckets = int(span >> m_Shift) + 1;
+    m_Buckets.resize(buckets + 1);
+
+    for (int bucket = 0, segment = 0; bucket <= buckets; ++bucket) {
+        qint64 start = m_Bounds.first() + (qint64(bucket) << m_Shift);
+
+        while (segment + 1 < segments && m_Bounds[segment + 1] <= start) {
+            ++segment;
+        }
+
+        m_Buckets[bucket] = quint32(segment);
+    }
+}
+
+//---------------------------------------------------------------------------
+QList<SRange> RangeIndex::find(qint64 aNumber) const {
+    QList<SRange> ranges;
+    int segment = findSegment(aNumber);
+
+    if (segment >= 0) {
+        int first = int(m_Offsets[segment]);
+        int last = int(m_Offsets[segment + 1]);
+
+        ranges.reserve(last - first);
+
+        for (int i = first; i < last; ++i) {
+            ranges << m_Matches[i];
+        }
+    }
+
+    return ranges;
+}
+
+//---------------------------------------------------------------------------
+int RangeIndex::segmentCount() const {
+    return m_Bounds.isEmpty() ? 0 : m_Bounds.size() - 1;
+}
+
+//---------------------------------------------------------------------------
+int RangeIndex::findSegment(qint64 aNumber) const {
+    if (m_Bounds.isEmpty() || aNumber < m_Bounds.first() || aNumber >= m_Bounds.last()) {
+        return -1;
+    }
+
+    int bucket = int(quint64(aNumber - m_Bounds.first()) >> m_Shift);
+
+    // Искомый отрезок лежит между отрезками начала этой и следующей корзины.
+    const qint64 *bounds = m_Bounds.constData();
+    const qint64 *first = bounds + m_Buckets[bucket] + 1;
+    const qint64 *last = bounds + m_Buckets[bucket + 1] + 1;
+
+    return int(std::upper_bound(first, last, aNumber) - bounds) - 1;
+}
+
+//---------------------------------------------------------------------------
+} // namespace PaymentProcessor
+} // namespace SDK
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,250 @@
+/* @file Двоичный снимок разобранных настроек. */
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+
+#include <SDK/PaymentProcessor/Settings/SettingsSnapshot.h>
+
+namespace SDK {
+namespace PaymentProcessor {
+
+namespace CSettingsSnapshot {
+/// Размер блока чтения исходника при расчёте суммы.
+const qint64 ChunkSize = 256 * 1024;
+} // namespace CSettingsSnapshot
+
+//---------------------------------------------------------------------------
+SettingsSnapshot::SettingsSnapshot(const QString &aFileName,
+                                   const QStringList &aSources,
+                                   const QString &aBuild)
+    : m_FileName(aFileName), m_SourceNames(aSources), m_Build(aBuild), m_Map(nullptr) {}
+
+//---------------------------------------------------------------------------
+SettingsSnapshot::~SettingsSnapshot() {
+    close();
+}
+
+//---------------------------------------------------------------------------
+bool SettingsSnapshot::open() {
+    close();
+
+    m_Error.clear();
+    m_Sources = getSources();
+    m_File.setFileName(m_FileName);
+
+    if (!m_File.open(QIODevice::ReadOnly)) {
+        m_Error = "snapshot not found";
+        return false;
+    }
+
+    qint64 size = m_File.size();
+    m_Map = size > 0 ? m_File.map(0, size) : nullptr;
+
+    if (m_Map) {
+        m_Content = QByteArray::fromRawData(reinterpret_cast<const char *>(m_Map), int(size));
+    } else {
+        m_Content = m_File.readAll();
+    }
+
+    QDataStream header(m_Content);
+    header.setVersion(CSettingsSnapshot::StreamVersion);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString build;
+    quint32 count = 0;
+    header >> magic >> version;
+
+    if (magic != CSettingsSnapshot::Magic || version != CSettingsSnapshot::Version) {
+        m_Error = "incompatible format";
+    } else {
+        header >> build >> count;
+
+        if (build != m_Build) {
+            m_Error = QString("snapshot written by build %1").arg(build);
+        } else if (count != quint32(m_Sources.size())) {
+            m_Error = "source list changed";
+        }
+    }
+
+    for (quint32 i = 0; m_Error.isEmpty() && i < count; ++i) {
+        SSource source;
+        header >> source.path >> source.size >> source.hash;
+
+        const SSource &current = m_Sources[int(i)];
+
+        if (header.status() == QDataStream::Ok &&
+            (source.path != current.path || source.size != current.size ||
+             source.hash != current.hash)) {
+            m_Error = QString("source %1 changed").arg(current.path);
+        }
+    }
+
+    qint64 dataSize = -1;
+    QByteArray dataHash;
+
+    if (m_Error.isEmpty()) {
+        header >> dataSize >> dataHash;
+
+        qint64 offset = header.device()->pos();
+
+        if (header.status() != QDataStream::Ok || dataSize < 0 ||
+            offset + dataSize != m_Content.size()) {
+            m_Error = "snapshot is damaged";
+        } else {
+            m_Data = QByteArray::fromRawData(m_Content.constData() + offset, int(dataSize));
+
+            if (QCryptographicHash::hash(m_Data, QCryptographicHash::Md5) != dataHash) {
+                m_Error = "snapshot checksum mismatch";
+            }
+        }
+    }
+
+    if (!m_Error.isEmpty()) {
+        close();
+        return false;
+    }
+
+    m_Stream.reset(new QDataStream(m_Data));
+    m_Stream->setVersion(CSettingsSnapshot::StreamVersion);
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+QDataStream &SettingsSnapshot::data() {
+    if (!m_Stream) {
+        // Пустой поток: чтение из него сразу выставляет ошибку статуса.
+        m_Stream.reset(new QDataStream(QByteArray()));
+    }
+
+    return *m_Stream;
+}
+
+//---------------------------------------------------------------------------
+void SettingsSnapshot::close() {
+    m_Stream.reset();
+    m_Data.clear();
+    m_Content.clear();
+
+    if (m_Map) {
+        m_File.unmap(m_Map);
+        m_Map = nullptr;
+    }
+
+    m_File.close();
+}
+
+//---------------------------------------------------------------------------
+bool SettingsSnapshot::write(const QByteArray &aData) {
+    close();
+
+    m_Error.clear();
+
+    if (m_Sources.size() != m_SourceNames.size()) {
+        m_Sources = getSources();
+    }
+
+    foreach (const SSource &source, m_Sources) {
+        if (source.size >= 0 && source.hash.isEmpty()) {
+            m_Error = QString("source %1 is not readable").arg(source.path);
+            return false;
+        }
+    }
+
+    QDir().mkpath(QFileInfo(m_FileName).absolutePath());
+
+    QSaveFile file(m_FileName);
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        m_Error = file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(CSettingsSnapshot::StreamVersion);
+    stream << CSettingsSnapshot::Magic << CSettingsSnapshot::Version << m_Build
+           << static_cast<quint32>(m_Sources.size());
+
+    foreach (const SSource &source, m_Sources) {
+        stream << source.path << source.size << source.hash;
+    }
+
+    stream << static_cast<qint64>(aData.size())
+           << QCryptographicHash::hash(aData, QCryptographicHash::Md5);
+    stream.writeRawData(aData.constData(), aData.size());
+
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        m_Error = file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+const QString &SettingsSnapshot::getFileName() const {
+    return m_FileName;
+}
+
+//---------------------------------------------------------------------------
+const QString &SettingsSnapshot::getError() const {
+    return m_Error;
+}
+
+//---------------------------------------------------------------------------
+QList<SettingsSnapshot::SSource> SettingsSnapshot::getSources() {
+    QList<SSource> sources;
+
+    foreach (const QString &name, m_SourceNames) {
+        QFileInfo info(name);
+        SSource source;
+
+        source.path = info.absoluteFilePath();
+        source.size = info.exists() ? info.size() : -1;
+
+        if (source.size >= 0) {
+            source.hash = hashFile(source.path);
+        }
+
+        sources << source;
+    }
+
+    return sources;
+}
+
+//---------------------------------------------------------------------------
+QByteArray SettingsSnapshot::hashFile(const QString &aPath) {
+    QFile file(aPath);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    QByteArray buffer(static_cast<int>(CSettingsSnapshot::ChunkSize), Qt::Uninitialized);
+
+    forever {
+        qint64 size = file.read(buffer.data(), CSettingsSnapshot::ChunkSize);
+
+        if (size < 0) {
+            return QByteArray();
+        }
+
+        if (size == 0) {
+            break;
+        }
+
+        hash.addData(QByteArray::fromRawData(buffer.constData(), static_cast<int>(size)));
+    }
+
+    return hash.result();
+}
+
+//---------------------------------------------------------------------------
+} // namespace PaymentProcessor
+} // namespace SDK
+
+//---------------------------------------------------------------------------
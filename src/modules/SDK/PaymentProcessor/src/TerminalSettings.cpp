@@ -174,9 +174,44 @@ SDatabaseSettings TerminalSettings::getDatabaseSettings() const {
     databaseSettings.user = m_properties.get("system.database.user", QString());
     databaseSettings.password = m_properties.get("system.database.password", QString());
 
+    databaseSettings.journalMode =
+        m_properties.get("system.database.journal_mode", databaseSettings.journalMode);
+    databaseSettings.synchronous =
+        m_properties.get("system.database.synchronous", databaseSettings.synchronous);
+    databaseSettings.cacheSize =
+        m_properties.get("system.database.cache_size", databaseSettings.cacheSize);
+    databaseSettings.mmapSize =
+        m_properties.get("system.database.mmap_size", databaseSettings.mmapSize);
+    databaseSettings.tempStore =
+        m_properties.get("system.database.temp_store", databaseSettings.tempStore);
+    databaseSettings.statementCacheSize = m_properties.get("system.database.statement_cache",
+                                                           databaseSettings.statementCacheSize);
+    databaseSettings.readConnections = m_properties.get("system.database.read_connections",
+                                                        databaseSettings.readConnections);
+    databaseSettings.balanceSelfCheck = m_properties.get("system.database.balance_self_check",
+                                                         databaseSettings.balanceSelfCheck);
+
     return databaseSettings;
 }
 
+//---------------------------------------------------------------------------
+SOfflinePaymentSettings TerminalSettings::getOfflinePaymentSettings() const {
+    SOfflinePaymentSettings settings;
+
+    settings.workers =
+        qMax(1, m_properties.get("system.payments.offline_workers", settings.workers));
+    settings.order =
+        m_properties.get("system.payments.offline_order", QString("oldest")) == "amount"
+            ? SOfflinePaymentSettings::Amount
+            : SOfflinePaymentSettings::Oldest;
+    settings.providerRate =
+        qMax(0.0, m_properties.get("system.payments.provider_rate", settings.providerRate));
+    settings.gatewayRate =
+        qMax(0.0, m_properties.get("system.payments.gateway_rate", settings.gatewayRate));
+
+    return settings;
+}
+
 //---------------------------------------------------------------------------
 QStringList TerminalSettings::getDeviceList() const {
     QStringList deviceList;
@@ -7,17 +7,65 @@
 #include <QtCore/QElapsedTimer>
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
 #include <QtCore/QSettings>
 #include <QtCore/QString>
+#include <QtCore/QStringView>
 #include <QtCore/QXmlStreamReader>
 #include <QtCore/QXmlStreamWriter>
 
 #include <SettingsManager/SettingsManager.h>
 #include <boost/foreach.hpp>
+#include <cwchar>
 #include <fstream>
 #include <utility>
 #include <vector>
 
+namespace {
+/// Ключ дерева настроек - имя тега или атрибута в нижнем регистре. Имена из ASCII (то есть
+/// практически все) переводятся посимвольно, без промежуточных QString и перекодирования.
+std::string toKey(QStringView aName) {
+    std::string key(size_t(aName.size()), '\0');
+
+    for (qsizetype i = 0; i < aName.size(); ++i) {
+        ushort c = aName[i].unicode();
+
+        if (c >= 0x80) {
+            return aName.toString().toLower().toStdString();
+        }
+
+        key[size_t(i)] = char(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+    }
+
+    return key;
+}
+
+/// Значение дерева настроек, то же, что QString::toStdWString(), но без копии в QString.
+std::wstring toValue(QStringView aText) {
+    std::wstring value;
+
+#if WCHAR_MAX <= 0xFFFF
+    value.assign(reinterpret_cast<const wchar_t *>(aText.utf16()), size_t(aText.size()));
+#else
+    value.reserve(size_t(aText.size()));
+
+    for (qsizetype i = 0; i < aText.size(); ++i) {
+        uint c = aText[i].unicode();
+
+        if (QChar::isHighSurrogate(c) && i + 1 < aText.size() &&
+            aText[i + 1].isLowSurrogate()) {
+            c = QChar::surrogateToUcs4(ushort(c), aText[++i].unicode());
+        }
+
+        value.push_back(wchar_t(c));
+    }
+#endif
+
+    return value;
+}
+} // namespace
+
+//---------------------------------------------------------------------------
 SSettingsSource::SSettingsSource() : readOnly(true) {}
 
 //---------------------------------------------------------------------------
@@ -85,6 +133,12 @@ bool SettingsManager::loadSettings(const QList<SSettingsSource> &aSettingSources
             continue;
         }
 
+        // Для изменяемых файлов запоминаем прочитанное: при сохранении сравнение идёт с ним,
+        // без повторного разбора файла.
+        if (!source.readOnly && !source.isSymlink()) {
+            rememberFile(path.filePath(), newBranch);
+        }
+
         SSettingsSource workingSource(source);
         std::string branchName = source.adapterName.toStdString();
 
@@ -152,38 +206,50 @@ bool SettingsManager::saveSettings() {
                 m_Properties.get_child((source.adapterName + "." + path.baseName()).toStdString()));
         }
 
-        // Здесь храним оригинальную конфигурацию
-        TPtree originalBranch;
+        bool isXML = path.suffix().compare("xml", Qt::CaseInsensitive) == 0;
+        bool isINI = path.suffix().compare("ini", Qt::CaseInsensitive) == 0;
 
-        if (path.suffix().compare("xml", Qt::CaseInsensitive) == 0) {
-            readXML(path.filePath(), originalBranch);
+        if (!isXML && !isINI) {
+            result = false;
+            toLog(LogLevel::Error,
+                  QString("Unable to save configuration file %1: unsupported file extension.")
+                      .arg(source.configFileName));
+            continue;
+        }
 
-            if (originalBranch != branchToSave) {
-                createBackup(path.filePath());
+        // Если файл не менялся с момента загрузки или сохранения, сравниваем с запомненным
+        // деревом; иначе, как и раньше, перечитываем файл.
+        const TPtree *original = findFile(path.filePath());
+        TPtree originalBranch;
 
-                if (!writeXML(path.filePath(), branchToSave)) {
-                    result = false;
-                    continue;
-                }
+        if (!original) {
+            if (isXML) {
+                readXML(path.filePath(), originalBranch);
+            } else {
+                readINI(path.filePath(), originalBranch);
             }
-        } else if (path.suffix().compare("ini", Qt::CaseInsensitive) == 0) {
-            readINI(path.filePath(), originalBranch);
 
-            if (originalBranch != branchToSave) {
-                createBackup(path.filePath());
+            original = &originalBranch;
+        }
 
-                if (!writeINI(path.filePath(), branchToSave)) {
-                    result = false;
-                    continue;
-                }
+        if (*original == branchToSave) {
+            if (original == &originalBranch) {
+                rememberFile(path.filePath(), originalBranch);
             }
-        } else {
+
+            continue;
+        }
+
+        createBackup(path.filePath());
+
+        if (!(isXML ? writeXML(path.filePath(), branchToSave)
+                    : writeINI(path.filePath(), branchToSave))) {
+            m_Files.remove(path.absoluteFilePath());
             result = false;
-            toLog(LogLevel::Error,
-                  QString("Unable to save configuration file %1: unsupported file extension.")
-                      .arg(source.configFileName));
             continue;
         }
+
+        rememberFile(path.filePath(), branchToSave);
     }
 
     return result;
@@ -198,7 +264,8 @@ bool SettingsManager::readXML(const QString &aFileName, TPtree &aTree) {
         return false;
     }
 
-    QXmlStreamReader xmlReader(&inputFile);
+    // Файл читается целиком одним вызовом, разбор идёт из памяти.
+    QXmlStreamReader xmlReader(inputFile.readAll());
 
     std::vector<boost::reference_wrapper<TPtree>> stack;
     boost::reference_wrapper<TPtree> current = boost::ref(aTree);
@@ -217,10 +284,8 @@ bool SettingsManager::readXML(const QString &aFileName, TPtree &aTree) {
 
         // Встретили открывающий тег.
         case QXmlStreamReader::StartElement: {
-            QString key = xmlReader.name().toString().toLower();
-
             TPtree &newOne = boost::unwrap_ref(current)
-                                 .push_back(std::make_pair(key.toStdString(), TPtree()))
+                                 .push_back(std::make_pair(toKey(xmlReader.name()), TPtree()))
                                  ->second;
             stack.push_back(current);
             current = boost::ref(newOne);
@@ -234,9 +299,10 @@ bool SettingsManager::readXML(const QString &aFileName, TPtree &aTree) {
                                          .push_back(std::make_pair("<xmlattr>", TPtree()))
                                          ->second;
 
+                // put(): имена, совпавшие после перевода в нижний регистр (ID и id), дают
+                // один ключ со значением последнего атрибута, имя с точкой разбирается как путь.
                 foreach (const QXmlStreamAttribute &attribute, attributes) {
-                    attribTree.put(attribute.name().toString().toLower().toStdString(),
-                                   attribute.value().toString().toStdWString());
+                    attribTree.put(toKey(attribute.name()), toValue(attribute.value()));
                 }
             }
 
@@ -246,7 +312,7 @@ bool SettingsManager::readXML(const QString &aFileName, TPtree &aTree) {
         // Текст внутри тегов.
         case QXmlStreamReader::Characters: {
             if (!xmlReader.isWhitespace()) {
-                boost::unwrap_ref(current).put_value(xmlReader.text().toString());
+                boost::unwrap_ref(current).data() = toValue(xmlReader.text());
             }
 
             break;
@@ -301,7 +367,8 @@ bool SettingsManager::readXML(const QString &aFileName, TPtree &aTree) {
 
 //---------------------------------------------------------------------------
 bool SettingsManager::writeXML(const QString &aFileName, const TPtree &aTree) {
-    QFile outputFile(aFileName);
+    // Запись во временный файл и замена исходного: при сбое старый файл остаётся целым.
+    QSaveFile outputFile(aFileName);
 
     if (!outputFile.open(QIODevice::WriteOnly)) {
         toLog(LogLevel::Error, QString("Failed to open file: %1.").arg(aFileName));
@@ -315,6 +382,12 @@ bool SettingsManager::writeXML(const QString &aFileName, const TPtree &aTree) {
     writeXMLNode(xmlWriter, aTree);
     xmlWriter.writeEndDocument();
 
+    if (xmlWriter.hasError() || !outputFile.commit()) {
+        toLog(LogLevel::Error,
+              QString("Failed to write file %1: %2.").arg(aFileName).arg(outputFile.errorString()));
+        return false;
+    }
+
     return true;
 }
 
@@ -404,7 +477,36 @@ bool SettingsManager::writeINI(const QString &aFileName, const TPtree &aTree) {
 void SettingsManager::createBackup(const QString &aFilePath) {
     QString backupExt = QDateTime::currentDateTime().toString(".yyyy-MM-dd_hh-mm-ss") + "_backup";
 
-    QFile::rename(aFilePath, aFilePath + backupExt);
+    // Копия, а не переименование: исходный файл остаётся на месте до атомарной замены.
+    QFile::copy(aFilePath, aFilePath + backupExt);
+}
+
+//---------------------------------------------------------------------------
+void SettingsManager::rememberFile(const QString &aFilePath, const TPtree &aTree) {
+    QFileInfo info(aFilePath);
+
+    if (!info.exists()) {
+        m_Files.remove(info.absoluteFilePath());
+        return;
+    }
+
+    SFileState &state = m_Files[info.absoluteFilePath()];
+    state.size = info.size();
+    state.modified = info.lastModified();
+    state.tree = aTree;
+}
+
+//---------------------------------------------------------------------------
+const TPtree *SettingsManager::findFile(const QString &aFilePath) const {
+    QFileInfo info(aFilePath);
+    auto it = m_Files.constFind(info.absoluteFilePath());
+
+    if (it == m_Files.constEnd() || !info.exists() || it->size != info.size() ||
+        it->modified != info.lastModified()) {
+        return nullptr;
+    }
+
+    return &it->tree;
 }
 
 //---------------------------------------------------------------------------
@@ -16,6 +16,11 @@ namespace CComponent {
 inline const char *OptionalTask() {
     return "OptionalTaskProperty";
 }
+
+/// Размер файла задачи из описания обновления.
+inline const char *TaskSize() {
+    return "TaskSizeProperty";
+}
 } // namespace CComponent
 
 //---------------------------------------------------------------------------
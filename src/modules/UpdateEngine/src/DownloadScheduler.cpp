@@ -0,0 +1,402 @@
+/* @file Планировщик параллельной загрузки файлов обновления. */
+
+#include <QtCore/QFile>
+#include <QtCore/QTimer>
+
+#include <NetworkTaskManager/FileDataStream.h>
+#include <NetworkTaskManager/FileDownloadTask.h>
+#include <NetworkTaskManager/NetworkTaskManager.h>
+#include <algorithm>
+
+#include "Component.h"
+#include "DownloadScheduler.h"
+#include "Misc.h"
+
+namespace {
+//---------------------------------------------------------------------------
+/// Файл части. NetworkTaskManager позиционирует поток по началу Content-Range, то есть по
+/// смещению в целом файле, а в файле части оно отсчитывается от начала части.
+class SegmentDataStream : public FileDataStream {
+public:
+    SegmentDataStream(const QString &aPath, qint64 aBegin)
+        : FileDataStream(aPath), m_Begin(aBegin) {}
+
+    virtual bool seek(qint64 aOffset) { return FileDataStream::seek(aOffset - m_Begin); }
+
+private:
+    qint64 m_Begin;
+};
+} // namespace
+
+//---------------------------------------------------------------------------
+DownloadScheduler::DownloadScheduler(NetworkTaskManager *aManager, QObject *aParent)
+    : QObject(aParent), m_Manager(aManager), m_MaxTasks(CDownloadScheduler::MaxTasks),
+      m_MaxTasksPerHost(CDownloadScheduler::MaxTasksPerHost), m_Order(SmallFirst),
+      m_SegmentThreshold(CDownloadScheduler::SegmentThreshold),
+      m_SegmentCount(CDownloadScheduler::Segments), m_Active(false) {}
+
+//---------------------------------------------------------------------------
+void DownloadScheduler::setMaxTasks(int aMaxTasks, int aMaxTasksPerHost) {
+    m_MaxTasks = qMax(1, aMaxTasks);
+    m_MaxTasksPerHost = qMax(1, aMaxTasksPerHost);
+}
+
+//---------------------------------------------------------------------------
+void DownloadScheduler::setOrder(EOrder aOrder) {
+    m_Order = aOrder;
+}
+
+//---------------------------------------------------------------------------
+void DownloadScheduler::setSegmentation(qint64 aThreshold, int aSegments) {
+    m_SegmentThreshold = aThreshold;
+    m_SegmentCount = aSegments;
+}
+
+//---------------------------------------------------------------------------
+void DownloadScheduler::enqueue(const QList<NetworkTask *> &aTasks) {
+    QList<NetworkTask *> tasks = aTasks;
+
+    if (m_Order == SmallFirst) {
+        std::stable_sort(tasks.begin(), tasks.end(), [](NetworkTask *aLeft, NetworkTask *aRight) {
+            return aLeft->property(CComponent::TaskSize()).toLongLong() <
+                   aRight->property(CComponent::TaskSize()).toLongLong();
+        });
+    }
+
+    foreach (auto task, tasks) {
+        connect(task, SIGNAL(onComplete()), SLOT(onTaskComplete()), Qt::UniqueConnection);
+    }
+
+    m_Queue += tasks;
+    m_Active = true;
+
+    schedule();
+}
+
+//---------------------------------------------------------------------------
+void DownloadScheduler::retry(NetworkTask *aTask, int aDelay) {
+    m_Delayed.insert(aTask);
+
+    QTimer::singleShot(aDelay, this, [this, aTask]() {
+        // Задача могла быть снята вызовом abort().
+        if (m_Delayed.remove(aTask)) {
+            m_Queue.prepend(aTask);
+            schedule();
+        }
+    });
+}
+
+//---------------------------------------------------------------------------
+void DownloadScheduler::abort() {
+    m_Active = false;
+
+    foreach (auto task, m_Running) {
+        disconnect(task, nullptr, this, nullptr);
+
+        if (m_Segments.contains(task) || m_Cancelled.contains(task)) {
+            connect(task, SIGNAL(onComplete()), task, SLOT(deleteLater()));
+        }
+
+        m_Manager->removeTask(task);
+    }
+
+    foreach (auto task, m_Queue) {
+        if (m_Segments.contains(task)) {
+            delete task;
+        }
+    }
+
+    m_Queue.clear();
+    m_Running.clear();
+    m_Hosts.clear();
+    m_Delayed.clear();
+    m_Segments.clear();
+    m_SegmentsLeft.clear();
+    m_SegmentsTotal.clear();
+    m_Cancelled.clear();
+    m_Whole.clear();
+}
+
+//---------------------------------------------------------------------------
+int DownloadScheduler::pending() const {
+    int result = m_Delayed.size() + m_SegmentsLeft.size();
+
+    foreach (auto task, m_Queue) {
+        if (!m_Segments.contains(task)) {
+            ++result;
+        }
+    }
+
+    foreach (auto task, m_Running) {
+        if (!m_Segments.contains(task) && !m_Cancelled.contains(task)) {
+            ++result;
+        }
+    }
+
+    return result;
+}
+
+//---------------------------------------------------------------------------
+void DownloadScheduler::schedule() {
+    for (int i = 0; i < m_Queue.size() && m_Running.size() < m_MaxTasks;) {
+        NetworkTask *task = m_Queue.at(i);
+
+        // Сервер занят - пробуем следующую задачу, она может быть с другого сервера.
+        if (m_Hosts.value(hostKey(task)) >= m_MaxTasksPerHost) {
+            ++i;
+            continue;
+        }
+
+        m_Queue.removeAt(i);
+
+        if (!split(task, i)) {
+            start(task);
+        }
+    }
+
+    checkFinished();
+}
+
+//---------------------------------------------------------------------------
+void DownloadScheduler::onTaskComplete() {
+    auto *task = qobject_cast<NetworkTask *>(sender());
+
+    release(task);
+
+    emit taskFinished(task);
+
+    // Задача, отложенная на повтор, снова качается целиком, иначе владелец может её удалить.
+    if (!m_Delayed.contains(task)) {
+        m_Whole.remove(task);
+    }
+
+    schedule();
+}
+
+//---------------------------------------------------------------------------
+void DownloadScheduler::onSegmentComplete() {
+    auto *task = qobject_cast<FileDownloadTask *>(sender());
+
+    release(task);
+
+    if (m_Cancelled.remove(task)) {
+        task->closeFile();
+        QFile::remove(task->getPath());
+        task->deleteLater();
+
+        schedule();
+        return;
+    }
+
+    SSegment segment = m_Segments.take(task);
+    qint64 received = task->getDataStream()->size();
+    int httpError = task->getHttpError();
+
+    task->closeFile();
+    task->deleteLater();
+
+    if (httpError == 200) {
+        // Сервер прислал файл целиком вместо диапазона.
+        Log(LogLevel::Warning,
+            QString("Server ignores Range header for %1.")
+                .arg(segment.owner->getUrl().toString()));
+
+        unsplit(segment.owner);
+    } else if (received == segment.end - segment.begin + 1) {
+        if (--m_SegmentsLeft[segment.owner] == 0) {
+            if (merge(segment.owner)) {
+                m_SegmentsLeft.remove(segment.owner);
+                m_SegmentsTotal.remove(segment.owner);
+
+                // Запрос докачки склеенного файла вернёт 416, после чего файл будет проверен
+                // верификатором задачи так же, как полностью скачанный ранее.
+                m_Queue.prepend(segment.owner);
+            } else {
+                unsplit(segment.owner);
+            }
+        }
+    } else if (++segment.fails >= CDownloadScheduler::MaxSegmentFails) {
+        Log(LogLevel::Error,
+            QString("Failed to download segment %1 of %2. Error: %3. Http code: %4")
+                .arg(segment.index)
+                .arg(segment.owner->getUrl().toString())
+                .arg(task->errorString())
+                .arg(httpError));
+
+        unsplit(segment.owner);
+    } else {
+        m_Queue.prepend(createSegmentTask(segment));
+    }
+
+    schedule();
+}
+
+//---------------------------------------------------------------------------
+bool DownloadScheduler::split(NetworkTask *aTask, int aPosition) {
+    auto *task = qobject_cast<FileDownloadTask *>(aTask);
+    qint64 size = aTask->property(CComponent::TaskSize()).toLongLong();
+
+    // Без верификатора склеенный файл нечем проверить, начатый файл докачивается как раньше.
+    if (!task || !task->getVerifier() || m_SegmentThreshold <= 0 || size < m_SegmentThreshold ||
+        m_Whole.contains(task) || task->getDataStream()->size() > 0) {
+        return false;
+    }
+
+    int count =
+        static_cast<int>(qMin<qint64>(m_SegmentCount, size / CDownloadScheduler::MinSegmentSize));
+
+    if (count < 2) {
+        return false;
+    }
+
+    qint64 length = (size + count - 1) / count;
+
+    for (int index = 0; index < count; ++index) {
+        SSegment segment = {task, index, index * length, qMin(size, (index + 1) * length) - 1, 0};
+
+        // Части от прерванного запуска могли остаться от другой версии файла.
+        QFile::remove(segmentPath(task, index));
+
+        m_Queue.insert(aPosition + index, createSegmentTask(segment));
+    }
+
+    m_SegmentsLeft.insert(task, count);
+    m_SegmentsTotal.insert(task, count);
+
+    Log(LogLevel::Normal,
+        QString("%1 downloading in %2 segments...").arg(task->getUrl().toString()).arg(count));
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+FileDownloadTask *DownloadScheduler::createSegmentTask(const SSegment &aSegment) {
+    QString path = segmentPath(aSegment.owner, aSegment.index);
+
+    auto *task = new FileDownloadTask(aSegment.owner->getUrl(), path);
+    task->setDataStream(new SegmentDataStream(path, aSegment.begin));
+    task->setFlags(NetworkTask::None);
+
+    qint64 received = task->getDataStream()->size();
+
+    if (received > aSegment.end - aSegment.begin + 1) {
+        task->getDataStream()->clear();
+        received = 0;
+    }
+
+    QString range = QString("bytes=%1-%2").arg(aSegment.begin + received).arg(aSegment.end);
+    task->getRequestHeader().insert("Range", range.toLatin1());
+
+    connect(task, SIGNAL(onComplete()), SLOT(onSegmentComplete()));
+
+    m_Segments.insert(task, aSegment);
+
+    return task;
+}
+
+//---------------------------------------------------------------------------
+bool DownloadScheduler::merge(FileDownloadTask *aTask) {
+    DataStream *stream = aTask->getDataStream();
+    int count = m_SegmentsTotal.value(aTask);
+
+    for (int index = 0; index < count; ++index) {
+        QFile segment(segmentPath(aTask, index));
+
+        if (!segment.open(QIODevice::ReadOnly)) {
+            Log(LogLevel::Error, QString("Failed to open segment %1.").arg(segment.fileName()));
+            return false;
+        }
+
+        while (!segment.atEnd()) {
+            if (!stream->write(segment.read(CDownloadScheduler::MergeBlockSize))) {
+                Log(LogLevel::Error, QString("Failed to write %1.").arg(aTask->getPath()));
+                return false;
+            }
+        }
+
+        segment.close();
+        segment.remove();
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void DownloadScheduler::unsplit(FileDownloadTask *aTask) {
+    Log(LogLevel::Normal,
+        QString("%1 will be downloaded in one piece.").arg(aTask->getUrl().toString()));
+
+    for (auto it = m_Segments.begin(); it != m_Segments.end();) {
+        if (it.value().owner != aTask) {
+            ++it;
+            continue;
+        }
+
+        auto *task = qobject_cast<FileDownloadTask *>(it.key());
+        it = m_Segments.erase(it);
+
+        if (m_Queue.removeOne(task)) {
+            task->closeFile();
+            QFile::remove(task->getPath());
+            delete task;
+        } else {
+            // Файл части удалится по завершении запроса.
+            m_Cancelled.insert(task);
+            m_Manager->removeTask(task);
+        }
+    }
+
+    for (int index = 0; index < m_SegmentsTotal.value(aTask); ++index) {
+        QFile::remove(segmentPath(aTask, index));
+    }
+
+    m_SegmentsLeft.remove(aTask);
+    m_SegmentsTotal.remove(aTask);
+
+    aTask->resetFile();
+
+    m_Whole.insert(aTask);
+    m_Queue.prepend(aTask);
+}
+
+//---------------------------------------------------------------------------
+void DownloadScheduler::start(NetworkTask *aTask) {
+    m_Running.insert(aTask);
+    ++m_Hosts[hostKey(aTask)];
+
+    m_Manager->addTask(aTask);
+}
+
+//---------------------------------------------------------------------------
+void DownloadScheduler::release(NetworkTask *aTask) {
+    if (m_Running.remove(aTask)) {
+        QString host = hostKey(aTask);
+
+        if (--m_Hosts[host] <= 0) {
+            m_Hosts.remove(host);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+void DownloadScheduler::checkFinished() {
+    if (m_Active && m_Queue.isEmpty() && m_Running.isEmpty() && m_Delayed.isEmpty()) {
+        m_Active = false;
+
+        emit finished();
+    }
+}
+
+//---------------------------------------------------------------------------
+QString DownloadScheduler::hostKey(const NetworkTask *aTask) {
+    const QUrl &url = aTask->getUrl();
+
+    return url.host() + ":" + QString::number(url.port());
+}
+
+//---------------------------------------------------------------------------
+QString DownloadScheduler::segmentPath(const FileDownloadTask *aTask, int aIndex) {
+    return QString("%1.part%2").arg(aTask->getPath()).arg(aIndex);
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,157 @@
+/* @file Планировщик параллельной загрузки файлов обновления. */
+
+#pragma once
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+
+class NetworkTask;
+class NetworkTaskManager;
+class FileDownloadTask;
+
+//---------------------------------------------------------------------------
+namespace CDownloadScheduler {
+/// Число одновременных загрузок.
+const int MaxTasks = 4;
+
+/// Число одновременных загрузок с одного сервера. QNetworkAccessManager открывает к серверу
+/// не больше 6 соединений, лишние запросы ждут в его внутренней очереди.
+const int MaxTasksPerHost = 4;
+
+/// Файлы от этого размера скачиваются частями с заголовком Range.
+const qint64 SegmentThreshold = 8 * 1024 * 1024;
+
+/// Число частей большого файла.
+const int Segments = 4;
+
+/// Минимальный размер части.
+const qint64 MinSegmentSize = 1024 * 1024;
+
+/// Число неудачных попыток скачать часть, после которого файл качается целиком.
+const int MaxSegmentFails = 3;
+
+/// Размер блока при склейке частей.
+const qint64 MergeBlockSize = 1024 * 1024;
+} // namespace CDownloadScheduler
+
+//---------------------------------------------------------------------------
+/// Очередь загрузки файлов обновления через общий NetworkTaskManager. Одновременно выполняется
+/// не больше заданного числа задач, большие файлы скачиваются несколькими запросами
+/// диапазонов. Что делать с неудачно завершённой задачей, решает владелец очереди.
+class DownloadScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    /// Порядок загрузки.
+    enum EOrder {
+        ManifestOrder, /// В порядке описания обновления.
+        SmallFirst     /// Сначала маленькие файлы.
+    };
+
+    explicit DownloadScheduler(NetworkTaskManager *aManager, QObject *aParent = nullptr);
+
+    /// Устанавливает число одновременных загрузок всего и с одного сервера.
+    void setMaxTasks(int aMaxTasks, int aMaxTasksPerHost);
+
+    /// Устанавливает порядок загрузки.
+    void setOrder(EOrder aOrder);
+
+    /// Устанавливает минимальный размер файла для загрузки частями и число частей.
+    /// aThreshold = 0 отключает загрузку частями.
+    void setSegmentation(qint64 aThreshold, int aSegments);
+
+    /// Добавляет задачи в очередь. Размер файла берётся из свойства CComponent::TaskSize().
+    void enqueue(const QList<NetworkTask *> &aTasks);
+
+    /// Ставит завершённую задачу в начало очереди через aDelay мс.
+    void retry(NetworkTask *aTask, int aDelay);
+
+    /// Прерывает загрузки и очищает очередь. Сигнал finished после этого не отправляется.
+    void abort();
+
+    /// Возвращает число незавершённых задач.
+    int pending() const;
+
+signals:
+    /// Задача из очереди завершена (успешно или нет).
+    void taskFinished(NetworkTask *aTask);
+
+    /// Все задачи завершены.
+    void finished();
+
+private slots:
+    /// Запускает задачи из очереди, пока есть свободные места.
+    void schedule();
+
+    void onTaskComplete();
+    void onSegmentComplete();
+
+private:
+    /// Часть большого файла.
+    struct SSegment {
+        FileDownloadTask *owner;
+        int index;
+        qint64 begin; // первый байт
+        qint64 end;   // последний байт включительно
+        int fails;
+    };
+
+    /// Делит задачу на части и ставит их в очередь на место aPosition. false - делить не нужно.
+    bool split(NetworkTask *aTask, int aPosition);
+
+    /// Создаёт задачу загрузки части, продолжая ранее скачанный кусок.
+    FileDownloadTask *createSegmentTask(const SSegment &aSegment);
+
+    /// Склеивает скачанные части в файл задачи.
+    bool merge(FileDownloadTask *aTask);
+
+    /// Отменяет загрузку частями и ставит задачу целиком в начало очереди.
+    void unsplit(FileDownloadTask *aTask);
+
+    void start(NetworkTask *aTask);
+    void release(NetworkTask *aTask);
+    void checkFinished();
+
+    static QString hostKey(const NetworkTask *aTask);
+    static QString segmentPath(const FileDownloadTask *aTask, int aIndex);
+
+private:
+    NetworkTaskManager *m_Manager;
+
+    int m_MaxTasks;
+    int m_MaxTasksPerHost;
+    EOrder m_Order;
+    qint64 m_SegmentThreshold;
+    int m_SegmentCount;
+
+    /// Очередь задач и частей на запуск.
+    QList<NetworkTask *> m_Queue;
+
+    /// Выполняющиеся задачи и части.
+    QSet<NetworkTask *> m_Running;
+
+    /// Число выполняющихся запросов к серверу.
+    QHash<QString, int> m_Hosts;
+
+    /// Задачи, ожидающие повторной попытки.
+    QSet<NetworkTask *> m_Delayed;
+
+    /// Части больших файлов и число оставшихся частей каждого файла.
+    QHash<NetworkTask *, SSegment> m_Segments;
+    QHash<FileDownloadTask *, int> m_SegmentsLeft;
+    QHash<FileDownloadTask *, int> m_SegmentsTotal;
+
+    /// Отменённые части, ожидающие завершения запроса.
+    QSet<NetworkTask *> m_Cancelled;
+
+    /// Файлы, которые качаются только целиком. Задача забывается при завершении без повтора.
+    QSet<NetworkTask *> m_Whole;
+
+    /// Очередь не остановлена и ещё не сообщила о завершении.
+    bool m_Active;
+};
+
+//---------------------------------------------------------------------------
@@ -2,13 +2,13 @@
 
 #include "File.h"
 
-#include <QtCore/QCryptographicHash>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
 
-#include <NetworkTaskManager/HashVerifier.h>
 #include <utility>
 
+#include "FileHasher.h"
+
 File::File() : m_Size(0) {}
 
 //---------------------------------------------------------------------------
@@ -39,18 +39,17 @@ File::Result File::verify(const QString &aTempFilePath) const {
         }
     }
 
-    QFile f(aTempFilePath);
-    if (f.open(QIODevice::ReadOnly)) {
-        Sha256Verifier sha256V(hash());
+    QString fileHash = FileHasher::sha256(aTempFilePath);
 
-        bool hashOK = sha256V.verify(nullptr, f.readAll());
+    if (fileHash.isNull()) {
+        return Error;
+    }
 
-        if (!hashOK && size() == 0) {
-            return NotFullyDownloaded;
-        }
+    bool hashOK = (fileHash.compare(hash(), Qt::CaseInsensitive) == 0);
 
-        return hashOK ? OK : Error;
+    if (!hashOK && size() == 0) {
+        return NotFullyDownloaded;
     }
 
-    return Error;
+    return hashOK ? OK : Error;
 }
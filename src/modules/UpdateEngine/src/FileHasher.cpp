@@ -0,0 +1,214 @@
+/* @file Расчёт контрольных сумм файлов рабочего каталога с кешем. */
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+#include <QtCore/QVector>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+#include "FileHasher.h"
+
+namespace CFileHasher {
+const char CacheName[] = "hash_cache.dat";
+} // namespace CFileHasher
+
+namespace {
+//---------------------------------------------------------------------------
+/// inode файла. Время изменения и размер не меняются при замене файла копией с сохранёнными
+/// атрибутами, а номер inode при этом другой.
+quint64 fileInode(const QString &aPath) {
+#ifdef Q_OS_UNIX
+    struct stat info;
+
+    if (::stat(QFile::encodeName(aPath).constData(), &info) == 0) {
+        return static_cast<quint64>(info.st_ino);
+    }
+#else
+    Q_UNUSED(aPath);
+#endif
+
+    return 0;
+}
+} // namespace
+
+//---------------------------------------------------------------------------
+FileHasher::FileHasher() : m_Paranoid(false), m_CacheHits(0), m_Calculated(0) {}
+
+//---------------------------------------------------------------------------
+void FileHasher::setParanoid(bool aParanoid) {
+    m_Paranoid = aParanoid;
+}
+
+//---------------------------------------------------------------------------
+bool FileHasher::loadCache(const QString &aPath) {
+    m_Cache.clear();
+
+    QFile file(aPath);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> count;
+
+    if (magic != CFileHasher::CacheMagic || version != CFileHasher::CacheVersion) {
+        return false;
+    }
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString name;
+        QByteArray hash;
+        SCacheItem item;
+
+        stream >> name >> item.size >> item.modified >> item.inode >> hash;
+        item.hash = QString::fromLatin1(hash);
+
+        m_Cache.insert(name, item);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        m_Cache.clear();
+
+        return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool FileHasher::saveCache(const QString &aPath) const {
+    QDir().mkpath(QFileInfo(aPath).absolutePath());
+
+    QSaveFile file(aPath);
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << CFileHasher::CacheMagic << CFileHasher::CacheVersion
+           << static_cast<quint32>(m_Cache.size());
+
+    for (auto it = m_Cache.begin(); it != m_Cache.end(); ++it) {
+        stream << it.key() << it.value().size << it.value().modified << it.value().inode
+               << it.value().hash.toLatin1();
+    }
+
+    return (stream.status() == QDataStream::Ok) && file.commit();
+}
+
+//---------------------------------------------------------------------------
+void FileHasher::prune() {
+    for (auto it = m_Cache.begin(); it != m_Cache.end();) {
+        if (m_Used.contains(it.key())) {
+            ++it;
+        } else {
+            it = m_Cache.erase(it);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+bool FileHasher::hash(QList<SEntry> &aEntries) {
+    QVector<SEntry *> changed;
+    m_CacheHits = 0;
+
+    for (auto it = aEntries.begin(); it != aEntries.end(); ++it) {
+        m_Used.insert(it->name);
+
+        auto cached = m_Cache.constFind(it->name);
+
+        if (!m_Paranoid && cached != m_Cache.constEnd() && cached->size == it->size &&
+            cached->modified == it->modified && cached->inode == it->inode) {
+            it->hash = cached->hash;
+            ++m_CacheHits;
+        } else {
+            changed << &(*it);
+        }
+    }
+
+    // Файлы читаются и хешируются параллельно, каждый поток пишет только в свою запись.
+    QtConcurrent::blockingMap(changed, [](SEntry *aEntry) { aEntry->hash = sha256(aEntry->path); });
+
+    bool result = true;
+
+    foreach (SEntry *entry, changed) {
+        if (entry->hash.isEmpty()) {
+            m_Cache.remove(entry->name);
+            result = false;
+        } else {
+            SCacheItem item = {entry->size, entry->modified, entry->inode, entry->hash};
+            m_Cache.insert(entry->name, item);
+        }
+    }
+
+    m_Calculated = changed.size();
+
+    return result;
+}
+
+//---------------------------------------------------------------------------
+int FileHasher::cacheHits() const {
+    return m_CacheHits;
+}
+
+//---------------------------------------------------------------------------
+int FileHasher::calculated() const {
+    return m_Calculated;
+}
+
+//---------------------------------------------------------------------------
+FileHasher::SEntry FileHasher::entry(const QString &aName, const QFileInfo &aInfo) {
+    SEntry result;
+    result.name = aName;
+    result.path = aInfo.filePath();
+    result.size = aInfo.size();
+    result.modified = aInfo.lastModified().toMSecsSinceEpoch();
+    result.inode = fileInode(result.path);
+
+    return result;
+}
+
+//---------------------------------------------------------------------------
+QString FileHasher::sha256(const QString &aPath) {
+    QFile file(aPath);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    QByteArray buffer(static_cast<int>(CFileHasher::ChunkSize), Qt::Uninitialized);
+
+    forever {
+        qint64 size = file.read(buffer.data(), CFileHasher::ChunkSize);
+
+        if (size < 0) {
+            return QString();
+        }
+
+        if (size == 0) {
+            break;
+        }
+
+        hash.addData(QByteArray::fromRawData(buffer.constData(), static_cast<int>(size)));
+    }
+
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,84 @@
+/* @file Расчёт контрольных сумм файлов рабочего каталога с кешем. */
+
+#pragma once
+
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+
+//---------------------------------------------------------------------------
+namespace CFileHasher {
+/// Размер блока чтения файла.
+const qint64 ChunkSize = 256 * 1024;
+
+/// Имя файла кеша.
+extern const char CacheName[];
+
+/// Признак и версия формата файла кеша.
+const quint32 CacheMagic = 0x454B4843;
+const quint32 CacheVersion = 1;
+} // namespace CFileHasher
+
+//---------------------------------------------------------------------------
+/// Считает SHA-256 файлов блоками в пуле потоков. Суммы запоминаются в кеше по пути, размеру,
+/// времени изменения и inode файла, поэтому неизменённые файлы повторно не читаются.
+class FileHasher {
+public:
+    /// Файл для расчёта.
+    struct SEntry {
+        QString name;     // путь относительно корня, ключ кеша
+        QString path;     // полный путь
+        qint64 size;      // размер
+        qint64 modified;  // время изменения, мс
+        quint64 inode;    // 0 - не поддерживается системой
+        QString hash;     // результат, пустая строка - файл не прочитан
+
+        SEntry() : size(0), modified(0), inode(0) {}
+    };
+
+    FileHasher();
+
+    /// Режим без кеша: суммы всех файлов пересчитываются, кеш только обновляется.
+    void setParanoid(bool aParanoid);
+
+    /// Загружает кеш. Повреждённый или несовместимый кеш игнорируется.
+    bool loadCache(const QString &aPath);
+
+    /// Сохраняет кеш.
+    bool saveCache(const QString &aPath) const;
+
+    /// Удаляет из кеша файлы, не встречавшиеся в вызовах hash().
+    void prune();
+
+    /// Заполняет суммы aEntries. false - часть файлов не прочитана, их hash пустой.
+    bool hash(QList<SEntry> &aEntries);
+
+    /// Число сумм, взятых из кеша и посчитанных заново в последнем вызове hash().
+    int cacheHits() const;
+    int calculated() const;
+
+    /// Описание файла для расчёта.
+    static SEntry entry(const QString &aName, const QFileInfo &aInfo);
+
+    /// Потоковый расчёт SHA-256 файла. Пустая строка - файл не прочитан.
+    static QString sha256(const QString &aPath);
+
+private:
+    /// Запись кеша.
+    struct SCacheItem {
+        qint64 size;
+        qint64 modified;
+        quint64 inode;
+        QString hash;
+    };
+
+    QHash<QString, SCacheItem> m_Cache;
+    QSet<QString> m_Used;
+    bool m_Paranoid;
+    int m_CacheHits;
+    int m_Calculated;
+};
+
+//---------------------------------------------------------------------------
@@ -64,6 +64,7 @@ QList<NetworkTask *> Folder::download(const QString &aBaseURL, const TFileList &
             auto *task = new FileDownloadTask(fileURL, dstFilePath);
             task->setVerifier(new Sha256Verifier(fileInfo.hash()));
             task->setProperty(CComponent::OptionalTask(), optional());
+            task->setProperty(CComponent::TaskSize(), fileInfo.size());
             tasks.append(task);
         }
     }
@@ -86,6 +86,7 @@ QList<NetworkTask *> Package::download(const QString &aBaseURL, const TFileList
             }
 
             task->setProperty(CComponent::OptionalTask(), optional());
+            task->setProperty(CComponent::TaskSize(), static_cast<qint64>(m_Size));
             tasks << task;
         }
     }
@@ -3,7 +3,6 @@
 // Stl
 
 #include <QtCore/QCoreApplication>
-#include <QtCore/QCryptographicHash>
 #include <QtCore/QDateTime>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
@@ -31,6 +30,7 @@ const char Name[] = "Updater";
 #include <numeric>
 #include <utility>
 
+#include "FileHasher.h"
 #include "Folder.h"
 #include "Misc.h"
 #include "Package.h"
@@ -58,7 +58,8 @@ const QString BitsJobNamePrefix = "TCUpdater_";
 
 //---------------------------------------------------------------------------
 Updater::Updater(QObject *aParent)
-    : QObject(aParent), m_FailCount(0), m_AllTasksCount(0), m_ProgressPercent(0),
+    : QObject(aParent), m_Scheduler(&m_NetworkTaskManager), m_FailCount(0), m_AllTasksCount(0),
+      m_ProgressPercent(0),
 #ifdef Q_OS_WIN32
       m_BitsManager(ILog::getInstance(CUpdater::Name)), m_UseBITS(true), m_JobPriority(CBITS::HIGH)
 #else
@@ -70,6 +71,10 @@ Updater::Updater(QObject *aParent)
     m_NetworkTaskManager.setDownloadSpeedLimit(80);
 
     connect(&m_ProgressTimer, SIGNAL(timeout()), this, SLOT(showProgress()));
+    connect(&m_Scheduler,
+            SIGNAL(taskFinished(NetworkTask *)),
+            SLOT(downloadComplete(NetworkTask *)));
+    connect(&m_Scheduler, SIGNAL(finished()), SLOT(download()));
 }
 
 //---------------------------------------------------------------------------
@@ -82,7 +87,8 @@ Updater::Updater(QString aConfigURL,
     : m_ConfigURL(std::move(aConfigURL)),
       m_UpdateURL(aUpdateURL + "/" + aAppId + "/" + aConfiguration), m_Version(std::move(aVersion)),
       m_AppId(aAppId), m_Configuration(aConfiguration),
-      m_NetworkTaskManager(ILog::getInstance(CUpdater::Name)), m_FailCount(0),
+      m_NetworkTaskManager(ILog::getInstance(CUpdater::Name)), m_Scheduler(&m_NetworkTaskManager),
+      m_FailCount(0),
       m_AP(std::move(aPointId)), m_AllTasksCount(0), m_ProgressPercent(0),
 #ifdef Q_OS_WIN32
       m_BitsManager(ILog::getInstance(CUpdater::Name)), m_UseBITS(true), m_JobPriority(CBITS::HIGH)
@@ -93,6 +99,10 @@ Updater::Updater(QString aConfigURL,
     m_NetworkTaskManager.setDownloadSpeedLimit(80);
 
     connect(&m_ProgressTimer, SIGNAL(timeout()), this, SLOT(showProgress()));
+    connect(&m_Scheduler,
+            SIGNAL(taskFinished(NetworkTask *)),
+            SLOT(downloadComplete(NetworkTask *)));
+    connect(&m_Scheduler, SIGNAL(finished()), SLOT(download()));
 }
 
 //---------------------------------------------------------------------------
@@ -276,10 +286,54 @@ void Updater::addExceptionDirs(const QStringList &aDirs) {
 
 //---------------------------------------------------------------------------
 TFileList Updater::getWorkingDirStructure(const QString &aDir) const noexcept(false) {
+    QList<FileHasher::SEntry> entries;
+    collectFiles(aDir, entries);
+
+    QDir configDir(m_WorkingDir + CUpdater::UpdaterConfigurationDir);
+    QString cachePath = configDir.absoluteFilePath(CFileHasher::CacheName);
+
+    // Вычисляем контрольные суммы изменившихся файлов.
+    FileHasher hasher;
+    hasher.setParanoid(m_ParanoidHashing);
+    hasher.loadCache(cachePath);
+
+    bool hashed = hasher.hash(entries);
+
+    Log(LogLevel::Normal,
+        QString("Checksum of %1 files: %2 from cache, %3 calculated.")
+            .arg(entries.size())
+            .arg(hasher.cacheHits())
+            .arg(hasher.calculated()));
+
+    // Записи файлов, удалённых из дерева, выбрасываются только при полном обходе.
+    if (aDir.isEmpty()) {
+        hasher.prune();
+    }
+
+    if (!hasher.saveCache(cachePath)) {
+        Log(LogLevel::Warning, QString("Failed to save checksum cache %1.").arg(cachePath));
+    }
+
     TFileList list;
 
+    foreach (const FileHasher::SEntry &entry, entries) {
+        if (!hashed && entry.hash.isEmpty()) {
+            throw Exception(ECategory::Application,
+                            ESeverity::Major,
+                            0,
+                            QString("Failed to calculate checksum for file %1.").arg(entry.path));
+        }
+
+        list.insert(File(entry.name, entry.hash, "", entry.size));
+    }
+
+    return list;
+}
+
+//---------------------------------------------------------------------------
+void Updater::collectFiles(const QString &aDir, QList<FileHasher::SEntry> &aEntries) const {
     if (m_ExceptionDirs.contains(aDir, Qt::CaseInsensitive)) {
-        return list;
+        return;
     }
 
     QDir current(m_WorkingDir + "/" + aDir);
@@ -287,41 +341,14 @@ TFileList Updater::getWorkingDirStructure(const QString &aDir) const noexcept(fa
     foreach (auto fileInfo,
              current.entryInfoList(QDir::NoDotAndDotDot | QDir::Dirs | QDir::Files)) {
         if (fileInfo.isFile()) {
-            // Вычисляем контрольную сумму.
-            QString path = current.filePath(fileInfo.fileName());
-            QFile file(path);
-
-            if (file.open(QIODevice::ReadOnly)) {
-                auto filePath = aDir + "/" + fileInfo.fileName();
-
-#if QT_VERSION >= 0x050000
-                list.insert(File(filePath.replace(QRegularExpression("^/+"), ""),
-                                 QString::fromLatin1(QCryptographicHash::hash(
-                                                         file.readAll(), QCryptographicHash::Sha256)
-                                                         .toHex()),
-                                 "",
-                                 fileInfo.size()));
-#else
-                list.insert(File(filePath.remove(QRegularExpression("^/+"), ""),
-                                 QString::fromLatin1(CCryptographicHash::hash(
-                                                         file.readAll(), CCryptographicHash::Sha256)
-                                                         .toHex()),
-                                 "",
-                                 fileInfo.size()));
-#endif
-            } else {
-                throw Exception(
-                    ECategory::Application,
-                    ESeverity::Major,
-                    0,
-                    QString("Failed to calculate checksum for file %1.").arg(fileInfo.filePath()));
-            }
+            auto filePath = aDir + "/" + fileInfo.fileName();
+            filePath.replace(QRegularExpression("^/+"), "");
+
+            aEntries << FileHasher::entry(filePath, fileInfo);
         } else if (fileInfo.isDir()) {
-            list += getWorkingDirStructure(aDir + "/" + fileInfo.fileName());
+            collectFiles(aDir + "/" + fileInfo.fileName(), aEntries);
         }
     }
-
-    return list;
 }
 
 //-------------------------------------------------------------------------
@@ -400,14 +427,13 @@ void Updater::download() {
 #else
     if (true) { // Always use network download on non-Windows
 #endif
-        auto *task = m_ActiveTasks.front();
-        NetworkTask::connect(
-            task, SIGNAL(onComplete()), this, SLOT(downloadComplete()), Qt::UniqueConnection);
+        foreach (auto task, m_ActiveTasks) {
+            m_TaskSizes[task] = task->getDataStream()->size();
+        }
 
-        m_CurrentTaskSize = task->getDataStream()->size();
-        m_NetworkTaskManager.addTask(task);
+        Log(LogLevel::Normal, QString("Downloading %1 files...").arg(m_ActiveTasks.size()));
 
-        Log(LogLevel::Normal, QString("%1 downloading...").arg(task->getUrl().toString()));
+        m_Scheduler.enqueue(m_ActiveTasks);
     }
 }
 
@@ -420,25 +446,20 @@ void closeFileTask(NetworkTask *aTask) {
 }
 
 //---------------------------------------------------------------------------
-void Updater::downloadComplete() {
-    auto *task = m_ActiveTasks.front();
-    task->disconnect(this, SLOT(downloadComplete()));
-
+void Updater::downloadComplete(NetworkTask *aTask) {
     auto goToNextFile = [&]() {
         // Удаляем старое задание.
-        task->getDataStream()->close();
-        m_ActiveTasks.pop_front();
-        m_FailCount = 0;
-
-        // Продолжаем закачку другого файла.
-        QMetaObject::invokeMethod(this, "download", Qt::QueuedConnection);
+        aTask->getDataStream()->close();
+        m_ActiveTasks.removeOne(aTask);
+        m_TaskSizes.remove(aTask);
+        m_TaskFails.remove(aTask);
     };
 
-    if ((task->getError() == 0) || task->getError() == NetworkTask::TaskFailedButVerified) {
+    if ((aTask->getError() == 0) || aTask->getError() == NetworkTask::TaskFailedButVerified) {
         Log(LogLevel::Normal,
-            QString("File %1 downloaded successfully.").arg(task->getUrl().toString()));
+            QString("File %1 downloaded successfully.").arg(aTask->getUrl().toString()));
 
-        closeFileTask(task);
+        closeFileTask(aTask);
 
         goToNextFile();
         return;
@@ -448,24 +469,24 @@ void Updater::downloadComplete() {
 
     Log(LogLevel::Error,
         QString("Failed to download file %1. Error: %2. Http code: %3")
-            .arg(task->getUrl().toString())
-            .arg(task->errorString())
-            .arg(task->getHttpError()));
+            .arg(aTask->getUrl().toString())
+            .arg(aTask->errorString())
+            .arg(aTask->getHttpError()));
 
-    bool haveNewData = (m_CurrentTaskSize != task->getDataStream()->size());
-    bool retryCountReached = ++m_FailCount >= CUpdater::MaxFails;
+    bool haveNewData = (m_TaskSizes.value(aTask) != aTask->getDataStream()->size());
+    bool retryCountReached = ++m_TaskFails[aTask] >= CUpdater::MaxFails;
 
-    if (task->getError() == NetworkTask::VerifyFailed ||
-        task->getHttpError() == 416) // 416 - Requested Range Not Satisfiable
+    if (aTask->getError() == NetworkTask::VerifyFailed ||
+        aTask->getHttpError() == 416) // 416 - Requested Range Not Satisfiable
     {
-        checkTaskVerifierResult(task);
+        checkTaskVerifierResult(aTask);
 
         nextTryTimeout = 1;
 
-        if (task->property(CComponent::OptionalTask()).toBool()) {
+        if (aTask->property(CComponent::OptionalTask()).toBool()) {
             Log(LogLevel::Normal,
                 QString("File %1 is optional. Skip it and continue to download.")
-                    .arg(task->getUrl().toString()));
+                    .arg(aTask->getUrl().toString()));
             goToNextFile();
             return;
         }
@@ -474,7 +495,7 @@ void Updater::downloadComplete() {
     }
 
     if (!retryCountReached) {
-        if ((task->getHttpError() / 100) == 2) // HTTP 2xx
+        if ((aTask->getHttpError() / 100) == 2) // HTTP 2xx
         {
             // При успешном ответе сервера продолжаем докачку файла незамедлительно
             Log(LogLevel::Error, "Continue download...");
@@ -487,15 +508,17 @@ void Updater::downloadComplete() {
             nextTryTimeout *= 60 * 1000;
         }
 
-        // Делаем повторную попытку скачать файл через несколько минут.
-        QTimer::singleShot(nextTryTimeout, this, SLOT(download()));
+        // Делаем повторную попытку скачать файл через несколько минут, остальные файлы
+        // продолжают скачиваться.
+        m_TaskSizes[aTask] = aTask->getDataStream()->size();
+        m_Scheduler.retry(aTask, nextTryTimeout);
     } else {
-        if (task->property(CComponent::OptionalTask()).toBool()) {
+        if (aTask->property(CComponent::OptionalTask()).toBool()) {
             Log(LogLevel::Normal,
                 QString("File %1 is optional. Skip it and continue to download.")
-                    .arg(task->getUrl().toString()));
+                    .arg(aTask->getUrl().toString()));
 
-            QMetaObject::invokeMethod(task, "resetFile", Qt::DirectConnection);
+            QMetaObject::invokeMethod(aTask, "resetFile", Qt::DirectConnection);
             goToNextFile();
             return;
         }
@@ -504,6 +527,7 @@ void Updater::downloadComplete() {
         Log(LogLevel::Error,
             QString("Download terminated after %1 attempts.").arg(CUpdater::MaxFails));
 
+        m_Scheduler.abort();
         m_ProgressTimer.stop();
         emit done(CUpdaterErrors::NetworkError);
     }
@@ -525,7 +549,7 @@ void Updater::checkTaskVerifierResult(NetworkTask *aTask) {
 
     QMetaObject::invokeMethod(aTask, "resetFile", Qt::DirectConnection);
 
-    m_CurrentTaskSize = 0;
+    m_TaskSizes[aTask] = 0;
 }
 
 //---------------------------------------------------------------------------
@@ -855,6 +879,31 @@ void Updater::setMD5(const QString &aMD5) {
     m_MD5 = aMD5;
 }
 
+//---------------------------------------------------------------------------
+void Updater::setDownloadConcurrency(int aMaxTasks, int aMaxTasksPerHost) {
+    m_Scheduler.setMaxTasks(aMaxTasks, aMaxTasksPerHost);
+}
+
+//---------------------------------------------------------------------------
+void Updater::setDownloadOrder(DownloadScheduler::EOrder aOrder) {
+    m_Scheduler.setOrder(aOrder);
+}
+
+//---------------------------------------------------------------------------
+void Updater::setSegmentedDownload(qint64 aThreshold, int aSegments) {
+    m_Scheduler.setSegmentation(aThreshold, aSegments);
+}
+
+//---------------------------------------------------------------------------
+void Updater::setParanoidHashing(bool aParanoid) {
+    m_ParanoidHashing = aParanoid;
+}
+
+//---------------------------------------------------------------------------
+void Updater::setDownloadBandwidth(qint64 aBytesPerSecond) {
+    m_NetworkTaskManager.setTotalTrafficLimit(aBytesPerSecond);
+}
+
 //---------------------------------------------------------------------------
 void Updater::downloadPackage() {
     Package *package = nullptr;
@@ -894,7 +943,7 @@ void Updater::downloadPackage() {
         Log(LogLevel::Normal, QString("Downloading file %1...").arg(m_ConfigURL));
 
         // Запускаем закачку.
-        m_CurrentTaskSize = task->getDataStream()->size();
+        m_TaskSizes[task] = task->getDataStream()->size();
         m_NetworkTaskManager.addTask(task);
     }
 }
@@ -904,7 +953,7 @@ void Updater::packageDownloaded(QObject *aPackage) {
     auto *task = qobject_cast<NetworkTask *>(m_Mapper.mapping(aPackage));
     auto *package = qobject_cast<Package *>(aPackage);
 
-    bool haveNewData = (m_CurrentTaskSize != task->getDataStream()->size());
+    bool haveNewData = (m_TaskSizes.take(task) != task->getDataStream()->size());
     bool retryCountReached = ++m_FailCount >= CUpdater::MaxFails;
 
     if ((task->getError() == 0) || task->getError() == NetworkTask::TaskFailedButVerified) {
@@ -0,0 +1,270 @@
+/* @file Протокол обмена сторожевого сервиса с клиентами. */
+
+#include <QtCore/QtEndian>
+
+#include <cstring>
+
+#include <WatchServiceClient/Constants.h>
+#include <WatchServiceClient/Protocol.h>
+
+namespace {
+//---------------------------------------------------------------------------
+/// Имя типа по коду. Пустая строка - Custom.
+const QString &typeName(int aCode) {
+    static const QString names[CWatchServiceProtocol::Types::Count] = {
+        QString(),
+        CWatchService::Commands::Ping,
+        CWatchService::Commands::ScreenActivity,
+        CWatchService::Commands::Close,
+        CWatchService::Commands::Exit,
+        CWatchService::Commands::StartModule,
+        CWatchService::Commands::CloseModule,
+        CWatchService::Commands::Restart,
+        CWatchService::Commands::Reboot,
+        CWatchService::Commands::Shutdown,
+        CWatchService::Commands::ShowSplashScreen,
+        CWatchService::Commands::HideSplashScreen,
+        CWatchService::Commands::SetState,
+        CWatchService::Commands::ResetState,
+        CWatchService::Commands::CloseLogs,
+        CWatchService::Notification::ModuleClosed,
+        CWatchService::Commands::Protocol};
+
+    return names[aCode];
+}
+
+//---------------------------------------------------------------------------
+int typeCode(const QString &aType) {
+    for (int code = CWatchServiceProtocol::Types::Custom + 1;
+         code < CWatchServiceProtocol::Types::Count;
+         ++code) {
+        if (typeName(code) == aType) {
+            return code;
+        }
+    }
+
+    return CWatchServiceProtocol::Types::Custom;
+}
+
+//---------------------------------------------------------------------------
+bool appendField(QByteArray &aBuffer, int aTag, const QString &aValue) {
+    if (aValue.isEmpty()) {
+        return true;
+    }
+
+    QByteArray value = aValue.toUtf8();
+
+    if (value.size() > CWatchServiceProtocol::MaxFieldSize) {
+        return false;
+    }
+
+    char header[CWatchServiceProtocol::FieldHeaderSize];
+    header[0] = static_cast<char>(aTag);
+    qToBigEndian<quint16>(static_cast<quint16>(value.size()), header + 1);
+
+    aBuffer.append(header, sizeof(header));
+    aBuffer.append(value);
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void appendPair(QByteArray &aBuffer, const QString &aKey, const QString &aValue) {
+    if (!aValue.isEmpty()) {
+        aBuffer.append(aKey.toLatin1());
+        aBuffer.append('=');
+        aBuffer.append(aValue.toUtf8());
+        aBuffer.append(';');
+    }
+}
+} // namespace
+
+//---------------------------------------------------------------------------
+QByteArray WatchServiceProtocol::encode(const SWatchServiceMessage &aMessage, EFormat aFormat) {
+    if (aFormat == Binary) {
+        QByteArray result = encodeBinary(aMessage);
+
+        if (!result.isEmpty()) {
+            return result;
+        }
+    }
+
+    return encodeText(aMessage);
+}
+
+//---------------------------------------------------------------------------
+bool WatchServiceProtocol::decode(const QByteArray &aData, SWatchServiceMessage &aMessage) {
+    aMessage = SWatchServiceMessage();
+
+    if (isBinary(aData)) {
+        return decodeBinary(aData, aMessage);
+    }
+
+    decodeText(aData, aMessage);
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool WatchServiceProtocol::isBinary(const QByteArray &aData) {
+    return !aData.isEmpty() && (aData.at(0) == CWatchServiceProtocol::Magic);
+}
+
+//---------------------------------------------------------------------------
+QByteArray WatchServiceProtocol::encodeText(const SWatchServiceMessage &aMessage) {
+    QByteArray result;
+
+    appendPair(result, CWatchService::Fields::Sender, aMessage.sender);
+    appendPair(result, CWatchService::Fields::Target, aMessage.target);
+    appendPair(result, CWatchService::Fields::Type, aMessage.type);
+    appendPair(result, CWatchService::Fields::Module, aMessage.module);
+    appendPair(result, CWatchService::Fields::Params, aMessage.params);
+
+    if (aMessage.protocol > 0) {
+        appendPair(result, CWatchService::Fields::Protocol, QString::number(aMessage.protocol));
+    }
+
+    foreach (const QString &item, aMessage.tail) {
+        result.append(item.toUtf8());
+        result.append(';');
+    }
+
+    return result;
+}
+
+//---------------------------------------------------------------------------
+QByteArray WatchServiceProtocol::encodeBinary(const SWatchServiceMessage &aMessage) {
+    int code = typeCode(aMessage.type);
+
+    QByteArray result;
+    result.reserve(64);
+    result.append(CWatchServiceProtocol::Magic);
+    result.append(static_cast<char>(CWatchServiceProtocol::Version));
+    result.append(static_cast<char>(code));
+
+    bool ok = appendField(result, CWatchServiceProtocol::Tags::Sender, aMessage.sender) &&
+              appendField(result, CWatchServiceProtocol::Tags::Target, aMessage.target) &&
+              appendField(result, CWatchServiceProtocol::Tags::Module, aMessage.module) &&
+              appendField(result, CWatchServiceProtocol::Tags::Params, aMessage.params);
+
+    if (code == CWatchServiceProtocol::Types::Custom) {
+        ok = ok && appendField(result, CWatchServiceProtocol::Tags::Type, aMessage.type);
+    }
+
+    foreach (const QString &item, aMessage.tail) {
+        ok = ok && appendField(result, CWatchServiceProtocol::Tags::Tail, item);
+    }
+
+    return ok ? result : QByteArray();
+}
+
+//---------------------------------------------------------------------------
+void WatchServiceProtocol::decodeText(const QByteArray &aData, SWatchServiceMessage &aMessage) {
+    const char *data = aData.constData();
+    int size = aData.size();
+    int begin = 0;
+
+    // Один проход по сообщению без промежуточного списка подстрок.
+    while (begin < size) {
+        int end = aData.indexOf(';', begin);
+        if (end < 0) {
+            end = size;
+        }
+
+        if (end > begin) {
+            const char *separator =
+                static_cast<const char *>(memchr(data + begin, '=', end - begin));
+
+            if (separator) {
+                QLatin1String key(data + begin, static_cast<int>(separator - data - begin));
+                QString value =
+                    QString::fromUtf8(separator + 1, static_cast<int>(data + end - separator - 1));
+
+                if (key == CWatchService::Fields::Sender) {
+                    aMessage.sender = value;
+                } else if (key == CWatchService::Fields::Type) {
+                    aMessage.type = value;
+                } else if (key == CWatchService::Fields::Target) {
+                    aMessage.target = value;
+                } else if (key == CWatchService::Fields::Module) {
+                    aMessage.module = value;
+                } else if (key == CWatchService::Fields::Params) {
+                    aMessage.params = value;
+                } else if (key == CWatchService::Fields::Protocol) {
+                    aMessage.protocol = value.toInt();
+                } else {
+                    aMessage.tail << QString::fromUtf8(data + begin, end - begin);
+                }
+            } else {
+                aMessage.tail << QString::fromUtf8(data + begin, end - begin);
+            }
+        }
+
+        begin = end + 1;
+    }
+}
+
+//---------------------------------------------------------------------------
+bool WatchServiceProtocol::decodeBinary(const QByteArray &aData, SWatchServiceMessage &aMessage) {
+    if (aData.size() < CWatchServiceProtocol::HeaderSize) {
+        return false;
+    }
+
+    const char *data = aData.constData();
+    int size = aData.size();
+    int code = static_cast<quint8>(data[2]);
+    int pos = CWatchServiceProtocol::HeaderSize;
+
+    while (pos < size) {
+        if (size - pos < CWatchServiceProtocol::FieldHeaderSize) {
+            return false;
+        }
+
+        int tag = static_cast<quint8>(data[pos]);
+        int length = qFromBigEndian<quint16>(data + pos + 1);
+        pos += CWatchServiceProtocol::FieldHeaderSize;
+
+        if (size - pos < length) {
+            return false;
+        }
+
+        QString value = QString::fromUtf8(data + pos, length);
+        pos += length;
+
+        switch (tag) {
+        case CWatchServiceProtocol::Tags::Sender:
+            aMessage.sender = value;
+            break;
+        case CWatchServiceProtocol::Tags::Target:
+            aMessage.target = value;
+            break;
+        case CWatchServiceProtocol::Tags::Module:
+            aMessage.module = value;
+            break;
+        case CWatchServiceProtocol::Tags::Params:
+            aMessage.params = value;
+            break;
+        case CWatchServiceProtocol::Tags::Type:
+            aMessage.type = value;
+            break;
+        case CWatchServiceProtocol::Tags::Tail:
+            aMessage.tail << value;
+            break;
+        default:
+            // Поле более новой версии схемы.
+            break;
+        }
+    }
+
+    if (code >= CWatchServiceProtocol::Types::Count) {
+        // Тип более новой версии схемы: поля прочитаны, но выполнять такое сообщение нечем.
+        aMessage.type.clear();
+        aMessage.unknownType = code;
+    } else if (code != CWatchServiceProtocol::Types::Custom) {
+        aMessage.type = typeName(code);
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
@@ -20,7 +20,7 @@ IWatchServiceClient *createWatchServiceClient(const QString &aClientName,
 
 //---------------------------------------------------------------------------
 WatchServiceClient::WatchServiceClient(QString aName, PingThread aThread)
-    : m_Name(std::move(aName)) {
+    : m_Name(std::move(aName)), m_BinaryProtocol(false) {
     qRegisterMetaType<WatchServiceClient::TMethod>("WatchServiceClient::TMethod");
 
     connect(this,
@@ -67,6 +67,9 @@ void WatchServiceClient::run() {
     m_Client->subscribeOnMessageReceived(this);
     m_Client->subscribeOnDisconnected(this);
 
+    // До подтверждения сервисом сообщения идут текстом.
+    m_BinaryProtocol = false;
+
     m_InitMutex.lock();
 
     if (m_Client->connect(CWatchService::MessageQueue)) {
@@ -106,21 +109,13 @@ bool WatchServiceClient::isConnected() const {
 
 //---------------------------------------------------------------------------
 void WatchServiceClient::execute(QString aCommand, QString aModule, QString aParams) {
-    QString command = QString::fromLatin1("%1=%2;").arg(CWatchService::Fields::Sender).arg(m_Name);
-
-    if (!aCommand.isEmpty()) {
-        command += QString::fromLatin1("%1=%2;").arg(CWatchService::Fields::Type).arg(aCommand);
-    }
-
-    if (!aModule.isEmpty()) {
-        command += QString::fromLatin1("%1=%2;").arg(CWatchService::Fields::Module).arg(aModule);
-    }
+    SWatchServiceMessage message;
+    message.sender = m_Name;
+    message.type = aCommand;
+    message.module = aModule;
+    message.params = aParams;
 
-    if (!aParams.isEmpty()) {
-        command += QString::fromLatin1("%1=%2;").arg(CWatchService::Fields::Params).arg(aParams);
-    }
-
-    emit invokeMethod([this, capture0 = command.toUtf8()] { sendMessage(capture0); });
+    emit invokeMethod([this, message] { sendMessage(message); });
 }
 
 //---------------------------------------------------------------------------
@@ -226,9 +221,20 @@ void WatchServiceClient::ping() {
 }
 
 //---------------------------------------------------------------------------
-void WatchServiceClient::sendMessage(const QByteArray &aMessage) {
-    if (m_Client) {
-        m_Client->sendMessage(aMessage);
+void WatchServiceClient::sendMessage(const SWatchServiceMessage &aMessage) {
+    if (!m_Client) {
+        return;
+    }
+
+    if (m_BinaryProtocol) {
+        m_Client->sendBinaryMessage(
+            WatchServiceProtocol::encode(aMessage, WatchServiceProtocol::Binary));
+    } else {
+        // Сервис новой версии ответит на поле protocol, старая версия его пропустит.
+        SWatchServiceMessage message(aMessage);
+        message.protocol = CWatchServiceProtocol::Version;
+
+        m_Client->sendMessage(WatchServiceProtocol::encode(message, WatchServiceProtocol::Text));
     }
 }
 
@@ -244,36 +250,48 @@ void WatchServiceClient::onPing() {
 
 //---------------------------------------------------------------------------
 void WatchServiceClient::onMessageReceived(QByteArray aMessage) {
-    QStringList params = QString::fromUtf8(aMessage.data(), aMessage.size()).split(";");
-    if (!params.isEmpty()) {
-        QString sender;
-        QString type;
-        QString target;
-        QStringList tail;
-
-        foreach (QString param, params) {
-            if (param.indexOf(CWatchService::Fields::Sender) != -1) {
-                sender = param.right(param.length() - param.indexOf("=") - 1);
-            } else if (param.indexOf(CWatchService::Fields::Type) != -1) {
-                type = param.right(param.length() - param.indexOf("=") - 1);
-            } else if (param.indexOf(CWatchService::Fields::Target) != -1) {
-                target = param.right(param.length() - param.indexOf("=") - 1);
-            } else {
-                tail.append(param);
+    SWatchServiceMessage message;
+
+    if (!WatchServiceProtocol::decode(aMessage, message)) {
+        return;
+    }
+
+    if (message.unknownType != 0) {
+        toLog(LogLevel::Debug,
+              QString("Skipping message of unknown type %1 from %2.")
+                  .arg(message.unknownType)
+                  .arg(message.sender));
+        return;
+    }
+
+    const QString &sender = message.sender;
+    const QString &type = message.type;
+    const QString &target = message.target;
+
+    if (target.isEmpty() || (target == m_Name)) {
+        if ((sender == CWatchService::Name) && (type == CWatchService::Commands::Close)) {
+            emit onCloseCommandReceived();
+        } else if ((sender == CWatchService::Name) &&
+                   (type == CWatchService::Commands::CloseLogs)) {
+            ILog::logRotateAll();
+        } else if ((sender == CWatchService::Name) &&
+                   (type == CWatchService::Commands::Protocol)) {
+            m_BinaryProtocol = message.params.toInt() >= 1;
+        } else if (type == CWatchService::Notification::ModuleClosed) {
+            emit onModuleClosed(sender);
+        } else {
+            // Подписчики получают модуль и параметры в хвосте, как и раньше.
+            QStringList tail;
+
+            if (!message.module.isEmpty()) {
+                tail << CWatchService::Fields::Module + "=" + message.module;
             }
-        }
 
-        if (target.isEmpty() || (target == m_Name)) {
-            if ((sender == CWatchService::Name) && (type == CWatchService::Commands::Close)) {
-                emit onCloseCommandReceived();
-            } else if ((sender == CWatchService::Name) &&
-                       (type == CWatchService::Commands::CloseLogs)) {
-                ILog::logRotateAll();
-            } else if (type == CWatchService::Notification::ModuleClosed) {
-                emit onModuleClosed(sender);
-            } else {
-                emit onCommandReceived(sender, target, type, tail);
+            if (!message.params.isEmpty()) {
+                tail << CWatchService::Fields::Params + "=" + message.params;
             }
+
+            emit onCommandReceived(sender, target, type, tail + message.tail);
         }
     }
 }
@@ -13,6 +13,7 @@
 
 #include <MessageQueue/IMessageQueueClient.h>
 #include <WatchServiceClient/IWatchServiceClient.h>
+#include <WatchServiceClient/Protocol.h>
 #include <boost/function.hpp>
 
 //---------------------------------------------------------------------------
@@ -97,7 +98,7 @@ private:
     typedef boost::function<void()> TMethod;
 
     // Отправка сообщения по транспортному каналу.
-    void sendMessage(const QByteArray &aMessage);
+    void sendMessage(const SWatchServiceMessage &aMessage);
 
 signals:
     /// Вызов указанного метода в своём потоке.
@@ -138,6 +139,9 @@ private:
 
     QString m_Name;
 
+    /// Сервис подтвердил поддержку двоичного протокола. Используется только в потоке клиента.
+    bool m_BinaryProtocol;
+
     QWaitCondition m_InitCondition;
     QMutex m_InitMutex;
 };
@@ -0,0 +1,49 @@
+/* @file Границы текущих суток для смены файлов лога. */
+
+#pragma once
+
+#include <QtCore/QDate>
+#include <QtCore/QDateTime>
+#include <QtCore/QString>
+#include <QtCore/QTimeZone>
+
+//---------------------------------------------------------------------------
+/// Хранит границы локальных суток в миллисекундах UTC. Проверка смены суток сводится к двум
+/// сравнениям целых чисел без форматирования даты. Выход за границы в любую сторону (полночь,
+/// перевод часов синхронизацией времени) означает, что файл лога нужно сменить. Длина суток
+/// при переходе на летнее/зимнее время учитывается часовым поясом.
+class DayRollover {
+public:
+    explicit DayRollover(const QTimeZone &aTimeZone = QTimeZone::systemTimeZone())
+        : m_TimeZone(aTimeZone), m_Begin(0), m_End(0) {}
+
+    /// Возвращает true, если момент aMSecs (UTC) лежит вне текущих суток.
+    bool isExpired(qint64 aMSecs) const { return aMSecs < m_Begin || aMSecs >= m_End; }
+
+    /// Пересчитывает границы суток, в которые попадает момент aMSecs (UTC).
+    void reset(qint64 aMSecs) {
+        m_Date = QDateTime::fromMSecsSinceEpoch(aMSecs, m_TimeZone).date();
+        m_DateString = m_Date.toString("yyyy.MM.dd");
+        m_Begin = m_Date.startOfDay(m_TimeZone).toMSecsSinceEpoch();
+        m_End = m_Date.addDays(1).startOfDay(m_TimeZone).toMSecsSinceEpoch();
+    }
+
+    /// Текущая дата.
+    const QDate &date() const { return m_Date; }
+
+    /// Текущая дата в формате имени файла лога.
+    const QString &dateString() const { return m_DateString; }
+
+    /// Начало и конец текущих суток, мс UTC.
+    qint64 begin() const { return m_Begin; }
+    qint64 end() const { return m_End; }
+
+private:
+    QTimeZone m_TimeZone;
+    QDate m_Date;
+    QString m_DateString;
+    qint64 m_Begin;
+    qint64 m_End;
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,116 @@
+/* @file Файл назначения лога. */
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDate>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QString>
+
+#include <Common/ILog.h>
+
+#include <cstdio>
+
+//---------------------------------------------------------------------------
+/// Файл, в который пишут один или несколько логов с одинаковым направлением.
+/// Запись производится через фоновый поток LogWriter, сам файл трогает только он
+/// (или вызывающий поток, если LogWriter уже остановлен).
+class DestinationFile : public QEnableSharedFromThis<DestinationFile> {
+    QFile m_File;
+    FILE *m_StdFile;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    QRecursiveMutex m_Mutex;
+#else
+    QMutex m_Mutex;
+#endif
+    QString m_FileName;
+    QDate m_Date;
+
+public:
+    /// Создавать только через DestinationFilePtr: запись в очередь использует sharedFromThis().
+    DestinationFile()
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+        : m_StdFile(nullptr), m_Mutex(QMutex::Recursive)
+#else
+        : m_StdFile(nullptr)
+#endif
+    {
+    }
+
+    ~DestinationFile() {
+        QMutexLocker locker(&m_Mutex);
+
+        m_File.close();
+
+        if (m_StdFile) {
+            fclose(m_StdFile);
+            m_StdFile = nullptr;
+        }
+    }
+
+    bool open(const QString &aLogPath, const QDate &aDate = QDate()) {
+        QMutexLocker locker(&m_Mutex);
+
+        m_File.close();
+
+        if (m_StdFile) {
+            fflush(m_StdFile);
+            fclose(m_StdFile);
+        }
+
+// Cross-platform file open
+#ifdef Q_OS_WIN
+        m_StdFile = _fsopen(aLogPath.toLocal8Bit().constData(), "ab+", _SH_DENYNO);
+#else
+        m_StdFile = fopen(aLogPath.toLocal8Bit().constData(), "ab+");
+#endif
+
+        bool isOK = m_StdFile && m_File.open(m_StdFile, QIODevice::Append | QIODevice::Text);
+
+        m_FileName = isOK ? aLogPath : "";
+        m_Date = aDate;
+
+        return isOK;
+    }
+
+    bool isOpen() const { return m_File.isOpen(); }
+
+    QString fileName() const { return m_FileName; }
+
+    /// Дата, за которую ведётся файл.
+    QDate date() const { return m_Date; }
+
+    /// Ставит сообщение в очередь фонового писателя. Уровень определяет срочность сброса на диск.
+    void write(const QString &aMessage, LogLevel::Enum aLevel = LogLevel::Normal);
+
+    /// Синхронно пишет готовый буфер в файл. При aFlush сбрасывает буферы на диск.
+    void writeRaw(const QByteArray &aData, bool aFlush) {
+        QMutexLocker locker(&m_Mutex);
+
+        if (!m_File.isOpen()) {
+            return;
+        }
+
+        m_File.write(aData);
+
+        if (aFlush) {
+            m_File.flush();
+        }
+    }
+
+    /// Сбрасывает буферы файла на диск.
+    void flush() {
+        QMutexLocker locker(&m_Mutex);
+
+        if (m_File.isOpen()) {
+            m_File.flush();
+        }
+    }
+};
+
+//---------------------------------------------------------------------------
+typedef QSharedPointer<DestinationFile> DestinationFilePtr;
+
+//---------------------------------------------------------------------------
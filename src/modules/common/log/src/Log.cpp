@@ -32,3 +32,13 @@ void ILog::setGlobalLevel(LogLevel::Enum aMaxLogLevel) {
 }
 
 //---------------------------------------------------------------------------
+void ILog::setLevelOverride(const QString &aName, LogLevel::Enum aLevel) {
+    gLogManager.setLevelOverride(aName, aLevel);
+}
+
+//---------------------------------------------------------------------------
+void ILog::clearLevelOverride(const QString &aName) {
+    gLogManager.clearLevelOverride(aName);
+}
+
+//---------------------------------------------------------------------------
@@ -2,6 +2,7 @@
 
 #include "LogManager.h"
 
+#include "LogWriter.h"
 #include "SimpleLog.h"
 
 LogManager gLogManager;
@@ -22,6 +23,9 @@ LogManager::~LogManager() {
 
         log.reset();
     }
+
+    // Дописываем очередь фонового писателя, дальнейшие записи пойдут синхронно.
+    LogWriter::instance()->shutdown();
 }
 
 //---------------------------------------------------------------------------
@@ -34,7 +38,7 @@ ILog *LogManager::getLog(const QString &aName, LogType::Enum aType) {
         return m_Logs.value(name).get();
     }
 
-    std::shared_ptr<ILog> newlog(new SimpleLog(aName, aType, m_MaxLogLevel));
+    std::shared_ptr<ILog> newlog(new SimpleLog(aName, aType, effectiveLevel(aName)));
     m_Logs.insert(name, newlog);
 
     return newlog.get();
@@ -51,7 +55,48 @@ void LogManager::logRotateAll() {
 
 //---------------------------------------------------------------------------
 void LogManager::setGlobalLevel(LogLevel::Enum aMaxLogLevel) {
+    QMutexLocker lock(&m_Mutex);
+
     m_MaxLogLevel = aMaxLogLevel;
+
+    foreach (auto log, m_Logs.values()) {
+        if (!m_LevelOverrides.contains(log->getName())) {
+            log->setLevel(aMaxLogLevel);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+void LogManager::setLevelOverride(const QString &aName, LogLevel::Enum aLevel) {
+    QMutexLocker lock(&m_Mutex);
+
+    m_LevelOverrides.insert(aName, aLevel);
+
+    foreach (auto log, m_Logs.values()) {
+        if (log->getName() == aName) {
+            log->setLevel(aLevel);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+void LogManager::clearLevelOverride(const QString &aName) {
+    QMutexLocker lock(&m_Mutex);
+
+    if (!m_LevelOverrides.remove(aName)) {
+        return;
+    }
+
+    foreach (auto log, m_Logs.values()) {
+        if (log->getName() == aName) {
+            log->setLevel(m_MaxLogLevel);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+LogLevel::Enum LogManager::effectiveLevel(const QString &aName) const {
+    return m_LevelOverrides.value(aName, m_MaxLogLevel);
 }
 
 //---------------------------------------------------------------------------
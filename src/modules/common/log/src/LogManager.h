@@ -22,13 +22,24 @@ public:
     /// сутки
     virtual void logRotateAll();
 
-    /// Установить уровень логирования для всех логов
+    /// Установить уровень логирования для всех логов без персонального уровня
     virtual void setGlobalLevel(LogLevel::Enum aMaxLogLevel);
 
+    /// Установить персональный уровень логирования для логов с заданным именем
+    virtual void setLevelOverride(const QString &aName, LogLevel::Enum aLevel);
+
+    /// Снять персональный уровень логирования
+    virtual void clearLevelOverride(const QString &aName);
+
+protected:
+    /// Уровень, который должен действовать для лога с заданным именем.
+    LogLevel::Enum effectiveLevel(const QString &aName) const;
+
 protected:
     QMap<QString, std::shared_ptr<ILog>> m_Logs;
     QMutex m_Mutex;
     LogLevel::Enum m_MaxLogLevel;
+    QMap<QString, LogLevel::Enum> m_LevelOverrides;
 };
 
 //---------------------------------------------------------------------------
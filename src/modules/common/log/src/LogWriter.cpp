@@ -0,0 +1,249 @@
+/* @file Фоновый поток записи логов в файлы. */
+
+#include <QtCore/QElapsedTimer>
+
+#include "LogWriter.h"
+
+//---------------------------------------------------------------------------
+void DestinationFile::write(const QString &aMessage, LogLevel::Enum aLevel) {
+    LogWriter::instance()->enqueue(sharedFromThis(), aMessage.toUtf8(), aLevel);
+}
+
+//---------------------------------------------------------------------------
+LogWriter *LogWriter::instance() {
+    // Намеренно не удаляется: логи пишутся и во время разрушения статических объектов.
+    // Поток останавливается явно через shutdown(), после чего запись идёт синхронно.
+    static LogWriter *writer = new LogWriter();
+
+    return writer;
+}
+
+//---------------------------------------------------------------------------
+LogWriter::LogWriter()
+    : m_PendingBytes(0), m_EnqueuedSeq(0), m_FlushedSeq(0), m_FlushRequestSeq(0),
+      m_FlushInterval(CLogWriter::FlushInterval), m_Started(false), m_Stopping(false),
+      m_Stopped(false) {
+}
+
+//---------------------------------------------------------------------------
+LogWriter::~LogWriter() {
+    shutdown();
+}
+
+//---------------------------------------------------------------------------
+void LogWriter::enqueue(const DestinationFilePtr &aFile,
+                        const QByteArray &aData,
+                        LogLevel::Enum aLevel) {
+    QMutexLocker locker(&m_Mutex);
+
+    if (m_Stopped) {
+        locker.unlock();
+        aFile->writeRaw(aData, true);
+
+        return;
+    }
+
+    if (!m_Started) {
+        m_Started = true;
+        start(QThread::LowPriority);
+    }
+
+    // Защита от неограниченного роста очереди, если диск не успевает.
+    while (m_PendingBytes > CLogWriter::MaxPendingBytes && !m_Stopped) {
+        m_Written.wait(&m_Mutex);
+    }
+
+    SRecord record;
+    record.file = aFile;
+    record.data = aData;
+
+    m_Queue.append(record);
+    m_PendingBytes += aData.size();
+    quint64 seq = ++m_EnqueuedSeq;
+
+    bool urgent = (aLevel == LogLevel::Fatal) || (aLevel == LogLevel::Error);
+
+    if (urgent) {
+        m_FlushRequestSeq = seq;
+    }
+
+    if (urgent || m_Queue.size() == 1 || m_PendingBytes >= CLogWriter::WakeUpBytes) {
+        m_HasWork.wakeOne();
+    }
+
+    // Перед аварийным завершением запись должна оказаться на диске.
+    if (aLevel == LogLevel::Fatal) {
+        while (m_FlushedSeq < seq && !m_Stopped) {
+            m_Written.wait(&m_Mutex);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+void LogWriter::flush() {
+    QMutexLocker locker(&m_Mutex);
+
+    if (!m_Started || m_Stopped) {
+        return;
+    }
+
+    quint64 target = m_EnqueuedSeq;
+
+    if (m_FlushRequestSeq < target) {
+        m_FlushRequestSeq = target;
+    }
+
+    m_HasWork.wakeOne();
+
+    while (m_FlushedSeq < target && !m_Stopped) {
+        m_Written.wait(&m_Mutex);
+    }
+}
+
+//---------------------------------------------------------------------------
+void LogWriter::shutdown() {
+    {
+        QMutexLocker locker(&m_Mutex);
+
+        if (!m_Started) {
+            m_Stopped = true;
+            return;
+        }
+
+        m_Stopping = true;
+        m_HasWork.wakeOne();
+    }
+
+    wait();
+}
+
+//---------------------------------------------------------------------------
+void LogWriter::setFlushInterval(int aMsec) {
+    QMutexLocker locker(&m_Mutex);
+
+    m_FlushInterval = qMax(1, aMsec);
+    m_HasWork.wakeOne();
+}
+
+//---------------------------------------------------------------------------
+void LogWriter::run() {
+    QElapsedTimer clock;
+    clock.start();
+
+    // Момент, не позже которого записанные данные должны быть сброшены на диск (-1 - нечего
+    // сбрасывать).
+    qint64 deadline = -1;
+    QVector<SRecord> batch;
+
+    QMutexLocker locker(&m_Mutex);
+
+    forever {
+        // Копим записи до срочного запроса, заполнения буфера или истечения интервала.
+        while (!m_Stopping && m_FlushRequestSeq <= m_FlushedSeq &&
+               m_PendingBytes < CLogWriter::WakeUpBytes) {
+            if (deadline < 0) {
+                if (m_Queue.isEmpty()) {
+                    m_HasWork.wait(&m_Mutex);
+                    continue;
+                }
+
+                deadline = clock.elapsed() + m_FlushInterval;
+            }
+
+            qint64 remaining = deadline - clock.elapsed();
+
+            if (remaining <= 0) {
+                break;
+            }
+
+            m_HasWork.wait(&m_Mutex, static_cast<unsigned long>(remaining));
+        }
+
+        batch.swap(m_Queue);
+        m_PendingBytes = 0;
+
+        quint64 seq = m_EnqueuedSeq;
+        bool stopping = m_Stopping;
+        bool flushNow = stopping || (m_FlushRequestSeq > m_FlushedSeq) ||
+                        (deadline >= 0 && clock.elapsed() >= deadline);
+
+        // Очередь освободилась - отпускаем ожидающих места писателей.
+        m_Written.wakeAll();
+        locker.unlock();
+
+        writeBatch(batch);
+
+        if (flushNow) {
+            flushFiles();
+            deadline = -1;
+        } else if (deadline < 0 && !batch.isEmpty()) {
+            deadline = clock.elapsed() + m_FlushInterval;
+        }
+
+        batch.clear();
+
+        locker.relock();
+
+        if (flushNow) {
+            m_FlushedSeq = seq;
+            m_Written.wakeAll();
+        }
+
+        if (stopping && m_Queue.isEmpty()) {
+            m_Stopped = true;
+            m_Written.wakeAll();
+            break;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+void LogWriter::writeBatch(const QVector<SRecord> &aBatch) {
+    int i = 0;
+
+    while (i < aBatch.size()) {
+        const DestinationFilePtr &file = aBatch[i].file;
+
+        int end = i + 1;
+
+        while (end < aBatch.size() && aBatch[end].file == file) {
+            ++end;
+        }
+
+        if (end - i == 1) {
+            file->writeRaw(aBatch[i].data, false);
+        } else {
+            int size = 0;
+
+            for (int j = i; j < end; ++j) {
+                size += aBatch[j].data.size();
+            }
+
+            QByteArray chunk;
+            chunk.reserve(size);
+
+            for (int j = i; j < end; ++j) {
+                chunk.append(aBatch[j].data);
+            }
+
+            file->writeRaw(chunk, false);
+        }
+
+        if (!m_DirtyFiles.contains(file)) {
+            m_DirtyFiles.append(file);
+        }
+
+        i = end;
+    }
+}
+
+//---------------------------------------------------------------------------
+void LogWriter::flushFiles() {
+    foreach (const DestinationFilePtr &file, m_DirtyFiles) {
+        file->flush();
+    }
+
+    m_DirtyFiles.clear();
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,89 @@
+/* @file Фоновый поток записи логов в файлы. */
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
+
+#include <Common/ILog.h>
+
+#include "DestinationFile.h"
+
+//---------------------------------------------------------------------------
+namespace CLogWriter {
+/// Максимальный интервал между сбросами файлов на диск, мс.
+const int FlushInterval = 200;
+
+/// Объём очереди, при превышении которого писатели ждут её разбора, байт.
+const int MaxPendingBytes = 8 * 1024 * 1024;
+
+/// Объём очереди, при котором писатель просыпается не дожидаясь таймаута, байт.
+const int WakeUpBytes = 64 * 1024;
+} // namespace CLogWriter
+
+//---------------------------------------------------------------------------
+/// Единый фоновый поток записи логов. Логи ставят в очередь уже отформатированные строки,
+/// поток объединяет подряд идущие записи одного файла в один буфер и пишет его одним вызовом.
+/// Сброс на диск - не реже FlushInterval, немедленно для Error/Fatal и при остановке.
+class LogWriter : public QThread {
+public:
+    /// Возвращает экземпляр писателя (поток запускается при первой записи).
+    static LogWriter *instance();
+
+    /// Ставит запись в очередь. Для Fatal дожидается фактической записи на диск.
+    void enqueue(const DestinationFilePtr &aFile, const QByteArray &aData, LogLevel::Enum aLevel);
+
+    /// Дожидается записи и сброса на диск всего, что было поставлено в очередь до вызова.
+    void flush();
+
+    /// Записывает очередь и останавливает поток. Последующие записи выполняются синхронно.
+    void shutdown();
+
+    /// Устанавливает максимальный интервал между сбросами файлов на диск.
+    void setFlushInterval(int aMsec);
+
+protected:
+    virtual void run();
+
+private:
+    LogWriter();
+    virtual ~LogWriter();
+
+    struct SRecord {
+        DestinationFilePtr file;
+        QByteArray data;
+    };
+
+    /// Пишет пачку записей, склеивая соседние записи одного файла.
+    void writeBatch(const QVector<SRecord> &aBatch);
+
+    /// Сбрасывает на диск все файлы, в которые писали после предыдущего сброса.
+    void flushFiles();
+
+private:
+    QMutex m_Mutex;
+    QWaitCondition m_HasWork;
+    QWaitCondition m_Written;
+
+    QVector<SRecord> m_Queue;
+    int m_PendingBytes;
+
+    /// Номер последней поставленной в очередь записи и последней записи, сброшенной на диск.
+    quint64 m_EnqueuedSeq;
+    quint64 m_FlushedSeq;
+    /// Номер записи, после которой требуется немедленный сброс на диск.
+    quint64 m_FlushRequestSeq;
+
+    int m_FlushInterval;
+    bool m_Started;
+    bool m_Stopping;
+    bool m_Stopped;
+
+    /// Файлы с несброшенными данными. Используется только потоком писателя.
+    QVector<DestinationFilePtr> m_DirtyFiles;
+};
+
+//---------------------------------------------------------------------------
@@ -30,6 +30,135 @@
 
 #include "SimpleLog.h"
 
+//---------------------------------------------------------------------------
+namespace {
+/// Определяет рабочий каталог приложения по ini-файлу рядом с исполняемым файлом.
+QString resolveWorkingDirectory() {
+    QString workingDirectory;
+
+#ifdef Q_OS_WIN
+    TCHAR szPath[MAX_PATH] = {0};
+
+    if (GetModuleFileName(0, szPath, MAX_PATH)) {
+        QFileInfo info(QDir::toNativeSeparators(
+            QString::from_WCharArray(reinterpret_cast<const wchar_t *>(szPath))));
+        QString settingsFilePath = QDir::toNativeSeparators(info.absolutePath() + "/" +
+                                                            info.completeBaseName() + ".ini");
+        QSettings m_Settings(ISysUtils::rm_BOM(settingsFilePath), QSettings::IniFormat);
+        m_Settings.setIniCodec("UTF-8");
+
+        if (m_Settings.contains("common/working_directory")) {
+            QString directory = m_Settings.value("common/working_directory").toString();
+            workingDirectory = QDir::toNativeSeparators(QDir::cleanPath(
+                (QDir::isAbsolutePath(directory) ? "" : (info.absolutePath() + "/")) +
+                directory));
+        } else {
+            workingDirectory = info.absolutePath();
+        }
+    }
+#else
+    // Unix implementation (Linux/macOS)
+    {
+        // Get the executable path using /proc/self/exe (Linux) or _NSGetExecutablePath
+        // (macOS)
+        QString exePath;
+#ifdef __linux__
+        char buf[PATH_MAX];
+        ssize_t len = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+        if (len != -1) {
+            buf[len] = '\0';
+            exePath = QString::fromLocal8Bit(buf);
+        }
+#elif defined(__APPLE__)
+        char buf[PATH_MAX];
+        uint32_t size = sizeof(buf);
+        if (_NSGetExecutablePath(buf, &size) == 0) {
+            char resolved[PATH_MAX];
+            if (realpath(buf, resolved) != nullptr) {
+                exePath = QString::fromLocal8Bit(resolved);
+            } else {
+                exePath = QString::fromLocal8Bit(buf);
+            }
+        }
+#endif
+        if (exePath.isEmpty()) {
+            // Fallback: use current working directory + argv[0] from QCoreApplication
+            // This might not work if QApplication isn't created yet
+            exePath = QDir::currentPath() + "/tray"; // fallback
+        }
+
+        QFileInfo exeInfo(exePath);
+        QString iniDirPath = exeInfo.absolutePath();
+
+        // For macOS app bundles, the .ini file is in the directory containing the .app
+        // bundle, not inside the bundle itself
+#ifdef __APPLE__
+        if (exePath.contains(".app/Contents/MacOS/")) {
+            // Go up three levels: from Contents/MacOS/ to the directory containing the .app
+            QDir bundleDir(exeInfo.absolutePath()); // Contents/MacOS
+            bundleDir.cdUp();                       // Contents
+            bundleDir.cdUp();                       // .app bundle
+            bundleDir.cdUp();                       // directory containing .app
+            iniDirPath = bundleDir.absolutePath();
+        }
+#endif
+
+        QString settingsFilePath =
+            QDir::toNativeSeparators(iniDirPath + "/" + exeInfo.completeBaseName() + ".ini");
+        QSettings mSettings(ISysUtils::rm_BOM(settingsFilePath), QSettings::IniFormat);
+
+        if (mSettings.contains("common/working_directory")) {
+            QString directory = mSettings.value("common/working_directory").toString();
+            if (QDir::isAbsolutePath(directory)) {
+                workingDirectory = QDir::toNativeSeparators(QDir::cleanPath(directory));
+            } else {
+                workingDirectory =
+                    QDir::toNativeSeparators(QDir::cleanPath(iniDirPath + "/" + directory));
+            }
+        } else {
+            workingDirectory = iniDirPath; // File and console use same directory
+        }
+    }
+#endif
+
+    return workingDirectory;
+}
+
+//---------------------------------------------------------------------------
+QMutex &logDirectoryMutex() {
+    static QMutex mutex;
+
+    return mutex;
+}
+
+//---------------------------------------------------------------------------
+QString &logDirectoryCache() {
+    static QString directory;
+
+    return directory;
+}
+} // namespace
+
+//---------------------------------------------------------------------------
+QString SimpleLog::getLogDirectory() {
+    QMutexLocker locker(&logDirectoryMutex());
+    QString &directory = logDirectoryCache();
+
+    // ini-файл читается один раз, а не при каждом открытии файла лога.
+    if (directory.isEmpty()) {
+        directory = resolveWorkingDirectory() + "/logs";
+    }
+
+    return directory;
+}
+
+//---------------------------------------------------------------------------
+void SimpleLog::setLogDirectory(const QString &aDirectory) {
+    QMutexLocker locker(&logDirectoryMutex());
+
+    logDirectoryCache() = aDirectory;
+}
+
 //---------------------------------------------------------------------------
 SimpleLog::SimpleLog(const QString &aName, LogType::Enum aType, LogLevel::Enum aMaxLogLevel)
     : m_InitOk(false), m_MaxLogLevel(aMaxLogLevel), m_Name(aName), m_Destination(aName),
@@ -100,7 +229,12 @@ LogType::Enum SimpleLog::getType() const {
 
 //---------------------------------------------------------------------------
 void SimpleLog::setLevel(LogLevel::Enum aLevel) {
-    m_MaxLogLevel = aLevel;
+    m_MaxLogLevel.storeRelaxed(aLevel);
+}
+
+//---------------------------------------------------------------------------
+bool SimpleLog::isEnabled(LogLevel::Enum aLevel) const {
+    return aLevel <= m_MaxLogLevel.loadRelaxed();
 }
 
 //---------------------------------------------------------------------------
@@ -154,11 +288,12 @@ void SimpleLog::flushDuplicateCounter() {
 
 //---------------------------------------------------------------------------
 void SimpleLog::write(LogLevel::Enum aLevel, const QString &aMessage) {
-    if (!isInitiated() && !init()) {
+    // Уровень проверяем первым: это дешевле проверки смены суток и инициализации.
+    if (!isEnabled(aLevel)) {
         return;
     }
 
-    if (aLevel > m_MaxLogLevel) {
+    if (!isInitiated() && !init()) {
         return;
     }
 
@@ -167,6 +302,10 @@ void SimpleLog::write(LogLevel::Enum aLevel, const QString &aMessage) {
 
 //---------------------------------------------------------------------------
 void SimpleLog::write(LogLevel::Enum aLevel, const QString &aMessage, const QByteArray &aData) {
+    if (!isEnabled(aLevel)) {
+        return;
+    }
+
     write(aLevel, aMessage + aData.toHex().data());
 }
 
@@ -193,6 +332,13 @@ bool SimpleLog::init() {
     case LogType::File: {
         QMutexLocker locker(&fileListMutex);
 
+        // Границы суток пересчитываются только при выходе за них (полночь или перевод часов).
+        qint64 now = currentMSecs();
+
+        if (m_Rollover.isExpired(now)) {
+            m_Rollover.reset(now);
+        }
+
         if (fileList.contains(m_Destination)) {
             m_CurrentFile = fileList[m_Destination];
 
@@ -203,101 +349,14 @@ bool SimpleLog::init() {
             }
 
             // Тут происходит смена даты файла при смене суток.
-            if (m_CurrentFile->fileName().contains(QDate::currentDate().toString("yyyy.MM.dd"))) {
+            if (m_CurrentFile->date() == m_Rollover.date()) {
                 break;
             }
             fileList.remove(m_Destination);
             return init();
         }
-        QString logPath;
-        QString workingDirectory;
-
-#ifdef Q_OS_WIN
-        TCHAR szPath[MAX_PATH] = {0};
-
-        if (GetModuleFileName(0, szPath, MAX_PATH)) {
-            QFileInfo info(QDir::toNativeSeparators(
-                QString::from_WCharArray(reinterpret_cast<const wchar_t *>(szPath))));
-            QString settingsFilePath = QDir::toNativeSeparators(info.absolutePath() + "/" +
-                                                                info.completeBaseName() + ".ini");
-            QSettings m_Settings(ISysUtils::rm_BOM(settingsFilePath), QSettings::IniFormat);
-            m_Settings.setIniCodec("UTF-8");
-
-            if (m_Settings.contains("common/working_directory")) {
-                QString directory = m_Settings.value("common/working_directory").toString();
-                workingDirectory = QDir::toNativeSeparators(QDir::cleanPath(
-                    (QDir::isAbsolutePath(directory) ? "" : (info.absolutePath() + "/")) +
-                    directory));
-            } else {
-                workingDirectory = info.absolutePath();
-            }
-        }
-#else
-        // Unix implementation (Linux/macOS)
-        {
-            // Get the executable path using /proc/self/exe (Linux) or _NSGetExecutablePath
-            // (macOS)
-            QString exePath;
-#ifdef __linux__
-            char buf[PATH_MAX];
-            ssize_t len = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
-            if (len != -1) {
-                buf[len] = '\0';
-                exePath = QString::fromLocal8Bit(buf);
-            }
-#elif defined(__APPLE__)
-            char buf[PATH_MAX];
-            uint32_t size = sizeof(buf);
-            if (_NSGetExecutablePath(buf, &size) == 0) {
-                char resolved[PATH_MAX];
-                if (realpath(buf, resolved) != nullptr) {
-                    exePath = QString::fromLocal8Bit(resolved);
-                } else {
-                    exePath = QString::fromLocal8Bit(buf);
-                }
-            }
-#endif
-            if (exePath.isEmpty()) {
-                // Fallback: use current working directory + argv[0] from QCoreApplication
-                // This might not work if QApplication isn't created yet
-                exePath = QDir::currentPath() + "/tray"; // fallback
-            }
-
-            QFileInfo exeInfo(exePath);
-            QString iniDirPath = exeInfo.absolutePath();
-
-            // For macOS app bundles, the .ini file is in the directory containing the .app
-            // bundle, not inside the bundle itself
-#ifdef __APPLE__
-            if (exePath.contains(".app/Contents/MacOS/")) {
-                // Go up three levels: from Contents/MacOS/ to the directory containing the .app
-                QDir bundleDir(exeInfo.absolutePath()); // Contents/MacOS
-                bundleDir.cdUp();                       // Contents
-                bundleDir.cdUp();                       // .app bundle
-                bundleDir.cdUp();                       // directory containing .app
-                iniDirPath = bundleDir.absolutePath();
-            }
-#endif
-
-            QString settingsFilePath =
-                QDir::toNativeSeparators(iniDirPath + "/" + exeInfo.completeBaseName() + ".ini");
-            QSettings mSettings(ISysUtils::rm_BOM(settingsFilePath), QSettings::IniFormat);
-
-            if (mSettings.contains("common/working_directory")) {
-                QString directory = mSettings.value("common/working_directory").toString();
-                if (QDir::isAbsolutePath(directory)) {
-                    workingDirectory = QDir::toNativeSeparators(QDir::cleanPath(directory));
-                } else {
-                    workingDirectory =
-                        QDir::toNativeSeparators(QDir::cleanPath(iniDirPath + "/" + directory));
-                }
-            } else {
-                workingDirectory = iniDirPath; // File and console use same directory
-            }
-        }
-#endif
-        logPath = workingDirectory + "/logs/" + QDate::currentDate().toString("yyyy.MM.dd ") +
-                  m_Destination + ".log";
+        QString logPath =
+            getLogDirectory() + "/" + m_Rollover.dateString() + " " + m_Destination + ".log";
 
         QFileInfo logPathInfo(logPath);
 
@@ -311,7 +370,7 @@ bool SimpleLog::init() {
 
         m_CurrentFile = DestinationFilePtr(new DestinationFile());
 
-        if (!m_CurrentFile->open(logPath)) {
+        if (!m_CurrentFile->open(logPath, m_Rollover.date())) {
             return false;
         }
 
@@ -340,15 +399,19 @@ bool SimpleLog::init() {
 
 //---------------------------------------------------------------------------
 bool SimpleLog::isInitiated() {
-    // Тут проверяем сменился ли день
-    if (m_Type == LogType::File && m_CurrentFile &&
-        !m_CurrentFile->fileName().contains(QDate::currentDate().toString("yyyy.MM.dd"))) {
+    // Тут проверяем сменился ли день: два сравнения с заранее вычисленными границами суток.
+    if (m_Type == LogType::File && m_CurrentFile && m_Rollover.isExpired(currentMSecs())) {
         return false;
     }
 
     return m_InitOk;
 }
 
+//---------------------------------------------------------------------------
+qint64 SimpleLog::currentMSecs() const {
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
 //---------------------------------------------------------------------------
 void SimpleLog::writeHeader() {
     write(LogLevel::Normal,
@@ -447,7 +510,7 @@ void SimpleLog::safeWrite(LogLevel::Enum aLevel, const QString &aMessage) {
 
     switch (m_Type) {
     case LogType::File:
-        m_CurrentFile->write(formattedMessage);
+        m_CurrentFile->write(formattedMessage, aLevel);
         break;
 
     case LogType::Debug:
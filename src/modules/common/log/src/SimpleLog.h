@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDateTime>
 #include <QtCore/QDir>
@@ -11,80 +12,13 @@
 #include <QtCore/QMutex>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QString>
-#include <QtCore/QTextStream>
 
 #include <Common/ILog.h>
 
+#include "DayRollover.h"
+#include "DestinationFile.h"
 #include "LogManager.h"
 
-//---------------------------------------------------------------------------
-class SimpleLog;
-
-//---------------------------------------------------------------------------
-class DestinationFile {
-    QFile m_File;
-    FILE *m_StdFile;
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-    QRecursiveMutex m_Mutex;
-#else
-    QMutex m_Mutex;
-#endif
-    QTextStream m_LogStream;
-    QString m_FileName;
-
-protected:
-    DestinationFile()
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-        : m_StdFile(nullptr), m_Mutex(QMutex::Recursive), m_LogStream(&m_File)
-#else
-        : m_StdFile(nullptr), m_LogStream(&m_File)
-#endif
-    {
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-        m_LogStream.setCodec("utf-8");
-#endif
-    }
-
-    friend class SimpleLog;
-
-public:
-    bool open(const QString &aLogPath) {
-        m_File.close();
-
-        if (m_StdFile) {
-            fflush(m_StdFile);
-            fclose(m_StdFile);
-        }
-
-// Cross-platform file open
-#ifdef Q_OS_WIN
-        m_StdFile = _fsopen(aLogPath.toLocal8Bit().constData(), "ab+", _SH_DENYNO);
-#else
-        m_StdFile = fopen(aLogPath.toLocal8Bit().constData(), "ab+");
-#endif
-
-        bool isOK = m_StdFile && m_File.open(m_StdFile, QIODevice::Append | QIODevice::Text);
-
-        m_FileName = isOK ? aLogPath : "";
-
-        return isOK;
-    }
-
-    bool isOpen() const { return m_File.isOpen(); }
-
-    QString fileName() const { return m_FileName; }
-
-    void write(const QString &aMessage) {
-        QMutexLocker locker(&m_Mutex);
-
-        m_LogStream << aMessage;
-        m_LogStream.flush();
-    }
-};
-
-//---------------------------------------------------------------------------
-typedef QSharedPointer<DestinationFile> DestinationFilePtr;
-
 //---------------------------------------------------------------------------
 class SimpleLog : public ILog {
 public:
@@ -110,6 +44,9 @@ public:
     /// игнорируется.
     virtual void setLevel(LogLevel::Enum aLevel);
 
+    /// Возвращает true, если сообщение уровня aLevel будет записано.
+    virtual bool isEnabled(LogLevel::Enum aLevel) const;
+
     /// Устанавливает уровень отступа для древовидных логов.
     virtual void adjustPadding(int aStep);
 
@@ -122,17 +59,27 @@ public:
     /// Принудительно закрыть журнал. Функция write заново его откроет.
     virtual void logRotate();
 
+    /// Каталог файлов логов. Определяется по ini-файлу приложения один раз за время работы.
+    static QString getLogDirectory();
+
+    /// Переопределяет каталог файлов логов.
+    static void setLogDirectory(const QString &aDirectory);
+
 protected:
     virtual bool init();
     virtual bool isInitiated();
     virtual void safeWrite(LogLevel::Enum aLevel, const QString &aMessage);
 
+    /// Текущее время, мс UTC. Определяет дату файла лога.
+    virtual qint64 currentMSecs() const;
+
 private:
     virtual void writeHeader();
 
 private:
     bool m_InitOk;
-    LogLevel::Enum m_MaxLogLevel;
+    /// Уровень меняется из других потоков (LogManager), читается на каждой записи.
+    QAtomicInt m_MaxLogLevel;
 
     QString m_Name;
     QString m_Destination;
@@ -155,6 +102,9 @@ private:
     void flushDuplicateCounter();
 
     DestinationFilePtr m_CurrentFile;
+
+    /// Границы суток текущего файла лога.
+    DayRollover m_Rollover;
 };
 
 //---------------------------------------------------------------------------
@@ -0,0 +1,377 @@
+/* @file Проверки и замеры счётчиков купюр баланса. */
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QScopedPointer>
+#include <QtTest/QtTest>
+
+#include <DatabaseProxy/DatabaseTransaction.h>
+#include <DatabaseProxy/IDatabaseProxy.h>
+#include <DatabaseProxy/IDatabaseQuery.h>
+
+#include "../../common/DatabaseFixture.h"
+#include "DatabaseUtils/BalanceCounters.h"
+
+namespace PPSDK = SDK::PaymentProcessor;
+
+//---------------------------------------------------------------------------
+class TestBalanceCounters : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    // Корректность
+    void testMigrationFillsCounters();
+    void testAddMatchesNotes();
+    void testRollbackKeepsCounters();
+    void testSelfCheckFindsDrift();
+    void testStaleMarkSurvivesRestart();
+    void testResetOnEncashment();
+
+    // Замеры
+    void benchmarkBalance();
+
+private:
+    bool execute(const QString &aQuery);
+
+    /// Добавляет купюру так же, как addPaymentNote/addChangeNote: в одной транзакции со счётчиком.
+    bool addNote(BalanceCounters &aCounters,
+                 BalanceCounters::EKind aKind,
+                 const PPSDK::SNote &aNote,
+                 qint64 aPayment);
+
+    /// Добавляет aCount инкассированных купюр одной транзакцией.
+    bool seedHistory(int aCount);
+
+    /// Сверяет счётчики с подсчётом по купюрам.
+    void verifyMatches(BalanceCounters &aCounters, BalanceCounters::EKind aKind);
+
+    /// Выполняет инкассацию: отмечает купюры и обнуляет счётчики.
+    bool encash(BalanceCounters &aCounters);
+
+    DatabaseFixture *m_Fixture = nullptr;
+    IDatabaseProxy *m_Database = nullptr;
+    qint64 m_NextPayment = 1;
+};
+
+namespace {
+const int IntervalNotes = 2000;
+const int BalanceReads = 20;
+
+const double Nominals[] = {10, 50, 100, 500, 1000, 5000};
+
+const char InsertAccepted[] =
+    "INSERT INTO `payment_note` (`nominal`, `date`, `ejection`, `type`, `serial`, `currency`, "
+    "`fk_payment_id`) VALUES (:amount, :date, :ejection, :type, :serial, :currency, :id)";
+
+const char InsertDispensed[] =
+    "INSERT INTO `dispensed_note` (`nominal`, `date`, `type`, `serial`, `currency`, "
+    "`session_id`) VALUES (:amount, :date, :type, :serial, :currency, :id)";
+
+PPSDK::SNote makeNote(int aIndex) {
+    PPSDK::EAmountType::Enum type =
+        (aIndex % 7 == 0) ? PPSDK::EAmountType::Coin : PPSDK::EAmountType::Bill;
+
+    return PPSDK::SNote(type,
+                        Nominals[aIndex % (sizeof(Nominals) / sizeof(Nominals[0]))],
+                        643,
+                        QString("SN%1").arg(aIndex, 8, 10, QChar('0')));
+}
+} // namespace
+
+//---------------------------------------------------------------------------
+void TestBalanceCounters::initTestCase() {
+    m_Fixture = new DatabaseFixture();
+    m_Database = m_Fixture->database();
+    QVERIFY(m_Database);
+    QVERIFY(m_Fixture->open("balance.db",
+                            QStringList()
+                                << ":/scripts/empty_db.sql" << ":/scripts/db_patch_13.sql"));
+}
+
+//---------------------------------------------------------------------------
+void TestBalanceCounters::cleanupTestCase() {
+    delete m_Fixture;
+    m_Fixture = nullptr;
+    m_Database = nullptr;
+}
+
+//---------------------------------------------------------------------------
+bool TestBalanceCounters::execute(const QString &aQuery) {
+    long rowsAffected = 0;
+
+    return m_Database->execDML(aQuery, rowsAffected);
+}
+
+//---------------------------------------------------------------------------
+bool TestBalanceCounters::addNote(BalanceCounters &aCounters,
+                                  BalanceCounters::EKind aKind,
+                                  const PPSDK::SNote &aNote,
+                                  qint64 aPayment) {
+    DatabaseTransaction transaction(m_Database);
+
+    QScopedPointer<IDatabaseQuery> query(m_Database->createQuery(
+        aKind == BalanceCounters::Accepted ? InsertAccepted : InsertDispensed));
+
+    if (!transaction || !query) {
+        return false;
+    }
+
+    query->bindValue(":amount", aNote.nominal.toString());
+    query->bindValue(":date", QDateTime::currentDateTime().toString(CIDatabaseProxy::DateFormat));
+    query->bindValue(":type", aNote.type);
+    query->bindValue(":serial", aNote.serial);
+    query->bindValue(":currency", aNote.currency);
+    query->bindValue(":id", aPayment);
+
+    if (aKind == BalanceCounters::Accepted) {
+        query->bindValue(":ejection", QVariant());
+    }
+
+    return query->exec() && aCounters.add(aKind, aNote) && transaction.commit();
+}
+
+//---------------------------------------------------------------------------
+bool TestBalanceCounters::seedHistory(int aCount) {
+    DatabaseTransaction transaction(m_Database);
+
+    QScopedPointer<IDatabaseQuery> query(m_Database->createQuery(InsertAccepted));
+
+    if (!transaction || !query) {
+        return false;
+    }
+
+    QString date = QDateTime::currentDateTime().addYears(-1).toString(CIDatabaseProxy::DateFormat);
+
+    for (int i = 0; i < aCount; ++i) {
+        PPSDK::SNote note = makeNote(i);
+
+        query->bindValue(":amount", note.nominal.toString());
+        query->bindValue(":date", date);
+        query->bindValue(":ejection", date);
+        query->bindValue(":type", note.type);
+        query->bindValue(":serial", note.serial);
+        query->bindValue(":currency", note.currency);
+        query->bindValue(":id", m_NextPayment++);
+
+        if (!query->exec()) {
+            return false;
+        }
+    }
+
+    return transaction.commit();
+}
+
+//---------------------------------------------------------------------------
+void TestBalanceCounters::verifyMatches(BalanceCounters &aCounters, BalanceCounters::EKind aKind) {
+    QList<PPSDK::SBalance::SAmounts> counted;
+    QList<PPSDK::SBalance::SAmounts> aggregated;
+    double countedTotal = 0.0;
+    double aggregatedTotal = 0.0;
+    QString difference;
+
+    QVERIFY(aCounters.read(aKind, counted, countedTotal));
+    QVERIFY(aCounters.recompute(aKind, aggregated, aggregatedTotal));
+    QVERIFY2(BalanceCounters::equal(counted, aggregated, difference), qPrintable(difference));
+    QCOMPARE(countedTotal, aggregatedTotal);
+}
+
+//---------------------------------------------------------------------------
+bool TestBalanceCounters::encash(BalanceCounters &aCounters) {
+    DatabaseTransaction transaction(m_Database);
+    QString date = QDateTime::currentDateTime().toString(CIDatabaseProxy::DateFormat);
+
+    return transaction &&
+           execute(QString("UPDATE `payment_note` SET `ejection` = '%1' WHERE `ejection` IS NULL")
+                       .arg(date)) &&
+           execute(QString("UPDATE `dispensed_note` SET `reported` = '%1' WHERE `reported` IS NULL")
+                       .arg(date)) &&
+           aCounters.reset(BalanceCounters::Accepted) &&
+           aCounters.reset(BalanceCounters::Dispensed) && transaction.commit();
+}
+
+//---------------------------------------------------------------------------
+void TestBalanceCounters::testMigrationFillsCounters() {
+    // Купюры, принятые до появления счётчиков, попадают в них при миграции.
+    QVERIFY(execute("INSERT INTO `payment_note` (`nominal`, `type`, `serial`, `currency`, "
+                    "`fk_payment_id`) VALUES (100, 0, 'A1', 643, 1), (100, 0, 'A2', 643, 1), "
+                    "(0.50, 1, '', 643, 2), (1000, 2, 'E1', 643, 3)"));
+    QVERIFY(execute("INSERT INTO `dispensed_note` (`nominal`, `type`, `serial`, `currency`, "
+                    "`session_id`) VALUES (50, 0, 'D1', 643, 1)"));
+
+    QVERIFY(m_Fixture->applyScript(":/scripts/db_patch_14.sql"));
+
+    BalanceCounters counters(*m_Database);
+    verifyMatches(counters, BalanceCounters::Accepted);
+    verifyMatches(counters, BalanceCounters::Dispensed);
+
+    QVERIFY(encash(counters));
+}
+
+//---------------------------------------------------------------------------
+void TestBalanceCounters::testAddMatchesNotes() {
+    BalanceCounters counters(*m_Database);
+
+    for (int i = 0; i < 50; ++i) {
+        QVERIFY(addNote(counters, BalanceCounters::Accepted, makeNote(i), m_NextPayment++));
+    }
+
+    // Электронные деньги не входят в наличные, null и пустой серийный номер склеиваются
+    // так же, как в GROUP_CONCAT, вторая валюта складывается с первой.
+    QVERIFY(addNote(counters,
+                    BalanceCounters::Accepted,
+                    PPSDK::SNote(PPSDK::EAmountType::EMoney, 300, 643, "E"),
+                    m_NextPayment++));
+    QVERIFY(addNote(counters,
+                    BalanceCounters::Accepted,
+                    PPSDK::SNote(PPSDK::EAmountType::Bill, 100, 643, QString()),
+                    m_NextPayment++));
+    QVERIFY(addNote(counters,
+                    BalanceCounters::Accepted,
+                    PPSDK::SNote(PPSDK::EAmountType::Bill, 100, 643, ""),
+                    m_NextPayment++));
+    QVERIFY(addNote(counters,
+                    BalanceCounters::Accepted,
+                    PPSDK::SNote(PPSDK::EAmountType::Coin, 0.5, 840, "C"),
+                    m_NextPayment++));
+
+    for (int i = 0; i < 10; ++i) {
+        QVERIFY(addNote(counters, BalanceCounters::Dispensed, makeNote(i), i));
+    }
+
+    verifyMatches(counters, BalanceCounters::Accepted);
+    verifyMatches(counters, BalanceCounters::Dispensed);
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+void TestBalanceCounters::testRollbackKeepsCounters() {
+    BalanceCounters counters(*m_Database);
+
+    {
+        DatabaseTransaction transaction(m_Database);
+        QVERIFY(counters.add(BalanceCounters::Accepted, makeNote(1)));
+        QVERIFY(transaction.rollback());
+    }
+
+    verifyMatches(counters, BalanceCounters::Accepted);
+}
+
+//---------------------------------------------------------------------------
+void TestBalanceCounters::testSelfCheckFindsDrift() {
+    BalanceCounters counters(*m_Database);
+
+    QVERIFY(execute("UPDATE `balance_counter` SET `count` = `count` + 5 WHERE `kind` = 0"));
+
+    QList<PPSDK::SBalance::SAmounts> counted;
+    QList<PPSDK::SBalance::SAmounts> aggregated;
+    double total = 0.0;
+    QString difference;
+
+    QVERIFY(counters.read(BalanceCounters::Accepted, counted, total));
+    QVERIFY(counters.recompute(BalanceCounters::Accepted, aggregated, total));
+    QVERIFY(!BalanceCounters::equal(counted, aggregated, difference));
+    QVERIFY(!difference.isEmpty());
+
+    // Испорченные счётчики пересобираются при следующем чтении.
+    counters.invalidate();
+    verifyMatches(counters, BalanceCounters::Accepted);
+}
+
+//---------------------------------------------------------------------------
+void TestBalanceCounters::testStaleMarkSurvivesRestart() {
+    {
+        BalanceCounters counters(*m_Database);
+        DatabaseTransaction transaction(m_Database);
+
+        // Купюра сохранена, счётчики не обновлены - отметка фиксируется вместе с ней.
+        QVERIFY(execute(QString("INSERT INTO `payment_note` (`nominal`, `date`, `type`, "
+                                "`serial`, `currency`, `fk_payment_id`) "
+                                "VALUES ('500.00', '%1', 0, 'STALE', 643, %2)")
+                            .arg(QDateTime::currentDateTime().toString(CIDatabaseProxy::DateFormat))
+                            .arg(m_NextPayment++)));
+        QVERIFY(counters.markStale());
+        QVERIFY(transaction.commit());
+    }
+
+    // Новый запуск: счётчики в памяти считаются верными, отметку находит restore().
+    BalanceCounters counters(*m_Database);
+    QVERIFY(counters.restore());
+
+    QScopedPointer<IDatabaseQuery> query(
+        m_Database->createQuery("SELECT COUNT(*) FROM `balance_counter` WHERE `kind` = 2"));
+    QVERIFY(query->exec() && query->first());
+    QCOMPARE(query->value(0).toInt(), 0);
+
+    verifyMatches(counters, BalanceCounters::Accepted);
+    verifyMatches(counters, BalanceCounters::Dispensed);
+
+    // Без отметки restore() ничего не делает.
+    QVERIFY(counters.restore());
+}
+
+//---------------------------------------------------------------------------
+void TestBalanceCounters::testResetOnEncashment() {
+    BalanceCounters counters(*m_Database);
+
+    QVERIFY(encash(counters));
+
+    QList<PPSDK::SBalance::SAmounts> sums;
+    double total = -1.0;
+
+    QVERIFY(counters.read(BalanceCounters::Accepted, sums, total));
+    QVERIFY(sums.isEmpty());
+    QCOMPARE(total, 0.0);
+
+    verifyMatches(counters, BalanceCounters::Accepted);
+    verifyMatches(counters, BalanceCounters::Dispensed);
+}
+
+//---------------------------------------------------------------------------
+void TestBalanceCounters::benchmarkBalance() {
+    BalanceCounters counters(*m_Database);
+
+    for (int i = 0; i < IntervalNotes; ++i) {
+        QVERIFY(addNote(counters, BalanceCounters::Accepted, makeNote(i), m_NextPayment++));
+    }
+
+    QElapsedTimer timer;
+    int seeded = 0;
+
+    foreach (int history, QList<int>() << 10000 << 100000 << 1000000) {
+        QVERIFY(seedHistory(history - seeded));
+        seeded = history;
+
+        QList<PPSDK::SBalance::SAmounts> sums;
+        double total = 0.0;
+
+        timer.start();
+
+        for (int i = 0; i < BalanceReads; ++i) {
+            QVERIFY(counters.read(BalanceCounters::Accepted, sums, total));
+        }
+
+        qint64 countersTime = timer.nsecsElapsed() / BalanceReads;
+
+        timer.start();
+
+        for (int i = 0; i < BalanceReads; ++i) {
+            QVERIFY(counters.recompute(BalanceCounters::Accepted, sums, total));
+        }
+
+        qint64 aggregateTime = timer.nsecsElapsed() / BalanceReads;
+
+        qDebug() << "History" << history << "notes, interval" << IntervalNotes
+                 << "notes, balance us: counters" << countersTime / 1000.0 << "aggregate"
+                 << aggregateTime / 1000.0;
+
+        verifyMatches(counters, BalanceCounters::Accepted);
+    }
+
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+QTEST_MAIN(TestBalanceCounters)
+#include "TestBalanceCounters.moc"
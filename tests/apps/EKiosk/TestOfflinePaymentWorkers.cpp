@@ -0,0 +1,737 @@
+/* @file Проверки и нагрузочный замер параллельного проведения оффлайн платежей. */
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QtTest/QtTest>
+
+#include <SDK/PaymentProcessor/Payment/Step.h>
+
+#include <DatabaseProxy/DatabaseTransaction.h>
+#include <DatabaseProxy/IDatabaseProxy.h>
+#include <DatabaseProxy/IDatabaseQuery.h>
+
+#include "../../common/DatabaseFixture.h"
+#include "DatabaseUtils/PaymentQueue.h"
+#include "Services/OfflinePaymentWorkers.h"
+
+namespace PPSDK = SDK::PaymentProcessor;
+
+namespace {
+const int BacklogSize = 5000;
+const int Providers = 20;
+const int QueueWindow = 256;
+const qint64 LeaseTimeout = 10 * 60 * 1000;
+
+/// Задержка ответа шлюза, мс.
+const int GatewayLatency = 2;
+const int WorkerCounts[] = {1, 4, 16};
+
+/// Прежняя схема: один платёж за срабатывание таймера раз в секунду.
+const int OldProcessTimeout = 1000;
+
+const char InsertPayment[] =
+    "INSERT INTO `payment` (`id`, `create_date`, `type`, `initial_session`, `session`, "
+    "`operator`, `status`) VALUES (:id, :date, 'humo', :session, :session, :operator, :status)";
+
+const char InsertAmount[] = "INSERT INTO `payment_param` (`name`, `value`, `type`, "
+                            "`fk_payment_id`) VALUES ('AMOUNT', :amount, 0, :id)";
+
+const char ResetQuery[] = "UPDATE `payment` SET `status` = 3, `next_try_date` = NULL, "
+                          "`lease_owner` = NULL, `lease_until` = NULL";
+
+const char CompleteQuery[] = "UPDATE `payment` SET `status` = :status WHERE `id` = :id";
+
+/// Шлюз оператора: операторы поровну делят два шлюза.
+QString gatewayOf(qint64 aProvider) {
+    return QString("gw%1").arg(aProvider % 2);
+}
+
+SQueuedPayment makePayment(qint64 aID, qint64 aProvider) {
+    SQueuedPayment payment;
+    payment.id = aID;
+    payment.provider = aProvider;
+
+    return payment;
+}
+} // namespace
+
+//---------------------------------------------------------------------------
+/// Шлюз на локальном порту: отвечает ERROR=0 на каждый запрос с задержкой и считает сессии.
+class MockGateway : public QThread {
+public:
+    explicit MockGateway(int aLatency) : m_Latency(aLatency), m_Port(0) {}
+
+    quint16 port() const { return m_Port; }
+
+    /// Число принятых сессий и сессий, пришедших повторно.
+    int sessions() {
+        QMutexLocker lock(&m_Lock);
+        return m_Sessions.size();
+    }
+
+    int duplicates() {
+        QMutexLocker lock(&m_Lock);
+
+        int result = 0;
+
+        foreach (int count, m_Sessions) {
+            result += count - 1;
+        }
+
+        return result;
+    }
+
+    void reset() {
+        QMutexLocker lock(&m_Lock);
+        m_Sessions.clear();
+    }
+
+    /// Ожидает готовности сервера.
+    bool waitReady() { return m_Ready.tryAcquire(1, 5000) && m_Port; }
+
+    /// Блокирующий запрос к шлюзу из потока без цикла событий.
+    static bool post(quint16 aPort, qint64 aSession) {
+        QTcpSocket socket;
+        socket.connectToHost(QHostAddress::LocalHost, aPort);
+
+        if (!socket.waitForConnected(5000)) {
+            return false;
+        }
+
+        QByteArray body = "SESSION=" + QByteArray::number(aSession) + "\r\nAMOUNT=10.00\r\n";
+
+        socket.write("POST /payment HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n"
+                     "Content-Length: " +
+                     QByteArray::number(body.size()) + "\r\n\r\n" + body);
+
+        QByteArray reply;
+
+        while (socket.waitForReadyRead(5000)) {
+            reply += socket.readAll();
+        }
+
+        reply += socket.readAll();
+
+        return reply.contains("\r\nERROR=0\r\n");
+    }
+
+protected:
+    /// Отвечает на запрос, когда он получен целиком.
+    void reply(QTcpSocket *aSocket, const QByteArray &aBuffer) {
+        int header = aBuffer.indexOf("\r\n\r\n");
+        if (header < 0) {
+            return;
+        }
+
+        int length = 0;
+        foreach (const QByteArray &line, aBuffer.left(header).split('\n')) {
+            if (line.toLower().startsWith("content-length:")) {
+                length = line.mid(15).trimmed().toInt();
+            }
+        }
+
+        QByteArray body = aBuffer.mid(header + 4);
+        if (body.size() < length) {
+            return;
+        }
+
+        QByteArray session;
+        foreach (const QByteArray &line, body.split('\n')) {
+            if (line.startsWith("SESSION=")) {
+                session = line.mid(8).trimmed();
+            }
+        }
+
+        {
+            QMutexLocker lock(&m_Lock);
+            ++m_Sessions[session];
+        }
+
+        QByteArray answer = "SESSION=" + session + "\r\nERROR=0\r\nRESULT=0\r\n";
+        QByteArray response = "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: " +
+                              QByteArray::number(answer.size()) + "\r\n\r\n" + answer;
+
+        QTimer::singleShot(m_Latency, aSocket, [aSocket, response]() {
+            aSocket->write(response);
+            aSocket->disconnectFromHost();
+        });
+    }
+
+    virtual void run() override {
+        QTcpServer server;
+
+        if (server.listen(QHostAddress::LocalHost, 0)) {
+            m_Port = server.serverPort();
+        }
+
+        m_Ready.release();
+
+        QHash<QTcpSocket *, QByteArray> buffers;
+
+        QObject::connect(&server, &QTcpServer::newConnection, &server, [&]() {
+            while (QTcpSocket *socket = server.nextPendingConnection()) {
+                QObject::connect(socket, &QTcpSocket::disconnected, socket, [&buffers, socket]() {
+                    buffers.remove(socket);
+                    socket->deleteLater();
+                });
+
+                QObject::connect(socket, &QTcpSocket::readyRead, socket, [&, socket]() {
+                    buffers[socket] += socket->readAll();
+                    reply(socket, buffers[socket]);
+                });
+            }
+        });
+
+        exec();
+    }
+
+private:
+    int m_Latency;
+    quint16 m_Port;
+    QSemaphore m_Ready;
+    QMutex m_Lock;
+    QHash<QByteArray, int> m_Sessions;
+};
+
+//---------------------------------------------------------------------------
+class TestOfflinePaymentWorkers : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    // Корректность
+    void testClaimIsExclusive();
+    void testRenewLease();
+    void testStop();
+    void testQueueOrder();
+    void testProviderRate();
+    void testGatewayRate();
+    void testJitter();
+    void testTwoOwners();
+    void testRestartLeases();
+
+    // Замеры
+    void benchmarkDrain();
+
+private:
+    struct SResult {
+        qint64 id;
+        QString owner;
+        bool ok;
+    };
+
+    bool execute(const QString &aQuery);
+
+    /// Добавляет BacklogSize платежей к проведению.
+    bool seedBacklog();
+
+    /// Возвращает все платежи в очередь.
+    bool resetBacklog();
+
+    /// Число платежей со статусом aStatus.
+    int count(int aStatus);
+
+    /// Проводит очередь через шлюз обработчиками aOwners. Возвращает время в мс.
+    qint64 drain(const OfflinePaymentWorkers::SSettings &aSettings, const QStringList &aOwners);
+
+    /// Сохраняет результаты проведения и снимает аренду.
+    void applyResults();
+
+    DatabaseFixture *m_Fixture = nullptr;
+    IDatabaseProxy *m_Database = nullptr;
+    PaymentQueue *m_Queue = nullptr;
+    MockGateway *m_Gateway = nullptr;
+
+    QMutex m_ResultsLock;
+    QList<SResult> m_Results;
+};
+
+//---------------------------------------------------------------------------
+void TestOfflinePaymentWorkers::initTestCase() {
+    m_Fixture = new DatabaseFixture();
+    m_Database = m_Fixture->database();
+    QVERIFY(m_Database);
+    QVERIFY(m_Fixture->open("queue.db",
+                            QStringList() << ":/scripts/empty_db.sql" << ":/scripts/db_patch_13.sql"
+                                          << ":/scripts/db_patch_14.sql"
+                                          << ":/scripts/db_patch_15.sql"));
+    QVERIFY(seedBacklog());
+
+    m_Queue = new PaymentQueue(*m_Database);
+
+    m_Gateway = new MockGateway(GatewayLatency);
+    m_Gateway->start();
+    QVERIFY(m_Gateway->waitReady());
+}
+
+//---------------------------------------------------------------------------
+void TestOfflinePaymentWorkers::cleanupTestCase() {
+    if (m_Gateway) {
+        m_Gateway->quit();
+        m_Gateway->wait();
+        delete m_Gateway;
+    }
+
+    delete m_Queue;
+
+    delete m_Fixture;
+    m_Fixture = nullptr;
+    m_Database = nullptr;
+}
+
+//---------------------------------------------------------------------------
+bool TestOfflinePaymentWorkers::execute(const QString &aQuery) {
+    long rowsAffected = 0;
+
+    return m_Database->execDML(aQuery, rowsAffected);
+}
+
+//---------------------------------------------------------------------------
+bool TestOfflinePaymentWorkers::seedBacklog() {
+    DatabaseTransaction transaction(m_Database);
+
+    QScopedPointer<IDatabaseQuery> payment(m_Database->createQuery(InsertPayment));
+    QScopedPointer<IDatabaseQuery> amount(m_Database->createQuery(InsertAmount));
+
+    if (!transaction || !payment || !amount) {
+        return false;
+    }
+
+    QDateTime start = QDateTime::currentDateTime().addDays(-1);
+
+    for (int i = 1; i <= BacklogSize; ++i) {
+        // Порядок создания не совпадает с порядком идентификаторов.
+        int shift = (i * 7919) % BacklogSize;
+
+        payment->bindValue(":id", i);
+        payment->bindValue(":date",
+                           start.addSecs(shift).toString(CIDatabaseProxy::DateFormat));
+        payment->bindValue(":session", QString::number(i));
+        payment->bindValue(":operator", 100 + i % Providers);
+        payment->bindValue(":status", PPSDK::EPaymentStatus::ReadyForCheck);
+
+        amount->bindValue(":amount", QString::number((i * 104729) % 1000 + 1) + ".00");
+        amount->bindValue(":id", i);
+
+        if (!payment->exec() || !amount->exec()) {
+            return false;
+        }
+    }
+
+    return transaction.commit();
+}
+
+//---------------------------------------------------------------------------
+bool TestOfflinePaymentWorkers::resetBacklog() {
+    m_Gateway->reset();
+
+    return execute(ResetQuery);
+}
+
+//---------------------------------------------------------------------------
+int TestOfflinePaymentWorkers::count(int aStatus) {
+    QScopedPointer<IDatabaseQuery> query(
+        m_Database->createQuery("SELECT COUNT(*) FROM `payment` WHERE `status` = :status"));
+
+    query->bindValue(":status", aStatus);
+
+    return (query->exec() && query->first()) ? query->value(0).toInt() : -1;
+}
+
+//---------------------------------------------------------------------------
+void TestOfflinePaymentWorkers::applyResults() {
+    QList<SResult> results;
+
+    {
+        QMutexLocker lock(&m_ResultsLock);
+        results.swap(m_Results);
+    }
+
+    if (results.isEmpty()) {
+        return;
+    }
+
+    DatabaseTransaction transaction(m_Database);
+    QScopedPointer<IDatabaseQuery> query(m_Database->createQuery(CompleteQuery));
+
+    foreach (const SResult &result, results) {
+        query->bindValue(":status",
+                         result.ok ? PPSDK::EPaymentStatus::Completed
+                                   : PPSDK::EPaymentStatus::ProcessError);
+        query->bindValue(":id", result.id);
+        query->exec();
+
+        m_Queue->release(result.id, result.owner);
+    }
+
+    transaction.commit();
+}
+
+//---------------------------------------------------------------------------
+qint64 TestOfflinePaymentWorkers::drain(const OfflinePaymentWorkers::SSettings &aSettings,
+                                        const QStringList &aOwners) {
+    QList<OfflinePaymentWorkers *> pools;
+    QSemaphore finished;
+
+    for (int i = 0; i < aOwners.size(); ++i) {
+        pools << new OfflinePaymentWorkers(aSettings, &gatewayOf);
+        pools.last()->setFinishedHandler([&finished]() { finished.release(); });
+    }
+
+    quint16 port = m_Gateway->port();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    forever {
+        int running = 0;
+
+        foreach (OfflinePaymentWorkers *pool, pools) {
+            running += pool->running();
+        }
+
+        // Результаты завершившихся платежей записываются до выборки, чтобы не взять их снова.
+        applyResults();
+
+        QList<SQueuedPayment> queue =
+            m_Queue->select(aSettings.order, QueueWindow, PaymentQueue::now());
+
+        if (queue.isEmpty() && (running == 0)) {
+            break;
+        }
+
+        int started = 0;
+
+        // Все обработчики получают одну и ту же выборку: платёж достаётся только захватившему.
+        for (int i = 0; i < pools.size(); ++i) {
+            QString owner = aOwners.at(i);
+
+            started += pools.at(i)->dispatch(
+                queue,
+                [this, owner](const SQueuedPayment &aPayment) {
+                    qint64 now = PaymentQueue::now();
+                    return m_Queue->claim(aPayment.id, owner, now + LeaseTimeout, now);
+                },
+                [this, owner, port](const SQueuedPayment &aPayment) {
+                    SResult result = {aPayment.id, owner, MockGateway::post(port, aPayment.id)};
+
+                    QMutexLocker lock(&m_ResultsLock);
+                    m_Results << result;
+                });
+        }
+
+        if (started == 0) {
+            finished.tryAcquire(1, 50);
+        }
+    }
+
+    qint64 elapsed = qMax(qint64(1), timer.elapsed());
+
+    qDeleteAll(pools);
+
+    return elapsed;
+}
+
+//---------------------------------------------------------------------------
+void TestOfflinePaymentWorkers::testClaimIsExclusive() {
+    QVERIFY(resetBacklog());
+
+    qint64 now = PaymentQueue::now();
+
+    QVERIFY(m_Queue->claim(1, "first", now + LeaseTimeout, now));
+    QVERIFY(!m_Queue->claim(1, "second", now + LeaseTimeout, now));
+
+    // Чужая аренда не снимается.
+    QVERIFY(m_Queue->release(1, "second"));
+    QVERIFY(!m_Queue->claim(1, "second", now + LeaseTimeout, now));
+
+    // Арендованный платёж не попадает в очередь, пока аренда действует.
+    QList<SQueuedPayment> queue = m_Queue->select(EPaymentQueueOrder::Oldest, BacklogSize, now);
+    QCOMPARE(queue.size(), BacklogSize - 1);
+
+    queue = m_Queue->select(EPaymentQueueOrder::Oldest, BacklogSize, now + LeaseTimeout);
+    QCOMPARE(queue.size(), BacklogSize);
+
+    // Истёкшую аренду забирает другой обработчик.
+    QVERIFY(m_Queue->claim(1, "second", now + 2 * LeaseTimeout, now + LeaseTimeout));
+
+    QVERIFY(m_Queue->release(1, "second"));
+    QVERIFY(m_Queue->claim(1, "first", now + LeaseTimeout, now));
+    QVERIFY(m_Queue->release(1, "first"));
+
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+void TestOfflinePaymentWorkers::testRenewLease() {
+    QVERIFY(resetBacklog());
+
+    qint64 now = PaymentQueue::now();
+
+    QVERIFY(m_Queue->claim(1, "first", now + LeaseTimeout, now));
+
+    // Продлевается только своя действующая аренда.
+    QVERIFY(!m_Queue->renew(1, "second", now + 2 * LeaseTimeout, now));
+    QVERIFY(m_Queue->renew(1, "first", now + 2 * LeaseTimeout, now + LeaseTimeout / 2));
+
+    // По первоначальному сроку платёж уже не освобождается.
+    QVERIFY(!m_Queue->claim(1, "second", now + 3 * LeaseTimeout, now + LeaseTimeout));
+
+    // Истёкшая аренда не продлевается: платёж может быть уже у другого обработчика.
+    QVERIFY(!m_Queue->renew(1, "first", now + 4 * LeaseTimeout, now + 2 * LeaseTimeout));
+    QVERIFY(m_Queue->claim(1, "second", now + 3 * LeaseTimeout, now + 2 * LeaseTimeout));
+    QVERIFY(!m_Queue->renew(1, "first", now + 4 * LeaseTimeout, now + 2 * LeaseTimeout));
+
+    QVERIFY(m_Queue->release(1, "second"));
+
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+void TestOfflinePaymentWorkers::testStop() {
+    OfflinePaymentWorkers::SSettings settings;
+    settings.workers = 2;
+
+    QSemaphore started;
+    QSemaphore proceed;
+    int finished = 0;
+
+    {
+        OfflinePaymentWorkers workers(settings, &gatewayOf);
+        workers.setFinishedHandler([&finished]() { ++finished; });
+
+        QList<SQueuedPayment> queue;
+        queue << makePayment(1, 1) << makePayment(2, 1) << makePayment(3, 1);
+
+        auto claim = [](const SQueuedPayment &) { return true; };
+        auto process = [&started, &proceed](const SQueuedPayment &) {
+            started.release();
+            proceed.acquire();
+        };
+
+        QCOMPARE(workers.dispatch(queue, claim, process), 2);
+        QVERIFY(started.tryAcquire(2, 5000));
+        QCOMPARE(workers.getRunning().size(), 2);
+
+        // После остановки платежи не раздаются, проводимые доводятся до конца.
+        workers.stop();
+        QCOMPARE(workers.dispatch(queue, claim, process), 0);
+        QVERIFY(!workers.waitForDone(100));
+
+        proceed.release(2);
+        QVERIFY(workers.waitForDone(5000));
+        QCOMPARE(workers.running(), 0);
+    }
+
+    // Обработчик освобождения после остановки не вызывается.
+    QCOMPARE(finished, 0);
+}
+
+//---------------------------------------------------------------------------
+void TestOfflinePaymentWorkers::testQueueOrder() {
+    QVERIFY(resetBacklog());
+
+    QList<SQueuedPayment> oldest =
+        m_Queue->select(EPaymentQueueOrder::Oldest, QueueWindow, PaymentQueue::now());
+    QCOMPARE(oldest.size(), QueueWindow);
+
+    for (int i = 1; i < oldest.size(); ++i) {
+        QVERIFY(oldest.at(i - 1).created <= oldest.at(i).created);
+    }
+
+    // Самый старый платёж - со сдвигом 0 от начала.
+    QCOMPARE(oldest.first().id, qint64(BacklogSize));
+
+    QList<SQueuedPayment> largest =
+        m_Queue->select(EPaymentQueueOrder::Amount, QueueWindow, PaymentQueue::now());
+    QCOMPARE(largest.size(), QueueWindow);
+
+    for (int i = 1; i < largest.size(); ++i) {
+        QVERIFY(largest.at(i - 1).amount >= largest.at(i).amount);
+    }
+
+    QCOMPARE(largest.first().amount, 1000.0);
+
+    // Отложенный платёж в очередь не попадает.
+    QVERIFY(execute(QString("UPDATE `payment` SET `next_try_date` = '%1' WHERE `id` = %2")
+                        .arg(QDateTime::currentDateTime().addSecs(3600).toString(
+                            CIDatabaseProxy::DateFormat))
+                        .arg(BacklogSize)));
+
+    oldest = m_Queue->select(EPaymentQueueOrder::Oldest, 1, PaymentQueue::now());
+    QCOMPARE(oldest.size(), 1);
+    QVERIFY(oldest.first().id != qint64(BacklogSize));
+}
+
+//---------------------------------------------------------------------------
+void TestOfflinePaymentWorkers::testProviderRate() {
+    qint64 clock = 0;
+
+    OfflinePaymentWorkers::SSettings settings;
+    settings.workers = 100;
+    settings.providerRate = 60; // 1 в секунду, запас 10
+
+    OfflinePaymentWorkers workers(settings, &gatewayOf, [&clock]() { return clock; });
+
+    QList<SQueuedPayment> queue;
+
+    for (int i = 0; i < 50; ++i) {
+        queue << makePayment(i, 1) << makePayment(1000 + i, 2);
+    }
+
+    auto claim = [](const SQueuedPayment &) { return true; };
+    auto process = [](const SQueuedPayment &) {};
+
+    // Запас каждого оператора, ограничение одного не задерживает другого.
+    QCOMPARE(workers.dispatch(queue, claim, process), 20);
+    QVERIFY(workers.waitForDone(5000));
+    QCOMPARE(workers.dispatch(queue, claim, process), 0);
+
+    clock += 1000;
+    QCOMPARE(workers.dispatch(queue, claim, process), 2);
+    QVERIFY(workers.waitForDone(5000));
+
+    // Разрешения не копятся выше запаса.
+    clock += 60 * 1000;
+    QCOMPARE(workers.dispatch(queue, claim, process), 20);
+    QVERIFY(workers.waitForDone(5000));
+
+    // Не захваченный платёж разрешение не расходует.
+    clock += 60 * 1000;
+    QCOMPARE(workers.dispatch(queue, [](const SQueuedPayment &) { return false; }, process), 0);
+    QCOMPARE(workers.dispatch(queue, claim, process), 20);
+    QVERIFY(workers.waitForDone(5000));
+}
+
+//---------------------------------------------------------------------------
+void TestOfflinePaymentWorkers::testGatewayRate() {
+    qint64 clock = 0;
+
+    OfflinePaymentWorkers::SSettings settings;
+    settings.workers = 100;
+    settings.gatewayRate = 30; // запас 5
+
+    OfflinePaymentWorkers workers(settings, &gatewayOf, [&clock]() { return clock; });
+
+    QList<SQueuedPayment> queue;
+
+    // Операторы 1 и 3 - один шлюз gw1, оператор 2 - шлюз gw0.
+    for (int i = 0; i < 10; ++i) {
+        queue << makePayment(i, 1) << makePayment(100 + i, 3) << makePayment(200 + i, 2);
+    }
+
+    auto claim = [](const SQueuedPayment &) { return true; };
+    auto process = [](const SQueuedPayment &) {};
+
+    QCOMPARE(workers.dispatch(queue, claim, process), 10);
+    QVERIFY(workers.waitForDone(5000));
+
+    clock += 2000;
+    QCOMPARE(workers.dispatch(queue, claim, process), 2);
+    QVERIFY(workers.waitForDone(5000));
+}
+
+//---------------------------------------------------------------------------
+void TestOfflinePaymentWorkers::testJitter() {
+    QDateTime now = QDateTime::currentDateTime();
+    QDateTime next = now.addSecs(600);
+
+    qint64 minimum = next.toMSecsSinceEpoch();
+    qint64 maximum = minimum;
+
+    for (int i = 0; i < 1000; ++i) {
+        QDateTime jittered = OfflinePaymentWorkers::jitter(next, now);
+        qint64 delta = now.msecsTo(jittered);
+
+        QVERIFY(delta >= 480 * 1000 && delta <= 720 * 1000);
+
+        minimum = qMin(minimum, jittered.toMSecsSinceEpoch());
+        maximum = qMax(maximum, jittered.toMSecsSinceEpoch());
+    }
+
+    // Попытки действительно разнесены.
+    QVERIFY(maximum - minimum > 60 * 1000);
+
+    // Наступившая попытка не сдвигается.
+    QCOMPARE(OfflinePaymentWorkers::jitter(now.addSecs(-5), now), now.addSecs(-5));
+}
+
+//---------------------------------------------------------------------------
+void TestOfflinePaymentWorkers::testTwoOwners() {
+    QVERIFY(resetBacklog());
+
+    OfflinePaymentWorkers::SSettings settings;
+    settings.workers = 8;
+
+    drain(settings, QStringList() << "first" << "second");
+
+    QCOMPARE(m_Gateway->sessions(), BacklogSize);
+    QCOMPARE(m_Gateway->duplicates(), 0);
+    QCOMPARE(count(PPSDK::EPaymentStatus::Completed), BacklogSize);
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+void TestOfflinePaymentWorkers::testRestartLeases() {
+    QVERIFY(resetBacklog());
+
+    // Прежний экземпляр упал, не сняв аренду: у части платежей она ещё действует.
+    qint64 now = PaymentQueue::now();
+    QVERIFY(execute(QString("UPDATE `payment` SET `lease_owner` = 'crashed', `lease_until` = "
+                            "CASE WHEN `id` % 10 = 0 THEN %1 ELSE %2 END WHERE `id` % 5 = 0")
+                        .arg(now + LeaseTimeout)
+                        .arg(now - 1)));
+
+    OfflinePaymentWorkers::SSettings settings;
+    settings.workers = 8;
+
+    drain(settings, QStringList() << "restarted");
+
+    QCOMPARE(m_Gateway->sessions(), BacklogSize - BacklogSize / 10);
+    QCOMPARE(m_Gateway->duplicates(), 0);
+    QCOMPARE(count(PPSDK::EPaymentStatus::ReadyForCheck), BacklogSize / 10);
+}
+
+//---------------------------------------------------------------------------
+void TestOfflinePaymentWorkers::benchmarkDrain() {
+    qint64 single = 0;
+
+    for (int workers : WorkerCounts) {
+        QVERIFY(resetBacklog());
+
+        OfflinePaymentWorkers::SSettings settings;
+        settings.workers = workers;
+
+        qint64 elapsed = drain(settings, QStringList() << "benchmark");
+
+        QCOMPARE(m_Gateway->sessions(), BacklogSize);
+        QCOMPARE(m_Gateway->duplicates(), 0);
+        QCOMPARE(count(PPSDK::EPaymentStatus::Completed), BacklogSize);
+
+        if (workers == 1) {
+            single = elapsed;
+        }
+
+        qDebug() << BacklogSize << "payments, gateway latency" << GatewayLatency << "ms:"
+                 << workers << "workers drain" << elapsed << "ms,"
+                 << BacklogSize * 1000 / elapsed << "payments/s, speedup"
+                 << double(single) / elapsed;
+    }
+
+    qDebug() << "One payment per" << OldProcessTimeout << "ms timer tick would take"
+             << qint64(BacklogSize) * OldProcessTimeout / 1000 << "s";
+
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+QTEST_MAIN(TestOfflinePaymentWorkers)
+#include "TestOfflinePaymentWorkers.moc"
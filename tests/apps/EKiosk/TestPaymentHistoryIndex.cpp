@@ -0,0 +1,286 @@
+/* @file Проверки и замеры выборок платежей по индексируемому времени создания. */
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QScopedPointer>
+#include <QtTest/QtTest>
+
+#include <DatabaseProxy/DatabaseTransaction.h>
+#include <DatabaseProxy/IDatabaseProxy.h>
+#include <DatabaseProxy/IDatabaseQuery.h>
+
+#include "../../common/DatabaseFixture.h"
+#include "DatabaseUtils/SqlScript.h"
+
+//---------------------------------------------------------------------------
+class TestPaymentHistoryIndex : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    // Корректность
+    void testSplitKeepsTriggers();
+    void testEpochFollowsCreateDate();
+    void testQueriesUseIndex();
+
+    // Замеры
+    void benchmarkBackupQueries();
+
+private:
+    bool seedHistory(int aPayments);
+
+    QVariant scalar(const QString &aQuery,
+                    const QString &aName = QString(),
+                    const QVariant &aValue = QVariant());
+    QString queryPlan(const QString &aQuery);
+
+    /// Время выполнения запроса в миллисекундах, -1 при ошибке.
+    qint64 measure(const QString &aQuery, const QString &aName, const QVariant &aValue);
+
+    DatabaseFixture *m_Fixture = nullptr;
+    IDatabaseProxy *m_Database = nullptr;
+};
+
+namespace {
+const int HistoricPayments = 1000000;
+const int HistoryDays = 365;
+
+/// Ночной бэкап уносит платежи старше двух месяцев - берём первый месяц истории.
+const int BackupDays = 30;
+
+const QDateTime HistoryStart(QDate(2024, 1, 1), QTime(0, 0));
+
+const char LegacyCount[] = "SELECT COUNT(*) FROM `payment` WHERE strftime('%s%f', `create_date`) "
+                           "<= strftime('%s%f', :date)";
+const char LegacySelect[] = "SELECT `id`, `create_date`, `status` FROM `payment` WHERE "
+                            "strftime('%s%f', `create_date`) <= strftime('%s%f', :date)";
+const char LegacyDelete[] = "DELETE FROM `payment` WHERE strftime('%s%f', `create_date`) <= "
+                            "strftime('%s%f', :date)";
+
+const char RangeCount[] =
+    "SELECT COUNT(*), MAX(`id`) FROM `payment` WHERE `create_epoch` <= :epoch";
+const char RangeSelect[] =
+    "SELECT `id`, `create_date`, `status` FROM `payment` WHERE `create_epoch` <= :epoch";
+const char RangeDelete[] = "DELETE FROM `payment` WHERE `create_epoch` <= :epoch";
+} // namespace
+
+//---------------------------------------------------------------------------
+void TestPaymentHistoryIndex::initTestCase() {
+    m_Fixture = new DatabaseFixture();
+    m_Database = m_Fixture->database();
+    QVERIFY(m_Database);
+    QVERIFY(m_Fixture->open("payments.db",
+                            QStringList()
+                                << ":/scripts/empty_db.sql" << ":/scripts/db_patch_13.sql"));
+
+    QCOMPARE(scalar("SELECT `value` FROM `device_param` WHERE `name` = :name", ":name", "db_patch")
+                 .toInt(),
+             13);
+}
+
+//---------------------------------------------------------------------------
+void TestPaymentHistoryIndex::cleanupTestCase() {
+    delete m_Fixture;
+    m_Fixture = nullptr;
+    m_Database = nullptr;
+}
+
+//---------------------------------------------------------------------------
+bool TestPaymentHistoryIndex::seedHistory(int aPayments) {
+    DatabaseTransaction transaction(m_Database);
+
+    QScopedPointer<IDatabaseQuery> payment(m_Database->createQuery(
+        "INSERT INTO `payment` (`create_date`, `status`) VALUES (:date, 6)"));
+
+    if (!transaction || !payment) {
+        return false;
+    }
+
+    qint64 step = qint64(HistoryDays) * 86400000 / aPayments;
+
+    for (int i = 0; i < aPayments; ++i) {
+        payment->bindValue(
+            ":date", HistoryStart.addMSecs(step * i).toString(CIDatabaseProxy::DateFormat));
+
+        if (!payment->exec()) {
+            return false;
+        }
+    }
+
+    return transaction.commit();
+}
+
+//---------------------------------------------------------------------------
+QVariant TestPaymentHistoryIndex::scalar(const QString &aQuery,
+                                         const QString &aName,
+                                         const QVariant &aValue) {
+    QScopedPointer<IDatabaseQuery> query(m_Database->createQuery(aQuery));
+
+    if (!query) {
+        return QVariant();
+    }
+
+    if (!aName.isEmpty()) {
+        query->bindValue(aName, aValue);
+    }
+
+    return (query->exec() && query->first()) ? query->value(0) : QVariant();
+}
+
+//---------------------------------------------------------------------------
+QString TestPaymentHistoryIndex::queryPlan(const QString &aQuery) {
+    QScopedPointer<IDatabaseQuery> query(m_Database->execQuery("EXPLAIN QUERY PLAN " + aQuery));
+    QStringList result;
+
+    if (query) {
+        for (query->first(); query->isValid(); query->next()) {
+            result << query->value(3).toString();
+        }
+    }
+
+    return result.join("; ");
+}
+
+//---------------------------------------------------------------------------
+qint64 TestPaymentHistoryIndex::measure(const QString &aQuery,
+                                        const QString &aName,
+                                        const QVariant &aValue) {
+    QElapsedTimer timer;
+    timer.start();
+
+    QScopedPointer<IDatabaseQuery> query(m_Database->createQuery(aQuery));
+
+    if (!query) {
+        return -1;
+    }
+
+    query->bindValue(aName, aValue);
+
+    if (!query->exec()) {
+        return -1;
+    }
+
+    // Выборку читаем целиком, как это делает бэкап.
+    for (query->first(); query->isValid(); query->next()) {
+    }
+
+    return timer.elapsed();
+}
+
+//---------------------------------------------------------------------------
+void TestPaymentHistoryIndex::testSplitKeepsTriggers() {
+    QFile script(":/scripts/db_patch_13.sql");
+    QVERIFY(script.open(QIODevice::ReadOnly));
+
+    QStringList steps = SqlScript::split(QString::fromUtf8(script.readAll()));
+    int triggers = 0;
+
+    foreach (const QString &step, steps) {
+        if (step.contains("CREATE TRIGGER")) {
+            ++triggers;
+            QVERIFY(step.endsWith("END"));
+        }
+    }
+
+    QCOMPARE(triggers, 2);
+    QCOMPARE(SqlScript::split("SELECT 1; -- comment\nSELECT 2;").size(), 2);
+}
+
+//---------------------------------------------------------------------------
+void TestPaymentHistoryIndex::testEpochFollowsCreateDate() {
+    QDateTime created(QDate(2024, 3, 5), QTime(10, 11, 12, 345));
+    long rows = 0;
+
+    QVERIFY(m_Database->execDML(QString("INSERT INTO `payment` (`create_date`) VALUES ('%1')")
+                                    .arg(created.toString(CIDatabaseProxy::DateFormat)),
+                                rows));
+
+    qint64 id = scalar("SELECT MAX(`id`) FROM `payment`").toLongLong();
+    QString epochQuery = "SELECT `create_epoch` FROM `payment` WHERE `id` = :id";
+
+    QCOMPARE(scalar(epochQuery, ":id", id).toLongLong(), SqlScript::toEpoch(created));
+
+    // Сохранение платежа переписывает create_date - колонка следует за ним.
+    QDateTime updated = created.addDays(-40).addMSecs(1);
+
+    QVERIFY(m_Database->execDML(QString("UPDATE `payment` SET `create_date` = '%1' WHERE `id` = %2")
+                                    .arg(updated.toString(CIDatabaseProxy::DateFormat))
+                                    .arg(id),
+                                rows));
+    QCOMPARE(scalar(epochQuery, ":id", id).toLongLong(), SqlScript::toEpoch(updated));
+
+    // Платёж со временем по умолчанию (CURRENT_TIMESTAMP) тоже получает значение.
+    QVERIFY(m_Database->execDML("INSERT INTO `payment` DEFAULT VALUES", rows));
+    QVERIFY(!scalar("SELECT `create_epoch` FROM `payment` ORDER BY `id` DESC LIMIT 1").isNull());
+
+    QVERIFY(m_Database->execDML("DELETE FROM `payment`", rows));
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+void TestPaymentHistoryIndex::testQueriesUseIndex() {
+    QVERIFY(queryPlan(QString(RangeCount).replace(":epoch", "0"))
+                .contains("i__payment__create_epoch"));
+    QVERIFY(queryPlan("SELECT `id` FROM `payment` WHERE `create_epoch` >= 0 AND `create_epoch` < 1")
+                .contains("i__payment__create_epoch"));
+    QVERIFY(queryPlan("SELECT `type`, `nominal`, COUNT(*) FROM `dispensed_note` WHERE "
+                      "`reported` = '2024-01-01' GROUP BY `type`, `nominal`")
+                .contains("i__dispensed_note__reported"));
+}
+
+//---------------------------------------------------------------------------
+void TestPaymentHistoryIndex::benchmarkBackupQueries() {
+    QElapsedTimer timer;
+    timer.start();
+
+    QVERIFY(seedHistory(HistoricPayments));
+
+    qDebug() << "Seeded" << HistoricPayments << "payments in" << timer.elapsed() << "ms";
+
+    QDateTime cutoff = HistoryStart.addDays(BackupDays);
+    QString date = cutoff.toString(CIDatabaseProxy::DateFormat);
+    qint64 epoch = SqlScript::toEpoch(cutoff);
+
+    qint64 legacyCount = scalar(LegacyCount, ":date", date).toLongLong();
+    qint64 rangeCount = scalar(RangeCount, ":epoch", epoch).toLongLong();
+
+    QVERIFY(rangeCount > 0);
+    QCOMPARE(rangeCount, legacyCount);
+
+    qint64 legacyCountTime = measure(LegacyCount, ":date", date);
+    qint64 rangeCountTime = measure(RangeCount, ":epoch", epoch);
+    qint64 legacySelectTime = measure(LegacySelect, ":date", date);
+    qint64 rangeSelectTime = measure(RangeSelect, ":epoch", epoch);
+
+    // Удаление замеряем в откатываемых транзакциях, чтобы оба варианта видели одни данные.
+    qint64 legacyDeleteTime = -1;
+    qint64 rangeDeleteTime = -1;
+
+    {
+        DatabaseTransaction transaction(m_Database);
+        legacyDeleteTime = measure(LegacyDelete, ":date", date);
+        QVERIFY(transaction.rollback());
+    }
+
+    {
+        DatabaseTransaction transaction(m_Database);
+        rangeDeleteTime = measure(RangeDelete, ":epoch", epoch);
+        QVERIFY(transaction.rollback());
+    }
+
+    qDebug() << "Backup of" << rangeCount << "of" << HistoricPayments << "payments, ms:";
+    qDebug() << "  count  strftime" << legacyCountTime << "range" << rangeCountTime;
+    qDebug() << "  select strftime" << legacySelectTime << "range" << rangeSelectTime;
+    qDebug() << "  delete strftime" << legacyDeleteTime << "range" << rangeDeleteTime;
+
+    QVERIFY(legacyCountTime >= 0 && rangeCountTime >= 0);
+    QVERIFY(legacySelectTime >= 0 && rangeSelectTime >= 0);
+    QVERIFY(legacyDeleteTime >= 0 && rangeDeleteTime >= 0);
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+QTEST_MAIN(TestPaymentHistoryIndex)
+#include "TestPaymentHistoryIndex.moc"
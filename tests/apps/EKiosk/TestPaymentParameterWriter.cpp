@@ -0,0 +1,342 @@
+/* @file Проверки и замеры пакетной записи параметров платежа. */
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QVector>
+#include <QtTest/QtTest>
+
+#include <DatabaseProxy/DatabaseTransaction.h>
+#include <DatabaseProxy/IDatabaseProxy.h>
+#include <DatabaseProxy/IDatabaseQuery.h>
+
+#include <algorithm>
+
+#include "../../common/DatabaseFixture.h"
+#include "DatabaseUtils/PaymentParameterWriter.h"
+
+namespace PPSDK = SDK::PaymentProcessor;
+
+//---------------------------------------------------------------------------
+class TestPaymentParameterWriter : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    // Корректность
+    void testWritesOnlyChanged();
+    void testLoadsStoredValues();
+    void testRollbackForgetsPayment();
+
+    // Замеры
+    void benchmarkSaveLatency();
+
+private:
+    bool seedHistory(int aPayments);
+
+    /// Параметры платежа на шаге aStep: часть значений меняется от шага к шагу.
+    TPaymentParameters makeParameters(qint64 aPayment, int aStep) const;
+
+    /// Прежняя запись: запрос пересоздаётся и выполняется для каждого параметра.
+    bool legacySave(qint64 aPayment, const TPaymentParameters &aParameters);
+    bool writerSave(PaymentParameterWriter &aWriter,
+                    qint64 aPayment,
+                    const TPaymentParameters &aParameters,
+                    int &aWritten);
+
+    QString parameterValue(qint64 aPayment, const QString &aName);
+
+    DatabaseFixture *m_Fixture = nullptr;
+    IDatabaseProxy *m_Database = nullptr;
+};
+
+namespace {
+const int HistoricPayments = 100000;
+const int HistoricParameters = 10;
+const int ParametersPerPayment = 30;
+const int SavedPayments = 200;
+const int SavesPerPayment = 5;
+
+const char InsertParameter[] =
+    "INSERT OR REPLACE INTO `payment_param` (`name`, `value`, `type`, `fk_payment_id`, "
+    "`external`) VALUES (:name, :value, :type, :id, :external)";
+} // namespace
+
+//---------------------------------------------------------------------------
+void TestPaymentParameterWriter::initTestCase() {
+    m_Fixture = new DatabaseFixture();
+    m_Database = m_Fixture->database();
+    QVERIFY(m_Database);
+    QVERIFY(m_Fixture->open("payments.db", QStringList() << ":/scripts/empty_db.sql"));
+}
+
+//---------------------------------------------------------------------------
+void TestPaymentParameterWriter::cleanupTestCase() {
+    delete m_Fixture;
+    m_Fixture = nullptr;
+    m_Database = nullptr;
+}
+
+//---------------------------------------------------------------------------
+bool TestPaymentParameterWriter::seedHistory(int aPayments) {
+    DatabaseTransaction transaction(m_Database);
+
+    QScopedPointer<IDatabaseQuery> payment(
+        m_Database->createQuery("INSERT INTO `payment` (`status`) VALUES (6)"));
+    QScopedPointer<IDatabaseQuery> parameter(m_Database->createQuery(InsertParameter));
+
+    if (!transaction || !payment || !parameter) {
+        return false;
+    }
+
+    for (int i = 0; i < aPayments; ++i) {
+        if (!payment->exec()) {
+            return false;
+        }
+
+        for (int j = 0; j < HistoricParameters; ++j) {
+            parameter->bindValue(":name", QString("param_%1").arg(j));
+            parameter->bindValue(":value", QString::number(i * j));
+            parameter->bindValue(":type", 0);
+            parameter->bindValue(":id", i + 1);
+            parameter->bindValue(":external", 0);
+
+            if (!parameter->exec()) {
+                return false;
+            }
+        }
+    }
+
+    return transaction.commit();
+}
+
+//---------------------------------------------------------------------------
+TPaymentParameters TestPaymentParameterWriter::makeParameters(qint64 aPayment, int aStep) const {
+    TPaymentParameters result;
+
+    for (int i = 0; i < ParametersPerPayment; ++i) {
+        // Три параметра (счётчики, статусы шлюза) меняются при каждом сохранении.
+        QVariant value = (i < 3) ? QVariant(QString("%1_%2").arg(i).arg(aStep))
+                                 : QVariant(QString("value_%1_%2").arg(aPayment).arg(i));
+
+        result << PPSDK::IPayment::SParameter(
+            QString("param_%1").arg(i), value, true, false, (i % 5) == 0);
+    }
+
+    result << PPSDK::IPayment::SParameter("receipt_printed", true, true);
+    result << PPSDK::IPayment::SParameter("empty_value", QVariant(), true);
+
+    return result;
+}
+
+//---------------------------------------------------------------------------
+bool TestPaymentParameterWriter::legacySave(qint64 aPayment,
+                                            const TPaymentParameters &aParameters) {
+    DatabaseTransaction transaction(m_Database);
+
+    if (!transaction) {
+        return false;
+    }
+
+    QScopedPointer<IDatabaseQuery> query;
+
+    foreach (const PPSDK::IPayment::SParameter &parameter, aParameters) {
+        if (query) {
+            query->clear();
+        }
+
+        query.reset(m_Database->createQuery(InsertParameter));
+
+        if (!query) {
+            return false;
+        }
+
+        query->bindValue(":name", parameter.name);
+        query->bindValue(":value", parameter.value);
+        query->bindValue(":type", parameter.crypted ? 1 : 0);
+        query->bindValue(":id", aPayment);
+        query->bindValue(":external", parameter.external ? 1 : 0);
+
+        if (!query->exec()) {
+            return false;
+        }
+    }
+
+    return transaction.commit();
+}
+
+//---------------------------------------------------------------------------
+bool TestPaymentParameterWriter::writerSave(PaymentParameterWriter &aWriter,
+                                            qint64 aPayment,
+                                            const TPaymentParameters &aParameters,
+                                            int &aWritten) {
+    DatabaseTransaction transaction(m_Database);
+
+    if (!transaction || !aWriter.write(aPayment, aParameters, QSet<QString>(), aWritten) ||
+        !transaction.commit()) {
+        aWriter.rollback();
+
+        return false;
+    }
+
+    aWriter.commit();
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+QString TestPaymentParameterWriter::parameterValue(qint64 aPayment, const QString &aName) {
+    QScopedPointer<IDatabaseQuery> query(m_Database->createQuery(
+        "SELECT `value` FROM `payment_param` WHERE `fk_payment_id` = :id AND `name` = :name"));
+
+    if (!query) {
+        return QString();
+    }
+
+    query->bindValue(":id", aPayment);
+    query->bindValue(":name", aName);
+
+    return (query->exec() && query->first()) ? query->value(0).toString() : QString();
+}
+
+//---------------------------------------------------------------------------
+void TestPaymentParameterWriter::testWritesOnlyChanged() {
+    PaymentParameterWriter writer(*m_Database);
+    const qint64 payment = 1000001;
+    int written = 0;
+
+    QVERIFY(writerSave(writer, payment, makeParameters(payment, 0), written));
+    QCOMPARE(written, ParametersPerPayment + 2);
+
+    QVERIFY(writerSave(writer, payment, makeParameters(payment, 0), written));
+    QCOMPARE(written, 0);
+
+    QVERIFY(writerSave(writer, payment, makeParameters(payment, 1), written));
+    QCOMPARE(written, 3);
+    QCOMPARE(parameterValue(payment, "param_0"), QString("0_1"));
+
+    // Пропускаемые параметры не пишутся.
+    QSet<QString> skip;
+    skip << "param_0" << "param_1" << "param_2";
+
+    DatabaseTransaction transaction(m_Database);
+    QVERIFY(writer.write(payment, makeParameters(payment, 2), skip, written));
+    QVERIFY(transaction.commit());
+    writer.commit();
+
+    QCOMPARE(written, 0);
+    QCOMPARE(parameterValue(payment, "param_0"), QString("0_1"));
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+void TestPaymentParameterWriter::testLoadsStoredValues() {
+    const qint64 payment = 1000002;
+    int written = 0;
+
+    {
+        PaymentParameterWriter writer(*m_Database);
+        QVERIFY(writerSave(writer, payment, makeParameters(payment, 0), written));
+    }
+
+    // Новый экземпляр ничего не знает о платеже и сравнивает с тем, что лежит в БД,
+    // в том числе bool и null в том виде, в каком их сохранил SQLite.
+    PaymentParameterWriter writer(*m_Database);
+    QVERIFY(writerSave(writer, payment, makeParameters(payment, 0), written));
+    QCOMPARE(written, 0);
+
+    // Изменение признака external тоже считается изменением.
+    TPaymentParameters parameters = makeParameters(payment, 0);
+    parameters[4].external = !parameters[4].external;
+
+    QVERIFY(writerSave(writer, payment, parameters, written));
+    QCOMPARE(written, 1);
+}
+
+//---------------------------------------------------------------------------
+void TestPaymentParameterWriter::testRollbackForgetsPayment() {
+    PaymentParameterWriter writer(*m_Database);
+    const qint64 payment = 1000003;
+    int written = 0;
+
+    QVERIFY(writerSave(writer, payment, makeParameters(payment, 0), written));
+
+    {
+        DatabaseTransaction transaction(m_Database);
+        QVERIFY(writer.write(payment, makeParameters(payment, 1), QSet<QString>(), written));
+        QCOMPARE(written, 3);
+        QVERIFY(transaction.rollback());
+        writer.rollback();
+    }
+
+    // После отката значения перечитываются из БД, и изменения пишутся снова.
+    QVERIFY(writerSave(writer, payment, makeParameters(payment, 1), written));
+    QCOMPARE(written, 3);
+    QCOMPARE(parameterValue(payment, "param_1"), QString("1_1"));
+}
+
+//---------------------------------------------------------------------------
+void TestPaymentParameterWriter::benchmarkSaveLatency() {
+    QElapsedTimer timer;
+    timer.start();
+
+    QVERIFY(seedHistory(HistoricPayments));
+
+    qDebug() << "Seeded" << HistoricPayments << "payments in" << timer.elapsed() << "ms";
+
+    auto report = [](const char *aName, QVector<qint64> &aSamples, qint64 aRows) {
+        std::sort(aSamples.begin(), aSamples.end());
+
+        qDebug() << aName << "save latency, us: p50" << aSamples[aSamples.size() / 2] / 1000.0
+                 << "p99" << aSamples[aSamples.size() * 99 / 100] / 1000.0 << "max"
+                 << aSamples.last() / 1000.0 << "rows written" << aRows;
+    };
+
+    // Новые платежи после истории; каждый сохраняется несколько раз за время жизни.
+    QVector<qint64> legacySamples;
+    qint64 legacyRows = 0;
+
+    for (int i = 0; i < SavedPayments; ++i) {
+        qint64 payment = HistoricPayments + 1 + i;
+
+        for (int step = 0; step < SavesPerPayment; ++step) {
+            TPaymentParameters parameters = makeParameters(payment, step);
+
+            timer.start();
+            QVERIFY(legacySave(payment, parameters));
+            legacySamples.append(timer.nsecsElapsed());
+
+            legacyRows += parameters.size();
+        }
+    }
+
+    PaymentParameterWriter writer(*m_Database);
+    QVector<qint64> writerSamples;
+    qint64 writerRows = 0;
+
+    for (int i = 0; i < SavedPayments; ++i) {
+        qint64 payment = HistoricPayments + SavedPayments + 1 + i;
+
+        for (int step = 0; step < SavesPerPayment; ++step) {
+            TPaymentParameters parameters = makeParameters(payment, step);
+            int written = 0;
+
+            timer.start();
+            QVERIFY(writerSave(writer, payment, parameters, written));
+            writerSamples.append(timer.nsecsElapsed());
+
+            writerRows += written;
+        }
+    }
+
+    report("Legacy", legacySamples, legacyRows);
+    report("Batched", writerSamples, writerRows);
+
+    QVERIFY(writerRows < legacyRows);
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+QTEST_MAIN(TestPaymentParameterWriter)
+#include "TestPaymentParameterWriter.moc"
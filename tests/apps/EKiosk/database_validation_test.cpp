@@ -38,7 +38,8 @@ void DatabaseValidationTest::initTestCase() {
     qInfo() << "";
 
     // List all required database scripts
-    m_requiredScripts << ":/scripts/empty_db.sql";
+    m_requiredScripts << ":/scripts/empty_db.sql" << ":/scripts/db_patch_13.sql"
+                      << ":/scripts/db_patch_14.sql" << ":/scripts/db_patch_15.sql";
 }
 
 void DatabaseValidationTest::testEmptyDbScriptExists() {
@@ -0,0 +1,112 @@
+/* @file Временная база SQLite со схемой терминала для тестов. */
+
+#pragma once
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+#include <QtCore/QTemporaryDir>
+
+#include <DatabaseProxy/DatabaseTransaction.h>
+#include <DatabaseProxy/IDatabaseProxy.h>
+
+#include "DatabaseUtils/SqlScript.h"
+
+//---------------------------------------------------------------------------
+/// Считает неудачные запросы. Запросы могут выполняться из нескольких потоков.
+class QueryChecker : public IDatabaseQueryChecker {
+public:
+    virtual bool isGood(bool aQueryResult) override {
+        if (!aQueryResult) {
+            m_Errors.fetchAndAddRelaxed(1);
+        }
+
+        return aQueryResult;
+    }
+
+    /// Число неудачных запросов с начала теста или с последнего reset().
+    int errors() const { return m_Errors.loadAcquire(); }
+
+    /// Сбрасывает счётчик после ожидаемой ошибки.
+    void reset() { m_Errors.storeRelease(0); }
+
+private:
+    QAtomicInt m_Errors;
+};
+
+//---------------------------------------------------------------------------
+/// База во временном каталоге, открытая через IDatabaseProxy. Скрипты схемы берутся из
+/// ресурсов Database.qrc, поэтому тест компилирует этот ресурс вместе с собой и видит
+/// apps/EKiosk/src в путях заголовков.
+class DatabaseFixture {
+public:
+    DatabaseFixture() : m_Database(IDatabaseProxy::getInstance(&m_Checker)) {}
+
+    ~DatabaseFixture() {
+        if (m_Database) {
+            m_Database->close();
+            IDatabaseProxy::freeInstance(m_Database);
+        }
+    }
+
+    /// Закрывает прежнюю базу, открывает файл aName во временном каталоге с профилем
+    /// aPerformance и применяет скрипты aScripts по порядку.
+    bool open(const QString &aName,
+              const QStringList &aScripts,
+              const SDatabasePerformance &aPerformance = SDatabasePerformance()) {
+        if (!m_TempDir.isValid() || !m_Database) {
+            return false;
+        }
+
+        m_Database->close();
+        m_Database->setPerformance(aPerformance);
+
+        if (!m_Database->open(filePath(aName))) {
+            return false;
+        }
+
+        foreach (const QString &script, aScripts) {
+            if (!applyScript(script)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /// Выполняет скрипт одной транзакцией, как DatabaseUtils::updateDatabase.
+    bool applyScript(const QString &aScript) {
+        QFile script(aScript);
+
+        if (!script.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+
+        DatabaseTransaction transaction(m_Database);
+        long rowsAffected = 0;
+
+        foreach (const QString &step, SqlScript::split(QString::fromUtf8(script.readAll()))) {
+            if (!m_Database->execDML(step, rowsAffected)) {
+                return false;
+            }
+        }
+
+        return transaction.commit();
+    }
+
+    /// Путь к файлу во временном каталоге.
+    QString filePath(const QString &aName) const { return m_TempDir.filePath(aName); }
+
+    IDatabaseProxy *database() const { return m_Database; }
+
+    QueryChecker &checker() { return m_Checker; }
+
+private:
+    Q_DISABLE_COPY(DatabaseFixture)
+
+    QTemporaryDir m_TempDir;
+    QueryChecker m_Checker;
+    IDatabaseProxy *m_Database;
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,397 @@
+/* @file Локальный HTTP/1.1 сервер для тестов сетевых модулей. */
+
+#pragma once
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QPointer>
+#include <QtCore/QSemaphore>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+#include <QtCore/QUrl>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+
+#include <functional>
+
+namespace CHttpStandIn {
+/// Размер блока, которым тело ответа пишется в сокет.
+const qint64 ChunkSize = 256 * 1024;
+
+/// Сколько данных держать в очереди сокета, чтобы большие ответы не копились в памяти.
+const qint64 SocketBacklog = 4 * 1024 * 1024;
+} // namespace CHttpStandIn
+
+//---------------------------------------------------------------------------
+/// Keep-alive сервер на 127.0.0.1. Ответ настраивается для каждого пути: тело целиком или
+/// генерируемое по частям, тело по запросу, задержка, обрыв соединения или отсутствие ответа.
+/// Заголовок Range поддерживается для тел с известным размером. Неизвестный путь - 404.
+class HttpStandIn : public QTcpServer {
+public:
+    /// Запрос клиента. Путь без начального '/'.
+    struct SRequest {
+        QString path;
+        QByteArray range;
+        QByteArray body;
+    };
+
+    /// Часть тела [aOffset, aOffset + aSize).
+    typedef std::function<QByteArray(qint64 aOffset, qint64 aSize)> TContent;
+
+    /// Тело ответа, построенное по запросу.
+    typedef std::function<QByteArray(const SRequest &aRequest)> THandler;
+
+    struct SRoute {
+        enum EAction {
+            Answer, /// ответить
+            Drop,   /// закрыть соединение, получив запрос
+            Hang    /// не отвечать
+        };
+
+        SRoute() : action(Answer), status(200), delay(0), size(0) {}
+
+        EAction action;
+        int status;
+        int delay;
+        qint64 size;
+        TContent content;
+        THandler handler;
+    };
+
+    HttpStandIn() : m_Latency(0), m_Ranges(true) {}
+
+    /// Задаёт ответ на путь aPath. Строка запроса при выборе ответа не учитывается.
+    void route(const QString &aPath, const SRoute &aRoute) { m_Routes.insert(aPath, aRoute); }
+
+    /// Отдаёт aBody через aDelay мс.
+    void serve(const QString &aPath, const QByteArray &aBody, int aDelay = 0) {
+        serve(
+            aPath,
+            aBody.size(),
+            [aBody](qint64 aOffset, qint64 aSize) {
+                return aBody.mid(static_cast<int>(aOffset), static_cast<int>(aSize));
+            },
+            aDelay);
+    }
+
+    /// Отдаёт тело размером aSize, не держа его в памяти целиком.
+    void serve(const QString &aPath, qint64 aSize, const TContent &aContent, int aDelay = 0) {
+        SRoute route;
+        route.size = aSize;
+        route.content = aContent;
+        route.delay = aDelay;
+
+        m_Routes.insert(aPath, route);
+    }
+
+    /// Отвечает телом, построенным по запросу. aHandler вызывается в потоке сервера.
+    void reply(const QString &aPath, const THandler &aHandler, int aDelay = 0) {
+        SRoute route;
+        route.handler = aHandler;
+        route.delay = aDelay;
+
+        m_Routes.insert(aPath, route);
+    }
+
+    void drop(const QString &aPath) {
+        SRoute route;
+        route.action = SRoute::Drop;
+
+        m_Routes.insert(aPath, route);
+    }
+
+    void hang(const QString &aPath) {
+        SRoute route;
+        route.action = SRoute::Hang;
+
+        m_Routes.insert(aPath, route);
+    }
+
+    /// Задержка всех ответов в мс, добавляется к задержке пути.
+    void setLatency(int aLatency) { m_Latency = aLatency; }
+
+    /// false - заголовок Range игнорируется, как обычным сервером без докачки.
+    void setRanges(bool aRanges) { m_Ranges = aRanges; }
+
+    QUrl url(const QString &aPath) const {
+        return QUrl(QString("http://127.0.0.1:%1/%2").arg(serverPort()).arg(aPath));
+    }
+
+    /// Адрес порта, который никто не слушает.
+    static QUrl refusedUrl(const QString &aPath) {
+        QTcpServer closed;
+        closed.listen(QHostAddress::LocalHost);
+
+        quint16 port = closed.serverPort();
+        closed.close();
+
+        return QUrl(QString("http://127.0.0.1:%1/%2").arg(port).arg(aPath));
+    }
+
+    /// Пути полученных запросов по порядку.
+    QStringList paths() const {
+        QMutexLocker locker(&m_Mutex);
+        QStringList result;
+
+        foreach (const SRequest &request, m_Requests) {
+            result << request.path;
+        }
+
+        return result;
+    }
+
+    /// Заголовки Range полученных запросов, пустые для запросов без него.
+    QList<QByteArray> rangeHeaders() const {
+        QMutexLocker locker(&m_Mutex);
+        QList<QByteArray> result;
+
+        foreach (const SRequest &request, m_Requests) {
+            result << request.range;
+        }
+
+        return result;
+    }
+
+    /// Наибольшее число запросов, ожидавших ответа одновременно.
+    int maxInFlight() const { return m_MaxInFlight.loadAcquire(); }
+
+    /// Забывает запросы и счётчики. Можно вызывать из любого потока.
+    void reset() {
+        QMutexLocker locker(&m_Mutex);
+
+        m_Requests.clear();
+        m_MaxInFlight.storeRelease(m_InFlight.loadAcquire());
+    }
+
+protected:
+    void incomingConnection(qintptr aHandle) override {
+        auto *socket = new QTcpSocket(this);
+        socket->setSocketDescriptor(aHandle);
+
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { readRequests(socket); });
+        connect(socket, &QTcpSocket::bytesWritten, this, [this, socket]() { send(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_Buffers.remove(socket);
+            m_Outputs.remove(socket);
+            socket->deleteLater();
+        });
+    }
+
+private:
+    /// Тело ответа, которое ещё пишется в сокет.
+    struct SOutput {
+        TContent content;
+        qint64 position;
+        qint64 end;
+    };
+
+    void readRequests(QTcpSocket *aSocket) {
+        QByteArray &buffer = m_Buffers[aSocket];
+        buffer += aSocket->readAll();
+
+        for (int end = buffer.indexOf("\r\n\r\n"); end >= 0; end = buffer.indexOf("\r\n\r\n")) {
+            QList<QByteArray> lines = buffer.left(end).split('\n');
+            SRequest request;
+            int length = 0;
+
+            request.path = QString::fromLatin1(lines.first().split(' ').value(1)).mid(1);
+
+            foreach (const QByteArray &line, lines.mid(1)) {
+                QByteArray lower = line.toLower();
+
+                if (lower.startsWith("range:")) {
+                    request.range = line.mid(6).trimmed();
+                } else if (lower.startsWith("content-length:")) {
+                    length = line.mid(15).trimmed().toInt();
+                }
+            }
+
+            if (buffer.size() < end + 4 + length) {
+                return;
+            }
+
+            request.body = buffer.mid(end + 4, length);
+            buffer.remove(0, end + 4 + length);
+
+            {
+                QMutexLocker locker(&m_Mutex);
+                m_Requests << request;
+            }
+
+            if (!dispatch(aSocket, request)) {
+                return;
+            }
+        }
+    }
+
+    /// false - соединение закрыто.
+    bool dispatch(QTcpSocket *aSocket, const SRequest &aRequest) {
+        // Строка запроса нужна только для различения запросов, ответ от неё не зависит.
+        auto it = m_Routes.constFind(aRequest.path.section('?', 0, 0));
+
+        if (it == m_Routes.constEnd()) {
+            aSocket->write("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+            return true;
+        }
+
+        SRoute route = it.value();
+
+        switch (route.action) {
+        case SRoute::Drop:
+            m_Buffers.remove(aSocket);
+            aSocket->abort();
+            return false;
+        case SRoute::Hang:
+            return true;
+        case SRoute::Answer:
+            break;
+        }
+
+        int inFlight = m_InFlight.fetchAndAddOrdered(1) + 1;
+
+        if (inFlight > m_MaxInFlight.loadAcquire()) {
+            m_MaxInFlight.storeRelease(inFlight);
+        }
+
+        QPointer<QTcpSocket> socket(aSocket);
+        QTimer::singleShot(m_Latency + route.delay, this, [this, socket, route, aRequest]() {
+            m_InFlight.fetchAndAddOrdered(-1);
+
+            if (socket) {
+                answer(socket, route, aRequest);
+            }
+        });
+
+        return true;
+    }
+
+    void answer(QTcpSocket *aSocket, SRoute aRoute, const SRequest &aRequest) {
+        if (aRoute.handler) {
+            QByteArray body = aRoute.handler(aRequest);
+
+            aRoute.size = body.size();
+            aRoute.content = [body](qint64 aOffset, qint64 aSize) {
+                return body.mid(static_cast<int>(aOffset), static_cast<int>(aSize));
+            };
+        }
+
+        qint64 begin = 0;
+        QByteArray header = "HTTP/1.1 " + QByteArray::number(aRoute.status) + " " +
+                            (aRoute.status == 200 ? "OK" : "Status") + "\r\n";
+
+        if (m_Ranges && !aRoute.handler && aRequest.range.startsWith("bytes=")) {
+            QList<QByteArray> bounds = aRequest.range.mid(6).split('-');
+            qint64 last = aRoute.size - 1;
+            begin = bounds.value(0).toLongLong();
+
+            if (!bounds.value(1).isEmpty()) {
+                last = qMin(last, bounds.value(1).toLongLong());
+            }
+
+            if (begin > last) {
+                aSocket->write("HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */" +
+                               QByteArray::number(aRoute.size) + "\r\nContent-Length: 0\r\n\r\n");
+                return;
+            }
+
+            header = "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes " +
+                     QByteArray::number(begin) + "-" + QByteArray::number(last) + "/" +
+                     QByteArray::number(aRoute.size) + "\r\n";
+            aRoute.size = last + 1;
+        }
+
+        aSocket->write(header + "Content-Length: " + QByteArray::number(aRoute.size - begin) +
+                       "\r\n\r\n");
+
+        SOutput output = {aRoute.content, begin, aRoute.size};
+        m_Outputs.insert(aSocket, output);
+
+        send(aSocket);
+    }
+
+    /// Дописывает тело ответа, пока очередь сокета не заполнена.
+    void send(QTcpSocket *aSocket) {
+        auto it = m_Outputs.find(aSocket);
+
+        if (it == m_Outputs.end()) {
+            return;
+        }
+
+        SOutput &output = it.value();
+
+        while (output.position < output.end &&
+               aSocket->bytesToWrite() < CHttpStandIn::SocketBacklog) {
+            qint64 chunk = qMin(CHttpStandIn::ChunkSize, output.end - output.position);
+
+            aSocket->write(output.content(output.position, chunk));
+            output.position += chunk;
+        }
+
+        if (output.position >= output.end) {
+            m_Outputs.erase(it);
+        }
+    }
+
+    QHash<QString, SRoute> m_Routes;
+    int m_Latency;
+    bool m_Ranges;
+
+    QHash<QTcpSocket *, QByteArray> m_Buffers;
+    QHash<QTcpSocket *, SOutput> m_Outputs;
+
+    mutable QMutex m_Mutex;
+    QList<SRequest> m_Requests;
+    QAtomicInt m_InFlight;
+    QAtomicInt m_MaxInFlight;
+};
+
+//---------------------------------------------------------------------------
+/// Сервер в своём потоке - для тестов, которые блокируют поток ожиданием ответа.
+class HttpStandInThread : public QThread {
+public:
+    /// Настройка путей, вызывается в потоке сервера до начала приёма соединений.
+    typedef std::function<void(HttpStandIn &aServer)> TSetup;
+
+    HttpStandInThread() : m_Server(nullptr), m_Port(0) {}
+
+    void startAndWait(const TSetup &aSetup) {
+        m_Setup = aSetup;
+
+        start();
+        m_Ready.acquire();
+    }
+
+    QUrl url(const QString &aPath) const {
+        return QUrl(QString("http://127.0.0.1:%1/%2").arg(m_Port).arg(aPath));
+    }
+
+    /// Сервер, пока поток работает. Счётчики и список запросов можно читать из любого потока.
+    HttpStandIn *server() const { return m_Server; }
+
+protected:
+    void run() override {
+        HttpStandIn server;
+        m_Setup(server);
+        server.listen(QHostAddress::LocalHost);
+
+        m_Port = server.serverPort();
+        m_Server = &server;
+        m_Ready.release();
+
+        exec();
+
+        m_Server = nullptr;
+    }
+
+private:
+    TSetup m_Setup;
+    HttpStandIn *m_Server;
+    quint16 m_Port;
+    QSemaphore m_Ready;
+};
+
+//---------------------------------------------------------------------------
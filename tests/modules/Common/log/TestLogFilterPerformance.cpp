@@ -0,0 +1,146 @@
+/* @file Замеры стоимости отфильтрованных и записываемых сообщений лога. */
+
+#include <QtCore/QByteArray>
+#include <QtCore/QElapsedTimer>
+#include <QtTest/QtTest>
+
+#include "SimpleLog.h"
+
+namespace {
+const int Iterations = 1000000;
+
+//---------------------------------------------------------------------------
+/// Лог, который только считает записи: измеряется стоимость фронтенда, а не вывода.
+class CountingLog : public ILog {
+public:
+    CountingLog() : m_Name("Counting"), m_Level(LogLevel::Normal), m_Count(0), m_Bytes(0) {}
+
+    virtual const QString &getName() const { return m_Name; }
+    virtual LogType::Enum getType() const { return LogType::Debug; }
+    virtual const QString &getDestination() const { return m_Name; }
+    virtual void setDestination(const QString &) {}
+    virtual void setLevel(LogLevel::Enum aLevel) { m_Level = aLevel; }
+    virtual bool isEnabled(LogLevel::Enum aLevel) const { return aLevel <= m_Level; }
+    virtual void adjustPadding(int) {}
+    virtual void write(LogLevel::Enum aLevel, const QString &aMessage) {
+        if (isEnabled(aLevel)) {
+            ++m_Count;
+            m_Bytes += aMessage.size();
+        }
+    }
+    virtual void write(LogLevel::Enum aLevel, const QString &aMessage, const QByteArray &aData) {
+        write(aLevel, aMessage + aData.toHex().data());
+    }
+    virtual void logRotate() {}
+
+    int count() const { return m_Count; }
+
+private:
+    QString m_Name;
+    LogLevel::Enum m_Level;
+    int m_Count;
+    qint64 m_Bytes;
+};
+} // namespace
+
+//---------------------------------------------------------------------------
+class TestLogFilterPerformance : public QObject {
+    Q_OBJECT
+
+private slots:
+    void benchmarkEnabled();
+    void benchmarkFilteredEager();
+    void benchmarkFilteredLazy();
+    void benchmarkSimpleLogFiltered();
+
+private:
+    /// Типичное сообщение протокола: форматирование и hex-дамп пакета.
+    QString makeMessage(int aIndex) const {
+        return QString("CCNet: >> {%1} poll %2").arg(QString(m_Packet.toHex())).arg(aIndex);
+    }
+
+    void report(const char *aName, qint64 aNsecs) const {
+        qDebug() << aName << ":" << double(aNsecs) / Iterations << "ns per call";
+    }
+
+    QByteArray m_Packet = QByteArray::fromHex("02030633da81");
+    qint64 m_EagerNsecs = 0;
+};
+
+//---------------------------------------------------------------------------
+void TestLogFilterPerformance::benchmarkEnabled() {
+    CountingLog log;
+    ILog *logPtr = &log;
+    log.setLevel(LogLevel::Debug);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < Iterations; ++i) {
+        LOG(logPtr, LogLevel::Debug, makeMessage(i));
+    }
+
+    report("Enabled LOG", timer.nsecsElapsed());
+    QCOMPARE(log.count(), Iterations);
+}
+
+//---------------------------------------------------------------------------
+void TestLogFilterPerformance::benchmarkFilteredEager() {
+    // Прежнее поведение: сообщение формируется до проверки уровня.
+    CountingLog log;
+    ILog *logPtr = &log;
+    log.setLevel(LogLevel::Normal);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < Iterations; ++i) {
+        logPtr->write(LogLevel::Debug, makeMessage(i));
+    }
+
+    m_EagerNsecs = timer.nsecsElapsed();
+    report("Filtered write() (eager)", m_EagerNsecs);
+    QCOMPARE(log.count(), 0);
+}
+
+//---------------------------------------------------------------------------
+void TestLogFilterPerformance::benchmarkFilteredLazy() {
+    CountingLog log;
+    ILog *logPtr = &log;
+    log.setLevel(LogLevel::Normal);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < Iterations; ++i) {
+        LOG(logPtr, LogLevel::Debug, makeMessage(i));
+    }
+
+    qint64 lazy = timer.nsecsElapsed();
+    report("Filtered LOG (lazy)", lazy);
+    QCOMPARE(log.count(), 0);
+
+    // Проверка уровня - один виртуальный вызов, на порядок дешевле форматирования.
+    QVERIFY(m_EagerNsecs > 0);
+    QVERIFY(lazy * 10 < m_EagerNsecs);
+}
+
+//---------------------------------------------------------------------------
+void TestLogFilterPerformance::benchmarkSimpleLogFiltered() {
+    SimpleLog log("filterBenchmark", LogType::Console, LogLevel::Warning);
+    ILog *logPtr = &log;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < Iterations; ++i) {
+        LOG(logPtr, LogLevel::Debug, makeMessage(i));
+        LOGB(logPtr, LogLevel::Trace, QString("Packet: "), m_Packet);
+    }
+
+    report("Filtered LOG + LOGB on SimpleLog", timer.nsecsElapsed());
+}
+
+//---------------------------------------------------------------------------
+QTEST_MAIN(TestLogFilterPerformance)
+#include "TestLogFilterPerformance.moc"
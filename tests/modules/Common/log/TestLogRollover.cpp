@@ -0,0 +1,198 @@
+/* @file Тесты смены файла лога при смене суток и переводе часов. */
+
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QTimeZone>
+#include <QtTest/QtTest>
+
+#include "DayRollover.h"
+#include "LogWriter.h"
+#include "SimpleLog.h"
+
+namespace {
+const qint64 Hour = 60 * 60 * 1000;
+
+//---------------------------------------------------------------------------
+/// Лог с подменяемыми часами.
+class SimulatedClockLog : public SimpleLog {
+public:
+    explicit SimulatedClockLog(const QString &aName) : SimpleLog(aName), m_Now(0) {}
+
+    void setNow(const QDateTime &aNow) { m_Now = aNow.toMSecsSinceEpoch(); }
+
+protected:
+    virtual qint64 currentMSecs() const { return m_Now; }
+
+private:
+    qint64 m_Now;
+};
+
+//---------------------------------------------------------------------------
+qint64 msecs(const QTimeZone &aZone, int aYear, int aMonth, int aDay, const QTime &aTime) {
+    return QDateTime(QDate(aYear, aMonth, aDay), aTime, aZone).toMSecsSinceEpoch();
+}
+} // namespace
+
+//---------------------------------------------------------------------------
+class TestLogRollover : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    // Границы суток
+    void testMidnight();
+    void testDstSpringForward();
+    void testDstFallBack();
+    void testClockSetBack();
+
+    // Запись в файлы
+    void testLinesFollowSimulatedClock();
+
+private:
+    QStringList readLines(const QString &aFileName);
+
+    QTemporaryDir *m_TempDir = nullptr;
+};
+
+//---------------------------------------------------------------------------
+void TestLogRollover::initTestCase() {
+    m_TempDir = new QTemporaryDir();
+    QVERIFY(m_TempDir->isValid());
+
+    SimpleLog::setLogDirectory(m_TempDir->path());
+}
+
+//---------------------------------------------------------------------------
+void TestLogRollover::cleanupTestCase() {
+    LogWriter::instance()->flush();
+    delete m_TempDir;
+}
+
+//---------------------------------------------------------------------------
+QStringList TestLogRollover::readLines(const QString &aFileName) {
+    LogWriter::instance()->flush();
+
+    QFile file(m_TempDir->path() + "/" + aFileName);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QStringList();
+    }
+
+    return QString::fromUtf8(file.readAll()).split('\n', Qt::SkipEmptyParts);
+}
+
+//---------------------------------------------------------------------------
+void TestLogRollover::testMidnight() {
+    QTimeZone zone = QTimeZone::utc();
+    DayRollover rollover(zone);
+
+    qint64 lastMsec = msecs(zone, 2026, 1, 1, QTime(23, 59, 59, 999));
+    QVERIFY(rollover.isExpired(lastMsec));
+
+    rollover.reset(lastMsec);
+    QCOMPARE(rollover.dateString(), QString("2026.01.01"));
+    QVERIFY(!rollover.isExpired(lastMsec));
+    QVERIFY(!rollover.isExpired(msecs(zone, 2026, 1, 1, QTime(0, 0))));
+    QVERIFY(rollover.isExpired(lastMsec + 1));
+
+    rollover.reset(lastMsec + 1);
+    QCOMPARE(rollover.dateString(), QString("2026.01.02"));
+    QCOMPARE(rollover.end() - rollover.begin(), 24 * Hour);
+}
+
+//---------------------------------------------------------------------------
+void TestLogRollover::testDstSpringForward() {
+    QTimeZone zone("Europe/Berlin");
+
+    if (!zone.isValid()) {
+        QSKIP("Time zone database is not available");
+    }
+
+    DayRollover rollover(zone);
+    rollover.reset(msecs(zone, 2026, 3, 29, QTime(12, 0)));
+
+    // 02:00 -> 03:00: сутки короче на час
+    QCOMPARE(rollover.end() - rollover.begin(), 23 * Hour);
+    QVERIFY(!rollover.isExpired(msecs(zone, 2026, 3, 29, QTime(23, 59, 59))));
+    QVERIFY(rollover.isExpired(msecs(zone, 2026, 3, 30, QTime(0, 0))));
+}
+
+//---------------------------------------------------------------------------
+void TestLogRollover::testDstFallBack() {
+    QTimeZone zone("Europe/Berlin");
+
+    if (!zone.isValid()) {
+        QSKIP("Time zone database is not available");
+    }
+
+    DayRollover rollover(zone);
+    rollover.reset(msecs(zone, 2026, 10, 25, QTime(1, 0)));
+
+    // 03:00 -> 02:00: сутки длиннее на час, повторный час остаётся в тех же сутках
+    QCOMPARE(rollover.end() - rollover.begin(), 25 * Hour);
+    QCOMPARE(rollover.dateString(), QString("2026.10.25"));
+    QVERIFY(!rollover.isExpired(msecs(zone, 2026, 10, 25, QTime(2, 30)) + Hour));
+    QVERIFY(rollover.isExpired(msecs(zone, 2026, 10, 26, QTime(0, 0))));
+}
+
+//---------------------------------------------------------------------------
+void TestLogRollover::testClockSetBack() {
+    QTimeZone zone = QTimeZone::utc();
+    DayRollover rollover(zone);
+
+    // Синхронизация времени перевела часы из новых суток обратно в предыдущие
+    rollover.reset(msecs(zone, 2026, 1, 2, QTime(0, 0, 30)));
+    qint64 setBack = msecs(zone, 2026, 1, 1, QTime(23, 59, 50));
+    QVERIFY(rollover.isExpired(setBack));
+
+    rollover.reset(setBack);
+    QCOMPARE(rollover.dateString(), QString("2026.01.01"));
+}
+
+//---------------------------------------------------------------------------
+void TestLogRollover::testLinesFollowSimulatedClock() {
+    const int linesPerDay = 1000;
+
+    SimulatedClockLog log("rollover");
+    QDate day1(2026, 1, 1);
+    QDate day2 = day1.addDays(1);
+
+    // Последние миллисекунды первых суток
+    log.setNow(QDateTime(day1, QTime(23, 59, 59, 0)));
+
+    for (int i = 0; i < linesPerDay; ++i) {
+        log.write(LogLevel::Normal, QString("day1 line %1").arg(i));
+    }
+
+    // Полночь
+    log.setNow(QDateTime(day2, QTime(0, 0, 0, 1)));
+
+    for (int i = 0; i < linesPerDay; ++i) {
+        log.write(LogLevel::Normal, QString("day2 line %1").arg(i));
+    }
+
+    // Синхронизация времени вернула часы в предыдущие сутки
+    log.setNow(QDateTime(day1, QTime(23, 59, 58)));
+    log.write(LogLevel::Normal, "day1 after time sync");
+
+    // И снова вперёд
+    log.setNow(QDateTime(day2, QTime(0, 1)));
+    log.write(LogLevel::Normal, "day2 after time sync");
+
+    QStringList day1Lines = readLines("2026.01.01 rollover.log").filter("day");
+    QStringList day2Lines = readLines("2026.01.02 rollover.log").filter("day");
+
+    QCOMPARE(day1Lines.size(), linesPerDay + 1);
+    QCOMPARE(day2Lines.size(), linesPerDay + 1);
+    QCOMPARE(day1Lines.filter("day2").size(), 0);
+    QCOMPARE(day2Lines.filter("day1").size(), 0);
+    QVERIFY(day1Lines.last().endsWith("day1 after time sync"));
+    QVERIFY(day2Lines.last().endsWith("day2 after time sync"));
+}
+
+//---------------------------------------------------------------------------
+QTEST_MAIN(TestLogRollover)
+#include "TestLogRollover.moc"
@@ -0,0 +1,230 @@
+/* @file Замеры производительности и проверки фонового писателя логов. */
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+#include <QtTest/QtTest>
+
+#include <algorithm>
+
+#include "DestinationFile.h"
+#include "LogWriter.h"
+
+class TestLogWriterPerformance : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    // Замеры
+    void benchmarkSyncWrite();
+    void benchmarkAsyncWrite();
+    void benchmarkAsyncLatency();
+
+    // Корректность
+    void testConcurrentProducers();
+    void testErrorFlushesImmediately();
+    void testFatalIsSynchronous();
+
+private:
+    DestinationFilePtr openFile(const QString &aName);
+    int countLines(const QString &aName);
+    QString makeLine(int aIndex) const;
+
+    QTemporaryDir *m_TempDir = nullptr;
+};
+
+namespace {
+const int LineCount = 100000;
+const int LatencySamples = 20000;
+const int ProducerThreads = 4;
+const int LinesPerThread = 25000;
+} // namespace
+
+//---------------------------------------------------------------------------
+void TestLogWriterPerformance::initTestCase() {
+    m_TempDir = new QTemporaryDir();
+    QVERIFY(m_TempDir->isValid());
+}
+
+//---------------------------------------------------------------------------
+void TestLogWriterPerformance::cleanupTestCase() {
+    LogWriter::instance()->flush();
+    delete m_TempDir;
+}
+
+//---------------------------------------------------------------------------
+DestinationFilePtr TestLogWriterPerformance::openFile(const QString &aName) {
+    DestinationFilePtr file(new DestinationFile());
+    file->open(m_TempDir->path() + "/" + aName);
+
+    return file;
+}
+
+//---------------------------------------------------------------------------
+int TestLogWriterPerformance::countLines(const QString &aName) {
+    QFile file(m_TempDir->path() + "/" + aName);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+
+    return file.readAll().count('\n');
+}
+
+//---------------------------------------------------------------------------
+QString TestLogWriterPerformance::makeLine(int aIndex) const {
+    return QString("12:00:00.000 T:0000abcd [D]  Poll device status, answer %1\n").arg(aIndex);
+}
+
+//---------------------------------------------------------------------------
+void TestLogWriterPerformance::benchmarkSyncWrite() {
+    // Прежнее поведение: запись и сброс на диск каждой строки в вызывающем потоке.
+    DestinationFilePtr file = openFile("sync.log");
+    QVERIFY(file->isOpen());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < LineCount; ++i) {
+        file->writeRaw(makeLine(i).toUtf8(), true);
+    }
+
+    qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+
+    qDebug() << "Sync write:" << LineCount << "lines in" << elapsed << "ms,"
+             << (LineCount * 1000LL / elapsed) << "lines/s";
+
+    QCOMPARE(countLines("sync.log"), LineCount);
+}
+
+//---------------------------------------------------------------------------
+void TestLogWriterPerformance::benchmarkAsyncWrite() {
+    DestinationFilePtr file = openFile("async.log");
+    QVERIFY(file->isOpen());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < LineCount; ++i) {
+        file->write(makeLine(i), LogLevel::Debug);
+    }
+
+    qint64 enqueued = qMax<qint64>(1, timer.elapsed());
+
+    LogWriter::instance()->flush();
+
+    qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+
+    qDebug() << "Async write:" << LineCount << "lines enqueued in" << enqueued << "ms,"
+             << "on disk in" << elapsed << "ms," << (LineCount * 1000LL / elapsed) << "lines/s";
+
+    QCOMPARE(countLines("async.log"), LineCount);
+}
+
+//---------------------------------------------------------------------------
+void TestLogWriterPerformance::benchmarkAsyncLatency() {
+    DestinationFilePtr syncFile = openFile("latency_sync.log");
+    DestinationFilePtr asyncFile = openFile("latency_async.log");
+
+    QVector<qint64> syncSamples;
+    QVector<qint64> asyncSamples;
+    syncSamples.reserve(LatencySamples);
+    asyncSamples.reserve(LatencySamples);
+
+    QElapsedTimer timer;
+
+    for (int i = 0; i < LatencySamples; ++i) {
+        QString line = makeLine(i);
+
+        timer.start();
+        syncFile->writeRaw(line.toUtf8(), true);
+        syncSamples.append(timer.nsecsElapsed());
+
+        timer.start();
+        asyncFile->write(line, LogLevel::Normal);
+        asyncSamples.append(timer.nsecsElapsed());
+    }
+
+    LogWriter::instance()->flush();
+
+    auto report = [](const char *aName, QVector<qint64> &aSamples) {
+        std::sort(aSamples.begin(), aSamples.end());
+
+        qDebug() << aName << "latency, us: p50" << aSamples[aSamples.size() / 2] / 1000.0 << "p99"
+                 << aSamples[aSamples.size() * 99 / 100] / 1000.0 << "max"
+                 << aSamples.last() / 1000.0;
+    };
+
+    report("Sync", syncSamples);
+    report("Async", asyncSamples);
+
+    QCOMPARE(countLines("latency_async.log"), LatencySamples);
+}
+
+//---------------------------------------------------------------------------
+void TestLogWriterPerformance::testConcurrentProducers() {
+    DestinationFilePtr file = openFile("concurrent.log");
+    QList<QThread *> threads;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int t = 0; t < ProducerThreads; ++t) {
+        threads.append(QThread::create([this, file, t]() {
+            for (int i = 0; i < LinesPerThread; ++i) {
+                file->write(makeLine(t * LinesPerThread + i), LogLevel::Normal);
+            }
+        }));
+    }
+
+    for (QThread *thread : threads) {
+        thread->start();
+    }
+
+    for (QThread *thread : threads) {
+        thread->wait();
+        delete thread;
+    }
+
+    LogWriter::instance()->flush();
+
+    qDebug() << "Concurrent write:" << ProducerThreads * LinesPerThread << "lines in"
+             << timer.elapsed() << "ms";
+
+    QCOMPARE(countLines("concurrent.log"), ProducerThreads * LinesPerThread);
+}
+
+//---------------------------------------------------------------------------
+void TestLogWriterPerformance::testErrorFlushesImmediately() {
+    // Обычные записи ждут интервала сброса, ошибки - нет.
+    LogWriter::instance()->setFlushInterval(60 * 1000);
+
+    DestinationFilePtr file = openFile("error.log");
+    file->write(makeLine(1), LogLevel::Normal);
+    file->write(makeLine(2), LogLevel::Error);
+
+    QTRY_COMPARE_WITH_TIMEOUT(countLines("error.log"), 2, 5000);
+
+    LogWriter::instance()->setFlushInterval(CLogWriter::FlushInterval);
+}
+
+//---------------------------------------------------------------------------
+void TestLogWriterPerformance::testFatalIsSynchronous() {
+    LogWriter::instance()->setFlushInterval(60 * 1000);
+
+    DestinationFilePtr file = openFile("fatal.log");
+    file->write(makeLine(1), LogLevel::Debug);
+    file->write(makeLine(2), LogLevel::Fatal);
+
+    QCOMPARE(countLines("fatal.log"), 2);
+
+    LogWriter::instance()->setFlushInterval(CLogWriter::FlushInterval);
+}
+
+//---------------------------------------------------------------------------
+QTEST_MAIN(TestLogWriterPerformance)
+#include "TestLogWriterPerformance.moc"
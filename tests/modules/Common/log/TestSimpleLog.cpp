@@ -18,6 +18,9 @@ private slots:
     void testBasicWrite();
     void testDifferentLevels();
     void testSetLevel();
+    void testIsEnabled();
+    void testLazyMacroSkipsFormatting();
+    void testLevelOverride();
 
     // Тесты свёртки дубликатов
     void testDuplicateSuppression();
@@ -102,6 +105,73 @@ void TestSimpleLog::testSetLevel() {
     QVERIFY(true);
 }
 
+//---------------------------------------------------------------------------
+void TestSimpleLog::testIsEnabled() {
+    SimpleLog log("testIsEnabled", LogType::Console, LogLevel::Warning);
+
+    QVERIFY(log.isEnabled(LogLevel::Error));
+    QVERIFY(log.isEnabled(LogLevel::Warning));
+    QVERIFY(!log.isEnabled(LogLevel::Normal));
+    QVERIFY(!log.isEnabled(LogLevel::Debug));
+
+    // Уровень меняется без пересоздания лога
+    log.setLevel(LogLevel::Trace);
+    QVERIFY(log.isEnabled(LogLevel::Debug));
+    QVERIFY(log.isEnabled(LogLevel::Trace));
+}
+
+//---------------------------------------------------------------------------
+void TestSimpleLog::testLazyMacroSkipsFormatting() {
+    SimpleLog log("testLazy", LogType::Console, LogLevel::Warning);
+    ILog *logPtr = &log;
+
+    int evaluated = 0;
+    auto message = [&evaluated]() {
+        ++evaluated;
+        return QString("Expensive message");
+    };
+
+    // Отфильтрованное сообщение не должно вычисляться
+    LOG(logPtr, LogLevel::Debug, message());
+    LOGB(logPtr, LogLevel::Normal, message(), QByteArray("\x01\x02"));
+    QCOMPARE(evaluated, 0);
+
+    // Разрешённое - вычисляется ровно один раз
+    LOG(logPtr, LogLevel::Error, message());
+    QCOMPARE(evaluated, 1);
+}
+
+//---------------------------------------------------------------------------
+void TestSimpleLog::testLevelOverride() {
+    ILog *log = ILog::getInstance("testOverride", LogType::Console);
+    ILog *other = ILog::getInstance("testOverrideOther", LogType::Console);
+
+    ILog::setGlobalLevel(LogLevel::Warning);
+    QVERIFY(!log->isEnabled(LogLevel::Debug));
+    QVERIFY(!other->isEnabled(LogLevel::Normal));
+
+    // Персональный уровень применяется к уже созданному логу
+    ILog::setLevelOverride("testOverride", LogLevel::Debug);
+    QVERIFY(log->isEnabled(LogLevel::Debug));
+    QVERIFY(!other->isEnabled(LogLevel::Debug));
+
+    // Глобальный уровень не перекрывает персональный
+    ILog::setGlobalLevel(LogLevel::Error);
+    QVERIFY(log->isEnabled(LogLevel::Debug));
+    QVERIFY(!other->isEnabled(LogLevel::Warning));
+
+    // Логи, созданные после установки, получают персональный уровень
+    ILog *late = ILog::getInstance("testOverride", LogType::Debug);
+    QVERIFY(late->isEnabled(LogLevel::Debug));
+
+    ILog::clearLevelOverride("testOverride");
+    QVERIFY(!log->isEnabled(LogLevel::Warning));
+    QVERIFY(!late->isEnabled(LogLevel::Warning));
+
+    ILog::setGlobalLevel(LogLevel::Normal);
+    QVERIFY(log->isEnabled(LogLevel::Normal));
+}
+
 //---------------------------------------------------------------------------
 void TestSimpleLog::testDuplicateSuppression() {
     SimpleLog log("testDupSuppress", LogType::Console, LogLevel::Normal);
@@ -0,0 +1,240 @@
+#include <QtCore/QElapsedTimer>
+#include <QtTest/QtTest>
+
+#include <Common/ILog.h>
+
+#include <NetworkTaskManager/NetworkTaskManager.h>
+
+#include "Common/ConnectionProbe.h"
+
+#include "../../common/HttpStandIn.h"
+
+namespace {
+const int Delay = 300;
+const int Timeout = 1000;
+
+IConnection::CheckUrl host(const QUrl &aUrl) {
+    return IConnection::CheckUrl(aUrl, "OK");
+}
+} // namespace
+
+class TestConnectionProbe : public QObject {
+    Q_OBJECT
+
+public:
+    TestConnectionProbe() : m_Log(ILog::getInstance("TestConnectionProbe")), m_Network(m_Log) {}
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testFirstSuccessWins();
+    void testAllHostsFail();
+    void testQuorum();
+    void testBackoff();
+    void testAsyncCachedHealth();
+    void testLatencyHistory();
+    void testAnswersAfterSettle();
+
+private:
+    QUrl url(const QString &aPath) const { return m_Servers.url(aPath); }
+
+    ILog *m_Log;
+    NetworkTaskManager m_Network;
+
+    // The probe blocks its thread in check(), so the stand-in hosts run in a thread of their
+    // own: "answer" answers "OK", "delayed" answers after Delay ms, "drop" drops the connection
+    // once the request arrives and "hang" never answers.
+    HttpStandInThread m_Servers;
+    QUrl m_Refused;
+};
+
+//---------------------------------------------------------------------------
+void TestConnectionProbe::initTestCase() {
+    m_Servers.startAndWait([](HttpStandIn &aServer) {
+        aServer.serve("answer", "OK");
+        aServer.serve("delayed", "OK", Delay);
+        aServer.drop("drop");
+        aServer.hang("hang");
+    });
+
+    m_Refused = HttpStandIn::refusedUrl("ping");
+}
+
+//---------------------------------------------------------------------------
+void TestConnectionProbe::cleanupTestCase() {
+    m_Servers.quit();
+    m_Servers.wait();
+}
+
+//---------------------------------------------------------------------------
+void TestConnectionProbe::testFirstSuccessWins() {
+    ConnectionProbe probe(&m_Network, m_Log);
+    probe.setTimeout(10 * Timeout);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // The primary host hangs: the answer of the last one must not wait for its timeout.
+    QVERIFY(probe.check(QList<IConnection::CheckUrl>()
+                        << host(url("hang")) << host(url("delayed"))
+                        << host(url("answer"))));
+
+    ConnectionProbe::SHealth health = probe.getHealth();
+
+    QVERIFY(timer.elapsed() < Timeout);
+    QVERIFY(health.alive);
+    QCOMPARE(health.host, url("answer"));
+    QVERIFY(health.checked.isValid());
+    QVERIFY(!probe.isRunning());
+}
+
+//---------------------------------------------------------------------------
+void TestConnectionProbe::testAllHostsFail() {
+    ConnectionProbe probe(&m_Network, m_Log);
+    probe.setTimeout(Timeout);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVERIFY(!probe.check(QList<IConnection::CheckUrl>()
+                         << host(url("drop")) << host(m_Refused)
+                         << host(url("hang")) << host(url("hang"))));
+
+    // One timeout for all hosts rather than the sum of them.
+    qint64 elapsed = timer.elapsed();
+    QVERIFY(elapsed >= Timeout - 1);
+    QVERIFY(elapsed < 2 * Timeout);
+    QVERIFY(!probe.getHealth().alive);
+    QCOMPARE(probe.getHealth().latency, qint64(-1));
+
+    // A wrong answer is a failure too.
+    QVERIFY(!probe.check(QList<IConnection::CheckUrl>()
+                         << IConnection::CheckUrl(url("answer"), "pong")));
+}
+
+//---------------------------------------------------------------------------
+void TestConnectionProbe::testQuorum() {
+    ConnectionProbe probe(&m_Network, m_Log);
+    probe.setTimeout(Timeout);
+    probe.setQuorum(2);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVERIFY(probe.check(QList<IConnection::CheckUrl>()
+                        << host(url("answer")) << host(url("delayed"))
+                        << host(url("hang"))));
+    QVERIFY(timer.elapsed() >= Delay - 1);
+    QVERIFY(timer.elapsed() < Timeout);
+
+    // Once the quorum is out of reach the hanging host is not waited for.
+    timer.restart();
+    QVERIFY(!probe.check(QList<IConnection::CheckUrl>()
+                         << host(url("answer")) << host(url("drop"))
+                         << host(m_Refused) << host(url("hang"))));
+    QVERIFY(timer.elapsed() < Timeout);
+}
+
+//---------------------------------------------------------------------------
+void TestConnectionProbe::testBackoff() {
+    const qint64 backoff = 500;
+
+    ConnectionProbe probe(&m_Network, m_Log);
+    probe.setTimeout(Timeout);
+    probe.setBackoff(backoff, 4 * backoff);
+
+    QUrl refused = m_Refused;
+    QList<IConnection::CheckUrl> hosts;
+    hosts << host(refused) << host(url("delayed"));
+
+    QVERIFY(probe.check(hosts));
+    ConnectionProbe::SHostStats stats = probe.getHostStats(refused);
+    QCOMPARE(stats.failures, 1);
+    QVERIFY(stats.retryAt > 0);
+
+    // The dead host is skipped while it backs off ...
+    QVERIFY(probe.check(hosts));
+    QCOMPARE(probe.getHostStats(refused).failures, 1);
+
+    // ... and probed again afterwards with a doubled pause.
+    QTest::qWait(backoff + 100);
+    QVERIFY(probe.check(hosts));
+
+    ConnectionProbe::SHostStats again = probe.getHostStats(refused);
+    QCOMPARE(again.failures, 2);
+    QVERIFY(again.retryAt - stats.retryAt >= 2 * backoff);
+
+    // With every host backing off they are all probed anyway.
+    QVERIFY(!probe.check(QList<IConnection::CheckUrl>() << host(refused)));
+    QCOMPARE(probe.getHostStats(refused).failures, 3);
+}
+
+//---------------------------------------------------------------------------
+void TestConnectionProbe::testAsyncCachedHealth() {
+    ConnectionProbe probe(&m_Network, m_Log);
+    probe.setTimeout(Timeout);
+
+    QSignalSpy spy(&probe, SIGNAL(finished(bool)));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVERIFY(probe.start(QList<IConnection::CheckUrl>() << host(url("delayed"))));
+    QVERIFY(timer.elapsed() < Delay / 2);
+    QVERIFY(probe.isRunning());
+    QVERIFY(!probe.getHealth().checked.isValid());
+
+    // A second round is refused while the first one runs.
+    QVERIFY(!probe.start(QList<IConnection::CheckUrl>() << host(url("answer"))));
+
+    QVERIFY(spy.wait(2 * Timeout));
+    QCOMPARE(spy.first().first().toBool(), true);
+
+    ConnectionProbe::SHealth health = probe.getHealth();
+    QVERIFY(health.alive);
+    QVERIFY(health.latency >= Delay - 1);
+    QVERIFY(!probe.isRunning());
+}
+
+//---------------------------------------------------------------------------
+void TestConnectionProbe::testLatencyHistory() {
+    ConnectionProbe probe(&m_Network, m_Log);
+    QList<IConnection::CheckUrl> hosts;
+    hosts << host(url("answer"));
+
+    for (int i = 0; i < CConnectionProbe::HistorySize + 4; ++i) {
+        QVERIFY(probe.check(hosts));
+    }
+
+    ConnectionProbe::SHostStats stats = probe.getHostStats(url("answer"));
+
+    QCOMPARE(stats.latencies.size(), CConnectionProbe::HistorySize);
+    QCOMPARE(stats.failures, 0);
+    QVERIFY(stats.averageLatency() >= 0);
+    QVERIFY(stats.averageLatency() < Timeout);
+}
+
+//---------------------------------------------------------------------------
+void TestConnectionProbe::testAnswersAfterSettle() {
+    ConnectionProbe probe(&m_Network, m_Log);
+    probe.setTimeout(Timeout);
+
+    // The first answer settles the round, the rest arrive while it is being finished and must
+    // not be removed from the network manager once more.
+    QList<IConnection::CheckUrl> hosts;
+    hosts << host(url("answer")) << host(url("answer"))
+          << host(url("answer")) << host(url("delayed"));
+
+    for (int i = 0; i < 20; ++i) {
+        QVERIFY(probe.check(hosts));
+    }
+
+    QTest::qWait(Delay + 100);
+
+    QVERIFY(probe.check(QList<IConnection::CheckUrl>() << host(url("delayed"))));
+    QVERIFY(probe.getHealth().latency >= Delay - 1);
+}
+
+QTEST_MAIN(TestConnectionProbe)
+#include "TestConnectionProbe.moc"
@@ -0,0 +1,317 @@
+/* @file Тесты криптодвижка: корректность на сгенерированных ключах и производительность. */
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+
+#include <Crypt/CryptEngine.h>
+#include <functional>
+
+namespace {
+const ulong SerialNumber = 100500;
+const char Password[] = "test-password";
+
+const int PrimaryKeyPair = 1;
+const int ReleasedKeyPair = 2;
+const int BenchmarkKeyPair = 10; // пары BenchmarkKeyPair..BenchmarkKeyPair + 7
+const int BenchmarkSignatures = 400;
+const int ThreadCounts[] = {1, 2, 4, 8};
+
+/// Запускает aWork в aThreads потоках, aWork получает номер потока. Возвращает время в мс.
+qint64 runThreads(int aThreads, const std::function<void(int)> &aWork) {
+    QList<QThread *> threads;
+
+    for (int i = 0; i < aThreads; ++i) {
+        threads << QThread::create(aWork, i);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    foreach (QThread *thread, threads) {
+        thread->start();
+    }
+
+    foreach (QThread *thread, threads) {
+        thread->wait();
+        delete thread;
+    }
+
+    return qMax(qint64(1), timer.elapsed());
+}
+} // namespace
+
+class TestCryptEngine : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testSignVerify();
+    void testEncryptDecrypt();
+    void testBatch();
+    void testConcurrentSign();
+    void testReleaseWhileSigning();
+    void benchmarkThreads();
+
+private:
+    /// Загружает сгенерированную пару ключей под номером aKeyPair.
+    bool load(int aKeyPair);
+
+    QTemporaryDir m_KeysDir;
+    QString m_SecretKeyPath;
+    QString m_PublicKeyPath;
+    CryptEngine m_Engine;
+};
+
+//---------------------------------------------------------------------------
+void TestCryptEngine::initTestCase() {
+    QVERIFY(m_KeysDir.isValid());
+    QVERIFY(m_Engine.initialize());
+
+    QString error;
+
+    // Открытый ключ пары - собственный, поэтому ответ проверяется той же парой.
+    QVERIFY2(m_Engine.createKeyPair(
+                 m_KeysDir.path(), "test", "test", Password, SerialNumber, error),
+             qPrintable(error));
+
+    m_SecretKeyPath = m_KeysDir.filePath("tests.key");
+    m_PublicKeyPath = m_KeysDir.filePath("testp.key");
+
+    QVERIFY(load(PrimaryKeyPair));
+}
+
+//---------------------------------------------------------------------------
+void TestCryptEngine::cleanupTestCase() {
+    m_Engine.shutdown();
+}
+
+//---------------------------------------------------------------------------
+bool TestCryptEngine::load(int aKeyPair) {
+    QString error;
+
+    bool result = m_Engine.loadKeyPair(aKeyPair,
+                                       CCrypt::ETypeEngine::File,
+                                       m_SecretKeyPath,
+                                       Password,
+                                       m_PublicKeyPath,
+                                       SerialNumber,
+                                       SerialNumber,
+                                       error);
+    if (!result) {
+        qWarning() << "load key pair" << aKeyPair << error;
+    }
+
+    return result;
+}
+
+//---------------------------------------------------------------------------
+void TestCryptEngine::testSignVerify() {
+    QString error;
+    QByteArray request("SESSION=1\r\nNUMBER=992900000000\r\nAMOUNT=10.00\r\n");
+    QByteArray signature;
+    QByteArray original;
+
+    QVERIFY2(m_Engine.sign(PrimaryKeyPair, request, signature, error), qPrintable(error));
+    QVERIFY2(m_Engine.verify(PrimaryKeyPair, signature, original, error), qPrintable(error));
+    QCOMPARE(original, request);
+
+    QByteArray detached;
+
+    QVERIFY2(m_Engine.signDetach(PrimaryKeyPair, request, detached, error), qPrintable(error));
+    QVERIFY2(m_Engine.verifyDetach(PrimaryKeyPair, request, detached, error), qPrintable(error));
+    QVERIFY(!m_Engine.verifyDetach(PrimaryKeyPair, request + "X", detached, error));
+
+    // Запрос больше кешируемого буфера и следом короткий: буфер потока не портит результат.
+    QByteArray large(100 * 1024, 'a');
+    QByteArray largeSignature;
+
+    QVERIFY2(m_Engine.sign(PrimaryKeyPair, large, largeSignature, error), qPrintable(error));
+    QVERIFY(m_Engine.sign(PrimaryKeyPair, request, signature, error));
+    QVERIFY(m_Engine.verify(PrimaryKeyPair, largeSignature, original, error));
+    QCOMPARE(original, large);
+    QVERIFY(m_Engine.verify(PrimaryKeyPair, signature, original, error));
+    QCOMPARE(original, request);
+
+    QVERIFY(!m_Engine.sign(12345, request, signature, error));
+    QCOMPARE(error, QString("key pair not found"));
+}
+
+//---------------------------------------------------------------------------
+void TestCryptEngine::testEncryptDecrypt() {
+    QString error;
+    QByteArray data("card data");
+    QByteArray encrypted;
+    QByteArray decrypted;
+
+    QVERIFY2(m_Engine.encrypt(PrimaryKeyPair, data, encrypted, error), qPrintable(error));
+    QVERIFY2(m_Engine.decrypt(PrimaryKeyPair, encrypted, decrypted, error), qPrintable(error));
+    QCOMPARE(decrypted, data);
+
+    QByteArray longData(20 * 1024, 'b');
+
+    QVERIFY2(m_Engine.encryptLong(PrimaryKeyPair, longData, encrypted, error), qPrintable(error));
+    QVERIFY2(m_Engine.decryptLong(PrimaryKeyPair, encrypted, decrypted, error),
+             qPrintable(error));
+    QCOMPARE(decrypted, longData);
+}
+
+//---------------------------------------------------------------------------
+void TestCryptEngine::testBatch() {
+    QString error;
+    QList<QByteArray> requests;
+
+    for (int i = 0; i < 50; ++i) {
+        requests << QByteArray("REQUEST=") + QByteArray::number(i);
+    }
+
+    QList<QByteArray> signatures;
+    QList<QByteArray> originals;
+
+    QVERIFY2(m_Engine.signBatch(PrimaryKeyPair, requests, signatures, error), qPrintable(error));
+    QCOMPARE(signatures.size(), requests.size());
+
+    QVERIFY2(m_Engine.verifyBatch(PrimaryKeyPair, signatures, originals, error),
+             qPrintable(error));
+    QCOMPARE(originals, requests);
+
+    // Подпись пакета совпадает по смыслу с одиночной.
+    QByteArray original;
+    QVERIFY(m_Engine.verify(PrimaryKeyPair, signatures.at(7), original, error));
+    QCOMPARE(original, requests.at(7));
+
+    signatures[3] = "broken";
+
+    QVERIFY(!m_Engine.verifyBatch(PrimaryKeyPair, signatures, originals, error));
+    QVERIFY2(error.startsWith("response 3:"), qPrintable(error));
+}
+
+//---------------------------------------------------------------------------
+void TestCryptEngine::testConcurrentSign() {
+    QVERIFY(load(PrimaryKeyPair + 100));
+
+    QAtomicInt failures(0);
+
+    // Подпись и проверка одной парой и подпись соседней парой одновременно.
+    runThreads(4, [&](int aThread) {
+        int keyPair = (aThread % 2) ? PrimaryKeyPair : PrimaryKeyPair + 100;
+
+        for (int i = 0; i < 25; ++i) {
+            QString error;
+            QByteArray request = QByteArray::number(aThread) + ":" + QByteArray::number(i);
+            QByteArray signature;
+            QByteArray original;
+
+            if (!m_Engine.sign(keyPair, request, signature, error) ||
+                !m_Engine.verify(PrimaryKeyPair, signature, original, error) ||
+                original != request) {
+                failures.ref();
+            }
+        }
+    });
+
+    QCOMPARE(failures.loadRelaxed(), 0);
+    QVERIFY(m_Engine.releaseKeyPair(PrimaryKeyPair + 100));
+}
+
+//---------------------------------------------------------------------------
+void TestCryptEngine::testReleaseWhileSigning() {
+    QVERIFY(load(ReleasedKeyPair));
+
+    QAtomicInt signatures(0);
+    QAtomicInt unexpected(0);
+
+    runThreads(5, [&](int aThread) {
+        if (aThread == 0) {
+            while (signatures.loadAcquire() < 10) {
+                QThread::yieldCurrentThread();
+            }
+
+            m_Engine.releaseKeyPair(ReleasedKeyPair);
+            return;
+        }
+
+        for (;;) {
+            QString error;
+            QByteArray signature;
+
+            if (m_Engine.sign(ReleasedKeyPair, "data", signature, error)) {
+                signatures.ref();
+            } else {
+                // Выгрузка - единственная допустимая причина отказа.
+                if (error != "key pair not found") {
+                    unexpected.ref();
+                }
+
+                return;
+            }
+        }
+    });
+
+    QCOMPARE(unexpected.loadRelaxed(), 0);
+    QVERIFY(m_Engine.getKeyPairSerialNumber(ReleasedKeyPair).isEmpty());
+    QVERIFY(!m_Engine.releaseKeyPair(ReleasedKeyPair));
+}
+
+//---------------------------------------------------------------------------
+void TestCryptEngine::benchmarkThreads() {
+    for (int i = 0; i < 8; ++i) {
+        QVERIFY(load(BenchmarkKeyPair + i));
+    }
+
+    QMutex globalMutex;
+    QAtomicInt failures(0);
+
+    for (int threads : ThreadCounts) {
+        int perThread = BenchmarkSignatures / threads;
+
+        auto work = [&](int aKeyPair, QMutex *aGlobalMutex) {
+            for (int i = 0; i < perThread; ++i) {
+                QString error;
+                QByteArray signature;
+                QByteArray original;
+                QByteArray request = "AMOUNT=" + QByteArray::number(i);
+
+                // Прежняя схема: один мьютекс на все операции движка.
+                if (aGlobalMutex) {
+                    aGlobalMutex->lock();
+                }
+
+                bool ok = m_Engine.sign(aKeyPair, request, signature, error) &&
+                          m_Engine.verify(aKeyPair, signature, original, error);
+
+                if (aGlobalMutex) {
+                    aGlobalMutex->unlock();
+                }
+
+                if (!ok || original != request) {
+                    failures.ref();
+                }
+            }
+        };
+
+        qint64 global = runThreads(threads, [&](int aThread) {
+            work(BenchmarkKeyPair + aThread, &globalMutex);
+        });
+        qint64 shared = runThreads(threads, [&](int) { work(BenchmarkKeyPair, nullptr); });
+        qint64 perKey = runThreads(threads, [&](int aThread) {
+            work(BenchmarkKeyPair + aThread, nullptr);
+        });
+
+        int total = perThread * threads;
+
+        qDebug() << threads << "threads," << total << "sign+verify: global lock"
+                 << total * 1000 / global << "ops/s, one key pair" << total * 1000 / shared
+                 << "ops/s, key pair per thread" << total * 1000 / perKey << "ops/s";
+    }
+
+    QCOMPARE(failures.loadRelaxed(), 0);
+}
+
+QTEST_MAIN(TestCryptEngine)
+#include "TestCryptEngine.moc"
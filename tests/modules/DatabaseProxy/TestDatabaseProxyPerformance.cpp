@@ -0,0 +1,443 @@
+/* @file Замеры производительности и проверки SQLiteDatabaseProxy. */
+
+#include <QtCore/QDateTime>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QScopedPointer>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+#include <QtTest/QtTest>
+
+#include <DatabaseProxy/DatabaseTransaction.h>
+#include <DatabaseProxy/IDatabaseProxy.h>
+#include <DatabaseProxy/IDatabaseQuery.h>
+
+#include "../../common/DatabaseFixture.h"
+#include "StatementCache.h"
+
+//---------------------------------------------------------------------------
+class TestDatabaseProxyPerformance : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    // Корректность
+    void testStatementCacheLru();
+    void testStatementReuse();
+    void testReopenDropsStatements();
+    void testPerformanceProfile();
+
+    // Замеры
+    void benchmarkPaymentWorkload();
+
+private:
+    bool openDatabase(const QString &aName, const SDatabasePerformance &aPerformance);
+
+    bool createPayment(qint64 &aPayment);
+    bool savePayment(qint64 aPayment, int aStatus, int aParameters);
+    bool addNote(qint64 aPayment);
+    bool performEncashment(qint64 aFirstPayment);
+
+    /// Прогоняет платёжную нагрузку и возвращает число транзакций в секунду.
+    double runWorkload(const QString &aName, const SDatabasePerformance &aPerformance);
+
+    DatabaseFixture *m_Fixture = nullptr;
+    IDatabaseProxy *m_Database = nullptr;
+    int m_Transactions = 0;
+};
+
+namespace {
+const int PaymentCount = 1000;
+const int PaymentsPerEncashment = 250;
+const int ParametersPerPayment = 12;
+
+const char SchemaScript[] = ":/scripts/empty_db.sql";
+
+const char UpdatePayment[] =
+    "UPDATE `payment` SET `last_update` = :last_update, `type` = :type, `session` = :session, "
+    "`operator` = :provider, `status` = :status, `priority` = :priority WHERE `id` = :id";
+
+const char InsertParameter[] =
+    "INSERT OR REPLACE INTO `payment_param` (`name`, `value`, `type`, `fk_payment_id`, "
+    "`external`) VALUES (:name, :value, :type, :id, :external)";
+
+const char InsertNote[] = "INSERT INTO `payment_note` (`nominal`, `date`, `type`, `serial`, "
+                          "`currency`, `fk_payment_id`) VALUES (:amount, :date, :type, :serial, "
+                          ":currency, :id)";
+
+const char SumParameter[] = "SELECT SUM(`value`) FROM `payment_param` WHERE `name` = :name AND "
+                            "`fk_payment_id` >= :first_payment";
+
+const char InsertEncashment[] = "INSERT INTO `encashment` (`date`, `amount`, `fee`, `report`) "
+                                "VALUES (:date, :amount, :fee, :report)";
+
+/// Профиль, соответствующий настройкам SQLite по умолчанию, без кэша запросов.
+SDatabasePerformance legacyPerformance() {
+    SDatabasePerformance performance;
+    performance.journalMode = "DELETE";
+    performance.synchronous = "FULL";
+    performance.cacheSize = -2000;
+    performance.mmapSize = 0;
+    performance.tempStore = "DEFAULT";
+    performance.statementCacheSize = 0;
+
+    return performance;
+}
+} // namespace
+
+//---------------------------------------------------------------------------
+void TestDatabaseProxyPerformance::initTestCase() {
+    m_Fixture = new DatabaseFixture();
+    m_Database = m_Fixture->database();
+    QVERIFY(m_Database);
+}
+
+//---------------------------------------------------------------------------
+void TestDatabaseProxyPerformance::cleanupTestCase() {
+    delete m_Fixture;
+    m_Fixture = nullptr;
+    m_Database = nullptr;
+}
+
+//---------------------------------------------------------------------------
+bool TestDatabaseProxyPerformance::openDatabase(const QString &aName,
+                                                const SDatabasePerformance &aPerformance) {
+    return m_Fixture->open(aName, QStringList() << SchemaScript, aPerformance);
+}
+
+//---------------------------------------------------------------------------
+bool TestDatabaseProxyPerformance::createPayment(qint64 &aPayment) {
+    long rowsAffected = 0;
+
+    if (!m_Database->execDML("INSERT INTO `payment` DEFAULT VALUES", rowsAffected)) {
+        return false;
+    }
+
+    ++m_Transactions;
+
+    QScopedPointer<IDatabaseQuery> query(m_Database->execQuery("SELECT MAX(`id`) FROM `payment`"));
+
+    if (!query || !query->first()) {
+        return false;
+    }
+
+    aPayment = query->value(0).toLongLong();
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool TestDatabaseProxyPerformance::savePayment(qint64 aPayment, int aStatus, int aParameters) {
+    // Повторяет PaymentDatabaseUtils::savePayment: основная запись и параметры в одной транзакции.
+    DatabaseTransaction transaction(m_Database);
+
+    if (!transaction) {
+        return false;
+    }
+
+    QScopedPointer<IDatabaseQuery> query(m_Database->createQuery(UpdatePayment));
+
+    if (!query) {
+        return false;
+    }
+
+    query->bindValue(":last_update",
+                     QDateTime::currentDateTime().toString(CIDatabaseProxy::DateFormat));
+    query->bindValue(":type", "cyberplat");
+    query->bindValue(":session", QString("session_%1").arg(aPayment));
+    query->bindValue(":provider", 100 + aPayment % 50);
+    query->bindValue(":status", aStatus);
+    query->bindValue(":priority", 0);
+    query->bindValue(":id", aPayment);
+
+    if (!query->exec()) {
+        return false;
+    }
+
+    for (int i = 0; i < aParameters; ++i) {
+        query->clear();
+        query.reset(m_Database->createQuery(InsertParameter));
+
+        if (!query) {
+            return false;
+        }
+
+        query->bindValue(":name", QString("param_%1").arg(i));
+        query->bindValue(":value", QString("%1.00").arg((aPayment + i) % 1000));
+        query->bindValue(":type", 0);
+        query->bindValue(":id", aPayment);
+        query->bindValue(":external", i % 2);
+
+        if (!query->exec()) {
+            return false;
+        }
+    }
+
+    ++m_Transactions;
+
+    return transaction.commit();
+}
+
+//---------------------------------------------------------------------------
+bool TestDatabaseProxyPerformance::addNote(qint64 aPayment) {
+    QScopedPointer<IDatabaseQuery> query(m_Database->createQuery(InsertNote));
+
+    if (!query) {
+        return false;
+    }
+
+    query->bindValue(":amount", "100");
+    query->bindValue(":date", QDateTime::currentDateTime().toString(CIDatabaseProxy::DateFormat));
+    query->bindValue(":type", 0);
+    query->bindValue(":serial", QString("AA%1").arg(aPayment));
+    query->bindValue(":currency", 972);
+    query->bindValue(":id", aPayment);
+
+    ++m_Transactions;
+
+    return query->exec();
+}
+
+//---------------------------------------------------------------------------
+bool TestDatabaseProxyPerformance::performEncashment(qint64 aFirstPayment) {
+    DatabaseTransaction transaction(m_Database);
+
+    if (!transaction) {
+        return false;
+    }
+
+    QScopedPointer<IDatabaseQuery> query(m_Database->createQuery(SumParameter));
+
+    if (!query) {
+        return false;
+    }
+
+    query->bindValue(":name", "param_0");
+    query->bindValue(":first_payment", aFirstPayment);
+
+    if (!query->exec() || !query->first()) {
+        return false;
+    }
+
+    QString amount = query->value(0).toString();
+
+    query->clear();
+    query.reset(m_Database->createQuery(InsertEncashment));
+
+    if (!query) {
+        return false;
+    }
+
+    query->bindValue(":date", QDateTime::currentDateTime().toString(CIDatabaseProxy::DateFormat));
+    query->bindValue(":amount", amount);
+    query->bindValue(":fee", 0);
+    query->bindValue(":report", "report");
+
+    if (!query->exec()) {
+        return false;
+    }
+
+    QScopedPointer<IDatabaseQuery> update(
+        m_Database->execQuery(QString("UPDATE `payment_note` SET `ejection` = '%1' WHERE "
+                                      "`fk_payment_id` >= %2")
+                                  .arg(QDateTime::currentDateTime().toString(
+                                      CIDatabaseProxy::DateFormat))
+                                  .arg(aFirstPayment)));
+
+    ++m_Transactions;
+
+    return update && transaction.commit();
+}
+
+//---------------------------------------------------------------------------
+double TestDatabaseProxyPerformance::runWorkload(const QString &aName,
+                                                 const SDatabasePerformance &aPerformance) {
+    if (!openDatabase(aName, aPerformance)) {
+        return -1;
+    }
+
+    m_Transactions = 0;
+    qint64 firstPayment = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < PaymentCount; ++i) {
+        qint64 payment = 0;
+
+        // Создание, заполнение параметров, купюра и проведение платежа.
+        if (!createPayment(payment) || !savePayment(payment, 0, ParametersPerPayment) ||
+            !addNote(payment) || !savePayment(payment, 3, 2)) {
+            return -1;
+        }
+
+        if (!firstPayment) {
+            firstPayment = payment;
+        }
+
+        if ((i + 1) % PaymentsPerEncashment == 0) {
+            if (!performEncashment(firstPayment)) {
+                return -1;
+            }
+
+            firstPayment = 0;
+        }
+    }
+
+    qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+    double rate = m_Transactions * 1000.0 / elapsed;
+
+    qDebug() << aName << ":" << m_Transactions << "transactions in" << elapsed << "ms," << rate
+             << "tx/s";
+
+    return rate;
+}
+
+//---------------------------------------------------------------------------
+void TestDatabaseProxyPerformance::testStatementCacheLru() {
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "statement_cache_test");
+    db.setDatabaseName(":memory:");
+    QVERIFY(db.open());
+
+    {
+        StatementCache cache(2);
+        cache.attach(db);
+
+        QStringList queries = QStringList() << "SELECT 1" << "SELECT 2" << "SELECT 3";
+
+        foreach (const QString &sql, queries) {
+            QSqlQuery query(db);
+            QVERIFY(!cache.acquire(sql, query));
+            QVERIFY(query.prepare(sql));
+            cache.release(sql, query, cache.generation());
+        }
+
+        // Первый запрос вытеснен, последние два остались подготовленными.
+        QSqlQuery query(db);
+        QVERIFY(!cache.acquire("SELECT 1", query));
+        QVERIFY(cache.acquire("SELECT 3", query));
+        QVERIFY(query.exec());
+        QVERIFY(query.first());
+        QCOMPARE(query.value(0).toInt(), 3);
+
+        // Запрос выдаётся монопольно.
+        QSqlQuery other(db);
+        QVERIFY(!cache.acquire("SELECT 3", other));
+
+        // Запрос от прежнего соединения не принимается.
+        int generation = cache.generation();
+        cache.attach(db);
+        cache.release("SELECT 3", query, generation);
+        QVERIFY(!cache.acquire("SELECT 3", other));
+
+        QCOMPARE(cache.hits(), quint64(1));
+    }
+
+    db.close();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase("statement_cache_test");
+}
+
+//---------------------------------------------------------------------------
+void TestDatabaseProxyPerformance::testStatementReuse() {
+    QVERIFY(openDatabase("reuse.db", SDatabasePerformance()));
+
+    qint64 payment = 0;
+    QVERIFY(createPayment(payment));
+
+    // Один и тот же текст запроса с разными значениями и вложенное использование.
+    for (int i = 0; i < 3; ++i) {
+        QVERIFY(savePayment(payment, i, ParametersPerPayment));
+    }
+
+    QScopedPointer<IDatabaseQuery> outer(m_Database->createQuery(
+        "SELECT `name`, `value` FROM `payment_param` WHERE `fk_payment_id` = :id ORDER BY `id`"));
+    QVERIFY(outer);
+    outer->bindValue(":id", payment);
+    QVERIFY(outer->exec());
+
+    int rows = 0;
+
+    for (outer->first(); outer->isValid(); outer->next()) {
+        QScopedPointer<IDatabaseQuery> inner(m_Database->createQuery(
+            "SELECT `name`, `value` FROM `payment_param` WHERE `fk_payment_id` = :id ORDER BY "
+            "`id`"));
+        QVERIFY(inner);
+        inner->bindValue(":id", payment);
+        QVERIFY(inner->exec());
+        QVERIFY(inner->first());
+
+        ++rows;
+    }
+
+    QCOMPARE(rows, ParametersPerPayment);
+
+    long status = 0;
+    QVERIFY(m_Database->execScalar(
+        QString("SELECT `status` FROM `payment` WHERE `id` = %1").arg(payment), status));
+    QCOMPARE(status, 2L);
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+void TestDatabaseProxyPerformance::testReopenDropsStatements() {
+    QVERIFY(openDatabase("first.db", SDatabasePerformance()));
+
+    qint64 payment = 0;
+    QVERIFY(createPayment(payment));
+    QVERIFY(savePayment(payment, 1, 1));
+
+    // Подготовленные для прежнего файла запросы не должны попасть в новый.
+    QVERIFY(openDatabase("second.db", SDatabasePerformance()));
+    QVERIFY(createPayment(payment));
+    QVERIFY(savePayment(payment, 1, 1));
+
+    long count = 0;
+    QVERIFY(m_Database->execScalar("SELECT COUNT(*) FROM `payment_param`", count));
+    QCOMPARE(count, 1L);
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+void TestDatabaseProxyPerformance::testPerformanceProfile() {
+    QVERIFY(openDatabase("profile.db", SDatabasePerformance()));
+
+    QScopedPointer<IDatabaseQuery> query(m_Database->execQuery("PRAGMA journal_mode"));
+    QVERIFY(query && query->first());
+    QCOMPARE(query->value(0).toString().toUpper(), CIDatabaseProxy::DefaultJournalMode);
+    query.reset();
+
+    // synchronous: 0 - OFF, 1 - NORMAL, 2 - FULL, 3 - EXTRA.
+    long synchronous = 0;
+    QVERIFY(m_Database->execScalar("PRAGMA synchronous", synchronous));
+    QCOMPARE(synchronous, 2L);
+
+    long tempStore = 0;
+    QVERIFY(m_Database->execScalar("PRAGMA temp_store", tempStore));
+    QCOMPARE(tempStore, 2L);
+
+    // Неизвестное значение не применяется и не ломает соединение.
+    SDatabasePerformance performance;
+    performance.synchronous = "SOMETIMES";
+    m_Database->setPerformance(performance);
+    QVERIFY(m_Database->execScalar("PRAGMA synchronous", synchronous));
+    QCOMPARE(synchronous, 2L);
+}
+
+//---------------------------------------------------------------------------
+void TestDatabaseProxyPerformance::benchmarkPaymentWorkload() {
+    double before = runWorkload("legacy.db", legacyPerformance());
+    QVERIFY(before > 0);
+
+    double after = runWorkload("tuned.db", SDatabasePerformance());
+    QVERIFY(after > 0);
+
+    qDebug() << "Payment workload speedup:" << after / before;
+
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+QTEST_MAIN(TestDatabaseProxyPerformance)
+#include "TestDatabaseProxyPerformance.moc"
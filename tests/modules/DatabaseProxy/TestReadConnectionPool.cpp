@@ -0,0 +1,463 @@
+/* @file Проверки и замеры пула соединений чтения SQLiteDatabaseProxy. */
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRecursiveMutex>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+
+#include <DatabaseProxy/DatabaseTransaction.h>
+#include <DatabaseProxy/IDatabaseProxy.h>
+#include <DatabaseProxy/IDatabaseQuery.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "../../common/DatabaseFixture.h"
+
+//---------------------------------------------------------------------------
+class TestReadConnectionPool : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    // Корректность
+    void testReaderSeesCommittedData();
+    void testConnectionLimit();
+    void testReopenWithLiveReader();
+    void testDisabledWithoutWal();
+
+    // Замеры
+    void benchmarkReportsUnderWriteLoad();
+
+private:
+    bool openDatabase(const QString &aName, const SDatabasePerformance &aPerformance);
+
+    /// Сохраняет платёж с параметрами одной транзакцией, как DatabaseUtils::savePayment.
+    bool savePayment(int aIndex);
+    bool seedPayments(int aCount);
+
+    /// Читает число платежей запросом чтения. -1 при ошибке.
+    qint64 countPayments();
+
+    /// Запускает aAction в отдельном потоке и ждёт его завершения.
+    template <typename T> void runInThread(T aAction);
+
+    /// Платёжная нагрузка при параллельных отчётах. Возвращает задержки записи в мкс.
+    std::vector<qint64> runLoad(const QString &aName, int aReadConnections, int &aReports);
+
+    DatabaseFixture *m_Fixture = nullptr;
+    IDatabaseProxy *m_Database = nullptr;
+
+    /// Синхронизация, повторяющая DatabaseUtils::m_AccessMutex.
+    QRecursiveMutex m_AccessMutex;
+};
+
+namespace {
+const int SeedPayments = 100000;
+const int LoadPayments = 1000;
+const int ParametersPerPayment = 5;
+const int ReportThreads = 2;
+
+const char SchemaScript[] = ":/scripts/empty_db.sql";
+
+const char InsertPayment[] = "INSERT INTO `payment` (`create_date`, `operator`, `status`) VALUES "
+                             "(:date, :provider, :status)";
+
+const char InsertParameter[] = "INSERT INTO `payment_param` (`name`, `value`, `type`, "
+                               "`fk_payment_id`) VALUES (:name, :value, 0, :id)";
+
+const char CountPayments[] = "SELECT COUNT(*) FROM `payment`";
+
+/// Отчёты, которые в терминале строят getStatistic и findPayments.
+const char StatisticReport[] = "SELECT `operator`, count(*) FROM `payment` GROUP BY `operator`";
+
+const char FindReport[] = "SELECT DISTINCT(p.[id]) FROM payment p, payment_param pp "
+                          "WHERE p.[id] = pp.[fk_payment_id] AND pp.[value] = :value";
+
+SDatabasePerformance readPerformance(int aReadConnections) {
+    SDatabasePerformance performance;
+    performance.readConnections = aReadConnections;
+
+    return performance;
+}
+
+qint64 percentile(const std::vector<qint64> &aSorted, double aPercent) {
+    if (aSorted.empty()) {
+        return -1;
+    }
+
+    size_t index = static_cast<size_t>(aPercent / 100.0 * (aSorted.size() - 1));
+
+    return aSorted[index];
+}
+} // namespace
+
+//---------------------------------------------------------------------------
+void TestReadConnectionPool::initTestCase() {
+    m_Fixture = new DatabaseFixture();
+    m_Database = m_Fixture->database();
+    QVERIFY(m_Database);
+}
+
+//---------------------------------------------------------------------------
+void TestReadConnectionPool::cleanupTestCase() {
+    delete m_Fixture;
+    m_Fixture = nullptr;
+    m_Database = nullptr;
+}
+
+//---------------------------------------------------------------------------
+bool TestReadConnectionPool::openDatabase(const QString &aName,
+                                          const SDatabasePerformance &aPerformance) {
+    return m_Fixture->open(aName, QStringList() << SchemaScript, aPerformance);
+}
+
+//---------------------------------------------------------------------------
+bool TestReadConnectionPool::savePayment(int aIndex) {
+    QMutexLocker lock(&m_AccessMutex);
+    DatabaseTransaction transaction(m_Database);
+
+    if (!transaction) {
+        return false;
+    }
+
+    QScopedPointer<IDatabaseQuery> query(m_Database->createQuery(InsertPayment));
+
+    if (!query) {
+        return false;
+    }
+
+    query->bindValue(":date", QDateTime::currentDateTime().toString(CIDatabaseProxy::DateFormat));
+    query->bindValue(":provider", 100 + aIndex % 50);
+    query->bindValue(":status", 6);
+
+    if (!query->exec()) {
+        return false;
+    }
+
+    long id = 0;
+
+    if (!m_Database->execScalar("SELECT last_insert_rowid()", id)) {
+        return false;
+    }
+
+    for (int i = 0; i < ParametersPerPayment; ++i) {
+        query->clear();
+        query.reset(m_Database->createQuery(InsertParameter));
+
+        if (!query) {
+            return false;
+        }
+
+        query->bindValue(":name", QString("param_%1").arg(i));
+        query->bindValue(":value", QString("99890%1").arg(aIndex * ParametersPerPayment + i));
+        query->bindValue(":id", static_cast<qint64>(id));
+
+        if (!query->exec()) {
+            return false;
+        }
+    }
+
+    return transaction.commit();
+}
+
+//---------------------------------------------------------------------------
+bool TestReadConnectionPool::seedPayments(int aCount) {
+    // Одна транзакция на всю историю, чтобы наполнение не занимало минуты.
+    DatabaseTransaction transaction(m_Database);
+
+    QScopedPointer<IDatabaseQuery> payment(m_Database->createQuery(InsertPayment));
+    QScopedPointer<IDatabaseQuery> parameter(m_Database->createQuery(InsertParameter));
+
+    if (!transaction || !payment || !parameter) {
+        return false;
+    }
+
+    for (int i = 0; i < aCount; ++i) {
+        payment->bindValue(":date", "2024-01-01 00:00:00.000");
+        payment->bindValue(":provider", 100 + i % 50);
+        payment->bindValue(":status", 6);
+
+        if (!payment->exec()) {
+            return false;
+        }
+
+        for (int j = 0; j < ParametersPerPayment; ++j) {
+            parameter->bindValue(":name", QString("param_%1").arg(j));
+            parameter->bindValue(":value", QString("99890%1").arg(i * ParametersPerPayment + j));
+            parameter->bindValue(":id", i + 1);
+
+            if (!parameter->exec()) {
+                return false;
+            }
+        }
+    }
+
+    return transaction.commit();
+}
+
+//---------------------------------------------------------------------------
+qint64 TestReadConnectionPool::countPayments() {
+    QScopedPointer<IDatabaseQuery> query(m_Database->createReadQuery(CountPayments));
+
+    return (query && query->exec() && query->first()) ? query->value(0).toLongLong() : -1;
+}
+
+//---------------------------------------------------------------------------
+template <typename T> void TestReadConnectionPool::runInThread(T aAction) {
+    QScopedPointer<QThread> thread(QThread::create(aAction));
+    thread->start();
+    thread->wait();
+}
+
+//---------------------------------------------------------------------------
+void TestReadConnectionPool::testReaderSeesCommittedData() {
+    QVERIFY(openDatabase("committed.db", readPerformance(2)));
+    QVERIFY(savePayment(0));
+
+    bool reader = false;
+    qint64 count = -1;
+
+    {
+        DatabaseTransaction transaction(m_Database);
+        QVERIFY(transaction);
+
+        long rows = 0;
+        QVERIFY(m_Database->execDML("INSERT INTO `payment` DEFAULT VALUES", rows));
+
+        // Поток транзакции читает через основное соединение и видит свои изменения.
+        QVERIFY(!m_Database->acquireReadConnection());
+        QCOMPARE(countPayments(), qint64(2));
+
+        // Другой поток читает отдельным соединением последнюю зафиксированную версию.
+        runInThread([&]() {
+            reader = m_Database->acquireReadConnection();
+            count = countPayments();
+        });
+
+        QVERIFY(reader);
+        QCOMPARE(count, qint64(1));
+
+        QVERIFY(transaction.commit());
+    }
+
+    runInThread([&]() { count = countPayments(); });
+    QCOMPARE(count, qint64(2));
+
+    // Соединение чтения не позволяет писать.
+    runInThread([&]() {
+        QScopedPointer<IDatabaseQuery> query(
+            m_Database->createReadQuery("DELETE FROM `payment`"));
+        reader = query && query->exec();
+    });
+
+    QVERIFY(!reader);
+    QCOMPARE(countPayments(), qint64(2));
+
+    // Отклонённая запись - единственная ожидаемая ошибка.
+    QCOMPARE(m_Fixture->checker().errors(), 1);
+    m_Fixture->checker().reset();
+}
+
+//---------------------------------------------------------------------------
+void TestReadConnectionPool::testConnectionLimit() {
+    QVERIFY(openDatabase("limit.db", readPerformance(1)));
+
+    QSemaphore acquired;
+    QSemaphore finish;
+    bool first = false;
+    bool second = true;
+    bool third = false;
+
+    // Первый поток держит единственное соединение, второй читает через основное.
+    QScopedPointer<QThread> holder(QThread::create([&]() {
+        first = m_Database->acquireReadConnection();
+        acquired.release();
+        finish.acquire();
+    }));
+    holder->start();
+    acquired.acquire();
+
+    runInThread([&]() { second = m_Database->acquireReadConnection(); });
+
+    finish.release();
+    holder->wait();
+
+    // Завершившийся поток вернул соединение в пул.
+    runInThread([&]() { third = m_Database->acquireReadConnection(); });
+
+    QVERIFY(first);
+    QVERIFY(!second);
+    QVERIFY(third);
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+void TestReadConnectionPool::testReopenWithLiveReader() {
+    QVERIFY(openDatabase("before_reopen.db", readPerformance(1)));
+
+    QSemaphore acquired;
+    QSemaphore reopened;
+    QSemaphore finish;
+    bool first = false;
+    bool second = false;
+    bool other = true;
+    qint64 count = -1;
+
+    // Поток держит соединение к старому файлу, пока база переоткрывается из другого потока.
+    QScopedPointer<QThread> holder(QThread::create([&]() {
+        first = m_Database->acquireReadConnection();
+        acquired.release();
+        reopened.acquire();
+
+        // Старое соединение закрывается здесь же, новое открывается к новому файлу.
+        second = m_Database->acquireReadConnection();
+        count = countPayments();
+        acquired.release();
+        finish.acquire();
+    }));
+    holder->start();
+    acquired.acquire();
+
+    QVERIFY(openDatabase("after_reopen.db", readPerformance(1)));
+    QVERIFY(savePayment(0));
+    reopened.release();
+    acquired.acquire();
+
+    // Единственное место нового пула занято потоком-держателем.
+    runInThread([&]() { other = m_Database->acquireReadConnection(); });
+
+    finish.release();
+    holder->wait();
+
+    QVERIFY(first);
+    QVERIFY(second);
+    QCOMPARE(count, qint64(1));
+    QVERIFY(!other);
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+void TestReadConnectionPool::testDisabledWithoutWal() {
+    SDatabasePerformance performance = readPerformance(4);
+    performance.journalMode = "DELETE";
+
+    QVERIFY(openDatabase("delete.db", performance));
+    QVERIFY(savePayment(0));
+
+    bool reader = true;
+    qint64 count = -1;
+
+    runInThread([&]() {
+        reader = m_Database->acquireReadConnection();
+        count = countPayments();
+    });
+
+    QVERIFY(!reader);
+    QCOMPARE(count, qint64(1));
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+std::vector<qint64>
+TestReadConnectionPool::runLoad(const QString &aName, int aReadConnections, int &aReports) {
+    std::vector<qint64> latencies;
+
+    if (!openDatabase(aName, readPerformance(aReadConnections)) || !seedPayments(SeedPayments)) {
+        return latencies;
+    }
+
+    QAtomicInt done(0);
+    QAtomicInt reports(0);
+    QList<QThread *> readers;
+
+    for (int i = 0; i < ReportThreads; ++i) {
+        readers << QThread::create([&, i]() {
+            while (!done.loadAcquire()) {
+                // Как DatabaseUtils: без отдельного соединения отчёт ждёт запись.
+                QMutexLocker lock(m_Database->acquireReadConnection() ? nullptr
+                                                                      : &m_AccessMutex);
+
+                bool find = (i % 2) != 0;
+                QScopedPointer<IDatabaseQuery> query(
+                    m_Database->createReadQuery(find ? FindReport : StatisticReport));
+
+                if (!query) {
+                    return;
+                }
+
+                if (find) {
+                    query->bindValue(":value", QString("99890%1").arg(reports.loadAcquire()));
+                }
+
+                if (!query->exec()) {
+                    return;
+                }
+
+                for (query->first(); query->isValid(); query->next()) {
+                }
+
+                reports.fetchAndAddRelaxed(1);
+            }
+        });
+
+        readers.last()->start();
+    }
+
+    QElapsedTimer timer;
+
+    for (int i = 0; i < LoadPayments; ++i) {
+        timer.start();
+
+        if (!savePayment(SeedPayments + i)) {
+            latencies.clear();
+            break;
+        }
+
+        latencies.push_back(timer.nsecsElapsed() / 1000);
+    }
+
+    done.storeRelease(1);
+
+    foreach (QThread *thread, readers) {
+        thread->wait();
+        delete thread;
+    }
+
+    aReports = reports.loadAcquire();
+    std::sort(latencies.begin(), latencies.end());
+
+    return latencies;
+}
+
+//---------------------------------------------------------------------------
+void TestReadConnectionPool::benchmarkReportsUnderWriteLoad() {
+    QList<int> modes = QList<int>() << 0 << ReportThreads;
+
+    qDebug() << "Saving" << LoadPayments << "payments over" << SeedPayments << "while"
+             << ReportThreads << "threads run reports, write latency in us:";
+
+    foreach (int connections, modes) {
+        int reports = 0;
+        std::vector<qint64> latencies =
+            runLoad(QString("load_%1.db").arg(connections), connections, reports);
+
+        QCOMPARE(static_cast<int>(latencies.size()), LoadPayments);
+
+        qDebug() << "  read connections" << connections << ": p50" << percentile(latencies, 50)
+                 << "p95" << percentile(latencies, 95) << "p99" << percentile(latencies, 99)
+                 << "max" << latencies.back() << "reports" << reports;
+    }
+
+    QCOMPARE(m_Fixture->checker().errors(), 0);
+}
+
+//---------------------------------------------------------------------------
+QTEST_MAIN(TestReadConnectionPool)
+#include "TestReadConnectionPool.moc"
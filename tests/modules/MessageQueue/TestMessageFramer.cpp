@@ -0,0 +1,227 @@
+#include <QtCore/QElapsedTimer>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
+#include <QtTest/QtTest>
+
+#include "MessageFramer.h"
+
+namespace {
+// Former parseInputBuffer: every message copies the rest of the buffer.
+int legacyParse(QByteArray aBuffer) {
+    int count = 0;
+    int messageEnd = aBuffer.indexOf('\0');
+    while (messageEnd != -1) {
+        QByteArray message = aBuffer.left(messageEnd);
+        aBuffer = aBuffer.right(aBuffer.size() - messageEnd - 1);
+        ++count;
+        messageEnd = aBuffer.indexOf('\0');
+    }
+
+    return count;
+}
+
+QByteArray smallMessage(int aIndex) {
+    return "sender=bench;type=ping;params=" + QByteArray::number(aIndex);
+}
+} // namespace
+
+class TestMessageFramer : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testTextFrames();
+    void testSplitFrames();
+    void testBinaryFrames();
+    void testCorruptedLength();
+    void testClear();
+    void benchmarkParse();
+    void benchmarkLocalSocket();
+};
+
+void TestMessageFramer::testTextFrames() {
+    MessageFramer framer;
+    framer.append(MessageFramer::frame("one") + MessageFramer::frame("") +
+                  MessageFramer::frame("three"));
+
+    QByteArray message;
+    MessageFramer::EFormat format = MessageFramer::Binary;
+
+    QVERIFY(framer.next(message, &format));
+    QCOMPARE(message, QByteArray("one"));
+    QCOMPARE(format, MessageFramer::Text);
+
+    QVERIFY(framer.next(message));
+    QCOMPARE(message, QByteArray());
+
+    QVERIFY(framer.next(message));
+    QCOMPARE(message, QByteArray("three"));
+
+    QVERIFY(!framer.next(message));
+    QCOMPARE(framer.pending(), 0);
+}
+
+void TestMessageFramer::testSplitFrames() {
+    QByteArray stream;
+    for (int i = 0; i < 50; ++i) {
+        stream += MessageFramer::frame(smallMessage(i),
+                                       i % 3 ? MessageFramer::Text : MessageFramer::Binary);
+    }
+
+    // every chunk size splits frames at different positions, including inside headers
+    for (int chunk = 1; chunk <= 17; ++chunk) {
+        MessageFramer framer;
+        QList<QByteArray> messages;
+        QByteArray message;
+
+        for (int pos = 0; pos < stream.size(); pos += chunk) {
+            framer.append(stream.mid(pos, chunk));
+
+            while (framer.next(message)) {
+                messages << message;
+            }
+        }
+
+        QCOMPARE(messages.size(), 50);
+        for (int i = 0; i < messages.size(); ++i) {
+            QCOMPARE(messages[i], smallMessage(i));
+        }
+
+        QCOMPARE(framer.pending(), 0);
+        QVERIFY(!framer.isCorrupted());
+    }
+}
+
+void TestMessageFramer::testBinaryFrames() {
+    QByteArray payload(1000, '\0');
+    payload[10] = '\xFF';
+
+    QByteArray frame = MessageFramer::frame(payload, MessageFramer::Binary);
+    QCOMPARE(frame.size(), CMessageFramer::BinaryHeaderSize + payload.size());
+
+    MessageFramer framer;
+    QByteArray message;
+    MessageFramer::EFormat format = MessageFramer::Text;
+
+    framer.append(frame.left(CMessageFramer::BinaryHeaderSize + 100));
+    QVERIFY(!framer.next(message));
+
+    framer.append(frame.mid(CMessageFramer::BinaryHeaderSize + 100));
+    QVERIFY(framer.next(message, &format));
+    QCOMPARE(format, MessageFramer::Binary);
+    QCOMPARE(message, payload);
+}
+
+void TestMessageFramer::testCorruptedLength() {
+    QByteArray header(CMessageFramer::BinaryHeaderSize, '\xFF');
+
+    MessageFramer framer;
+    framer.append(MessageFramer::frame("before") + header + "garbage");
+
+    QByteArray message;
+    QVERIFY(framer.next(message));
+    QCOMPARE(message, QByteArray("before"));
+
+    QVERIFY(!framer.next(message));
+    QVERIFY(framer.isCorrupted());
+    QCOMPARE(framer.pending(), 0);
+
+    framer.clear();
+    QVERIFY(!framer.isCorrupted());
+
+    framer.append(MessageFramer::frame("after"));
+    QVERIFY(framer.next(message));
+    QCOMPARE(message, QByteArray("after"));
+}
+
+void TestMessageFramer::testClear() {
+    MessageFramer framer;
+    framer.append("incomplete");
+
+    QByteArray message;
+    QVERIFY(!framer.next(message));
+    QCOMPARE(framer.pending(), 10);
+
+    framer.clear();
+    framer.append(MessageFramer::frame("complete"));
+
+    QVERIFY(framer.next(message));
+    QCOMPARE(message, QByteArray("complete"));
+}
+
+void TestMessageFramer::benchmarkParse() {
+    const int count = 100000;
+
+    QByteArray stream;
+    for (int i = 0; i < count; ++i) {
+        stream += MessageFramer::frame(smallMessage(i));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    MessageFramer framer;
+    framer.append(stream);
+
+    int parsed = 0;
+    QByteArray message;
+    while (framer.next(message)) {
+        ++parsed;
+    }
+
+    qint64 framerElapsed = timer.elapsed();
+    QCOMPARE(parsed, count);
+
+    // the legacy parser is quadratic, so it is measured on a tenth of the stream
+    QByteArray part = stream.left(stream.indexOf(MessageFramer::frame(smallMessage(count / 10))));
+
+    timer.restart();
+    QCOMPARE(legacyParse(part), count / 10);
+    qint64 legacyElapsed = timer.elapsed();
+
+    qDebug() << "Single read of" << count << "messages:" << framerElapsed << "ms, legacy parser"
+             << legacyElapsed << "ms for" << count / 10;
+}
+
+void TestMessageFramer::benchmarkLocalSocket() {
+    const int count = 100000;
+
+    // The LocalSocket transport is not part of the build, its framing is measured directly.
+    QLocalServer server;
+    QString name = QString("ek_framer_%1").arg(QCoreApplication::applicationPid());
+    QLocalServer::removeServer(name);
+    QVERIFY(server.listen(name));
+
+    QLocalSocket client;
+    client.connectToServer(name);
+    QVERIFY(client.waitForConnected(5000));
+    QTRY_VERIFY(server.hasPendingConnections());
+
+    QLocalSocket *peer = server.nextPendingConnection();
+    MessageFramer framer;
+    int received = 0;
+
+    connect(peer, &QLocalSocket::readyRead, this, [&]() {
+        framer.append(peer->readAll());
+
+        QByteArray message;
+        while (framer.next(message)) {
+            ++received;
+        }
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < count; ++i) {
+        MessageFramer::write(client, smallMessage(i));
+    }
+
+    QTRY_COMPARE_WITH_TIMEOUT(received, count, 60000);
+
+    qint64 elapsed = qMax<qint64>(timer.elapsed(), 1);
+    qDebug() << "LocalSocket:" << count << "messages in" << elapsed << "ms,"
+             << (count * 1000LL / elapsed) << "messages/s";
+}
+
+QTEST_MAIN(TestMessageFramer)
+#include "TestMessageFramer.moc"
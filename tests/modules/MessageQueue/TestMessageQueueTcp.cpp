@@ -1,8 +1,10 @@
 #include <QSignalSpy>
+#include <QtCore/QElapsedTimer>
 #include <QtTest/QtTest>
 
 #include <MessageQueue/MessageQueueConstants.h>
 
+#include "MessageFramer.h"
 #include "MessageQueueClient.h"
 #include "MessageQueueServer.h"
 
@@ -28,6 +30,9 @@ private slots:
     void testMultipleMessagesInSingleRead();
     void testPartialMessageBoundary();
     void testSendToMultipleClients();
+    void testBinaryMessage();
+    void testMixedFrames();
+    void benchmarkSmallMessages();
 };
 
 void TestMessageQueueTcp::testServerStartStop() {
@@ -184,5 +189,82 @@ void TestMessageQueueTcp::testSendToMultipleClients() {
     QCOMPARE(spy2.takeFirst().at(0).toByteArray(), QByteArray("broadcast-msg"));
 }
 
+void TestMessageQueueTcp::testBinaryMessage() {
+    MessageQueueServer server("0");
+    QVERIFY(server.init());
+
+    MessageQueueClient client;
+    QVERIFY(client.connect(QString::number(server.serverPort())));
+
+    QSignalSpy serverSpy(&server, SIGNAL(onMessageReceived(QByteArray)));
+
+    // binary frames may carry '\0' inside the message
+    QByteArray payload("bin\0ary\0", 9);
+    client.sendBinaryMessage(payload);
+
+    QTRY_COMPARE(serverSpy.count(), 1);
+    QCOMPARE(serverSpy.takeFirst().at(0).toByteArray(), payload);
+
+    QSignalSpy clientSpy(&client, SIGNAL(onMessageReceived(QByteArray)));
+    server.sendBinaryMessage(payload);
+
+    QTRY_COMPARE(clientSpy.count(), 1);
+    QCOMPARE(clientSpy.takeFirst().at(0).toByteArray(), payload);
+}
+
+void TestMessageQueueTcp::testMixedFrames() {
+    MessageQueueServer server("0");
+    QVERIFY(server.init());
+
+    QTcpSocket sock;
+    sock.connectToHost(QHostAddress::LocalHost, server.serverPort());
+    QVERIFY(sock.waitForConnected(5000));
+
+    QSignalSpy serverSpy(&server, SIGNAL(onMessageReceived(QByteArray)));
+
+    QByteArray combined = MessageFramer::frame("text1") +
+                          MessageFramer::frame(QByteArray("a\0b", 3), MessageFramer::Binary) +
+                          MessageFramer::frame("text2");
+
+    // deliver the frames byte by byte so that every header and terminator is split
+    for (int i = 0; i < combined.size(); ++i) {
+        sock.write(combined.constData() + i, 1);
+        QVERIFY(sock.waitForBytesWritten(1000));
+    }
+
+    QTRY_COMPARE(serverSpy.count(), 3);
+    QCOMPARE(serverSpy.takeFirst().at(0).toByteArray(), QByteArray("text1"));
+    QCOMPARE(serverSpy.takeFirst().at(0).toByteArray(), QByteArray("a\0b", 3));
+    QCOMPARE(serverSpy.takeFirst().at(0).toByteArray(), QByteArray("text2"));
+
+    sock.disconnectFromHost();
+}
+
+void TestMessageQueueTcp::benchmarkSmallMessages() {
+    const int count = 100000;
+
+    MessageQueueServer server("0");
+    QVERIFY(server.init());
+
+    MessageQueueClient client;
+    QVERIFY(client.connect(QString::number(server.serverPort())));
+
+    int received = 0;
+    connect(&server, &MessageQueueServer::onMessageReceived, this, [&received]() { ++received; });
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < count; ++i) {
+        client.sendMessage("sender=bench;type=ping;params=" + QByteArray::number(i));
+    }
+
+    QTRY_COMPARE_WITH_TIMEOUT(received, count, 60000);
+
+    qint64 elapsed = qMax<qint64>(timer.elapsed(), 1);
+    qDebug() << "Tcp:" << count << "messages in" << elapsed << "ms,"
+             << (count * 1000LL / elapsed) << "messages/s";
+}
+
 QTEST_MAIN(TestMessageQueueTcp)
 #include "TestMessageQueueTcp.moc"
@@ -0,0 +1,264 @@
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QTimer>
+#include <QtTest/QtTest>
+
+#include <Common/ILog.h>
+
+#include <NetworkTaskManager/BandwidthLimiter.h>
+#include <NetworkTaskManager/MemoryDataStream.h>
+#include <NetworkTaskManager/NetworkTask.h>
+#include <NetworkTaskManager/NetworkTaskManager.h>
+#include <algorithm>
+
+#include "../../common/HttpStandIn.h"
+
+namespace {
+const qint64 KB = 1024;
+} // namespace
+
+class TestBandwidthLimiter : public QObject {
+    Q_OBJECT
+
+public:
+    TestBandwidthLimiter() : m_Now(0), m_Manager(ILog::getInstance("TestBandwidthLimiter")) {}
+
+private slots:
+    void initTestCase();
+
+    void testUnlimited();
+    void testClassRate();
+    void testFractionalRefill();
+    void testPriorityReserve();
+    void testDynamicLimit();
+    void testSimulatedSaturation();
+    void benchmarkLocalServer();
+
+private:
+    BandwidthLimiter::TClock clock() {
+        return [this]() { return m_Now; };
+    }
+
+    qint64 m_Now;
+    HttpStandIn m_Server;
+    NetworkTaskManager m_Manager;
+};
+
+//---------------------------------------------------------------------------
+void TestBandwidthLimiter::initTestCase() {
+    m_Server.serve("ping", QByteArray(2048, 'p'));
+    QVERIFY(m_Server.listen(QHostAddress::LocalHost));
+}
+
+//---------------------------------------------------------------------------
+void TestBandwidthLimiter::testUnlimited() {
+    BandwidthLimiter limiter(clock());
+
+    QVERIFY(!limiter.isLimited(NetworkTask::Bulk));
+    QCOMPARE(limiter.acquire(NetworkTask::Bulk, 10 * 1024 * KB), 10 * 1024 * KB);
+    QCOMPARE(limiter.acquire(NetworkTask::Interactive, 0), qint64(0));
+}
+
+//---------------------------------------------------------------------------
+void TestBandwidthLimiter::testClassRate() {
+    m_Now = 0;
+    BandwidthLimiter limiter(clock());
+    limiter.setLimit(NetworkTask::Bulk, 100 * KB);
+
+    QVERIFY(limiter.isLimited(NetworkTask::Bulk));
+    QVERIFY(!limiter.isLimited(NetworkTask::Interactive));
+
+    // A fresh bucket holds BurstInterval worth of traffic.
+    QCOMPARE(limiter.acquire(NetworkTask::Bulk, 1024 * KB), 20 * KB);
+    QCOMPARE(limiter.acquire(NetworkTask::Bulk, 1024 * KB), qint64(0));
+    QCOMPARE(limiter.acquire(NetworkTask::Interactive, 1024 * KB), 1024 * KB);
+
+    m_Now += 100;
+    QCOMPARE(limiter.acquire(NetworkTask::Bulk, 1024 * KB), 10 * KB);
+
+    // Idle time does not accumulate beyond the bucket size.
+    m_Now += 10000;
+    QCOMPARE(limiter.acquire(NetworkTask::Bulk, 1024 * KB), 20 * KB);
+}
+
+//---------------------------------------------------------------------------
+void TestBandwidthLimiter::testFractionalRefill() {
+    m_Now = 0;
+    BandwidthLimiter limiter(clock());
+    limiter.setLimit(NetworkTask::Monitoring, 500);
+
+    QCOMPARE(limiter.acquire(NetworkTask::Monitoring, 1024 * KB), CBandwidthLimiter::MinBurst);
+
+    // 1 ms steps give half a byte each; the fractions must not be lost.
+    qint64 received = 0;
+    for (int i = 0; i < 2000; ++i) {
+        ++m_Now;
+        received += limiter.acquire(NetworkTask::Monitoring, 1024 * KB);
+    }
+
+    QCOMPARE(received, qint64(1000));
+}
+
+//---------------------------------------------------------------------------
+void TestBandwidthLimiter::testPriorityReserve() {
+    m_Now = 0;
+    BandwidthLimiter limiter(clock());
+    limiter.setTotalLimit(100 * KB);
+
+    qint64 capacity = 20 * KB;
+    qint64 reserve = capacity * CBandwidthLimiter::PriorityReserve / 100;
+
+    // Nobody else is active: bulk may take the whole bucket.
+    QCOMPARE(limiter.acquire(NetworkTask::Bulk, 1024 * KB), capacity);
+
+    m_Now += 1000;
+    limiter.setActive(NetworkTask::Interactive, true);
+
+    // With an interactive request in flight bulk leaves the reserve untouched ...
+    QCOMPARE(limiter.acquire(NetworkTask::Bulk, 1024 * KB), capacity - reserve);
+    QCOMPARE(limiter.acquire(NetworkTask::Monitoring, 1024 * KB), qint64(0));
+
+    // ... which the interactive answer gets at once.
+    QCOMPARE(limiter.acquire(NetworkTask::Interactive, 1024 * KB), reserve);
+
+    limiter.setActive(NetworkTask::Interactive, false);
+    m_Now += 1000;
+    QCOMPARE(limiter.acquire(NetworkTask::Monitoring, 1024 * KB), capacity);
+}
+
+//---------------------------------------------------------------------------
+void TestBandwidthLimiter::testDynamicLimit() {
+    m_Now = 0;
+    BandwidthLimiter limiter(clock());
+    limiter.setLimit(NetworkTask::Bulk, 1000 * KB);
+
+    QCOMPARE(limiter.acquire(NetworkTask::Bulk, 100 * KB), 100 * KB);
+
+    // Lowering the limit trims the accumulated tokens.
+    limiter.setLimit(NetworkTask::Bulk, 50 * KB);
+    QCOMPARE(limiter.getLimit(NetworkTask::Bulk), 50 * KB);
+    QCOMPARE(limiter.acquire(NetworkTask::Bulk, 1024 * KB), 10 * KB);
+
+    m_Now += 1000;
+    limiter.setLimit(NetworkTask::Bulk, 0);
+    QVERIFY(!limiter.isLimited(NetworkTask::Bulk));
+    QCOMPARE(limiter.acquire(NetworkTask::Bulk, 1024 * KB), 1024 * KB);
+}
+
+//---------------------------------------------------------------------------
+void TestBandwidthLimiter::testSimulatedSaturation() {
+    // A 64 KB/s GSM-like link, bulk capped at 80% of it. The manager reads replies every
+    // ThrottleInterval ms in priority order; a 2 KB payment answer arrives every 500 ms while
+    // the bulk download always has data waiting.
+    const qint64 link = 64 * KB;
+    const qint64 answer = 2 * KB;
+    const qint64 duration = 60000;
+
+    m_Now = 0;
+    BandwidthLimiter limiter(clock());
+    limiter.setTotalLimit(link);
+    limiter.setLimit(NetworkTask::Bulk, link * 80 / 100);
+    limiter.setActive(NetworkTask::Bulk, true);
+
+    qint64 bulk = 0;
+    qint64 pending = 0;
+    qint64 arrived = 0;
+    qint64 worstLatency = 0;
+    int answers = 0;
+
+    for (; m_Now < duration; m_Now += CNetworkTaskManager::ThrottleInterval) {
+        if (pending == 0 && m_Now % 500 == 0) {
+            pending = answer;
+            arrived = m_Now;
+            limiter.setActive(NetworkTask::Interactive, true);
+        }
+
+        if (pending > 0) {
+            pending -= limiter.acquire(NetworkTask::Interactive, pending);
+
+            if (pending == 0) {
+                worstLatency = qMax(worstLatency, m_Now - arrived);
+                ++answers;
+                limiter.setActive(NetworkTask::Interactive, false);
+            }
+        }
+
+        bulk += limiter.acquire(NetworkTask::Bulk, 1024 * KB);
+    }
+
+    qint64 bulkRate = bulk * 1000 / duration;
+
+    qDebug() << "simulated link" << link << "B/s: bulk" << bulkRate << "B/s," << answers
+             << "payment answers, worst latency" << worstLatency << "ms";
+
+    QCOMPARE(answers, int(duration / 500));
+    QVERIFY(worstLatency <= CNetworkTaskManager::ThrottleInterval);
+    QVERIFY(qAbs(bulkRate - link * 80 / 100) <= link / 100);
+}
+
+//---------------------------------------------------------------------------
+void TestBandwidthLimiter::benchmarkLocalServer() {
+    const qint64 bulkLimit = 2 * 1024 * KB;
+    const int duration = 3000;
+
+    // generated on the fly, the download is cut off after the measurement
+    m_Server.serve("bulk", 1024 * 1024 * KB, [](qint64, qint64 aSize) {
+        return QByteArray(static_cast<int>(aSize), 'b');
+    });
+    m_Manager.setTrafficLimit(NetworkTask::Bulk, bulkLimit);
+
+    NetworkTask bulk;
+    bulk.setUrl(m_Server.url("bulk"));
+    bulk.setTrafficClass(NetworkTask::Bulk);
+    bulk.setDataStream(new MemoryDataStream());
+
+    QElapsedTimer timer;
+    timer.start();
+    m_Manager.addTask(&bulk);
+
+    QList<qint64> latencies;
+
+    while (timer.elapsed() < duration) {
+        NetworkTask ping;
+        ping.setUrl(m_Server.url("ping"));
+        ping.setDataStream(new MemoryDataStream());
+
+        QEventLoop loop;
+        connect(&ping, &NetworkTask::onComplete, &loop, &QEventLoop::quit, Qt::QueuedConnection);
+        QTimer::singleShot(5000, &loop, SLOT(quit()));
+
+        QElapsedTimer latency;
+        latency.start();
+        m_Manager.addTask(&ping);
+        loop.exec();
+
+        QCOMPARE(ping.getError(), int(NetworkTask::NoError));
+        latencies << latency.elapsed();
+
+        // Keep draining the bulk buffer between pings.
+        QEventLoop pause;
+        QTimer::singleShot(100, &pause, SLOT(quit()));
+        pause.exec();
+    }
+
+    qint64 received = bulk.getCurrentSize();
+    qint64 elapsed = timer.elapsed();
+
+    m_Manager.removeTask(&bulk);
+    bulk.waitForFinished();
+    m_Manager.setTrafficLimit(NetworkTask::Bulk, 0);
+
+    std::sort(latencies.begin(), latencies.end());
+    qint64 rate = received * 1000 / qMax<qint64>(1, elapsed);
+
+    qDebug() << "bulk limit" << bulkLimit << "B/s, received" << rate << "B/s;" << latencies.size()
+             << "pings, median" << latencies.at(latencies.size() / 2) << "ms, max"
+             << latencies.last() << "ms";
+
+    // Qt's read buffer lets a little more than the limit through at start.
+    QVERIFY(rate <= bulkLimit * 3 / 2);
+    QVERIFY(latencies.last() < 1000);
+}
+
+QTEST_MAIN(TestBandwidthLimiter)
+#include "TestBandwidthLimiter.moc"
@@ -0,0 +1,347 @@
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QTimer>
+#include <QtTest/QtTest>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include <Common/ILog.h>
+
+#include <NetworkTaskManager/FileDataStream.h>
+#include <NetworkTaskManager/FileDownloadTask.h>
+#include <NetworkTaskManager/HashVerifier.h>
+#include <NetworkTaskManager/NetworkTaskManager.h>
+
+#include "../../common/HttpStandIn.h"
+
+namespace {
+const qint64 BlockSize = 1024 * 1024 + 7;
+
+// Peak resident set size of the process in KB, -1 if unknown.
+qint64 peakRss() {
+#ifdef Q_OS_LINUX
+    QFile status("/proc/self/status");
+    if (status.open(QIODevice::ReadOnly)) {
+        foreach (const QByteArray &line, status.readAll().split('\n')) {
+            if (line.startsWith("VmHWM:")) {
+                return line.mid(6).trimmed().split(' ').first().toLongLong();
+            }
+        }
+    }
+#endif
+
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return usage.ru_maxrss;
+    }
+#endif
+
+    return -1;
+}
+
+// The pre-streaming behaviour: the whole download is read back into memory and hashed at once.
+class BufferedSha256Verifier : public IVerifier {
+public:
+    explicit BufferedSha256Verifier(const QString &aHash) : m_Hash(aHash) {}
+
+    bool verify(NetworkTask * /*aTask*/, const QByteArray &aData) override {
+        return QString::fromLatin1(
+                   QCryptographicHash::hash(aData, QCryptographicHash::Sha256).toHex()) == m_Hash;
+    }
+
+private:
+    QString m_Hash;
+};
+
+// A synthetic file of any size that is never kept in memory. The content is a repeated
+// pseudo-random block.
+class SyntheticFile {
+public:
+    SyntheticFile() {
+        m_Block.resize(static_cast<int>(BlockSize));
+
+        quint32 seed = 12345;
+        for (int i = 0; i < m_Block.size(); ++i) {
+            seed = seed * 1103515245 + 12345;
+            m_Block[i] = static_cast<char>(seed >> 24);
+        }
+    }
+
+    QByteArray content(qint64 aOffset, qint64 aSize) const {
+        QByteArray result;
+        result.reserve(static_cast<int>(aSize));
+
+        while (result.size() < aSize) {
+            qint64 position = (aOffset + result.size()) % BlockSize;
+            result.append(m_Block.constData() + position,
+                          static_cast<int>(qMin(BlockSize - position, aSize - result.size())));
+        }
+
+        return result;
+    }
+
+    QString hash(qint64 aSize) const {
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+
+        for (qint64 offset = 0; offset < aSize; offset += BlockSize) {
+            hash.addData(content(offset, qMin(BlockSize, aSize - offset)));
+        }
+
+        return QString::fromLatin1(hash.result().toHex());
+    }
+
+private:
+    QByteArray m_Block;
+};
+} // namespace
+
+class TestStreamingDownload : public QObject {
+    Q_OBJECT
+
+public:
+    TestStreamingDownload() : m_Size(0), m_Manager(ILog::getInstance("TestStreamingDownload")) {}
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void testStreamingHash();
+    void testResumeRehydratesHash();
+    void testResumeCorruptedPrefix();
+    void testAlreadyComplete();
+    void testFlushThreshold();
+    void benchmarkLargeDownload();
+
+private:
+    // Runs aTask and waits for its completion signal.
+    bool run(NetworkTask *aTask, int aTimeout = 60000);
+
+    // Serves file.bin of aSize bytes.
+    void serve(qint64 aSize);
+
+    // Writes the first aSize bytes of the served file to aPath.
+    void writePrefix(const QString &aPath, qint64 aSize, bool aCorrupt = false);
+
+    HttpStandIn m_Server;
+    SyntheticFile m_File;
+    qint64 m_Size;
+    NetworkTaskManager m_Manager;
+    QTemporaryDir m_Dir;
+};
+
+//---------------------------------------------------------------------------
+void TestStreamingDownload::initTestCase() {
+    QVERIFY(m_Server.listen(QHostAddress::LocalHost));
+    QVERIFY(m_Dir.isValid());
+}
+
+//---------------------------------------------------------------------------
+void TestStreamingDownload::init() {
+    serve(8 * 1024 * 1024 + 123);
+    m_Server.reset();
+    QFile::remove(m_Dir.filePath("file.bin"));
+}
+
+//---------------------------------------------------------------------------
+bool TestStreamingDownload::run(NetworkTask *aTask, int aTimeout) {
+    // onComplete is emitted from the manager thread.
+    QEventLoop loop;
+    bool done = false;
+
+    connect(
+        aTask,
+        &NetworkTask::onComplete,
+        &loop,
+        [&]() {
+            done = true;
+            loop.quit();
+        },
+        Qt::QueuedConnection);
+    QTimer::singleShot(aTimeout, &loop, SLOT(quit()));
+
+    m_Manager.addTask(aTask);
+    loop.exec();
+
+    return done;
+}
+
+//---------------------------------------------------------------------------
+void TestStreamingDownload::serve(qint64 aSize) {
+    m_Size = aSize;
+    m_Server.serve("file.bin", aSize, [this](qint64 aOffset, qint64 aChunk) {
+        return m_File.content(aOffset, aChunk);
+    });
+}
+
+//---------------------------------------------------------------------------
+void TestStreamingDownload::writePrefix(const QString &aPath, qint64 aSize, bool aCorrupt) {
+    QByteArray data = m_File.content(0, aSize);
+
+    if (aCorrupt) {
+        int middle = static_cast<int>(aSize / 2);
+        data[middle] = static_cast<char>(data[middle] ^ 1);
+    }
+
+    QFile file(aPath);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(data), aSize);
+}
+
+//---------------------------------------------------------------------------
+void TestStreamingDownload::testStreamingHash() {
+    QString path = m_Dir.filePath("file.bin");
+    QString hash = m_File.hash(m_Size);
+
+    FileDownloadTask task(m_Server.url("file.bin"), path);
+    auto *verifier = new Sha256Verifier(hash.toUpper());
+    task.setVerifier(verifier);
+
+    QVERIFY(run(&task));
+    QCOMPARE(task.getError(), int(NetworkTask::NoError));
+    QCOMPARE(verifier->calculatedHash(), hash);
+
+    // The buffered tail is on disk as soon as the task reports completion.
+    QCOMPARE(QFileInfo(path).size(), m_Size);
+    task.closeFile();
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha256).toHex(),
+             hash.toLatin1());
+}
+
+//---------------------------------------------------------------------------
+void TestStreamingDownload::testResumeRehydratesHash() {
+    QString path = m_Dir.filePath("file.bin");
+    qint64 prefix = 3 * 1024 * 1024 + 5;
+    writePrefix(path, prefix);
+
+    FileDownloadTask task(m_Server.url("file.bin"), path);
+    auto *verifier = new Sha256Verifier(m_File.hash(m_Size));
+    task.setVerifier(verifier);
+
+    QVERIFY(run(&task));
+    QCOMPARE(task.getError(), int(NetworkTask::NoError));
+    QCOMPARE(m_Server.rangeHeaders().size(), 1);
+    QCOMPARE(m_Server.rangeHeaders().first(), "bytes=" + QByteArray::number(prefix) + "-");
+    QCOMPARE(verifier->calculatedHash(), verifier->referenceHash());
+    QCOMPARE(QFileInfo(path).size(), m_Size);
+}
+
+//---------------------------------------------------------------------------
+void TestStreamingDownload::testResumeCorruptedPrefix() {
+    QString path = m_Dir.filePath("file.bin");
+    writePrefix(path, 2 * 1024 * 1024, true);
+
+    FileDownloadTask task(m_Server.url("file.bin"), path);
+    task.setVerifier(new Sha256Verifier(m_File.hash(m_Size)));
+
+    QVERIFY(run(&task));
+    QCOMPARE(task.getError(), int(NetworkTask::VerifyFailed));
+}
+
+//---------------------------------------------------------------------------
+void TestStreamingDownload::testAlreadyComplete() {
+    QString path = m_Dir.filePath("file.bin");
+    writePrefix(path, m_Size);
+
+    FileDownloadTask task(m_Server.url("file.bin"), path);
+    auto *verifier = new Sha256Verifier(m_File.hash(m_Size));
+    task.setVerifier(verifier);
+
+    // Nothing is left to download: the server answers 416 and the file on disk is hashed.
+    QVERIFY(run(&task));
+    QCOMPARE(task.getError(), int(NetworkTask::TaskFailedButVerified));
+    QCOMPARE(verifier->calculatedHash(), verifier->referenceHash());
+}
+
+//---------------------------------------------------------------------------
+void TestStreamingDownload::testFlushThreshold() {
+    QString path = m_Dir.filePath("stream.bin");
+    QFile::remove(path);
+
+    FileDataStream stream(path);
+    stream.setFlushThreshold(100);
+
+    QVERIFY(stream.write(QByteArray(60, 'a')));
+    QCOMPARE(QFileInfo(path).size(), qint64(0));
+    QCOMPARE(stream.size(), qint64(60));
+    QCOMPARE(stream.pos(), qint64(60));
+
+    QVERIFY(stream.write(QByteArray(60, 'b')));
+    QCOMPARE(QFileInfo(path).size(), qint64(120));
+
+    // Reading sees buffered data.
+    QVERIFY(stream.write(QByteArray(10, 'c')));
+    QCOMPARE(stream.read(115, 100), QByteArray(5, 'b') + QByteArray(10, 'c'));
+    QCOMPARE(QFileInfo(path).size(), qint64(130));
+
+    stream.setFlushThreshold(0);
+    QVERIFY(stream.write(QByteArray(1, 'd')));
+    QCOMPARE(QFileInfo(path).size(), qint64(131));
+
+    QVERIFY(stream.clear());
+    QCOMPARE(stream.size(), qint64(0));
+}
+
+//---------------------------------------------------------------------------
+void TestStreamingDownload::benchmarkLargeDownload() {
+    // EK_DOWNLOAD_BENCHMARK_MB overrides the download size.
+    qint64 megabytes = qEnvironmentVariableIsSet("EK_DOWNLOAD_BENCHMARK_MB")
+                           ? qgetenv("EK_DOWNLOAD_BENCHMARK_MB").toLongLong()
+                           : 500;
+
+    serve(megabytes * 1024 * 1024);
+    QString hash = m_File.hash(m_Size);
+    QString path = m_Dir.filePath("file.bin");
+
+    // The streaming path runs first because the peak RSS only grows.
+    {
+        qint64 rssBefore = peakRss();
+        QElapsedTimer timer;
+        timer.start();
+
+        FileDownloadTask task(m_Server.url("file.bin"), path);
+        task.setVerifier(new Sha256Verifier(hash));
+
+        QVERIFY(run(&task, 600000));
+        QCOMPARE(task.getError(), int(NetworkTask::NoError));
+
+        qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+        qDebug() << "streaming:" << megabytes << "MB in" << elapsed << "ms,"
+                 << megabytes * 1000 / elapsed << "MB/s, peak RSS" << rssBefore << "->"
+                 << peakRss() << "KB";
+    }
+
+    QVERIFY(QFile::remove(path));
+
+    {
+        qint64 rssBefore = peakRss();
+        QElapsedTimer timer;
+        timer.start();
+
+        FileDownloadTask task(m_Server.url("file.bin"), path);
+        static_cast<FileDataStream *>(task.getDataStream())->setFlushThreshold(0);
+        task.setVerifier(new BufferedSha256Verifier(hash));
+
+        QVERIFY(run(&task, 600000));
+        QCOMPARE(task.getError(), int(NetworkTask::NoError));
+
+        qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+        qDebug() << "flush per chunk + readAll():" << megabytes << "MB in" << elapsed << "ms,"
+                 << megabytes * 1000 / elapsed << "MB/s, peak RSS" << rssBefore << "->"
+                 << peakRss() << "KB";
+    }
+
+    QVERIFY(QFile::remove(path));
+}
+
+QTEST_MAIN(TestStreamingDownload)
+#include "TestStreamingDownload.moc"
@@ -0,0 +1,290 @@
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QTimer>
+#include <QtTest/QtTest>
+
+#include <Common/ILog.h>
+
+#include <NetworkTaskManager/MemoryDataStream.h>
+#include <NetworkTaskManager/NetworkTask.h>
+#include <NetworkTaskManager/NetworkTaskManager.h>
+#include <NetworkTaskManager/TimerWheel.h>
+#include <algorithm>
+
+#include "../../common/HttpStandIn.h"
+
+namespace {
+const int SyntheticTasks = 10000;
+} // namespace
+
+class TestTaskRegistry : public QObject {
+    Q_OBJECT
+
+public:
+    TestTaskRegistry() : m_Manager(ILog::getInstance("TestTaskRegistry")) {}
+
+private slots:
+    void initTestCase();
+
+    void testWheelExpiry();
+    void testWheelReschedule();
+    void testWheelLongDelay();
+    void testWheelPause();
+    void testTimings();
+    void testTimeout();
+    void testCancel();
+    void benchmarkSyntheticTasks();
+    void benchmarkCancel();
+
+private:
+    /// Runs the event loop until aCount tasks report completion or aTimeout ms pass.
+    bool waitForCompletion(const QList<NetworkTask *> &aTasks, int aCount, int aTimeout);
+
+    NetworkTask *createTask(const QString &aPath, int aTimeout = 0);
+
+    HttpStandIn m_Server;
+    NetworkTaskManager m_Manager;
+};
+
+//---------------------------------------------------------------------------
+void TestTaskRegistry::initTestCase() {
+    m_Server.serve("ping", QByteArray(64, 'p'));
+    m_Server.hang("hang");
+    QVERIFY(m_Server.listen(QHostAddress::LocalHost));
+}
+
+//---------------------------------------------------------------------------
+NetworkTask *TestTaskRegistry::createTask(const QString &aPath, int aTimeout) {
+    auto *task = new NetworkTask();
+    task->setUrl(m_Server.url(aPath));
+    task->setTimeout(aTimeout);
+    task->setDataStream(new MemoryDataStream());
+
+    return task;
+}
+
+//---------------------------------------------------------------------------
+bool TestTaskRegistry::waitForCompletion(const QList<NetworkTask *> &aTasks,
+                                         int aCount,
+                                         int aTimeout) {
+    int completed = 0;
+    QEventLoop loop;
+
+    foreach (NetworkTask *task, aTasks) {
+        connect(
+            task,
+            &NetworkTask::onComplete,
+            &loop,
+            [&]() {
+                if (++completed == aCount) {
+                    loop.quit();
+                }
+            },
+            Qt::QueuedConnection);
+    }
+
+    QTimer::singleShot(aTimeout, &loop, SLOT(quit()));
+
+    foreach (NetworkTask *task, aTasks) {
+        if (task->getState() == NetworkTask::Created) {
+            m_Manager.addTask(task);
+        }
+    }
+
+    if (completed < aCount) {
+        loop.exec();
+    }
+
+    return completed == aCount;
+}
+
+//---------------------------------------------------------------------------
+void TestTaskRegistry::testWheelExpiry() {
+    TimerWheel<int> wheel(100);
+
+    wheel.schedule(1, 250);
+    wheel.schedule(2, 90);
+    QCOMPARE(wheel.size(), 2);
+
+    // A deadline fires no earlier than requested and within one tick after it.
+    QVERIFY(wheel.advance(89).isEmpty());
+    QCOMPARE(wheel.advance(100), QList<int>() << 2);
+    QVERIFY(wheel.advance(249).isEmpty());
+    QCOMPARE(wheel.advance(300), QList<int>() << 1);
+    QVERIFY(wheel.isEmpty());
+
+    // Deadlines already in the past fire on the next tick.
+    wheel.schedule(3, 0);
+    QCOMPARE(wheel.advance(400), QList<int>() << 3);
+}
+
+//---------------------------------------------------------------------------
+void TestTaskRegistry::testWheelReschedule() {
+    TimerWheel<int> wheel(100);
+
+    wheel.schedule(1, 100);
+    wheel.schedule(1, 500);
+    QCOMPARE(wheel.size(), 1);
+    QVERIFY(wheel.advance(200).isEmpty());
+
+    QVERIFY(wheel.cancel(1));
+    QVERIFY(!wheel.cancel(1));
+    QVERIFY(!wheel.contains(1));
+    QVERIFY(wheel.advance(1000).isEmpty());
+}
+
+//---------------------------------------------------------------------------
+void TestTaskRegistry::testWheelLongDelay() {
+    // 8 slots of 10 ms: the deadline is more than ten turns away.
+    TimerWheel<int> wheel(10, 8);
+    wheel.schedule(1, 1005);
+
+    for (qint64 now = 10; now < 1005; now += 10) {
+        QVERIFY2(wheel.advance(now).isEmpty(), qPrintable(QString::number(now)));
+    }
+
+    QCOMPARE(wheel.advance(1010), QList<int>() << 1);
+}
+
+//---------------------------------------------------------------------------
+void TestTaskRegistry::testWheelPause() {
+    TimerWheel<int> wheel(10, 8);
+
+    for (int i = 0; i < 100; ++i) {
+        wheel.schedule(i, i * 7);
+    }
+
+    // A long stall expires everything that is due in a single call.
+    QList<int> expired = wheel.advance(350);
+    std::sort(expired.begin(), expired.end());
+
+    QCOMPARE(expired.size(), 51);
+    QCOMPARE(expired.first(), 0);
+    QCOMPARE(expired.last(), 50);
+    QCOMPARE(wheel.size(), 49);
+}
+
+//---------------------------------------------------------------------------
+void TestTaskRegistry::testTimings() {
+    QScopedPointer<NetworkTask> task(createTask("ping"));
+    QCOMPARE(task->getState(), NetworkTask::Created);
+
+    QVERIFY(waitForCompletion(QList<NetworkTask *>() << task.data(), 1, 5000));
+
+    NetworkTask::STimings timings = task->getTimings();
+
+    QCOMPARE(task->getState(), NetworkTask::Finished);
+    QCOMPARE(task->getError(), int(NetworkTask::NoError));
+    QVERIFY(timings.queue >= 0);
+    QVERIFY(timings.firstByte >= 0);
+    QVERIFY(timings.total >= timings.queue + timings.firstByte);
+
+    // Connection stages are reported by Qt 6.3+ and only for a fresh connection.
+    QVERIFY(timings.dns < 0 || timings.connect >= 0);
+}
+
+//---------------------------------------------------------------------------
+void TestTaskRegistry::testTimeout() {
+    const int timeout = 300;
+
+    QScopedPointer<NetworkTask> task(createTask("hang", timeout));
+
+    QVERIFY(waitForCompletion(QList<NetworkTask *>() << task.data(), 1, 5000));
+
+    qint64 total = task->getTimings().total;
+
+    // The manager and the task keep separate millisecond clocks.
+    QCOMPARE(task->getError(), int(NetworkTask::Timeout));
+    QVERIFY(total + 1 >= timeout);
+    QVERIFY(total < timeout + 2 * CNetworkTaskManager::TimeoutResolution + 200);
+}
+
+//---------------------------------------------------------------------------
+void TestTaskRegistry::testCancel() {
+    QScopedPointer<NetworkTask> hanging(createTask("hang", 60000));
+    QScopedPointer<NetworkTask> ping(createTask("ping"));
+
+    m_Manager.addTask(hanging.data());
+    QVERIFY(waitForCompletion(QList<NetworkTask *>() << ping.data(), 1, 5000));
+    QCOMPARE(hanging->getState(), NetworkTask::Running);
+
+    m_Manager.removeTask(hanging.data());
+    hanging->waitForFinished();
+
+    QCOMPARE(hanging->getState(), NetworkTask::Finished);
+    QVERIFY(hanging->getError() != int(NetworkTask::Timeout));
+}
+
+//---------------------------------------------------------------------------
+void TestTaskRegistry::benchmarkSyntheticTasks() {
+    QList<NetworkTask *> tasks;
+
+    for (int i = 0; i < SyntheticTasks; ++i) {
+        tasks << createTask(QString("ping?%1").arg(i), 60000);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVERIFY(waitForCompletion(tasks, SyntheticTasks, 120000));
+
+    qint64 elapsed = timer.elapsed();
+
+    QList<qint64> queue;
+    QList<qint64> firstByte;
+    int failed = 0;
+
+    foreach (NetworkTask *task, tasks) {
+        queue << task->getTimings().queue;
+        firstByte << task->getTimings().firstByte;
+        failed += task->getError() != NetworkTask::NoError ? 1 : 0;
+    }
+
+    std::sort(queue.begin(), queue.end());
+    std::sort(firstByte.begin(), firstByte.end());
+
+    qDebug() << SyntheticTasks << "concurrent tasks in" << elapsed << "ms;"
+             << "queue median" << queue.at(queue.size() / 2) << "ms, max" << queue.last()
+             << "ms; first byte median" << firstByte.at(firstByte.size() / 2) << "ms, max"
+             << firstByte.last() << "ms";
+
+    qDeleteAll(tasks);
+
+    QCOMPARE(failed, 0);
+}
+
+//---------------------------------------------------------------------------
+void TestTaskRegistry::benchmarkCancel() {
+    QList<NetworkTask *> tasks;
+
+    for (int i = 0; i < SyntheticTasks; ++i) {
+        tasks << createTask(QString("hang?%1").arg(i), 60000);
+        m_Manager.addTask(tasks.last());
+    }
+
+    // Let the manager register every task before cancelling them in reverse order.
+    QScopedPointer<NetworkTask> marker(createTask("ping"));
+    QVERIFY(waitForCompletion(QList<NetworkTask *>() << marker.data(), 1, 60000));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = tasks.size() - 1; i >= 0; --i) {
+        m_Manager.removeTask(tasks.at(i));
+    }
+
+    foreach (NetworkTask *task, tasks) {
+        task->waitForFinished();
+    }
+
+    qDebug() << "cancelled" << SyntheticTasks << "in-flight tasks in" << timer.elapsed() << "ms";
+
+    foreach (NetworkTask *task, tasks) {
+        QCOMPARE(task->getState(), NetworkTask::Finished);
+    }
+
+    qDeleteAll(tasks);
+}
+
+QTEST_MAIN(TestTaskRegistry)
+#include "TestTaskRegistry.moc"
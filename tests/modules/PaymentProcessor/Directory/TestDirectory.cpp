@@ -1,17 +1,29 @@
 /* @file Тесты для Directory - проверка безопасности доступа к property tree */
 
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRandomGenerator>
 #include <QtTest/QtTest>
 
 #include <SDK/PaymentProcessor/Settings/Directory.h>
 
+#include <algorithm>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
+#include <iterator>
+#include <limits>
 
 using namespace SDK::PaymentProcessor;
 
 // Для чтения XML используем ptree со string/string
 using XmlPtree = boost::property_tree::basic_ptree<std::string, std::string>;
 
+namespace {
+const int RangeCount = 20000;
+const int VirtualRangeCount = 2000;
+const int LookupCount = 1000000;
+const qint64 FirstNumber = 901000000;
+} // namespace
+
 class TestDirectory : public QObject {
     Q_OBJECT
 
@@ -50,7 +62,231 @@ private:
         }
     }
 
+    /// Номерная ёмкость как в numcapacity.xml: обычные диапазоны не пересекаются, виртуальные
+    /// частично перекрывают друг друга цепочкой и лежат поверх обычных.
+    void generateRanges(QVector<SRange> &aRanges, QVector<SRange> &aOverlappedRanges) {
+        QRandomGenerator random(20240101);
+        qint64 from = FirstNumber;
+
+        for (int i = 0; i < RangeCount; ++i) {
+            SRange range;
+            range.from = from;
+            range.to = from + random.bounded(1, 10000);
+            range.cids << 100 + random.bounded(50);
+
+            if (i % 7 == 0) {
+                range.cids << 200 + random.bounded(50);
+            }
+
+            aRanges << range;
+            from = range.to + 1 + (i % 5 == 0 ? random.bounded(1, 5000) : 0);
+        }
+
+        for (int i = 0; i < VirtualRangeCount; ++i) {
+            const SRange &base = aRanges[random.bounded(RangeCount)];
+
+            SRange range;
+            range.from = base.from + random.bounded(int(base.to - base.from + 1));
+            range.to = range.from + random.bounded(1, 20000);
+            range.ids << 5000 + random.bounded(300);
+
+            if (i % 10 == 0 && !aOverlappedRanges.isEmpty()) {
+                // Продолжение предыдущего виртуального диапазона с перекрытием.
+                const SRange &previous = aOverlappedRanges.last();
+                range.from = previous.to - random.bounded(1, 100);
+                range.to = previous.to + random.bounded(1, 20000);
+            }
+
+            aOverlappedRanges << range;
+        }
+
+        std::sort(aRanges.begin(), aRanges.end());
+        std::sort(aOverlappedRanges.begin(), aOverlappedRanges.end());
+
+        // Конец очередного виртуального диапазона не меньше предыдущего, как в реальных данных.
+        for (int i = 1; i < aOverlappedRanges.size(); ++i) {
+            aOverlappedRanges[i].to = qMax(aOverlappedRanges[i].to, aOverlappedRanges[i - 1].to);
+        }
+    }
+
+    /// Дерево свойств с номерной ёмкостью.
+    TPtree createNumCapacity(const QVector<SRange> &aRanges,
+                             const QVector<SRange> &aOverlappedRanges) {
+        QString xml = "<root><Directory><numcapacity stamp=\"2024-01-01T00:00:00\">";
+
+        foreach (const SRange &range, aRanges + aOverlappedRanges) {
+            xml += QString("<record from=\"%1\" to=\"%2\">").arg(range.from).arg(range.to);
+
+            foreach (qint64 cid, range.cids) {
+                xml += QString("<cid>%1</cid>").arg(cid);
+            }
+
+            foreach (qint64 id, range.ids) {
+                xml += QString("<id>%1</id>").arg(id);
+            }
+
+            xml += "</record>";
+        }
+
+        return createPtree(xml + "</numcapacity></Directory></root>");
+    }
+
+    /// Поиск двоичным поиском по отсортированным спискам, как до индекса.
+    QList<SRange> legacyLookup(const QVector<SRange> &aRanges,
+                               const QVector<SRange> &aOverlappedRanges,
+                               qint64 aNumber) {
+        QList<SRange> ranges;
+
+        auto begin = std::lower_bound(aOverlappedRanges.begin(), aOverlappedRanges.end(), aNumber);
+        auto end = std::upper_bound(aOverlappedRanges.begin(), aOverlappedRanges.end(), aNumber);
+
+        if (begin == end) {
+            begin = std::lower_bound(aRanges.begin(), aRanges.end(), aNumber);
+            end = std::upper_bound(aRanges.begin(), aRanges.end(), aNumber);
+        }
+
+        std::copy(begin, end, std::back_inserter(ranges));
+
+        return ranges;
+    }
+
+    /// Сравнивает найденные диапазоны.
+    bool sameRanges(const QList<SRange> &aActual, const QList<SRange> &aExpected) {
+        if (aActual.size() != aExpected.size()) {
+            return false;
+        }
+
+        for (int i = 0; i < aActual.size(); ++i) {
+            if (aActual[i].from != aExpected[i].from || aActual[i].to != aExpected[i].to ||
+                aActual[i].cids != aExpected[i].cids || aActual[i].ids != aExpected[i].ids) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
 private slots:
+    /// Тест: поиск по индексу совпадает с прежним поиском по спискам диапазонов
+    void testRangeLookupMatchesLegacy() {
+        QVector<SRange> ranges;
+        QVector<SRange> overlapped;
+        generateRanges(ranges, overlapped);
+
+        TPtree ptree = createNumCapacity(ranges, overlapped);
+        Directory directory(ptree);
+
+        QList<qint64> numbers;
+        numbers << 0 << FirstNumber - 1 << std::numeric_limits<qint64>::max();
+
+        // Все границы и соседние с ними номера.
+        foreach (const SRange &range, ranges + overlapped) {
+            numbers << range.from - 1 << range.from << range.to << range.to + 1;
+        }
+
+        QRandomGenerator random(42);
+        qint64 last = ranges.last().to + 30000;
+
+        for (int i = 0; i < 200000; ++i) {
+            numbers << FirstNumber - 1000 + random.bounded(int(last - FirstNumber));
+        }
+
+        int virtualHits = 0;
+
+        foreach (qint64 number, numbers) {
+            QList<SRange> actual = directory.getRangesForNumber(number);
+            QList<SRange> expected = legacyLookup(ranges, overlapped, number);
+
+            if (!sameRanges(actual, expected)) {
+                QFAIL(qPrintable(QString("Lookup mismatch for %1").arg(number)));
+            }
+
+            if (!actual.isEmpty() && !actual.first().ids.isEmpty()) {
+                ++virtualHits;
+            }
+        }
+
+        QVERIFY(virtualHits > 0);
+    }
+
+    /// Тест: вложенные и пересекающиеся диапазоны - все диапазоны, содержащие номер
+    void testNestedRanges() {
+        QString xml = "<root><Directory><numcapacity stamp=\"2024-01-01T00:00:00\">"
+                      "<record from=\"100\" to=\"199\"><cid>1</cid></record>"
+                      "<record from=\"120\" to=\"129\"><cid>2</cid></record>"
+                      "<record from=\"150\" to=\"250\"><cid>3</cid></record>"
+                      "<record from=\"300\" to=\"399\"><cid>4</cid></record>"
+                      "<record from=\"310\" to=\"390\"><id>10</id></record>"
+                      "<record from=\"320\" to=\"330\"><id>11</id></record>"
+                      "<record from=\"500\" to=\"400\"><cid>5</cid></record>"
+                      "</numcapacity></Directory></root>";
+
+        TPtree ptree = createPtree(xml);
+        Directory directory(ptree);
+
+        auto cids = [&directory](qint64 aNumber) {
+            QList<qint64> result;
+            foreach (const SRange &range, directory.getRangesForNumber(aNumber)) {
+                result << (range.ids.isEmpty() ? range.cids.first() : range.ids.first());
+            }
+            return result;
+        };
+
+        QCOMPARE(cids(99), QList<qint64>());
+        QCOMPARE(cids(110), QList<qint64>() << 1);
+        QCOMPARE(cids(125), QList<qint64>() << 1 << 2);
+        QCOMPARE(cids(140), QList<qint64>() << 1);
+        QCOMPARE(cids(160), QList<qint64>() << 1 << 3);
+        QCOMPARE(cids(200), QList<qint64>() << 3);
+        QCOMPARE(cids(260), QList<qint64>());
+        QCOMPARE(cids(305), QList<qint64>() << 4);
+        QCOMPARE(cids(315), QList<qint64>() << 10);
+        QCOMPARE(cids(325), QList<qint64>() << 10 << 11);
+        QCOMPARE(cids(395), QList<qint64>() << 4);
+        QCOMPARE(cids(450), QList<qint64>());
+    }
+
+    /// Бенчмарк: 1M поисков по индексу и прежним двоичным поиском
+    void benchmarkRangeLookup() {
+        QVector<SRange> ranges;
+        QVector<SRange> overlapped;
+        generateRanges(ranges, overlapped);
+
+        TPtree ptree = createNumCapacity(ranges, overlapped);
+        Directory directory(ptree);
+
+        QRandomGenerator random(7);
+        QVector<qint64> numbers(LookupCount);
+        qint64 span = ranges.last().to - FirstNumber;
+
+        for (qint64 &number : numbers) {
+            number = FirstNumber + random.bounded(int(span));
+        }
+
+        QElapsedTimer timer;
+        qint64 found = 0;
+
+        timer.start();
+        foreach (qint64 number, numbers) {
+            found += directory.getRangesForNumber(number).size();
+        }
+        qint64 indexTime = timer.elapsed();
+
+        qint64 legacyFound = 0;
+
+        timer.restart();
+        foreach (qint64 number, numbers) {
+            legacyFound += legacyLookup(ranges, overlapped, number).size();
+        }
+        qint64 legacyTime = timer.elapsed();
+
+        QCOMPARE(found, legacyFound);
+
+        qDebug() << "ranges:" << ranges.size() << "virtual:" << overlapped.size()
+                 << "lookups:" << LookupCount;
+        qDebug() << "index:" << indexTime << "ms, sorted lists:" << legacyTime << "ms";
+    }
+
     /// Тест: пустое дерево свойств -> должен возвращать пустой список без крашей
     void testEmptyPropertyTree() {
         TPtree emptyPtree;
@@ -0,0 +1,549 @@
+/* @file Тесты конвейера RequestSender против локального шлюза, подписывающего ответы. */
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMessageAuthenticationCode>
+#include <QtCore/QMutex>
+#include <QtCore/QSemaphore>
+#include <QtCore/QSet>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+
+#include <Common/ILog.h>
+
+#include <SDK/PaymentProcessor/Humo/Request.h>
+#include <SDK/PaymentProcessor/Humo/RequestSender.h>
+#include <SDK/PaymentProcessor/Humo/Response.h>
+
+#include <Crypt/ICryptEngine.h>
+#include <NetworkTaskManager/NetworkTaskManager.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "../../../common/HttpStandIn.h"
+
+using namespace SDK::PaymentProcessor::Humo;
+
+namespace {
+const int Latency = 5;        // ответ шлюза, мс
+const int SlowLatency = 5000; // ответ /slow, мс
+const int SignRounds = 2000;  // цена подписи, приближённая к RSA
+const int BenchmarkRequests = 500;
+
+/// Подпись HMAC-SHA256 на общем тестовом ключе. Подписанное сообщение - hex-дайджест и само
+/// сообщение; дополнительные раунды хеширования придают подписи реальную цену.
+class TestCryptEngine : public ICryptEngine {
+public:
+    bool initialize() override { return true; }
+    void shutdown() override {}
+    QSet<CCrypt::ETypeEngine> availableEngines() override {
+        return QSet<CCrypt::ETypeEngine>() << CCrypt::File;
+    }
+    CCrypt::TokenStatus getTokenStatus(CCrypt::ETypeEngine) override {
+        return CCrypt::TokenStatus();
+    }
+    bool initializeToken(CCrypt::ETypeEngine) override { return false; }
+    QByteArray generatePassword() const override { return QByteArray(); }
+    QList<QByteArray> getRootPassword() const override { return QList<QByteArray>(); }
+
+    bool createKeyPair(const QString &,
+                       const QString &,
+                       const QString &,
+                       const QString &,
+                       const ulong,
+                       QString &) override {
+        return false;
+    }
+    bool createKeyPair(int, CCrypt::ETypeEngine, const QByteArray &, int, QString &) override {
+        return false;
+    }
+    bool loadKeyPair(int,
+                     CCrypt::ETypeEngine,
+                     const QString &,
+                     const QString &,
+                     const QString &,
+                     const ulong,
+                     const ulong,
+                     QString &) override {
+        return false;
+    }
+    QString getKeyPairSerialNumber(int) override { return "100500"; }
+    bool releaseKeyPair(int) override { return true; }
+    void releaseKeyPairs() override {}
+    bool replacePublicKey(int, const QByteArray &) override { return false; }
+    bool exportSecretKey(int, QByteArray &, const QByteArray &) override { return false; }
+    bool exportSecretKeyToFile(int, const QString &, const QByteArray &) override { return false; }
+    bool exportPublicKey(int, QByteArray &, ulong &) override { return false; }
+    bool exportPublicKeyToFile(int, const QString &, ulong &) override { return false; }
+
+    bool sign(int, const QByteArray &aRequest, QByteArray &aSignature, QString &) override {
+        aSignature = digest(aRequest) + aRequest;
+        return true;
+    }
+    bool signDetach(int, const QByteArray &aRequest, QByteArray &aSignature, QString &) override {
+        aSignature = digest(aRequest);
+        return true;
+    }
+    bool signBatch(int aKeyPair,
+                   const QList<QByteArray> &aRequests,
+                   QList<QByteArray> &aSignatures,
+                   QString &aError) override {
+        aSignatures.clear();
+
+        foreach (const QByteArray &request, aRequests) {
+            QByteArray signature;
+            sign(aKeyPair, request, signature, aError);
+            aSignatures << signature;
+        }
+
+        return true;
+    }
+    bool verify(int,
+                const QByteArray &aResponse,
+                QByteArray &aOriginal,
+                QString &aError) override {
+        aOriginal = aResponse.mid(64);
+
+        if (aResponse.left(64) != digest(aOriginal)) {
+            aError = "signature mismatch";
+            return false;
+        }
+
+        return true;
+    }
+    bool verifyDetach(int,
+                      const QByteArray &aResponse,
+                      const QByteArray &aSignature,
+                      QString &) override {
+        return aSignature == digest(aResponse);
+    }
+    bool verifyBatch(int aKeyPair,
+                     const QList<QByteArray> &aResponses,
+                     QList<QByteArray> &aOriginals,
+                     QString &aError) override {
+        aOriginals.clear();
+
+        foreach (const QByteArray &response, aResponses) {
+            QByteArray original;
+
+            if (!verify(aKeyPair, response, original, aError)) {
+                return false;
+            }
+
+            aOriginals << original;
+        }
+
+        return true;
+    }
+
+    bool encrypt(int, const QByteArray &, QByteArray &, CCrypt::ETypeKey, QString &) override {
+        return false;
+    }
+    bool encrypt(int, const QByteArray &, QByteArray &, QString &) override { return false; }
+    bool encryptLong(int, const QByteArray &, QByteArray &, CCrypt::ETypeKey, QString &) override {
+        return false;
+    }
+    bool encryptLong(int, const QByteArray &, QByteArray &, QString &) override { return false; }
+    bool decrypt(int, const QByteArray &, QByteArray &, CCrypt::ETypeKey, QString &) override {
+        return false;
+    }
+    bool decrypt(int, const QByteArray &, QByteArray &, QString &) override { return false; }
+    bool decryptLong(int, const QByteArray &, QByteArray &, CCrypt::ETypeKey, QString &) override {
+        return false;
+    }
+    bool decryptLong(int, const QByteArray &, QByteArray &, QString &) override { return false; }
+    bool setData(const QString &, const QByteArray &) override { return false; }
+    bool getData(const QString &, QByteArray &) override { return false; }
+
+private:
+    static QByteArray digest(const QByteArray &aData) {
+        QByteArray hash =
+            QMessageAuthenticationCode::hash(aData, "test-key", QCryptographicHash::Sha256);
+
+        for (int i = 0; i < SignRounds; ++i) {
+            hash = QCryptographicHash::hash(hash, QCryptographicHash::Sha256);
+        }
+
+        return hash.toHex();
+    }
+};
+
+/// Шлюз: проверяет подпись inputmessage и возвращает SESSION в подписанном ответе. aCorrupt
+/// портит подпись ответа. Вызывается в потоке сервера.
+HttpStandIn::THandler gateway(ICryptEngine *aCrypt, bool aCorrupt = false) {
+    return [aCrypt, aCorrupt](const HttpStandIn::SRequest &aRequest) {
+        QByteArray message = aRequest.body.left(aRequest.body.indexOf('\n'));
+        message = QByteArray::fromPercentEncoding(message.mid(message.indexOf('=') + 1));
+
+        QByteArray request;
+        QString error;
+        QByteArray answer = "ERROR=1\r\nRESULT=1\r\n";
+
+        if (aCrypt->verify(0, message, request, error)) {
+            QByteArray session;
+
+            foreach (const QByteArray &line, request.split('\n')) {
+                if (line.startsWith("SESSION=")) {
+                    session = line.mid(8).trimmed();
+                }
+            }
+
+            answer = "ERROR=0\r\nRESULT=0\r\nSESSION=" + session + "\r\n";
+        }
+
+        QByteArray signedAnswer;
+        aCrypt->sign(0, answer, signedAnswer, error);
+
+        if (aCorrupt) {
+            signedAnswer[0] = signedAnswer[0] == 'a' ? 'b' : 'a';
+        }
+
+        return signedAnswer;
+    };
+}
+
+/// Результаты асинхронных запросов из рабочих потоков.
+struct SResults {
+    QMutex mutex;
+    QSemaphore done;
+    QList<RequestSender::ESendError> errors;
+    QList<qint64> latencies;
+    int ok = 0;
+};
+
+qint64 percentile(QList<qint64> aValues, int aPercent) {
+    std::sort(aValues.begin(), aValues.end());
+
+    return aValues.isEmpty() ? -1 : aValues.at((aValues.size() - 1) * aPercent / 100);
+}
+} // namespace
+
+class TestRequestSender : public QObject {
+    Q_OBJECT
+
+public:
+    TestRequestSender() : m_Network(ILog::getInstance("TestRequestSender")) {}
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testSyncRoundTrip();
+    void testErrors();
+    void testResponseCreatorThread();
+    void testAsyncInFlightWindow();
+    void testDestroyWhilePending();
+    void testDestroyAfterNetworkStopped();
+    void benchmarkThroughput();
+
+private:
+    RequestSender *createSender();
+
+    /// Отправляет aCount POST запросов на aPath и ждёт все ответы.
+    bool sendAsync(RequestSender *aSender, const QString &aPath, int aCount, SResults &aResults);
+
+    TestCryptEngine m_Crypt;
+    NetworkTaskManager m_Network;
+    // Синхронные запросы блокируют поток теста, поэтому шлюз работает в своём потоке.
+    HttpStandInThread m_Gateway;
+};
+
+//---------------------------------------------------------------------------
+void TestRequestSender::initTestCase() {
+    ICryptEngine *crypt = &m_Crypt;
+
+    // /bad портит подпись ответа, /slow отвечает через SlowLatency мс.
+    m_Gateway.startAndWait([crypt](HttpStandIn &aServer) {
+        aServer.reply("pay", gateway(crypt), Latency);
+        aServer.reply("bad", gateway(crypt, true), Latency);
+        aServer.reply("slow", gateway(crypt), SlowLatency);
+    });
+}
+
+//---------------------------------------------------------------------------
+void TestRequestSender::cleanupTestCase() {
+    m_Gateway.quit();
+    m_Gateway.wait();
+}
+
+//---------------------------------------------------------------------------
+RequestSender *TestRequestSender::createSender() {
+    auto *sender = new RequestSender(&m_Network, &m_Crypt);
+    sender->setOnlySecureConnectionEnabled(false);
+
+    return sender;
+}
+
+//---------------------------------------------------------------------------
+bool TestRequestSender::sendAsync(RequestSender *aSender,
+                                  const QString &aPath,
+                                  int aCount,
+                                  SResults &aResults) {
+    std::vector<std::unique_ptr<Request>> requests;
+    QElapsedTimer clock;
+    clock.start();
+
+    for (int i = 0; i < aCount; ++i) {
+        requests.emplace_back(new Request());
+        requests.back()->addParameter("SESSION", i);
+
+        qint64 started = clock.elapsed();
+        QString session = QString::number(i);
+
+        aSender->postAsync(
+            m_Gateway.url(aPath),
+            *requests.back(),
+            RequestSender::Solid,
+            [&aResults, &clock, started, session](Response *aResponse,
+                                                  RequestSender::ESendError aError) {
+                std::unique_ptr<Response> response(aResponse);
+
+                QMutexLocker lock(&aResults.mutex);
+
+                aResults.errors << aError;
+                aResults.latencies << clock.elapsed() - started;
+
+                if (response && response->isOk() &&
+                    response->getParameter("SESSION").toString() == session) {
+                    ++aResults.ok;
+                }
+
+                aResults.done.release();
+            });
+    }
+
+    return aResults.done.tryAcquire(aCount, 60000);
+}
+
+//---------------------------------------------------------------------------
+void TestRequestSender::testSyncRoundTrip() {
+    QScopedPointer<RequestSender> sender(createSender());
+
+    Request request;
+    request.addParameter("SESSION", "42");
+
+    RequestSender::ESendError error = RequestSender::NetworkError;
+    std::unique_ptr<Response> response(
+        sender->post(m_Gateway.url("pay"), request, RequestSender::Solid, error));
+
+    QCOMPARE(error, RequestSender::Ok);
+    QVERIFY(response != nullptr);
+    QVERIFY(response->isOk());
+    QCOMPARE(response->getParameter("SESSION").toString(), QString("42"));
+    QCOMPARE(request.getParameter("ACCEPT_KEYS").toString(), QString("100500"));
+    QCOMPARE(sender->getPendingCount(), 0);
+}
+
+//---------------------------------------------------------------------------
+void TestRequestSender::testErrors() {
+    QScopedPointer<RequestSender> sender(createSender());
+    Request request;
+    RequestSender::ESendError error = RequestSender::Ok;
+
+    // Подпись ответа проверяется.
+    QVERIFY(sender->post(m_Gateway.url("bad"), request, RequestSender::Solid, error) == nullptr);
+    QCOMPARE(error, RequestSender::ServerCryptError);
+
+    // Ошибка подписи запроса останавливает конвейер до сети.
+    sender->setRequestSigner([](const QByteArray &, QByteArray &, RequestSender::ESignatureType,
+                                QByteArray &) { return false; });
+    QVERIFY(sender->post(m_Gateway.url("pay"), request, RequestSender::Solid, error) == nullptr);
+    QCOMPARE(error, RequestSender::ClientCryptError);
+
+    // HTTP без разрешения отклоняется сразу.
+    sender->setOnlySecureConnectionEnabled(true);
+    QVERIFY(sender->post(m_Gateway.url("pay"), request, RequestSender::Solid, error) == nullptr);
+    QCOMPARE(error, RequestSender::HttpIsNotSupported);
+    QCOMPARE(sender->getPendingCount(), 0);
+}
+
+//---------------------------------------------------------------------------
+void TestRequestSender::testResponseCreatorThread() {
+    QScopedPointer<RequestSender> sender(createSender());
+    QThread *creatorThread = nullptr;
+
+    sender->setResponseCreator([&creatorThread](const Request &aRequest, const QString &aData) {
+        creatorThread = QThread::currentThread();
+        return new Response(aRequest, aData);
+    });
+
+    // Синхронный ответ создаётся в ждущем потоке.
+    Request request;
+    RequestSender::ESendError error = RequestSender::NetworkError;
+    std::unique_ptr<Response> response(
+        sender->post(m_Gateway.url("pay"), request, RequestSender::Solid, error));
+
+    QCOMPARE(error, RequestSender::Ok);
+    QCOMPARE(creatorThread, QThread::currentThread());
+
+    // Асинхронный - в рабочем потоке, вместе с обработчиком.
+    QThread *handlerThread = nullptr;
+    QSemaphore done;
+
+    sender->postAsync(m_Gateway.url("pay"),
+                      request,
+                      RequestSender::Solid,
+                      [&](Response *aResponse, RequestSender::ESendError) {
+                          delete aResponse;
+                          handlerThread = QThread::currentThread();
+                          done.release();
+                      });
+
+    QVERIFY(done.tryAcquire(1, 10000));
+    QVERIFY(handlerThread != QThread::currentThread());
+    QCOMPARE(creatorThread, handlerThread);
+}
+
+//---------------------------------------------------------------------------
+void TestRequestSender::testAsyncInFlightWindow() {
+    const int window = 2;
+    const int count = 20;
+
+    QScopedPointer<RequestSender> sender(createSender());
+    sender->setMaxInFlight(window);
+    m_Gateway.server()->reset();
+
+    SResults results;
+    QVERIFY(sendAsync(sender.data(), "pay", count, results));
+
+    QCOMPARE(results.ok, count);
+    QVERIFY(m_Gateway.server()->maxInFlight() <= window);
+    QCOMPARE(sender->getPendingCount(), 0);
+}
+
+//---------------------------------------------------------------------------
+void TestRequestSender::testDestroyWhilePending() {
+    const int count = 10;
+
+    std::vector<std::unique_ptr<Request>> requests;
+    QSemaphore done;
+    QAtomicInt failed;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    {
+        QScopedPointer<RequestSender> sender(createSender());
+        sender->setMaxInFlight(3);
+
+        for (int i = 0; i < count; ++i) {
+            requests.emplace_back(new Request());
+            sender->postAsync(m_Gateway.url("slow"),
+                              *requests.back(),
+                              RequestSender::Solid,
+                              [&](Response *aResponse, RequestSender::ESendError aError) {
+                                  delete aResponse;
+
+                                  if (aError == RequestSender::NetworkError) {
+                                      failed.fetchAndAddOrdered(1);
+                                  }
+
+                                  done.release();
+                              });
+        }
+
+        QTest::qWait(200);
+    }
+
+    // К моменту удаления отправителя все обработчики вызваны, ответы /slow не ожидались.
+    QVERIFY(done.tryAcquire(count));
+    QCOMPARE(failed.loadAcquire(), count);
+    QVERIFY(timer.elapsed() < SlowLatency);
+}
+
+//---------------------------------------------------------------------------
+void TestRequestSender::testDestroyAfterNetworkStopped() {
+    const int count = 6;
+
+    std::vector<std::unique_ptr<Request>> requests;
+    QSemaphore done;
+    QAtomicInt failed;
+
+    QElapsedTimer timer;
+
+    {
+        NetworkTaskManager network(ILog::getInstance("TestRequestSender"));
+        QScopedPointer<RequestSender> sender(new RequestSender(&network, &m_Crypt));
+        sender->setOnlySecureConnectionEnabled(false);
+        sender->setMaxInFlight(3);
+
+        for (int i = 0; i < count; ++i) {
+            requests.emplace_back(new Request());
+            sender->postAsync(m_Gateway.url("slow"),
+                              *requests.back(),
+                              RequestSender::Solid,
+                              [&](Response *aResponse, RequestSender::ESendError aError) {
+                                  delete aResponse;
+
+                                  if (aError == RequestSender::NetworkError) {
+                                      failed.fetchAndAddOrdered(1);
+                                  }
+
+                                  done.release();
+                              });
+        }
+
+        QTest::qWait(200);
+
+        // Поток менеджера остановлен: прерывание задач в его очереди уже не выполнится.
+        network.quit();
+        QVERIFY(network.wait(5000));
+
+        timer.start();
+        sender.reset();
+    }
+
+    // Удаление не зависает, все обработчики вызваны.
+    QVERIFY(done.tryAcquire(count));
+    QCOMPARE(failed.loadAcquire(), count);
+    QVERIFY(timer.elapsed() < CRequestSender::CloseTimeout + 1000);
+}
+
+//---------------------------------------------------------------------------
+void TestRequestSender::benchmarkThroughput() {
+    QScopedPointer<RequestSender> sender(createSender());
+
+    // Последовательно, как раньше: в сети не больше одного запроса.
+    QList<qint64> serialLatencies;
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < BenchmarkRequests; ++i) {
+        Request request;
+        request.addParameter("SESSION", i);
+
+        QElapsedTimer latency;
+        latency.start();
+
+        RequestSender::ESendError error = RequestSender::NetworkError;
+        std::unique_ptr<Response> response(
+            sender->post(m_Gateway.url("pay"), request, RequestSender::Solid, error));
+        QCOMPARE(error, RequestSender::Ok);
+
+        serialLatencies << latency.elapsed();
+    }
+
+    qint64 serial = qMax(qint64(1), timer.elapsed());
+
+    // Конвейер: подпись, передача и проверка разных запросов идут одновременно.
+    SResults results;
+    timer.restart();
+    QVERIFY(sendAsync(sender.data(), "pay", BenchmarkRequests, results));
+    qint64 pipelined = qMax(qint64(1), timer.elapsed());
+
+    QCOMPARE(results.ok, BenchmarkRequests);
+
+    qDebug() << "serial:" << BenchmarkRequests * 1000 / serial << "req/s, latency p50"
+             << percentile(serialLatencies, 50) << "p90" << percentile(serialLatencies, 90)
+             << "p99" << percentile(serialLatencies, 99) << "ms";
+    qDebug() << "pipelined:" << BenchmarkRequests * 1000 / pipelined << "req/s, latency p50"
+             << percentile(results.latencies, 50) << "p90" << percentile(results.latencies, 90)
+             << "p99" << percentile(results.latencies, 99) << "ms";
+
+    QVERIFY(pipelined < serial);
+}
+
+QTEST_MAIN(TestRequestSender)
+#include "TestRequestSender.moc"
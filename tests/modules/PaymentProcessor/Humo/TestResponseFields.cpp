@@ -0,0 +1,259 @@
+/* @file Тесты разбора ответа сервера: эквивалентность прежнему разбору и производительность. */
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QRegularExpression>
+#include <QtTest/QtTest>
+
+#include <SDK/PaymentProcessor/Humo/ErrorCodes.h>
+#include <SDK/PaymentProcessor/Humo/Request.h>
+#include <SDK/PaymentProcessor/Humo/Response.h>
+#include <SDK/PaymentProcessor/Humo/ResponseFields.h>
+
+using namespace SDK::PaymentProcessor::Humo;
+
+namespace {
+const int FuzzIterations = 20000;
+const int BenchmarkIterations = 20000;
+
+/// Прежний разбор ответа: регулярное выражение на каждую строку и словарь QVariant.
+struct SReference {
+    QVariantMap parameters;
+    int error = ELocalError::NetworkError;
+    int result = EServerResult::Empty;
+    QString errorMessage;
+
+    explicit SReference(const QString &aData) {
+        QRegularExpression regexp("^(\\w+)=(.*)$");
+
+        foreach (auto line, aData.split("\r\n")) {
+            QRegularExpressionMatch match = regexp.match(line);
+            if (match.hasMatch() && match.capturedLength() > 1) {
+                add(match.captured(1), match.captured(2));
+            }
+        }
+    }
+
+    void add(const QString &aName, const QString &aValue) {
+        parameters[aName] = aValue;
+
+        if (aName == CResponse::Parameters::Error || aName == CResponse::Parameters::ErrorCode) {
+            error = aValue.toInt();
+        }
+
+        if (aName == CResponse::Parameters::Result) {
+            result = aValue.toInt();
+        }
+
+        if (aName == CResponse::Parameters::ErrorMessage) {
+            errorMessage = aValue;
+        }
+    }
+};
+
+/// Записанные ответы шлюза, номера и идентификаторы заменены.
+const char *const Samples[] = {
+    "SESSION=20240101120000123456\r\nERROR=0\r\nRESULT=0\r\nTRANSID=1000000001\r\n"
+    "AUTHCODE=A1B2C3\r\nERRMSG=\r\nADDINFO=\r\n",
+    "SESSION=20240101120001654321\r\nERROR=23\r\nRESULT=1\r\n"
+    "ERRMSG=%D0%9D%D0%B5%D0%B2%D0%B5%D1%80%D0%BD%D1%8B%D0%B9+%D0%BD%D0%BE%D0%BC%D0%B5%D1%80\r\n",
+    "SESSION=20240101120002000000\r\nERROR=0\r\nRESULT=0\r\nTRANSID=1000000002\r\n"
+    "PRICE=150.00\r\nACCOUNT=992900000000\r\nCLIENT_NAME=Иванов И.И.\r\n"
+    "BALANCE=12 345,67\r\nADDINFO=key1=v1;key2=v2\r\nDATE=01.01.2024 12:00:02\r\n",
+    "ERROR=0\r\nRESULT=0\r\nSTATUS=7\r\nSERVER_TIME=20240101120003\r\n",
+    "ERROR_CODE=-286\r\nRESULT=1\r\nERROR_MSG=absent expected param\r\n\r\n",
+};
+
+QString randomString(QRandomGenerator &aRandom) {
+    // Символы, на которых расходятся возможные реализации: разделители, '=', не-ASCII.
+    static const QString alphabet = QString::fromUtf8("AZaz09_=\r\n\r\n \t-.:ЖёÄ\x01");
+
+    QString result;
+    int length = aRandom.bounded(64);
+
+    for (int i = 0; i < length; ++i) {
+        result += alphabet.at(aRandom.bounded(alphabet.size()));
+    }
+
+    return result;
+}
+
+QString randomReply(QRandomGenerator &aRandom) {
+    static const QStringList names = QStringList() << "ERROR" << "ERROR_CODE" << "RESULT"
+                                                   << "ERRMSG" << "TRANSID" << "x_1" << "";
+    static const QStringList values = QStringList() << "0" << "-1" << " 5" << "12abc" << ""
+                                                    << "a=b" << "v\n" << "v\nw" << "v\r";
+    static const QStringList separators = QStringList() << "\r\n" << "\n" << "\r" << "\r\r\n";
+
+    QString result;
+    int lines = aRandom.bounded(12);
+
+    for (int i = 0; i < lines; ++i) {
+        result += names.at(aRandom.bounded(names.size())) + "=" +
+                  values.at(aRandom.bounded(values.size())) +
+                  separators.at(aRandom.bounded(separators.size()));
+    }
+
+    return result;
+}
+} // namespace
+
+class TestResponseFields : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testFields();
+    void testLineRules();
+    void testOverride();
+    void fuzzEquivalence();
+    void benchmarkParsers();
+
+private:
+    /// Сравнивает разбор aData с прежним.
+    void compare(const QString &aData);
+};
+
+//---------------------------------------------------------------------------
+void TestResponseFields::compare(const QString &aData) {
+    SReference reference(aData);
+    Request request;
+
+    // Значения из таблицы полей, словарь ещё не построен.
+    Response lazy(request, aData);
+
+    foreach (const QString &name, reference.parameters.keys()) {
+        QCOMPARE(lazy.getParameter(name), reference.parameters.value(name));
+    }
+
+    QVERIFY(!lazy.getParameter("NO_SUCH_FIELD").isValid());
+    QCOMPARE(lazy.getError(), reference.error);
+    QCOMPARE(lazy.getResult(), reference.result);
+    QCOMPARE(lazy.getErrorMessage(), reference.errorMessage);
+
+    Response full(request, aData);
+    QCOMPARE(full.getParameters(), reference.parameters);
+}
+
+//---------------------------------------------------------------------------
+void TestResponseFields::testFields() {
+    ResponseFields fields(QString::fromUtf8(Samples[2]));
+
+    QCOMPARE(fields.size(), 10);
+    QCOMPARE(fields.name(0).toString(), QString("SESSION"));
+    QCOMPARE(fields.get(u"CLIENT_NAME").toString(), QString::fromUtf8("Иванов И.И."));
+    QCOMPARE(fields.get(u"ADDINFO").toString(), QString("key1=v1;key2=v2"));
+    QCOMPARE(fields.getInt(u"TRANSID"), 1000000002);
+    QCOMPARE(fields.getInt(u"PRICE", -1), -1);
+    QCOMPARE(fields.getInt(u"MISSING", 7), 7);
+    QVERIFY(!fields.contains(u"session"));
+
+    for (const char *sample : Samples) {
+        compare(QString::fromUtf8(sample));
+    }
+}
+
+//---------------------------------------------------------------------------
+void TestResponseFields::testLineRules() {
+    const QString data("A=1\nB=2\r\nC=3\n\r\nD=4\r\r\n=5\r\nE F=6\r\nЖ=7\r\nG==8\r\nH=9");
+    ResponseFields fields(data);
+
+    // "A=1\nB=2" - перевод строки внутри значения, строка пропускается.
+    QVERIFY(!fields.contains(u"A"));
+    QVERIFY(!fields.contains(u"B"));
+    QCOMPARE(fields.get(u"C").toString(), QString("3"));
+    QCOMPARE(fields.get(u"D").toString(), QString("4\r"));
+    QVERIFY(!fields.contains(u"E"));
+    QCOMPARE(fields.get(u"G").toString(), QString("=8"));
+    QCOMPARE(fields.get(u"H").toString(), QString("9"));
+    QCOMPARE(fields.size(), 4);
+
+    compare(data);
+    compare(QString("ERROR=1\r\nERROR_CODE=5\r\nERROR=2\r\n"));
+    compare(QString());
+    compare(QString("\r\n\r\n"));
+}
+
+//---------------------------------------------------------------------------
+void TestResponseFields::testOverride() {
+    class TestResponse : public Response {
+    public:
+        TestResponse(const Request &aRequest, const QString &aData) : Response(aRequest, aData) {
+            addParameter(CResponse::Parameters::Error, "-286");
+        }
+    };
+
+    Request request;
+    TestResponse response(request, "ERROR=0\r\nRESULT=0\r\nTRANSID=15\r\n");
+
+    // Параметры, добавленные наследником, перекрывают разобранные.
+    QCOMPARE(response.getError(), int(ELocalError::AbsentExpectedParam));
+    QCOMPARE(response.getParameter("ERROR").toString(), QString("-286"));
+    QCOMPARE(response.getParameter("TRANSID").toString(), QString("15"));
+    QCOMPARE(response.getParameters().size(), 3);
+}
+
+//---------------------------------------------------------------------------
+void TestResponseFields::fuzzEquivalence() {
+    QRandomGenerator random(20240101);
+
+    for (int i = 0; i < FuzzIterations; ++i) {
+        QString data = (i % 2) ? randomString(random) : randomReply(random);
+
+        compare(data);
+
+        if (QTest::currentTestFailed()) {
+            qDebug() << "input:" << data;
+            return;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+void TestResponseFields::benchmarkParsers() {
+    QStringList samples;
+
+    for (const char *sample : Samples) {
+        samples << QString::fromUtf8(sample);
+    }
+
+    Request request;
+    int checksum = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+
+    for (int i = 0; i < BenchmarkIterations; ++i) {
+        SReference reference(samples.at(i % samples.size()));
+        checksum += reference.error + reference.parameters.value("TRANSID").toString().size();
+    }
+
+    qint64 regexp = qMax(qint64(1), timer.elapsed());
+
+    timer.restart();
+
+    // Типичное обращение: статус и одно-два поля.
+    for (int i = 0; i < BenchmarkIterations; ++i) {
+        Response response(request, samples.at(i % samples.size()));
+        checksum -= response.getError() + response.getParameter("TRANSID").toString().size();
+    }
+
+    qint64 tokenizer = qMax(qint64(1), timer.elapsed());
+
+    timer.restart();
+
+    for (int i = 0; i < BenchmarkIterations; ++i) {
+        Response response(request, samples.at(i % samples.size()));
+        checksum += response.getParameters().size();
+    }
+
+    qint64 tokenizerMap = qMax(qint64(1), timer.elapsed());
+
+    qDebug() << BenchmarkIterations << "replies: regexp" << regexp << "ms, tokenizer"
+             << tokenizer << "ms, tokenizer with full map" << tokenizerMap << "ms;"
+             << "speedup" << double(regexp) / tokenizer << "(checksum" << checksum << ")";
+
+    QVERIFY(tokenizer < regexp);
+}
+
+QTEST_MAIN(TestResponseFields)
+#include "TestResponseFields.moc"
@@ -0,0 +1,346 @@
+/* @file Тесты скомпилированных комиссий: совпадение с обходом правил и производительность. */
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRandomGenerator>
+#include <QtTest/QtTest>
+
+#include <SDK/PaymentProcessor/Settings/Commissions.h>
+
+using namespace SDK::PaymentProcessor;
+
+namespace {
+const qint64 FirstID = 1000;
+const int ProviderCount = 300;
+const int SampleCount = 200000;
+const int BenchmarkProviderCount = 5000;
+const int BenchmarkLookups = 1000000;
+const int MSecsPerDay = 24 * 60 * 60 * 1000;
+
+/// Пороги сумм; совпадающие границы у разных ступеней встречаются часто, как в реальных файлах.
+const double Thresholds[] = {0, 1, 10, 99.99, 100, 250.5, 500, 1000, 5000, 15000};
+const int ThresholdCount = sizeof(Thresholds) / sizeof(Thresholds[0]);
+
+/// Понедельник.
+const QDate FirstDay(2024, 1, 1);
+
+std::wstring text(const QString &aValue) {
+    return aValue.toStdWString();
+}
+
+std::wstring number(double aValue) {
+    return text(QString::number(aValue, 'g', 15));
+}
+
+/// Генератор правил комиссий в формате commissions.xml.
+class RulesGenerator {
+public:
+    explicit RulesGenerator(quint32 aSeed) : m_Random(aSeed) {}
+
+    /// Дерево <commissions> с aCount операторами и комиссиями по умолчанию.
+    TPtree generate(int aCount) {
+        TPtree root;
+
+        for (int i = 0; i < aCount; ++i) {
+            root.add_child("operator", makeOperator(FirstID + i));
+        }
+
+        addList(root);
+
+        return root;
+    }
+
+    /// Границы всех сгенерированных временных окон и соседние с ними моменты.
+    const QVector<QTime> &getEdges() const { return m_Edges; }
+
+private:
+    TPtree makeCommission() {
+        TPtree commission;
+
+        commission.put("<xmlattr>.type", text(m_Random.bounded(2) ? "percent" : "absolute"));
+        commission.put("<xmlattr>.amount", number(m_Random.bounded(1, 60) / 4.0));
+
+        if (m_Random.bounded(3) == 0) {
+            commission.put("<xmlattr>.min_charge", number(m_Random.bounded(5)));
+        }
+
+        if (m_Random.bounded(4) == 0) {
+            commission.put("<xmlattr>.max_charge", number(50 + m_Random.bounded(200)));
+        }
+
+        if (m_Random.bounded(4) == 0) {
+            commission.put("<xmlattr>.base", text("amount"));
+        }
+
+        return commission;
+    }
+
+    /// Ступени <amount> и общая <commission>: вложенные, пересекающиеся и смежные диапазоны.
+    void addList(TPtree &aNode) {
+        int tiers = m_Random.bounded(5);
+
+        for (int i = 0; i < tiers; ++i) {
+            int first = m_Random.bounded(ThresholdCount - 1);
+            int last = first + 1 + m_Random.bounded(ThresholdCount - first - 1);
+
+            TPtree amount;
+
+            if (m_Random.bounded(5)) {
+                amount.put("<xmlattr>.above", number(Thresholds[first]));
+            }
+
+            if (m_Random.bounded(5)) {
+                amount.put("<xmlattr>.below", number(Thresholds[last]));
+            }
+
+            amount.add_child("commission", makeCommission());
+            aNode.add_child("amount", amount);
+        }
+
+        if (tiers == 0 || m_Random.bounded(3) == 0) {
+            aNode.add_child("commission", makeCommission());
+        }
+    }
+
+    QTime makeTime() {
+        return QTime(m_Random.bounded(24), m_Random.bounded(4) * 15, m_Random.bounded(2) * 59);
+    }
+
+    TPtree makeTimeList() {
+        TPtree time;
+        QTime begin = makeTime();
+        QTime end = makeTime();
+
+        // Окна бывают и пустыми (начало позже конца), и с ошибкой в записи времени.
+        time.put("<xmlattr>.begin",
+                 text(m_Random.bounded(20) ? begin.toString("hh:mm:ss") : QString("25:00:00")));
+        time.put("<xmlattr>.end",
+                 text(m_Random.bounded(20) ? end.toString("hh:mm:ss") : QString("xx")));
+
+        m_Edges << begin << begin.addMSecs(-1) << end << end.addMSecs(1) << end.addMSecs(999);
+
+        addList(time);
+
+        return time;
+    }
+
+    TPtree makeOperator(qint64 aId) {
+        TPtree op;
+
+        op.put("<xmlattr>.id", number(aId));
+        op.put("vat", number(m_Random.bounded(3) * 6));
+
+        for (int i = m_Random.bounded(3); i > 0; --i) {
+            QStringList days;
+
+            for (int day = Commission::Mon; day <= Commission::Sun; ++day) {
+                if (m_Random.bounded(3) == 0) {
+                    days << QString::number(day);
+                }
+            }
+
+            TPtree day;
+            day.put("<xmlattr>.id", text(days.join(",")));
+
+            for (int time = m_Random.bounded(3); time > 0; --time) {
+                day.add_child("time", makeTimeList());
+            }
+
+            addList(day);
+            op.add_child("day", day);
+        }
+
+        for (int i = m_Random.bounded(4) == 0 ? m_Random.bounded(1, 3) : 0; i > 0; --i) {
+            op.add_child("time", makeTimeList());
+        }
+
+        addList(op);
+
+        return op;
+    }
+
+private:
+    QRandomGenerator m_Random;
+    QVector<QTime> m_Edges;
+};
+
+bool sameCommission(const Commission &aActual, const Commission &aExpected, double aSum) {
+    return aActual.getValue() == aExpected.getValue() &&
+           aActual.getMinLimit() == aExpected.getMinLimit() &&
+           aActual.getMaxLimit() == aExpected.getMaxLimit() &&
+           aActual.getMinCharge() == aExpected.getMinCharge() &&
+           aActual.getMaxCharge() == aExpected.getMaxCharge() &&
+           aActual.getType() == aExpected.getType() && aActual.getBase() == aExpected.getBase() &&
+           aActual.getValueFor(aSum, false) == aExpected.getValueFor(aSum, false);
+}
+
+bool sameCommissions(const TCommissions &aActual, const TCommissions &aExpected) {
+    if (aActual.size() != aExpected.size()) {
+        return false;
+    }
+
+    for (int i = 0; i < aActual.size(); ++i) {
+        if (!sameCommission(aActual[i], aExpected[i], 100)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+} // namespace
+
+//---------------------------------------------------------------------------
+class TestCommissions : public QObject {
+    Q_OBJECT
+
+private slots:
+    void compiledMatchesRules_data();
+    void compiledMatchesRules();
+    void cacheFollowsChanges();
+
+    void benchmark();
+};
+
+//---------------------------------------------------------------------------
+void TestCommissions::compiledMatchesRules_data() {
+    QTest::addColumn<quint32>("seed");
+
+    for (quint32 seed = 1; seed <= 5; ++seed) {
+        QTest::newRow(qPrintable(QString("seed %1").arg(seed))) << seed;
+    }
+}
+
+//---------------------------------------------------------------------------
+void TestCommissions::compiledMatchesRules() {
+    QFETCH(quint32, seed);
+
+    RulesGenerator generator(seed);
+    Commissions commissions = Commissions::from_Settings(generator.generate(ProviderCount));
+    QVERIFY(commissions.isValid());
+
+    QRandomGenerator random(seed * 31);
+    const QVector<QTime> &edges = generator.getEdges();
+    QVERIFY(!edges.isEmpty());
+
+    for (int i = 0; i < SampleCount; ++i) {
+        // Несколько идентификаторов без своих правил - проверяются комиссии по умолчанию.
+        qint64 provider = FirstID + random.bounded(ProviderCount + 10);
+
+        double sum = 0;
+        switch (random.bounded(4)) {
+        case 0:
+            sum = Thresholds[random.bounded(ThresholdCount)];
+            break;
+        case 1:
+            // Окрестность границы, где результат решает qFuzzyCompare.
+            sum = Thresholds[random.bounded(ThresholdCount)] * (1.0 + 1e-14);
+            break;
+        case 2:
+            sum = Thresholds[random.bounded(ThresholdCount)] + (random.bounded(2) ? 0.01 : -0.01);
+            break;
+        default:
+            sum = random.bounded(2000000) / 100.0;
+        }
+
+        QTime time = random.bounded(2)
+                         ? edges[random.bounded(edges.size())]
+                         : QTime::fromMSecsSinceStartOfDay(random.bounded(MSecsPerDay));
+        QDateTime moment(FirstDay.addDays(random.bounded(7)), time);
+
+        Commission actual = commissions.getCommission(provider, sum, moment);
+        Commission expected = commissions.findCommission(provider, sum, moment);
+
+        if (!sameCommission(actual, expected, sum)) {
+            QFAIL(qPrintable(QString("Commission mismatch: provider %1, sum %2, %3")
+                                 .arg(provider)
+                                 .arg(sum, 0, 'g', 17)
+                                 .arg(moment.toString(Qt::ISODateWithMs))));
+        }
+
+        if (i % 16 == 0 && !sameCommissions(commissions.getCommissions(provider, moment),
+                                            commissions.findCommissions(provider, moment))) {
+            QFAIL(qPrintable(QString("Commission list mismatch: provider %1, %2")
+                                 .arg(provider)
+                                 .arg(moment.toString(Qt::ISODateWithMs))));
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+void TestCommissions::cacheFollowsChanges() {
+    TPtree tree;
+    TPtree op;
+    op.put("<xmlattr>.id", number(FirstID));
+    op.put("commission.<xmlattr>.type", text("absolute"));
+    op.put("commission.<xmlattr>.amount", number(7));
+    tree.add_child("operator", op);
+
+    Commissions commissions = Commissions::from_Settings(tree);
+    QCOMPARE(commissions.getCommission(FirstID, 100).getValue(), 7.0);
+    QCOMPARE(commissions.getCommission(FirstID + 1, 100).getValue(), 0.0);
+
+    // Копия пользуется уже скомпилированными правилами, дополнение правил видно только ей.
+    Commissions copy = commissions;
+
+    TPtree local;
+    op.put("<xmlattr>.id", number(FirstID + 1));
+    op.put("commission.<xmlattr>.amount", number(3));
+    local.add_child("operator", op);
+    copy.appendFrom_Settings(local);
+
+    QCOMPARE(copy.getCommission(FirstID + 1, 100).getValue(), 3.0);
+    QCOMPARE(commissions.getCommission(FirstID + 1, 100).getValue(), 0.0);
+
+    copy.clear();
+    QCOMPARE(copy.getCommission(FirstID, 100).getValue(), 0.0);
+    QCOMPARE(commissions.getCommission(FirstID, 100).getValue(), 7.0);
+}
+
+//---------------------------------------------------------------------------
+void TestCommissions::benchmark() {
+    RulesGenerator generator(2024);
+    Commissions commissions =
+        Commissions::from_Settings(generator.generate(BenchmarkProviderCount));
+
+    QRandomGenerator random(77);
+    QVector<qint64> providers(BenchmarkLookups);
+    QVector<double> sums(BenchmarkLookups);
+
+    for (int i = 0; i < BenchmarkLookups; ++i) {
+        providers[i] = FirstID + random.bounded(BenchmarkProviderCount);
+        sums[i] = random.bounded(2000000) / 100.0;
+    }
+
+    QDateTime moment(FirstDay.addDays(5), QTime(13, 30));
+    QElapsedTimer timer;
+
+    // Первое обращение к каждому оператору компилирует его правила.
+    timer.start();
+    for (qint64 id = FirstID; id < FirstID + BenchmarkProviderCount; ++id) {
+        commissions.getCommission(id, 100, moment);
+    }
+    qint64 compileTime = timer.elapsed();
+
+    double compiledTotal = 0;
+    timer.restart();
+    for (int i = 0; i < BenchmarkLookups; ++i) {
+        compiledTotal += commissions.getCommission(providers[i], sums[i], moment).getValue();
+    }
+    qint64 compiledTime = timer.elapsed();
+
+    double rulesTotal = 0;
+    timer.restart();
+    for (int i = 0; i < BenchmarkLookups; ++i) {
+        rulesTotal += commissions.findCommission(providers[i], sums[i], moment).getValue();
+    }
+    qint64 rulesTime = timer.elapsed();
+
+    QCOMPARE(compiledTotal, rulesTotal);
+
+    qDebug() << "providers:" << BenchmarkProviderCount << "lookups:" << BenchmarkLookups;
+    qDebug() << "compile:" << compileTime << "ms, compiled:" << compiledTime
+             << "ms, rule walk:" << rulesTime << "ms";
+}
+
+//---------------------------------------------------------------------------
+QTEST_MAIN(TestCommissions)
+#include "TestCommissions.moc"
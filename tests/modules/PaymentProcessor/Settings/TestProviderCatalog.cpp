@@ -0,0 +1,381 @@
+/* @file Тесты каталога операторов: индексы, изменения поверх каталога и производительность. */
+
+#pragma push_macro("foreach")
+#undef foreach
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#pragma pop_macro("foreach")
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFuture>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QtTest>
+
+#include <Common/ILog.h>
+
+#include <SDK/PaymentProcessor/Settings/DealerSettings.h>
+#include <SDK/PaymentProcessor/Settings/ProviderCatalog.h>
+
+#include <sstream>
+
+using namespace SDK::PaymentProcessor;
+
+namespace {
+const int OperatorCount = 5000;
+const int GatewayCount = 500;
+const int LookupIterations = 200000;
+const qint64 FirstID = 1000;
+const qint64 FirstCID = 100;
+const qint64 SharedCID = 9000;
+
+const char Header[] = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<operators version=\"2.0\">\n";
+
+qint64 operatorID(int aIndex) {
+    return FirstID + aIndex;
+}
+
+qint64 operatorCID(int aIndex) {
+    return FirstCID + aIndex % GatewayCount;
+}
+
+/// Каждый сотый оператор скрыт и в каталог не попадает.
+bool isHidden(int aIndex) {
+    return aIndex % 100 == 99;
+}
+
+QString processingOf(int aIndex) {
+    switch (aIndex % 10) {
+    case 0:
+        return "dummy";
+    case 1:
+        return "humo#alias";
+    default:
+        return "humo";
+    }
+}
+
+/// Описание оператора в формате operators.xml version 2.0.
+QString makeOperator(int aIndex, const QString &aName) {
+    QString fields;
+
+    for (int field = 0; field < 3; ++field) {
+        fields += QString("<field id=\"f%1\" type=\"text\" sort=\"%2\"><name>Field %1</name>"
+                          "<enum><item name=\"A\" value=\"1\"/><item name=\"B\" value=\"2\"/>"
+                          "</enum></field>")
+                      .arg(field)
+                      .arg(3 - field);
+    }
+
+    QString ttList = aIndex % 50 == 0 ? QString("<tt_list>%1, %2</tt_list>")
+                                            .arg(SharedCID)
+                                            .arg(SharedCID + 1 + aIndex % 7)
+                                      : QString();
+
+    return QString("<operator id=\"%1\" type=\"humo\"><name>%2</name><cid>%3</cid>%4"
+                   "<terminal_show>%5</terminal_show><limit min=\"1\" max=\"%6\"/>"
+                   "<processor type=\"%7\" keys=\"0\"><request name=\"check\">"
+                   "<url>https://gw%8.example/check</url>"
+                   "<request_property name=\"account\" value=\"{f0}\"/></request></processor>"
+                   "<fields>%9</fields></operator>\n")
+        .arg(operatorID(aIndex))
+        .arg(aName)
+        .arg(operatorCID(aIndex))
+        .arg(ttList)
+        .arg(isHidden(aIndex) ? 0 : 1)
+        .arg(1000 + aIndex)
+        .arg(processingOf(aIndex))
+        .arg(aIndex % 3)
+        .arg(fields);
+}
+
+QString operatorName(int aIndex) {
+    return QString("Operator %1 &amp; Co").arg(aIndex);
+}
+
+bool writeFile(const QString &aPath, const QString &aContent) {
+    QFile file(aPath);
+
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate) &&
+           file.write(aContent.toUtf8()) > 0;
+}
+
+/// Облегчённый разбор описания для сравнения последовательного и параллельного построения.
+bool parseOperator(const std::string &aBuffer, SProvider &aProvider) {
+    boost::property_tree::ptree tree;
+    std::stringstream stream(aBuffer);
+
+    try {
+        boost::property_tree::read_xml(stream, tree);
+
+        const auto &op = tree.get_child("operator");
+        aProvider.id = op.get<qint64>("<xmlattr>.id");
+        aProvider.cid = op.get<qint64>("cid", -1);
+        aProvider.name = QString::fromStdString(op.get<std::string>("name"));
+        aProvider.processor.type =
+            QString::fromStdString(op.get<std::string>("processor.<xmlattr>.type"));
+    } catch (std::exception &) {
+        return false;
+    }
+
+    return true;
+}
+} // namespace
+
+//---------------------------------------------------------------------------
+class TestProviderCatalog : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void lookupById();
+    void firstDescriptionWins();
+    void gatewayIndex();
+    void processingIndex();
+    void disableProvider();
+    void externalLimits();
+    void concurrentReaders();
+
+    void benchmark();
+
+private:
+    /// Загружает настройки дилера из подготовленных файлов.
+    QSharedPointer<DealerSettings> load();
+
+private:
+    QTemporaryDir m_Dir;
+    QStringList m_Files;
+    TPtree m_Properties;
+    QSharedPointer<DealerSettings> m_Settings;
+};
+
+//---------------------------------------------------------------------------
+void TestProviderCatalog::initTestCase() {
+    QVERIFY(m_Dir.isValid());
+
+    QString operators = Header;
+    for (int i = 0; i < OperatorCount; ++i) {
+        operators += makeOperator(i, operatorName(i));
+    }
+    operators += "</operators>\n";
+
+    // Второй файл повторяет часть операторов с другими именами.
+    QString duplicates = Header;
+    for (int i = 0; i < 10; ++i) {
+        duplicates += makeOperator(i, "Duplicate");
+    }
+    duplicates += "</operators>\n";
+
+    m_Files << m_Dir.filePath("operators.xml") << m_Dir.filePath("operators_extra.xml");
+
+    QVERIFY(writeFile(m_Files[0], operators));
+    QVERIFY(writeFile(m_Files[1], duplicates));
+
+    m_Settings = load();
+}
+
+//---------------------------------------------------------------------------
+QSharedPointer<DealerSettings> TestProviderCatalog::load() {
+    m_Properties.clear();
+
+    foreach (const QString &file, m_Files) {
+        m_Properties.add_child("operators", TPtree(file.toStdWString()));
+    }
+
+    QSharedPointer<DealerSettings> settings(new DealerSettings(m_Properties));
+    settings->setLog(ILog::getInstance("TestProviderCatalog"));
+    settings->initialize();
+
+    return settings;
+}
+
+//---------------------------------------------------------------------------
+void TestProviderCatalog::lookupById() {
+    for (int i = 0; i < OperatorCount; ++i) {
+        SProvider provider = m_Settings->getProvider(operatorID(i));
+
+        if (isHidden(i)) {
+            QVERIFY(provider.isNull());
+            continue;
+        }
+
+        QCOMPARE(provider.id, operatorID(i));
+        QCOMPARE(provider.cid, operatorCID(i));
+        QCOMPARE(provider.name, QString("Operator %1 & Co").arg(i));
+        QCOMPARE(provider.limits.max, QString::number(1000 + i));
+        QCOMPARE(provider.fields.size(), 3);
+        QCOMPARE(provider.fields.first().id, QString("f2"));
+        QCOMPARE(provider.processor.requests.value("CHECK").url,
+                 QString("https://gw%1.example/check").arg(i % 3));
+    }
+
+    QVERIFY(m_Settings->getProvider(FirstID - 1).isNull());
+}
+
+//---------------------------------------------------------------------------
+void TestProviderCatalog::firstDescriptionWins() {
+    QCOMPARE(m_Settings->getProvider(operatorID(3)).name, QString("Operator 3 & Co"));
+}
+
+//---------------------------------------------------------------------------
+void TestProviderCatalog::gatewayIndex() {
+    // Позже описанный оператор возвращается первым, как в прежнем индексе на QMultiMap.
+    for (int cid = 0; cid < GatewayCount; cid += 37) {
+        QList<qint64> expected;
+        for (int i = cid; i < OperatorCount; i += GatewayCount) {
+            if (!isHidden(i)) {
+                expected.prepend(operatorID(i));
+            }
+        }
+
+        QList<qint64> actual;
+        foreach (const SProvider &provider, m_Settings->getProvidersByCID(FirstCID + cid)) {
+            actual << provider.id;
+        }
+
+        QCOMPARE(actual, expected);
+    }
+
+    QCOMPARE(m_Settings->getProvidersByCID(SharedCID).size(), OperatorCount / 50);
+    QVERIFY(m_Settings->getProvidersByCID(SharedCID + 1).first().ttList.contains(SharedCID + 1));
+
+    SProvider mnp = m_Settings->getMNPProvider(operatorID(2), 0, operatorCID(5));
+    QCOMPARE(mnp.cid, operatorCID(5));
+}
+
+//---------------------------------------------------------------------------
+void TestProviderCatalog::processingIndex() {
+    QStringList types = m_Settings->getProviderProcessingTypes();
+    std::sort(types.begin(), types.end());
+
+    QCOMPARE(types, QStringList() << "dummy" << "humo");
+    QCOMPARE(m_Settings->getProviders("dummy").size(), OperatorCount / 10);
+    QCOMPARE(m_Settings->getProviders("humo").size(),
+             OperatorCount - OperatorCount / 10 - OperatorCount / 100);
+}
+
+//---------------------------------------------------------------------------
+void TestProviderCatalog::disableProvider() {
+    QSharedPointer<DealerSettings> settings = load();
+
+    foreach (qint64 id, settings->getProviders("dummy")) {
+        settings->disableProvider(id);
+    }
+
+    QCOMPARE(settings->getProviderProcessingTypes(), QStringList() << "humo");
+    QVERIFY(settings->getProviders("dummy").isEmpty());
+    QVERIFY(settings->getProvider(operatorID(10)).isNull());
+    QVERIFY(!settings->getProvider(operatorID(11)).isNull());
+
+    // Шлюз operatorCID(0) обслуживают только отключённые операторы.
+    QVERIFY(settings->getProvidersByCID(operatorCID(0)).isEmpty());
+    QCOMPARE(settings->getProvidersByCID(operatorCID(1)).size(), OperatorCount / GatewayCount);
+}
+
+//---------------------------------------------------------------------------
+void TestProviderCatalog::externalLimits() {
+    qint64 id = operatorID(2);
+
+    m_Settings->setExternalLimits(id, 5, 50);
+
+    SProvider provider = m_Settings->getProvider(id);
+    QCOMPARE(provider.limits.min, QString("5"));
+    QCOMPARE(provider.limits.max, QString("50"));
+
+    m_Settings->setExternalLimits(id, 0, 0);
+
+    provider = m_Settings->getProvider(id);
+    QCOMPARE(provider.limits.min, QString("1"));
+    QCOMPARE(provider.limits.max, QString("1002"));
+
+    // Для отсутствующего оператора лимиты не запоминаются.
+    m_Settings->setExternalLimits(FirstID - 1, 5, 50);
+    QVERIFY(m_Settings->getProvider(FirstID - 1).isNull());
+}
+
+//---------------------------------------------------------------------------
+void TestProviderCatalog::concurrentReaders() {
+    QSharedPointer<DealerSettings> settings = load();
+    QList<QFuture<int>> readers;
+
+    for (int reader = 0; reader < 4; ++reader) {
+        readers << QtConcurrent::run([settings]() {
+            int found = 0;
+
+            for (int i = 0; i < OperatorCount; ++i) {
+                found += settings->getProvider(operatorID(i)).isNull() ? 0 : 1;
+                settings->getProvidersByCID(operatorCID(i));
+            }
+
+            return found;
+        });
+    }
+
+    // Изменения поверх каталога идут параллельно с чтением.
+    for (int i = 0; i < OperatorCount; i += 10) {
+        settings->setExternalLimits(operatorID(i + 2), 1, 10);
+    }
+
+    for (QFuture<int> &reader : readers) {
+        QCOMPARE(reader.result(), OperatorCount - OperatorCount / 100);
+    }
+}
+
+//---------------------------------------------------------------------------
+void TestProviderCatalog::benchmark() {
+    QElapsedTimer timer;
+
+    // Холодный старт: загрузка файлов, построение каталога и первое обращение к каждому оператору.
+    timer.start();
+    QSharedPointer<DealerSettings> settings = load();
+    qint64 loadTime = timer.elapsed();
+
+    for (int i = 0; i < OperatorCount; ++i) {
+        settings->getProvider(operatorID(i));
+    }
+    qint64 coldTime = timer.elapsed();
+
+    // Задержка поиска по уже построенному каталогу.
+    QRandomGenerator random(5000);
+
+    timer.restart();
+    for (int i = 0; i < LookupIterations; ++i) {
+        settings->getProvider(operatorID(random.bounded(OperatorCount)));
+    }
+    double idLookup = double(timer.nsecsElapsed()) / LookupIterations;
+
+    timer.restart();
+    for (int i = 0; i < LookupIterations / 10; ++i) {
+        settings->getProvidersByCID(FirstCID + random.bounded(GatewayCount));
+    }
+    double cidLookup = double(timer.nsecsElapsed()) / (LookupIterations / 10);
+
+    // Разбор всех описаний одним потоком (как суммарно делали ленивые обращения) и параллельно.
+    ProviderCatalog::TSources sources;
+    for (int i = 0; i < OperatorCount; ++i) {
+        sources.append({operatorID(i), makeOperator(i, operatorName(i)).toStdString()});
+    }
+
+    timer.restart();
+    auto serial = ProviderCatalog::compile(sources, &parseOperator, false);
+    qint64 serialTime = timer.elapsed();
+
+    timer.restart();
+    auto parallel = ProviderCatalog::compile(sources, &parseOperator, true);
+    qint64 parallelTime = timer.elapsed();
+
+    QCOMPARE(serial->size(), OperatorCount);
+    QCOMPARE(parallel->size(), OperatorCount);
+    QCOMPARE(parallel->getIDsByCID(FirstCID), serial->getIDsByCID(FirstCID));
+
+    qDebug() << "operators:" << OperatorCount << "load:" << loadTime
+             << "ms, load + first touch:" << coldTime << "ms";
+    qDebug() << "getProvider:" << idLookup << "ns, getProvidersByCID:" << cidLookup << "ns";
+    qDebug() << "compile serial:" << serialTime << "ms, parallel:" << parallelTime << "ms";
+}
+
+//---------------------------------------------------------------------------
+QTEST_MAIN(TestProviderCatalog)
+#include "TestProviderCatalog.moc"
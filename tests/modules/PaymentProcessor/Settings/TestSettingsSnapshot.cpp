@@ -0,0 +1,502 @@
+/* @file Тесты снимка настроек: совпадение с XML, устаревание, повреждение и время запуска. */
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QtTest>
+
+#include <Common/ILog.h>
+
+#include <SDK/PaymentProcessor/Settings/DealerSettings.h>
+#include <SDK/PaymentProcessor/Settings/Directory.h>
+#include <SDK/PaymentProcessor/Settings/SettingsSnapshot.h>
+
+#include <SettingsManager/SettingsManager.h>
+
+#include <limits>
+
+using namespace SDK::PaymentProcessor;
+
+namespace {
+const int OperatorCount = 5000;
+const int RangeCount = 20000;
+const int CommissionCount = 500;
+const qint64 FirstID = 1000;
+const qint64 FirstNumber = 900000000;
+const int BenchmarkRuns = 3;
+
+const char DealerSnapshot[] = "cache/dealer.snapshot";
+const char DirectorySnapshot[] = "cache/directory.snapshot";
+
+/// Версия сборки, записывающей снимки.
+const char Build[] = "1.0.0.1";
+
+/// Описание оператора в формате operators.xml version 2.0.
+QString makeOperator(int aIndex) {
+    QString fields;
+
+    for (int field = 0; field < 3; ++field) {
+        fields += QString("<field id=\"f%1\" type=\"text\" sort=\"%1\"><name>Field %1</name>"
+                          "<enum><item name=\"A\" value=\"1\"/><item name=\"B\" value=\"2\"/>"
+                          "</enum><security hidemask=\"****\"><printer hidemask=\"**\"/>"
+                          "</security></field>")
+                      .arg(field);
+    }
+
+    return QString("<operator id=\"%1\"><name>Operator %1</name><cid>%2</cid>"
+                   "<tt_list>%3</tt_list><limit min=\"1\" max=\"15000\"/>"
+                   "<processor type=\"humo\" keys=\"%4\"><request name=\"pay\">"
+                   "<url>https://gw.example/pay</url>"
+                   "<request_property name=\"account\" value=\"{f0}\" crypted=\"true\"/>"
+                   "<receive_property name=\"TRANSID\" required=\"false\" encoding=\"url\"/>"
+                   "</request></processor><fields>%5</fields>"
+                   "<receipts><parameter name=\"P\" value=\"%1\"/></receipts></operator>\n")
+        .arg(FirstID + aIndex)
+        .arg(100 + aIndex % 500)
+        .arg(9000 + aIndex % 3)
+        .arg(aIndex % 4)
+        .arg(fields);
+}
+
+/// Номерная ёмкость: каждый десятый диапазон виртуальный.
+QString makeNumCapacity() {
+    QString result = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<numcapacity>\n";
+
+    for (int i = 0; i < RangeCount; ++i) {
+        qint64 from = FirstNumber + qint64(i) * 100;
+        QString owner = i % 10 == 0 ? QString("<id>%1</id>").arg(FirstID + i % OperatorCount)
+                                    : QString("<cid>%1</cid>").arg(100 + i % 500);
+
+        result += QString("<range from=\"%1\" to=\"%2\">%3</range>\n")
+                      .arg(from)
+                      .arg(from + 99)
+                      .arg(owner);
+    }
+
+    return result + "</numcapacity>\n";
+}
+
+/// Комиссии: ступени по сумме, по дням и времени, НДС и комиссия процессинга.
+QString makeCommissions(double aDefault) {
+    QString result = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<commissions>\n";
+
+    for (int i = 0; i < CommissionCount; ++i) {
+        result += QString("<operator id=\"%1\"><vat>%2</vat>"
+                          "<amount above=\"0\" below=\"500\">"
+                          "<commission type=\"absolute\" amount=\"%3\"/></amount>"
+                          "<day id=\"6,7\"><time begin=\"00:00:00\" end=\"23:59:59\">"
+                          "<commission type=\"percent\" amount=\"2\" min_charge=\"1\"/></time>"
+                          "</day><commission type=\"percent\" amount=\"%4\" round=\"high\"/>"
+                          "<cyberaddcomission percent=\"1\" min_value=\"0.5\" type=\"2\"/>"
+                          "</operator>\n")
+                      .arg(FirstID + i * 7)
+                      .arg(i % 3 * 6)
+                      .arg(i % 10)
+                      .arg(1 + i % 5);
+    }
+
+    result += QString("<commission type=\"percent\" amount=\"%1\"/>\n").arg(aDefault);
+
+    return result + "</commissions>\n";
+}
+
+bool writeFile(const QString &aPath, const QString &aContent) {
+    QFile file(aPath);
+
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate) &&
+           file.write(aContent.toUtf8()) > 0;
+}
+} // namespace
+
+//---------------------------------------------------------------------------
+class TestSettingsSnapshot : public QObject {
+    Q_OBJECT
+
+    /// Загруженные настройки; менеджер объявлен первым, так как адаптеры ссылаются на его дерево.
+    struct SConfiguration {
+        QSharedPointer<SettingsManager> manager;
+        QSharedPointer<DealerSettings> dealer;
+        QSharedPointer<Directory> directory;
+        bool dealerCached;
+        bool directoryCached;
+    };
+
+private slots:
+    void initTestCase();
+
+    void snapshotMatchesXML();
+    void corruptedSnapshot_data();
+    void corruptedSnapshot();
+    void changedSource();
+    void otherBuild();
+
+    void benchmark();
+
+private:
+    /// Загрузка так же, как в SettingsService: снимок, если он действителен, иначе XML.
+    SConfiguration load(bool aUseSnapshots = true, const QString &aBuild = Build);
+
+    /// Сравнивает настройки с эталонной загрузкой из XML.
+    void compare(const SConfiguration &aConfiguration);
+
+    QString path(const QString &aName) const;
+    QList<SSettingsSource> dealerSources() const;
+    QList<SSettingsSource> directorySources() const;
+    QStringList files(const QList<SSettingsSource> &aSources) const;
+
+private:
+    QTemporaryDir m_Dir;
+    ILog *m_Log;
+    SConfiguration m_Reference;
+};
+
+//---------------------------------------------------------------------------
+void TestSettingsSnapshot::initTestCase() {
+    QVERIFY(m_Dir.isValid());
+
+    m_Log = ILog::getInstance("TestSettingsSnapshot");
+
+    QString operators = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<operators version=\"2.0\">\n";
+    for (int i = 0; i < OperatorCount; ++i) {
+        operators += makeOperator(i);
+    }
+
+    QVERIFY(writeFile(path("operators.xml"), operators + "</operators>\n"));
+    QVERIFY(writeFile(path("commissions.xml"), makeCommissions(3)));
+    QVERIFY(writeFile(path("numcapacity.xml"), makeNumCapacity()));
+
+    m_Reference = load(false);
+    QVERIFY(!m_Reference.dealerCached && !m_Reference.directoryCached);
+}
+
+//---------------------------------------------------------------------------
+QString TestSettingsSnapshot::path(const QString &aName) const {
+    return m_Dir.filePath(aName);
+}
+
+//---------------------------------------------------------------------------
+QList<SSettingsSource> TestSettingsSnapshot::dealerSources() const {
+    return QList<SSettingsSource>()
+           << SSettingsSource("commissions.xml", CAdapterNames::DealerAdapter, true)
+           << SSettingsSource("commissions.local.xml", CAdapterNames::DealerAdapter, true)
+           << SSettingsSource(path("operators.xml"), CAdapterNames::DealerAdapter, "operators");
+}
+
+//---------------------------------------------------------------------------
+QList<SSettingsSource> TestSettingsSnapshot::directorySources() const {
+    return QList<SSettingsSource>()
+           << SSettingsSource("numcapacity.xml", CAdapterNames::Directory, true);
+}
+
+//---------------------------------------------------------------------------
+QStringList TestSettingsSnapshot::files(const QList<SSettingsSource> &aSources) const {
+    QStringList result;
+
+    foreach (const SSettingsSource &source, aSources) {
+        result << QDir(m_Dir.path()).absoluteFilePath(source.configFileName);
+    }
+
+    return result;
+}
+
+//---------------------------------------------------------------------------
+TestSettingsSnapshot::SConfiguration TestSettingsSnapshot::load(bool aUseSnapshots,
+                                                                const QString &aBuild) {
+    SConfiguration config;
+
+    config.manager.reset(new SettingsManager(m_Dir.path()));
+    config.manager->setLog(m_Log);
+
+    SettingsSnapshot dealerSnapshot(path(DealerSnapshot), files(dealerSources()), aBuild);
+    SettingsSnapshot directorySnapshot(
+        path(DirectorySnapshot), files(directorySources()), aBuild);
+
+    config.dealerCached = aUseSnapshots && dealerSnapshot.open();
+    config.directoryCached = aUseSnapshots && directorySnapshot.open();
+
+    QList<SSettingsSource> sources;
+    // Ветка дилера есть всегда (в приложении её создают config.xml, customers.xml и т.д.).
+    sources << SSettingsSource("customers.xml", CAdapterNames::DealerAdapter, true);
+
+    if (!config.dealerCached) {
+        sources << dealerSources();
+    }
+
+    if (!config.directoryCached) {
+        sources << directorySources();
+    }
+
+    config.manager->loadSettings(sources);
+
+    config.dealer.reset(new DealerSettings(config.manager->getProperties()));
+    config.dealer->setLog(m_Log);
+
+    config.directory.reset(new Directory(config.manager->getProperties(), m_Log));
+
+    bool dealerFailed =
+        config.dealerCached && !config.dealer->loadSnapshot(dealerSnapshot.data());
+    bool directoryFailed =
+        config.directoryCached && !config.directory->loadSnapshot(directorySnapshot.data());
+
+    dealerSnapshot.close();
+    directorySnapshot.close();
+
+    // Пропущенные конфиги догружаются одним списком в исходном порядке.
+    QList<SSettingsSource> missingSources;
+
+    if (dealerFailed) {
+        config.dealerCached = false;
+        missingSources << dealerSources();
+    }
+
+    if (directoryFailed) {
+        config.directoryCached = false;
+        missingSources << directorySources();
+    }
+
+    if (!missingSources.isEmpty()) {
+        config.manager->loadSettings(missingSources);
+    }
+
+    config.dealer->initialize();
+
+    if (directoryFailed) {
+        config.directory.reset(new Directory(config.manager->getProperties(), m_Log));
+    }
+
+    if (aUseSnapshots && !config.dealerCached) {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(CSettingsSnapshot::StreamVersion);
+        config.dealer->saveSnapshot(stream);
+
+        if (!dealerSnapshot.write(data)) {
+            qWarning() << dealerSnapshot.getError();
+        }
+    }
+
+    if (aUseSnapshots && !config.directoryCached) {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(CSettingsSnapshot::StreamVersion);
+        config.directory->saveSnapshot(stream);
+
+        if (!directorySnapshot.write(data)) {
+            qWarning() << directorySnapshot.getError();
+        }
+    }
+
+    return config;
+}
+
+//---------------------------------------------------------------------------
+void TestSettingsSnapshot::compare(const SConfiguration &aConfiguration) {
+    DealerSettings &dealer = *aConfiguration.dealer;
+    DealerSettings &reference = *m_Reference.dealer;
+
+    for (int i = 0; i < OperatorCount; i += 7) {
+        SProvider actual = dealer.getProvider(FirstID + i);
+        SProvider expected = reference.getProvider(FirstID + i);
+
+        QCOMPARE(actual.id, expected.id);
+        QCOMPARE(actual.cid, expected.cid);
+        QCOMPARE(actual.ttList, expected.ttList);
+        QCOMPARE(actual.name, expected.name);
+        QCOMPARE(actual.limits.max, expected.limits.max);
+        QCOMPARE(actual.processor.keyPair, expected.processor.keyPair);
+        QCOMPARE(actual.processor.requests.keys(), expected.processor.requests.keys());
+        QCOMPARE(actual.processor.requests["PAY"].requestFields.first().crypted, true);
+        QCOMPARE(actual.processor.requests["PAY"].responseFields.first().encoding,
+                 expected.processor.requests["PAY"].responseFields.first().encoding);
+        QCOMPARE(SProvider::fields2Json(actual.fields), SProvider::fields2Json(expected.fields));
+        QCOMPARE(actual.fields.first().security, expected.fields.first().security);
+        QCOMPARE(actual.receiptParameters, expected.receiptParameters);
+    }
+
+    QCOMPARE(dealer.getProvidersByCID(9001).size(), reference.getProvidersByCID(9001).size());
+    QCOMPARE(dealer.getProviders("humo").size(), OperatorCount);
+
+    for (int i = 0; i < CommissionCount * 7; i += 3) {
+        qint64 provider = FirstID + i;
+
+        foreach (double sum, QList<double>() << 10 << 499 << 501 << 5000) {
+            Commission actual = dealer.getCommission(provider, QVariantMap(), sum);
+            Commission expected = reference.getCommission(provider, QVariantMap(), sum);
+
+            QCOMPARE(actual.getValueFor(sum, false), expected.getValueFor(sum, false));
+            QCOMPARE(actual.getType(), expected.getType());
+        }
+
+        QCOMPARE(dealer.getVAT(provider), reference.getVAT(provider));
+        QCOMPARE(dealer.getProcessingCommission(provider).getValue(100, 110),
+                 reference.getProcessingCommission(provider).getValue(100, 110));
+    }
+
+    for (int i = 0; i < RangeCount; i += 13) {
+        qint64 number = FirstNumber + qint64(i) * 100 + 50;
+
+        QList<SRange> actual = aConfiguration.directory->getRangesForNumber(number);
+        QList<SRange> expected = m_Reference.directory->getRangesForNumber(number);
+
+        QCOMPARE(actual.size(), 1);
+        QCOMPARE(actual.first().from, expected.first().from);
+        QCOMPARE(actual.first().cids, expected.first().cids);
+        QCOMPARE(actual.first().ids, expected.first().ids);
+    }
+
+    QCOMPARE(aConfiguration.directory->getOverlappedIDs(),
+             m_Reference.directory->getOverlappedIDs());
+}
+
+//---------------------------------------------------------------------------
+void TestSettingsSnapshot::snapshotMatchesXML() {
+    QFile::remove(path(DealerSnapshot));
+    QFile::remove(path(DirectorySnapshot));
+
+    // Первый запуск читает XML и пишет снимки, второй - загружается из них.
+    SConfiguration first = load();
+    QVERIFY(!first.dealerCached && !first.directoryCached);
+    compare(first);
+
+    SConfiguration second = load();
+    QVERIFY(second.dealerCached && second.directoryCached);
+    compare(second);
+}
+
+//---------------------------------------------------------------------------
+void TestSettingsSnapshot::corruptedSnapshot_data() {
+    QTest::addColumn<QString>("damage");
+
+    QTest::newRow("payload byte") << "payload";
+    QTest::newRow("truncated") << "truncate";
+    QTest::newRow("magic") << "magic";
+    QTest::newRow("empty file") << "empty";
+    QTest::newRow("unreadable payload") << "garbage";
+}
+
+//---------------------------------------------------------------------------
+void TestSettingsSnapshot::corruptedSnapshot() {
+    QFETCH(QString, damage);
+
+    QVERIFY(load().dealerCached);
+
+    QString snapshotPath = path(DealerSnapshot);
+
+    if (damage == "garbage") {
+        // Сумма данных верна, но данные не являются снимком дилера.
+        SettingsSnapshot snapshot(snapshotPath, files(dealerSources()), Build);
+        QVERIFY(snapshot.write(QByteArray(64, '\x7f')));
+        QVERIFY(snapshot.open());
+    } else {
+        QFile file(snapshotPath);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+
+        QByteArray content = file.readAll();
+
+        if (damage == "payload") {
+            content[content.size() - 10] = char(content[content.size() - 10] ^ 0x55);
+        } else if (damage == "truncate") {
+            content.chop(100);
+        } else if (damage == "magic") {
+            content[0] = char(content[0] ^ 0x01);
+        } else {
+            content.clear();
+        }
+
+        QVERIFY(file.resize(0));
+        QVERIFY(file.seek(0));
+        QCOMPARE(file.write(content), qint64(content.size()));
+        file.close();
+
+        SettingsSnapshot snapshot(snapshotPath, files(dealerSources()), Build);
+        QVERIFY(!snapshot.open());
+        QVERIFY(!snapshot.getError().isEmpty());
+    }
+
+    // Настройки загружаются из XML, снимок пересобирается.
+    SConfiguration fallback = load();
+    QVERIFY(!fallback.dealerCached);
+    compare(fallback);
+
+    SConfiguration restored = load();
+    QVERIFY(restored.dealerCached);
+    compare(restored);
+}
+
+//---------------------------------------------------------------------------
+void TestSettingsSnapshot::changedSource() {
+    QVERIFY(load().dealerCached);
+
+    // Обновление контента заменило комиссии: снимок устарел и пересобирается.
+    QVERIFY(writeFile(path("commissions.xml"), makeCommissions(4)));
+
+    SConfiguration updated = load();
+    QVERIFY(!updated.dealerCached);
+    QVERIFY(updated.directoryCached);
+    QCOMPARE(updated.dealer->getCommission(FirstID + 1, QVariantMap(), 100).getValue(), 4.0);
+
+    SConfiguration cached = load();
+    QVERIFY(cached.dealerCached);
+    QCOMPARE(cached.dealer->getCommission(FirstID + 1, QVariantMap(), 100).getValue(), 4.0);
+
+    // Новый файл в списке исходников тоже делает снимок недействительным.
+    QVERIFY(writeFile(path("commissions.local.xml"), makeCommissions(3)));
+    QVERIFY(!load().dealerCached);
+
+    QVERIFY(QFile::remove(path("commissions.local.xml")));
+    QVERIFY(writeFile(path("commissions.xml"), makeCommissions(3)));
+    QVERIFY(!load().dealerCached);
+}
+
+//---------------------------------------------------------------------------
+void TestSettingsSnapshot::otherBuild() {
+    QVERIFY(load().dealerCached);
+
+    // Исходники те же, но снимок записан другой сборкой.
+    SettingsSnapshot snapshot(path(DealerSnapshot), files(dealerSources()), "1.0.0.2");
+    QVERIFY(!snapshot.open());
+    QVERIFY(snapshot.getError().contains(Build));
+
+    SConfiguration updated = load(true, "1.0.0.2");
+    QVERIFY(!updated.dealerCached && !updated.directoryCached);
+    compare(updated);
+
+    SConfiguration cached = load(true, "1.0.0.2");
+    QVERIFY(cached.dealerCached && cached.directoryCached);
+    compare(cached);
+
+    // Возврат на прежнюю сборку снова пересобирает снимки.
+    QVERIFY(!load().dealerCached);
+}
+
+//---------------------------------------------------------------------------
+void TestSettingsSnapshot::benchmark() {
+    QVERIFY(load().dealerCached);
+
+    qint64 xmlTime = std::numeric_limits<qint64>::max();
+    qint64 snapshotTime = std::numeric_limits<qint64>::max();
+
+    for (int run = 0; run < BenchmarkRuns; ++run) {
+        QElapsedTimer timer;
+
+        timer.start();
+        SConfiguration xml = load(false);
+        xmlTime = qMin(xmlTime, timer.elapsed());
+
+        timer.restart();
+        SConfiguration snapshot = load();
+        snapshotTime = qMin(snapshotTime, timer.elapsed());
+
+        QVERIFY(snapshot.dealerCached && snapshot.directoryCached);
+    }
+
+    qDebug() << "operators:" << OperatorCount << "ranges:" << RangeCount
+             << "commissions:" << CommissionCount;
+    qDebug() << "startup from XML:" << xmlTime << "ms, from snapshot:" << snapshotTime << "ms"
+             << "snapshot size:" << QFileInfo(path(DealerSnapshot)).size() +
+                                        QFileInfo(path(DirectorySnapshot)).size()
+             << "bytes";
+}
+
+//---------------------------------------------------------------------------
+QTEST_MAIN(TestSettingsSnapshot)
+#include "TestSettingsSnapshot.moc"
@@ -1,16 +1,153 @@
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QTemporaryDir>
+#include <QXmlStreamReader>
 #include <QtTest/QtTest>
 
 #include <SettingsManager/SettingsManager.h>
 
+#include <vector>
+
+namespace {
+// Reference parser: the XML reading algorithm SettingsManager used before keys and values
+// were converted without intermediate QString copies. The input is fed as one buffer, as
+// SettingsManager does now, so text nodes are never split at device read boundaries.
+bool referenceReadXML(const QString &aFileName, TPtree &aTree) {
+    QFile inputFile(aFileName);
+
+    if (!inputFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QXmlStreamReader xmlReader(inputFile.readAll());
+    std::vector<TPtree *> stack;
+    TPtree *current = &aTree;
+
+    while (!xmlReader.atEnd()) {
+        switch (xmlReader.readNext()) {
+        case QXmlStreamReader::StartElement: {
+            QString key = xmlReader.name().toString().toLower();
+            TPtree &newOne =
+                current->push_back(std::make_pair(key.toStdString(), TPtree()))->second;
+            stack.push_back(current);
+            current = &newOne;
+
+            QXmlStreamAttributes attributes = xmlReader.attributes();
+
+            if (!attributes.isEmpty()) {
+                TPtree &attribTree =
+                    current->push_back(std::make_pair("<xmlattr>", TPtree()))->second;
+
+                foreach (const QXmlStreamAttribute &attribute, attributes) {
+                    attribTree.put(attribute.name().toString().toLower().toStdString(),
+                                   attribute.value().toString().toStdWString());
+                }
+            }
+
+            break;
+        }
+
+        case QXmlStreamReader::Characters:
+            if (!xmlReader.isWhitespace()) {
+                current->put_value(xmlReader.text().toString());
+            }
+            break;
+
+        case QXmlStreamReader::EndElement:
+            current = stack.back();
+            stack.pop_back();
+            break;
+
+        case QXmlStreamReader::Invalid:
+            aTree.clear();
+            return false;
+
+        default:
+            break;
+        }
+    }
+
+    return true;
+}
+
+// Synthetic config: mixed-case and Cyrillic names, attributes (including dotted names and
+// names that collide after lowercasing), comments, CDATA, entities, mixed content and indentation.
+QByteArray generateConfig(int aCount) {
+    QString xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<Config Version=\"2\">\n";
+
+    for (int i = 0; i < aCount; ++i) {
+        switch (i % 6) {
+        case 0:
+            xml += QString("  <Operator ID=\"%1\" Name=\"Оператор %1\" Skin.Color=\"#%2\" "
+                           "id=\"op%1\">\n"
+                           "    <Limit Min=\"1\" MAX=\"%3\"/>\n"
+                           "    <Field ID=\"phone\" Type=\"text\">Телефон &amp; код</Field>\n"
+                           "  </Operator>\n")
+                       .arg(i)
+                       .arg(i % 4096, 3, 16, QChar('0'))
+                       .arg(i * 10);
+            break;
+        case 1:
+            xml += QString("  <!-- комментарий %1 -->\n  <Параметр_%1>значение %1</Параметр_%1>\n")
+                       .arg(i);
+            break;
+        case 2:
+            xml += QString("  <Script><![CDATA[if (a < %1 && b > 0) { return \"x\"; }]]>"
+                           "</Script>\n")
+                       .arg(i);
+            break;
+        case 3:
+            xml += QString("  <Mixed>head<Inner Key=\"%1\">%1</Inner>tail &#x1F600; %1</Mixed>\n")
+                       .arg(i);
+            break;
+        case 4:
+            xml += QString("  <Empty/>\n  <Spaces>   \n   </Spaces>\n  <Number>%1</Number>\n")
+                       .arg(i);
+            break;
+        default:
+            xml += QString("  <Group Level=\"%1\"><Item>&lt;a&gt;</Item><Item>b</Item>"
+                           "<ITEM>c</ITEM></Group>\n")
+                       .arg(i);
+        }
+    }
+
+    xml += "</Config>\n";
+
+    return xml.toUtf8();
+}
+
+bool writeFile(const QString &aPath, const QByteArray &aContent) {
+    QFile file(aPath);
+
+    return file.open(QIODevice::WriteOnly) && file.write(aContent) == aContent.size();
+}
+
+QByteArray readFile(const QString &aPath) {
+    QFile file(aPath);
+
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+QStringList backups(const QString &aPath) {
+    return QFileInfo(aPath).dir().entryList(
+        QStringList() << (QFileInfo(aPath).fileName() + ".*_backup"), QDir::Files);
+}
+} // namespace
+
 class TestSettingsManager : public QObject {
     Q_OBJECT
 
 private slots:
     void testLoadXML();
     void testSaveXML();
+
+    void testLoadMatchesReference();
+    void testLoadInvalidXML();
+    void testSaveUnchanged();
+    void testSaveAfterExternalChange();
+
+    void benchmarkLoad();
 };
 
 void TestSettingsManager::testLoadXML() {
@@ -93,5 +230,144 @@ void TestSettingsManager::testSaveXML() {
     QVERIFY(!list.isEmpty());
 }
 
+void TestSettingsManager::testLoadMatchesReference() {
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+
+    QString path = tmp.path() + "/big.xml";
+    QVERIFY(writeFile(path, generateConfig(600)));
+
+    TPtree expected;
+    QVERIFY(referenceReadXML(path, expected));
+
+    SettingsManager mgr(tmp.path());
+    QVERIFY(mgr.loadSettings(QList<SSettingsSource>() << SSettingsSource(path, "adapter", true)));
+
+    const TPtree &actual = mgr.getProperties("adapter");
+    QVERIFY(actual == expected);
+
+    // Spot checks of the conversions the comparison relies on.
+    QCOMPARE(actual.get<QString>("config.operator.<xmlattr>.name"), QString("Оператор 0"));
+    QCOMPARE(actual.get<QString>("config.operator.<xmlattr>.skin.color"), QString("#000"));
+    QCOMPARE(actual.get_child("config.operator.<xmlattr>").count("id"), size_t(1));
+    QCOMPARE(actual.get<QString>("config.operator.<xmlattr>.id"), QString("op0"));
+    QCOMPARE(actual.get<QString>("config.mixed"), QString::fromUtf8("tail \xF0\x9F\x98\x80 3"));
+    QCOMPARE(actual.get<QString>("config.параметр_1"), QString("значение 1"));
+    QVERIFY(actual.get_child("config.spaces").data().empty());
+}
+
+void TestSettingsManager::testLoadInvalidXML() {
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+
+    QString path = tmp.path() + "/broken.xml";
+    QVERIFY(writeFile(path, "<?xml version=\"1.0\"?>\n<settings><a>1</a><b></settings>\n"));
+
+    TPtree expected;
+    QVERIFY(!referenceReadXML(path, expected));
+
+    SettingsManager mgr(tmp.path());
+    QVERIFY(mgr.loadSettings(QList<SSettingsSource>() << SSettingsSource(path, "adapter", true)));
+    QVERIFY(mgr.getProperties("adapter") == expected);
+    QVERIFY(mgr.getProperties("adapter").empty());
+}
+
+void TestSettingsManager::testSaveUnchanged() {
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+
+    // Formatting that the writer would not reproduce: a rewrite would be visible.
+    QString path = tmp.path() + "/cfg.xml";
+    QByteArray xml = "<?xml version=\"1.0\"?>\n<settings><field1>value</field1>"
+                     "<!-- keep --><field2 a=\"1\"/></settings>\n";
+    QVERIFY(writeFile(path, xml));
+
+    SettingsManager mgr(tmp.path());
+    QVERIFY(mgr.loadSettings(QList<SSettingsSource>() << SSettingsSource(path, "adapter", false)));
+
+    QVERIFY(mgr.saveSettings());
+    QCOMPARE(readFile(path), xml);
+    QVERIFY(backups(path).isEmpty());
+
+    // After a real change the file is rewritten once, the next save is a no-op again.
+    mgr.getProperties("adapter").put("settings.field1", QString("newval").toStdWString());
+
+    QVERIFY(mgr.saveSettings());
+    QByteArray saved = readFile(path);
+    QVERIFY(saved.contains("newval"));
+    QCOMPARE(backups(path).size(), 1);
+    // Only the config and its backup: the temporary file of the atomic write is gone.
+    QCOMPARE(QDir(tmp.path()).entryList(QDir::Files).size(), 2);
+
+    // Backup names have a one-second resolution, wait so that another backup would be visible.
+    QTest::qWait(1100);
+    QVERIFY(mgr.saveSettings());
+    QCOMPARE(readFile(path), saved);
+    QCOMPARE(backups(path).size(), 1);
+}
+
+void TestSettingsManager::testSaveAfterExternalChange() {
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+
+    QString path = tmp.path() + "/cfg.xml";
+    QVERIFY(
+        writeFile(path, "<?xml version=\"1.0\"?>\n<settings><field1>old</field1></settings>\n"));
+
+    SettingsManager mgr(tmp.path());
+    QVERIFY(mgr.loadSettings(QList<SSettingsSource>() << SSettingsSource(path, "adapter", false)));
+
+    // The file changed behind the manager's back: it is re-read and the settings in memory win.
+    QVERIFY(writeFile(path,
+                      "<?xml version=\"1.0\"?>\n<settings><field1>external</field1></settings>\n"));
+
+    QVERIFY(mgr.saveSettings());
+
+    QByteArray content = readFile(path);
+    QVERIFY(content.contains("old"));
+    QVERIFY(!content.contains("external"));
+    QCOMPARE(backups(path).size(), 1);
+}
+
+void TestSettingsManager::benchmarkLoad() {
+    const int Count = 50000;
+
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+
+    QString path = tmp.path() + "/big.xml";
+    QByteArray xml = generateConfig(Count);
+    QVERIFY(writeFile(path, xml));
+
+    QElapsedTimer timer;
+
+    timer.start();
+    TPtree expected;
+    QVERIFY(referenceReadXML(path, expected));
+    qint64 referenceTime = timer.elapsed();
+
+    SettingsManager mgr(tmp.path());
+
+    timer.restart();
+    QVERIFY(mgr.loadSettings(QList<SSettingsSource>() << SSettingsSource(path, "adapter", false)));
+    qint64 loadTime = timer.elapsed();
+
+    QVERIFY(mgr.getProperties("adapter") == expected);
+
+    timer.restart();
+    QVERIFY(mgr.saveSettings());
+    qint64 unchangedSaveTime = timer.elapsed();
+
+    mgr.getProperties("adapter").put("config.number", QString("changed").toStdWString());
+
+    timer.restart();
+    QVERIFY(mgr.saveSettings());
+    qint64 saveTime = timer.elapsed();
+
+    qDebug() << "config:" << xml.size() / 1024 << "KB, entries:" << Count;
+    qDebug() << "reference parse:" << referenceTime << "ms, load:" << loadTime << "ms";
+    qDebug() << "save unchanged:" << unchangedSaveTime << "ms, save changed:" << saveTime << "ms";
+}
+
 QTEST_MAIN(TestSettingsManager)
 #include "TestSettingsManager.moc"
@@ -0,0 +1,267 @@
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QtTest>
+
+#include <Common/ILog.h>
+
+#include <NetworkTaskManager/FileDownloadTask.h>
+#include <NetworkTaskManager/HashVerifier.h>
+#include <NetworkTaskManager/NetworkTaskManager.h>
+#include <algorithm>
+
+#include "Component.h"
+#include "DownloadScheduler.h"
+
+#include "../../common/HttpStandIn.h"
+
+class TestDownloadScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    TestDownloadScheduler() : m_Manager(ILog::getInstance("TestDownloadScheduler")) {}
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void testDownloadTree();
+    void testHostLimit();
+    void testSmallFirst();
+    void testManifestOrder();
+    void testSegmentedDownload();
+    void testSegmentFallback();
+    void benchmarkConcurrency();
+
+private:
+    QList<NetworkTask *> createTasks(const QStringList &aNames);
+    bool run(DownloadScheduler &aScheduler, const QList<NetworkTask *> &aTasks);
+    bool filesEqual(const QStringList &aNames) const;
+
+    // synthetic update tree served with Range support
+    HttpStandIn m_Server;
+    QMap<QString, QByteArray> m_Files;
+    NetworkTaskManager m_Manager;
+    QScopedPointer<QTemporaryDir> m_Dir;
+    QStringList m_Small;
+    QString m_Large;
+    int m_Failed;
+};
+
+void TestDownloadScheduler::initTestCase() {
+    // deterministic pseudo-random content, sizes from 512 bytes to 16 KB
+    quint32 seed = 12345;
+    auto next = [&seed]() {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 8;
+    };
+
+    for (int i = 0; i < 200; ++i) {
+        QByteArray data(static_cast<int>(512 + next() % (16 * 1024)), Qt::Uninitialized);
+        for (int j = 0; j < data.size(); ++j) {
+            data[j] = static_cast<char>(next());
+        }
+
+        QString name = QString("bin/file%1.dll").arg(i);
+        m_Files.insert(name, data);
+        m_Server.serve(name, data);
+        m_Small << name;
+    }
+
+    QByteArray package(6 * 1024 * 1024, Qt::Uninitialized);
+    for (int j = 0; j < package.size(); ++j) {
+        package[j] = static_cast<char>(next());
+    }
+
+    m_Large = "package.zip";
+    m_Files.insert(m_Large, package);
+    m_Server.serve(m_Large, package);
+
+    QVERIFY(m_Server.listen(QHostAddress::LocalHost));
+}
+
+void TestDownloadScheduler::init() {
+    m_Server.reset();
+    m_Server.setLatency(0);
+    m_Server.setRanges(true);
+    m_Failed = 0;
+
+    m_Dir.reset(new QTemporaryDir());
+    QVERIFY(m_Dir->isValid());
+    QVERIFY(QDir(m_Dir->path()).mkpath("bin"));
+}
+
+QList<NetworkTask *> TestDownloadScheduler::createTasks(const QStringList &aNames) {
+    QList<NetworkTask *> tasks;
+
+    foreach (const QString &name, aNames) {
+        const QByteArray &data = m_Files[name];
+
+        auto *task = new FileDownloadTask(m_Server.url(name), m_Dir->path() + "/" + name);
+        task->setVerifier(new Sha256Verifier(
+            QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex()));
+        task->setProperty(CComponent::TaskSize(), static_cast<qint64>(data.size()));
+        tasks << task;
+    }
+
+    return tasks;
+}
+
+bool TestDownloadScheduler::run(DownloadScheduler &aScheduler, const QList<NetworkTask *> &aTasks) {
+    QSignalSpy finished(&aScheduler, SIGNAL(finished()));
+
+    connect(&aScheduler, &DownloadScheduler::taskFinished, this, [this](NetworkTask *aTask) {
+        if (aTask->getError() != NetworkTask::NoError &&
+            aTask->getError() != NetworkTask::TaskFailedButVerified) {
+            ++m_Failed;
+        }
+
+        qobject_cast<FileDownloadTask *>(aTask)->closeFile();
+    });
+
+    aScheduler.enqueue(aTasks);
+
+    bool result = finished.wait(60000);
+
+    disconnect(&aScheduler, &DownloadScheduler::taskFinished, this, nullptr);
+    qDeleteAll(aTasks);
+
+    return result && (m_Failed == 0);
+}
+
+bool TestDownloadScheduler::filesEqual(const QStringList &aNames) const {
+    foreach (const QString &name, aNames) {
+        QFile file(m_Dir->path() + "/" + name);
+
+        if (!file.open(QIODevice::ReadOnly) || file.readAll() != m_Files[name]) {
+            qWarning() << "Wrong content of" << name;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void TestDownloadScheduler::testDownloadTree() {
+    m_Server.setLatency(10);
+
+    DownloadScheduler scheduler(&m_Manager);
+    scheduler.setMaxTasks(4, 4);
+
+    QVERIFY(run(scheduler, createTasks(m_Small)));
+    QVERIFY(filesEqual(m_Small));
+
+    QCOMPARE(m_Server.paths().size(), m_Small.size());
+    QVERIFY(m_Server.maxInFlight() > 1);
+    QVERIFY(m_Server.maxInFlight() <= 4);
+    QCOMPARE(scheduler.pending(), 0);
+}
+
+void TestDownloadScheduler::testHostLimit() {
+    m_Server.setLatency(10);
+
+    DownloadScheduler scheduler(&m_Manager);
+    scheduler.setMaxTasks(8, 2);
+
+    QStringList names = m_Small.mid(0, 40);
+    QVERIFY(run(scheduler, createTasks(names)));
+    QVERIFY(filesEqual(names));
+
+    QCOMPARE(m_Server.maxInFlight(), 2);
+}
+
+void TestDownloadScheduler::testSmallFirst() {
+    DownloadScheduler scheduler(&m_Manager);
+    scheduler.setMaxTasks(1, 1);
+    scheduler.setOrder(DownloadScheduler::SmallFirst);
+
+    QStringList names = m_Small.mid(0, 30);
+    QVERIFY(run(scheduler, createTasks(names)));
+
+    QStringList expected = names;
+    std::stable_sort(expected.begin(), expected.end(), [this](const QString &a, const QString &b) {
+        return m_Files[a].size() < m_Files[b].size();
+    });
+
+    QCOMPARE(m_Server.paths(), expected);
+}
+
+void TestDownloadScheduler::testManifestOrder() {
+    DownloadScheduler scheduler(&m_Manager);
+    scheduler.setMaxTasks(1, 1);
+    scheduler.setOrder(DownloadScheduler::ManifestOrder);
+
+    QStringList names = m_Small.mid(0, 30);
+    QVERIFY(run(scheduler, createTasks(names)));
+
+    QCOMPARE(m_Server.paths(), names);
+}
+
+void TestDownloadScheduler::testSegmentedDownload() {
+    DownloadScheduler scheduler(&m_Manager);
+    scheduler.setSegmentation(2 * 1024 * 1024, 4);
+
+    QStringList names = QStringList() << m_Large << m_Small.mid(0, 10);
+    QVERIFY(run(scheduler, createTasks(names)));
+    QVERIFY(filesEqual(names));
+
+    // four closed ranges, then the resume request of the glued file that gets 416
+    QStringList paths = m_Server.paths();
+    QList<QByteArray> headers = m_Server.rangeHeaders();
+    QList<QByteArray> ranges;
+    for (int i = 0; i < paths.size(); ++i) {
+        if (paths[i] == m_Large) {
+            ranges << headers[i];
+        }
+    }
+
+    QCOMPARE(ranges.size(), 5);
+    QCOMPARE(ranges.last(), QByteArray("bytes=") + QByteArray::number(6 * 1024 * 1024) + "-");
+    for (int i = 0; i < 4; ++i) {
+        QVERIFY(ranges[i].startsWith("bytes="));
+        QVERIFY(!ranges[i].endsWith("-"));
+    }
+
+    QVERIFY(QDir(m_Dir->path()).entryList(QStringList() << "*.part*").isEmpty());
+}
+
+void TestDownloadScheduler::testSegmentFallback() {
+    m_Server.setRanges(false);
+
+    DownloadScheduler scheduler(&m_Manager);
+    scheduler.setSegmentation(2 * 1024 * 1024, 4);
+
+    QStringList names = QStringList() << m_Large;
+    QVERIFY(run(scheduler, createTasks(names)));
+    QVERIFY(filesEqual(names));
+
+    // the last request is the whole file without a Range header
+    QCOMPARE(m_Server.rangeHeaders().last(), QByteArray());
+    QVERIFY(QDir(m_Dir->path()).entryList(QStringList() << "*.part*").isEmpty());
+}
+
+void TestDownloadScheduler::benchmarkConcurrency() {
+    QStringList names = m_Small.mid(0, 100);
+
+    foreach (int latency, QList<int>() << 0 << 20) {
+        foreach (int concurrency, QList<int>() << 1 << 4 << 8) {
+            init();
+            m_Server.setLatency(latency);
+
+            DownloadScheduler scheduler(&m_Manager);
+            scheduler.setMaxTasks(concurrency, concurrency);
+
+            QElapsedTimer timer;
+            timer.start();
+
+            QVERIFY(run(scheduler, createTasks(names)));
+
+            qDebug() << names.size() << "files, latency" << latency << "ms, concurrency"
+                     << concurrency << ":" << timer.elapsed() << "ms";
+        }
+    }
+}
+
+QTEST_MAIN(TestDownloadScheduler)
+#include "TestDownloadScheduler.moc"
@@ -0,0 +1,361 @@
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+
+#include "FileHasher.h"
+
+namespace {
+// Writes aData to aPath creating missing directories.
+bool writeFile(const QString &aPath, const QByteArray &aData) {
+    QDir().mkpath(QFileInfo(aPath).absolutePath());
+
+    QFile file(aPath);
+
+    return file.open(QIODevice::WriteOnly) && file.write(aData) == aData.size();
+}
+
+// Collects all files under aRoot the way Updater::collectFiles does.
+QList<FileHasher::SEntry> scan(const QString &aRoot) {
+    QList<FileHasher::SEntry> result;
+    QDir root(aRoot);
+    QDirIterator it(aRoot, QDir::Files, QDirIterator::Subdirectories);
+
+    while (it.hasNext()) {
+        it.next();
+        result << FileHasher::entry(root.relativeFilePath(it.filePath()), it.fileInfo());
+    }
+
+    return result;
+}
+
+QString referenceHash(const QByteArray &aData) {
+    return QString::fromLatin1(QCryptographicHash::hash(aData, QCryptographicHash::Sha256).toHex());
+}
+
+QString hashOf(const QList<FileHasher::SEntry> &aEntries, const QString &aName) {
+    foreach (const FileHasher::SEntry &entry, aEntries) {
+        if (entry.name == aName) {
+            return entry.hash;
+        }
+    }
+
+    return QString();
+}
+} // namespace
+
+class TestFileHasher : public QObject {
+    Q_OBJECT
+
+private slots:
+    void streamingHash();
+    void cacheHits();
+    void changedFileIsRehashed();
+    void paranoidIgnoresCache();
+    void brokenCacheIgnored();
+    void prune();
+    void unreadableFile();
+    void benchmarkTree();
+};
+
+//---------------------------------------------------------------------------
+void TestFileHasher::streamingHash() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // Spans several read chunks and ends in a partial one.
+    QByteArray data;
+    for (int i = 0; data.size() < CFileHasher::ChunkSize * 3 + 17; ++i) {
+        data += QByteArray::number(i);
+    }
+
+    QString path = dir.filePath("big.bin");
+    QVERIFY(writeFile(path, data));
+    QCOMPARE(FileHasher::sha256(path), referenceHash(data));
+
+    QVERIFY(writeFile(dir.filePath("empty.bin"), QByteArray()));
+    QCOMPARE(FileHasher::sha256(dir.filePath("empty.bin")), referenceHash(QByteArray()));
+
+    QVERIFY(FileHasher::sha256(dir.filePath("missing.bin")).isNull());
+}
+
+//---------------------------------------------------------------------------
+void TestFileHasher::cacheHits() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QString root = dir.filePath("tree");
+    QString cache = dir.filePath("cache/hash_cache.dat");
+
+    for (int i = 0; i < 20; ++i) {
+        QVERIFY(writeFile(QString("%1/d%2/f%3.txt").arg(root).arg(i % 3).arg(i),
+                          QByteArray::number(i).repeated(100)));
+    }
+
+    QList<FileHasher::SEntry> cold = scan(root);
+    {
+        FileHasher hasher;
+        QVERIFY(!hasher.loadCache(cache));
+        QVERIFY(hasher.hash(cold));
+        QCOMPARE(hasher.cacheHits(), 0);
+        QCOMPARE(hasher.calculated(), 20);
+        QVERIFY(hasher.saveCache(cache));
+    }
+
+    QList<FileHasher::SEntry> warm = scan(root);
+    {
+        FileHasher hasher;
+        QVERIFY(hasher.loadCache(cache));
+        QVERIFY(hasher.hash(warm));
+        QCOMPARE(hasher.cacheHits(), 20);
+        QCOMPARE(hasher.calculated(), 0);
+    }
+
+    foreach (const FileHasher::SEntry &entry, cold) {
+        QCOMPARE(hashOf(warm, entry.name), entry.hash);
+        QCOMPARE(entry.hash, FileHasher::sha256(entry.path));
+    }
+}
+
+//---------------------------------------------------------------------------
+void TestFileHasher::changedFileIsRehashed() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QString root = dir.filePath("tree");
+    QString cache = dir.filePath("hash_cache.dat");
+
+    QVERIFY(writeFile(root + "/a.txt", "first"));
+    QVERIFY(writeFile(root + "/b.txt", "second"));
+
+    QList<FileHasher::SEntry> entries = scan(root);
+    {
+        FileHasher hasher;
+        QVERIFY(hasher.hash(entries));
+        QVERIFY(hasher.saveCache(cache));
+    }
+
+    // A different size invalidates the entry even if mtime is kept.
+    QFileInfo info(root + "/a.txt");
+    QDateTime modified = info.lastModified();
+    QVERIFY(writeFile(root + "/a.txt", "first, changed"));
+    {
+        QFile file(root + "/a.txt");
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.setFileTime(modified, QFileDevice::FileModificationTime));
+    }
+
+    entries = scan(root);
+
+    FileHasher hasher;
+    QVERIFY(hasher.loadCache(cache));
+    QVERIFY(hasher.hash(entries));
+    QCOMPARE(hasher.cacheHits(), 1);
+    QCOMPARE(hasher.calculated(), 1);
+    QCOMPARE(hashOf(entries, "a.txt"), referenceHash("first, changed"));
+}
+
+//---------------------------------------------------------------------------
+void TestFileHasher::paranoidIgnoresCache() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QString root = dir.filePath("tree");
+    QString cache = dir.filePath("hash_cache.dat");
+
+    QVERIFY(writeFile(root + "/a.txt", "aaaa"));
+
+    QList<FileHasher::SEntry> entries = scan(root);
+    {
+        FileHasher hasher;
+        QVERIFY(hasher.hash(entries));
+        QVERIFY(hasher.saveCache(cache));
+    }
+
+    // Same size and mtime: only a full rehash notices the new content.
+    QDateTime modified = QFileInfo(root + "/a.txt").lastModified();
+    {
+        QFile file(root + "/a.txt");
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QCOMPARE(file.write("bbbb"), qint64(4));
+        QVERIFY(file.flush());
+        QVERIFY(file.setFileTime(modified, QFileDevice::FileModificationTime));
+    }
+
+    entries = scan(root);
+    {
+        FileHasher hasher;
+        QVERIFY(hasher.loadCache(cache));
+        QVERIFY(hasher.hash(entries));
+        QCOMPARE(hasher.cacheHits(), 1);
+        QCOMPARE(hashOf(entries, "a.txt"), referenceHash("aaaa"));
+    }
+
+    entries = scan(root);
+    {
+        FileHasher hasher;
+        hasher.setParanoid(true);
+        QVERIFY(hasher.loadCache(cache));
+        QVERIFY(hasher.hash(entries));
+        QCOMPARE(hasher.cacheHits(), 0);
+        QCOMPARE(hasher.calculated(), 1);
+        QCOMPARE(hashOf(entries, "a.txt"), referenceHash("bbbb"));
+        QVERIFY(hasher.saveCache(cache));
+    }
+
+    // The paranoid pass refreshed the cache.
+    entries = scan(root);
+
+    FileHasher hasher;
+    QVERIFY(hasher.loadCache(cache));
+    QVERIFY(hasher.hash(entries));
+    QCOMPARE(hasher.cacheHits(), 1);
+    QCOMPARE(hashOf(entries, "a.txt"), referenceHash("bbbb"));
+}
+
+//---------------------------------------------------------------------------
+void TestFileHasher::brokenCacheIgnored() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QString root = dir.filePath("tree");
+    QString cache = dir.filePath("hash_cache.dat");
+
+    QVERIFY(writeFile(root + "/a.txt", "data"));
+    QVERIFY(writeFile(cache, "not a cache"));
+
+    QList<FileHasher::SEntry> entries = scan(root);
+
+    FileHasher hasher;
+    QVERIFY(!hasher.loadCache(cache));
+    QVERIFY(hasher.hash(entries));
+    QCOMPARE(hasher.calculated(), 1);
+    QCOMPARE(hashOf(entries, "a.txt"), referenceHash("data"));
+}
+
+//---------------------------------------------------------------------------
+void TestFileHasher::prune() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QString root = dir.filePath("tree");
+    QString cache = dir.filePath("hash_cache.dat");
+
+    QVERIFY(writeFile(root + "/keep.txt", "keep"));
+    QVERIFY(writeFile(root + "/gone.txt", "gone"));
+
+    QList<FileHasher::SEntry> entries = scan(root);
+    {
+        FileHasher hasher;
+        QVERIFY(hasher.hash(entries));
+        QVERIFY(hasher.saveCache(cache));
+    }
+
+    QVERIFY(QFile::remove(root + "/gone.txt"));
+
+    entries = scan(root);
+    {
+        FileHasher hasher;
+        QVERIFY(hasher.loadCache(cache));
+        QVERIFY(hasher.hash(entries));
+        hasher.prune();
+        QVERIFY(hasher.saveCache(cache));
+    }
+
+    // A file reappearing with the same attributes must be hashed again.
+    QVERIFY(writeFile(root + "/gone.txt", "back"));
+    entries = scan(root);
+
+    FileHasher hasher;
+    QVERIFY(hasher.loadCache(cache));
+    QVERIFY(hasher.hash(entries));
+    QCOMPARE(hasher.cacheHits(), 1);
+    QCOMPARE(hasher.calculated(), 1);
+    QCOMPARE(hashOf(entries, "gone.txt"), referenceHash("back"));
+}
+
+//---------------------------------------------------------------------------
+void TestFileHasher::unreadableFile() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QVERIFY(writeFile(dir.filePath("a.txt"), "data"));
+
+    QList<FileHasher::SEntry> entries = scan(dir.path());
+    QVERIFY(QFile::remove(dir.filePath("a.txt")));
+
+    FileHasher hasher;
+    QVERIFY(!hasher.hash(entries));
+    QVERIFY(entries.first().hash.isEmpty());
+}
+
+//---------------------------------------------------------------------------
+void TestFileHasher::benchmarkTree() {
+    const int files = 10000;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QString root = dir.filePath("tree");
+    QString cache = dir.filePath("hash_cache.dat");
+
+    // Mostly small files with a few larger ones, similar to an installed kiosk.
+    for (int i = 0; i < files; ++i) {
+        int size = (i % 100 == 0) ? 1024 * 1024 : 512 + (i * 7919) % 16384;
+        QByteArray data(size, static_cast<char>('a' + i % 26));
+        data.replace(0, 4, reinterpret_cast<const char *>(&i), 4);
+
+        QVERIFY(writeFile(QString("%1/d%2/s%3/f%4.bin").arg(root).arg(i % 10).arg(i % 37).arg(i),
+                          data));
+    }
+
+    QElapsedTimer timer;
+
+    // The former implementation: serial walk and readAll() of each file.
+    timer.start();
+    QList<FileHasher::SEntry> legacy = scan(root);
+    for (auto it = legacy.begin(); it != legacy.end(); ++it) {
+        QFile file(it->path);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        it->hash = referenceHash(file.readAll());
+    }
+    qint64 legacyTime = timer.elapsed();
+
+    timer.restart();
+    QList<FileHasher::SEntry> cold = scan(root);
+    {
+        FileHasher hasher;
+        hasher.loadCache(cache);
+        QVERIFY(hasher.hash(cold));
+        QVERIFY(hasher.saveCache(cache));
+        QCOMPARE(hasher.calculated(), files);
+    }
+    qint64 coldTime = timer.elapsed();
+
+    timer.restart();
+    QList<FileHasher::SEntry> warm = scan(root);
+    {
+        FileHasher hasher;
+        QVERIFY(hasher.loadCache(cache));
+        QVERIFY(hasher.hash(warm));
+        QVERIFY(hasher.saveCache(cache));
+        QCOMPARE(hasher.cacheHits(), files);
+    }
+    qint64 warmTime = timer.elapsed();
+
+    for (int i = 0; i < legacy.size(); i += 97) {
+        QCOMPARE(hashOf(cold, legacy[i].name), legacy[i].hash);
+        QCOMPARE(hashOf(warm, legacy[i].name), legacy[i].hash);
+    }
+
+    qDebug() << files << "files: serial readAll" << legacyTime << "ms, cold cache" << coldTime
+             << "ms, warm cache" << warmTime << "ms," << QThread::idealThreadCount() << "threads";
+}
+
+QTEST_MAIN(TestFileHasher)
+#include "TestFileHasher.moc"
@@ -4,6 +4,7 @@
 #include <QtTest/QtTest>
 
 #include <WatchServiceClient/Constants.h>
+#include <WatchServiceClient/Protocol.h>
 #include <string>
 
 #include "WatchServiceClient.h"
@@ -56,6 +57,8 @@ private slots:
     void testModuleClosedEmitted();
     void testGenericCommandEmitted();
     void testTargetFiltering();
+    void testBinaryCommandEmitted();
+    void testProtocolConfirmationConsumed();
     void testStartStop();
     void testIsConnected();
     void testExecute();
@@ -162,6 +165,49 @@ void TestWatchServiceClient::testTargetFiltering() {
     QCOMPARE(spy.count(), 0);
 }
 
+void TestWatchServiceClient::testBinaryCommandEmitted() {
+    TestableWatchServiceClient client("client1");
+
+    QSignalSpy spy(&client,
+                   SIGNAL(onCommandReceived(
+                       const QString &, const QString &, const QString &, const QStringList &)));
+
+    SWatchServiceMessage message;
+    message.sender = "senderX";
+    message.type = "cmd";
+    message.params = "p1";
+
+    client.callOnMessage(WatchServiceProtocol::encode(message, WatchServiceProtocol::Binary));
+
+    QCOMPARE(spy.count(), 1);
+    QList<QVariant> args = spy.takeFirst();
+    QCOMPARE(args.at(0).toString(), QString("senderX"));
+    QCOMPARE(args.at(2).toString(), QString("cmd"));
+    QVERIFY(args.at(3).toStringList().contains(QString("params=p1")));
+}
+
+void TestWatchServiceClient::testProtocolConfirmationConsumed() {
+    TestableWatchServiceClient client("client1");
+
+    QSignalSpy spy(&client,
+                   SIGNAL(onCommandReceived(
+                       const QString &, const QString &, const QString &, const QStringList &)));
+
+    QByteArray msg = QString("%1=%2;%3=%4;%5=%6;%7=1;")
+                         .arg(CWatchService::Fields::Sender)
+                         .arg(CWatchService::Name)
+                         .arg(CWatchService::Fields::Target)
+                         .arg("client1")
+                         .arg(CWatchService::Fields::Type)
+                         .arg(CWatchService::Commands::Protocol)
+                         .arg(CWatchService::Fields::Params)
+                         .toUtf8();
+
+    client.callOnMessage(msg);
+
+    QCOMPARE(spy.count(), 0);
+}
+
 void TestWatchServiceClient::testStartStop() {
     TestableWatchServiceClient client("client1");
     QVERIFY(!client.isRunning());
@@ -0,0 +1,319 @@
+#include <QtCore/QElapsedTimer>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
+#include <QtTest/QtTest>
+
+#include <WatchServiceClient/Constants.h>
+#include <WatchServiceClient/Protocol.h>
+#include <algorithm>
+
+#include "MessageFramer.h"
+
+namespace {
+SWatchServiceMessage heartbeat() {
+    SWatchServiceMessage message;
+    message.sender = CWatchService::Modules::PaymentProcessor;
+    message.type = CWatchService::Commands::Ping;
+    message.module = CWatchService::Modules::WatchService;
+
+    return message;
+}
+
+// Former WatchService::messageReceived parsing, kept as the baseline for the benchmark.
+QString legacyType(const QByteArray &aMessage) {
+    QString sender;
+    QString type;
+    QString params;
+    QString module;
+
+    foreach (QString param, QString::fromUtf8(aMessage.data(), aMessage.size()).split(";")) {
+        if (param.indexOf(CWatchService::Fields::Sender) != -1) {
+            sender = param.right(param.length() - param.indexOf("=") - 1);
+        } else if (param.indexOf(CWatchService::Fields::Type) != -1) {
+            type = param.right(param.length() - param.indexOf("=") - 1);
+        } else if (param.indexOf(CWatchService::Fields::Params) != -1) {
+            params = param.right(param.length() - param.indexOf("=") - 1);
+        } else if (param.indexOf(CWatchService::Fields::Module) != -1) {
+            module = param.right(param.length() - param.indexOf("=") - 1);
+        }
+    }
+
+    return type;
+}
+
+qint64 percentile(QVector<qint64> aValues, int aPercent) {
+    std::sort(aValues.begin(), aValues.end());
+    return aValues[(aValues.size() - 1) * aPercent / 100];
+}
+} // namespace
+
+class TestWatchServiceProtocol : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testTextRoundTrip();
+    void testLegacyText();
+    void testBinaryRoundTrip();
+    void testBinaryIsCompact();
+    void testCustomType();
+    void testUnknownField();
+    void testMalformedBinary();
+    void testUnknownType();
+    void testLongFieldFallsBackToText();
+    void benchmarkCodec();
+    void benchmarkLocalSocketRoundTrip();
+};
+
+void TestWatchServiceProtocol::testTextRoundTrip() {
+    SWatchServiceMessage message = heartbeat();
+    message.params = QString::fromUtf8("параметры=1 2");
+    message.protocol = CWatchServiceProtocol::Version;
+
+    QByteArray data = WatchServiceProtocol::encode(message, WatchServiceProtocol::Text);
+    QVERIFY(!WatchServiceProtocol::isBinary(data));
+
+    SWatchServiceMessage decoded;
+    QVERIFY(WatchServiceProtocol::decode(data, decoded));
+    QCOMPARE(decoded.sender, message.sender);
+    QCOMPARE(decoded.type, message.type);
+    QCOMPARE(decoded.module, message.module);
+    QCOMPARE(decoded.params, message.params);
+    QCOMPARE(decoded.protocol, static_cast<int>(CWatchServiceProtocol::Version));
+    QVERIFY(decoded.tail.isEmpty());
+}
+
+void TestWatchServiceProtocol::testLegacyText() {
+    // messages built by the service itself, e.g. screen activity with a bare hash
+    SWatchServiceMessage decoded;
+    QVERIFY(WatchServiceProtocol::decode("sender=watch_service;type=screen_activity;abc123",
+                                         decoded));
+    QCOMPARE(decoded.sender, CWatchService::Name);
+    QCOMPARE(decoded.type, CWatchService::Commands::ScreenActivity);
+    QCOMPARE(decoded.tail, QStringList() << "abc123");
+    QCOMPARE(decoded.protocol, 0);
+
+    QVERIFY(WatchServiceProtocol::decode("type=module_closed;sender=ekiosk", decoded));
+    QCOMPARE(decoded.sender, CWatchService::Modules::PaymentProcessor);
+    QCOMPARE(decoded.type, CWatchService::Notification::ModuleClosed);
+
+    QVERIFY(WatchServiceProtocol::decode("sender=a;target=b;type=close;extra=1;", decoded));
+    QCOMPARE(decoded.target, QString("b"));
+    QCOMPARE(decoded.tail, QStringList() << "extra=1");
+}
+
+void TestWatchServiceProtocol::testBinaryRoundTrip() {
+    SWatchServiceMessage message = heartbeat();
+    message.target = "target";
+    message.params = QString::fromUtf8("значение;с=разделителями");
+    message.tail << "one" << "two";
+
+    QByteArray data = WatchServiceProtocol::encode(message, WatchServiceProtocol::Binary);
+    QVERIFY(WatchServiceProtocol::isBinary(data));
+    QCOMPARE(static_cast<quint8>(data.at(1)), CWatchServiceProtocol::Version);
+    QCOMPARE(static_cast<int>(data.at(2)), static_cast<int>(CWatchServiceProtocol::Types::Ping));
+
+    SWatchServiceMessage decoded;
+    QVERIFY(WatchServiceProtocol::decode(data, decoded));
+    QCOMPARE(decoded.sender, message.sender);
+    QCOMPARE(decoded.target, message.target);
+    QCOMPARE(decoded.type, message.type);
+    QCOMPARE(decoded.module, message.module);
+    QCOMPARE(decoded.params, message.params);
+    QCOMPARE(decoded.tail, message.tail);
+}
+
+void TestWatchServiceProtocol::testBinaryIsCompact() {
+    QByteArray text = WatchServiceProtocol::encode(heartbeat(), WatchServiceProtocol::Text);
+    QByteArray binary = WatchServiceProtocol::encode(heartbeat(), WatchServiceProtocol::Binary);
+
+    qDebug() << "Heartbeat:" << text.size() << "bytes as text," << binary.size()
+             << "bytes as binary";
+    QVERIFY(binary.size() < text.size());
+}
+
+void TestWatchServiceProtocol::testCustomType() {
+    SWatchServiceMessage message = heartbeat();
+    message.type = "custom_command";
+
+    QByteArray data = WatchServiceProtocol::encode(message, WatchServiceProtocol::Binary);
+    QCOMPARE(static_cast<int>(data.at(2)), static_cast<int>(CWatchServiceProtocol::Types::Custom));
+
+    SWatchServiceMessage decoded;
+    QVERIFY(WatchServiceProtocol::decode(data, decoded));
+    QCOMPARE(decoded.type, QString("custom_command"));
+}
+
+void TestWatchServiceProtocol::testUnknownField() {
+    QByteArray data = WatchServiceProtocol::encode(heartbeat(), WatchServiceProtocol::Binary);
+
+    // a field from a newer schema version is skipped
+    data.append('\x7F');
+    data.append('\0');
+    data.append('\x02');
+    data.append("xy");
+
+    SWatchServiceMessage decoded;
+    QVERIFY(WatchServiceProtocol::decode(data, decoded));
+    QCOMPARE(decoded.sender, heartbeat().sender);
+    QCOMPARE(decoded.type, heartbeat().type);
+}
+
+void TestWatchServiceProtocol::testMalformedBinary() {
+    QByteArray data = WatchServiceProtocol::encode(heartbeat(), WatchServiceProtocol::Binary);
+
+    SWatchServiceMessage decoded;
+    QVERIFY(!WatchServiceProtocol::decode(data.left(data.size() - 1), decoded));
+    QVERIFY(!WatchServiceProtocol::decode(data.left(2), decoded));
+}
+
+void TestWatchServiceProtocol::testUnknownType() {
+    QByteArray data = WatchServiceProtocol::encode(heartbeat(), WatchServiceProtocol::Binary);
+
+    // A type added by a newer peer is not a broken frame: it is decoded and flagged.
+    QByteArray newer = data;
+    newer[2] = static_cast<char>(CWatchServiceProtocol::Types::Count);
+
+    SWatchServiceMessage decoded;
+    QVERIFY(WatchServiceProtocol::decode(newer, decoded));
+    QCOMPARE(decoded.unknownType, int(CWatchServiceProtocol::Types::Count));
+    QCOMPARE(decoded.sender, heartbeat().sender);
+    QVERIFY(decoded.type.isEmpty());
+
+    SWatchServiceMessage known;
+    QVERIFY(WatchServiceProtocol::decode(data, known));
+    QCOMPARE(known.unknownType, 0);
+}
+
+void TestWatchServiceProtocol::testLongFieldFallsBackToText() {
+    SWatchServiceMessage message = heartbeat();
+    message.params = QString(CWatchServiceProtocol::MaxFieldSize + 1, 'x');
+
+    QByteArray data = WatchServiceProtocol::encode(message, WatchServiceProtocol::Binary);
+    QVERIFY(!WatchServiceProtocol::isBinary(data));
+
+    SWatchServiceMessage decoded;
+    QVERIFY(WatchServiceProtocol::decode(data, decoded));
+    QCOMPARE(decoded.params, message.params);
+}
+
+void TestWatchServiceProtocol::benchmarkCodec() {
+    const int count = 200000;
+
+    QByteArray text = WatchServiceProtocol::encode(heartbeat(), WatchServiceProtocol::Text);
+    QByteArray binary = WatchServiceProtocol::encode(heartbeat(), WatchServiceProtocol::Binary);
+    SWatchServiceMessage decoded;
+    int matched = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < count; ++i) {
+        matched += legacyType(text) == CWatchService::Commands::Ping;
+    }
+    qint64 legacy = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < count; ++i) {
+        WatchServiceProtocol::decode(text, decoded);
+        matched += decoded.type == CWatchService::Commands::Ping;
+    }
+    qint64 textDecode = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < count; ++i) {
+        WatchServiceProtocol::decode(binary, decoded);
+        matched += decoded.type == CWatchService::Commands::Ping;
+    }
+    qint64 binaryDecode = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < count; ++i) {
+        QByteArray data = WatchServiceProtocol::encode(heartbeat(), WatchServiceProtocol::Binary);
+        matched += data.size() > 0;
+    }
+    qint64 binaryEncode = timer.nsecsElapsed();
+
+    QCOMPARE(matched, count * 4);
+
+    qDebug() << "Heartbeat, ns per message: legacy parse" << legacy / count << ", text decode"
+             << textDecode / count << ", binary decode" << binaryDecode / count
+             << ", binary encode" << binaryEncode / count;
+}
+
+void TestWatchServiceProtocol::benchmarkLocalSocketRoundTrip() {
+    const int count = 5000;
+
+    // The LocalSocket transport is not part of the build, so the round trip uses its framing
+    // over a raw local socket pair: the client sends a heartbeat, the service answers.
+    QLocalServer server;
+    QString name = QString("ek_ws_protocol_%1").arg(QCoreApplication::applicationPid());
+    QLocalServer::removeServer(name);
+    QVERIFY(server.listen(name));
+
+    QLocalSocket client;
+    client.connectToServer(name);
+    QVERIFY(client.waitForConnected(5000));
+    QVERIFY(server.waitForNewConnection(5000));
+
+    QLocalSocket *service = server.nextPendingConnection();
+    QVERIFY(service);
+
+    SWatchServiceMessage answer;
+    answer.sender = CWatchService::Name;
+    answer.target = CWatchService::Modules::PaymentProcessor;
+    answer.type = CWatchService::Commands::Protocol;
+    answer.params = QString::number(CWatchServiceProtocol::Version);
+
+    auto receive = [](QLocalSocket &aSocket, MessageFramer &aFramer, QByteArray &aMessage) {
+        while (!aFramer.next(aMessage)) {
+            if (!aSocket.bytesAvailable() && !aSocket.waitForReadyRead(5000)) {
+                return false;
+            }
+
+            aFramer.append(aSocket.readAll());
+        }
+
+        return true;
+    };
+
+    foreach (WatchServiceProtocol::EFormat format,
+             QList<WatchServiceProtocol::EFormat>()
+                 << WatchServiceProtocol::Text << WatchServiceProtocol::Binary) {
+        MessageFramer clientFramer;
+        MessageFramer serviceFramer;
+        MessageFramer::EFormat frame =
+            format == WatchServiceProtocol::Binary ? MessageFramer::Binary : MessageFramer::Text;
+        QVector<qint64> latencies;
+        latencies.reserve(count);
+
+        QElapsedTimer timer;
+
+        for (int i = 0; i < count; ++i) {
+            timer.start();
+
+            MessageFramer::write(client, WatchServiceProtocol::encode(heartbeat(), format), frame);
+            client.flush();
+
+            QByteArray data;
+            SWatchServiceMessage message;
+            QVERIFY(receive(*service, serviceFramer, data));
+            QVERIFY(WatchServiceProtocol::decode(data, message));
+            QCOMPARE(message.type, CWatchService::Commands::Ping);
+
+            MessageFramer::write(*service, WatchServiceProtocol::encode(answer, format), frame);
+            service->flush();
+
+            QVERIFY(receive(client, clientFramer, data));
+            QVERIFY(WatchServiceProtocol::decode(data, message));
+            QCOMPARE(message.type, CWatchService::Commands::Protocol);
+
+            latencies << timer.nsecsElapsed() / 1000;
+        }
+
+        qDebug() << (format == WatchServiceProtocol::Binary ? "Binary" : "Text")
+                 << "round trip over local socket, us: p50" << percentile(latencies, 50) << "p99"
+                 << percentile(latencies, 99);
+    }
+}
+
+QTEST_MAIN(TestWatchServiceProtocol)
+#include "TestWatchServiceProtocol.moc"
@@ -29,6 +29,7 @@ public:
         m_Destination = aDestination;
     }
     virtual void setLevel(LogLevel::Enum aLevel) override { m_Level = aLevel; }
+    virtual bool isEnabled(LogLevel::Enum aLevel) const override { return aLevel >= m_Level; }
     virtual void adjustPadding(int aStep) override { /* Mock implementation - do nothing */ }
     virtual void write(LogLevel::Enum aLevel, const QString &aMessage) override {
         // Don't log during Qt shutdown to avoid crashes